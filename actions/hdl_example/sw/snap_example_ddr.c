@@ -25,6 +25,7 @@
 #include <getopt.h>
 #include <ctype.h>
 #include <stdbool.h>
+#include <pthread.h>
 #include <linux/random.h>
 
 #include <libsnap.h>
@@ -98,18 +99,216 @@ static void print_time(uint64_t elapsed, uint64_t size)
 	}
 }
 
+/*
+ * Pattern generation and checking work on 32 byte vectors (GCC vector
+ * extensions, AVX2 clone on x86) and are split across up to threads
+ * threads, so the host keeps up with the card on large sweeps.
+ * Mismatches are collected per slice and the first max_errors of them
+ * are reported in address order.
+ */
+typedef uint64_t v4u64_t __attribute__((vector_size(32)));
+
+#if defined(__x86_64__)
+#define DDR_CLONES __attribute__((target_clones("avx2", "default")))
+#else
+#define DDR_CLONES
+#endif
+
+#define	MAX_THREADS		64
+#define	MIN_SLICE		(64 * KILO_BYTE)  /* Less is not worth a thread */
+#define	STRIPE_WORDS		512		  /* Scalar rescan of 4 KiB */
+#define	MAX_ERRORS		256		  /* Max mismatches reported */
+#define	DEFAULT_ERRORS		10
+
+static int threads = 0;		/* 0: one per CPU */
+static int max_errors = DEFAULT_ERRORS;
+
+enum ddr_op {
+	DDR_FILL_AD,		/* Write address pattern */
+	DDR_CMP_AD,		/* Check address pattern */
+	DDR_CMP_BUF,		/* Check against expect buffer */
+};
+
+struct ddr_err {
+	uint64_t addr;		/* RAM Address */
+	uint64_t expect;
+	uint64_t data;
+};
+
+struct ddr_slice {
+	enum ddr_op op;
+	uint64_t *buf;
+	const uint64_t *expect_buf;
+	uint64_t pattern;	/* Pattern of the first word */
+	uint64_t addr;		/* RAM Address of the first word */
+	size_t words;
+	unsigned long nerr;
+	struct ddr_err err[MAX_ERRORS];
+};
+
+/* Address pattern: pattern in the low, ~pattern in the high word */
+static inline uint64_t pat_ad(uint64_t pattern)
+{
+	return (pattern & 0xffffffff) | (~pattern << 32ull);
+}
+
+/* Same for four words, a macro to keep vectors out of the call ABI */
+#define VPAT_AD(p)	(((p) & 0xffffffff) | (~(p) << 32))
+
+DDR_CLONES
+static void fill_ad(uint64_t *a64, uint64_t pattern, size_t words)
+{
+	v4u64_t p = { pattern, pattern + 8, pattern + 16, pattern + 24 };
+	v4u64_t d;
+	size_t i;
+
+	for (i = 0; i + 4 <= words; i += 4) {
+		d = VPAT_AD(p);
+		memcpy(&a64[i], &d, sizeof(d));
+		p += 32;
+	}
+	for (; i < words; i++)
+		a64[i] = pat_ad(pattern + i * 8);
+}
+
+/* Returns true if any word of the stripe differs */
+DDR_CLONES
+static bool diff_ad(const uint64_t *a64, uint64_t pattern, size_t words)
+{
+	v4u64_t p = { pattern, pattern + 8, pattern + 16, pattern + 24 };
+	v4u64_t d, acc = { 0, 0, 0, 0 };
+	size_t i;
+
+	for (i = 0; i + 4 <= words; i += 4) {
+		memcpy(&d, &a64[i], sizeof(d));
+		acc |= d ^ VPAT_AD(p);
+		p += 32;
+	}
+	for (; i < words; i++)
+		if (a64[i] != pat_ad(pattern + i * 8))
+			return true;
+	return (acc[0] | acc[1] | acc[2] | acc[3]) != 0;
+}
+
+DDR_CLONES
+static bool diff_buf(const uint64_t *a64, const uint64_t *b64, size_t words)
+{
+	v4u64_t d, e, acc = { 0, 0, 0, 0 };
+	size_t i;
+
+	for (i = 0; i + 4 <= words; i += 4) {
+		memcpy(&d, &a64[i], sizeof(d));
+		memcpy(&e, &b64[i], sizeof(e));
+		acc |= d ^ e;
+	}
+	for (; i < words; i++)
+		if (a64[i] != b64[i])
+			return true;
+	return (acc[0] | acc[1] | acc[2] | acc[3]) != 0;
+}
+
+static void *ddr_slice_run(void *arg)
+{
+	struct ddr_slice *s = arg;
+	size_t i, j, n;
+	uint64_t expect;
+	bool diff;
+
+	if (s->op == DDR_FILL_AD) {
+		fill_ad(s->buf, s->pattern, s->words);
+		return NULL;
+	}
+
+	for (i = 0; i < s->words; i += n) {
+		n = MIN(s->words - i, (size_t)STRIPE_WORDS);
+		if (s->op == DDR_CMP_AD)
+			diff = diff_ad(&s->buf[i], s->pattern + i * 8, n);
+		else	diff = diff_buf(&s->buf[i], &s->expect_buf[i], n);
+		if (!diff)
+			continue;
+
+		/* Find the words which differ */
+		for (j = i; j < i + n; j++) {
+			if (s->op == DDR_CMP_AD)
+				expect = pat_ad(s->pattern + j * 8);
+			else	expect = s->expect_buf[j];
+			if (s->buf[j] == expect)
+				continue;
+			if (s->nerr < (unsigned long)max_errors) {
+				s->err[s->nerr].addr = s->addr + j * 8;
+				s->err[s->nerr].expect = expect;
+				s->err[s->nerr].data = s->buf[j];
+			}
+			s->nerr++;
+		}
+	}
+	return NULL;
+}
+
+/*
+ *	Run op on size bytes of buf, one slice per thread.
+ *	Returns the number of mismatches.
+ */
+static unsigned long ddr_run(enum ddr_op op, void *buf, const void *expect_buf,
+			uint64_t pattern, uint64_t address, int size)
+{
+	static struct ddr_slice slice[MAX_THREADS];
+	pthread_t tid[MAX_THREADS];
+	bool started[MAX_THREADS];
+	size_t words = size / 8, start, end;
+	unsigned long nerr = 0;
+	int i, j, n, reported = 0;
+
+	n = MIN(threads, size / (int)MIN_SLICE);
+	if (n < 1)
+		n = 1;
+
+	for (i = 0; i < n; i++) {
+		/* Slices start on 64 byte boundaries */
+		start = (words * i / n) & ~7ull;
+		end = (i == n - 1) ? words : (words * (i + 1) / n) & ~7ull;
+		slice[i].op = op;
+		slice[i].buf = (uint64_t *)buf + start;
+		slice[i].expect_buf = expect_buf ?
+			(const uint64_t *)expect_buf + start : NULL;
+		slice[i].pattern = pattern + start * 8;
+		slice[i].addr = address + start * 8;
+		slice[i].words = end - start;
+		slice[i].nerr = 0;
+	}
+	for (i = 1; i < n; i++) {
+		started[i] = (pthread_create(&tid[i], NULL, ddr_slice_run,
+					     &slice[i]) == 0);
+		if (!started[i])
+			ddr_slice_run(&slice[i]);
+	}
+	ddr_slice_run(&slice[0]);
+	for (i = 1; i < n; i++)
+		if (started[i])
+			pthread_join(tid[i], NULL);
+
+	for (i = 0; i < n; i++) {
+		for (j = 0; j < (int)slice[i].nerr && j < max_errors &&
+			     reported < max_errors; j++, reported++)
+			VERBOSE0("\nError@: 0x%016llx (+0x%llx) Expect: 0x%016llx Read: 0x%016llx",
+				(long long)slice[i].err[j].addr,	/* Address */
+				(long long)(slice[i].err[j].addr - address),
+				(long long)slice[i].err[j].expect,	/* What i expect */
+				(long long)slice[i].err[j].data);	/* What i got */
+		nerr += slice[i].nerr;
+	}
+	if (nerr)
+		VERBOSE0("\n%lu mismatches in 0x%x Bytes from RAM 0x%llx",
+			nerr, size, (long long)address);
+	return nerr;
+}
+
 /*
  *	Set Pattern in Buffer
  */
 static void memset_ad(void *a, uint64_t pattern, int size)
 {
-	int i;
-	uint64_t *a64 = a;
-	for (i = 0; i < size; i += 8) {
-		*a64 = (pattern & 0xffffffff) | (~pattern << 32ull);
-		pattern += 8;
-		a64++;
-	}
+	ddr_run(DDR_FILL_AD, a, NULL, pattern, 0, size);
 }
 
 /*
@@ -148,71 +347,28 @@ static int memcmp2(void *b0,		/* Data from RAM */
 		uint64_t address,	/* RAM Address */
 		int size)
 {
-	int i;
 	int rc;
-	uint64_t *a64 = b0;
-	uint64_t *a64_1 = b1;	/* 2nd compare bufer */
-	uint64_t data;		/* Data Value */
-	uint64_t expect;	/* Compare Value */
 
 	VERBOSE3("\n      Compare Buffer %p <-> %p from RAM 0x%llx",
 		b0, b1, (long long)address);
-	rc = 0;
-	for (i = 0; i < size; i += 8) {
-		data = *a64;		/* Get data from 1st Host Buffer */
-		expect = *a64_1;	/* Get expect Value from 2nd Host Buffer */
-		if (data != expect) {
-			VERBOSE0("\nError@: 0x%016llx Expect: 0x%016llx Read: 0x%016llx",
-				(long long)address,	/* Address */
-				(long long)expect,	/* What i expect */
-				(long long)data);	/* What i got */
-			rc++;
-			if (rc > 10)
-				goto __memcmp2_exit;	/* Exit */
-		}
-		a64++;
-		a64_1++;
-		address += 8;
-	}
-	rc = 0;
-__memcmp2_exit:
+	rc = (ddr_run(DDR_CMP_BUF, b0, b1, 0, address, size) != 0);
 	VERBOSE3("  Exit: %d ", rc);
 	return rc;
 }
 
 /*
- *	Compare 2 Buffers
+ *	Compare Buffer with Pattern
  */
 static int memcmp_pat(void *h_buf,	/* Host Buffer */
-		uint64_t addr,		/* Address */
+		uint64_t pattern,	/* Pattern of the first word */
+		uint64_t address,	/* RAM Address */
 		int size)
 {
-	int i;
 	int rc;
-	uint64_t *a64 = h_buf;
-	uint64_t data;		/* Data Value */
-	uint64_t expect;	/* Compare Value */
 
 	VERBOSE3("\n      Compare: %p Pattern: 0x%016llx Size: 0x%x",
-		h_buf, (long long)addr, size);
-	rc = 0;
-	for (i = 0; i < size; i += 8) {
-		data = *a64;	/* Get data */
-		expect = (addr & 0xffffffff) | (~addr << 32ul);
-		if (data != expect) {
-			rc++;
-			VERBOSE0("\nError@: 0x%016llx Expect: 0x%016llx Read: 0x%016llx",
-				(long long)addr,	/* Address */
-				(long long)expect,	/* What i expect */
-				(long long)data);	/* What i got */
-			if (rc > 10)
-				goto __memcmp_pat_exit;	/* Exit */
-		}
-		addr += 8;
-		a64++;
-	}
-	rc = 0;
-__memcmp_pat_exit:
+		h_buf, (long long)pattern, size);
+	rc = (ddr_run(DDR_CMP_AD, h_buf, NULL, pattern, address, size) != 0);
 	VERBOSE3("  Exit: %d ", rc);
 	return rc;
 }
@@ -485,8 +641,8 @@ static int ram_test_ad(struct snap_card* dnc,
 			goto __ram_test_ad_exit;
 		t_sum += us_elappsed;
 		if (inverse)
-			rc = memcmp_pat(dest, ~card_addr, mem_size);
-		else	rc = memcmp_pat(dest, card_addr, mem_size);
+			rc = memcmp_pat(dest, ~card_addr, card_addr, mem_size);
+		else	rc = memcmp_pat(dest, card_addr, card_addr, mem_size);
 		card_addr += mem_size;
 		if (rc) {
 			dump_regs(dnc);
@@ -619,11 +775,14 @@ static void usage(const char *prog)
 		"    -e, --end            Card Ram End Address (From card)\n"
 		"    -b, --buffer         Host Buffer Size (default 0x%llx)\n"
 		"    -I, --irq            Use Interrupts\n"
+		"    -T, --threads        Host threads to check data (default all CPUs)\n"
+		"    -E, --errors         Mismatches to report (default %d, max %d)\n"
 		"\tTool to check DDR Memory (SDRAM) on KU3 and FGT Card.\n"
 		"\t     Note: values for -s -b -e must be 64 Bytes aligned.\n"
 		, prog,
 		(long long)DDR_MEM_BASE_ADDR,
-		(long long)HOST_BUFFER_SIZE);
+		(long long)HOST_BUFFER_SIZE,
+		DEFAULT_ERRORS, MAX_ERRORS);
 }
 
 int main(int argc, char *argv[])
@@ -658,9 +817,11 @@ int main(int argc, char *argv[])
 			{ "end",      required_argument, NULL, 'e' },
 			{ "buffer",   required_argument, NULL, 'b' },
 			{ "irq",      required_argument, NULL, 'I' },
+			{ "threads",  required_argument, NULL, 'T' },
+			{ "errors",   required_argument, NULL, 'E' },
 			{ 0,          no_argument,       NULL, 0   },
 		};
-		cmd = getopt_long(argc, argv, "C:i:t:s:e:b:IqvVh",
+		cmd = getopt_long(argc, argv, "C:i:t:s:e:b:T:E:IqvVh",
 			long_options, &option_index);
 		if (cmd == -1)  /* all params processed ? */
 			break;
@@ -697,6 +858,12 @@ int main(int argc, char *argv[])
 		case 'I':
 			attach_flags |= SNAP_ATTACH_IRQ | SNAP_ACTION_DONE_IRQ;
 			break;
+		case 'T':	/* threads */
+			threads = strtol(optarg, (char **)NULL, 0);
+			break;
+		case 'E':	/* errors */
+			max_errors = strtol(optarg, (char **)NULL, 0);
+			break;
 		default:
 			usage(argv[0]);
 			exit(EXIT_FAILURE);
@@ -707,6 +874,10 @@ int main(int argc, char *argv[])
 		usage(argv[0]);
 		exit(1);
 	}
+	if (threads == 0)
+		threads = sysconf(_SC_NPROCESSORS_ONLN);
+	threads = MAX(1, MIN(threads, MAX_THREADS));
+	max_errors = MAX(0, MIN(max_errors, MAX_ERRORS));
 
 	VERBOSE1("Start Memory Test. Timeout: %d sec Device: ",
 		timeout);
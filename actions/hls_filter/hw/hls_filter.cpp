@@ -0,0 +1,752 @@
+/*
+ * Copyright 2017 International Business Machines
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* SNAP HLS_FILTER EXAMPLE */
+
+#include <string.h>
+#include "ap_int.h"
+#include "action_filter.H"
+
+/* ----------------------------------------------------------------------------
+ * Filter of a column by a predicate program, see include/action_filter.h.
+ *
+ * A value is a lane of a bus word, FILTER_LANES of them per word. Each
+ * lane turns its value into an unsigned key which compares like the
+ * value: the sign bit flipped for integers, all bits of negative
+ * floats flipped and the sign bit of the others, the bytes of strings
+ * reversed so the first one is the top one. The values of the program
+ * become keys the same way. Then every lane runs the whole program on
+ * its own, so a word of values is done in a cycle.
+ *
+ * The selected lanes of a word make a bit each in the bitmap, a bus
+ * word of it every FILTER_LANES words, or their row ids are packed
+ * behind the ones before, a bus word whenever FILTER_IDS are there.
+ * Either way there is at most one word of result per word of values.
+ *
+ * Reader, filter and writer are a DATAFLOW region. The filter tells
+ * the writer the size of each burst of result words it has made, so
+ * the writer does not need to know the number of words in advance.
+ * ----------------------------------------------------------------------------
+ */
+
+//----------------------------------------------------------------------
+//--- KEYS -------------------------------------------------------------
+//----------------------------------------------------------------------
+/* Key of the value v of the column type, compared unsigned */
+template <int W>
+static ap_uint<W> filter_key(ap_uint<W> v, snapu16_t type)
+{
+	ap_uint<W> sign = 0, k;
+
+	sign[W - 1] = 1;
+	if (type == FILTER_TYPE_STRING) {
+	 filter_key_bytes:
+		for (int i = 0; i < W / 8; i++) {
+#pragma HLS UNROLL
+			k(W - 1 - 8 * i, W - 8 - 8 * i) = v(8 * i + 7, 8 * i);
+		}
+	} else if ((type == FILTER_TYPE_FLOAT ||
+		    type == FILTER_TYPE_DOUBLE) && v[W - 1])
+		k = ~v;
+	else	k = v ^ sign;
+	return k;
+}
+
+/* The program on key k */
+template <int W>
+static bool filter_eval(ap_uint<W> k, const filter_pred<W> &p)
+{
+	bool r = false, t;
+
+ filter_eval_loop:
+	for (int j = 0; j < FILTER_INSNS; j++) {
+#pragma HLS UNROLL
+		switch (p.op[j]) {
+		case FILTER_OP_EQ:
+			t = k == p.key[j];
+			break;
+		case FILTER_OP_NE:
+			t = k != p.key[j];
+			break;
+		case FILTER_OP_LT:
+			t = k < p.key[j];
+			break;
+		case FILTER_OP_LE:
+			t = k <= p.key[j];
+			break;
+		case FILTER_OP_GT:
+			t = k > p.key[j];
+			break;
+		default:
+			t = k >= p.key[j];
+			break;
+		}
+		if (j == 0)
+			r = t;
+		else if (j < p.n)
+			r = p.conn[j] ? (r || t) : (r && t);
+	}
+	return r;
+}
+
+/* The program at prog as the lanes use it, 1 if it is not valid */
+template <int W>
+static short filter_prog(snap_membus_t *pbuf, snapu16_t type,
+			 filter_pred<W> *p)
+{
+	snap_membus_t w;
+	snapu8_t op, conn;
+	short rc = 0;
+
+	p->n = pbuf[0](31, 0);
+	if (p->n == 0 || p->n > FILTER_INSNS)
+		rc = 1;
+ filter_prog_loop:
+	for (int j = 0; j < FILTER_INSNS; j++) {
+		/* filter_insn j at byte 32 + 4j, its value at 64 + 32j */
+		op = pbuf[0](8 * (32 + 4 * j) + 7, 8 * (32 + 4 * j));
+		conn = pbuf[0](8 * (33 + 4 * j) + 7, 8 * (33 + 4 * j));
+		w = pbuf[1 + j / 2];
+		p->op[j] = op;
+		p->conn[j] = conn == FILTER_CONN_OR;
+		p->key[j] = filter_key<W>(w(256 * (j % 2) + W - 1,
+					    256 * (j % 2)), type);
+		if (j < p->n && (op > FILTER_OP_GE || conn > FILTER_CONN_OR))
+			rc = 1;
+	}
+	return rc;
+}
+
+//----------------------------------------------------------------------
+//--- STREAMS ----------------------------------------------------------
+//----------------------------------------------------------------------
+/*
+ * Result word w to out while there is room, cap words in all. A burst
+ * ends where the writer has to start a new one, at the 4KiB boundary
+ * of out or after SNAP_DMA_BURST_WORDS.
+ */
+static void filter_emit(snap_membus_t w, hls::stream<snap_membus_t> &out,
+			hls::stream<filter_burst_t> &bursts, snapu64_t waddr,
+			snapu32_t cap, snapu32_t *on, snapu32_t *bn,
+			snapu32_t *blen)
+{
+	filter_burst_t b;
+
+	if (*on == cap)
+		return;
+	out.write(w);
+	*on += 1;
+	*bn += 1;
+	if (*bn == *blen) {
+		b.n = *bn;
+		b.last = false;
+		bursts.write(b);
+		*bn = 0;
+		*blen = snap_dma_burst_words(waddr + *on, cap - *on);
+	}
+}
+
+/*
+ * Filter the rows in the words of in, the bitmap or the row ids of
+ * the selected ones to out, at most cap words at word address waddr.
+ * count gets the rows selected, owords the words of result.
+ */
+template <int W>
+static void filter_words(hls::stream<snap_membus_t> &in, snapu32_t words,
+			 snapu64_t rows, snapu16_t type, filter_pred<W> pred,
+			 snapu16_t mode, snapu32_t row_base, snapu64_t waddr,
+			 snapu32_t cap, hls::stream<snap_membus_t> &out,
+			 hls::stream<filter_burst_t> &bursts,
+			 snapu64_t *count, snapu32_t *owords)
+{
+	const int L = FILTER_LANES(W);
+	snap_membus_t bitmap = 0, w;
+	snapu32_t ids[2 * FILTER_IDS];
+#pragma HLS ARRAY_PARTITION variable=ids complete
+	snapu32_t on = 0, bn = 0, blen, bpos = 0, nid = 0;
+	snapu64_t row = 0, sel = 0;
+	filter_burst_t b;
+
+	blen = snap_dma_burst_words(waddr, cap);
+
+ filter_words_loop:
+	for (snapu32_t i = 0; i < words; i++) {
+#pragma HLS PIPELINE
+		ap_uint<L> bits = 0;
+		snapu8_t pos[L + 1];
+#pragma HLS ARRAY_PARTITION variable=pos complete
+
+		w = in.read();
+		pos[0] = 0;
+	 filter_lanes_loop:
+		for (int l = 0; l < L; l++) {
+#pragma HLS UNROLL
+			ap_uint<W> v = w((l + 1) * W - 1, l * W);
+
+			bits[l] = row + l < rows &&
+				filter_eval<W>(filter_key<W>(v, type), pred);
+			pos[l + 1] = pos[l] + (bool)bits[l];
+		}
+		row += L;
+		sel += pos[L];
+
+		if (mode == FILTER_MODE_BITMAP) {
+			bitmap |= (snap_membus_t)bits << bpos;
+			bpos += L;
+			if (bpos == MEMDW || i + 1 == words) {
+				filter_emit(bitmap, out, bursts, waddr, cap,
+					    &on, &bn, &blen);
+				bitmap = 0;
+				bpos = 0;
+			}
+			continue;
+		}
+
+		/* the ids of the selected lanes behind the ones there */
+	 filter_ids_loop:
+		for (int l = 0; l < L; l++) {
+#pragma HLS UNROLL
+			if (bits[l])
+				ids[nid + pos[l]] = row_base + (snapu32_t)
+					(row - L + l);
+		}
+		nid += pos[L];
+		if (nid >= FILTER_IDS || (i + 1 == words && nid != 0)) {
+		 filter_ids_pack:
+			for (int k = 0; k < FILTER_IDS; k++) {
+#pragma HLS UNROLL
+				w(32 * k + 31, 32 * k) = k < nid ? ids[k] :
+					(snapu32_t)0;
+				ids[k] = ids[k + FILTER_IDS];
+			}
+			filter_emit(w, out, bursts, waddr, cap, &on, &bn,
+				    &blen);
+			nid = nid >= FILTER_IDS ?
+				(snapu32_t)(nid - FILTER_IDS) : (snapu32_t)0;
+		}
+	}
+	/* the ids left after a full word of the last one */
+	if (nid != 0) {
+	 filter_ids_last:
+		for (int k = 0; k < FILTER_IDS; k++) {
+#pragma HLS UNROLL
+			w(32 * k + 31, 32 * k) = k < nid ? ids[k] :
+				(snapu32_t)0;
+		}
+		filter_emit(w, out, bursts, waddr, cap, &on, &bn, &blen);
+	}
+
+	b.n = bn;
+	b.last = true;
+	bursts.write(b);
+	*count = sel;
+	*owords = on;
+}
+
+/* Write the bursts of words to addr until the last one */
+static void filter_write(hls::stream<snap_membus_t> &words,
+			 hls::stream<filter_burst_t> &bursts,
+			 snap_membus_t *host, snap_membus_t *card,
+			 snapu16_t type, snapu64_t addr, snapu64_t *stall)
+{
+	snapu64_t waddr = addr >> ADDR_RIGHT_SHIFT;
+	snapu64_t waited = 0;
+	filter_burst_t b;
+
+ filter_write_loop:
+	do {
+	filter_write_wait:
+		while (bursts.empty())
+#pragma HLS PIPELINE
+			waited++;
+		b = bursts.read();
+		if (type == SNAP_ADDRTYPE_HOST_DRAM)
+			snap_dma_burst_wrs(words, host, waddr, b.n);
+		else	snap_dma_burst_wrs(words, card, waddr, b.n);
+		waddr += b.n;
+	} while (!b.last);
+	*stall = waited;
+}
+
+template <int W>
+static void filter_flow(snap_membus_t *din_gmem, snap_membus_t *dout_gmem,
+			snap_membus_t *d_ddrmem, filter_job_t *job,
+			snapu32_t words, snapu64_t rows, filter_pred<W> pred,
+			snapu32_t cap, snapu64_t *rd_stall,
+			snapu64_t *wr_stall, snapu64_t *count,
+			snapu32_t *owords)
+{
+	hls::stream<snap_membus_t> iwords, owords_s;
+	hls::stream<filter_burst_t> bursts;
+#pragma HLS STREAM variable=iwords depth=128 /* 2 * SNAP_DMA_BURST_WORDS */
+#pragma HLS STREAM variable=owords_s depth=128
+#pragma HLS STREAM variable=bursts depth=4
+#pragma HLS DATAFLOW
+
+	snap_dma_read_stream(din_gmem, d_ddrmem, job->in.type, job->in.addr,
+			     job->in.size, iwords, rd_stall);
+	filter_words<W>(iwords, words, rows, job->type, pred, job->mode,
+			job->row_base, job->out.addr >> ADDR_RIGHT_SHIFT, cap,
+			owords_s, bursts, count, owords);
+	filter_write(owords_s, bursts, dout_gmem, d_ddrmem, job->out.type,
+		     job->out.addr, wr_stall);
+}
+
+//----------------------------------------------------------------------
+//--- MAIN PROGRAM -----------------------------------------------------
+//----------------------------------------------------------------------
+template <int W>
+static short filter_column(snap_membus_t *din_gmem, snap_membus_t *dout_gmem,
+			   snap_membus_t *d_ddrmem, action_reg *act_reg,
+			   snap_membus_t *pbuf, snap_perf_t *perf)
+{
+	filter_job_t *job = &act_reg->Data;
+	snapu64_t size = job->in.size, rows = size / (W / 8);
+	snapu64_t rd_stall = 0, wr_stall = 0, count = 0;
+	snapu32_t words = snap_dma_words(size), cap, owords = 0;
+	filter_pred<W> pred;
+	short rc;
+
+	if (size % (W / 8) != 0 ||
+	    (job->out.type != SNAP_ADDRTYPE_HOST_DRAM &&
+	     job->out.type != SNAP_ADDRTYPE_CARD_DRAM) ||
+	    (job->in.type != SNAP_ADDRTYPE_HOST_DRAM &&
+	     job->in.type != SNAP_ADDRTYPE_CARD_DRAM))
+		return 1;
+	if (job->mode == FILTER_MODE_BITMAP) {
+		if (job->out.size < (rows + 7) / 8)
+			return 1;
+		cap = (rows + MEMDW - 1) / MEMDW;
+	} else if (job->mode == FILTER_MODE_ROWIDS)
+		cap = job->out.size / BPERDW;
+	else	return 1;
+
+	rc = snap_dma_read(din_gmem, d_ddrmem, job->prog.type, job->prog.addr,
+			   pbuf, sizeof(filter_prog_t), perf);
+	if (rc != 0 || filter_prog<W>(pbuf, job->type, &pred) != 0)
+		return 1;
+
+	filter_flow<W>(din_gmem, dout_gmem, d_ddrmem, job, words, rows, pred,
+		       cap, &rd_stall, &wr_stall, &count, &owords);
+	job->count = count;
+
+	/* the filter takes a word per cycle, the reader may stall it */
+	perf->cycles += words + rd_stall;
+	perf->rd_bytes += (snapu64_t)words * BPERDW;
+	perf->wr_bytes += (snapu64_t)owords * BPERDW;
+	perf->rd_stall += rd_stall;
+	perf->wr_stall += wr_stall;
+	return 0;
+}
+
+static void process_action(snap_membus_t *din_gmem,
+			   snap_membus_t *dout_gmem,
+			   snap_membus_t *d_ddrmem,
+			   action_reg *act_reg,
+			   snap_perf_t *perf)
+{
+	static snap_membus_t pbuf[FILTER_PROG_WORDS];
+	short rc;
+
+	snap_perf_clear(perf);
+	act_reg->Data.count = 0;
+	switch (filter_width(act_reg->Data.type, act_reg->Data.width)) {
+	case 4:
+		rc = filter_column<32>(din_gmem, dout_gmem, d_ddrmem, act_reg,
+				       pbuf, perf);
+		break;
+	case 8:
+		rc = filter_column<64>(din_gmem, dout_gmem, d_ddrmem, act_reg,
+				       pbuf, perf);
+		break;
+	case 16:
+		rc = filter_column<128>(din_gmem, dout_gmem, d_ddrmem, act_reg,
+					pbuf, perf);
+		break;
+	case 32:
+		rc = filter_column<256>(din_gmem, dout_gmem, d_ddrmem, act_reg,
+					pbuf, perf);
+		break;
+	default:
+		rc = 1;
+		break;
+	}
+
+	if (rc != 0)
+		act_reg->Control.Retc = SNAP_RETC_FAILURE;
+	else	act_reg->Control.Retc = SNAP_RETC_SUCCESS;
+}
+
+//--- TOP LEVEL MODULE -------------------------------------------------
+void hls_action(snap_membus_t *din_gmem,
+		snap_membus_t *dout_gmem,
+		snap_membus_t *d_ddrmem,
+		action_reg *act_reg,
+		action_RO_config_reg *Action_Config,
+		snap_perf_t *Action_Perf)
+{
+	// Host Memory AXI Interface
+#pragma HLS INTERFACE m_axi port=din_gmem bundle=host_mem offset=slave depth=512 \
+  max_read_burst_length=64  max_write_burst_length=64 \
+  num_read_outstanding=8  num_write_outstanding=8
+#pragma HLS INTERFACE s_axilite port=din_gmem bundle=ctrl_reg offset=0x030
+
+#pragma HLS INTERFACE m_axi port=dout_gmem bundle=host_mem offset=slave depth=512 \
+  max_read_burst_length=64  max_write_burst_length=64 \
+  num_read_outstanding=8  num_write_outstanding=8
+#pragma HLS INTERFACE s_axilite port=dout_gmem bundle=ctrl_reg offset=0x040
+
+	// DDR memory Interface
+#pragma HLS INTERFACE m_axi port=d_ddrmem bundle=card_mem0 offset=slave depth=512 \
+  max_read_burst_length=64  max_write_burst_length=64 \
+  num_read_outstanding=8  num_write_outstanding=8
+#pragma HLS INTERFACE s_axilite port=d_ddrmem bundle=ctrl_reg offset=0x050
+
+	// Host Memory AXI Lite Master Interface
+#pragma HLS DATA_PACK variable=Action_Config
+#pragma HLS INTERFACE s_axilite port=Action_Config bundle=ctrl_reg offset=0x010
+#pragma HLS DATA_PACK variable=act_reg
+#pragma HLS INTERFACE s_axilite port=act_reg bundle=ctrl_reg offset=0x100
+#pragma HLS INTERFACE s_axilite port=return bundle=ctrl_reg
+
+	// Performance counters of the job, ACTION_PERF
+#pragma HLS DATA_PACK variable=Action_Perf
+#pragma HLS INTERFACE s_axilite port=Action_Perf bundle=ctrl_reg offset=0x080
+
+	/* Required Action Type Detection */
+	switch (act_reg->Control.flags) {
+	case 0:
+		Action_Config->action_type = FILTER_ACTION_TYPE;
+		Action_Config->release_level = RELEASE_LEVEL;
+		act_reg->Control.Retc = 0xe00f;
+		return;
+	default:
+		process_action(din_gmem, dout_gmem, d_ddrmem, act_reg,
+			       Action_Perf);
+		break;
+	}
+}
+
+//-----------------------------------------------------------------------------
+//--- TESTBENCH ---------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
+#if defined(NO_SYNTH) && !defined(HLS_SWEMU)
+
+#include <stdlib.h>
+
+static action_reg act_reg;
+static action_RO_config_reg Action_Config;
+static snap_perf_t Action_Perf;
+
+#define MEM_SIZE	(2 * 1024 * 1024)
+#define IN		0
+#define OUT		(512 * 1024)
+#define PROG		(1024 * 1024)
+#define DDR_SIZE	(64 * 1024)
+
+static uint32_t lcg(uint32_t *x)
+{
+	*x = *x * 1103515245U + 12345U;
+	return *x >> 16;
+}
+
+/* A value of the type from a few ones, so some of them are equal */
+static void value(uint8_t *p, unsigned int type, unsigned int width,
+		  uint32_t *x)
+{
+	int32_t i = (int32_t)(lcg(x) % 101) - 50;
+	int64_t l = (int64_t)i << 33;
+	float f = i / 4.0f;
+	double d = i / 8.0;
+	unsigned int k, len;
+
+	switch (type) {
+	case FILTER_TYPE_INT32:
+		memcpy(p, &i, 4);
+		break;
+	case FILTER_TYPE_INT64:
+		memcpy(p, &l, 8);
+		break;
+	case FILTER_TYPE_FLOAT:
+		memcpy(p, &f, 4);
+		break;
+	case FILTER_TYPE_DOUBLE:
+		memcpy(p, &d, 8);
+		break;
+	default:
+		memset(p, 0, width);
+		len = lcg(x) % (width + 1);
+		for (k = 0; k < len; k++)
+			p[k] = k < 2 ? 'a' + lcg(x) % 3 : 0x61 + lcg(x) % 128;
+		break;
+	}
+}
+
+/* Value a compared to value b, -1, 0 or 1 */
+static int compare(const uint8_t *a, const uint8_t *b, unsigned int type,
+		   unsigned int width)
+{
+	int32_t i, j;
+	int64_t l, m;
+	float f, g;
+	double d, e;
+
+	switch (type) {
+	case FILTER_TYPE_INT32:
+		memcpy(&i, a, 4);
+		memcpy(&j, b, 4);
+		return (i > j) - (i < j);
+	case FILTER_TYPE_INT64:
+		memcpy(&l, a, 8);
+		memcpy(&m, b, 8);
+		return (l > m) - (l < m);
+	case FILTER_TYPE_FLOAT:
+		memcpy(&f, a, 4);
+		memcpy(&g, b, 4);
+		return (f > g) - (f < g);
+	case FILTER_TYPE_DOUBLE:
+		memcpy(&d, a, 8);
+		memcpy(&e, b, 8);
+		return (d > e) - (d < e);
+	default:
+		i = memcmp(a, b, width);
+		return (i > 0) - (i < 0);
+	}
+}
+
+static int selected(const uint8_t *v, const filter_prog_t *prog,
+		    unsigned int type, unsigned int width)
+{
+	int r = 0, t, c;
+	unsigned int j;
+
+	for (j = 0; j < prog->n; j++) {
+		c = compare(v, prog->value[j], type, width);
+		switch (prog->insn[j].op) {
+		case FILTER_OP_EQ: t = c == 0; break;
+		case FILTER_OP_NE: t = c != 0; break;
+		case FILTER_OP_LT: t = c < 0; break;
+		case FILTER_OP_LE: t = c <= 0; break;
+		case FILTER_OP_GT: t = c > 0; break;
+		default: t = c >= 0; break;
+		}
+		if (j == 0)
+			r = t;
+		else if (prog->insn[j].conn == FILTER_CONN_OR)
+			r = r || t;
+		else	r = r && t;
+	}
+	return r;
+}
+
+static int run(snap_membus_t *mem, snap_membus_t *ddr, unsigned int type,
+	       unsigned int width, unsigned int mode, uint64_t n,
+	       uint64_t out_size)
+{
+	act_reg.Control.flags = 0x1; /* just not 0x0 */
+	act_reg.Data.in.addr = IN;
+	act_reg.Data.in.size = n * filter_width(type, width);
+	act_reg.Data.in.type = SNAP_ADDRTYPE_HOST_DRAM;
+	act_reg.Data.out.addr = OUT;
+	act_reg.Data.out.size = out_size;
+	act_reg.Data.out.type = SNAP_ADDRTYPE_HOST_DRAM;
+	act_reg.Data.prog.addr = PROG;
+	act_reg.Data.prog.size = sizeof(filter_prog_t);
+	act_reg.Data.prog.type = SNAP_ADDRTYPE_HOST_DRAM;
+	act_reg.Data.type = type;
+	act_reg.Data.width = width;
+	act_reg.Data.mode = mode;
+	act_reg.Data.row_base = 1000;
+
+	hls_action(mem, mem, ddr, &act_reg, &Action_Config, &Action_Perf);
+	return act_reg.Control.Retc == SNAP_RETC_SUCCESS ? 0 : 1;
+}
+
+/* OUT is the result of the program at PROG, cap row ids at most */
+static int check(uint8_t *m, unsigned int type, unsigned int width,
+		 unsigned int mode, uint64_t n, uint64_t cap)
+{
+	const filter_prog_t *prog = (const filter_prog_t *)(m + PROG);
+	unsigned int wb = filter_width(type, width);
+	uint64_t i, count = 0;
+	uint32_t id;
+	int s;
+
+	for (i = 0; i < n; i++) {
+		s = selected(m + IN + i * wb, prog, type, width);
+		if (mode == FILTER_MODE_BITMAP &&
+		    ((m[OUT + i / 8] >> (i % 8)) & 1) != s)
+			return 1;
+		if (mode == FILTER_MODE_ROWIDS && s && count < cap) {
+			memcpy(&id, m + OUT + count * 4, 4);
+			if (id != 1000 + i)
+				return 1;
+		}
+		count += s;
+	}
+	/* the rest of the last bitmap byte is clear */
+	if (mode == FILTER_MODE_BITMAP && n % 8 != 0 &&
+	    (m[OUT + n / 8] >> (n % 8)) != 0)
+		return 1;
+	return act_reg.Data.count != count;
+}
+
+/* A random program of the kind, values from the ones of the column */
+static void program(uint8_t *m, unsigned int kind, unsigned int type,
+		    unsigned int width, uint32_t *x)
+{
+	static const uint8_t kinds[4][FILTER_INSNS + 1][2] = {
+		/* n, then op and conn: a range, a set, a mix, all of them */
+		{ { 2 }, { FILTER_OP_GT }, { FILTER_OP_LT, FILTER_CONN_AND } },
+		{ { 3 }, { FILTER_OP_EQ }, { FILTER_OP_EQ, FILTER_CONN_OR },
+		  { FILTER_OP_EQ, FILTER_CONN_OR } },
+		{ { 4 }, { FILTER_OP_LE }, { FILTER_OP_GE, FILTER_CONN_OR },
+		  { FILTER_OP_NE, FILTER_CONN_AND },
+		  { FILTER_OP_EQ, FILTER_CONN_OR } },
+		{ { 8 }, { FILTER_OP_GE }, { FILTER_OP_NE, FILTER_CONN_AND },
+		  { FILTER_OP_LT, FILTER_CONN_AND },
+		  { FILTER_OP_EQ, FILTER_CONN_OR },
+		  { FILTER_OP_GT, FILTER_CONN_OR },
+		  { FILTER_OP_LE, FILTER_CONN_AND },
+		  { FILTER_OP_NE, FILTER_CONN_OR },
+		  { FILTER_OP_EQ, FILTER_CONN_AND } },
+	};
+	filter_prog_t *prog = (filter_prog_t *)(m + PROG);
+	unsigned int j;
+
+	memset(prog, 0, sizeof(*prog));
+	prog->n = kinds[kind][0][0];
+	for (j = 0; j < prog->n; j++) {
+		prog->insn[j].op = kinds[kind][j + 1][0];
+		prog->insn[j].conn = kinds[kind][j + 1][1];
+		value(prog->value[j], type, width, x);
+	}
+}
+
+int main(void)
+{
+	static const unsigned int types[8][2] = {
+		{ FILTER_TYPE_INT32, 0 }, { FILTER_TYPE_INT64, 0 },
+		{ FILTER_TYPE_FLOAT, 0 }, { FILTER_TYPE_DOUBLE, 0 },
+		{ FILTER_TYPE_STRING, 4 }, { FILTER_TYPE_STRING, 8 },
+		{ FILTER_TYPE_STRING, 16 }, { FILTER_TYPE_STRING, 32 } };
+	snap_membus_t *mem = (snap_membus_t *)calloc(1, MEM_SIZE);
+	snap_membus_t *ddr = (snap_membus_t *)calloc(1, DDR_SIZE);
+	uint8_t *m = (uint8_t *)mem;
+	unsigned int t, type, width, wb, mode, kind, i;
+	uint64_t ns[6], n, r, size;
+	uint32_t x = 1;
+
+	if (mem == NULL || ddr == NULL)
+		return 1;
+
+	/* Query ACTION_TYPE ... */
+	act_reg.Control.flags = 0x0;
+	hls_action(mem, mem, ddr, &act_reg, &Action_Config, &Action_Perf);
+	fprintf(stderr,
+		"ACTION_TYPE:   %08x\n"
+		"RELEASE_LEVEL: %08x\n"
+		"RETC:          %04x\n",
+		(unsigned int)Action_Config.action_type,
+		(unsigned int)Action_Config.release_level,
+		(unsigned int)act_reg.Control.Retc);
+
+	for (t = 0; t < 8; t++) {
+		type = types[t][0];
+		width = types[t][1];
+		wb = filter_width(type, width);
+
+		/* none, part of a word, a bitmap word and bursts of them */
+		ns[0] = 0;
+		ns[1] = 1;
+		ns[2] = BPERDW / wb - 1;
+		ns[3] = MEMDW;
+		ns[4] = 1000;
+		ns[5] = 4096 + 3;
+
+		for (mode = 0; mode < 2; mode++) {
+			for (kind = 0; kind < 4; kind++) {
+				for (i = 0; i < 6; i++) {
+					n = ns[i];
+					for (r = 0; r < n; r++)
+						value(m + IN + r * wb, type,
+						      width, &x);
+					program(m, kind, type, width, &x);
+					memset(m + OUT, 0xff, n * 4 + BPERDW);
+					size = mode == FILTER_MODE_BITMAP ?
+						(n + 7) / 8 : n * 4 + BPERDW;
+					if (run(mem, ddr, type, width, mode, n,
+						size) ||
+					    check(m, type, width, mode, n,
+						  n)) {
+						fprintf(stderr, " ==> TYPE %u "
+							"WIDTH %u MODE %u "
+							"PROGRAM %u %llu "
+							"FAILURE <==\n", type,
+							wb, mode, kind,
+							(unsigned long long)n);
+						return 1;
+					}
+				}
+			}
+			printf(" ==> TYPE %u WIDTH %u MODE %u OK, %llu "
+			       "SELECTED %llu CYCLES <==\n", type, wb, mode,
+			       (unsigned long long)act_reg.Data.count,
+			       (unsigned long long)Action_Perf.cycles);
+		}
+	}
+
+	/* Row ids while they fit, the count of all of them */
+	n = 4096;
+	for (r = 0; r < n; r++)
+		value(m + IN + r * 4, FILTER_TYPE_INT32, 0, &x);
+	program(m, 0, FILTER_TYPE_INT32, 0, &x);
+	memset(m + OUT, 0xff, n * 4);
+	if (run(mem, ddr, FILTER_TYPE_INT32, 0, FILTER_MODE_ROWIDS, n,
+		3 * BPERDW + 10) ||
+	    check(m, FILTER_TYPE_INT32, 0, FILTER_MODE_ROWIDS, n,
+		  3 * FILTER_IDS) ||
+	    m[OUT + 3 * BPERDW] != 0xff) {
+		fprintf(stderr, " ==> ROW IDS BEYOND OUT <==\n");
+		return 1;
+	}
+
+	/* Bad jobs fail */
+	if (run(mem, ddr, FILTER_TYPE_STRING, 12, FILTER_MODE_BITMAP, 16,
+		BPERDW) == 0 ||
+	    run(mem, ddr, FILTER_TYPE_INT32, 0, FILTER_MODE_BITMAP, 1000,
+		100) == 0 ||
+	    run(mem, ddr, FILTER_TYPE_INT32, 0, 2, 16, BPERDW) == 0) {
+		fprintf(stderr, " ==> BAD JOB NOT DETECTED <==\n");
+		return 1;
+	}
+	((filter_prog_t *)(m + PROG))->n = 0;
+	if (run(mem, ddr, FILTER_TYPE_INT32, 0, FILTER_MODE_BITMAP, 16,
+		BPERDW) == 0) {
+		fprintf(stderr, " ==> BAD PROGRAM NOT DETECTED <==\n");
+		return 1;
+	}
+	free(ddr);
+	free(mem);
+
+	printf(">> ACTION TYPE = %08lx - RELEASE_LEVEL = %08lx <<\n",
+	       (unsigned long)Action_Config.action_type,
+	       (unsigned long)Action_Config.release_level);
+	return 0;
+}
+
+#endif
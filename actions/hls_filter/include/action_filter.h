@@ -0,0 +1,131 @@
+#ifndef __ACTION_FILTER_H__
+#define __ACTION_FILTER_H__
+
+/*
+ * Copyright 2017 International Business Machines
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <snap_types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define FILTER_ACTION_TYPE 0x1014100A
+
+/* filter_job.type, the values of the column */
+#define FILTER_TYPE_INT32	0
+#define FILTER_TYPE_INT64	1
+#define FILTER_TYPE_FLOAT	2	/* IEEE single */
+#define FILTER_TYPE_DOUBLE	3	/* IEEE double */
+#define FILTER_TYPE_STRING	4	/* filter_job.width bytes */
+
+/* filter_job.mode, what goes to out */
+#define FILTER_MODE_BITMAP	0	/* a bit per row */
+#define FILTER_MODE_ROWIDS	1	/* uint32_t ids of the rows selected */
+
+/* filter_insn.op, the value of a row compared to filter_prog.value */
+#define FILTER_OP_EQ		0
+#define FILTER_OP_NE		1
+#define FILTER_OP_LT		2
+#define FILTER_OP_LE		3
+#define FILTER_OP_GT		4
+#define FILTER_OP_GE		5
+
+/* filter_insn.conn, how the result joins the ones before */
+#define FILTER_CONN_AND		0
+#define FILTER_CONN_OR		1
+
+#define FILTER_INSNS		8	/* per program */
+#define FILTER_VALUE_BYTES	32	/* longest value, strings */
+
+typedef struct filter_insn {
+	uint8_t op;		/* FILTER_OP_* */
+	uint8_t conn;		/* FILTER_CONN_*, not for the first */
+	uint16_t reserved;
+} filter_insn_t;
+
+/*
+ * Predicate program: instruction i compares the row to value[i], the
+ * results are joined from left to right without precedence, e.g.
+ *
+ *   col > x AND col < y       { GT x }, { AND LT y }
+ *   col IN (a, b, c)          { EQ a }, { OR EQ b }, { OR EQ c }
+ *
+ * A value has the type of the column, numbers in little endian, a
+ * string in its first width bytes.
+ */
+typedef struct filter_prog {
+	uint32_t n;		/* instructions, 1 ... FILTER_INSNS */
+	uint32_t reserved[7];
+	filter_insn_t insn[FILTER_INSNS];
+	uint8_t value[FILTER_INSNS][FILTER_VALUE_BYTES];
+} filter_prog_t;
+
+/*
+ * Filter of the column at in, in.size / width rows of width bytes,
+ * by the predicate program at prog. Integers compare signed, floats
+ * in IEEE total order, which puts -0 before +0 and NaNs beyond the
+ * infinities, and strings like memcmp(). A string takes all width
+ * bytes, shorter ones are padded with zeros.
+ *
+ * The bitmap has bit i % 8 of byte i / 8 set if row i is selected and
+ * needs (rows + 7) / 8 bytes in out. Row ids are row_base plus the
+ * row number of the selected rows, in order. They go to out while
+ * they fit, count tells how many there are.
+ *
+ * in, out and prog must be 64 byte aligned. Columns larger than
+ * in.size can say are filtered in parts with row_base set. out is
+ * written in full bus words, so it needs the room for the bitmap
+ * rounded up to 64 bytes, row ids fill out.size / 64 bus words.
+ */
+typedef struct filter_job {
+	struct snap_addr in;	/* in:  values of the column */
+	struct snap_addr out;	/* in:  bitmap or row ids */
+	struct snap_addr prog;	/* in:  filter_prog */
+	uint16_t type;		/* in:  FILTER_TYPE_* */
+	uint16_t width;		/* in:  bytes of a string, 4, 8, 16 or 32 */
+	uint16_t mode;		/* in:  FILTER_MODE_* */
+	uint16_t reserved;
+	uint32_t row_base;	/* in:  id of the first row */
+	uint32_t reserved2;
+	uint64_t count;		/* out: rows selected */
+} filter_job_t;
+
+/* Bytes of a value of the column */
+static inline unsigned int filter_width(unsigned int type,
+					unsigned int width)
+{
+	switch (type) {
+	case FILTER_TYPE_INT32:
+	case FILTER_TYPE_FLOAT:
+		return 4;
+	case FILTER_TYPE_INT64:
+	case FILTER_TYPE_DOUBLE:
+		return 8;
+	case FILTER_TYPE_STRING:
+		if (width == 4 || width == 8 || width == 16 || width == 32)
+			return width;
+		return 0;
+	default:
+		return 0;
+	}
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif	/* __ACTION_FILTER_H__ */
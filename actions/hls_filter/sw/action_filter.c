@@ -0,0 +1,494 @@
+/*
+ * Copyright 2017 International Business Machines
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Software version of the filter action, see include/action_filter.h.
+ *
+ * The column is taken a bus word of 64 bytes at a time, like the
+ * action does. Values of 4 and 8 bytes go through GCC vector types of
+ * 16 bytes, four per word, the compiler makes SSE or VSX code of them;
+ * wider vector types than the CPU has end up as scalar code. Every
+ * value becomes a signed key first which compares like the value, so
+ * one signed compare per instruction does all types. Strings of 16
+ * and 32 bytes are compared by memcmp(). The selected lanes of a word
+ * are a mask of bits, which goes to the bitmap as it is or becomes
+ * the row ids, one per bit set.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <libsnap.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include <snap_internal.h>
+#include <snap_tools.h>
+#include <action_filter.h>
+
+#define FILTER_WORD		64	/* bytes, a bus word of the action */
+#define FILTER_VEC		16	/* bytes, a SIMD register */
+#define FILTER_VECS		(FILTER_WORD / FILTER_VEC)
+
+typedef int32_t filter_v32 __attribute__((vector_size(FILTER_VEC)));
+typedef uint32_t filter_u32 __attribute__((vector_size(FILTER_VEC)));
+typedef int64_t filter_v64 __attribute__((vector_size(FILTER_VEC)));
+typedef uint64_t filter_u64 __attribute__((vector_size(FILTER_VEC)));
+
+/* The program with its values as keys */
+struct filter_keys {
+	filter_v32 k32[FILTER_INSNS];	/* a value in every lane */
+	filter_v64 k64[FILTER_INSNS];
+	const uint8_t *str[FILTER_INSNS];
+	uint8_t op[FILTER_INSNS];
+	uint8_t conn[FILTER_INSNS];
+	unsigned int n;
+};
+
+/* Where the result goes */
+struct filter_out {
+	uint8_t *out;
+	unsigned int mode;
+	uint32_t row_base;
+	uint64_t cap;		/* row ids that fit */
+	uint64_t count;		/* rows selected */
+};
+
+static struct snap_card *filter_card;	/* for the emulated card DRAM */
+
+static int mmio_write32(struct snap_card *card,
+			uint64_t offs, uint32_t data)
+{
+	act_trace("  %s(%p, %llx, %x)\n", __func__, card,
+		  (long long)offs, data);
+	filter_card = card;
+	return 0;
+}
+
+static int mmio_read32(struct snap_card *card,
+		       uint64_t offs, uint32_t *data)
+{
+	act_trace("  %s(%p, %llx, %x)\n", __func__, card,
+		  (long long)offs, *data);
+	filter_card = card;
+	return 0;
+}
+
+/* Memory behind a job address, NULL if it cannot be reached */
+static uint8_t *filter_mem(const struct snap_addr *a)
+{
+	switch (a->type) {
+	case SNAP_ADDRTYPE_HOST_DRAM:
+		return (uint8_t *)(unsigned long)a->addr;
+	case SNAP_ADDRTYPE_CARD_DRAM:
+		if (filter_card == NULL)
+			return NULL;
+		return snap_card_ddr_emu(filter_card, a->addr, a->size);
+	default:
+		return NULL;
+	}
+}
+
+/*
+ * Signed keys of values: integers as they are, floats with the other
+ * bits flipped if the sign is set, strings in big endian with the sign
+ * bit flipped. The vector versions below do the same on all lanes.
+ */
+static int32_t filter_key32(uint32_t v, unsigned int type)
+{
+	if (type == FILTER_TYPE_FLOAT)
+		return v ^ ((int32_t)v >> 31 & 0x7fffffff);
+	if (type == FILTER_TYPE_STRING)
+		return __builtin_bswap32(v) ^ 0x80000000;
+	return v;
+}
+
+static int64_t filter_key64(uint64_t v, unsigned int type)
+{
+	if (type == FILTER_TYPE_DOUBLE)
+		return v ^ ((int64_t)v >> 63 & 0x7fffffffffffffffll);
+	if (type == FILTER_TYPE_STRING)
+		return __builtin_bswap64(v) ^ 0x8000000000000000ull;
+	return v;
+}
+
+/*
+ * The program on the keys s[] of a word, r[] gets all ones in the
+ * lanes selected. A macro, so it works for both vector types.
+ */
+#define FILTER_CMP(r, s, k, OP, j, conn)				\
+	do {								\
+		unsigned int v_;					\
+									\
+		for (v_ = 0; v_ < FILTER_VECS; v_++) {			\
+			if ((j) == 0)					\
+				r[v_] = s[v_] OP (k);			\
+			else if (conn)					\
+				r[v_] |= s[v_] OP (k);			\
+			else						\
+				r[v_] &= s[v_] OP (k);			\
+		}							\
+	} while (0)
+
+#define FILTER_EVAL(r, s, kv, keys)					\
+	do {								\
+		unsigned int j_;					\
+		int conn_;						\
+									\
+		for (j_ = 0; j_ < (keys)->n; j_++) {			\
+			conn_ = (keys)->conn[j_] == FILTER_CONN_OR;	\
+			switch ((keys)->op[j_]) {			\
+			case FILTER_OP_EQ:				\
+				FILTER_CMP(r, s, (kv)[j_], ==, j_,	\
+					   conn_);			\
+				break;					\
+			case FILTER_OP_NE:				\
+				FILTER_CMP(r, s, (kv)[j_], !=, j_,	\
+					   conn_);			\
+				break;					\
+			case FILTER_OP_LT:				\
+				FILTER_CMP(r, s, (kv)[j_], <, j_,	\
+					   conn_);			\
+				break;					\
+			case FILTER_OP_LE:				\
+				FILTER_CMP(r, s, (kv)[j_], <=, j_,	\
+					   conn_);			\
+				break;					\
+			case FILTER_OP_GT:				\
+				FILTER_CMP(r, s, (kv)[j_], >, j_,	\
+					   conn_);			\
+				break;					\
+			default:					\
+				FILTER_CMP(r, s, (kv)[j_], >=, j_,	\
+					   conn_);			\
+				break;					\
+			}						\
+		}							\
+	} while (0)
+
+/* Lanes selected in the word at p, 16 values of 4 bytes */
+static inline uint32_t filter_word32(const uint8_t *p, unsigned int type,
+				     const struct filter_keys *keys)
+{
+	filter_u32 u[FILTER_VECS];
+	filter_v32 s[FILTER_VECS], r[FILTER_VECS];
+	unsigned int v;
+#ifdef __SSE2__
+	__m128i m[FILTER_VECS];
+#else
+	uint32_t bits = 0;
+	unsigned int i;
+#endif
+
+	memcpy(u, p, FILTER_WORD);
+	for (v = 0; v < FILTER_VECS; v++) {
+		if (type == FILTER_TYPE_FLOAT)
+			s[v] = (filter_v32)u[v] ^
+				((filter_v32)u[v] >> 31 & 0x7fffffff);
+		else if (type == FILTER_TYPE_STRING)
+			s[v] = (filter_v32)((u[v] << 24 |
+					     (u[v] & 0xff00) << 8 |
+					     (u[v] >> 8 & 0xff00) |
+					     u[v] >> 24) ^ 0x80000000);
+		else	s[v] = (filter_v32)u[v];
+	}
+	memset(r, 0, sizeof(r));
+	FILTER_EVAL(r, s, keys->k32, keys);
+
+#ifdef __SSE2__
+	memcpy(m, r, FILTER_WORD);
+	return _mm_movemask_epi8(_mm_packs_epi16(_mm_packs_epi32(m[0], m[1]),
+						 _mm_packs_epi32(m[2], m[3])));
+#else
+	for (i = 0; i < FILTER_WORD / 4; i++)
+		bits |= (uint32_t)(r[i / 4][i % 4] & 1) << i;
+	return bits;
+#endif
+}
+
+/* Lanes selected in the word at p, 8 values of 8 bytes */
+static inline uint32_t filter_word64(const uint8_t *p, unsigned int type,
+				     const struct filter_keys *keys)
+{
+	filter_u64 u[FILTER_VECS], b;
+	filter_v64 s[FILTER_VECS], r[FILTER_VECS];
+	unsigned int v;
+#ifdef __SSE2__
+	__m128i m[FILTER_VECS];
+#else
+	uint32_t bits = 0;
+	unsigned int i;
+#endif
+
+	memcpy(u, p, FILTER_WORD);
+	for (v = 0; v < FILTER_VECS; v++) {
+		if (type == FILTER_TYPE_DOUBLE)
+			s[v] = (filter_v64)u[v] ^ ((filter_v64)u[v] >> 63 &
+						   0x7fffffffffffffffll);
+		else if (type == FILTER_TYPE_STRING) {
+			b = (u[v] & 0x00ff00ff00ff00ffull) << 8 |
+				(u[v] >> 8 & 0x00ff00ff00ff00ffull);
+			b = (b & 0x0000ffff0000ffffull) << 16 |
+				(b >> 16 & 0x0000ffff0000ffffull);
+			s[v] = (filter_v64)((b << 32 | b >> 32) ^
+					    0x8000000000000000ull);
+		} else	s[v] = (filter_v64)u[v];
+	}
+	memset(r, 0, sizeof(r));
+	FILTER_EVAL(r, s, keys->k64, keys);
+
+#ifdef __SSE2__
+	memcpy(m, r, FILTER_WORD);
+	return _mm_movemask_pd(_mm_castsi128_pd(m[0])) |
+		_mm_movemask_pd(_mm_castsi128_pd(m[1])) << 2 |
+		_mm_movemask_pd(_mm_castsi128_pd(m[2])) << 4 |
+		_mm_movemask_pd(_mm_castsi128_pd(m[3])) << 6;
+#else
+	for (i = 0; i < FILTER_WORD / 8; i++)
+		bits |= (uint32_t)(r[i / 2][i % 2] & 1) << i;
+	return bits;
+#endif
+}
+
+/* Lanes selected in the word at p, strings of width bytes */
+static inline uint32_t filter_word_str(const uint8_t *p, unsigned int width,
+				       const struct filter_keys *keys)
+{
+	uint32_t bits = 0;
+	unsigned int i, j;
+	int r = 0, t, c;
+
+	for (i = 0; i < FILTER_WORD / width; i++, p += width) {
+		for (j = 0; j < keys->n; j++) {
+			c = memcmp(p, keys->str[j], width);
+			switch (keys->op[j]) {
+			case FILTER_OP_EQ:
+				t = c == 0;
+				break;
+			case FILTER_OP_NE:
+				t = c != 0;
+				break;
+			case FILTER_OP_LT:
+				t = c < 0;
+				break;
+			case FILTER_OP_LE:
+				t = c <= 0;
+				break;
+			case FILTER_OP_GT:
+				t = c > 0;
+				break;
+			default:
+				t = c >= 0;
+				break;
+			}
+			if (j == 0)
+				r = t;
+			else if (keys->conn[j] == FILTER_CONN_OR)
+				r |= t;
+			else	r &= t;
+		}
+		bits |= (uint32_t)r << i;
+	}
+	return bits;
+}
+
+/* bits of the lanes rows row ... to the result */
+static inline void filter_put(struct filter_out *o, uint64_t row,
+			      uint32_t bits, unsigned int lanes)
+{
+	uint32_t id;
+
+	if (o->mode == FILTER_MODE_BITMAP) {
+		o->count += __builtin_popcount(bits);
+		if (lanes >= 8)
+			memcpy(o->out + row / 8, &bits, lanes / 8);
+		else if (row % 8 == 0)
+			o->out[row / 8] = bits;
+		else	o->out[row / 8] |= bits << row % 8;
+		return;
+	}
+	while (bits != 0) {
+		id = o->row_base + row + __builtin_ctz(bits);
+		if (o->count < o->cap)
+			memcpy(o->out + o->count * 4, &id, 4);
+		o->count++;
+		bits &= bits - 1;
+	}
+}
+
+/*
+ * All rows of the column. The type is a constant where this is
+ * called, so the compiler makes a loop per type.
+ */
+static inline void filter_rows(const uint8_t *in, uint64_t rows,
+			       unsigned int type, unsigned int width,
+			       const struct filter_keys *keys,
+			       struct filter_out *o)
+{
+	unsigned int lanes = FILTER_WORD / width, rest;
+	uint64_t row, words = rows / lanes;
+	uint8_t last[FILTER_WORD];
+	uint32_t bits;
+
+	for (row = 0; row < words * lanes; row += lanes, in += FILTER_WORD) {
+		if (width == 4)
+			bits = filter_word32(in, type, keys);
+		else if (width == 8)
+			bits = filter_word64(in, type, keys);
+		else	bits = filter_word_str(in, width, keys);
+		filter_put(o, row, bits, lanes);
+	}
+
+	/* the rows of the last word, the lanes after them are empty */
+	rest = rows - row;
+	if (rest == 0)
+		return;
+	memset(last, 0, sizeof(last));
+	memcpy(last, in, rest * width);
+	if (width == 4)
+		bits = filter_word32(last, type, keys);
+	else if (width == 8)
+		bits = filter_word64(last, type, keys);
+	else	bits = filter_word_str(last, width, keys);
+	filter_put(o, row, bits & ((1u << rest) - 1), lanes);
+}
+
+static int action_main(struct snap_sim_action *action,
+		       void *job, unsigned int job_len)
+{
+	struct filter_job *js = (struct filter_job *)job;
+	struct filter_keys keys;
+	struct filter_out o;
+	const filter_prog_t *prog;
+	unsigned int width = filter_width(js->type, js->width), j, i;
+	uint64_t rows, bytes, wbytes;
+	uint32_t v32;
+	uint64_t v64;
+	uint8_t *in;
+
+	act_trace("%s(%p, %p, %d) in=%lld type=%d width=%d mode=%d\n",
+		  __func__, action, job, job_len, (long long)js->in.size,
+		  js->type, js->width, js->mode);
+
+	js->count = 0;
+	if (width == 0 || js->in.size % width != 0 ||
+	    (js->mode != FILTER_MODE_BITMAP &&
+	     js->mode != FILTER_MODE_ROWIDS)) {
+		act_trace("  err: bad job\n");
+		goto out_err;
+	}
+	rows = js->in.size / width;
+	if (js->mode == FILTER_MODE_BITMAP && js->out.size < (rows + 7) / 8) {
+		act_trace("  err: out too small for the bitmap\n");
+		goto out_err;
+	}
+	in = filter_mem(&js->in);
+	o.out = filter_mem(&js->out);
+	prog = (const filter_prog_t *)filter_mem(&js->prog);
+	if (in == NULL || o.out == NULL || prog == NULL) {
+		act_trace("  err: memory type not supported\n");
+		goto out_err;
+	}
+
+	keys.n = prog->n;
+	if (keys.n == 0 || keys.n > FILTER_INSNS) {
+		act_trace("  err: bad program\n");
+		goto out_err;
+	}
+	for (j = 0; j < keys.n; j++) {
+		keys.op[j] = prog->insn[j].op;
+		keys.conn[j] = prog->insn[j].conn;
+		if (keys.op[j] > FILTER_OP_GE ||
+		    keys.conn[j] > FILTER_CONN_OR) {
+			act_trace("  err: bad program\n");
+			goto out_err;
+		}
+		keys.str[j] = prog->value[j];
+		memcpy(&v32, prog->value[j], 4);
+		memcpy(&v64, prog->value[j], 8);
+		for (i = 0; i < FILTER_VEC / 4; i++)
+			keys.k32[j][i] = filter_key32(v32, js->type);
+		for (i = 0; i < FILTER_VEC / 8; i++)
+			keys.k64[j][i] = filter_key64(v64, js->type);
+	}
+
+	o.mode = js->mode;
+	o.row_base = js->row_base;
+	o.cap = js->out.size / FILTER_WORD * (FILTER_WORD / 4);
+	o.count = 0;
+	switch (js->type) {
+	case FILTER_TYPE_INT32:
+		filter_rows(in, rows, FILTER_TYPE_INT32, 4, &keys, &o);
+		break;
+	case FILTER_TYPE_INT64:
+		filter_rows(in, rows, FILTER_TYPE_INT64, 8, &keys, &o);
+		break;
+	case FILTER_TYPE_FLOAT:
+		filter_rows(in, rows, FILTER_TYPE_FLOAT, 4, &keys, &o);
+		break;
+	case FILTER_TYPE_DOUBLE:
+		filter_rows(in, rows, FILTER_TYPE_DOUBLE, 8, &keys, &o);
+		break;
+	default:
+		filter_rows(in, rows, FILTER_TYPE_STRING, width, &keys, &o);
+		break;
+	}
+
+	/* the action writes full bus words, the rest of the last is 0 */
+	if (js->mode == FILTER_MODE_BITMAP)
+		bytes = (rows + 7) / 8;
+	else	bytes = MIN(o.count, o.cap) * 4;
+	js->count = o.count;
+	wbytes = (bytes + FILTER_WORD - 1) / FILTER_WORD * FILTER_WORD;
+	memset(o.out + bytes, 0, wbytes - bytes);
+
+	action->perf.rd_bytes = (js->in.size + FILTER_WORD - 1) /
+		FILTER_WORD * FILTER_WORD + sizeof(filter_prog_t);
+	action->perf.wr_bytes = wbytes;
+
+	action->job.retc = SNAP_RETC_SUCCESS;
+	return 0;
+
+ out_err:
+	action->job.retc = SNAP_RETC_FAILURE;
+	return 0;
+}
+
+static struct snap_sim_action action = {
+	.vendor_id = SNAP_VENDOR_ID_ANY,
+	.device_id = SNAP_DEVICE_ID_ANY,
+	.action_type = FILTER_ACTION_TYPE,
+
+	.job = { .retc = SNAP_RETC_FAILURE, },
+	.state = ACTION_IDLE,
+	.main = action_main,
+	.priv_data = NULL,	/* this is passed back as void *card */
+	.mmio_write32 = mmio_write32,
+	.mmio_read32 = mmio_read32,
+
+	.next = NULL,
+};
+
+static void _init(void) __attribute__((constructor));
+
+static void _init(void)
+{
+	snap_action_register(&action);
+}
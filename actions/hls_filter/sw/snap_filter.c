@@ -0,0 +1,560 @@
+/*
+ * Copyright 2017 International Business Machines
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Filter of a column by a predicate with the filter action.
+ *
+ * The column comes from a file or is generated: integers from 0 to
+ * 999, floats of them divided by 10 and strings of lower case letters.
+ * The predicate is a list of comparisons with the column, joined by &
+ * and | from left to right, e.g. ">100&<200" or "=3|=5|=9". The result
+ * is a bitmap or the row ids of the selected rows with -r. -c checks
+ * it against a plain loop over the rows.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <malloc.h>
+#include <errno.h>
+#include <string.h>
+#include <sys/time.h>
+#include <assert.h>
+
+#include <snap_tools.h>
+#include <action_filter.h>
+#include <libsnap.h>
+#include <snap_hls_if.h>
+
+int verbose_flag = 0;
+
+static const char *version = GIT_VERSION;
+
+/**
+ * @brief	prints valid command line options
+ *
+ * @param prog	current program's name
+ */
+static void usage(const char *prog)
+{
+	printf("Usage: %s [-h] [-v, --verbose] [-V, --version]\n"
+	       "  -C, --card <cardno>       can be (0...3)\n"
+	       "  -i, --input <file>        input file, the column.\n"
+	       "  -o, --output <file>       output file, bitmap or row ids.\n"
+	       "  -n, --rows <n>            random rows instead of a file.\n"
+	       "  -T, --type <type>         int32, int64, float, double or\n"
+	       "                            string<width> (int32 default).\n"
+	       "  -p, --predicate <pred>    e.g. '>100&<200' or '=3|=5|=9'.\n"
+	       "  -r, --rowids              row ids instead of a bitmap.\n"
+	       "  -b, --row-base <id>       id of the first row.\n"
+	       "  -s, --seed <seed>         of the random rows.\n"
+	       "  -c, --check               check the result.\n"
+	       "  -t, --timeout             Timeout in sec to wait for done. (60 sec default)\n"
+	       "\n"
+	       "Example:\n"
+	       "  snap_filter -n 1000000 -p '>100&<200' -c\n"
+	       "  snap_filter -T string8 -n 1000000 -p '>=b&<c' -r -c\n"
+	       "\n",
+	       prog);
+}
+
+static uint64_t xorshift(uint64_t *x)
+{
+	*x ^= *x << 13;
+	*x ^= *x >> 7;
+	*x ^= *x << 17;
+	return *x;
+}
+
+static int parse_type(const char *s, uint16_t *type, uint16_t *width)
+{
+	*width = 0;
+	if (strcmp(s, "int32") == 0)
+		*type = FILTER_TYPE_INT32;
+	else if (strcmp(s, "int64") == 0)
+		*type = FILTER_TYPE_INT64;
+	else if (strcmp(s, "float") == 0)
+		*type = FILTER_TYPE_FLOAT;
+	else if (strcmp(s, "double") == 0)
+		*type = FILTER_TYPE_DOUBLE;
+	else if (strncmp(s, "string", 6) == 0) {
+		*type = FILTER_TYPE_STRING;
+		*width = strtol(s + 6, (char **)NULL, 0);
+	} else
+		return -1;
+	return filter_width(*type, *width) != 0 ? 0 : -1;
+}
+
+/* The value of the type at s to v, up to end */
+static int parse_value(const char *s, const char *end, unsigned int type,
+		       unsigned int width, uint8_t *v)
+{
+	char buf[64], *e;
+	int32_t i;
+	int64_t l;
+	float f;
+	double d;
+
+	if (end - s >= (int)sizeof(buf))
+		return -1;
+	memcpy(buf, s, end - s);
+	buf[end - s] = 0;
+	memset(v, 0, FILTER_VALUE_BYTES);
+
+	switch (type) {
+	case FILTER_TYPE_INT32:
+		i = strtol(buf, &e, 0);
+		memcpy(v, &i, 4);
+		break;
+	case FILTER_TYPE_INT64:
+		l = strtoll(buf, &e, 0);
+		memcpy(v, &l, 8);
+		break;
+	case FILTER_TYPE_FLOAT:
+		f = strtof(buf, &e);
+		memcpy(v, &f, 4);
+		break;
+	case FILTER_TYPE_DOUBLE:
+		d = strtod(buf, &e);
+		memcpy(v, &d, 8);
+		break;
+	default:
+		if (strlen(buf) > width)
+			return -1;
+		memcpy(v, buf, strlen(buf));
+		return 0;
+	}
+	return *e == 0 && e != buf ? 0 : -1;
+}
+
+/* The predicate s as a program for the type */
+static int parse_predicate(const char *s, unsigned int type,
+			   unsigned int width, filter_prog_t *prog)
+{
+	static const struct {
+		const char *s;
+		uint8_t op;
+	} ops[] = {	/* longest first */
+		{ "==", FILTER_OP_EQ }, { "!=", FILTER_OP_NE },
+		{ "<=", FILTER_OP_LE }, { ">=", FILTER_OP_GE },
+		{ "=", FILTER_OP_EQ }, { "<", FILTER_OP_LT },
+		{ ">", FILTER_OP_GT },
+	};
+	const char *end;
+	unsigned int k, n = 0;
+	uint8_t conn = FILTER_CONN_AND;
+
+	memset(prog, 0, sizeof(*prog));
+	while (1) {
+		if (n == FILTER_INSNS)
+			return -1;
+		for (k = 0; k < sizeof(ops) / sizeof(ops[0]); k++)
+			if (strncmp(s, ops[k].s, strlen(ops[k].s)) == 0)
+				break;
+		if (k == sizeof(ops) / sizeof(ops[0]))
+			return -1;
+		s += strlen(ops[k].s);
+		end = s + strcspn(s, "&|");
+		if (parse_value(s, end, type, width, prog->value[n]) != 0)
+			return -1;
+		prog->insn[n].op = ops[k].op;
+		prog->insn[n].conn = conn;
+		n++;
+		if (*end == 0)
+			break;
+		conn = *end == '|' ? FILTER_CONN_OR : FILTER_CONN_AND;
+		s = end + 1;
+	}
+	prog->n = n;
+	return 0;
+}
+
+/* Value a compared to value b, less than, equal or more than 0 */
+static int compare(const uint8_t *a, const uint8_t *b, unsigned int type,
+		   unsigned int width)
+{
+	int32_t i, j;
+	int64_t l, m;
+	float f, g;
+	double d, e;
+
+	switch (type) {
+	case FILTER_TYPE_INT32:
+		memcpy(&i, a, 4);
+		memcpy(&j, b, 4);
+		return (i > j) - (i < j);
+	case FILTER_TYPE_INT64:
+		memcpy(&l, a, 8);
+		memcpy(&m, b, 8);
+		return (l > m) - (l < m);
+	case FILTER_TYPE_FLOAT:
+		memcpy(&f, a, 4);
+		memcpy(&g, b, 4);
+		return (f > g) - (f < g);
+	case FILTER_TYPE_DOUBLE:
+		memcpy(&d, a, 8);
+		memcpy(&e, b, 8);
+		return (d > e) - (d < e);
+	default:
+		return memcmp(a, b, width);
+	}
+}
+
+static int selected(const uint8_t *v, const filter_prog_t *prog,
+		    unsigned int type, unsigned int width)
+{
+	int r = 0, t, c;
+	unsigned int j;
+
+	for (j = 0; j < prog->n; j++) {
+		c = compare(v, prog->value[j], type, width);
+		switch (prog->insn[j].op) {
+		case FILTER_OP_EQ:
+			t = c == 0;
+			break;
+		case FILTER_OP_NE:
+			t = c != 0;
+			break;
+		case FILTER_OP_LT:
+			t = c < 0;
+			break;
+		case FILTER_OP_LE:
+			t = c <= 0;
+			break;
+		case FILTER_OP_GT:
+			t = c > 0;
+			break;
+		default:
+			t = c >= 0;
+			break;
+		}
+		if (j == 0)
+			r = t;
+		else if (prog->insn[j].conn == FILTER_CONN_OR)
+			r = r || t;
+		else	r = r && t;
+	}
+	return r;
+}
+
+static int check(const uint8_t *in, const uint8_t *out, uint64_t rows,
+		 const struct filter_job *job, const filter_prog_t *prog)
+{
+	unsigned int width = filter_width(job->type, job->width);
+	uint64_t i, count = 0;
+	uint32_t id;
+	int s;
+
+	for (i = 0; i < rows; i++) {
+		s = selected(in + i * width, prog, job->type, job->width);
+		if (job->mode == FILTER_MODE_BITMAP &&
+		    ((out[i / 8] >> (i % 8)) & 1) != s) {
+			fprintf(stderr, "err: bit of row %lld is not %d\n",
+				(long long)i, s);
+			return -1;
+		}
+		if (job->mode == FILTER_MODE_ROWIDS && s) {
+			memcpy(&id, out + count * 4, 4);
+			if (id != (uint32_t)(job->row_base + i)) {
+				fprintf(stderr, "err: row id %lld is %u, "
+					"not %u\n", (long long)count, id,
+					(uint32_t)(job->row_base + i));
+				return -1;
+			}
+		}
+		count += s;
+	}
+	if (job->count != count) {
+		fprintf(stderr, "err: %lld rows selected, not %lld\n",
+			(long long)job->count, (long long)count);
+		return -1;
+	}
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	int ch, rc = 0;
+	int card_no = 0;
+	struct snap_card *card = NULL;
+	struct snap_action *action = NULL;
+	struct snap_job cjob;
+	struct filter_job job;
+	struct snap_action_perf perf;
+	char device[128];
+	const char *input = NULL;
+	const char *output = NULL;
+	const char *pred = ">100&<200";
+	unsigned long timeout = 60;
+	unsigned int width, rowids = 0, chk = 0, k, len;
+	uint16_t type = FILTER_TYPE_INT32, swidth = 0;
+	uint32_t row_base = 0;
+	uint64_t n = 0, size, osize, wsize, i, seed = 1, r;
+	struct timeval etime, stime;
+	ssize_t fsize;
+	uint8_t *ibuff = NULL, *obuff = NULL, *p;
+	filter_prog_t *prog = NULL;
+	int32_t i32;
+	int64_t i64;
+	float f;
+	double d;
+	long long usec;
+	FILE *fp;
+
+	while (1) {
+		int option_index = 0;
+		static struct option long_options[] = {
+			{ "card",	 required_argument, NULL, 'C' },
+			{ "input",	 required_argument, NULL, 'i' },
+			{ "output",	 required_argument, NULL, 'o' },
+			{ "rows",	 required_argument, NULL, 'n' },
+			{ "type",	 required_argument, NULL, 'T' },
+			{ "predicate",	 required_argument, NULL, 'p' },
+			{ "rowids",	 no_argument,	    NULL, 'r' },
+			{ "row-base",	 required_argument, NULL, 'b' },
+			{ "seed",	 required_argument, NULL, 's' },
+			{ "check",	 no_argument,	    NULL, 'c' },
+			{ "timeout",	 required_argument, NULL, 't' },
+			{ "version",	 no_argument,	    NULL, 'V' },
+			{ "verbose",	 no_argument,	    NULL, 'v' },
+			{ "help",	 no_argument,	    NULL, 'h' },
+			{ 0,		 no_argument,	    NULL, 0   },
+		};
+
+		ch = getopt_long(argc, argv, "C:i:o:n:T:p:rb:s:ct:Vvh",
+				 long_options, &option_index);
+		if (ch == -1)
+			break;
+
+		switch (ch) {
+		case 'C':
+			card_no = strtol(optarg, (char **)NULL, 0);
+			break;
+		case 'i':
+			input = optarg;
+			break;
+		case 'o':
+			output = optarg;
+			break;
+		case 'n':
+			n = strtoull(optarg, (char **)NULL, 0);
+			break;
+		case 'T':
+			if (parse_type(optarg, &type, &swidth) != 0) {
+				usage(argv[0]);
+				exit(EXIT_FAILURE);
+			}
+			break;
+		case 'p':
+			pred = optarg;
+			break;
+		case 'r':
+			rowids = 1;
+			break;
+		case 'b':
+			row_base = strtoul(optarg, (char **)NULL, 0);
+			break;
+		case 's':
+			seed = strtoull(optarg, (char **)NULL, 0);
+			break;
+		case 'c':
+			chk = 1;
+			break;
+		case 't':
+			timeout = strtol(optarg, (char **)NULL, 0);
+			break;
+			/* service */
+		case 'V':
+			printf("%s\n", version);
+			exit(EXIT_SUCCESS);
+		case 'v':
+			verbose_flag = 1;
+			break;
+		case 'h':
+			usage(argv[0]);
+			exit(EXIT_SUCCESS);
+			break;
+		default:
+			usage(argv[0]);
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	width = filter_width(type, swidth);
+	if (optind != argc || (input != NULL && n != 0)) {
+		usage(argv[0]);
+		exit(EXIT_FAILURE);
+	}
+
+	prog = snap_malloc(sizeof(*prog));
+	if (prog == NULL)
+		goto out_error;
+	if (parse_predicate(pred, type, swidth, prog) != 0) {
+		fprintf(stderr, "err: bad predicate %s\n", pred);
+		goto out_error;
+	}
+
+	if (input != NULL) {
+		fsize = __file_size(input);
+		if (fsize < 0)
+			goto out_error;
+		if (fsize % width != 0) {
+			fprintf(stderr, "err: %s is not made of %u byte "
+				"values\n", input, width);
+			goto out_error;
+		}
+		n = fsize / width;
+	}
+	size = n * width;
+	if (size > UINT32_MAX) {
+		fprintf(stderr, "err: column of %lld bytes too large\n",
+			(long long)size);
+		goto out_error;
+	}
+	/* row ids fill whole bus words, all of them have to fit */
+	osize = rowids ? (n * 4 + 63) / 64 * 64 : (n + 7) / 8;
+
+	/* room for the last bus word in full */
+	ibuff = snap_malloc(size + 64);
+	obuff = snap_malloc(osize + 64);
+	if (ibuff == NULL || obuff == NULL)
+		goto out_error;
+	if (input != NULL && size != 0 &&
+	    __file_read(input, ibuff, size) < 0)
+		goto out_error;
+	if (input == NULL) {
+		for (i = 0, p = ibuff; i < n; i++, p += width) {
+			r = xorshift(&seed);
+			i32 = r % 1000;
+			i64 = r % 1000;
+			f = i32 / 10.0f;
+			d = i64 / 10.0;
+			switch (type) {
+			case FILTER_TYPE_INT32:
+				memcpy(p, &i32, 4);
+				break;
+			case FILTER_TYPE_INT64:
+				memcpy(p, &i64, 8);
+				break;
+			case FILTER_TYPE_FLOAT:
+				memcpy(p, &f, 4);
+				break;
+			case FILTER_TYPE_DOUBLE:
+				memcpy(p, &d, 8);
+				break;
+			default:
+				memset(p, 0, width);
+				len = 1 + (r >> 32) % width;
+				for (k = 0; k < len; k++)
+					p[k] = 'a' + (r >> (5 * k % 60)) % 26;
+				break;
+			}
+		}
+	}
+
+	snprintf(device, sizeof(device)-1, "/dev/cxl/afu%d.0s", card_no);
+	card = snap_card_alloc_dev(device, SNAP_VENDOR_ID_IBM,
+				   SNAP_DEVICE_ID_SNAP);
+	if (card == NULL) {
+		fprintf(stderr, "err: failed to open card %u: %s\n",
+			card_no, strerror(errno));
+		goto out_error;
+	}
+
+	action = snap_attach_action(card, FILTER_ACTION_TYPE, 0, 60);
+	if (action == NULL) {
+		fprintf(stderr, "err: failed to attach action %u: %s\n",
+			card_no, strerror(errno));
+		goto out_error1;
+	}
+
+	assert(sizeof(job) <= SNAP_JOBSIZE);
+	memset(&job, 0, sizeof(job));
+	snap_addr_set(&job.in, ibuff, size, SNAP_ADDRTYPE_HOST_DRAM,
+		      SNAP_ADDRFLAG_ADDR | SNAP_ADDRFLAG_SRC);
+	snap_addr_set(&job.out, obuff, osize, SNAP_ADDRTYPE_HOST_DRAM,
+		      SNAP_ADDRFLAG_ADDR | SNAP_ADDRFLAG_DST);
+	snap_addr_set(&job.prog, prog, sizeof(*prog),
+		      SNAP_ADDRTYPE_HOST_DRAM,
+		      SNAP_ADDRFLAG_ADDR | SNAP_ADDRFLAG_SRC |
+		      SNAP_ADDRFLAG_END);
+	job.type = type;
+	job.width = swidth;
+	job.mode = rowids ? FILTER_MODE_ROWIDS : FILTER_MODE_BITMAP;
+	job.row_base = row_base;
+	snap_job_set(&cjob, &job, sizeof(job), NULL, 0);
+
+	gettimeofday(&stime, NULL);
+	rc = snap_action_sync_execute_job(action, &cjob, timeout);
+	gettimeofday(&etime, NULL);
+	if (rc != 0) {
+		fprintf(stderr, "err: job execution %d: %s!\n", rc,
+			strerror(errno));
+		goto out_error2;
+	}
+	if (cjob.retc != SNAP_RETC_SUCCESS) {
+		fprintf(stderr, "err: Unexpected RETC=%x!\n", cjob.retc);
+		goto out_error2;
+	}
+
+	usec = timediff_usec(&etime, &stime);
+	fprintf(stdout, "filter %lld rows of %u bytes selected %lld took "
+		"%lld usec (%lld MiB/s)\n", (long long)n, width,
+		(long long)job.count, usec,
+		usec ? (long long)(size * 1000000ull / usec >> 20) : 0ll);
+	if (verbose_flag && snap_action_perf(action, &perf) == 0)
+		fprintf(stdout, "cycles %lld read %lld bytes written %lld "
+			"bytes stalls read %lld write %lld\n",
+			(long long)perf.cycles, (long long)perf.rd_bytes,
+			(long long)perf.wr_bytes, (long long)perf.rd_stall,
+			(long long)perf.wr_stall);
+
+	if (chk && check(ibuff, obuff, n, &job, prog) != 0)
+		goto out_error2;
+	if (output != NULL) {
+		wsize = rowids ? job.count * 4 : osize;
+		fp = fopen(output, "w");
+		if (fp == NULL || (wsize != 0 &&
+				   fwrite(obuff, wsize, 1, fp) != 1)) {
+			fprintf(stderr, "err: cannot write %s: %s\n", output,
+				strerror(errno));
+			if (fp != NULL)
+				fclose(fp);
+			goto out_error2;
+		}
+		if (fclose(fp) != 0)
+			goto out_error2;
+	}
+
+	snap_detach_action(action);
+	snap_card_free(card);
+	__free(obuff);
+	__free(ibuff);
+	__free(prog);
+	exit(EXIT_SUCCESS);
+
+ out_error2:
+	snap_detach_action(action);
+ out_error1:
+	snap_card_free(card);
+ out_error:
+	__free(obuff);
+	__free(ibuff);
+	__free(prog);
+	exit(EXIT_FAILURE);
+}
@@ -0,0 +1,125 @@
+#!/bin/bash
+
+#
+# Copyright 2017 International Business Machines
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+
+verbose=0
+snap_card=0
+duration="NORMAL"
+
+function usage() {
+    echo "Usage:"
+    echo "  test_<action_type>.sh"
+    echo "    [-C <card>] card to be used for the test"
+    echo "    [-t <trace_level>]"
+    echo "    [-duration SHORT/NORMAL/LONG] run tests"
+    echo
+}
+
+while getopts ":C:t:d:h" opt; do
+    case $opt in
+	C)
+	snap_card=$OPTARG;
+	;;
+	t)
+	export SNAP_TRACE=$OPTARG;
+	;;
+	d)
+	duration=$OPTARG;
+	;;
+	h)
+	usage;
+	exit 0;
+	;;
+	\?)
+	echo "Invalid option: -$OPTARG" >&2
+	;;
+    esac
+done
+
+export PATH=$PATH:../software/tools
+
+snap_peek --help > /dev/null || exit 1;
+snap_poke --help > /dev/null || exit 1;
+
+#### VERSION ##########################################################
+
+if [ -z "$SNAP_CONFIG" ]; then
+	echo "CARD VERSION"
+	snap_peek -C ${snap_card} 0x0 || exit 1;
+	snap_peek -C ${snap_card} 0x8 || exit 1;
+	echo
+fi
+
+#### FILTER ###########################################################
+
+export PATH=$PATH:./hls_filter/sw
+
+function run() {
+    local name=$1; shift
+    echo -n "$name ... "
+    cmd="( $* ) > snap_filter.log 2>&1"
+    eval ${cmd}
+    if [ $? -ne 0 ]; then
+	cat snap_filter.log
+	echo "cmd: ${cmd}"
+	echo "failed"
+	exit 1
+    fi
+    echo "ok"
+}
+
+# random columns of all types to bitmaps and row ids, checked by -c
+if [ "$duration" = "SHORT" ]; then n=20000; else n=1000000; fi
+for type in int32 int64 float double; do
+    for pred in "'>100&<200'" "'=3|=5|=9|=500'" "'<=10|>=990&!=995'"; do
+	for mode in "" "-r"; do
+	    run "Doing snap_filter -T $type -p $pred $mode" \
+		"snap_filter -C${snap_card} -n $n -T $type -p $pred $mode -c"
+	done
+    done
+done
+for type in string4 string8 string16 string32; do
+    for pred in "'>=b&<d'" "'=a|=ab|=abc'" "'<c|>x&!=z'"; do
+	for mode in "" "-r"; do
+	    run "Doing snap_filter -T $type -p $pred $mode" \
+		"snap_filter -C${snap_card} -n $n -T $type -p $pred $mode -c"
+	done
+    done
+done
+run "Doing snap_filter with a row base" \
+    "snap_filter -C${snap_card} -n $n -p '<100' -r -b 0x10000000 -c"
+for i in 0 1 1000; do
+    run "Doing snap_filter of $i rows" \
+	"snap_filter -C${snap_card} -n $i -p '>500' -c"
+done
+
+# a file filtered, checked without snap_filter
+head -c $((n * 4)) /dev/urandom > filter_in.bin
+run "Doing snap_filter of a file" \
+    "snap_filter -C${snap_card} -i filter_in.bin -o filter_out.bin -p '>=-1000&<1000000'"
+if python3 -c "import struct" > /dev/null 2>&1; then
+    run "Check results" \
+	"python3 -c 'import struct; a = open(\"filter_in.bin\", \"rb\").read(); b = open(\"filter_out.bin\", \"rb\").read(); v = struct.unpack(\"<%di\" % (len(a) // 4), a); assert all(((b[i // 8] >> (i % 8)) & 1) == (-1000 <= x < 1000000) for i, x in enumerate(v))'"
+else
+    echo "python3 not found, skipping the file check"
+fi
+run "Doing snap_filter with a bad predicate" \
+    "! snap_filter -C${snap_card} -n 100 -p '~3'"
+
+rm -f filter_*.bin snap_filter.log
+echo "Test OK"
+exit 0
@@ -20,12 +20,25 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <iostream>
-#include <hls_minibuf.H>
+#include <stddef.h>
+#include <hls_burstbuf.H>
+#include <hls_recstream.H>
 
 #include "action_hashjoin_hls.H"
 
 using namespace std;
 
+/* Table entries as they are laid out in memory */
+typedef SNAP_REC_T(sizeof(table1_t)) t1_rec_t;
+typedef SNAP_REC_T(sizeof(table2_t)) t2_rec_t;
+typedef SNAP_REC_T(sizeof(table3_t)) t3_rec_t;
+
+#define REC_BITS(t, field, bits) \
+	(8 * offsetof(t, field) + (bits) - 1), (8 * offsetof(t, field))
+
+/* Table lines are read and written in bursts of 4KiB */
+#define HJ_BURST_WORDS (4096 / sizeof(snap_membus_t))
+
 // ----------------------------------------------------------------------------
 // Known Limitations => Issue #39 & #45
 //      => Transfers must be 64 byte aligned and a size of multiples of 64 bytes
@@ -46,62 +59,25 @@ static void write_HJ_regs(action_reg *reg,
 }
 
 /*
- * FIXME The table1, 2, 3 read and write code, I consider a problem. We
- *       are doing what the HLS tool should do for us in a less error
- *       prone way. We need to know about the bit positions and byte
- *       ordering of the individual fields. Those details should be known
- *       to the tool. Once the table format changes, there is a lot of code
- *       to be reviewed or worse to be changed, e.g. if one adds an element
- *       before the existing ones.
- *
- * FIXME We like to get rid of this bit cutting out code. The tool should solve
- *       this problem and avoid the user to make mistakes there.
+ * The tables are read and written as record streams (hls_recstream.H)
+ * fed by burst processes (hls_burstbuf.H). Field positions are taken
+ * from the table structs, so the code below follows changes of the
+ * table format.
  */
-
-static void copy_hashkey(snap_membus_t mem, hashkey_t key)
-{
-	snap_membus_t tmp = mem;
-
- loop_copy_hashkey:
-	for (unsigned char k = 0; k < sizeof(hashkey_t); k++) {
-#pragma HLS UNROLL /* factor=2 */
-		key[k] = tmp(7, 0);
-		tmp = tmp >> 8;
-	}
-}
-
-static snap_membus_t hashkey_to_mbus(hashkey_t key)
-{
-	snap_membus_t mem = 0;
-
- loop_hashkey_to_mbus:
-	for (char k = sizeof(hashkey_t)-1; k >= 0; k--) {
-#pragma HLS UNROLL /* factor=2 */
-		mem = mem << 8;
-		mem(7, 0) = key[k];
-	}
-	return mem;
-}
-
-static void read_table1(snap_membus_t *mem, unsigned int max_lines,
-			t1_fifo_t *fifo1, uint32_t t1_used)
+static void table1_from_recs(hls::stream<t1_rec_t> &recs, t1_fifo_t *fifo1,
+			     uint32_t t1_used)
 {
 	unsigned int i;
-	snap_4KiB_t buf;
-
-	snap_4KiB_rinit(&buf, mem, max_lines);
 
- read_table1_loop:
+ table1_from_recs_loop:
 	for (i = 0; i < t1_used; i++) {
-/* #pragma HLS PIPELINE */
-		snap_membus_t b[2];
+#pragma HLS PIPELINE
+		t1_rec_t r = recs.read();
 		table1_t t1;
 
-		snap_4KiB_get(&buf, &b[0]);
-		copy_hashkey(b[0], t1.name);
-
-		snap_4KiB_get(&buf, &b[1]);
-		t1.age = b[1](31, 0);
+		snap_rec_get_bytes(r, offsetof(table1_t, name), t1.name,
+				   sizeof(hashkey_t));
+		t1.age = r(REC_BITS(table1_t, age, 32));
 
 		fifo1->write(t1);
 #if defined(CONFIG_FIFO_DEBUG)
@@ -110,25 +86,35 @@ static void read_table1(snap_membus_t *mem, unsigned int max_lines,
 	}
 }
 
-static void read_table2(snap_membus_t *mem, unsigned int max_lines,
-			t2_fifo_t *fifo2, uint32_t t2_used)
+static void read_table1(snap_membus_t *mem, unsigned int max_lines,
+			t1_fifo_t *fifo1, uint32_t t1_used)
 {
-	unsigned int i;
-	snap_4KiB_t buf;
+#pragma HLS DATAFLOW
+	hls::stream<snap_membus_t> lines;
+	hls::stream<t1_rec_t> recs;
+#pragma HLS stream variable=lines depth=64 /* HJ_BURST_WORDS */
+
+	snap_bbuf_read<HJ_BURST_WORDS>(mem, max_lines,
+			snap_rec_lines(t1_used, sizeof(table1_t)), lines);
+	snap_rec_read<sizeof(table1_t)>(lines, t1_used, recs);
+	table1_from_recs(recs, fifo1, t1_used);
+}
 
-	snap_4KiB_rinit(&buf, mem, max_lines);
+static void table2_from_recs(hls::stream<t2_rec_t> &recs, t2_fifo_t *fifo2,
+			     uint32_t t2_used)
+{
+	unsigned int i;
 
- read_table2_loop:
+ table2_from_recs_loop:
 	for (i = 0; i < t2_used; i++) {
-/* #pragma HLS PIPELINE */
-		snap_membus_t b[2];
+#pragma HLS PIPELINE
+		t2_rec_t r = recs.read();
 		table2_t t2;
 
-		snap_4KiB_get(&buf, &b[0]);
-		copy_hashkey(b[0], t2.name);
-
-		snap_4KiB_get(&buf, &b[1]);
-		copy_hashkey(b[1], t2.animal);
+		snap_rec_get_bytes(r, offsetof(table2_t, name), t2.name,
+				   sizeof(hashkey_t));
+		snap_rec_get_bytes(r, offsetof(table2_t, animal), t2.animal,
+				   sizeof(hashkey_t));
 
 		fifo2->write(t2);
 #if defined(CONFIG_FIFO_DEBUG)
@@ -137,37 +123,62 @@ static void read_table2(snap_membus_t *mem, unsigned int max_lines,
 	}
 }
 
-static void write_table3(snap_membus_t *mem, unsigned int max_lines,
-			 t3_fifo_t *fifo3, uint32_t t3_used)
+static void read_table2(snap_membus_t *mem, unsigned int max_lines,
+			t2_fifo_t *fifo2, uint32_t t2_used)
 {
-	unsigned int i;
-	snap_4KiB_t buf;
+#pragma HLS DATAFLOW
+	hls::stream<snap_membus_t> lines;
+	hls::stream<t2_rec_t> recs;
+#pragma HLS stream variable=lines depth=64 /* HJ_BURST_WORDS */
+
+	snap_bbuf_read<HJ_BURST_WORDS>(mem, max_lines,
+			snap_rec_lines(t2_used, sizeof(table2_t)), lines);
+	snap_rec_read<sizeof(table2_t)>(lines, t2_used, recs);
+	table2_from_recs(recs, fifo2, t2_used);
+}
 
-	snap_4KiB_winit(&buf, mem, max_lines);
+/* Entries beyond t3_max are read from the fifo but dropped */
+static void table3_to_recs(t3_fifo_t *fifo3, uint32_t t3_used,
+			   uint32_t t3_max, hls::stream<t3_rec_t> &recs)
+{
+	unsigned int i;
 
-	/* extract data into target table3, or FIFO maybe? */
- write_table3_loop:
+ table3_to_recs_loop:
 	for (i = 0; i < t3_used; i++) {
-/* #pragma HLS PIPELINE */
-		snap_membus_t d[3];
+#pragma HLS PIPELINE
 		table3_t t3 = fifo3->read();
+		t3_rec_t r = 0;
 
 #if defined(CONFIG_FIFO_DEBUG)
 		fprintf(stderr, "(K) fifo3->read(%d, %s %s %d)\n",
 			i, t3.name, t3.animal, t3.age);
 #endif
-		d[0] = hashkey_to_mbus(t3.animal);
-		d[1] = hashkey_to_mbus(t3.name);
-		d[2](511, 32) = 0;
-		d[2](31, 0) = t3.age;
-
-		snap_4KiB_put(&buf, d[0]);
-		snap_4KiB_put(&buf, d[1]); 
-		snap_4KiB_put(&buf, d[2]);
+		snap_rec_set_bytes(r, offsetof(table3_t, animal), t3.animal,
+				   sizeof(hashkey_t));
+		snap_rec_set_bytes(r, offsetof(table3_t, name), t3.name,
+				   sizeof(hashkey_t));
+		r(REC_BITS(table3_t, age, 32)) = t3.age;
+
+		if (i < t3_max)
+			recs.write(r);
 	}
+}
 
-	/* FIXME Tryout for 0 entries ... */
-	snap_4KiB_flush(&buf);
+static void write_table3(snap_membus_t *mem, unsigned int max_lines,
+			 t3_fifo_t *fifo3, uint32_t t3_used)
+{
+#pragma HLS DATAFLOW
+	hls::stream<t3_rec_t> recs;
+	hls::stream<snap_membus_t> lines;
+#pragma HLS stream variable=lines depth=64 /* HJ_BURST_WORDS */
+	uint32_t t3_max = max_lines * sizeof(snap_membus_t) / sizeof(table3_t);
+	uint32_t t3_written = MIN(t3_used, t3_max);
+
+	table3_to_recs(fifo3, t3_used, t3_max, recs);
+	snap_rec_write<sizeof(table3_t)>(recs, t3_written, lines);
+	snap_bbuf_write<HJ_BURST_WORDS>(lines,
+			snap_rec_lines(t3_written, sizeof(table3_t)),
+			mem, max_lines);
 }
 //-----------------------------------------------------------------------------
 //--- MAIN PROGRAM ------------------------------------------------------------
@@ -302,7 +313,7 @@ void hls_action(snap_membus_t *din_gmem,
 //--- TESTBENCH ---------------------------------------------------------------
 //-----------------------------------------------------------------------------
 
-#if defined(NO_SYNTH)
+#if defined(NO_SYNTH) && !defined(HLS_SWEMU)
 
 /* table1 is initialized as constant for test code */
 static table1_t table1[] = {
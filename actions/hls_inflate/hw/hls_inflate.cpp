@@ -0,0 +1,1256 @@
+/*
+ * Copyright 2017 International Business Machines
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* SNAP HLS_INFLATE EXAMPLE */
+
+#include <string.h>
+#include "ap_int.h"
+#include "action_inflate.H"
+
+/* ----------------------------------------------------------------------------
+ * Raw deflate decompression, see include/action_inflate.h.
+ *
+ * The input is kept in a 64 bit buffer refilled by up to 8 bytes per
+ * cycle, so at least 57 bits are there as long as input is left. That
+ * is more than a literal/length code, its extra bits, the distance
+ * code and its extra bits together, so a literal or a match is
+ * decoded in one step.
+ *
+ * Huffman codes are decoded by a table of 2^INFLATE_LUT_BITS entries
+ * indexed by the next input bits. An entry gives the symbol and its
+ * code length, and for a literal followed by a literal with both
+ * codes fitting into the index bits the second one as well, so text
+ * goes two literals per step. Longer codes are decoded canonically:
+ * the code is compared against the first code of all lengths at once.
+ *
+ * The output and the last 32 KiB before it sit in a window of
+ * INFLATE_WINDOW bytes with 8 banks, matches at a distance of 8 bytes
+ * or more are copied 8 bytes per cycle.
+ *
+ * A step is only taken when all of its bits are in and its output
+ * fits, otherwise the job stops before it with NEED_INPUT or
+ * OUT_FULL. Block headers are read as one step, too. So a job never
+ * ends within a code and the state passed to the next job is the
+ * block type, the stored bytes left and the code lengths of the
+ * block.
+ * ----------------------------------------------------------------------------
+ */
+
+static const snapu16_t len_base[29] = {
+	3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+	35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+static const snapu8_t len_extra[29] = {
+	0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+	3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+static const snapu16_t dist_base[30] = {
+	1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+	257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+	8193, 12289, 16385, 24577 };
+static const snapu8_t dist_extra[30] = {
+	0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+	7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+/* Order the code length code lengths are stored in */
+static const snapu8_t clen_order[INFLATE_NCLEN] = {
+	16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+//----------------------------------------------------------------------
+//--- INPUT BITS -------------------------------------------------------
+//----------------------------------------------------------------------
+typedef struct {
+	snap_bytes_in_t in;
+	ap_uint<64> bits;	/* next bit in bit 0 */
+	snapu32_t nbits;	/* bits in bits */
+	snapu64_t used;		/* bits taken, from bit 0 of in */
+	snapu64_t mark;		/* used after the last complete step */
+} inflate_bits_t;
+
+/* Fill up bits by whole bytes, to 57 or more unless in runs out */
+static void inflate_refill(inflate_bits_t *b, snap_membus_t *host,
+			   snap_membus_t *card, snap_perf_t *perf)
+{
+	snapu32_t k = (64 - b->nbits) >> 3;
+
+	if (k > b->in.left)
+		k = b->in.left;
+	if (k == 0)
+		return;
+	b->bits |= (ap_uint<64>)snap_bytes_get(&b->in, host, card, k, perf)
+		<< b->nbits;
+	b->nbits += 8 * k;
+}
+
+static void inflate_drop(inflate_bits_t *b, snapu32_t n)
+{
+	b->bits >>= n;
+	b->nbits -= n;
+	b->used += n;
+}
+
+/* n <= 16 bits at bit offs of bits */
+static snapu32_t inflate_peek(inflate_bits_t *b, snapu32_t offs, snapu32_t n)
+{
+	ap_uint<64> v = b->bits >> offs;
+
+	return v(15, 0) & ((1 << n) - 1);
+}
+
+//----------------------------------------------------------------------
+//--- HUFFMAN CODES ----------------------------------------------------
+//----------------------------------------------------------------------
+
+/*
+ * Canonical decode of the next bits: sym in 8:0, code length in
+ * 12:9, 0 if no code matches.
+ */
+static ap_uint<13> inflate_find(inflate_code_t *c, ap_uint<16> next)
+{
+	snapu16_t code = 0, idx = 0;
+	snapu32_t len = 0;
+	ap_uint<13> r;
+
+ inflate_find_loop:
+	for (int l = 1; l <= INFLATE_MAXBITS; l++) {
+#pragma HLS UNROLL
+		code = (code << 1) | next[l - 1];
+		if (len == 0 && code >= c->first[l] &&
+		    code - c->first[l] < c->count[l]) {
+			len = l;
+			idx = c->offs[l] + code - c->first[l];
+		}
+	}
+	r(8, 0) = len != 0 ? (snapu16_t)c->sorted[idx] : (snapu16_t)0;
+	r(12, 9) = len;
+	return r;
+}
+
+/* As inflate_find(), by lookup for the codes in the lut */
+static ap_uint<13> inflate_sym(inflate_code_t *c, ap_uint<16> next)
+{
+	inflate_lut_t e = c->lut[next(INFLATE_LUT_BITS - 1, 0)];
+
+	if (e(12, 9) != 0)
+		return e(12, 0);
+	return inflate_find(c, next);
+}
+
+/*
+ * Length of the code found, what the next bits need to be looked at
+ * to tell: 16 if they do not hold a code.
+ */
+static snapu32_t inflate_len(ap_uint<13> s)
+{
+	return s(12, 9) != 0 ? (snapu32_t)s(12, 9) :
+		(snapu32_t)(INFLATE_MAXBITS + 1);
+}
+
+/*
+ * Tables of the code with the n code lengths lens, pairs of literals
+ * are looked up together if pairs is set. Returns 1 if there are more
+ * codes than the lengths allow.
+ */
+static short inflate_build(snapu8_t *lens, snapu32_t n, inflate_code_t *c,
+			   bool pairs)
+{
+	snapu16_t next[INFLATE_MAXBITS + 1];
+	snapu16_t code = 0, offs = 0;
+	int left = 1;
+
+ inflate_count_clear:
+	for (int l = 0; l <= INFLATE_MAXBITS; l++) {
+#pragma HLS UNROLL
+		c->count[l] = 0;
+	}
+ inflate_count_loop:
+	for (snapu32_t s = 0; s < n; s++)
+		c->count[lens[s]]++;
+
+ inflate_first_loop:
+	for (int l = 1; l <= INFLATE_MAXBITS; l++) {
+		left = 2 * left - c->count[l];
+		if (left < 0)
+			return 1;
+		c->first[l] = code;
+		c->offs[l] = offs;
+		next[l] = offs;
+		code = (code + c->count[l]) << 1;
+		offs += c->count[l];
+	}
+	c->first[0] = 0;
+	c->count[0] = 0;
+
+ inflate_sort_loop:
+	for (snapu32_t s = 0; s < n; s++) {
+		snapu8_t l = lens[s];
+
+		if (l != 0)
+			c->sorted[next[l]++] = s;
+	}
+
+ inflate_lut_loop:
+	for (snapu32_t i = 0; i < (1 << INFLATE_LUT_BITS); i++) {
+#pragma HLS PIPELINE
+		ap_uint<13> s = inflate_find(c, i);
+		inflate_lut_t e = 0;
+
+		if (s(12, 9) <= INFLATE_LUT_BITS)
+			e(12, 0) = s;
+		c->lut[i] = e;
+	}
+	if (!pairs)
+		return 0;
+
+ inflate_pair_loop:
+	for (snapu32_t i = 0; i < (1 << INFLATE_LUT_BITS); i++) {
+#pragma HLS PIPELINE
+		inflate_lut_t e = c->lut[i];
+		snapu32_t l1 = e(12, 9);
+
+		if (l1 != 0 && e(8, 0) < 256) {
+			inflate_lut_t e2 = c->lut[i >> l1];
+			snapu32_t l2 = e2(12, 9);
+
+			if (l2 != 0 && e2(8, 0) < 256 &&
+			    l1 + l2 <= INFLATE_LUT_BITS) {
+				e(20, 13) = e2(7, 0);
+				e(24, 21) = l2;
+				c->lut[i] = e;
+			}
+		}
+	}
+	return 0;
+}
+
+static void inflate_fixed(snapu8_t *lens)
+{
+ inflate_fixed_loop:
+	for (snapu32_t s = 0; s < INFLATE_NLEN + INFLATE_NDIST; s++) {
+		if (s < 144)
+			lens[s] = 8;
+		else if (s < 256)
+			lens[s] = 9;
+		else if (s < 280)
+			lens[s] = 7;
+		else if (s < INFLATE_NLEN)
+			lens[s] = 8;
+		else	lens[s] = 5;
+	}
+}
+
+static short inflate_tables(snapu8_t *lens, inflate_code_t *lcode,
+			    inflate_code_t *dcode)
+{
+	return inflate_build(lens, INFLATE_NLEN, lcode, true) |
+		inflate_build(lens + INFLATE_NLEN, INFLATE_NDIST, dcode,
+			      false);
+}
+
+//----------------------------------------------------------------------
+//--- BLOCKS -----------------------------------------------------------
+//----------------------------------------------------------------------
+
+/* n bytes of output: to out and the window at pos */
+static void inflate_emit(snapu8_t *win, snapu64_t *pos,
+			 snap_bytes_out_t *out, snap_membus_t *host,
+			 snap_membus_t *card, snap_bytes_t w, snapu32_t n,
+			 snap_perf_t *perf)
+{
+	snap_bytes_put8(win, INFLATE_WINDOW - 1, *pos, w, n);
+	snap_bytes_put(out, host, card, w, n, perf);
+	*pos += n;
+}
+
+/* Index into lens of the jth of the nlen + ndist code lengths */
+static snapu32_t inflate_lidx(snapu32_t j, snapu32_t nlen)
+{
+	return j < nlen ? j : (snapu32_t)(j - nlen + INFLATE_NLEN);
+}
+
+/* Code lengths of a dynamic block, lcode is used for their code */
+static snapu8_t inflate_dynamic(inflate_bits_t *b, snap_membus_t *host,
+				snap_membus_t *card, snapu8_t *lens,
+				inflate_code_t *lcode, snap_perf_t *perf)
+{
+	snapu8_t clens[INFLATE_NCLEN];
+	snapu32_t nlen, ndist, nclen, j, rep, l, t;
+	snapu8_t val;
+	ap_uint<13> s;
+
+	inflate_refill(b, host, card, perf);
+	if (b->nbits < 14)
+		return INFLATE_STATUS_NEED_INPUT;
+	nlen = inflate_peek(b, 0, 5) + 257;
+	ndist = inflate_peek(b, 5, 5) + 1;
+	nclen = inflate_peek(b, 10, 4) + 4;
+	inflate_drop(b, 14);
+	if (nlen > 286 || ndist > 30)
+		return INFLATE_BAD;
+
+ inflate_clen_loop:
+	for (j = 0; j < INFLATE_NCLEN; j++) {
+		snapu8_t v = 0;
+
+		if (j < nclen) {
+			inflate_refill(b, host, card, perf);
+			if (b->nbits < 3)
+				return INFLATE_STATUS_NEED_INPUT;
+			v = inflate_peek(b, 0, 3);
+			inflate_drop(b, 3);
+		}
+		clens[clen_order[j]] = v;
+	}
+	if (inflate_build(clens, INFLATE_NCLEN, lcode, false))
+		return INFLATE_BAD;
+
+ inflate_lens_clear:
+	for (j = 0; j < INFLATE_NLEN + INFLATE_NDIST; j++)
+		lens[j] = 0;
+
+	/* literal/length and distance lengths are one sequence */
+	j = 0;
+ inflate_lens_loop:
+	while (j < nlen + ndist) {
+		inflate_refill(b, host, card, perf);
+		s = inflate_sym(lcode, inflate_peek(b, 0, 16));
+		l = inflate_len(s);
+		if (l > b->nbits)
+			return b->nbits >= INFLATE_MAXBITS ? INFLATE_BAD :
+				INFLATE_STATUS_NEED_INPUT;
+		if (s(8, 0) < 16) {
+			val = s(8, 0);
+			rep = 1;
+			t = l;
+		} else if (s(8, 0) == 16) {
+			if (j == 0)
+				return INFLATE_BAD;
+			val = lens[inflate_lidx(j - 1, nlen)];
+			rep = 3 + inflate_peek(b, l, 2);
+			t = l + 2;
+		} else if (s(8, 0) == 17) {
+			val = 0;
+			rep = 3 + inflate_peek(b, l, 3);
+			t = l + 3;
+		} else {
+			val = 0;
+			rep = 11 + inflate_peek(b, l, 7);
+			t = l + 7;
+		}
+		if (t > b->nbits)
+			return INFLATE_STATUS_NEED_INPUT;
+		if (j + rep > nlen + ndist)
+			return INFLATE_BAD;
+		inflate_drop(b, t);
+
+	inflate_rep_loop:
+		for (; rep != 0; rep--, j++)
+			lens[inflate_lidx(j, nlen)] = val;
+	}
+	if (lens[256] == 0)
+		return INFLATE_BAD;
+	return INFLATE_BLOCK_END;
+}
+
+/* Block header, the tables of a Huffman coded block are built */
+static snapu8_t inflate_header(inflate_bits_t *b, snap_membus_t *host,
+			       snap_membus_t *card, inflate_state_t *st,
+			       snapu8_t *lens, inflate_code_t *lcode,
+			       inflate_code_t *dcode, snap_perf_t *perf)
+{
+	snapu32_t last, type, t;
+	snapu8_t rc;
+
+	inflate_refill(b, host, card, perf);
+	if (b->nbits < 3)
+		return INFLATE_STATUS_NEED_INPUT;
+	last = inflate_peek(b, 0, 1);
+	type = inflate_peek(b, 1, 2);
+
+	switch (type) {
+	case 0:	/* stored, LEN and NLEN from the next byte on */
+		t = 3 + ((8 - ((b->used + 3) & 7)) & 7);
+		if (t + 32 > b->nbits)
+			return INFLATE_STATUS_NEED_INPUT;
+		if (inflate_peek(b, t, 16) !=
+		    (~inflate_peek(b, t + 16, 16) & 0xffff))
+			return INFLATE_BAD;
+		st->stored_left = inflate_peek(b, t, 16);
+		st->block = INFLATE_BLOCK_STORED;
+		st->last = last;
+		inflate_drop(b, t + 32);
+		return INFLATE_BLOCK_END;
+	case 1:
+		inflate_drop(b, 3);
+		inflate_fixed(lens);
+		st->block = INFLATE_BLOCK_FIXED;
+		break;
+	case 2:
+		inflate_drop(b, 3);
+		rc = inflate_dynamic(b, host, card, lens, lcode, perf);
+		if (rc != INFLATE_BLOCK_END)
+			return rc;
+		st->block = INFLATE_BLOCK_DYNAMIC;
+		break;
+	default:
+		return INFLATE_BAD;
+	}
+	if (inflate_tables(lens, lcode, dcode))
+		return INFLATE_BAD;
+	st->last = last;
+	return INFLATE_BLOCK_END;
+}
+
+static snapu8_t inflate_stored(inflate_bits_t *b, snap_bytes_out_t *out,
+			       snap_membus_t *din_gmem,
+			       snap_membus_t *dout_gmem,
+			       snap_membus_t *d_ddrmem, inflate_state_t *st,
+			       snapu8_t *win, snapu64_t *pos, snapu64_t osize,
+			       snap_perf_t *perf)
+{
+	snapu32_t k;
+
+ inflate_stored_loop:
+	while (st->stored_left != 0) {
+#pragma HLS PIPELINE
+		if (out->total == osize)
+			return INFLATE_STATUS_OUT_FULL;
+		inflate_refill(b, din_gmem, d_ddrmem, perf);
+		k = b->nbits >> 3;
+		if (k > 8)
+			k = 8;
+		if (k > st->stored_left)
+			k = st->stored_left;
+		if (k > osize - out->total)
+			k = osize - out->total;
+		if (k == 0)
+			return INFLATE_STATUS_NEED_INPUT;
+		inflate_emit(win, pos, out, dout_gmem, d_ddrmem,
+			     b->bits(63, 0), k, perf);
+		inflate_drop(b, 8 * k);
+		st->stored_left -= k;
+		b->mark = b->used;
+	}
+	return INFLATE_BLOCK_END;
+}
+
+/* Literals and matches of a Huffman coded block, to the end of block */
+static snapu8_t inflate_codes(inflate_bits_t *b, snap_bytes_out_t *out,
+			      snap_membus_t *din_gmem,
+			      snap_membus_t *dout_gmem,
+			      snap_membus_t *d_ddrmem,
+			      inflate_code_t *lcode, inflate_code_t *dcode,
+			      snapu8_t *win, snapu64_t *pos, snapu64_t osize,
+			      snap_perf_t *perf)
+{
+	inflate_lut_t e;
+	ap_uint<13> s, d;
+	snapu32_t l, l2, t, sym, len, dist, i, k;
+	snap_bytes_t w;
+
+ inflate_codes_loop:
+	while (1) {
+		inflate_refill(b, din_gmem, d_ddrmem, perf);
+		e = lcode->lut[inflate_peek(b, 0, INFLATE_LUT_BITS)];
+		s = e(12, 9) != 0 ? (ap_uint<13>)e(12, 0) :
+			inflate_find(lcode, inflate_peek(b, 0, 16));
+		l = inflate_len(s);
+		if (l > b->nbits)
+			return b->nbits >= INFLATE_MAXBITS ? INFLATE_BAD :
+				INFLATE_STATUS_NEED_INPUT;
+		sym = s(8, 0);
+
+		if (sym < 256) {
+			if (out->total == osize)
+				return INFLATE_STATUS_OUT_FULL;
+			l2 = e(24, 21);
+			w = sym;
+			k = 1;
+			if (e(12, 9) != 0 && l2 != 0 && l + l2 <= b->nbits &&
+			    osize - out->total >= 2) {
+				w(15, 8) = e(20, 13);
+				l += l2;
+				k = 2;
+			}
+			inflate_emit(win, pos, out, dout_gmem, d_ddrmem, w, k,
+				     perf);
+			inflate_drop(b, l);
+			b->mark = b->used;
+			continue;
+		}
+		if (sym == 256) {
+			inflate_drop(b, l);
+			b->mark = b->used;
+			return INFLATE_BLOCK_END;
+		}
+		if (sym > 285)
+			return INFLATE_BAD;
+
+		/* length, distance code and distance from the same bits */
+		sym -= 257;
+		t = l + len_extra[sym];
+		if (t > b->nbits)
+			return INFLATE_STATUS_NEED_INPUT;
+		len = len_base[sym] + inflate_peek(b, l, len_extra[sym]);
+
+		d = inflate_sym(dcode, inflate_peek(b, t, 16));
+		l = inflate_len(d);
+		if (t + l > b->nbits)
+			return b->nbits - t >= INFLATE_MAXBITS ? INFLATE_BAD :
+				INFLATE_STATUS_NEED_INPUT;
+		sym = d(8, 0);
+		if (sym > 29)
+			return INFLATE_BAD;
+		t += l;
+		if (t + dist_extra[sym] > b->nbits)
+			return INFLATE_STATUS_NEED_INPUT;
+		dist = dist_base[sym] + inflate_peek(b, t, dist_extra[sym]);
+		t += dist_extra[sym];
+		if (dist > *pos)
+			return INFLATE_BAD;
+		if (len > osize - out->total)
+			return INFLATE_STATUS_OUT_FULL;
+
+		/* closer than 8 bytes, the match repeats what it writes */
+		if (dist >= 8) {
+		inflate_match_loop:
+			for (i = 0; i < len; i += 8) {
+#pragma HLS PIPELINE
+				k = MIN((snapu32_t)(len - i), (snapu32_t)8);
+				inflate_emit(win, pos, out, dout_gmem,
+					     d_ddrmem,
+					     snap_bytes_get8(win,
+							INFLATE_WINDOW - 1,
+							*pos - dist),
+					     k, perf);
+			}
+		} else {
+		inflate_match_byte_loop:
+			for (i = 0; i < len; i++) {
+#pragma HLS PIPELINE
+				inflate_emit(win, pos, out, dout_gmem,
+					     d_ddrmem,
+					     win[(*pos - dist) &
+						 (INFLATE_WINDOW - 1)],
+					     1, perf);
+			}
+		}
+		inflate_drop(b, t);
+		b->mark = b->used;
+	}
+}
+
+//----------------------------------------------------------------------
+//--- STATE ------------------------------------------------------------
+//----------------------------------------------------------------------
+static short inflate_state_read(snap_membus_t *host, snap_membus_t *card,
+				snapu16_t type, snapu64_t addr,
+				inflate_state_t *st, snapu8_t *lens,
+				snap_perf_t *perf)
+{
+	snap_membus_t words[INFLATE_STATE_WORDS];
+	short rc;
+
+	rc = snap_dma_read(host, card, type, addr, words,
+			   sizeof(inflate_state_t), perf);
+	st->block = words[0](31, 0);
+	st->last = words[0](63, 32);
+	st->stored_left = words[0](95, 64);
+
+ inflate_state_read_loop:
+	for (snapu32_t i = 0; i < INFLATE_NLEN + INFLATE_NDIST; i++) {
+		snapu32_t o = i + 16;
+
+		lens[i] = words[o / BPERDW](8 * (o % BPERDW) + 7,
+					    8 * (o % BPERDW));
+	}
+	return rc;
+}
+
+static short inflate_state_write(snap_membus_t *host, snap_membus_t *card,
+				 snapu16_t type, snapu64_t addr,
+				 inflate_state_t *st, snapu8_t *lens,
+				 snap_perf_t *perf)
+{
+	snap_membus_t words[INFLATE_STATE_WORDS];
+
+ inflate_state_clear:
+	for (int i = 0; i < (int)INFLATE_STATE_WORDS; i++)
+		words[i] = 0;
+	words[0](31, 0) = st->block;
+	words[0](63, 32) = st->last;
+	words[0](95, 64) = st->stored_left;
+
+ inflate_state_write_loop:
+	for (snapu32_t i = 0; i < INFLATE_NLEN + INFLATE_NDIST; i++) {
+		snapu32_t o = i + 16;
+
+		words[o / BPERDW](8 * (o % BPERDW) + 7, 8 * (o % BPERDW)) =
+			lens[i];
+	}
+	return snap_dma_write(host, card, type, addr, words,
+			      sizeof(inflate_state_t), perf);
+}
+
+//----------------------------------------------------------------------
+//--- MAIN PROGRAM -----------------------------------------------------
+//----------------------------------------------------------------------
+static short inflate(snap_membus_t *din_gmem, snap_membus_t *dout_gmem,
+		     snap_membus_t *d_ddrmem, action_reg *act_reg,
+		     snapu8_t *win, inflate_code_t *lcode,
+		     inflate_code_t *dcode, snap_perf_t *perf)
+{
+	inflate_state_t st;
+	snapu8_t lens[INFLATE_NLEN + INFLATE_NDIST];
+	inflate_bits_t b;
+	snap_bytes_out_t out;
+	snapu64_t dsize = act_reg->Data.dict.size;
+	snapu64_t osize = act_reg->Data.out.size;
+	snapu32_t in_bit = act_reg->Data.in_bit;
+	snapu64_t pos;
+	snapu8_t r = INFLATE_BLOCK_END;
+	short rc;
+
+	act_reg->Data.status = INFLATE_STATUS_DONE;
+	act_reg->Data.in_used = 0;
+	act_reg->Data.out_size = 0;
+	if (in_bit > 7 || (in_bit != 0 && act_reg->Data.in.size == 0))
+		return 1;
+
+	rc = inflate_state_read(din_gmem, d_ddrmem, act_reg->Data.state.type,
+				act_reg->Data.state.addr, &st, lens, perf);
+	if (st.block > INFLATE_BLOCK_DONE)
+		return 1;
+
+	/* the end of the dict goes into the window first */
+	if (dsize > INFLATE_DICT_SIZE)
+		dsize = INFLATE_DICT_SIZE;
+	snap_bytes_in_open(&b.in, din_gmem, d_ddrmem, act_reg->Data.dict.type,
+			   act_reg->Data.dict.addr + act_reg->Data.dict.size -
+			   dsize, dsize, perf);
+ inflate_dict_loop:
+	for (pos = 0; pos < dsize; pos += 8) {
+#pragma HLS PIPELINE
+		snapu32_t k = MIN((snapu64_t)(dsize - pos), (snapu64_t)8);
+
+		snap_bytes_put8(win, INFLATE_WINDOW - 1, pos,
+				snap_bytes_get(&b.in, din_gmem, d_ddrmem, k,
+					       perf), k);
+	}
+	pos = dsize;
+	rc |= b.in.rc;
+
+	snap_bytes_in_open(&b.in, din_gmem, d_ddrmem, act_reg->Data.in.type,
+			   act_reg->Data.in.addr, act_reg->Data.in.size, perf);
+	b.bits = 0;
+	b.nbits = 0;
+	b.used = 0;
+	inflate_refill(&b, din_gmem, d_ddrmem, perf);
+	inflate_drop(&b, in_bit);
+	b.mark = b.used;
+	snap_bytes_out_open(&out, act_reg->Data.out.type,
+			    act_reg->Data.out.addr);
+
+	if (st.block == INFLATE_BLOCK_FIXED ||
+	    st.block == INFLATE_BLOCK_DYNAMIC)
+		rc |= inflate_tables(lens, lcode, dcode);
+
+ inflate_block_loop:
+	while (rc == 0 && r == INFLATE_BLOCK_END &&
+	       st.block != INFLATE_BLOCK_DONE) {
+		switch (st.block) {
+		case INFLATE_BLOCK_HEADER:
+			r = inflate_header(&b, din_gmem, d_ddrmem, &st, lens,
+					   lcode, dcode, perf);
+			if (r == INFLATE_BLOCK_END)
+				b.mark = b.used;
+			continue;
+		case INFLATE_BLOCK_STORED:
+			r = inflate_stored(&b, &out, din_gmem, dout_gmem,
+					   d_ddrmem, &st, win, &pos, osize,
+					   perf);
+			break;
+		default:
+			r = inflate_codes(&b, &out, din_gmem, dout_gmem,
+					  d_ddrmem, lcode, dcode, win, &pos,
+					  osize, perf);
+			break;
+		}
+		if (r == INFLATE_BLOCK_END)
+			st.block = st.last ? INFLATE_BLOCK_DONE :
+				INFLATE_BLOCK_HEADER;
+	}
+	snap_bytes_flush(&out, dout_gmem, d_ddrmem, perf);
+	rc |= inflate_state_write(dout_gmem, d_ddrmem,
+				  act_reg->Data.state.type,
+				  act_reg->Data.state.addr, &st, lens, perf);
+
+	if (r == INFLATE_BAD)
+		rc = 1;
+	else if (r != INFLATE_BLOCK_END)
+		act_reg->Data.status = r;
+	act_reg->Data.in_used = b.mark - in_bit;
+	act_reg->Data.out_size = out.total;
+	return rc | b.in.rc | out.rc;
+}
+
+static void process_action(snap_membus_t *din_gmem,
+			   snap_membus_t *dout_gmem,
+			   snap_membus_t *d_ddrmem,
+			   action_reg *act_reg,
+			   snap_perf_t *perf)
+{
+	static snapu8_t win[INFLATE_WINDOW];
+	static inflate_code_t lcode, dcode;
+#pragma HLS ARRAY_PARTITION variable=win cyclic factor=8
+#pragma HLS ARRAY_PARTITION variable=lcode.count complete
+#pragma HLS ARRAY_PARTITION variable=lcode.first complete
+#pragma HLS ARRAY_PARTITION variable=lcode.offs complete
+#pragma HLS ARRAY_PARTITION variable=dcode.count complete
+#pragma HLS ARRAY_PARTITION variable=dcode.first complete
+#pragma HLS ARRAY_PARTITION variable=dcode.offs complete
+	short rc;
+
+	snap_perf_clear(perf);
+	rc = inflate(din_gmem, dout_gmem, d_ddrmem, act_reg, win, &lcode,
+		     &dcode, perf);
+
+	if (rc != 0)
+		act_reg->Control.Retc = SNAP_RETC_FAILURE;
+	else	act_reg->Control.Retc = SNAP_RETC_SUCCESS;
+}
+
+//--- TOP LEVEL MODULE -------------------------------------------------
+void hls_action(snap_membus_t *din_gmem,
+		snap_membus_t *dout_gmem,
+		snap_membus_t *d_ddrmem,
+		action_reg *act_reg,
+		action_RO_config_reg *Action_Config,
+		snap_perf_t *Action_Perf)
+{
+	// Host Memory AXI Interface
+#pragma HLS INTERFACE m_axi port=din_gmem bundle=host_mem offset=slave depth=512 \
+  max_read_burst_length=64  max_write_burst_length=64 \
+  num_read_outstanding=8  num_write_outstanding=8
+#pragma HLS INTERFACE s_axilite port=din_gmem bundle=ctrl_reg offset=0x030
+
+#pragma HLS INTERFACE m_axi port=dout_gmem bundle=host_mem offset=slave depth=512 \
+  max_read_burst_length=64  max_write_burst_length=64 \
+  num_read_outstanding=8  num_write_outstanding=8
+#pragma HLS INTERFACE s_axilite port=dout_gmem bundle=ctrl_reg offset=0x040
+
+	// DDR memory Interface
+#pragma HLS INTERFACE m_axi port=d_ddrmem bundle=card_mem0 offset=slave depth=512 \
+  max_read_burst_length=64  max_write_burst_length=64 \
+  num_read_outstanding=8  num_write_outstanding=8
+#pragma HLS INTERFACE s_axilite port=d_ddrmem bundle=ctrl_reg offset=0x050
+
+	// Host Memory AXI Lite Master Interface
+#pragma HLS DATA_PACK variable=Action_Config
+#pragma HLS INTERFACE s_axilite port=Action_Config bundle=ctrl_reg offset=0x010
+#pragma HLS DATA_PACK variable=act_reg
+#pragma HLS INTERFACE s_axilite port=act_reg bundle=ctrl_reg offset=0x100
+#pragma HLS INTERFACE s_axilite port=return bundle=ctrl_reg
+
+	// Performance counters of the job, ACTION_PERF
+#pragma HLS DATA_PACK variable=Action_Perf
+#pragma HLS INTERFACE s_axilite port=Action_Perf bundle=ctrl_reg offset=0x080
+
+	/* Required Action Type Detection */
+	switch (act_reg->Control.flags) {
+	case 0:
+		Action_Config->action_type = INFLATE_ACTION_TYPE;
+		Action_Config->release_level = RELEASE_LEVEL;
+		act_reg->Control.Retc = 0xe00f;
+		return;
+	default:
+		process_action(din_gmem, dout_gmem, d_ddrmem, act_reg,
+			       Action_Perf);
+		break;
+	}
+}
+
+//-----------------------------------------------------------------------------
+//--- TESTBENCH ---------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
+#if defined(NO_SYNTH) && !defined(HLS_SWEMU)
+
+#include <stdlib.h>
+
+/* text(4000, 1), zlib level 9 */
+static const uint8_t dyn_stream[] = {
+	0x85, 0x57, 0x5b, 0x92, 0xa3, 0x30, 0x10, 0xfb,
+	0xef, 0x53, 0x70, 0x35, 0x96, 0x90, 0x4d, 0x6a,
+	0x33, 0x64, 0x2a, 0x61, 0x6b, 0xae, 0xbf, 0x85,
+	0xfb, 0x61, 0x49, 0x26, 0xb5, 0x1f, 0x03, 0x04,
+	0xe3, 0x7e, 0x59, 0x52, 0xf7, 0x2c, 0xf3, 0xeb,
+	0x32, 0x3d, 0xd6, 0xed, 0xf7, 0x7e, 0x9b, 0xee,
+	0xdb, 0xf5, 0x31, 0xef, 0xeb, 0xf4, 0x35, 0xef,
+	0xcb, 0x8d, 0xae, 0x97, 0x15, 0x57, 0x7e, 0xee,
+	0xdb, 0xe5, 0xf9, 0x33, 0x2d, 0xc7, 0xd6, 0xe5,
+	0x79, 0x59, 0x27, 0xbb, 0xdc, 0xdf, 0xfb, 0xbc,
+	0x2d, 0xeb, 0x54, 0x0f, 0x69, 0xeb, 0xf6, 0x7c,
+	0xef, 0xf5, 0xc3, 0xf2, 0x21, 0x1c, 0x36, 0x0b,
+	0x69, 0xdb, 0xda, 0xa7, 0xed, 0xd2, 0xde, 0xb7,
+	0xa7, 0x5f, 0x8f, 0xe7, 0xf2, 0x67, 0x7a, 0xdc,
+	0xf7, 0xf5, 0x35, 0x3f, 0xa6, 0xf7, 0xfe, 0x5a,
+	0xe7, 0xaf, 0xee, 0x84, 0x57, 0x7d, 0xd7, 0xdf,
+	0xeb, 0xf5, 0x6b, 0xde, 0x24, 0xee, 0xfd, 0xd6,
+	0x23, 0x52, 0x23, 0x91, 0xcd, 0xf1, 0x89, 0x87,
+	0x10, 0xc1, 0x1d, 0x2f, 0xdc, 0x4a, 0x3a, 0x48,
+	0x6b, 0xee, 0x56, 0xed, 0xa4, 0x67, 0x0a, 0x27,
+	0x6c, 0x99, 0x6f, 0xf1, 0xab, 0x99, 0xe1, 0x5a,
+	0xee, 0x0b, 0x7b, 0xad, 0xa0, 0xed, 0x92, 0x86,
+	0xb0, 0x58, 0xf9, 0x0e, 0x8f, 0x20, 0xd6, 0xa5,
+	0x2a, 0x6e, 0x22, 0xdc, 0xb7, 0xef, 0xaa, 0x00,
+	0xdb, 0xfc, 0xed, 0x17, 0x4f, 0xcf, 0xa4, 0x32,
+	0x47, 0xe2, 0x6d, 0xf9, 0x78, 0x70, 0x63, 0x43,
+	0x92, 0x14, 0xa0, 0x9b, 0x89, 0xdd, 0xb1, 0x21,
+	0x4a, 0x95, 0xdf, 0xe7, 0x6f, 0xcf, 0xee, 0x88,
+	0xc6, 0x72, 0xf7, 0xe1, 0xa5, 0x96, 0xf1, 0x08,
+	0x4f, 0x0d, 0x0a, 0x82, 0x3a, 0xf0, 0x56, 0xca,
+	0x21, 0x3f, 0x1b, 0xd6, 0x9b, 0x07, 0x84, 0x83,
+	0x07, 0xd3, 0x61, 0x07, 0xd5, 0xa3, 0x8a, 0x87,
+	0x61, 0x40, 0xcb, 0x00, 0x80, 0xc3, 0xc6, 0x40,
+	0x00, 0x2f, 0x4e, 0xb3, 0x27, 0xb1, 0x5b, 0x2b,
+	0xb2, 0xfb, 0x23, 0x9a, 0xc4, 0xb1, 0x50, 0xad,
+	0xe9, 0xf0, 0xda, 0x9b, 0x23, 0x84, 0x0e, 0x16,
+	0xdf, 0xc3, 0xc7, 0xe3, 0x6e, 0xd2, 0x1b, 0xc2,
+	0x88, 0x93, 0xa1, 0x3c, 0x8b, 0xb8, 0x61, 0x2a,
+	0xef, 0x02, 0x92, 0xd8, 0xda, 0xe2, 0x66, 0x96,
+	0x74, 0x78, 0xa9, 0xa9, 0x60, 0x41, 0x5b, 0xf3,
+	0x62, 0x09, 0x4a, 0x0a, 0x79, 0xb9, 0x93, 0x54,
+	0x04, 0x81, 0x02, 0xf5, 0x37, 0xce, 0xd3, 0x7d,
+	0x90, 0x50, 0x59, 0x2f, 0x5a, 0x28, 0x46, 0xec,
+	0x20, 0xfc, 0x7a, 0x61, 0x2a, 0x78, 0xc0, 0x45,
+	0x9d, 0x69, 0x81, 0xe7, 0x93, 0x20, 0x05, 0x13,
+	0x3a, 0xb7, 0x40, 0xc4, 0x22, 0x98, 0x4f, 0xcc,
+	0x08, 0x53, 0x45, 0xbc, 0xae, 0x81, 0xc7, 0xaf,
+	0xae, 0x8d, 0xe5, 0xab, 0x7d, 0x19, 0x46, 0xf9,
+	0xf4, 0xc5, 0x13, 0x91, 0x6a, 0x60, 0x72, 0x27,
+	0xb9, 0x54, 0x25, 0xef, 0x45, 0xc7, 0x2a, 0xa2,
+	0x7b, 0x13, 0x34, 0x53, 0xf9, 0x99, 0x13, 0xfe,
+	0x4e, 0xd1, 0x20, 0xf2, 0x86, 0x65, 0x1d, 0x82,
+	0x15, 0x56, 0x93, 0x9c, 0x79, 0x34, 0x55, 0xa4,
+	0x48, 0x3e, 0x4d, 0xa5, 0xe4, 0x52, 0xab, 0xe9,
+	0xa9, 0xa4, 0x11, 0xc4, 0x16, 0x60, 0x1a, 0xe1,
+	0x56, 0x5a, 0x5a, 0xd2, 0xa0, 0xa7, 0xaf, 0x15,
+	0x8a, 0x50, 0x06, 0x2d, 0x02, 0x68, 0x20, 0x8d,
+	0x88, 0xbc, 0x0a, 0x13, 0xa4, 0x2a, 0xca, 0x97,
+	0xde, 0x13, 0x46, 0x7e, 0x6b, 0x76, 0x4b, 0xdf,
+	0xd3, 0x46, 0xaa, 0x07, 0xa0, 0xd5, 0x10, 0x0e,
+	0xf1, 0xdd, 0x79, 0x9b, 0xe3, 0x5e, 0xa2, 0x27,
+	0x56, 0x80, 0xe5, 0xfa, 0xe9, 0x7d, 0x3c, 0xe0,
+	0xa2, 0x1c, 0x9d, 0x31, 0x46, 0x9c, 0x7b, 0xab,
+	0x1b, 0x17, 0x2b, 0xeb, 0x40, 0x72, 0x6f, 0x68,
+	0xaa, 0x30, 0xac, 0xa6, 0x10, 0xd6, 0x2b, 0x47,
+	0x86, 0xca, 0xf6, 0xa7, 0xc6, 0x02, 0x72, 0x1e,
+	0xc1, 0xb9, 0x9c, 0x41, 0xf9, 0x74, 0x5c, 0x20,
+	0x79, 0x45, 0xe0, 0x78, 0x5a, 0xea, 0x19, 0xb0,
+	0x86, 0xa8, 0x24, 0x37, 0x76, 0x4a, 0x63, 0x9e,
+	0x7d, 0x88, 0xb7, 0xd5, 0x2c, 0xa8, 0x0b, 0xa0,
+	0xd4, 0xf6, 0x37, 0xaa, 0xf8, 0x46, 0x40, 0x20,
+	0x9e, 0xd3, 0x58, 0x23, 0x53, 0x24, 0x1f, 0x06,
+	0x4e, 0x93, 0x04, 0x74, 0x33, 0x48, 0x36, 0xff,
+	0x4e, 0x9a, 0xa6, 0xfd, 0xff, 0x88, 0x84, 0xfa,
+	0x96, 0x65, 0x2e, 0x25, 0xa5, 0x5c, 0xb3, 0x12,
+	0x27, 0x9d, 0xb9, 0x8f, 0xa4, 0xcc, 0x3e, 0x16,
+	0xe0, 0x4f, 0x1d, 0x53, 0x06, 0x31, 0x68, 0xf0,
+	0x59, 0xc2, 0xc4, 0xc2, 0xe1, 0x5a, 0xf9, 0x45,
+	0x6d, 0xb4, 0x02, 0xee, 0xa2, 0xa2, 0xf2, 0x7c,
+	0x76, 0x38, 0xc8, 0x1d, 0x21, 0x7a, 0xf7, 0xd3,
+	0xab, 0xae, 0x07, 0x4e, 0x25, 0x61, 0x29, 0x4f,
+	0x5d, 0x41, 0x6c, 0xf9, 0x42, 0x6b, 0x9c, 0x80,
+	0x6b, 0x4a, 0x5e, 0x1c, 0x28, 0x95, 0x7d, 0xfa,
+	0xaa, 0x59, 0x26, 0x89, 0x05, 0x1a, 0x36, 0x74,
+	0x06, 0x11, 0x94, 0x98, 0xda, 0xea, 0xa4, 0x2d,
+	0xb1, 0xc0, 0x3d, 0xcd, 0x30, 0xcc, 0x2e, 0x69,
+	0x1a, 0x0f, 0x8f, 0x9c, 0xc4, 0xc0, 0xfa, 0x94,
+	0xc1, 0xce, 0x21, 0xc3, 0x20, 0x69, 0x34, 0x29,
+	0x4b, 0x1f, 0xe3, 0x46, 0x3a, 0xe0, 0x59, 0xcb,
+	0xd5, 0x4c, 0x11, 0x90, 0x41, 0x2b, 0xe4, 0x1f,
+	0x9f, 0xe1, 0xff, 0x30, 0x14, 0x68, 0x3a, 0xe8,
+	0x92, 0xec, 0x0f, 0xfc, 0x85, 0x25, 0x9f, 0x89,
+	0xaa, 0xd5, 0xea, 0xbc, 0x7c, 0x5e, 0xf3, 0x0a,
+	0x05, 0x5a, 0x8b, 0xb8, 0x82, 0x69, 0x0e, 0x66,
+	0x62, 0xe3, 0xee, 0x10, 0x53, 0xb1, 0x36, 0xc2,
+	0xc1, 0x0d, 0x4d, 0x5b, 0x2c, 0xb1, 0x98, 0x06,
+	0xcb, 0xbe, 0x96, 0x9c, 0x73, 0x34, 0xa3, 0x8a,
+	0x19, 0x50, 0xba, 0x43, 0x57, 0xda, 0x0a, 0xf3,
+	0xa6, 0x7a, 0xee, 0xa8, 0x9b, 0x35, 0xf4, 0x72,
+	0xcb, 0x8c, 0x04, 0xfe, 0x01,
+};
+/* runs(3000, 2), zlib level 6 Z_FIXED */
+static const uint8_t fixed_stream[] = {
+	0xf3, 0xf4, 0x24, 0x02, 0xb8, 0x61, 0x00, 0x6f,
+	0x28, 0xf0, 0xf1, 0xf1, 0xf1, 0x07, 0x03, 0x77,
+	0x34, 0xe0, 0x81, 0x0e, 0xd0, 0x15, 0x20, 0x80,
+	0x2f, 0x7e, 0x10, 0x80, 0x05, 0x40, 0x34, 0x62,
+	0x93, 0xf1, 0x21, 0x06, 0xb8, 0x00, 0x01, 0xc8,
+	0xf5, 0xce, 0xc8, 0xc0, 0x15, 0x09, 0xe0, 0xd0,
+	0xe7, 0x88, 0x0a, 0x08, 0x05, 0x9b, 0x23, 0x3e,
+	0x80, 0xaa, 0x14, 0x6a, 0x2f, 0xdc, 0x1b, 0x7e,
+	0x28, 0xc0, 0x95, 0x40, 0x10, 0x81, 0x00, 0xc4,
+	0x1c, 0x17, 0xe2, 0x81, 0x3f, 0x0a, 0x80, 0x45,
+	0x93, 0x1f, 0x71, 0xc0, 0x9f, 0x18, 0xe0, 0x8d,
+	0x04, 0x5c, 0xb1, 0x01, 0x6f, 0x12, 0x81, 0x17,
+	0x6e, 0x40, 0x4a, 0x34, 0x60, 0x75, 0x0b, 0x6a,
+	0xf8, 0x63, 0x00, 0xbc, 0x41, 0xe9, 0xe9, 0x84,
+	0x07, 0x20, 0x52, 0x18, 0x11, 0x0e, 0xc7, 0x15,
+	0x94, 0x48, 0xf9, 0x90, 0x40, 0xa0, 0x63, 0x64,
+	0x3c, 0x10, 0xf0, 0x81, 0xe7, 0x53, 0x72, 0x74,
+	0x03, 0x01, 0xa9, 0x31, 0xe5, 0x8d, 0x3b, 0x24,
+	0x11, 0x80, 0x50, 0xfe, 0xf1, 0xf7, 0xc7, 0x9a,
+	0x73, 0x70, 0x05, 0x34, 0x16, 0x1b, 0x70, 0xc7,
+	0x34, 0x12, 0x20, 0xe4, 0x0c, 0x4f, 0x4f, 0x5c,
+	0x25, 0x97, 0x33, 0x31, 0x00, 0x6f, 0x29, 0x84,
+	0x1d, 0x60, 0x38, 0x91, 0x50, 0xb4, 0xc1, 0xec,
+	0xc2, 0x1e, 0x79, 0x84, 0x0b, 0x44, 0x7c, 0x39,
+	0x0b, 0x0a, 0xe0, 0x59, 0x1f, 0x14, 0xd4, 0x6e,
+	0xb8, 0xd2, 0x09, 0x2a, 0x40, 0xaf, 0x35, 0x40,
+	0x7e, 0xc3, 0x56, 0xbe, 0x61, 0x01, 0x58, 0x62,
+	0x81, 0x88, 0x54, 0x47, 0x4c, 0xd1, 0x85, 0x1a,
+	0x3b, 0xb8, 0xab, 0x25, 0x64, 0x80, 0x1e, 0xde,
+	0x98, 0x89, 0x0f, 0x6f, 0x59, 0x0f, 0x05, 0x60,
+	0xa3, 0x30, 0xeb, 0x52, 0xec, 0x00, 0x7f, 0xfd,
+	0x85, 0xd3, 0x0e, 0x2c, 0x31, 0x87, 0x2d, 0xa1,
+	0x60, 0x03, 0x28, 0x51, 0x47, 0x38, 0x41, 0x80,
+	0x00, 0x8e, 0x68, 0xc0, 0x1d, 0x04, 0x68, 0xfa,
+	0x09, 0x64, 0x1d, 0xb2, 0x02, 0x07, 0x06, 0xf0,
+	0x95, 0xc9, 0x84, 0xcb, 0x6a, 0x22, 0x82, 0x08,
+	0x08, 0x70, 0x16, 0x6d, 0x58, 0xf4, 0xba, 0x12,
+	0x17, 0xa4, 0x5e, 0xb8, 0xcb, 0x4b, 0x74, 0x13,
+	0x51, 0xca, 0x0c, 0xc2, 0x9e, 0x23, 0x2a, 0xd9,
+	0x11, 0x2a, 0x69, 0x60, 0xea, 0x70, 0xb9, 0x91,
+	0x70, 0x15, 0x83, 0xbd, 0x01, 0x84, 0xad, 0x91,
+	0x89, 0x04, 0x80, 0x0d, 0x1c, 0x50, 0x9c, 0xe2,
+	0x6e, 0x86, 0x10, 0x17, 0x9f, 0x44, 0xd5, 0x07,
+	0x48, 0x35, 0x03, 0xbe, 0xb4, 0x40, 0xa8, 0xcc,
+	0x20, 0xd8, 0x00, 0x23, 0x94, 0xd8, 0x70, 0xd7,
+	0x1c, 0x40, 0x00, 0x00,
+};
+/* noise(300, 3), zlib level 0 */
+static const uint8_t stored_stream[] = {
+	0x01, 0x2c, 0x01, 0xd3, 0xfe, 0x53, 0xc3, 0x7d,
+	0x78, 0x8e, 0xb4, 0x4d, 0xb7, 0x48, 0x2f, 0x6d,
+	0x46, 0x3d, 0x19, 0xe5, 0x70, 0x24, 0x4c, 0xbb,
+	0xa0, 0xe3, 0x58, 0xfc, 0x78, 0x74, 0xfa, 0x8c,
+	0xb1, 0x95, 0x5c, 0xaf, 0xb5, 0x32, 0x12, 0x53,
+	0xfe, 0x93, 0xd1, 0x23, 0x2c, 0x45, 0xed, 0x4c,
+	0xe9, 0xc9, 0x99, 0x0d, 0x7d, 0xff, 0xdc, 0x01,
+	0x30, 0x51, 0x55, 0x2c, 0x63, 0xa0, 0xb0, 0xc7,
+	0x6d, 0xee, 0xe4, 0xcc, 0x36, 0xd0, 0x32, 0x40,
+	0x96, 0x91, 0xdd, 0x43, 0x6b, 0x26, 0xaa, 0xd8,
+	0x7c, 0xd6, 0x16, 0x75, 0x11, 0xa6, 0x5a, 0x4a,
+	0x4e, 0x86, 0x1f, 0x51, 0x53, 0x3c, 0x01, 0x1a,
+	0x16, 0x14, 0xc6, 0x54, 0xfb, 0x44, 0x5b, 0x1a,
+	0x38, 0x21, 0x92, 0x03, 0xeb, 0x04, 0x9d, 0xe8,
+	0xf8, 0xfa, 0x4a, 0x73, 0xa4, 0x2f, 0xfc, 0x6d,
+	0xf3, 0x18, 0x6d, 0xc4, 0xc1, 0x62, 0x25, 0x5d,
+	0xa3, 0x9d, 0xb9, 0x9f, 0x7b, 0xa8, 0xc4, 0xbb,
+	0xdd, 0xdb, 0xa7, 0xbd, 0x25, 0xf7, 0x00, 0x54,
+	0x54, 0xce, 0xeb, 0x61, 0xaf, 0xb2, 0xfb, 0x42,
+	0x16, 0x9f, 0xf7, 0xdb, 0x25, 0x28, 0x54, 0x68,
+	0x0c, 0x22, 0x76, 0x06, 0x2f, 0x12, 0xa7, 0xfa,
+	0x7c, 0x57, 0xd3, 0xc8, 0x90, 0x17, 0x09, 0xf5,
+	0x89, 0xea, 0xb2, 0x96, 0xa9, 0x49, 0x8f, 0xa1,
+	0xb0, 0xb5, 0x74, 0xf0, 0xf6, 0xa7, 0xc6, 0x14,
+	0x4a, 0x3a, 0xb6, 0xdf, 0x8d, 0x9a, 0x3a, 0xb0,
+	0x0e, 0x2c, 0xd0, 0x7c, 0xa5, 0x7b, 0xf2, 0xa1,
+	0x8e, 0xe5, 0x58, 0x6b, 0x0b, 0x0a, 0xf0, 0x62,
+	0xb8, 0xf0, 0x9e, 0x59, 0xac, 0xf6, 0xb3, 0x38,
+	0x54, 0x7f, 0x2f, 0x84, 0x10, 0x5a, 0xb7, 0xb3,
+	0x8a, 0xf3, 0x54, 0x32, 0xdb, 0x3b, 0xf1, 0x32,
+	0x5c, 0x59, 0x93, 0x36, 0x4c, 0x0d, 0x56, 0x5e,
+	0x26, 0xe8, 0x2b, 0x71, 0xc0, 0x2e, 0x53, 0xab,
+	0x23, 0x86, 0x9a, 0x4c, 0x2e, 0x68, 0x54, 0xdd,
+	0xe9, 0x43, 0x19, 0x40, 0xaa, 0x71, 0x40, 0x7f,
+	0xea, 0xdb, 0x1c, 0x51, 0xe4, 0x6c, 0xf9, 0x6b,
+	0xf3, 0x37, 0xd4, 0x8d, 0xa9, 0x67, 0xde, 0x48,
+	0xae, 0xea, 0xaf, 0x8f, 0x5f, 0xdd, 0x4a, 0x05,
+	0x22, 0xb6, 0xd5, 0x00, 0x8b, 0x33, 0x15, 0x60,
+	0x30,
+};
+/* text(2000, 4), zlib level 9 with text(1024, 5) as zdict */
+static const uint8_t dict_stream[] = {
+	0x75, 0x56, 0x51, 0x16, 0xc3, 0x20, 0x0c, 0xfa,
+	0xef, 0xfd, 0x0f, 0xbc, 0x67, 0x02, 0x11, 0x88,
+	0xfb, 0x5b, 0x57, 0x8d, 0x0d, 0x10, 0x50, 0x06,
+	0x14, 0x2b, 0x5a, 0xbd, 0x6c, 0xe5, 0xf4, 0xc8,
+	0xdf, 0xbd, 0xe0, 0xd2, 0x16, 0xbd, 0x9c, 0x17,
+	0x05, 0x09, 0xaa, 0xdb, 0x14, 0xf4, 0x0e, 0x42,
+	0x61, 0x4b, 0xf2, 0x4f, 0xf7, 0x04, 0xa5, 0x6e,
+	0xeb, 0x71, 0xf6, 0xd8, 0x2b, 0x13, 0xa8, 0x7b,
+	0x8b, 0xa2, 0xe6, 0xe2, 0x8a, 0xd1, 0x64, 0xd3,
+	0xdc, 0x5f, 0x40, 0x90, 0x18, 0x1c, 0x50, 0xaa,
+	0xe7, 0x02, 0x94, 0x46, 0xa3, 0x5d, 0x44, 0x89,
+	0xb1, 0xf1, 0xae, 0x87, 0xf4, 0x2f, 0x54, 0x5d,
+	0x78, 0x94, 0xd4, 0x0f, 0x26, 0xae, 0xab, 0x11,
+	0x77, 0x68, 0xa8, 0x56, 0xe1, 0x6b, 0xdc, 0x41,
+	0xaf, 0x24, 0xe1, 0x7d, 0xb2, 0x32, 0xcd, 0xb5,
+	0x5a, 0xc3, 0x70, 0x7f, 0x66, 0x57, 0x66, 0x11,
+	0x63, 0x20, 0x01, 0xd7, 0x30, 0xac, 0xa8, 0xac,
+	0x68, 0xe1, 0xae, 0x9c, 0xb1, 0xc6, 0x4d, 0x15,
+	0x90, 0xd0, 0x8f, 0xc9, 0x84, 0x5f, 0x1a, 0x08,
+	0x26, 0x24, 0x87, 0x82, 0x0c, 0xbe, 0x75, 0x09,
+	0xf7, 0x39, 0x07, 0x37, 0x46, 0xaa, 0xd3, 0x7e,
+	0xc9, 0x03, 0xc5, 0xb3, 0x6c, 0xfc, 0x9d, 0x6e,
+	0xd4, 0x55, 0xeb, 0x5b, 0x86, 0x2c, 0xf9, 0xf2,
+	0x47, 0x19, 0xaf, 0x93, 0x6d, 0x5a, 0xeb, 0x21,
+	0x98, 0x61, 0xa7, 0x13, 0xb9, 0x7a, 0xc0, 0x62,
+	0x84, 0x5f, 0x25, 0xf4, 0xcb, 0xcf, 0xe4, 0xe9,
+	0x06, 0x52, 0x4c, 0xc1, 0x35, 0x09, 0xd9, 0x3d,
+	0x39, 0xed, 0x79, 0x7d, 0x03, 0xcd, 0x60, 0x46,
+	0x9a, 0xf0, 0xf3, 0x2d, 0xae, 0x34, 0x31, 0x3f,
+	0x9b, 0xa9, 0x97, 0x5d, 0xac, 0x26, 0x1d, 0x47,
+	0x71, 0xc3, 0x3a, 0x38, 0xa2, 0x37, 0x8a, 0xa9,
+	0xb7, 0xa4, 0xe8, 0xc3, 0x3a, 0x26, 0x24, 0x96,
+	0x27, 0xa3, 0xc8, 0xbe, 0x6a, 0x09, 0x7f, 0x26,
+	0x5e, 0x63, 0x19, 0xc8, 0xc4, 0xe0, 0x1a, 0x0d,
+	0xbe, 0x94, 0x73, 0x2c, 0xe4, 0x3c, 0x0d, 0x28,
+	0x65, 0xbf, 0x22, 0xec, 0xbb, 0x5c, 0x4d, 0xfe,
+	0xae, 0x6a, 0x61, 0xa4, 0x42, 0x2f, 0x00, 0xdd,
+	0xc3, 0xf4, 0xef, 0x8a, 0x19, 0x54, 0x24, 0x63,
+	0xeb, 0xf6, 0xb2, 0x0a, 0x68, 0x82, 0xa6, 0xfc,
+	0xd6, 0x7d, 0xd2, 0x73, 0x47, 0x13, 0x59, 0xa7,
+	0x42, 0x13, 0xc6, 0xa4, 0x47, 0x94, 0xb3, 0x6c,
+	0xe3, 0x79, 0xaf, 0xc0, 0x12, 0xb9, 0xbc, 0xdd,
+	0x99, 0x6b, 0x8d, 0xef, 0x4f, 0xf7, 0x1a, 0xa4,
+	0x7a, 0x54, 0xf7, 0x65, 0x5c, 0xff, 0x00,
+};
+
+/* The data of the streams above, zlib produced them from the same */
+static const char *words[16] = {
+	"snap ", "inflate ", "deflate ", "huffman ", "window ", "the ",
+	"card ", "host ", "stream ", "block ", "literal ", "match ",
+	"distance ", "code ", "length ", "\n" };
+
+static unsigned int lcg(uint32_t *x)
+{
+	*x = *x * 1103515245U + 12345U;
+	return *x >> 16;
+}
+
+static void text(uint8_t *p, unsigned int n, uint32_t x)
+{
+	unsigned int i = 0, k;
+
+	while (i < n) {
+		const char *w = words[lcg(&x) & 15];
+
+		for (k = 0; w[k] && i < n; k++)
+			p[i++] = w[k];
+	}
+}
+
+static void runs(uint8_t *p, unsigned int n, uint32_t x)
+{
+	unsigned int i = 0, v, k;
+
+	while (i < n) {
+		v = lcg(&x);
+		for (k = 0; k < 1 + v % 40 && i < n; k++)
+			p[i++] = 0x41 + (v >> 12);
+	}
+}
+
+static void noise(uint8_t *p, unsigned int n, uint32_t x)
+{
+	unsigned int i;
+
+	for (i = 0; i < n; i++)
+		p[i] = lcg(&x);
+}
+
+static action_reg act_reg;
+static action_RO_config_reg Action_Config;
+static snap_perf_t Action_Perf;
+
+#define MEM_SIZE	(1024 * 1024)
+#define IN		0
+#define STATE		(64 * 1024)
+#define OUT		(128 * 1024)
+#define RES		(256 * 1024)
+#define DICT		(384 * 1024)
+#define DATA		(512 * 1024)
+
+/* Run a job on host memory mem, addresses are offsets into it */
+static int run(snap_membus_t *mem, uint64_t in, uint64_t in_size,
+	       uint32_t in_bit, uint64_t out, uint64_t out_size,
+	       uint64_t dict, uint64_t dict_size)
+{
+	act_reg.Control.flags = 0x1; /* just not 0x0 */
+	act_reg.Data.in.addr = in;
+	act_reg.Data.in.size = in_size;
+	act_reg.Data.in.type = SNAP_ADDRTYPE_HOST_DRAM;
+	act_reg.Data.out.addr = out;
+	act_reg.Data.out.size = out_size;
+	act_reg.Data.out.type = SNAP_ADDRTYPE_HOST_DRAM;
+	act_reg.Data.dict.addr = dict;
+	act_reg.Data.dict.size = dict_size;
+	act_reg.Data.dict.type = SNAP_ADDRTYPE_HOST_DRAM;
+	act_reg.Data.state.addr = STATE;
+	act_reg.Data.state.size = sizeof(inflate_state_t);
+	act_reg.Data.state.type = SNAP_ADDRTYPE_HOST_DRAM;
+	act_reg.Data.in_bit = in_bit;
+
+	hls_action(mem, mem, NULL, &act_reg, &Action_Config, &Action_Perf);
+	return act_reg.Control.Retc == SNAP_RETC_SUCCESS ? 0 : 1;
+}
+
+/*
+ * Decode the stream at IN in jobs of ichunk bytes in and ochunk bytes
+ * out to RES, returns the bytes decoded or -1. Input is added while a
+ * job does not get a step done.
+ */
+static long chunked(snap_membus_t *mem, uint64_t size, uint64_t ichunk,
+		    uint64_t ochunk, unsigned int *jobs)
+{
+	uint8_t *m = (uint8_t *)mem;
+	uint64_t ip = 0, total = 0, n = ichunk, dsize, nb;
+	uint32_t in_bit = 0;
+
+	memset(m + STATE, 0, sizeof(inflate_state_t));
+	for (*jobs = 0; ; (*jobs)++) {
+		if (n > size - ip)
+			n = size - ip;
+		dsize = total < INFLATE_DICT_SIZE ? total : INFLATE_DICT_SIZE;
+		if (run(mem, IN + ip, n, in_bit, OUT, ochunk,
+			RES + total - dsize, dsize))
+			return -1;
+		memcpy(m + RES + total, m + OUT, act_reg.Data.out_size);
+		total += act_reg.Data.out_size;
+		nb = in_bit + act_reg.Data.in_used;
+		ip += nb / 8;
+		in_bit = nb % 8;
+
+		if (act_reg.Data.status == INFLATE_STATUS_DONE)
+			return total;
+		if (act_reg.Data.status == INFLATE_STATUS_NEED_INPUT) {
+			if (ip + n >= size + nb / 8)
+				return -1;	/* all input was there */
+			if (act_reg.Data.in_used == 0)
+				n += ichunk;
+			else	n = ichunk;
+		}
+	}
+}
+
+int main(void)
+{
+	static const struct {
+		const char *name;
+		const uint8_t *stream;
+		unsigned int size;
+		void (*data)(uint8_t *p, unsigned int n, uint32_t x);
+		unsigned int data_size;
+		uint32_t seed;
+	} vecs[] = {
+		{ "DYNAMIC", dyn_stream, sizeof(dyn_stream), text, 4000, 1 },
+		{ "FIXED", fixed_stream, sizeof(fixed_stream), runs, 3000, 2 },
+		{ "STORED", stored_stream, sizeof(stored_stream), noise,
+		  300, 3 },
+	};
+	snap_membus_t *mem = (snap_membus_t *)calloc(1, MEM_SIZE);
+	uint8_t *m = (uint8_t *)mem;
+	unsigned int i, jobs;
+	long total;
+
+	if (mem == NULL)
+		return 1;
+
+	/* Query ACTION_TYPE ... */
+	act_reg.Control.flags = 0x0;
+	hls_action(mem, mem, NULL, &act_reg, &Action_Config, &Action_Perf);
+	fprintf(stderr,
+		"ACTION_TYPE:   %08x\n"
+		"RELEASE_LEVEL: %08x\n"
+		"RETC:          %04x\n",
+		(unsigned int)Action_Config.action_type,
+		(unsigned int)Action_Config.release_level,
+		(unsigned int)act_reg.Control.Retc);
+
+	for (i = 0; i < sizeof(vecs) / sizeof(vecs[0]); i++) {
+		vecs[i].data(m + DATA, vecs[i].data_size, vecs[i].seed);
+		memcpy(m + IN, vecs[i].stream, vecs[i].size);
+
+		/* in one job */
+		memset(m + STATE, 0, sizeof(inflate_state_t));
+		if (run(mem, IN, vecs[i].size, 0, OUT, 64 * 1024, 0, 0) ||
+		    act_reg.Data.status != INFLATE_STATUS_DONE ||
+		    act_reg.Data.out_size != vecs[i].data_size ||
+		    (act_reg.Data.in_used + 7) / 8 != vecs[i].size ||
+		    memcmp(m + OUT, m + DATA, vecs[i].data_size) != 0) {
+			fprintf(stderr, " ==> %s FAILURE <==\n",
+				vecs[i].name);
+			return 1;
+		}
+
+		/* a few bytes in and out per job */
+		total = chunked(mem, vecs[i].size, 7, 64, &jobs);
+		if (total != vecs[i].data_size ||
+		    memcmp(m + RES, m + DATA, vecs[i].data_size) != 0) {
+			fprintf(stderr, " ==> %s CHUNKED FAILURE <==\n",
+				vecs[i].name);
+			return 1;
+		}
+		printf(" ==> %s %u -> %u OK, CHUNKED IN %u JOBS OK <==\n",
+		       vecs[i].name, vecs[i].size, vecs[i].data_size, jobs);
+	}
+
+	/* Matches into the dict, with and without it */
+	text(m + DICT + 5, 1024, 5);
+	text(m + DATA, 2000, 4);
+	memcpy(m + IN + 3, dict_stream, sizeof(dict_stream));
+	memset(m + STATE, 0, sizeof(inflate_state_t));
+	if (run(mem, IN + 3, sizeof(dict_stream), 0, OUT, 64 * 1024,
+		DICT + 5, 1024) ||
+	    act_reg.Data.status != INFLATE_STATUS_DONE ||
+	    act_reg.Data.out_size != 2000 ||
+	    memcmp(m + OUT, m + DATA, 2000) != 0) {
+		fprintf(stderr, " ==> DICT FAILURE <==\n");
+		return 1;
+	}
+	memset(m + STATE, 0, sizeof(inflate_state_t));
+	if (run(mem, IN + 3, sizeof(dict_stream), 0, OUT, 64 * 1024,
+		0, 0) == 0) {
+		fprintf(stderr, " ==> MISSING DICT NOT DETECTED <==\n");
+		return 1;
+	}
+	printf(" ==> DICT OK <==\n");
+
+	/* A cut stream needs input, garbage fails */
+	memcpy(m + IN, dyn_stream, sizeof(dyn_stream));
+	memset(m + STATE, 0, sizeof(inflate_state_t));
+	if (run(mem, IN, sizeof(dyn_stream) - 10, 0, OUT, 64 * 1024, 0, 0) ||
+	    act_reg.Data.status != INFLATE_STATUS_NEED_INPUT) {
+		fprintf(stderr, " ==> CUT STREAM FAILURE <==\n");
+		return 1;
+	}
+	memset(m + IN, 0xff, 64);
+	memset(m + STATE, 0, sizeof(inflate_state_t));
+	if (run(mem, IN, 64, 0, OUT, 64 * 1024, 0, 0) == 0) {
+		fprintf(stderr, " ==> ERROR NOT DETECTED <==\n");
+		return 1;
+	}
+	free(mem);
+
+	printf(">> ACTION TYPE = %08lx - RELEASE_LEVEL = %08lx <<\n",
+	       (unsigned long)Action_Config.action_type,
+	       (unsigned long)Action_Config.release_level);
+	return 0;
+}
+
+#endif
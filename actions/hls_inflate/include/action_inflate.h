@@ -0,0 +1,95 @@
+#ifndef __ACTION_INFLATE_H__
+#define __ACTION_INFLATE_H__
+
+/*
+ * Copyright 2017 International Business Machines
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <snap_types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define INFLATE_ACTION_TYPE 0x10141008
+
+/* inflate_job.status */
+#define INFLATE_STATUS_DONE	 0x0	/* last block of the stream ended */
+#define INFLATE_STATUS_NEED_INPUT 0x1	/* next code needs bits beyond in */
+#define INFLATE_STATUS_OUT_FULL	 0x2	/* next code does not fit into out */
+
+/* inflate_state.block */
+#define INFLATE_BLOCK_HEADER	0x0	/* next is a block header */
+#define INFLATE_BLOCK_STORED	0x1
+#define INFLATE_BLOCK_FIXED	0x2
+#define INFLATE_BLOCK_DYNAMIC	0x3
+#define INFLATE_BLOCK_DONE	0x4
+
+#define INFLATE_DICT_SIZE	(32 * 1024)	/* matches reach back 32 KiB */
+#define INFLATE_NLEN		288	/* literal/length codes */
+#define INFLATE_NDIST		32	/* distance codes */
+
+/*
+ * Where decoding stands between two jobs. Zeroed by the host for a
+ * new stream. The code lengths of the current block are kept, so the
+ * next job rebuilds its Huffman tables from them. 384 bytes, it must
+ * be 64 byte aligned.
+ */
+typedef struct inflate_state {
+	uint32_t block;		/* INFLATE_BLOCK_* */
+	uint32_t last;		/* block is the last one of the stream */
+	uint32_t stored_left;	/* bytes of the stored block to come */
+	uint32_t reserved;
+	uint8_t lens[INFLATE_NLEN + INFLATE_NDIST]; /* code lengths */
+	uint8_t padding[48];
+} inflate_state_t;
+
+/*
+ * Decompression of a raw deflate stream (RFC 1951). The zlib and gzip
+ * headers and trailers are left to the host, see sw/snap_inflate.c.
+ *
+ * A stream is decoded by a series of jobs, each taking what the host
+ * has of the input and room for output, in chunks of any size. A job
+ * decodes until the stream ends or until the next literal, match or
+ * block header needs bits beyond in or does not fit into out. Codes
+ * are never split, status tells why the job stopped, in_used the bits
+ * taken. The next job continues at in_bit + in_used bits after in:
+ * in.addr + (in_bit + in_used) / 8, in_bit = (in_bit + in_used) % 8.
+ *
+ * state is read at the start of a job and written back at its end.
+ * dict is the output preceding the job, its last INFLATE_DICT_SIZE
+ * bytes are the history matches may reach back to.
+ *
+ * in and dict can have any alignment. out and state must be 64 byte
+ * aligned and out must have room for out.size rounded up to 64
+ * bytes, the last bus word is written in full. Invalid data fails
+ * the job.
+ */
+typedef struct inflate_job {
+	struct snap_addr in;	/* in:  deflate stream */
+	struct snap_addr out;	/* in:  decompressed data */
+	struct snap_addr dict;	/* in:  output preceding out, up to 32 KiB */
+	struct snap_addr state;	/* in:  inflate_state_t, read and written */
+	uint32_t in_bit;	/* in:  bits of the first byte already used */
+	uint32_t status;	/* out: INFLATE_STATUS_* */
+	uint64_t in_used;	/* out: bits taken after in_bit */
+	uint64_t out_size;	/* out: bytes written to out */
+} inflate_job_t;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif	/* __ACTION_INFLATE_H__ */
@@ -0,0 +1,526 @@
+/*
+ * Copyright 2017 International Business Machines
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Software version of the inflate action, see include/action_inflate.h.
+ *
+ * Huffman codes are decoded a bit at a time, but a job stops at the
+ * same points as hw/hls_inflate.cpp does: before the literal, match
+ * or block header which needs bits beyond the input or does not fit
+ * into the output. Status, in_used, out_size and the state are the
+ * same for the same job. Host and card DRAM are supported, card DRAM
+ * is the emulated one of libsnap.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <libsnap.h>
+
+#include <snap_internal.h>
+#include <snap_tools.h>
+#include <action_inflate.h>
+
+#define INFLATE_MAXBITS		15
+#define INFLATE_NCLEN		19
+
+/* Result of a block part, next to INFLATE_STATUS_* */
+#define INFLATE_BLOCK_END	0x10	/* header read or block finished */
+#define INFLATE_BAD		0x11	/* invalid data */
+
+static const uint16_t len_base[29] = {
+	3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+	35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+static const uint8_t len_extra[29] = {
+	0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+	3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+static const uint16_t dist_base[30] = {
+	1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+	257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+	8193, 12289, 16385, 24577 };
+static const uint8_t dist_extra[30] = {
+	0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+	7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+static const uint8_t clen_order[INFLATE_NCLEN] = {
+	16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+struct inflate_code {
+	uint16_t count[INFLATE_MAXBITS + 1];
+	uint16_t sorted[INFLATE_NLEN];
+};
+
+struct inflate {
+	const uint8_t *in;
+	uint64_t in_bits;	/* bits in in, from bit 0 */
+	uint64_t used;		/* bits taken, from bit 0 */
+	uint64_t mark;		/* used after the last complete step */
+	uint8_t *hist;		/* dict followed by the output */
+	uint64_t pos;		/* bytes in hist */
+	uint64_t end;		/* room of hist */
+	struct inflate_state *st;
+	struct inflate_code lcode, dcode;
+};
+
+static struct snap_card *inflate_card;	/* for the emulated card DRAM */
+
+static int mmio_write32(struct snap_card *card,
+			uint64_t offs, uint32_t data)
+{
+	act_trace("  %s(%p, %llx, %x)\n", __func__, card,
+		  (long long)offs, data);
+	inflate_card = card;
+	return 0;
+}
+
+static int mmio_read32(struct snap_card *card,
+		       uint64_t offs, uint32_t *data)
+{
+	act_trace("  %s(%p, %llx, %x)\n", __func__, card,
+		  (long long)offs, *data);
+	inflate_card = card;
+	return 0;
+}
+
+/* Memory behind a job address, NULL if it cannot be reached */
+static uint8_t *inflate_mem(const struct snap_addr *a)
+{
+	switch (a->type) {
+	case SNAP_ADDRTYPE_HOST_DRAM:
+		return (uint8_t *)(unsigned long)a->addr;
+	case SNAP_ADDRTYPE_CARD_DRAM:
+		if (inflate_card == NULL)
+			return NULL;
+		return snap_card_ddr_emu(inflate_card, a->addr, a->size);
+	default:
+		return NULL;
+	}
+}
+
+static inline uint64_t inflate_avail(const struct inflate *s)
+{
+	return s->in_bits - s->used;
+}
+
+/* n bits at offs bits after the ones taken, the caller checks avail */
+static uint32_t inflate_bits(const struct inflate *s, uint64_t offs,
+			     unsigned int n)
+{
+	uint64_t b = s->used + offs;
+	uint32_t v = 0;
+	unsigned int i;
+
+	for (i = 0; i < n; i++, b++)
+		v |= ((s->in[b / 8] >> (b % 8)) & 1) << i;
+	return v;
+}
+
+/*
+ * Decode the code at offs bits after the ones taken to *sym. Returns
+ * its length, 0 if the input ends before, -1 if there is no such code.
+ */
+static int inflate_decode(const struct inflate *s,
+			  const struct inflate_code *c, uint64_t offs,
+			  unsigned int *sym)
+{
+	int code = 0, first = 0, index = 0, len;
+
+	for (len = 1; len <= INFLATE_MAXBITS; len++) {
+		if (offs + len > inflate_avail(s))
+			return 0;
+		code |= inflate_bits(s, offs + len - 1, 1);
+		if (code - first < c->count[len]) {
+			*sym = c->sorted[index + code - first];
+			return len;
+		}
+		index += c->count[len];
+		first += c->count[len];
+		first <<= 1;
+		code <<= 1;
+	}
+	return -1;
+}
+
+/* Returns -1 if there are more codes than the lengths allow */
+static int inflate_build(const uint8_t *lens, unsigned int n,
+			 struct inflate_code *c)
+{
+	uint16_t offs[INFLATE_MAXBITS + 1];
+	unsigned int s, l;
+	int left = 1;
+
+	memset(c->count, 0, sizeof(c->count));
+	for (s = 0; s < n; s++)
+		c->count[lens[s]]++;
+	c->count[0] = 0;
+
+	offs[1] = 0;
+	for (l = 1; l <= INFLATE_MAXBITS; l++) {
+		left = 2 * left - c->count[l];
+		if (left < 0)
+			return -1;
+		if (l < INFLATE_MAXBITS)
+			offs[l + 1] = offs[l] + c->count[l];
+	}
+	for (s = 0; s < n; s++)
+		if (lens[s] != 0)
+			c->sorted[offs[lens[s]]++] = s;
+	return 0;
+}
+
+static void inflate_fixed(uint8_t *lens)
+{
+	unsigned int s;
+
+	for (s = 0; s < INFLATE_NLEN + INFLATE_NDIST; s++)
+		lens[s] = s < 144 ? 8 : s < 256 ? 9 : s < 280 ? 7 :
+			s < INFLATE_NLEN ? 8 : 5;
+}
+
+static int inflate_tables(struct inflate *s)
+{
+	return inflate_build(s->st->lens, INFLATE_NLEN, &s->lcode) |
+		inflate_build(s->st->lens + INFLATE_NLEN, INFLATE_NDIST,
+			      &s->dcode);
+}
+
+/* Status of a code inflate_decode() returned len for */
+static int inflate_missing(int len)
+{
+	return len == 0 ? INFLATE_STATUS_NEED_INPUT : INFLATE_BAD;
+}
+
+static unsigned int inflate_lidx(unsigned int j, unsigned int nlen)
+{
+	return j < nlen ? j : j - nlen + INFLATE_NLEN;
+}
+
+static int inflate_dynamic(struct inflate *s, uint64_t t)
+{
+	uint8_t clens[INFLATE_NCLEN], *lens = s->st->lens;
+	unsigned int nlen, ndist, nclen, j, rep, sym;
+	struct inflate_code ccode;
+	uint8_t val;
+	int l;
+
+	if (t + 14 > inflate_avail(s))
+		return INFLATE_STATUS_NEED_INPUT;
+	nlen = inflate_bits(s, t, 5) + 257;
+	ndist = inflate_bits(s, t + 5, 5) + 1;
+	nclen = inflate_bits(s, t + 10, 4) + 4;
+	t += 14;
+	if (nlen > 286 || ndist > 30)
+		return INFLATE_BAD;
+
+	memset(clens, 0, sizeof(clens));
+	for (j = 0; j < nclen; j++) {
+		if (t + 3 > inflate_avail(s))
+			return INFLATE_STATUS_NEED_INPUT;
+		clens[clen_order[j]] = inflate_bits(s, t, 3);
+		t += 3;
+	}
+	if (inflate_build(clens, INFLATE_NCLEN, &ccode))
+		return INFLATE_BAD;
+
+	memset(lens, 0, INFLATE_NLEN + INFLATE_NDIST);
+	for (j = 0; j < nlen + ndist; ) {
+		l = inflate_decode(s, &ccode, t, &sym);
+		if (l <= 0)
+			return inflate_missing(l);
+		if (sym < 16) {
+			val = sym;
+			rep = 1;
+		} else if (sym == 16) {
+			if (j == 0)
+				return INFLATE_BAD;
+			if (t + l + 2 > inflate_avail(s))
+				return INFLATE_STATUS_NEED_INPUT;
+			val = lens[inflate_lidx(j - 1, nlen)];
+			rep = 3 + inflate_bits(s, t + l, 2);
+			l += 2;
+		} else {
+			unsigned int n = sym == 17 ? 3 : 7;
+
+			if (t + l + n > inflate_avail(s))
+				return INFLATE_STATUS_NEED_INPUT;
+			val = 0;
+			rep = (sym == 17 ? 3 : 11) + inflate_bits(s, t + l, n);
+			l += n;
+		}
+		if (j + rep > nlen + ndist)
+			return INFLATE_BAD;
+		t += l;
+		for (; rep != 0; rep--, j++)
+			lens[inflate_lidx(j, nlen)] = val;
+	}
+	if (lens[256] == 0)
+		return INFLATE_BAD;
+	s->used += t;
+	return INFLATE_BLOCK_END;
+}
+
+static int inflate_header(struct inflate *s)
+{
+	struct inflate_state *st = s->st;
+	uint32_t last, type, len;
+	uint64_t t;
+	int rc;
+
+	if (inflate_avail(s) < 3)
+		return INFLATE_STATUS_NEED_INPUT;
+	last = inflate_bits(s, 0, 1);
+	type = inflate_bits(s, 1, 2);
+
+	switch (type) {
+	case 0:	/* stored, LEN and NLEN from the next byte on */
+		t = 3 + ((8 - ((s->used + 3) & 7)) & 7);
+		if (t + 32 > inflate_avail(s))
+			return INFLATE_STATUS_NEED_INPUT;
+		len = inflate_bits(s, t, 16);
+		if (len != (~inflate_bits(s, t + 16, 16) & 0xffff))
+			return INFLATE_BAD;
+		st->stored_left = len;
+		st->block = INFLATE_BLOCK_STORED;
+		st->last = last;
+		s->used += t + 32;
+		return INFLATE_BLOCK_END;
+	case 1:
+		s->used += 3;
+		inflate_fixed(st->lens);
+		st->block = INFLATE_BLOCK_FIXED;
+		break;
+	case 2:
+		rc = inflate_dynamic(s, 3);
+		if (rc != INFLATE_BLOCK_END)
+			return rc;
+		st->block = INFLATE_BLOCK_DYNAMIC;
+		break;
+	default:
+		return INFLATE_BAD;
+	}
+	if (inflate_tables(s))
+		return INFLATE_BAD;
+	st->last = last;
+	return INFLATE_BLOCK_END;
+}
+
+static int inflate_stored(struct inflate *s)
+{
+	struct inflate_state *st = s->st;
+
+	while (st->stored_left != 0) {
+		if (s->pos == s->end)
+			return INFLATE_STATUS_OUT_FULL;
+		if (inflate_avail(s) < 8)
+			return INFLATE_STATUS_NEED_INPUT;
+		s->hist[s->pos++] = s->in[s->used / 8];
+		s->used += 8;
+		st->stored_left--;
+		s->mark = s->used;
+	}
+	return INFLATE_BLOCK_END;
+}
+
+static int inflate_codes(struct inflate *s)
+{
+	unsigned int sym, len, dist, i;
+	uint64_t t;
+	int l;
+
+	while (1) {
+		l = inflate_decode(s, &s->lcode, 0, &sym);
+		if (l <= 0)
+			return inflate_missing(l);
+
+		if (sym < 256) {
+			if (s->pos == s->end)
+				return INFLATE_STATUS_OUT_FULL;
+			s->hist[s->pos++] = sym;
+			s->used += l;
+			s->mark = s->used;
+			continue;
+		}
+		if (sym == 256) {
+			s->used += l;
+			s->mark = s->used;
+			return INFLATE_BLOCK_END;
+		}
+		if (sym > 285)
+			return INFLATE_BAD;
+
+		sym -= 257;
+		t = l + len_extra[sym];
+		if (t > inflate_avail(s))
+			return INFLATE_STATUS_NEED_INPUT;
+		len = len_base[sym] + inflate_bits(s, l, len_extra[sym]);
+
+		l = inflate_decode(s, &s->dcode, t, &sym);
+		if (l <= 0)
+			return inflate_missing(l);
+		if (sym > 29)
+			return INFLATE_BAD;
+		t += l;
+		if (t + dist_extra[sym] > inflate_avail(s))
+			return INFLATE_STATUS_NEED_INPUT;
+		dist = dist_base[sym] + inflate_bits(s, t, dist_extra[sym]);
+		t += dist_extra[sym];
+		if (dist > s->pos)
+			return INFLATE_BAD;
+		if (len > s->end - s->pos)
+			return INFLATE_STATUS_OUT_FULL;
+
+		for (i = 0; i < len; i++, s->pos++)
+			s->hist[s->pos] = s->hist[s->pos - dist];
+		s->used += t;
+		s->mark = s->used;
+	}
+}
+
+static int inflate_job(struct inflate_job *js, const uint8_t *in,
+		       uint8_t *out, const uint8_t *dict, uint64_t dsize,
+		       struct inflate_state *state)
+{
+	struct inflate *s;
+	struct inflate_state st;
+	int r = INFLATE_BLOCK_END, rc = 0;
+
+	if (js->in_bit > 7 || (js->in_bit != 0 && js->in.size == 0))
+		return -1;
+	if (state->block > INFLATE_BLOCK_DONE)
+		return -1;
+
+	s = calloc(1, sizeof(*s));
+	if (s == NULL)
+		return -1;
+	s->hist = malloc(dsize + js->out.size + 1);
+	if (s->hist == NULL) {
+		free(s);
+		return -1;
+	}
+	memcpy(s->hist, dict, dsize);
+	memcpy(&st, state, sizeof(st));
+	s->st = &st;
+	s->in = in;
+	s->in_bits = 8 * (uint64_t)js->in.size;
+	s->used = s->mark = js->in_bit;
+	s->pos = dsize;
+	s->end = dsize + js->out.size;
+
+	if (st.block == INFLATE_BLOCK_FIXED ||
+	    st.block == INFLATE_BLOCK_DYNAMIC)
+		rc = inflate_tables(s);
+
+	while (rc == 0 && r == INFLATE_BLOCK_END &&
+	       st.block != INFLATE_BLOCK_DONE) {
+		switch (st.block) {
+		case INFLATE_BLOCK_HEADER:
+			r = inflate_header(s);
+			if (r == INFLATE_BLOCK_END)
+				s->mark = s->used;
+			continue;
+		case INFLATE_BLOCK_STORED:
+			r = inflate_stored(s);
+			break;
+		default:
+			r = inflate_codes(s);
+			break;
+		}
+		if (r == INFLATE_BLOCK_END)
+			st.block = st.last ? INFLATE_BLOCK_DONE :
+				INFLATE_BLOCK_HEADER;
+	}
+	memcpy(state, &st, sizeof(st));
+
+	if (r == INFLATE_BAD)
+		rc = -1;
+	else if (r != INFLATE_BLOCK_END)
+		js->status = r;
+	js->in_used = s->mark - js->in_bit;
+	js->out_size = s->pos - dsize;
+	memcpy(out, s->hist + dsize, s->pos - dsize);
+	free(s->hist);
+	free(s);
+	return rc;
+}
+
+static int action_main(struct snap_sim_action *action,
+		       void *job, unsigned int job_len)
+{
+	struct inflate_job *js = (struct inflate_job *)job;
+	uint8_t *in, *out, *dict = NULL;
+	struct inflate_state *state;
+	uint64_t dsize = MIN(js->dict.size, (uint64_t)INFLATE_DICT_SIZE);
+	int rc;
+
+	act_trace("%s(%p, %p, %d) in=%lld bit=%d out=%lld dict=%lld\n",
+		  __func__, action, job, job_len, (long long)js->in.size,
+		  js->in_bit, (long long)js->out.size,
+		  (long long)js->dict.size);
+
+	js->status = INFLATE_STATUS_DONE;
+	js->in_used = 0;
+	js->out_size = 0;
+	in = inflate_mem(&js->in);
+	out = inflate_mem(&js->out);
+	state = (struct inflate_state *)inflate_mem(&js->state);
+	if (dsize != 0) {
+		dict = inflate_mem(&js->dict);
+		if (dict != NULL)
+			dict += js->dict.size - dsize;
+	}
+	if (in == NULL || out == NULL || state == NULL ||
+	    (dsize != 0 && dict == NULL)) {
+		act_trace("  err: memory type not supported\n");
+		goto out_err;
+	}
+
+	rc = inflate_job(js, in, out, dict, dsize, state);
+	action->perf.rd_bytes = js->in.size + dsize + sizeof(*state);
+	action->perf.wr_bytes = js->out_size + sizeof(*state);
+	if (rc != 0)
+		goto out_err;
+
+	action->job.retc = SNAP_RETC_SUCCESS;
+	return 0;
+
+ out_err:
+	action->job.retc = SNAP_RETC_FAILURE;
+	return 0;
+}
+
+static struct snap_sim_action action = {
+	.vendor_id = SNAP_VENDOR_ID_ANY,
+	.device_id = SNAP_DEVICE_ID_ANY,
+	.action_type = INFLATE_ACTION_TYPE,
+
+	.job = { .retc = SNAP_RETC_FAILURE, },
+	.state = ACTION_IDLE,
+	.main = action_main,
+	.priv_data = NULL,	/* this is passed back as void *card */
+	.mmio_write32 = mmio_write32,
+	.mmio_read32 = mmio_read32,
+
+	.next = NULL,
+};
+
+static void _init(void) __attribute__((constructor));
+
+static void _init(void)
+{
+	snap_action_register(&action);
+}
@@ -0,0 +1,31 @@
+/*
+ * Copyright 2017 International Business Machines
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Software emulation running hls_inflate.cpp, see hls_snap_swemu.H.
+ * Build with "make BUILD_HLS_SWEMU=1".
+ */
+
+#include <hls_inflate.cpp>
+#include <hls_snap_swemu.H>
+
+static void swemu_call(action_reg *act_reg, action_RO_config_reg *cfg,
+		       snap_perf_t *perf)
+{
+	hls_action(swemu.host, swemu.host, swemu.ddr, act_reg, cfg, perf);
+}
+
+SNAP_SWEMU_ACTION(INFLATE_ACTION_TYPE, action_reg, swemu_call)
@@ -0,0 +1,520 @@
+/*
+ * Copyright 2017 International Business Machines
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * gzip, zlib and raw deflate decompression with the inflate action.
+ *
+ * The action decodes the deflate stream, this tool the gzip (RFC
+ * 1952) or zlib (RFC 1950) wrapper around it: header, CRC32 or
+ * Adler-32 and length in the trailer. gzip files of several members
+ * are decompressed member by member like gzip does. The format is
+ * detected from the first bytes, -r takes the input as raw deflate.
+ *
+ * Each job gets -B bytes of input and room for -B bytes of output and
+ * returns where it stopped. The next job continues there with the
+ * state the action left and the last 32 KiB of output as dict. The
+ * output is written to the file job by job.
+ */
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <malloc.h>
+#include <errno.h>
+#include <string.h>
+#include <sys/time.h>
+#include <assert.h>
+
+#include <snap_tools.h>
+#include <action_inflate.h>
+#include <libsnap.h>
+#include <snap_hls_if.h>
+
+#define GZIP_FHCRC		0x02
+#define GZIP_FEXTRA		0x04
+#define GZIP_FNAME		0x08
+#define GZIP_FCOMMENT		0x10
+#define ZLIB_FDICT		0x20
+
+#define CHUNK_SIZE		(4 * 1024 * 1024)
+#define CHUNK_MIN		(4 * 1024)
+
+enum inflate_format { FORMAT_RAW, FORMAT_ZLIB, FORMAT_GZIP };
+
+int verbose_flag = 0;
+
+static const char *version = GIT_VERSION;
+
+struct inflate_tool {
+	struct snap_action *action;
+	unsigned long timeout;
+	uint64_t chunk;			/* bytes in and out per job */
+	struct inflate_state *state;
+	uint8_t *obuf;			/* dict followed by the job output */
+	FILE *fp;
+	uint32_t crc;			/* of the output of a stream */
+	uint32_t adler;
+	uint64_t total;			/* output of all streams */
+	unsigned int jobs;
+	struct snap_action_perf perf;	/* summed up over the jobs */
+};
+
+/**
+ * @brief	prints valid command line options
+ *
+ * @param prog	current program's name
+ */
+static void usage(const char *prog)
+{
+	printf("Usage: %s [-h] [-v, --verbose] [-V, --version]\n"
+	       "  -C, --card <cardno>       can be (0...3)\n"
+	       "  -i, --input <file>        input file, gzip or zlib.\n"
+	       "  -o, --output <file>       output file.\n"
+	       "  -r, --raw                 input is raw deflate.\n"
+	       "  -B, --chunk <size>        bytes in and out per job, multiple\n"
+	       "                            of 4 KiB (4 MiB default).\n"
+	       "  -t, --timeout             Timeout in sec to wait for done. (10 sec default)\n"
+	       "\n"
+	       "Example:\n"
+	       "  snap_inflate -i file.gz -o file\n"
+	       "\n",
+	       prog);
+}
+
+static uint32_t crc32(uint32_t crc, const uint8_t *p, uint64_t n)
+{
+	static uint32_t table[256];
+	uint32_t c;
+	unsigned int i, k;
+
+	if (table[1] == 0) {
+		for (i = 0; i < 256; i++) {
+			for (c = i, k = 0; k < 8; k++)
+				c = c & 1 ? 0xedb88320 ^ (c >> 1) : c >> 1;
+			table[i] = c;
+		}
+	}
+	crc = ~crc;
+	while (n--)
+		crc = table[(crc ^ *p++) & 0xff] ^ (crc >> 8);
+	return ~crc;
+}
+
+static uint32_t adler32(uint32_t adler, const uint8_t *p, uint64_t n)
+{
+	uint32_t a = adler & 0xffff, b = adler >> 16;
+	uint64_t k;
+
+	while (n != 0) {
+		k = MIN(n, 5552ull);	/* no overflow before the modulo */
+		n -= k;
+		while (k--) {
+			a += *p++;
+			b += a;
+		}
+		a %= 65521;
+		b %= 65521;
+	}
+	return b << 16 | a;
+}
+
+static inline uint32_t get32le(const uint8_t *p)
+{
+	return (uint32_t)p[0] | (uint32_t)p[1] << 8 |
+		(uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static inline uint32_t get32be(const uint8_t *p)
+{
+	return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 |
+		(uint32_t)p[2] << 8 | (uint32_t)p[3];
+}
+
+/* Run one job, the dict is the dsize bytes before out */
+static int inflate_job(struct inflate_tool *t, const uint8_t *in,
+		       uint64_t in_size, uint32_t in_bit, uint8_t *out,
+		       uint64_t dsize, struct inflate_job *job)
+{
+	struct snap_job cjob;
+	struct snap_action_perf perf;
+	int rc;
+
+	assert(sizeof(*job) <= SNAP_JOBSIZE);
+	memset(job, 0, sizeof(*job));
+	snap_addr_set(&job->in, in, in_size, SNAP_ADDRTYPE_HOST_DRAM,
+		      SNAP_ADDRFLAG_ADDR | SNAP_ADDRFLAG_SRC);
+	snap_addr_set(&job->out, out, t->chunk, SNAP_ADDRTYPE_HOST_DRAM,
+		      SNAP_ADDRFLAG_ADDR | SNAP_ADDRFLAG_DST);
+	snap_addr_set(&job->dict, out - dsize, dsize,
+		      SNAP_ADDRTYPE_HOST_DRAM,
+		      SNAP_ADDRFLAG_ADDR | SNAP_ADDRFLAG_SRC);
+	snap_addr_set(&job->state, t->state, sizeof(*t->state),
+		      SNAP_ADDRTYPE_HOST_DRAM,
+		      SNAP_ADDRFLAG_ADDR | SNAP_ADDRFLAG_SRC |
+		      SNAP_ADDRFLAG_DST | SNAP_ADDRFLAG_END);
+	job->in_bit = in_bit;
+	snap_job_set(&cjob, job, sizeof(*job), NULL, 0);
+
+	rc = snap_action_sync_execute_job(t->action, &cjob, t->timeout);
+	if (rc != 0) {
+		fprintf(stderr, "err: job execution %d: %s!\n", rc,
+			strerror(errno));
+		return -1;
+	}
+	if (cjob.retc != SNAP_RETC_SUCCESS) {
+		fprintf(stderr, "err: Unexpected RETC=%x!\n", cjob.retc);
+		return -1;
+	}
+	if (snap_action_perf(t->action, &perf) == 0) {
+		t->perf.cycles += perf.cycles;
+		t->perf.rd_bytes += perf.rd_bytes;
+		t->perf.wr_bytes += perf.wr_bytes;
+		t->perf.rd_stall += perf.rd_stall;
+		t->perf.wr_stall += perf.wr_stall;
+	}
+	t->jobs++;
+	return 0;
+}
+
+/*
+ * Decompress the deflate stream at *off of in to the output file.
+ * *off returns the byte after the stream, *size the bytes written.
+ */
+static int inflate_stream(struct inflate_tool *t, const uint8_t *in,
+			  uint64_t in_size, uint64_t *off, uint64_t *size)
+{
+	uint8_t *out = t->obuf + INFLATE_DICT_SIZE;
+	uint64_t ip = *off, n, nb, dsize = 0, keep;
+	struct inflate_job job;
+	uint32_t in_bit = 0;
+	int all_in;
+
+	memset(t->state, 0, sizeof(*t->state));
+	t->crc = 0;
+	t->adler = 1;
+	*size = 0;
+
+	while (1) {
+		n = MIN(t->chunk, in_size - ip);
+		all_in = ip + n == in_size;
+		if (inflate_job(t, in + ip, n, in_bit, out, dsize, &job) != 0)
+			return -1;
+		if (job.out_size != 0 &&
+		    fwrite(out, job.out_size, 1, t->fp) != 1) {
+			fprintf(stderr, "err: cannot write output: %s\n",
+				strerror(errno));
+			return -1;
+		}
+		t->crc = crc32(t->crc, out, job.out_size);
+		t->adler = adler32(t->adler, out, job.out_size);
+		*size += job.out_size;
+
+		/* the last 32 KiB of output are the next dict */
+		keep = MIN(dsize + job.out_size, (uint64_t)INFLATE_DICT_SIZE);
+		memmove(out - keep, out + job.out_size - keep, keep);
+		dsize = keep;
+
+		nb = in_bit + job.in_used;
+		ip += nb / 8;
+		in_bit = nb % 8;
+
+		if (job.status == INFLATE_STATUS_DONE)
+			break;
+		if (job.status == INFLATE_STATUS_NEED_INPUT && all_in) {
+			fprintf(stderr, "err: deflate stream cut short\n");
+			return -1;
+		}
+		if (job.in_used == 0 && job.out_size == 0) {
+			fprintf(stderr, "err: no progress at byte %lld\n",
+				(long long)ip);
+			return -1;
+		}
+	}
+	*off = ip + (in_bit != 0);	/* trailers start at a byte */
+	return 0;
+}
+
+/* Length of the gzip member header at in, 0 if there is none */
+static uint64_t gzip_header(const uint8_t *in, uint64_t size)
+{
+	uint64_t i = 10;
+	uint8_t flg;
+
+	if (size < 10 || in[0] != 0x1f || in[1] != 0x8b || in[2] != 8)
+		return 0;
+	flg = in[3];
+	if (flg & GZIP_FEXTRA) {
+		if (size < i + 2)
+			return 0;
+		i += 2 + (in[i] | in[i + 1] << 8);
+	}
+	if (flg & GZIP_FNAME) {
+		while (i < size && in[i] != 0)
+			i++;
+		i++;
+	}
+	if (flg & GZIP_FCOMMENT) {
+		while (i < size && in[i] != 0)
+			i++;
+		i++;
+	}
+	if (flg & GZIP_FHCRC)
+		i += 2;
+	return i <= size ? i : 0;
+}
+
+static int zlib_header(const uint8_t *in, uint64_t size)
+{
+	return size >= 2 && (in[0] & 0x0f) == 8 && (in[0] >> 4) <= 7 &&
+		(in[0] << 8 | in[1]) % 31 == 0;
+}
+
+static int inflate_file(struct inflate_tool *t, const uint8_t *in,
+			uint64_t size, enum inflate_format format)
+{
+	uint64_t off = 0, hdr, n;
+
+	switch (format) {
+	case FORMAT_RAW:
+		if (inflate_stream(t, in, size, &off, &n) != 0)
+			return -1;
+		t->total += n;
+		break;
+	case FORMAT_ZLIB:
+		if (in[1] & ZLIB_FDICT) {
+			fprintf(stderr, "err: zlib preset dictionaries are "
+				"not supported\n");
+			return -1;
+		}
+		off = 2;
+		if (inflate_stream(t, in, size, &off, &n) != 0)
+			return -1;
+		t->total += n;
+		if (size - off < 4 || get32be(in + off) != t->adler) {
+			fprintf(stderr, "err: zlib Adler-32 mismatch\n");
+			return -1;
+		}
+		off += 4;
+		break;
+	case FORMAT_GZIP:
+		while (off < size) {
+			hdr = gzip_header(in + off, size - off);
+			if (hdr == 0) {
+				if (t->total == 0) {
+					fprintf(stderr, "err: broken gzip "
+						"header\n");
+					return -1;
+				}
+				break;	/* trailing garbage */
+			}
+			off += hdr;
+			if (inflate_stream(t, in, size, &off, &n) != 0)
+				return -1;
+			t->total += n;
+			if (size - off < 8 ||
+			    get32le(in + off) != t->crc ||
+			    get32le(in + off + 4) != (uint32_t)n) {
+				fprintf(stderr, "err: gzip CRC32 or length "
+					"mismatch\n");
+				return -1;
+			}
+			off += 8;
+		}
+		break;
+	}
+	if (off != size)
+		fprintf(stderr, "warn: %lld bytes after the stream "
+			"ignored\n", (long long)(size - off));
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	int ch, rc = 0;
+	int card_no = 0;
+	struct snap_card *card = NULL;
+	struct inflate_tool t;
+	char device[128];
+	const char *input = NULL;
+	const char *output = NULL;
+	int raw = 0;
+	enum inflate_format format;
+	struct timeval etime, stime;
+	ssize_t size;
+	uint8_t *ibuff = NULL;
+	long long usec;
+
+	memset(&t, 0, sizeof(t));
+	t.timeout = 10;
+	t.chunk = CHUNK_SIZE;
+
+	while (1) {
+		int option_index = 0;
+		static struct option long_options[] = {
+			{ "card",	 required_argument, NULL, 'C' },
+			{ "input",	 required_argument, NULL, 'i' },
+			{ "output",	 required_argument, NULL, 'o' },
+			{ "raw",	 no_argument,	    NULL, 'r' },
+			{ "chunk",	 required_argument, NULL, 'B' },
+			{ "timeout",	 required_argument, NULL, 't' },
+			{ "version",	 no_argument,	    NULL, 'V' },
+			{ "verbose",	 no_argument,	    NULL, 'v' },
+			{ "help",	 no_argument,	    NULL, 'h' },
+			{ 0,		 no_argument,	    NULL, 0   },
+		};
+
+		ch = getopt_long(argc, argv, "C:i:o:rB:t:Vvh",
+				 long_options, &option_index);
+		if (ch == -1)
+			break;
+
+		switch (ch) {
+		case 'C':
+			card_no = strtol(optarg, (char **)NULL, 0);
+			break;
+		case 'i':
+			input = optarg;
+			break;
+		case 'o':
+			output = optarg;
+			break;
+		case 'r':
+			raw = 1;
+			break;
+		case 'B':
+			t.chunk = __str_to_num(optarg);
+			break;
+		case 't':
+			t.timeout = strtol(optarg, (char **)NULL, 0);
+			break;
+			/* service */
+		case 'V':
+			printf("%s\n", version);
+			exit(EXIT_SUCCESS);
+		case 'v':
+			verbose_flag = 1;
+			break;
+		case 'h':
+			usage(argv[0]);
+			exit(EXIT_SUCCESS);
+			break;
+		default:
+			usage(argv[0]);
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	if (optind != argc || input == NULL || output == NULL ||
+	    t.chunk < CHUNK_MIN || t.chunk % CHUNK_MIN) {
+		usage(argv[0]);
+		exit(EXIT_FAILURE);
+	}
+
+	size = __file_size(input);
+	if (size < 0)
+		goto out_error;
+	ibuff = snap_malloc(size + 1);
+	if (ibuff == NULL)
+		goto out_error;
+	if (size != 0 && __file_read(input, ibuff, size) < 0)
+		goto out_error;
+
+	if (raw)
+		format = FORMAT_RAW;
+	else if (gzip_header(ibuff, size) != 0)
+		format = FORMAT_GZIP;
+	else if (zlib_header(ibuff, size))
+		format = FORMAT_ZLIB;
+	else {
+		fprintf(stderr, "err: %s is neither gzip nor zlib, use -r "
+			"for raw deflate\n", input);
+		goto out_error;
+	}
+
+	t.state = snap_malloc(sizeof(*t.state));
+	t.obuf = snap_malloc(INFLATE_DICT_SIZE + t.chunk);
+	if (t.state == NULL || t.obuf == NULL)
+		goto out_error;
+
+	t.fp = fopen(output, "w");
+	if (t.fp == NULL) {
+		fprintf(stderr, "err: cannot open %s: %s\n", output,
+			strerror(errno));
+		goto out_error;
+	}
+
+	snprintf(device, sizeof(device)-1, "/dev/cxl/afu%d.0s", card_no);
+	card = snap_card_alloc_dev(device, SNAP_VENDOR_ID_IBM,
+				   SNAP_DEVICE_ID_SNAP);
+	if (card == NULL) {
+		fprintf(stderr, "err: failed to open card %u: %s\n",
+			card_no, strerror(errno));
+		goto out_error;
+	}
+
+	t.action = snap_attach_action(card, INFLATE_ACTION_TYPE, 0, 60);
+	if (t.action == NULL) {
+		fprintf(stderr, "err: failed to attach action %u: %s\n",
+			card_no, strerror(errno));
+		goto out_error1;
+	}
+
+	gettimeofday(&stime, NULL);
+	rc = inflate_file(&t, ibuff, size, format);
+	gettimeofday(&etime, NULL);
+	if (rc != 0)
+		goto out_error2;
+	if (fclose(t.fp) != 0) {
+		t.fp = NULL;
+		goto out_error2;
+	}
+	t.fp = NULL;
+
+	usec = timediff_usec(&etime, &stime);
+	fprintf(stdout, "decompress %lld bytes to %lld bytes in %u jobs "
+		"took %lld usec\n", (long long)size, (long long)t.total,
+		t.jobs, usec);
+	if (verbose_flag)
+		fprintf(stdout, "cycles %lld read %lld bytes written %lld "
+			"bytes stalls read %lld write %lld\n",
+			(long long)t.perf.cycles,
+			(long long)t.perf.rd_bytes,
+			(long long)t.perf.wr_bytes,
+			(long long)t.perf.rd_stall,
+			(long long)t.perf.wr_stall);
+
+	snap_detach_action(t.action);
+	snap_card_free(card);
+	__free(t.obuf);
+	__free(t.state);
+	__free(ibuff);
+	exit(EXIT_SUCCESS);
+
+ out_error2:
+	snap_detach_action(t.action);
+ out_error1:
+	snap_card_free(card);
+ out_error:
+	if (t.fp != NULL)
+		fclose(t.fp);
+	__free(t.obuf);
+	__free(t.state);
+	__free(ibuff);
+	exit(EXIT_FAILURE);
+}
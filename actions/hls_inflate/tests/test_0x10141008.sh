@@ -0,0 +1,132 @@
+#!/bin/bash
+
+#
+# Copyright 2017 International Business Machines
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+
+verbose=0
+snap_card=0
+duration="NORMAL"
+
+function usage() {
+    echo "Usage:"
+    echo "  test_<action_type>.sh"
+    echo "    [-C <card>] card to be used for the test"
+    echo "    [-t <trace_level>]"
+    echo "    [-duration SHORT/NORMAL/LONG] run tests"
+    echo
+}
+
+while getopts ":C:t:d:h" opt; do
+    case $opt in
+	C)
+	snap_card=$OPTARG;
+	;;
+	t)
+	export SNAP_TRACE=$OPTARG;
+	;;
+	d)
+	duration=$OPTARG;
+	;;
+	h)
+	usage;
+	exit 0;
+	;;
+	\?)
+	echo "Invalid option: -$OPTARG" >&2
+	;;
+    esac
+done
+
+export PATH=$PATH:../software/tools
+
+snap_peek --help > /dev/null || exit 1;
+snap_poke --help > /dev/null || exit 1;
+
+#### VERSION ##########################################################
+
+if [ -z "$SNAP_CONFIG" ]; then
+	echo "CARD VERSION"
+	snap_peek -C ${snap_card} 0x0 || exit 1;
+	snap_peek -C ${snap_card} 0x8 || exit 1;
+	echo
+fi
+
+#### INFLATE ##########################################################
+
+export PATH=$PATH:./hls_inflate/sw
+
+function run() {
+    local name=$1; shift
+    echo -n "$name ... "
+    cmd="( $* ) > snap_inflate.log 2>&1"
+    eval ${cmd}
+    if [ $? -ne 0 ]; then
+	cat snap_inflate.log
+	echo "cmd: ${cmd}"
+	echo "failed"
+	exit 1
+    fi
+    echo "ok"
+}
+
+# text which compresses, data which does not, a long run and nothing
+if [ "$duration" = "SHORT" ]; then size=70000; else size=3000000; fi
+head -c $size /dev/urandom | od -An -tx1 > inflate_text.bin
+head -c $size /dev/urandom > inflate_rand.bin
+head -c $size /dev/zero > inflate_zero.bin
+: > inflate_empty.bin
+
+# gzip files, a file of several members and small jobs
+if which gzip > /dev/null 2>&1; then
+    for f in inflate_text inflate_rand inflate_zero inflate_empty; do
+	for level in 1 6 9; do
+	    run "Doing snap_inflate of gzip -$level $f" \
+		"gzip -$level -c $f.bin > $f.gz && snap_inflate -C${snap_card} -i $f.gz -o $f.out"
+	    run "Check results" "cmp $f.bin $f.out"
+	done
+	run "Doing snap_inflate -B 4KiB $f" \
+	    "snap_inflate -C${snap_card} -B 4KiB -i $f.gz -o $f.out"
+	run "Check results" "cmp $f.bin $f.out"
+    done
+    run "Doing snap_inflate of gzip members" \
+	"cat inflate_text.gz inflate_zero.gz > inflate_cat.gz && snap_inflate -C${snap_card} -i inflate_cat.gz -o inflate_cat.out"
+    run "Check results" \
+	"cat inflate_text.bin inflate_zero.bin | cmp - inflate_cat.out"
+    run "Doing snap_inflate of a cut gzip file" \
+	"head -c 1000 inflate_text.gz > inflate_cut.gz && ! snap_inflate -C${snap_card} -i inflate_cut.gz -o inflate_cut.out"
+else
+    echo "gzip not found, skipping the gzip checks"
+fi
+
+# zlib and raw streams of each strategy of zlib
+if python3 -c "import zlib" > /dev/null 2>&1; then
+    for f in inflate_text inflate_zero; do
+	for strategy in Z_DEFAULT_STRATEGY Z_FIXED Z_HUFFMAN_ONLY Z_RLE; do
+	    run "Doing snap_inflate of zlib $strategy $f" \
+		"python3 -c 'import sys, zlib; c = zlib.compressobj(6, zlib.DEFLATED, 15, 8, zlib.$strategy); d = open(\"$f.bin\", \"rb\").read(); sys.stdout.buffer.write(c.compress(d) + c.flush())' > $f.z && snap_inflate -C${snap_card} -B 64KiB -i $f.z -o $f.out"
+	    run "Check results" "cmp $f.bin $f.out"
+	done
+	run "Doing snap_inflate -r of raw $f" \
+	    "python3 -c 'import sys, zlib; c = zlib.compressobj(9, zlib.DEFLATED, -15); d = open(\"$f.bin\", \"rb\").read(); sys.stdout.buffer.write(c.compress(d) + c.flush())' > $f.raw && snap_inflate -C${snap_card} -r -i $f.raw -o $f.out"
+	run "Check results" "cmp $f.bin $f.out"
+    done
+else
+    echo "python3 zlib not found, skipping the zlib checks"
+fi
+
+rm -f inflate_*.bin inflate_*.gz inflate_*.z inflate_*.raw inflate_*.out snap_inflate.log
+echo "Test OK"
+exit 0
@@ -117,34 +117,22 @@ void memcopy_table(snap_membus_t  *din_gmem,
         snapu32_t       total_bytes_to_transfer,
         short     direction)
 {
-
     //source_address and target_address are byte addresses.
-    snapu64_t address_xfer_offset = 0;
-    snap_membus_t   buf_gmem[MAX_NB_OF_BYTES_READ/ELE_BYTES];
-
-
-    snapu32_t  left_bytes = total_bytes_to_transfer;
-    snapu32_t  copy_bytes;
-
-    // Be cautious with "unsigned", it always >=0
-copy_loop: while (left_bytes > 0) {
-            if(direction == HOST2DDR) {
-                copy_bytes = read_bulk (din_gmem, source_address + address_xfer_offset,  left_bytes, buf_gmem);
-                write_bulk (d_ddrmem, target_address + address_xfer_offset,  copy_bytes, buf_gmem);
-
-            } else if (direction == DDR2HOST) {
-                copy_bytes = read_bulk  (d_ddrmem, source_address + address_xfer_offset, left_bytes, buf_gmem);
-                write_bulk (dout_gmem, target_address + address_xfer_offset, copy_bytes, buf_gmem);
-
-            } else if (direction == DDR2DDR) {
-                copy_bytes = read_bulk  (d_ddrmem, source_address + address_xfer_offset, left_bytes, buf_gmem);
-                write_bulk (d_ddrmem, target_address + address_xfer_offset, copy_bytes, buf_gmem);
-            }
-
-            left_bytes -= copy_bytes;
-            address_xfer_offset += MAX_NB_OF_BYTES_READ;
-        } // end of L_COPY
-
+    if(direction == HOST2DDR)
+        snap_dma_copy(din_gmem, dout_gmem, d_ddrmem, d_ddrmem,
+                      SNAP_ADDRTYPE_HOST_DRAM, source_address,
+                      SNAP_ADDRTYPE_CARD_DRAM, target_address,
+                      total_bytes_to_transfer);
+    else if (direction == DDR2HOST)
+        snap_dma_copy(din_gmem, dout_gmem, d_ddrmem, d_ddrmem,
+                      SNAP_ADDRTYPE_CARD_DRAM, source_address,
+                      SNAP_ADDRTYPE_HOST_DRAM, target_address,
+                      total_bytes_to_transfer);
+    else if (direction == DDR2DDR)
+        snap_dma_copy(din_gmem, dout_gmem, d_ddrmem, d_ddrmem,
+                      SNAP_ADDRTYPE_CARD_DRAM, source_address,
+                      SNAP_ADDRTYPE_CARD_DRAM, target_address,
+                      total_bytes_to_transfer);
 }
 
 static short compare_eq(ele_t a, ele_t b)
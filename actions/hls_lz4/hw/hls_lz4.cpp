@@ -0,0 +1,810 @@
+/*
+ * Copyright 2017 International Business Machines
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* SNAP HLS_LZ4 EXAMPLE */
+
+#include <string.h>
+#include "ap_int.h"
+#include "action_lz4.H"
+
+/* ----------------------------------------------------------------------------
+ * LZ4 blocks as the frame format stores them, see include/action_lz4.h.
+ *
+ * The data of both directions sits in a window of LZ4_WINDOW bytes,
+ * cyclically partitioned into 8 banks, so that 8 bytes at any offset
+ * are read or written per cycle. The window keeps the dict and the
+ * block being worked on, or the last 64KiB written out, which is all
+ * an LZ4 match may reach back to. Literals, matches and the bus words
+ * in and out all move 8 bytes per cycle.
+ *
+ * The compressor finds matches the way the reference LZ4 does: a hash
+ * table of LZ4_HASH_LOG bits maps 4 byte sequences to their last
+ * position. A hit is checked in the window and extended 8 bytes per
+ * cycle. The bytes a match covers are skipped, not hashed, so data
+ * which compresses passes several bytes per cycle. Misses make the
+ * step longer like in the reference, by a byte every 64 of them, so
+ * data which does not compress passes several bytes per cycle, too.
+ *
+ * in and dict are read from any byte address, the skipped head of
+ * their first bus word is dropped. out must be 64 byte aligned.
+ * ----------------------------------------------------------------------------
+ */
+
+/* Equal leading bytes of a and b, 8 if all are */
+static snapu32_t lz4_same(snap_bytes_t a, snap_bytes_t b)
+{
+	snapu32_t n = 8;
+
+ lz4_same_loop:
+	for (int k = 7; k >= 0; k--) {
+#pragma HLS UNROLL
+		if (a(8 * k + 7, 8 * k) != b(8 * k + 7, 8 * k))
+			n = k;
+	}
+	return n;
+}
+
+static snapu32_t lz4_hash(snapu32_t seq)
+{
+	snapu32_t h = seq * (snapu32_t)2654435761U;
+
+	return h >> (32 - LZ4_HASH_LOG);
+}
+
+/* n bytes from in to pos of the window */
+static void lz4_load(snap_bytes_in_t *in, snap_membus_t *host,
+		     snap_membus_t *card, snapu8_t *win, snapu64_t pos,
+		     snapu32_t n, snap_perf_t *perf)
+{
+ lz4_load_loop:
+	for (snapu32_t i = 0; i < n; i += 8) {
+#pragma HLS PIPELINE
+		snapu32_t k = MIN((snapu32_t)(n - i), (snapu32_t)8);
+
+		snap_bytes_put8(win, LZ4_WINDOW - 1, pos + i,
+				snap_bytes_get(in, host, card, k, perf), k);
+	}
+}
+
+/* n bytes from pos of buf to out */
+static void lz4_store(snapu8_t *buf, snapu32_t mask, snapu64_t pos,
+		      snapu32_t n, snap_bytes_out_t *out, snap_membus_t *host,
+		      snap_membus_t *card, snap_perf_t *perf)
+{
+ lz4_store_loop:
+	for (snapu32_t i = 0; i < n; i += 8) {
+#pragma HLS PIPELINE
+		snapu32_t k = MIN((snapu32_t)(n - i), (snapu32_t)8);
+
+		snap_bytes_put(out, host, card,
+			       snap_bytes_get8(buf, mask, pos + i), k, perf);
+	}
+}
+
+//----------------------------------------------------------------------
+//--- COMPRESS ---------------------------------------------------------
+//----------------------------------------------------------------------
+
+/* Length extension bytes of a length of 15 + rem */
+static snapu32_t lz4_put_ext(snapu8_t *obuf, snapu32_t op, snapu32_t rem)
+{
+	snapu32_t n255 = rem / 255;
+
+ lz4_put_ext_loop:
+	for (snapu32_t i = 0; i < n255; i += 8) {
+#pragma HLS PIPELINE
+		snapu32_t k = MIN((snapu32_t)(n255 - i), (snapu32_t)8);
+
+		snap_bytes_put8(obuf, ~0U, op + i, ~(snap_bytes_t)0, k);
+	}
+	op += n255;
+	obuf[op] = rem - n255 * 255;
+	return op + 1;
+}
+
+/* Sequence of lit literals at anchor and a match, or none if mlen is 0 */
+static snapu32_t lz4_put_seq(snapu8_t *win, snapu8_t *obuf, snapu32_t op,
+			     snapu64_t anchor, snapu32_t lit,
+			     snapu32_t offset, snapu32_t mlen)
+{
+	snapu8_t token = 0;
+
+	if (lit < 15)
+		token(7, 4) = lit;
+	else	token(7, 4) = 15;
+	if (mlen != 0 && mlen - LZ4_MINMATCH < 15)
+		token(3, 0) = mlen - LZ4_MINMATCH;
+	else if (mlen != 0)
+		token(3, 0) = 15;
+	obuf[op] = token;
+	op++;
+	if (lit >= 15)
+		op = lz4_put_ext(obuf, op, lit - 15);
+
+ lz4_put_lit_loop:
+	for (snapu32_t i = 0; i < lit; i += 8) {
+#pragma HLS PIPELINE
+		snapu32_t k = MIN((snapu32_t)(lit - i), (snapu32_t)8);
+
+		snap_bytes_put8(obuf, ~0U, op + i,
+				snap_bytes_get8(win, LZ4_WINDOW - 1, anchor + i),
+				k);
+	}
+	op += lit;
+	if (mlen == 0)
+		return op;
+
+	obuf[op] = offset(7, 0);
+	obuf[op + 1] = offset(15, 8);
+	op += 2;
+	if (mlen - LZ4_MINMATCH >= 15)
+		op = lz4_put_ext(obuf, op, mlen - LZ4_MINMATCH - 15);
+	return op;
+}
+
+/*
+ * Compress bsize bytes at bstart of the window into obuf. Matches may
+ * start at low. Returns the compressed size, fits is 0 if that is not
+ * below bsize, obuf then holds a part only.
+ */
+static snapu32_t lz4_compress_block(snapu8_t *win, snapu64_t *htab,
+				    snapu8_t *obuf, snapu64_t bstart,
+				    snapu32_t bsize, snapu64_t low,
+				    snap_bool_t *fits)
+{
+	snapu64_t end = bstart + bsize;
+	snapu64_t p = bstart, anchor = bstart;
+	snapu32_t op = 0, lit;
+	snapu32_t miss = 1 << LZ4_SKIP_TRIGGER;
+
+	*fits = 0;
+	if (bsize > LZ4_MFLIMIT) {
+		snapu64_t mflimit = end - LZ4_MFLIMIT;
+		snapu64_t mlimit = end - LZ4_LASTLITERALS;
+
+	lz4_match_loop:
+		while (p <= mflimit) {
+			snapu32_t seq = snap_bytes_get8(win, LZ4_WINDOW - 1, p)(31, 0);
+			snapu32_t h = lz4_hash(seq);
+			snapu64_t c = htab[h];
+			snapu64_t cand = c - 1;
+			snapu32_t mlen = LZ4_MINMATCH, n;
+
+			htab[h] = p + 1;
+			if (c == 0 || cand < low ||
+			    p - cand > LZ4_MAX_DISTANCE ||
+			    snap_bytes_get8(win, LZ4_WINDOW - 1, cand)(31, 0) != seq) {
+				p += miss >> LZ4_SKIP_TRIGGER;
+				miss++;
+				continue;
+			}
+
+		lz4_extend_loop:
+			while (p + mlen < mlimit) {
+#pragma HLS PIPELINE
+				n = lz4_same(snap_bytes_get8(win, LZ4_WINDOW - 1,
+								     p + mlen),
+					     snap_bytes_get8(win, LZ4_WINDOW - 1,
+								     cand + mlen));
+				if (n > mlimit - p - mlen)
+					n = mlimit - p - mlen;
+				mlen += n;
+				if (n < 8)
+					break;
+			}
+
+			lit = p - anchor;
+			if (op + lit + lit / 255 + mlen / 255 + 8 >= bsize)
+				return op;
+			op = lz4_put_seq(win, obuf, op, anchor, lit, p - cand,
+					 mlen);
+			p += mlen;
+			anchor = p;
+			miss = 1 << LZ4_SKIP_TRIGGER;
+		}
+	}
+
+	lit = end - anchor;
+	if (op + lit + lit / 255 + 2 >= bsize)
+		return op;
+	op = lz4_put_seq(win, obuf, op, anchor, lit, 0, 0);
+	*fits = 1;
+	return op;
+}
+
+static short lz4_compress(snap_membus_t *din_gmem, snap_membus_t *dout_gmem,
+			  snap_membus_t *d_ddrmem, action_reg *act_reg,
+			  snapu8_t *win, snapu8_t *obuf, snapu64_t *htab,
+			  snap_perf_t *perf)
+{
+	snap_bytes_in_t in;
+	snap_bytes_out_t out;
+	snapu64_t dsize = act_reg->Data.dict.size;
+	snapu64_t left = act_reg->Data.in.size;
+	snapu64_t pos, low = 0;
+	snapu32_t bsize, csize, blocks = 0;
+	snap_bool_t fits;
+	short rc = 0;
+
+	if (dsize > LZ4_DICT_SIZE)
+		dsize = LZ4_DICT_SIZE;
+
+ lz4_htab_clear:
+	for (int h = 0; h < (1 << LZ4_HASH_LOG); h++)
+#pragma HLS PIPELINE
+		htab[h] = 0;
+
+	/* the end of the dict goes first into the window and the table */
+	snap_bytes_in_open(&in, din_gmem, d_ddrmem, act_reg->Data.dict.type,
+			   act_reg->Data.dict.addr + act_reg->Data.dict.size -
+			   dsize, dsize, perf);
+	lz4_load(&in, din_gmem, d_ddrmem, win, 0, dsize, perf);
+	rc |= in.rc;
+ lz4_htab_dict:
+	for (pos = 0; pos + LZ4_MINMATCH <= dsize; pos++)
+#pragma HLS PIPELINE
+		htab[lz4_hash(snap_bytes_get8(win, LZ4_WINDOW - 1, pos)(31, 0))] =
+			pos + 1;
+	pos = dsize;
+
+	snap_bytes_in_open(&in, din_gmem, d_ddrmem, act_reg->Data.in.type,
+			   act_reg->Data.in.addr, act_reg->Data.in.size, perf);
+	snap_bytes_out_open(&out, act_reg->Data.out.type,
+			    act_reg->Data.out.addr);
+
+ lz4_compress_loop:
+	while (left != 0 && rc == 0) {
+		bsize = left < LZ4_BLOCK_SIZE ? left :
+			(snapu64_t)LZ4_BLOCK_SIZE;
+		lz4_load(&in, din_gmem, d_ddrmem, win, pos, bsize, perf);
+		if (act_reg->Data.flags & LZ4_FLAG_INDEPENDENT)
+			low = pos;
+
+		csize = lz4_compress_block(win, htab, obuf, pos, bsize, low,
+					   &fits);
+		if (out.total + 4 + (fits ? csize : bsize) >
+		    act_reg->Data.out.size) {
+			rc = 1;
+			break;
+		}
+		if (fits) {
+			snap_bytes_put(&out, dout_gmem, d_ddrmem, csize, 4, perf);
+			lz4_store(obuf, ~0U, 0, csize, &out, dout_gmem,
+				  d_ddrmem, perf);
+		} else {
+			snap_bytes_put(&out, dout_gmem, d_ddrmem,
+				       bsize | LZ4_BLOCK_RAW, 4, perf);
+			lz4_store(win, LZ4_WINDOW - 1, pos, bsize, &out,
+				  dout_gmem, d_ddrmem, perf);
+		}
+		pos += bsize;
+		left -= bsize;
+		blocks++;
+		rc |= in.rc;
+	}
+	snap_bytes_flush(&out, dout_gmem, d_ddrmem, perf);
+
+	act_reg->Data.out_size = out.total;
+	act_reg->Data.blocks = blocks;
+	return rc | in.rc | out.rc;
+}
+
+//----------------------------------------------------------------------
+//--- DECOMPRESS -------------------------------------------------------
+//----------------------------------------------------------------------
+
+/* n bytes of output: to out and the window at pos */
+static void lz4_emit(snapu8_t *win, snapu64_t *pos, snap_bytes_out_t *out,
+		     snap_membus_t *host, snap_membus_t *card, snap_bytes_t w,
+		     snapu32_t n, snap_perf_t *perf)
+{
+	snap_bytes_put8(win, LZ4_WINDOW - 1, *pos, w, n);
+	snap_bytes_put(out, host, card, w, n, perf);
+	*pos += n;
+}
+
+/* Length extension bytes, -1 if the block ends within them */
+static snapu32_t lz4_get_ext(snap_bytes_in_t *in, snap_membus_t *host,
+			     snap_membus_t *card, snapu32_t *bleft,
+			     snapu32_t len, snap_perf_t *perf)
+{
+	snapu8_t b;
+
+ lz4_get_ext_loop:
+	do {
+#pragma HLS PIPELINE
+		if (*bleft == 0)
+			return ~0U;
+		b = snap_bytes_get(in, host, card, 1, perf);
+		(*bleft)--;
+		len += b;
+	} while (b == 255);
+	return len;
+}
+
+/*
+ * Decompress a block of bsize bytes from in. pos is the position of
+ * the next output byte in the window, dsize of them being dict.
+ */
+static short lz4_decompress_block(snap_bytes_in_t *in, snap_bytes_out_t *out,
+				  snap_membus_t *din_gmem,
+				  snap_membus_t *dout_gmem,
+				  snap_membus_t *d_ddrmem, snapu8_t *win,
+				  snapu64_t *pos, snapu32_t bsize,
+				  snapu64_t osize, snap_perf_t *perf)
+{
+	snapu32_t bleft = bsize;
+	snapu32_t lit, mlen, offset, i, k;
+	snapu8_t token;
+
+ lz4_seq_loop:
+	while (bleft != 0) {
+		token = snap_bytes_get(in, din_gmem, d_ddrmem, 1, perf);
+		bleft--;
+		lit = token(7, 4);
+		if (lit == 15)
+			lit = lz4_get_ext(in, din_gmem, d_ddrmem, &bleft, lit,
+					  perf);
+		if (lit > bleft || out->total + lit > osize)
+			return 1;
+
+	lz4_lit_loop:
+		for (i = 0; i < lit; i += 8) {
+#pragma HLS PIPELINE
+			k = MIN((snapu32_t)(lit - i), (snapu32_t)8);
+			lz4_emit(win, pos, out, dout_gmem, d_ddrmem,
+				 snap_bytes_get(in, din_gmem, d_ddrmem, k,
+						perf), k, perf);
+		}
+		bleft -= lit;
+		if (bleft == 0)
+			break;		/* the last sequence has no match */
+
+		if (bleft < 2)
+			return 1;
+		offset = snap_bytes_get(in, din_gmem, d_ddrmem, 2, perf);
+		bleft -= 2;
+		if (offset == 0 || offset > *pos)
+			return 1;
+		mlen = token(3, 0);
+		if (mlen == 15)
+			mlen = lz4_get_ext(in, din_gmem, d_ddrmem, &bleft,
+					   mlen, perf);
+		if (mlen == ~0U || out->total + mlen + LZ4_MINMATCH > osize)
+			return 1;
+		mlen += LZ4_MINMATCH;
+
+		/* closer than 8 bytes, the match repeats what it writes */
+		if (offset >= 8) {
+		lz4_match_loop:
+			for (i = 0; i < mlen; i += 8) {
+#pragma HLS PIPELINE
+				k = MIN((snapu32_t)(mlen - i), (snapu32_t)8);
+				lz4_emit(win, pos, out, dout_gmem, d_ddrmem,
+					 snap_bytes_get8(win, LZ4_WINDOW - 1,
+							 *pos - offset),
+					 k, perf);
+			}
+		} else {
+		lz4_match_byte_loop:
+			for (i = 0; i < mlen; i++) {
+#pragma HLS PIPELINE
+				lz4_emit(win, pos, out, dout_gmem, d_ddrmem,
+					 win[(*pos - offset) &
+					     (LZ4_WINDOW - 1)], 1, perf);
+			}
+		}
+	}
+	return 0;
+}
+
+static short lz4_decompress(snap_membus_t *din_gmem,
+			    snap_membus_t *dout_gmem,
+			    snap_membus_t *d_ddrmem, action_reg *act_reg,
+			    snapu8_t *win, snap_perf_t *perf)
+{
+	snap_bytes_in_t in;
+	snap_bytes_out_t out;
+	snapu64_t dsize = act_reg->Data.dict.size;
+	snapu64_t osize = act_reg->Data.out.size;
+	snapu64_t pos = 0;
+	snapu32_t hdr, bsize, blocks = 0;
+	short rc = 0;
+
+	if (dsize > LZ4_DICT_SIZE)
+		dsize = LZ4_DICT_SIZE;
+	snap_bytes_in_open(&in, din_gmem, d_ddrmem, act_reg->Data.dict.type,
+			   act_reg->Data.dict.addr + act_reg->Data.dict.size -
+			   dsize, dsize, perf);
+	lz4_load(&in, din_gmem, d_ddrmem, win, 0, dsize, perf);
+	rc |= in.rc;
+	pos = dsize;
+
+	snap_bytes_in_open(&in, din_gmem, d_ddrmem, act_reg->Data.in.type,
+			   act_reg->Data.in.addr, act_reg->Data.in.size, perf);
+	snap_bytes_out_open(&out, act_reg->Data.out.type,
+			    act_reg->Data.out.addr);
+
+ lz4_decompress_loop:
+	while (in.left != 0 && rc == 0) {
+		if (in.left < 4) {
+			rc = 1;
+			break;
+		}
+		hdr = snap_bytes_get(&in, din_gmem, d_ddrmem, 4, perf);
+		if (hdr == 0)
+			break;		/* end mark */
+		bsize = hdr & ~LZ4_BLOCK_RAW;
+		if (bsize > in.left) {
+			rc = 1;
+			break;
+		}
+
+		if (hdr & LZ4_BLOCK_RAW) {
+			if (out.total + bsize > osize) {
+				rc = 1;
+				break;
+			}
+		lz4_raw_loop:
+			for (snapu32_t i = 0; i < bsize; i += 8) {
+#pragma HLS PIPELINE
+				snapu32_t k = MIN((snapu32_t)(bsize - i),
+						  (snapu32_t)8);
+
+				lz4_emit(win, &pos, &out, dout_gmem, d_ddrmem,
+					 snap_bytes_get(&in, din_gmem, d_ddrmem,
+							k, perf), k, perf);
+			}
+		} else
+			rc = lz4_decompress_block(&in, &out, din_gmem,
+						  dout_gmem, d_ddrmem, win,
+						  &pos, bsize, osize, perf);
+
+		if (act_reg->Data.flags & LZ4_FLAG_BLOCK_CHECKSUM) {
+			if (in.left < 4)
+				rc = 1;
+			else	snap_bytes_get(&in, din_gmem, d_ddrmem, 4, perf);
+		}
+		blocks++;
+		rc |= in.rc;
+	}
+	snap_bytes_flush(&out, dout_gmem, d_ddrmem, perf);
+
+	act_reg->Data.out_size = out.total;
+	act_reg->Data.blocks = blocks;
+	return rc | in.rc | out.rc;
+}
+
+//----------------------------------------------------------------------
+//--- MAIN PROGRAM -----------------------------------------------------
+//----------------------------------------------------------------------
+static void process_action(snap_membus_t *din_gmem,
+			   snap_membus_t *dout_gmem,
+			   snap_membus_t *d_ddrmem,
+			   action_reg *act_reg,
+			   snap_perf_t *perf)
+{
+	static snapu8_t win[LZ4_WINDOW];
+	static snapu8_t obuf[LZ4_OBUF_SIZE];
+	static snapu64_t htab[1 << LZ4_HASH_LOG];
+#pragma HLS ARRAY_PARTITION variable=win cyclic factor=8
+#pragma HLS ARRAY_PARTITION variable=obuf cyclic factor=8
+	short rc;
+
+	snap_perf_clear(perf);
+	switch (act_reg->Data.mode) {
+	case LZ4_COMPRESS:
+		rc = lz4_compress(din_gmem, dout_gmem, d_ddrmem, act_reg,
+				  win, obuf, htab, perf);
+		break;
+	case LZ4_DECOMPRESS:
+		rc = lz4_decompress(din_gmem, dout_gmem, d_ddrmem, act_reg,
+				    win, perf);
+		break;
+	default:
+		rc = 1;
+		break;
+	}
+
+	if (rc != 0)
+		act_reg->Control.Retc = SNAP_RETC_FAILURE;
+	else	act_reg->Control.Retc = SNAP_RETC_SUCCESS;
+}
+
+//--- TOP LEVEL MODULE -------------------------------------------------
+void hls_action(snap_membus_t *din_gmem,
+		snap_membus_t *dout_gmem,
+		snap_membus_t *d_ddrmem,
+		action_reg *act_reg,
+		action_RO_config_reg *Action_Config,
+		snap_perf_t *Action_Perf)
+{
+	// Host Memory AXI Interface
+#pragma HLS INTERFACE m_axi port=din_gmem bundle=host_mem offset=slave depth=512 \
+  max_read_burst_length=64  max_write_burst_length=64 \
+  num_read_outstanding=8  num_write_outstanding=8
+#pragma HLS INTERFACE s_axilite port=din_gmem bundle=ctrl_reg offset=0x030
+
+#pragma HLS INTERFACE m_axi port=dout_gmem bundle=host_mem offset=slave depth=512 \
+  max_read_burst_length=64  max_write_burst_length=64 \
+  num_read_outstanding=8  num_write_outstanding=8
+#pragma HLS INTERFACE s_axilite port=dout_gmem bundle=ctrl_reg offset=0x040
+
+	// DDR memory Interface
+#pragma HLS INTERFACE m_axi port=d_ddrmem bundle=card_mem0 offset=slave depth=512 \
+  max_read_burst_length=64  max_write_burst_length=64 \
+  num_read_outstanding=8  num_write_outstanding=8
+#pragma HLS INTERFACE s_axilite port=d_ddrmem bundle=ctrl_reg offset=0x050
+
+	// Host Memory AXI Lite Master Interface
+#pragma HLS DATA_PACK variable=Action_Config
+#pragma HLS INTERFACE s_axilite port=Action_Config bundle=ctrl_reg offset=0x010
+#pragma HLS DATA_PACK variable=act_reg
+#pragma HLS INTERFACE s_axilite port=act_reg bundle=ctrl_reg offset=0x100
+#pragma HLS INTERFACE s_axilite port=return bundle=ctrl_reg
+
+	// Performance counters of the job, ACTION_PERF
+#pragma HLS DATA_PACK variable=Action_Perf
+#pragma HLS INTERFACE s_axilite port=Action_Perf bundle=ctrl_reg offset=0x080
+
+	/* Required Action Type Detection */
+	switch (act_reg->Control.flags) {
+	case 0:
+		Action_Config->action_type = LZ4_ACTION_TYPE;
+		Action_Config->release_level = RELEASE_LEVEL;
+		act_reg->Control.Retc = 0xe00f;
+		return;
+	default:
+		process_action(din_gmem, dout_gmem, d_ddrmem, act_reg,
+			       Action_Perf);
+		break;
+	}
+}
+
+//-----------------------------------------------------------------------------
+//--- TESTBENCH ---------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
+#if defined(NO_SYNTH) && !defined(HLS_SWEMU)
+
+#include <stdlib.h>
+
+/* "lz4 ref.txt" of 64 lines "SNAP LZ4 testbench line <i % 37>: ..." */
+static const uint8_t ref_frame[] = {
+	0x04, 0x22, 0x4d, 0x18, 0x64, 0x40, 0xa7, 0x1c,
+	0x01, 0x00, 0x00, 0xff, 0x20, 0x53, 0x4e, 0x41,
+	0x50, 0x20, 0x4c, 0x5a, 0x34, 0x20, 0x74, 0x65,
+	0x73, 0x74, 0x62, 0x65, 0x6e, 0x63, 0x68, 0x20,
+	0x6c, 0x69, 0x6e, 0x65, 0x20, 0x30, 0x3a, 0x20,
+	0x74, 0x68, 0x65, 0x20, 0x71, 0x75, 0x69, 0x63,
+	0x6b, 0x20, 0x62, 0x72, 0x6f, 0x77, 0x6e, 0x20,
+	0x66, 0x6f, 0x78, 0x0a, 0x2f, 0x00, 0x05, 0x1f,
+	0x31, 0x2f, 0x00, 0x1b, 0x1f, 0x32, 0x2f, 0x00,
+	0x1b, 0x1f, 0x33, 0x2f, 0x00, 0x1b, 0x1f, 0x34,
+	0x2f, 0x00, 0x1b, 0x1f, 0x35, 0x2f, 0x00, 0x1b,
+	0x1f, 0x36, 0x2f, 0x00, 0x1b, 0x1f, 0x37, 0x2f,
+	0x00, 0x1b, 0x1f, 0x38, 0x2f, 0x00, 0x1b, 0x1f,
+	0x39, 0x2f, 0x00, 0x1b, 0x1f, 0x31, 0xd7, 0x01,
+	0x1d, 0x0f, 0xd8, 0x01, 0x1c, 0x1f, 0x31, 0xd9,
+	0x01, 0x1c, 0x1f, 0x31, 0xda, 0x01, 0x1c, 0x1f,
+	0x31, 0xdb, 0x01, 0x1c, 0x1f, 0x31, 0xdc, 0x01,
+	0x1c, 0x1f, 0x31, 0xdd, 0x01, 0x1c, 0x1f, 0x31,
+	0xde, 0x01, 0x1c, 0x1f, 0x31, 0xdf, 0x01, 0x1c,
+	0x1f, 0x31, 0xe0, 0x01, 0x1c, 0x1f, 0x32, 0xe0,
+	0x01, 0x1c, 0x1f, 0x32, 0xe0, 0x01, 0x1c, 0x1f,
+	0x32, 0xe0, 0x01, 0x1c, 0x1f, 0x32, 0xe0, 0x01,
+	0x1c, 0x1f, 0x32, 0xe0, 0x01, 0x1c, 0x1f, 0x32,
+	0xe0, 0x01, 0x1c, 0x1f, 0x32, 0xe0, 0x01, 0x1c,
+	0x1f, 0x32, 0xe0, 0x01, 0x1c, 0x1f, 0x32, 0xe0,
+	0x01, 0x1c, 0x1f, 0x32, 0xe0, 0x01, 0x1c, 0x1f,
+	0x33, 0xe0, 0x01, 0x1c, 0x1f, 0x33, 0xe0, 0x01,
+	0x1c, 0x1f, 0x33, 0xe0, 0x01, 0x1c, 0x1f, 0x33,
+	0xe0, 0x01, 0x1c, 0x1f, 0x33, 0xe0, 0x01, 0x1c,
+	0x1f, 0x33, 0xe0, 0x01, 0x1c, 0x1f, 0x33, 0xe0,
+	0x01, 0x1c, 0x0f, 0x4f, 0x01, 0x1c, 0x0f, 0x4e,
+	0x01, 0x1c, 0x0f, 0x4d, 0x01, 0x1d, 0x0f, 0xcc,
+	0x05, 0x1b, 0x0f, 0x4b, 0x01, 0x1c, 0x0f, 0x4a,
+	0x01, 0x1c, 0x0f, 0x49, 0x01, 0x1c, 0x0f, 0x28,
+	0x03, 0x1c, 0x0f, 0x27, 0x03, 0x1c, 0x0f, 0x26,
+	0x03, 0x1c, 0x0f, 0xe6, 0x06, 0xff, 0xff, 0xff,
+	0x03, 0x50, 0x20, 0x66, 0x6f, 0x78, 0x0a, 0x00,
+	0x00, 0x00, 0x00, 0x61, 0x58, 0x8c, 0xfd,
+};
+#define REF_HDR 7	/* magic, FLG, BD, HC */
+
+/* Mixed test data: text, runs, short repeats and noise */
+static void fill(uint8_t *p, unsigned int size, unsigned int seed)
+{
+	static const char *words[] = { "snap ", "action ", "lz4 ", "block ",
+				       "frame ", "the ", "card ", "host " };
+	unsigned int i = 0, n, k;
+
+	srand(seed);
+	while (i < size) {
+		switch (rand() % 4) {
+		case 0:	/* text */
+			for (n = 0; n < 40 && i < size; n++) {
+				const char *w = words[rand() % 8];
+
+				for (k = 0; w[k] && i < size; k++)
+					p[i++] = w[k];
+			}
+			break;
+		case 1:	/* run */
+			for (n = rand() % 600, k = rand(); n && i < size; n--)
+				p[i++] = k;
+			break;
+		case 2:	/* short repeat */
+			for (n = rand() % 300, k = 1 + rand() % 7;
+			     n && i < size; n--, i++)
+				p[i] = i >= k ? p[i - k] : 0;
+			break;
+		default: /* noise */
+			for (n = rand() % 500; n && i < size; n--)
+				p[i++] = rand();
+			break;
+		}
+	}
+}
+
+static action_reg act_reg;
+static action_RO_config_reg Action_Config;
+static snap_perf_t Action_Perf;
+
+/* Run a job on host memory mem, addresses are offsets into it */
+static int run(snap_membus_t *mem, uint32_t mode, uint32_t flags,
+	       uint64_t in, uint64_t in_size, uint64_t out, uint64_t out_size,
+	       uint64_t dict, uint64_t dict_size)
+{
+	act_reg.Control.flags = 0x1; /* just not 0x0 */
+	act_reg.Data.mode = mode;
+	act_reg.Data.flags = flags;
+	act_reg.Data.in.addr = in;
+	act_reg.Data.in.size = in_size;
+	act_reg.Data.in.type = SNAP_ADDRTYPE_HOST_DRAM;
+	act_reg.Data.out.addr = out;
+	act_reg.Data.out.size = out_size;
+	act_reg.Data.out.type = SNAP_ADDRTYPE_HOST_DRAM;
+	act_reg.Data.dict.addr = dict;
+	act_reg.Data.dict.size = dict_size;
+	act_reg.Data.dict.type = SNAP_ADDRTYPE_HOST_DRAM;
+
+	hls_action(mem, mem, NULL, &act_reg, &Action_Config, &Action_Perf);
+	return act_reg.Control.Retc == SNAP_RETC_SUCCESS ? 0 : 1;
+}
+
+int main(void)
+{
+#define DATA_SIZE	(300 * 1024 + 17)
+#define SPLIT		(128 * 1024 + 64)	/* second job, 64 byte aligned */
+#define MEM_SIZE	(4 * 1024 * 1024)
+#define SRC		0
+#define CMP		(1024 * 1024)
+#define CMP2		(1536 * 1024)
+#define DST		(2 * 1024 * 1024)
+#define REF		(3 * 1024 * 1024)
+	snap_membus_t *mem = (snap_membus_t *)calloc(1, MEM_SIZE);
+	uint8_t *m = (uint8_t *)mem;
+	uint64_t csize, csize2, ref_size;
+	unsigned int i;
+
+	if (mem == NULL)
+		return 1;
+
+	/* Query ACTION_TYPE ... */
+	act_reg.Control.flags = 0x0;
+	hls_action(mem, mem, NULL, &act_reg, &Action_Config, &Action_Perf);
+	fprintf(stderr,
+		"ACTION_TYPE:   %08x\n"
+		"RELEASE_LEVEL: %08x\n"
+		"RETC:          %04x\n",
+		(unsigned int)Action_Config.action_type,
+		(unsigned int)Action_Config.release_level,
+		(unsigned int)act_reg.Control.Retc);
+
+	/* Round trip in one job, linked and independent blocks */
+	fill(m + SRC, DATA_SIZE, 1);
+	for (i = 0; i < 2; i++) {
+		uint32_t flags = i ? LZ4_FLAG_INDEPENDENT : 0;
+
+		memset(m + DST, 0, DATA_SIZE);
+		if (run(mem, LZ4_COMPRESS, flags, SRC, DATA_SIZE, CMP,
+			LZ4_COMPRESS_BOUND(DATA_SIZE), 0, 0)) {
+			fprintf(stderr, " ==> COMPRESS FAILURE <==\n");
+			return 1;
+		}
+		csize = act_reg.Data.out_size;
+		if (act_reg.Data.blocks != 5 || csize >= DATA_SIZE) {
+			fprintf(stderr, " ==> COMPRESS SIZE FAILURE <==\n");
+			return 1;
+		}
+		if (run(mem, LZ4_DECOMPRESS, 0, CMP, csize, DST, DATA_SIZE,
+			0, 0) || act_reg.Data.out_size != DATA_SIZE ||
+		    memcmp(m + SRC, m + DST, DATA_SIZE) != 0) {
+			fprintf(stderr, " ==> ROUND TRIP FAILURE <==\n");
+			return 1;
+		}
+		printf(" ==> ROUND TRIP %s %lu -> %lu OK <==\n",
+		       i ? "INDEPENDENT" : "LINKED", (unsigned long)DATA_SIZE,
+		       (unsigned long)csize);
+	}
+
+	/* Two jobs, the second continuing with the first as dict */
+	if (run(mem, LZ4_COMPRESS, 0, SRC, SPLIT, CMP,
+		LZ4_COMPRESS_BOUND(SPLIT), 0, 0))
+		return 1;
+	csize = act_reg.Data.out_size;
+	if (run(mem, LZ4_COMPRESS, 0, SRC + SPLIT, DATA_SIZE - SPLIT,
+		CMP2, LZ4_COMPRESS_BOUND(DATA_SIZE - SPLIT),
+		SRC, SPLIT))
+		return 1;
+	csize2 = act_reg.Data.out_size;
+	memset(m + DST, 0, DATA_SIZE);
+	if (run(mem, LZ4_DECOMPRESS, 0, CMP, csize, DST, SPLIT, 0, 0) ||
+	    run(mem, LZ4_DECOMPRESS, 0, CMP2, csize2, DST + SPLIT,
+		DATA_SIZE - SPLIT, DST, SPLIT) ||
+	    memcmp(m + SRC, m + DST, DATA_SIZE) != 0) {
+		fprintf(stderr, " ==> STREAMING FAILURE <==\n");
+		return 1;
+	}
+	/* without its dict the second part must not decode */
+	if (run(mem, LZ4_DECOMPRESS, 0, CMP2, csize2, DST + SPLIT,
+		DATA_SIZE - SPLIT, 0, 0) == 0) {
+		fprintf(stderr, " ==> MISSING DICT NOT DETECTED <==\n");
+		return 1;
+	}
+	printf(" ==> STREAMING %lu + %lu OK <==\n", (unsigned long)csize,
+	       (unsigned long)csize2);
+
+	/* Blocks of the lz4 tool, at an odd address after the header */
+	memcpy(m + REF, ref_frame, sizeof(ref_frame));
+	ref_size = sizeof(ref_frame) - REF_HDR;
+	if (run(mem, LZ4_DECOMPRESS, 0, REF + REF_HDR, ref_size, DST,
+		64 * 1024, 0, 0) || act_reg.Data.out_size != 3052 ||
+	    act_reg.Data.blocks != 1) {
+		fprintf(stderr, " ==> REFERENCE FAILURE <==\n");
+		return 1;
+	}
+	for (i = 0; i < 64; i++) {
+		char line[64];
+		int n = snprintf(line, sizeof(line),
+			"SNAP LZ4 testbench line %d: the quick brown fox\n",
+			i % 37);
+
+		if (memcmp(m + DST, line, n) != 0) {
+			fprintf(stderr, " ==> REFERENCE COMPARE FAILURE <==\n");
+			return 1;
+		}
+		memmove(m + DST, m + DST + n, 64 * 1024 - n);
+	}
+	printf(" ==> REFERENCE OK <==\n");
+
+	/* Too small an output and garbage must fail */
+	if (run(mem, LZ4_DECOMPRESS, 0, REF + REF_HDR, ref_size, DST, 3000,
+		0, 0) == 0 ||
+	    run(mem, LZ4_DECOMPRESS, 0, SRC, 4096, DST, 64 * 1024, 0, 0) == 0) {
+		fprintf(stderr, " ==> ERROR NOT DETECTED <==\n");
+		return 1;
+	}
+	free(mem);
+
+	printf(">> ACTION TYPE = %08lx - RELEASE_LEVEL = %08lx <<\n",
+	       (unsigned long)Action_Config.action_type,
+	       (unsigned long)Action_Config.release_level);
+	return 0;
+}
+
+#endif
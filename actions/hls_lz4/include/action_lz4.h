@@ -0,0 +1,88 @@
+#ifndef __ACTION_LZ4_H__
+#define __ACTION_LZ4_H__
+
+/*
+ * Copyright 2017 International Business Machines
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <snap_types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LZ4_ACTION_TYPE 0x10141007
+
+/* lz4_job.mode */
+#define LZ4_COMPRESS		0x0
+#define LZ4_DECOMPRESS		0x1
+
+/* lz4_job.flags */
+#define LZ4_FLAG_INDEPENDENT	0x00000001 /* compress: no match across blocks */
+#define LZ4_FLAG_BLOCK_CHECKSUM	0x00000002 /* decompress: skip block checksums */
+
+#define LZ4_BLOCK_SIZE		(64 * 1024)	/* compressed blocks, frame BD 0x40 */
+#define LZ4_DICT_SIZE		(64 * 1024)	/* history matches reach back to */
+#define LZ4_BLOCK_RAW		0x80000000	/* block header: stored uncompressed */
+
+/* out.size which never fails compressing size bytes */
+#define LZ4_COMPRESS_BOUND(size) \
+	((size) + 4 * (((size) + LZ4_BLOCK_SIZE - 1) / LZ4_BLOCK_SIZE) + 64)
+
+/*
+ * LZ4 compression and decompression of the data blocks of an LZ4 frame.
+ * The frame header, end mark and content checksum are left to the host,
+ * see sw/snap_lz4.c.
+ *
+ * LZ4_COMPRESS cuts the data at in into blocks of LZ4_BLOCK_SIZE bytes
+ * and writes them to out the way the frame format stores them: a 4
+ * byte little endian block size followed by the block, or by the plain
+ * data with LZ4_BLOCK_RAW set if the block does not get smaller.
+ * Matches reach into the preceding blocks and into dict, unless
+ * LZ4_FLAG_INDEPENDENT is set.
+ *
+ * LZ4_DECOMPRESS reads such blocks from in until the end mark (block
+ * size 0) or the end of in and writes the data to out. Blocks may be
+ * of any size, e.g. the 4 MiB blocks of the lz4 tool. With
+ * LZ4_FLAG_BLOCK_CHECKSUM every block is followed by a 4 byte
+ * checksum, it is skipped.
+ *
+ * dict is the data preceding the job, so a stream can be split into
+ * jobs without losing matches across them: the data compressed, or
+ * decompressed, by the jobs before. Only its last LZ4_DICT_SIZE
+ * bytes are used. dict.size is 0 for the first job of a frame and
+ * for independent blocks.
+ *
+ * in and dict can have any alignment. out must be 64 byte aligned and
+ * have room for out.size rounded up to 64 bytes, the last bus word is
+ * written in full. out_size returns the bytes written, blocks the
+ * number of blocks.
+ */
+typedef struct lz4_job {
+	struct snap_addr in;	/* in:  data or blocks */
+	struct snap_addr out;	/* in:  blocks or data */
+	struct snap_addr dict;	/* in:  data preceding in, up to 64 KiB */
+	uint32_t mode;		/* in:  LZ4_COMPRESS or LZ4_DECOMPRESS */
+	uint32_t flags;		/* in:  LZ4_FLAG_* */
+	uint64_t out_size;	/* out: bytes written to out */
+	uint32_t blocks;	/* out: blocks written or read */
+	uint32_t reserved;
+} lz4_job_t;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif	/* __ACTION_LZ4_H__ */
@@ -0,0 +1,415 @@
+/*
+ * Copyright 2017 International Business Machines
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Software version of the LZ4 action, see include/action_lz4.h.
+ *
+ * The same greedy block compressor as hw/hls_lz4.cpp with the same
+ * hash table, so both produce the same blocks for the same job.
+ * Host and card DRAM are supported, card DRAM is the emulated one of
+ * libsnap.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <libsnap.h>
+
+#include <snap_internal.h>
+#include <snap_tools.h>
+#include <action_lz4.h>
+
+#define LZ4_MINMATCH		4
+#define LZ4_LASTLITERALS	5
+#define LZ4_MFLIMIT		12
+#define LZ4_MAX_DISTANCE	65535
+#define LZ4_HASH_LOG		12
+#define LZ4_SKIP_TRIGGER	6
+
+static struct snap_card *lz4_card;	/* for the emulated card DRAM */
+
+static int mmio_write32(struct snap_card *card,
+			uint64_t offs, uint32_t data)
+{
+	act_trace("  %s(%p, %llx, %x)\n", __func__, card,
+		  (long long)offs, data);
+	lz4_card = card;
+	return 0;
+}
+
+static int mmio_read32(struct snap_card *card,
+		       uint64_t offs, uint32_t *data)
+{
+	act_trace("  %s(%p, %llx, %x)\n", __func__, card,
+		  (long long)offs, *data);
+	lz4_card = card;
+	return 0;
+}
+
+/* Memory behind a job address, NULL if it cannot be reached */
+static uint8_t *lz4_mem(const struct snap_addr *a)
+{
+	switch (a->type) {
+	case SNAP_ADDRTYPE_HOST_DRAM:
+		return (uint8_t *)(unsigned long)a->addr;
+	case SNAP_ADDRTYPE_CARD_DRAM:
+		if (lz4_card == NULL)
+			return NULL;
+		return snap_card_ddr_emu(lz4_card, a->addr, a->size);
+	default:
+		return NULL;
+	}
+}
+
+static inline uint32_t lz4_read32(const uint8_t *p)
+{
+	return (uint32_t)p[0] | (uint32_t)p[1] << 8 |
+		(uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static inline void lz4_write32(uint8_t *p, uint32_t v)
+{
+	p[0] = v;
+	p[1] = v >> 8;
+	p[2] = v >> 16;
+	p[3] = v >> 24;
+}
+
+static inline uint32_t lz4_hash(uint32_t seq)
+{
+	return (seq * 2654435761U) >> (32 - LZ4_HASH_LOG);
+}
+
+static uint8_t *lz4_put_ext(uint8_t *op, uint32_t rem)
+{
+	for (; rem >= 255; rem -= 255)
+		*op++ = 255;
+	*op++ = rem;
+	return op;
+}
+
+static uint8_t *lz4_put_seq(uint8_t *op, const uint8_t *anchor,
+			    uint32_t lit, uint32_t offset, uint32_t mlen)
+{
+	uint8_t *token = op++;
+
+	*token = MIN(lit, 15U) << 4;
+	if (lit >= 15)
+		op = lz4_put_ext(op, lit - 15);
+	memcpy(op, anchor, lit);
+	op += lit;
+	if (mlen == 0)
+		return op;
+
+	*token |= MIN(mlen - LZ4_MINMATCH, 15U);
+	*op++ = offset;
+	*op++ = offset >> 8;
+	if (mlen - LZ4_MINMATCH >= 15)
+		op = lz4_put_ext(op, mlen - LZ4_MINMATCH - 15);
+	return op;
+}
+
+/*
+ * Compress bsize bytes at bstart of buf into dst, matches may start
+ * at low. Returns the compressed size, 0 if that is not below bsize.
+ */
+static uint32_t lz4_compress_block(const uint8_t *buf, uint64_t *htab,
+				   uint64_t bstart, uint32_t bsize,
+				   uint64_t low, uint8_t *dst)
+{
+	uint64_t end = bstart + bsize, p = bstart, anchor = bstart;
+	uint32_t op = 0, lit, miss = 1 << LZ4_SKIP_TRIGGER;
+
+	if (bsize > LZ4_MFLIMIT) {
+		uint64_t mflimit = end - LZ4_MFLIMIT;
+		uint64_t mlimit = end - LZ4_LASTLITERALS;
+
+		while (p <= mflimit) {
+			uint32_t seq = lz4_read32(buf + p);
+			uint32_t h = lz4_hash(seq);
+			uint64_t c = htab[h], cand = c - 1;
+			uint32_t mlen = LZ4_MINMATCH;
+
+			htab[h] = p + 1;
+			if (c == 0 || cand < low ||
+			    p - cand > LZ4_MAX_DISTANCE ||
+			    lz4_read32(buf + cand) != seq) {
+				p += miss++ >> LZ4_SKIP_TRIGGER;
+				continue;
+			}
+			while (p + mlen < mlimit &&
+			       buf[p + mlen] == buf[cand + mlen])
+				mlen++;
+
+			lit = p - anchor;
+			if (op + lit + lit / 255 + mlen / 255 + 8 >= bsize)
+				return 0;
+			op = lz4_put_seq(dst + op, buf + anchor, lit, p - cand,
+					 mlen) - dst;
+			p += mlen;
+			anchor = p;
+			miss = 1 << LZ4_SKIP_TRIGGER;
+		}
+	}
+
+	lit = end - anchor;
+	if (op + lit + lit / 255 + 2 >= bsize)
+		return 0;
+	return lz4_put_seq(dst + op, buf + anchor, lit, 0, 0) - dst;
+}
+
+static int lz4_compress(struct lz4_job *js, const uint8_t *in,
+			uint8_t *out, const uint8_t *dict, uint64_t dsize)
+{
+	uint64_t *htab;
+	uint8_t *buf, *blk;
+	uint64_t pos, left = js->in.size, low = 0, total = 0;
+	uint32_t bsize, csize;
+	int rc = 0;
+
+	buf = malloc(dsize + js->in.size + 1);
+	blk = malloc(LZ4_BLOCK_SIZE + 64);
+	htab = calloc(1 << LZ4_HASH_LOG, sizeof(*htab));
+	if (buf == NULL || blk == NULL || htab == NULL) {
+		rc = -1;
+		goto out;
+	}
+
+	/* the end of the dict goes first into the table */
+	memcpy(buf, dict, dsize);
+	memcpy(buf + dsize, in, js->in.size);
+	for (pos = 0; pos + LZ4_MINMATCH <= dsize; pos++)
+		htab[lz4_hash(lz4_read32(buf + pos))] = pos + 1;
+	pos = dsize;
+
+	while (left != 0) {
+		bsize = MIN(left, (uint64_t)LZ4_BLOCK_SIZE);
+		if (js->flags & LZ4_FLAG_INDEPENDENT)
+			low = pos;
+
+		csize = lz4_compress_block(buf, htab, pos, bsize, low, blk);
+		if (total + 4 + (csize ? csize : bsize) > js->out.size) {
+			rc = -1;
+			break;
+		}
+		if (csize) {
+			lz4_write32(out + total, csize);
+			memcpy(out + total + 4, blk, csize);
+		} else {
+			lz4_write32(out + total, bsize | LZ4_BLOCK_RAW);
+			memcpy(out + total + 4, buf + pos, bsize);
+		}
+		total += 4 + (csize ? csize : bsize);
+		pos += bsize;
+		left -= bsize;
+		js->blocks++;
+	}
+	js->out_size = total;
+ out:
+	free(htab);
+	free(blk);
+	free(buf);
+	return rc;
+}
+
+/* Length extension bytes, -1 if the block ends within them */
+static int64_t lz4_get_ext(const uint8_t **ip, const uint8_t *iend,
+			   uint32_t len)
+{
+	uint8_t b;
+
+	do {
+		if (*ip == iend)
+			return -1;
+		b = *(*ip)++;
+		len += b;
+	} while (b == 255);
+	return len;
+}
+
+/*
+ * Decompress the block at ip of bsize bytes to hist at pos, hist
+ * ending at hend. The bytes before pos are the data seen before.
+ */
+static int lz4_decompress_block(const uint8_t *ip, uint32_t bsize,
+				uint8_t *hist, uint64_t *pos, uint64_t hend)
+{
+	const uint8_t *iend = ip + bsize;
+	uint64_t op = *pos;
+	int64_t lit, mlen;
+	uint32_t offset;
+	uint8_t token;
+
+	while (ip != iend) {
+		token = *ip++;
+		lit = token >> 4;
+		if (lit == 15)
+			lit = lz4_get_ext(&ip, iend, lit);
+		if (lit < 0 || lit > iend - ip || op + lit > hend)
+			return -1;
+		memcpy(hist + op, ip, lit);
+		ip += lit;
+		op += lit;
+		if (ip == iend)
+			break;		/* the last sequence has no match */
+
+		if (iend - ip < 2)
+			return -1;
+		offset = ip[0] | ip[1] << 8;
+		ip += 2;
+		if (offset == 0 || offset > op)
+			return -1;
+		mlen = token & 15;
+		if (mlen == 15)
+			mlen = lz4_get_ext(&ip, iend, mlen);
+		if (mlen < 0 || op + mlen + LZ4_MINMATCH > hend)
+			return -1;
+		/* byte by byte, a close match repeats what it writes */
+		for (mlen += LZ4_MINMATCH; mlen != 0; mlen--, op++)
+			hist[op] = hist[op - offset];
+	}
+	*pos = op;
+	return 0;
+}
+
+static int lz4_decompress(struct lz4_job *js, const uint8_t *in,
+			  uint8_t *out, const uint8_t *dict, uint64_t dsize)
+{
+	const uint8_t *ip = in, *iend = in + js->in.size;
+	uint64_t hend = dsize + js->out.size, pos = dsize;
+	uint32_t hdr, bsize;
+	uint8_t *hist;
+	int rc = 0;
+
+	hist = malloc(hend + 1);
+	if (hist == NULL)
+		return -1;
+	memcpy(hist, dict, dsize);
+
+	while (ip != iend && rc == 0) {
+		if (iend - ip < 4) {
+			rc = -1;
+			break;
+		}
+		hdr = lz4_read32(ip);
+		ip += 4;
+		if (hdr == 0)
+			break;		/* end mark */
+		bsize = hdr & ~LZ4_BLOCK_RAW;
+		if (bsize > iend - ip) {
+			rc = -1;
+			break;
+		}
+
+		if (hdr & LZ4_BLOCK_RAW) {
+			if (pos + bsize > hend)
+				rc = -1;
+			else {
+				memcpy(hist + pos, ip, bsize);
+				pos += bsize;
+			}
+		} else
+			rc = lz4_decompress_block(ip, bsize, hist, &pos, hend);
+		ip += bsize;
+
+		if (js->flags & LZ4_FLAG_BLOCK_CHECKSUM) {
+			if (iend - ip < 4)
+				rc = -1;
+			else	ip += 4;
+		}
+		js->blocks++;
+	}
+	js->out_size = pos - dsize;
+	memcpy(out, hist + dsize, pos - dsize);
+	free(hist);
+	return rc;
+}
+
+static int action_main(struct snap_sim_action *action,
+		       void *job, unsigned int job_len)
+{
+	struct lz4_job *js = (struct lz4_job *)job;
+	uint8_t *in, *out, *dict = NULL;
+	uint64_t dsize = MIN(js->dict.size, (uint64_t)LZ4_DICT_SIZE);
+	int rc;
+
+	act_trace("%s(%p, %p, %d) mode=%d flags=%x in=%lld out=%lld "
+		  "dict=%lld\n", __func__, action, job, job_len, js->mode,
+		  js->flags, (long long)js->in.size, (long long)js->out.size,
+		  (long long)js->dict.size);
+
+	js->out_size = 0;
+	js->blocks = 0;
+	in = lz4_mem(&js->in);
+	out = lz4_mem(&js->out);
+	if (dsize != 0) {
+		dict = lz4_mem(&js->dict);
+		if (dict != NULL)
+			dict += js->dict.size - dsize;
+	}
+	if (in == NULL || out == NULL || (dsize != 0 && dict == NULL)) {
+		act_trace("  err: memory type not supported\n");
+		goto out_err;
+	}
+
+	switch (js->mode) {
+	case LZ4_COMPRESS:
+		rc = lz4_compress(js, in, out, dict, dsize);
+		break;
+	case LZ4_DECOMPRESS:
+		rc = lz4_decompress(js, in, out, dict, dsize);
+		break;
+	default:
+		rc = -1;
+		break;
+	}
+	action->perf.rd_bytes = js->in.size + dsize;
+	action->perf.wr_bytes = js->out_size;
+	if (rc != 0)
+		goto out_err;
+
+	action->job.retc = SNAP_RETC_SUCCESS;
+	return 0;
+
+ out_err:
+	action->job.retc = SNAP_RETC_FAILURE;
+	return 0;
+}
+
+static struct snap_sim_action action = {
+	.vendor_id = SNAP_VENDOR_ID_ANY,
+	.device_id = SNAP_DEVICE_ID_ANY,
+	.action_type = LZ4_ACTION_TYPE,
+
+	.job = { .retc = SNAP_RETC_FAILURE, },
+	.state = ACTION_IDLE,
+	.main = action_main,
+	.priv_data = NULL,	/* this is passed back as void *card */
+	.mmio_write32 = mmio_write32,
+	.mmio_read32 = mmio_read32,
+
+	.next = NULL,
+};
+
+static void _init(void) __attribute__((constructor));
+
+static void _init(void)
+{
+	snap_action_register(&action);
+}
@@ -0,0 +1,489 @@
+/*
+ * Copyright 2017 International Business Machines
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * LZ4 frame compression and decompression with the LZ4 action.
+ *
+ * The action does the blocks, this tool the frame around them: magic,
+ * frame descriptor, end mark and content checksum, see the LZ4 frame
+ * format description of the lz4 project. Files written can be read by
+ * "lz4 -d", files of "lz4" can be read, including 4 MiB blocks and
+ * block checksums. Dictionary IDs are not supported.
+ *
+ * The file is handed to the action in chunks of -B bytes. Each job
+ * gets the last 64 KiB before its chunk as dict, so matches reach
+ * across chunks unless the blocks are independent.
+ */
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <malloc.h>
+#include <errno.h>
+#include <string.h>
+#include <sys/time.h>
+#include <assert.h>
+
+#include <snap_tools.h>
+#include <action_lz4.h>
+#include <libsnap.h>
+#include <snap_hls_if.h>
+
+#include "xxh32.h"
+
+#define LZ4_MAGIC		0x184D2204
+#define LZ4_FLG_VERSION		0x40
+#define LZ4_FLG_INDEPENDENT	0x20
+#define LZ4_FLG_BLOCK_CHECKSUM	0x10
+#define LZ4_FLG_CONTENT_SIZE	0x08
+#define LZ4_FLG_CONTENT_CHECKSUM 0x04
+#define LZ4_FLG_DICT_ID		0x01
+#define LZ4_BD_64KB		0x40
+
+#define CHUNK_SIZE		(4 * 1024 * 1024)
+
+int verbose_flag = 0;
+
+static const char *version = GIT_VERSION;
+
+struct lz4_tool {
+	struct snap_action *action;
+	unsigned long timeout;
+	uint32_t flags;			/* LZ4_FLAG_* of the jobs */
+	unsigned int jobs;
+	struct snap_action_perf perf;	/* summed up over the jobs */
+};
+
+/**
+ * @brief	prints valid command line options
+ *
+ * @param prog	current program's name
+ */
+static void usage(const char *prog)
+{
+	printf("Usage: %s [-h] [-v, --verbose] [-V, --version]\n"
+	       "  -C, --card <cardno>       can be (0...3)\n"
+	       "  -i, --input <file>        input file.\n"
+	       "  -o, --output <file>       output file.\n"
+	       "  -d, --decompress          decompress, default is compress.\n"
+	       "  -B, --chunk <size>        bytes per job, multiple of 64 KiB\n"
+	       "                            (4 MiB default).\n"
+	       "  -I, --independent         compress blocks independently.\n"
+	       "  -t, --timeout             Timeout in sec to wait for done. (10 sec default)\n"
+	       "\n"
+	       "Example:\n"
+	       "  snap_lz4 -i file -o file.lz4\n"
+	       "  snap_lz4 -d -i file.lz4 -o file\n"
+	       "\n",
+	       prog);
+}
+
+static inline uint32_t get32(const uint8_t *p)
+{
+	return (uint32_t)p[0] | (uint32_t)p[1] << 8 |
+		(uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static inline void put32(uint8_t *p, uint32_t v)
+{
+	p[0] = v;
+	p[1] = v >> 8;
+	p[2] = v >> 16;
+	p[3] = v >> 24;
+}
+
+/* Run one job, dict being the dsize bytes before in */
+static int lz4_job(struct lz4_tool *t, uint32_t mode,
+		   const uint8_t *in, uint64_t in_size,
+		   uint8_t *out, uint64_t out_size,
+		   const uint8_t *dict, uint64_t dsize,
+		   uint64_t *written)
+{
+	struct snap_job cjob;
+	struct lz4_job job;
+	struct snap_action_perf perf;
+	int rc;
+
+	assert(sizeof(job) <= SNAP_JOBSIZE);
+	memset(&job, 0, sizeof(job));
+	snap_addr_set(&job.in, in, in_size, SNAP_ADDRTYPE_HOST_DRAM,
+		      SNAP_ADDRFLAG_ADDR | SNAP_ADDRFLAG_SRC);
+	snap_addr_set(&job.out, out, out_size, SNAP_ADDRTYPE_HOST_DRAM,
+		      SNAP_ADDRFLAG_ADDR | SNAP_ADDRFLAG_DST);
+	snap_addr_set(&job.dict, dict, dsize, SNAP_ADDRTYPE_HOST_DRAM,
+		      SNAP_ADDRFLAG_ADDR | SNAP_ADDRFLAG_SRC |
+		      SNAP_ADDRFLAG_END);
+	job.mode = mode;
+	job.flags = t->flags;
+	snap_job_set(&cjob, &job, sizeof(job), NULL, 0);
+
+	rc = snap_action_sync_execute_job(t->action, &cjob, t->timeout);
+	if (rc != 0) {
+		fprintf(stderr, "err: job execution %d: %s!\n", rc,
+			strerror(errno));
+		return -1;
+	}
+	if (cjob.retc != SNAP_RETC_SUCCESS) {
+		fprintf(stderr, "err: Unexpected RETC=%x!\n", cjob.retc);
+		return -1;
+	}
+	if (snap_action_perf(t->action, &perf) == 0) {
+		t->perf.cycles += perf.cycles;
+		t->perf.rd_bytes += perf.rd_bytes;
+		t->perf.wr_bytes += perf.wr_bytes;
+		t->perf.rd_stall += perf.rd_stall;
+		t->perf.wr_stall += perf.wr_stall;
+	}
+	t->jobs++;
+	*written = job.out_size;
+	return 0;
+}
+
+static int lz4_compress_file(struct lz4_tool *t, const uint8_t *in,
+			     uint64_t size, uint64_t chunk, FILE *fp)
+{
+	uint64_t bound = LZ4_COMPRESS_BOUND(chunk);
+	uint64_t off, n, dsize, written;
+	uint8_t hdr[7], tail[8];
+	uint8_t *cbuf;
+	int rc = 0;
+
+	cbuf = snap_malloc(bound);
+	if (cbuf == NULL)
+		return -1;
+
+	put32(hdr, LZ4_MAGIC);
+	hdr[4] = LZ4_FLG_VERSION | LZ4_FLG_CONTENT_CHECKSUM;
+	if (t->flags & LZ4_FLAG_INDEPENDENT)
+		hdr[4] |= LZ4_FLG_INDEPENDENT;
+	hdr[5] = LZ4_BD_64KB;
+	hdr[6] = xxh32(hdr + 4, 2, 0) >> 8;
+	if (fwrite(hdr, sizeof(hdr), 1, fp) != 1)
+		goto out_err;
+
+	for (off = 0; off < size; off += n) {
+		n = MIN(size - off, chunk);
+		dsize = (t->flags & LZ4_FLAG_INDEPENDENT) ? 0 :
+			MIN(off, (uint64_t)LZ4_DICT_SIZE);
+		if (lz4_job(t, LZ4_COMPRESS, in + off, n, cbuf, bound,
+			    in + off - dsize, dsize, &written) != 0)
+			goto out_err;
+		if (fwrite(cbuf, written, 1, fp) != 1)
+			goto out_err;
+	}
+
+	put32(tail, 0);			/* end mark */
+	put32(tail + 4, xxh32(in, size, 0));
+	if (fwrite(tail, sizeof(tail), 1, fp) != 1)
+		goto out_err;
+
+ out:
+	__free(cbuf);
+	return rc;
+ out_err:
+	rc = -1;
+	goto out;
+}
+
+static int lz4_decompress_file(struct lz4_tool *t, const uint8_t *in,
+			       uint64_t size, uint64_t chunk, FILE *fp)
+{
+	const uint8_t *ip = in, *iend = in + size, *job_in;
+	uint8_t *out = NULL, *obuf = NULL, *p;
+	uint64_t total = 0, alloc = 0, bmax, content_size = 0;
+	uint64_t dsize, written, job_max;
+	uint32_t hdr, bsize, csum = 0;
+	unsigned int nblocks, bd, i;
+	uint8_t flg;
+	int rc = 0;
+
+	if (size < 7 || get32(ip) != LZ4_MAGIC) {
+		fprintf(stderr, "err: no LZ4 frame\n");
+		return -1;
+	}
+	flg = ip[4];
+	bd = ip[5];
+	i = 6;
+	if ((flg & 0xc0) != LZ4_FLG_VERSION || (flg & 0x02) ||
+	    (bd & 0x8f) || ((bd >> 4) & 7) < 4) {
+		fprintf(stderr, "err: unknown LZ4 frame descriptor "
+			"%02x %02x\n", flg, bd);
+		return -1;
+	}
+	if (flg & LZ4_FLG_DICT_ID) {
+		fprintf(stderr, "err: dictionary IDs are not supported\n");
+		return -1;
+	}
+	if (flg & LZ4_FLG_CONTENT_SIZE) {
+		if (size < 15)
+			return -1;
+		content_size = get32(ip + 6) | (uint64_t)get32(ip + 10) << 32;
+		i += 8;
+	}
+	if (ip[i] != ((xxh32(ip + 4, i - 4, 0) >> 8) & 0xff)) {
+		fprintf(stderr, "err: LZ4 header checksum mismatch\n");
+		return -1;
+	}
+	ip += i + 1;
+	bmax = 1ull << (8 + 2 * ((bd >> 4) & 7));	/* 64 KiB .. 4 MiB */
+	if (flg & LZ4_FLG_BLOCK_CHECKSUM)
+		t->flags |= LZ4_FLAG_BLOCK_CHECKSUM;
+
+	job_max = MAX(chunk / bmax, 1ull) * bmax;
+	obuf = snap_malloc(job_max);
+	if (obuf == NULL)
+		return -1;
+
+	/* hand as many blocks to a job as its output can take */
+	while (1) {
+		job_in = ip;
+		for (nblocks = 0; (nblocks + 1) * bmax <= job_max; nblocks++) {
+			if (iend - ip < 4)
+				goto out_err;
+			hdr = get32(ip);
+			if (hdr == 0)
+				break;
+			bsize = hdr & ~LZ4_BLOCK_RAW;
+			if (bsize > bmax || bsize > iend - ip - 4)
+				goto out_err;
+			p = (uint8_t *)ip + 4;
+			ip += 4 + bsize;
+			if (flg & LZ4_FLG_BLOCK_CHECKSUM) {
+				if (iend - ip < 4 ||
+				    get32(ip) != xxh32(p, bsize, 0)) {
+					fprintf(stderr, "err: LZ4 block "
+						"checksum mismatch\n");
+					goto out_err;
+				}
+				ip += 4;
+			}
+		}
+		if (nblocks == 0)
+			break;
+
+		dsize = (flg & LZ4_FLG_INDEPENDENT) ? 0 :
+			MIN(total, (uint64_t)LZ4_DICT_SIZE);
+		if (lz4_job(t, LZ4_DECOMPRESS, job_in, ip - job_in, obuf,
+			    nblocks * bmax, out + total - dsize, dsize,
+			    &written) != 0)
+			goto out_err;
+
+		if (total + written > alloc) {
+			alloc = MAX(2 * alloc, total + written);
+			p = realloc(out, alloc);
+			if (p == NULL)
+				goto out_err;
+			out = p;
+		}
+		memcpy(out + total, obuf, written);
+		total += written;
+	}
+	ip += 4;			/* end mark */
+
+	if (flg & LZ4_FLG_CONTENT_CHECKSUM) {
+		if (iend - ip < 4)
+			goto out_err;
+		csum = get32(ip);
+		ip += 4;
+		if (csum != xxh32(out, total, 0)) {
+			fprintf(stderr, "err: LZ4 content checksum mismatch\n");
+			goto out_err;
+		}
+	}
+	if ((flg & LZ4_FLG_CONTENT_SIZE) && content_size != total) {
+		fprintf(stderr, "err: LZ4 content size mismatch\n");
+		goto out_err;
+	}
+	if (ip != iend)
+		fprintf(stderr, "warn: %lld bytes after the LZ4 frame "
+			"ignored\n", (long long)(iend - ip));
+	if (total != 0 && fwrite(out, total, 1, fp) != 1)
+		goto out_err;
+
+ out:
+	__free(obuf);
+	free(out);
+	return rc;
+ out_err:
+	fprintf(stderr, "err: LZ4 frame broken at byte %lld\n",
+		(long long)(ip - in));
+	rc = -1;
+	goto out;
+}
+
+int main(int argc, char *argv[])
+{
+	int ch, rc = 0;
+	int card_no = 0;
+	struct snap_card *card = NULL;
+	struct lz4_tool t;
+	char device[128];
+	const char *input = NULL;
+	const char *output = NULL;
+	int decompress = 0;
+	uint64_t chunk = CHUNK_SIZE;
+	struct timeval etime, stime;
+	ssize_t size;
+	uint8_t *ibuff = NULL;
+	FILE *fp = NULL;
+	long long usec;
+
+	memset(&t, 0, sizeof(t));
+	t.timeout = 10;
+
+	while (1) {
+		int option_index = 0;
+		static struct option long_options[] = {
+			{ "card",	 required_argument, NULL, 'C' },
+			{ "input",	 required_argument, NULL, 'i' },
+			{ "output",	 required_argument, NULL, 'o' },
+			{ "decompress",	 no_argument,	    NULL, 'd' },
+			{ "chunk",	 required_argument, NULL, 'B' },
+			{ "independent", no_argument,	    NULL, 'I' },
+			{ "timeout",	 required_argument, NULL, 't' },
+			{ "version",	 no_argument,	    NULL, 'V' },
+			{ "verbose",	 no_argument,	    NULL, 'v' },
+			{ "help",	 no_argument,	    NULL, 'h' },
+			{ 0,		 no_argument,	    NULL, 0   },
+		};
+
+		ch = getopt_long(argc, argv, "C:i:o:dB:It:Vvh",
+				 long_options, &option_index);
+		if (ch == -1)
+			break;
+
+		switch (ch) {
+		case 'C':
+			card_no = strtol(optarg, (char **)NULL, 0);
+			break;
+		case 'i':
+			input = optarg;
+			break;
+		case 'o':
+			output = optarg;
+			break;
+		case 'd':
+			decompress = 1;
+			break;
+		case 'B':
+			chunk = __str_to_num(optarg);
+			break;
+		case 'I':
+			t.flags |= LZ4_FLAG_INDEPENDENT;
+			break;
+		case 't':
+			t.timeout = strtol(optarg, (char **)NULL, 0);
+			break;
+			/* service */
+		case 'V':
+			printf("%s\n", version);
+			exit(EXIT_SUCCESS);
+		case 'v':
+			verbose_flag = 1;
+			break;
+		case 'h':
+			usage(argv[0]);
+			exit(EXIT_SUCCESS);
+			break;
+		default:
+			usage(argv[0]);
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	if (optind != argc || input == NULL || output == NULL ||
+	    chunk == 0 || chunk % LZ4_BLOCK_SIZE) {
+		usage(argv[0]);
+		exit(EXIT_FAILURE);
+	}
+
+	size = __file_size(input);
+	if (size < 0)
+		goto out_error;
+	ibuff = snap_malloc(size + 1);
+	if (ibuff == NULL)
+		goto out_error;
+	if (size != 0 && __file_read(input, ibuff, size) < 0)
+		goto out_error;
+
+	fp = fopen(output, "w");
+	if (fp == NULL) {
+		fprintf(stderr, "err: cannot open %s: %s\n", output,
+			strerror(errno));
+		goto out_error;
+	}
+
+	snprintf(device, sizeof(device)-1, "/dev/cxl/afu%d.0s", card_no);
+	card = snap_card_alloc_dev(device, SNAP_VENDOR_ID_IBM,
+				   SNAP_DEVICE_ID_SNAP);
+	if (card == NULL) {
+		fprintf(stderr, "err: failed to open card %u: %s\n",
+			card_no, strerror(errno));
+		goto out_error;
+	}
+
+	t.action = snap_attach_action(card, LZ4_ACTION_TYPE, 0, 60);
+	if (t.action == NULL) {
+		fprintf(stderr, "err: failed to attach action %u: %s\n",
+			card_no, strerror(errno));
+		goto out_error1;
+	}
+
+	gettimeofday(&stime, NULL);
+	if (decompress)
+		rc = lz4_decompress_file(&t, ibuff, size, chunk, fp);
+	else
+		rc = lz4_compress_file(&t, ibuff, size, chunk, fp);
+	gettimeofday(&etime, NULL);
+	if (rc != 0)
+		goto out_error2;
+	if (fclose(fp) != 0) {
+		fp = NULL;
+		goto out_error2;
+	}
+	fp = NULL;
+
+	usec = timediff_usec(&etime, &stime);
+	fprintf(stdout, "%s %lld bytes in %u jobs took %lld usec\n",
+		decompress ? "decompress" : "compress", (long long)size,
+		t.jobs, usec);
+	if (verbose_flag)
+		fprintf(stdout, "cycles %lld read %lld bytes written %lld "
+			"bytes stalls read %lld write %lld\n",
+			(long long)t.perf.cycles,
+			(long long)t.perf.rd_bytes,
+			(long long)t.perf.wr_bytes,
+			(long long)t.perf.rd_stall,
+			(long long)t.perf.wr_stall);
+
+	snap_detach_action(t.action);
+	snap_card_free(card);
+	__free(ibuff);
+	exit(EXIT_SUCCESS);
+
+ out_error2:
+	snap_detach_action(t.action);
+ out_error1:
+	snap_card_free(card);
+ out_error:
+	if (fp != NULL)
+		fclose(fp);
+	__free(ibuff);
+	exit(EXIT_FAILURE);
+}
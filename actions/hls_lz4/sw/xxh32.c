@@ -0,0 +1,135 @@
+/*
+ * Copyright 2017 International Business Machines
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * XXH32 after the description of the xxHash library by Yann Collet
+ * (BSD 2-Clause): four accumulators take 16 byte stripes, the rest is
+ * mixed in 4 and 1 bytes at a time.
+ */
+
+#include <string.h>
+
+#include "xxh32.h"
+
+#define XXH_PRIME32_1	0x9E3779B1U
+#define XXH_PRIME32_2	0x85EBCA77U
+#define XXH_PRIME32_3	0xC2B2AE3DU
+#define XXH_PRIME32_4	0x27D4EB2FU
+#define XXH_PRIME32_5	0x165667B1U
+
+static inline uint32_t xxh_rotl32(uint32_t x, int r)
+{
+	return (x << r) | (x >> (32 - r));
+}
+
+static inline uint32_t xxh_read32(const uint8_t *p)
+{
+	return (uint32_t)p[0] | (uint32_t)p[1] << 8 |
+		(uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static inline uint32_t xxh32_round(uint32_t acc, uint32_t input)
+{
+	acc += input * XXH_PRIME32_2;
+	acc = xxh_rotl32(acc, 13);
+	return acc * XXH_PRIME32_1;
+}
+
+/* Full stripes of p into acc, returns the bytes taken */
+static size_t xxh32_stripes(uint32_t *acc, const uint8_t *p, size_t len)
+{
+	size_t i;
+
+	for (i = 0; i + 16 <= len; i += 16) {
+		acc[0] = xxh32_round(acc[0], xxh_read32(p + i));
+		acc[1] = xxh32_round(acc[1], xxh_read32(p + i + 4));
+		acc[2] = xxh32_round(acc[2], xxh_read32(p + i + 8));
+		acc[3] = xxh32_round(acc[3], xxh_read32(p + i + 12));
+	}
+	return i;
+}
+
+void xxh32_init(struct xxh32_state *s, uint32_t seed)
+{
+	memset(s, 0, sizeof(*s));
+	s->seed = seed;
+	s->acc[0] = seed + XXH_PRIME32_1 + XXH_PRIME32_2;
+	s->acc[1] = seed + XXH_PRIME32_2;
+	s->acc[2] = seed;
+	s->acc[3] = seed - XXH_PRIME32_1;
+}
+
+void xxh32_update(struct xxh32_state *s, const void *buf, size_t len)
+{
+	const uint8_t *p = (const uint8_t *)buf;
+	size_t n;
+
+	s->total += len;
+	if (s->buf_len != 0) {
+		n = 16 - s->buf_len;
+		if (n > len)
+			n = len;
+		memcpy(s->buf + s->buf_len, p, n);
+		s->buf_len += n;
+		p += n;
+		len -= n;
+		if (s->buf_len < 16)
+			return;
+		xxh32_stripes(s->acc, s->buf, 16);
+		s->buf_len = 0;
+	}
+	n = xxh32_stripes(s->acc, p, len);
+	memcpy(s->buf, p + n, len - n);
+	s->buf_len = len - n;
+}
+
+uint32_t xxh32_final(const struct xxh32_state *s)
+{
+	const uint8_t *p = s->buf;
+	uint32_t h, i = 0;
+
+	if (s->total >= 16)
+		h = xxh_rotl32(s->acc[0], 1) + xxh_rotl32(s->acc[1], 7) +
+			xxh_rotl32(s->acc[2], 12) + xxh_rotl32(s->acc[3], 18);
+	else
+		h = s->seed + XXH_PRIME32_5;
+	h += (uint32_t)s->total;
+
+	for (; i + 4 <= s->buf_len; i += 4) {
+		h += xxh_read32(p + i) * XXH_PRIME32_3;
+		h = xxh_rotl32(h, 17) * XXH_PRIME32_4;
+	}
+	for (; i < s->buf_len; i++) {
+		h += p[i] * XXH_PRIME32_5;
+		h = xxh_rotl32(h, 11) * XXH_PRIME32_1;
+	}
+
+	h ^= h >> 15;
+	h *= XXH_PRIME32_2;
+	h ^= h >> 13;
+	h *= XXH_PRIME32_3;
+	h ^= h >> 16;
+	return h;
+}
+
+uint32_t xxh32(const void *buf, size_t len, uint32_t seed)
+{
+	struct xxh32_state s;
+
+	xxh32_init(&s, seed);
+	xxh32_update(&s, buf, len);
+	return xxh32_final(&s);
+}
@@ -0,0 +1,52 @@
+#ifndef __XXH32_H__
+#define __XXH32_H__
+
+/*
+ * Copyright 2017 International Business Machines
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * XXH32 hash, same results as XXH32() from the xxHash library. The
+ * LZ4 frame format uses it for its header, block and content
+ * checksums.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct xxh32_state {
+	uint32_t acc[4];
+	uint8_t buf[16];	/* bytes of an incomplete stripe */
+	uint32_t buf_len;
+	uint64_t total;
+	uint32_t seed;
+};
+
+uint32_t xxh32(const void *buf, size_t len, uint32_t seed);
+
+/* The same hash over data passed in pieces */
+void xxh32_init(struct xxh32_state *s, uint32_t seed);
+void xxh32_update(struct xxh32_state *s, const void *buf, size_t len);
+uint32_t xxh32_final(const struct xxh32_state *s);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif	/* __XXH32_H__ */
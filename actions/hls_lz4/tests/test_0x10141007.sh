@@ -0,0 +1,120 @@
+#!/bin/bash
+
+#
+# Copyright 2017 International Business Machines
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+
+verbose=0
+snap_card=0
+duration="NORMAL"
+
+function usage() {
+    echo "Usage:"
+    echo "  test_<action_type>.sh"
+    echo "    [-C <card>] card to be used for the test"
+    echo "    [-t <trace_level>]"
+    echo "    [-duration SHORT/NORMAL/LONG] run tests"
+    echo
+}
+
+while getopts ":C:t:d:h" opt; do
+    case $opt in
+	C)
+	snap_card=$OPTARG;
+	;;
+	t)
+	export SNAP_TRACE=$OPTARG;
+	;;
+	d)
+	duration=$OPTARG;
+	;;
+	h)
+	usage;
+	exit 0;
+	;;
+	\?)
+	echo "Invalid option: -$OPTARG" >&2
+	;;
+    esac
+done
+
+export PATH=$PATH:../software/tools
+
+snap_peek --help > /dev/null || exit 1;
+snap_poke --help > /dev/null || exit 1;
+
+#### VERSION ##########################################################
+
+if [ -z "$SNAP_CONFIG" ]; then
+	echo "CARD VERSION"
+	snap_peek -C ${snap_card} 0x0 || exit 1;
+	snap_peek -C ${snap_card} 0x8 || exit 1;
+	echo
+fi
+
+#### LZ4 ##############################################################
+
+export PATH=$PATH:./hls_lz4/sw
+
+function run() {
+    local name=$1; shift
+    echo -n "$name ... "
+    cmd="( $* ) > snap_lz4.log 2>&1"
+    eval ${cmd}
+    if [ $? -ne 0 ]; then
+	cat snap_lz4.log
+	echo "cmd: ${cmd}"
+	echo "failed"
+	exit 1
+    fi
+    echo "ok"
+}
+
+# text which compresses, data which does not, a long run and nothing
+if [ "$duration" = "SHORT" ]; then size=70000; else size=3000000; fi
+head -c $size /dev/urandom | od -An -tx1 > lz4_text.bin
+head -c $size /dev/urandom > lz4_rand.bin
+head -c $size /dev/zero > lz4_zero.bin
+: > lz4_empty.bin
+
+for f in lz4_text lz4_rand lz4_zero lz4_empty; do
+    for opts in "" "-I" "-B 128KiB"; do
+	run "Doing snap_lz4 $opts $f" \
+	    "snap_lz4 -C${snap_card} $opts -i $f.bin -o $f.lz4"
+	run "Doing snap_lz4 -d $f" \
+	    "snap_lz4 -C${snap_card} -d -B 128KiB -i $f.lz4 -o $f.out"
+	run "Check results" "cmp $f.bin $f.out"
+    done
+done
+
+# the frames must be understood by the reference tool and vice versa
+if which lz4 > /dev/null 2>&1; then
+    for f in lz4_text lz4_zero; do
+	run "Doing lz4 -d of snap_lz4 $f" \
+	    "snap_lz4 -C${snap_card} -i $f.bin -o $f.lz4 && lz4 -dqf $f.lz4 $f.out"
+	run "Check results" "cmp $f.bin $f.out"
+	for opts in "" "-BD" "-B4 -BX"; do
+	    run "Doing snap_lz4 -d of lz4 $opts $f" \
+		"lz4 -qf $opts $f.bin $f.lz4 && snap_lz4 -C${snap_card} -d -i $f.lz4 -o $f.out"
+	    run "Check results" "cmp $f.bin $f.out"
+	done
+    done
+else
+    echo "lz4 not found, skipping the cross checks"
+fi
+
+rm -f lz4_*.bin lz4_*.lz4 lz4_*.out snap_lz4.log
+echo "Test OK"
+exit 0
@@ -23,127 +23,33 @@
 /* ----------------------------------------------------------------------------
  * Known Limitations => Issue #39 & #45
  * => Transfers must be 64 byte aligned and a size of multiples of 64 bytes
- * Issue#320 - memcopy doesn't handle 4Kbytes xfer => use patch
+ * Issue#320 - 4Kbytes bursts are handled by hls_snap_dma.H
  * ----------------------------------------------------------------------------
  */
 
-// WRITE DATA TO MEMORY
-short write_burst_of_data_to_mem(snap_membus_t *dout_gmem,
-				 snap_membus_t *d_ddrmem,
-				 snapu16_t memory_type,
-				 snapu64_t output_address,
-				 snap_membus_t *buffer,
-				 snapu64_t size_in_bytes_to_transfer)
-{
-	short rc;
-	// Patch to Issue#320 - memcopy doesn't handle 4Kbytes xfer
-	int size_in_words;
-	if(size_in_bytes_to_transfer %BPERDW == 0)
-		size_in_words = size_in_bytes_to_transfer/BPERDW;
-	else
-		size_in_words = (size_in_bytes_to_transfer/BPERDW) + 1;
-
-	switch (memory_type) {
-	case SNAP_ADDRTYPE_HOST_DRAM:
-		// Patch to Issue#320 - memcopy doesn't handle 4Kbytes xfer
-		//memcpy((snap_membus_t  *) (dout_gmem + output_address),
-		//       buffer, size_in_bytes_to_transfer);
-		wb_dout_loop: for (int k=0; k<size_in_words; k++)
-#pragma HLS PIPELINE
-                    (dout_gmem + output_address)[k] = buffer[k];
-
-       		rc =  0;
-		break;
-	case SNAP_ADDRTYPE_CARD_DRAM:
-		// Patch to Issue#320 - memcopy doesn't handle 4Kbytes xfer
-		//memcpy((snap_membus_t  *) (d_ddrmem + output_address),
-		//       buffer, size_in_bytes_to_transfer);
-		wb_ddr_loop: for (int k=0; k<size_in_words; k++)
-#pragma HLS PIPELINE
-                    (d_ddrmem + output_address)[k] = buffer[k];
-
-       		rc =  0;
-		break;
-	default:
-		rc = 1;
-	}
-
-	return rc;
-}
-
-// READ DATA FROM MEMORY
-short read_burst_of_data_from_mem(snap_membus_t *din_gmem,
-				  snap_membus_t *d_ddrmem,
-				  snapu16_t memory_type,
-				  snapu64_t input_address,
-				  snap_membus_t *buffer,
-				  snapu64_t size_in_bytes_to_transfer)
-{
-	short rc;
-        int i;
-
-	// Patch to Issue#320 - memcopy doesn't handle 4Kbytes xfer
-	int size_in_words;
-	if(size_in_bytes_to_transfer %BPERDW == 0)
-		size_in_words = size_in_bytes_to_transfer/BPERDW;
-	else
-		size_in_words = (size_in_bytes_to_transfer/BPERDW) + 1;
-
-	switch (memory_type) {
-
-	case SNAP_ADDRTYPE_HOST_DRAM:
-		// Patch to Issue#320 - memcopy doesn't handle 4Kbytes xfer
-		//memcpy(buffer, (snap_membus_t  *) (din_gmem + input_address),
-		//       size_in_bytes_to_transfer);
-		rb_din_loop: for (int k=0; k<size_in_words; k++)
-#pragma HLS PIPELINE
-                    buffer[k] = (din_gmem + input_address)[k];
-
-       		rc =  0;
-		break;
-	case SNAP_ADDRTYPE_CARD_DRAM:
-		// Patch to Issue#320 - memcopy doesn't handle 4Kbytes xfer
-		//memcpy(buffer, (snap_membus_t  *) (d_ddrmem + input_address),
-		//       size_in_bytes_to_transfer);
-		rb_ddr_loop: for (int k=0; k<size_in_words; k++)
-#pragma HLS PIPELINE
-                    buffer[k] = (d_ddrmem + input_address)[k];
-
-       		rc =  0;
-		break;
-	default:
-		rc = 1;
-	}
-
-	return rc;
-}
-
 //----------------------------------------------------------------------
 //--- MAIN PROGRAM -----------------------------------------------------
 //----------------------------------------------------------------------
 static void process_action(snap_membus_t *din_gmem,
                            snap_membus_t *dout_gmem,
                            snap_membus_t *d_ddrmem,
-                           action_reg *act_reg)
+                           snap_membus_t *dout_ddrmem,
+                           snapu32_t *d_nvme,
+                           action_reg *act_reg,
+                           snap_perf_t *perf)
 {
 	// VARIABLES
 	snapu32_t xfer_size;
 	snapu32_t action_xfer_size;
-	snapu32_t nb_blocks_to_xfer;
-	snapu16_t i;
 	short rc = 0;
 	snapu32_t ReturnCode = SNAP_RETC_SUCCESS;
-	snapu64_t InputAddress;
 	snapu64_t OutputAddress;
-	snapu64_t address_xfer_offset;
-	snap_membus_t  buf_gmem[MAX_NB_OF_WORDS_READ];
-	// if 4096 bytes max => 64 words
+	snapu64_t staging;
+	nvme_stream_t nvme_in;
 
-	// byte address received need to be aligned with port width
-	InputAddress = (act_reg->Data.in.addr)   >> ADDR_RIGHT_SHIFT;
-	OutputAddress = (act_reg->Data.out.addr) >> ADDR_RIGHT_SHIFT;
+	snap_perf_clear(perf);
+	OutputAddress = act_reg->Data.out.addr;
 
-	address_xfer_offset = 0x0;
 	// testing sizes to prevent from writing out of bounds
 	action_xfer_size = MIN(act_reg->Data.in.size,
 			       act_reg->Data.out.size);
@@ -159,30 +65,42 @@ static void process_action(snap_membus_t *din_gmem,
 		return;
         }
 
-	// buffer size is hardware limited by MAX_NB_OF_BYTES_READ
-	if(action_xfer_size %MAX_NB_OF_BYTES_READ == 0)
-		nb_blocks_to_xfer = (action_xfer_size / MAX_NB_OF_BYTES_READ);
-	else
-		nb_blocks_to_xfer = (action_xfer_size / MAX_NB_OF_BYTES_READ) + 1;
+	// host and card DRAM sources are copied in one go
+	if (act_reg->Data.in.type != SNAP_ADDRTYPE_NVME) {
+		rc = snap_dma_copy(din_gmem, dout_gmem, d_ddrmem, dout_ddrmem,
+				   act_reg->Data.in.type, act_reg->Data.in.addr,
+				   act_reg->Data.out.type, OutputAddress,
+				   action_xfer_size, perf);
+		action_xfer_size = 0;
+	}
+	// NVMe data passes the staging area, which must stay untouched
+	else if (act_reg->Data.out.type == SNAP_ADDRTYPE_CARD_DRAM and
+		 act_reg->Data.out.addr + act_reg->Data.out.size >
+		 SNAP_NVME_STAGING_ADDR) {
+		act_reg->Control.Retc = SNAP_RETC_FAILURE;
+		return;
+	} else
+		nvme_stream_init(&nvme_in, d_nvme, act_reg->Data.in.addr,
+				 action_xfer_size,
+				 (act_reg->Data.in.flags & SNAP_ADDRFLAG_DRIVE1) != 0,
+				 MAX_NB_OF_BYTES_READ);
 
-	// transferring buffers one after the other
+	// NVMe: the next chunk is already read while we copy this one
 	L0:
-	for ( i = 0; i < nb_blocks_to_xfer; i++ ) {
-#pragma HLS UNROLL		// cannot completely unroll a loop with a variable trip count
-
+	while (action_xfer_size > 0) {
 		xfer_size = MIN(action_xfer_size,
 				(snapu32_t)MAX_NB_OF_BYTES_READ);
-
-		rc |= read_burst_of_data_from_mem(din_gmem, d_ddrmem,
-						  act_reg->Data.in.type,
-			InputAddress + address_xfer_offset, buf_gmem, xfer_size);
-
-		rc |= write_burst_of_data_to_mem(dout_gmem, d_ddrmem,
-						 act_reg->Data.out.type,
-			OutputAddress + address_xfer_offset, buf_gmem, xfer_size);
+		if (nvme_stream_next(&nvme_in, d_nvme, &staging) != xfer_size) {
+			rc = 1;
+			break;
+		}
+		rc |= snap_dma_copy(din_gmem, dout_gmem, d_ddrmem, dout_ddrmem,
+				    SNAP_ADDRTYPE_CARD_DRAM, staging,
+				    act_reg->Data.out.type, OutputAddress,
+				    xfer_size, perf);
 
 		action_xfer_size -= xfer_size;
-		address_xfer_offset += (snapu64_t)(xfer_size >> ADDR_RIGHT_SHIFT);
+		OutputAddress += xfer_size;
 	} // end of L0 loop
 
 	if (rc != 0)
@@ -196,23 +114,38 @@ static void process_action(snap_membus_t *din_gmem,
 void hls_action(snap_membus_t *din_gmem,
 		snap_membus_t *dout_gmem,
 		snap_membus_t *d_ddrmem,
+		snap_membus_t *dout_ddrmem,
+		snapu32_t *d_nvme,
 		action_reg *act_reg,
-		action_RO_config_reg *Action_Config)
+		action_RO_config_reg *Action_Config,
+		snap_perf_t *Action_Perf)
 {
 	// Host Memory AXI Interface
 #pragma HLS INTERFACE m_axi port=din_gmem bundle=host_mem offset=slave depth=512 \
-  max_read_burst_length=64  max_write_burst_length=64 
+  max_read_burst_length=64  max_write_burst_length=64 \
+  num_read_outstanding=8  num_write_outstanding=8
 #pragma HLS INTERFACE s_axilite port=din_gmem bundle=ctrl_reg offset=0x030
 
 #pragma HLS INTERFACE m_axi port=dout_gmem bundle=host_mem offset=slave depth=512 \
-  max_read_burst_length=64  max_write_burst_length=64 
+  max_read_burst_length=64  max_write_burst_length=64 \
+  num_read_outstanding=8  num_write_outstanding=8
 #pragma HLS INTERFACE s_axilite port=dout_gmem bundle=ctrl_reg offset=0x040
 
 	// DDR memory Interface
 #pragma HLS INTERFACE m_axi port=d_ddrmem bundle=card_mem0 offset=slave depth=512 \
-  max_read_burst_length=64  max_write_burst_length=64 
+  max_read_burst_length=64  max_write_burst_length=64 \
+  num_read_outstanding=8  num_write_outstanding=8
 #pragma HLS INTERFACE s_axilite port=d_ddrmem bundle=ctrl_reg offset=0x050
 
+	// Card DRAM writes, same port, so card to card copies overlap
+#pragma HLS INTERFACE m_axi port=dout_ddrmem bundle=card_mem0 offset=slave depth=512 \
+  max_read_burst_length=64  max_write_burst_length=64 \
+  num_read_outstanding=8  num_write_outstanding=8
+#pragma HLS INTERFACE s_axilite port=dout_ddrmem bundle=ctrl_reg offset=0x060
+
+	// NVMe host registers, reads of SNAP_ADDRTYPE_NVME sources
+#pragma HLS INTERFACE m_axi port=d_nvme bundle=nvme offset=off
+
 	// Host Memory AXI Lite Master Interface
 #pragma HLS DATA_PACK variable=Action_Config
 #pragma HLS INTERFACE s_axilite port=Action_Config bundle=ctrl_reg offset=0x010
@@ -220,6 +153,10 @@ void hls_action(snap_membus_t *din_gmem,
 #pragma HLS INTERFACE s_axilite port=act_reg bundle=ctrl_reg offset=0x100
 #pragma HLS INTERFACE s_axilite port=return bundle=ctrl_reg
 
+	// Performance counters of the job, ACTION_PERF
+#pragma HLS DATA_PACK variable=Action_Perf
+#pragma HLS INTERFACE s_axilite port=Action_Perf bundle=ctrl_reg offset=0x080
+
 	/* Required Action Type Detection */
 	// 	NOTE: switch generates better vhdl than "if" */
 	// Test used to exit the action if no parameter has been set.
@@ -232,7 +169,8 @@ void hls_action(snap_membus_t *din_gmem,
 		return;
 		break;
 	default:
-        	process_action(din_gmem, dout_gmem, d_ddrmem, act_reg);
+        	process_action(din_gmem, dout_gmem, d_ddrmem, dout_ddrmem,
+			       d_nvme, act_reg, Action_Perf);
 		break;
 	}
 }
@@ -241,7 +179,9 @@ void hls_action(snap_membus_t *din_gmem,
 //--- TESTBENCH ---------------------------------------------------------------
 //-----------------------------------------------------------------------------
 
-#ifdef NO_SYNTH
+#if defined(NO_SYNTH) && !defined(HLS_SWEMU)
+
+#include <stdlib.h>
 
 typedef char word_t[BPERDW];
 // Cast a char* word (64B) to a word for output port (512b)
@@ -266,14 +206,17 @@ int main(void)
     static snap_membus_t  din_gmem[MEMORY_LINES];
     static snap_membus_t  dout_gmem[MEMORY_LINES];
     static snap_membus_t  d_ddrmem[MEMORY_LINES];
+    static snapu32_t      d_nvme[16];
     //snap_membus_t  dout_gmem[2048];
     //snap_membus_t  d_ddrmem[2048];
     action_reg act_reg;
     action_RO_config_reg Action_Config;
+    snap_perf_t Action_Perf;
 
     /* Query ACTION_TYPE ... */
     act_reg.Control.flags = 0x0;
-    hls_action(din_gmem, dout_gmem, d_ddrmem, &act_reg, &Action_Config);
+    hls_action(din_gmem, dout_gmem, d_ddrmem, d_ddrmem, d_nvme, &act_reg,
+	       &Action_Config, &Action_Perf);
     fprintf(stderr,
 	    "ACTION_TYPE:   %08x\n"
 	    "RELEASE_LEVEL: %08x\n"
@@ -298,7 +241,8 @@ int main(void)
     act_reg.Data.out.size = 4096;
     act_reg.Data.out.type = SNAP_ADDRTYPE_HOST_DRAM;
 
-    hls_action(din_gmem, dout_gmem, d_ddrmem, &act_reg, &Action_Config);
+    hls_action(din_gmem, dout_gmem, d_ddrmem, d_ddrmem, d_nvme, &act_reg,
+	       &Action_Config, &Action_Perf);
     if (act_reg.Control.Retc == SNAP_RETC_FAILURE) {
 	    fprintf(stderr, " ==> RETURN CODE FAILURE <==\n");
 	    return 1;
@@ -310,6 +254,81 @@ int main(void)
     }
     else
     	printf(" ==> DATA COMPARE OK <==\n");
+    if (Action_Perf.rd_bytes != 4096 || Action_Perf.wr_bytes != 4096 ||
+	Action_Perf.cycles < 4096 / BPERDW) {
+	    fprintf(stderr, " ==> PERF COUNTER FAILURE <==\n");
+	    return 1;
+    }
+
+    /* Card to card, read through d_ddrmem and written through dout_ddrmem */
+    for (i = 0; i < 4096 / BPERDW; i++) {
+	    d_ddrmem[i] = 0;
+	    d_ddrmem[i](31, 0) = i * 0x01010101u + 3;
+	    d_ddrmem[i](511, 480) = ~i;
+    }
+    act_reg.Data.in.addr = 0;
+    act_reg.Data.in.type = SNAP_ADDRTYPE_CARD_DRAM;
+    act_reg.Data.out.addr = 8192;
+    act_reg.Data.out.type = SNAP_ADDRTYPE_CARD_DRAM;
+
+    hls_action(din_gmem, dout_gmem, d_ddrmem, d_ddrmem, d_nvme, &act_reg,
+	       &Action_Config, &Action_Perf);
+    if (act_reg.Control.Retc == SNAP_RETC_FAILURE ||
+	memcmp((void *)d_ddrmem, (void *)(d_ddrmem + 8192 / BPERDW),
+	       4096) != 0) {
+	    fprintf(stderr, " ==> CARD COMPARE FAILURE <==\n");
+	    return 1;
+    }
+    printf(" ==> CARD COMPARE OK <==\n");
+
+    /* NVMe drive 1 to host, three chunks through the staging area */
+#define DRIVE_SIZE (1024 * 1024)
+#define NVME_XFER  (600 * 1024)
+    uint8_t *drive = (uint8_t *)malloc(DRIVE_SIZE);
+    uint64_t card_size = SNAP_NVME_STAGING_ADDR + SNAP_NVME_STAGING_SIZE;
+    snap_membus_t *card = (snap_membus_t *)calloc(1, card_size);
+    snap_membus_t *host = (snap_membus_t *)calloc(1, NVME_XFER);
+
+    if (!drive || !card || !host)
+	    return 1;
+    for (i = 0; i < DRIVE_SIZE; i++)
+	    drive[i] = i * 7 + (i >> 9);
+    nvme_sim_setup(NULL, 0, drive, DRIVE_SIZE, card, card_size);
+
+    act_reg.Data.in.addr = 4096;
+    act_reg.Data.in.size = NVME_XFER;
+    act_reg.Data.in.type = SNAP_ADDRTYPE_NVME;
+    act_reg.Data.in.flags = SNAP_ADDRFLAG_SRC | SNAP_ADDRFLAG_DRIVE1;
+    act_reg.Data.out.addr = 0;
+    act_reg.Data.out.size = NVME_XFER;
+    act_reg.Data.out.type = SNAP_ADDRTYPE_HOST_DRAM;
+
+    hls_action(din_gmem, host, card, card, d_nvme, &act_reg, &Action_Config,
+		   &Action_Perf);
+    if (act_reg.Control.Retc == SNAP_RETC_FAILURE ||
+	memcmp(drive + 4096, host, NVME_XFER) != 0 || nvme_sim.cmds != 3) {
+	    fprintf(stderr, " ==> NVME COMPARE FAILURE <==\n");
+	    return 1;
+    }
+    printf(" ==> NVME COMPARE OK <==\n");
+
+    /* Drive offsets must be block aligned, drive 0 is not there */
+    act_reg.Data.in.addr = 4096 + 64;
+    hls_action(din_gmem, host, card, card, d_nvme, &act_reg, &Action_Config,
+		   &Action_Perf);
+    rc |= act_reg.Control.Retc != SNAP_RETC_FAILURE;
+    act_reg.Data.in.addr = 4096;
+    act_reg.Data.in.flags = SNAP_ADDRFLAG_SRC;
+    hls_action(din_gmem, host, card, card, d_nvme, &act_reg, &Action_Config,
+		   &Action_Perf);
+    rc |= act_reg.Control.Retc != SNAP_RETC_FAILURE;
+    if (rc) {
+	    fprintf(stderr, " ==> NVME ERROR NOT DETECTED <==\n");
+	    return 1;
+    }
+    free(drive);
+    free(card);
+    free(host);
 
     printf(">> ACTION TYPE = %08lx - RELEASE_LEVEL = %08lx <<\n",
                     (unsigned int)Action_Config.action_type,
@@ -81,7 +81,22 @@ static int action_main(struct snap_sim_action *action,
 		goto out_err;
 	}
 	/* checking parameters ... */
-	if (js->in.type != SNAP_ADDRTYPE_HOST_DRAM) {
+	if (js->in.type == SNAP_ADDRTYPE_NVME) {
+		int drive = (js->in.flags & SNAP_ADDRFLAG_DRIVE1) ? 1 : 0;
+
+		act_trace("  loading input data from NVMe drive %d\n", drive);
+		if (js->in.addr % SNAP_NVME_BLOCK_SIZE)
+			goto out_err;
+		ibuf = malloc(len);
+		if (ibuf == NULL)
+			goto out_err;
+
+		rc = snap_nvme_emu_read(drive, js->in.addr, ibuf, len);
+		if (rc != 0)
+			goto out_err;
+
+		src = ibuf;
+	} else if (js->in.type != SNAP_ADDRTYPE_HOST_DRAM) {
 		snprintf(ifname, sizeof(ifname), MEMORY_FILE,
 			 (long long)js->in.addr, (long long)js->in.size);
 
@@ -113,6 +128,8 @@ static int action_main(struct snap_sim_action *action,
 		memcpy(dst, src, len);
 	}
  out_ok:
+	action->perf.rd_bytes = len;
+	action->perf.wr_bytes = len;
 	action->job.retc = SNAP_RETC_SUCCESS;
 	return 0;
 
@@ -48,8 +48,9 @@ static void usage(const char *prog)
 	       "  -C, --card <cardno> can be (0...3)\n"
 	       "  -i, --input <file.bin>    input file.\n"
 	       "  -o, --output <file.bin>   output file.\n"
-	       "  -A, --type-in <CARD_DRAM, HOST_DRAM, ...>.\n"
-	       "  -a, --addr-in <addr>      address e.g. in CARD_RAM.\n"
+	       "  -A, --type-in <CARD_DRAM, HOST_DRAM, NVME, NVME1>.\n"
+	       "  -a, --addr-in <addr>      address e.g. in CARD_RAM,\n"
+	       "                            512 byte aligned offset on NVMe.\n"
 	       "  -D, --type-out <CARD_DRAM, HOST_DRAM, ...>.\n"
 	       "  -d, --addr-out <addr>     address e.g. in CARD_RAM.\n"
 	       "  -s, --size <size>         size of data.\n"
@@ -69,6 +70,7 @@ static void snap_prepare_memcopy(struct snap_job *cjob,
 				 void *addr_in,
 				 uint32_t size_in,
 				 uint8_t type_in,
+				 snap_addrflag_t flags_in,
 				 void *addr_out,
 				 uint32_t size_out,
 				 uint8_t type_out)
@@ -79,7 +81,7 @@ static void snap_prepare_memcopy(struct snap_job *cjob,
 	memset(mjob, 0, sizeof(*mjob));
 
 	snap_addr_set(&mjob->in, addr_in, size_in, type_in,
-		      SNAP_ADDRFLAG_ADDR | SNAP_ADDRFLAG_SRC);
+		      SNAP_ADDRFLAG_ADDR | SNAP_ADDRFLAG_SRC | flags_in);
 	snap_addr_set(&mjob->out, addr_out, size_out, type_out,
 		      SNAP_ADDRFLAG_ADDR | SNAP_ADDRFLAG_DST |
 		      SNAP_ADDRFLAG_END);
@@ -108,6 +110,7 @@ int main(int argc, char *argv[])
 	ssize_t size = 1024 * 1024;
 	uint8_t *ibuff = NULL, *obuff = NULL;
 	uint8_t type_in = SNAP_ADDRTYPE_HOST_DRAM;
+	snap_addrflag_t flags_in = 0;
 	uint64_t addr_in = 0x0ull;
 	uint8_t type_out = SNAP_ADDRTYPE_HOST_DRAM;
 	uint64_t addr_out = 0x0ull;
@@ -169,7 +172,12 @@ int main(int argc, char *argv[])
 				type_in = SNAP_ADDRTYPE_CARD_DRAM;
 			else if (strcmp(space, "HOST_DRAM") == 0)
 				type_in = SNAP_ADDRTYPE_HOST_DRAM;
-			else {
+			else if (strcmp(space, "NVME") == 0)
+				type_in = SNAP_ADDRTYPE_NVME;
+			else if (strcmp(space, "NVME1") == 0) {
+				type_in = SNAP_ADDRTYPE_NVME;
+				flags_in = SNAP_ADDRFLAG_DRIVE1;
+			} else {
 				usage(argv[0]);
 				exit(EXIT_FAILURE);
 			}
@@ -240,6 +248,7 @@ int main(int argc, char *argv[])
 			goto out_error;
 
 		type_in = SNAP_ADDRTYPE_HOST_DRAM;
+		flags_in = 0;
 		addr_in = (unsigned long)ibuff;
 	}
 
@@ -287,7 +296,7 @@ int main(int argc, char *argv[])
 	}
 
 	snap_prepare_memcopy(&cjob, &mjob,
-			     (void *)addr_in,  size, type_in,
+			     (void *)addr_in,  size, type_in, flags_in,
 			     (void *)addr_out, size, type_out);
 
 	__hexdump(stderr, &mjob, sizeof(mjob));
@@ -340,6 +349,20 @@ int main(int argc, char *argv[])
 	fprintf(stdout, "memcopy took %lld usec\n",
 		(long long)timediff_usec(&etime, &stime));
 
+	if (verbose_flag) {
+		struct snap_action_perf perf;
+
+		if (snap_action_perf(action, &perf) == 0)
+			fprintf(stdout, "cycles %lld read %lld bytes "
+				"written %lld bytes stalls read %lld "
+				"write %lld\n",
+				(long long)perf.cycles,
+				(long long)perf.rd_bytes,
+				(long long)perf.wr_bytes,
+				(long long)perf.rd_stall,
+				(long long)perf.wr_stall);
+	}
+
 	snap_detach_action(action);
 	snap_card_free(card);
 
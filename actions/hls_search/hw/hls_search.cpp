@@ -25,59 +25,9 @@ unsigned int global_count;
 /* ----------------------------------------------------------------------------
  * Known Limitations => Issue #39 & #45
  * => Transfers must be 64 byte aligned and a size of multiples of 64 bytes
- * Issue#320 - memcopy doesn't handle 4Kbytes xfer => use patch
+ * Issue#320 - 4Kbytes bursts are handled by hls_snap_dma.H
  * ----------------------------------------------------------------------------
  */
-static snapu32_t read_bulk(snap_membus_t *src_mem,
-			   snapu64_t      byte_address,
-			   snapu32_t      byte_to_transfer,
-			   snap_membus_t *buffer)
-{
-	snapu32_t xfer_size;
-
-	xfer_size = MIN(byte_to_transfer, (snapu32_t) MAX_NB_OF_BYTES_READ);
-        
-        // Patch to Issue#320 - memcopy doesn't handle 4Kbytes xfer
-        int xfer_size_in_words;
-        if(xfer_size %BPERDW == 0)
-        	xfer_size_in_words = xfer_size/BPERDW;
-        else
-        	xfer_size_in_words = (xfer_size/BPERDW) + 1;
-
-	//memcpy(buffer, 
-	//       (snap_membus_t *) (src_mem + (byte_address >> ADDR_RIGHT_SHIFT)), 
-	//       xfer_size);
-	rb_loop: for (int k=0; k< xfer_size_in_words; k++)
-#pragma HLS PIPELINE
-            buffer[k] = (src_mem + (byte_address >> ADDR_RIGHT_SHIFT))[k];
-
-	return xfer_size;
-}
-
-static snapu32_t write_bulk(snap_membus_t *tgt_mem,
-                            snapu64_t      byte_address,
-                            snapu32_t      byte_to_transfer,
-                            snap_membus_t *buffer)
-{
-	snapu32_t xfer_size;
-
-	// Patch to Issue#320 - memcopy doesn't handle 4Kbytes xfer
-	xfer_size = MIN(byte_to_transfer, (snapu32_t)  MAX_NB_OF_BYTES_READ);
-        int xfer_size_in_words;
-        if(xfer_size %BPERDW == 0)
-        	xfer_size_in_words = xfer_size/BPERDW;
-        else
-        	xfer_size_in_words = (xfer_size/BPERDW) + 1;
-
-	//memcpy((snap_membus_t *)(tgt_mem + (byte_address >> ADDR_RIGHT_SHIFT)), 
-	//       buffer, xfer_size);
-	wb_loop: for (int k=0; k<xfer_size_in_words; k++)
-#pragma HLS PIPELINE
-              (tgt_mem + (byte_address >> ADDR_RIGHT_SHIFT))[k] = buffer[k];
-
-	return xfer_size;
-}
-
 static void memcopy_table(snap_membus_t  *din_gmem,
 			  snap_membus_t  *dout_gmem,
 			  snap_membus_t  *d_ddrmem,
@@ -87,84 +37,22 @@ static void memcopy_table(snap_membus_t  *din_gmem,
 			  snap_bool_t     direction)
 {
 	//source_address and target_address are byte addresses.
-	snapu64_t address_xfer_offset = 0;
-	snap_membus_t   buf_gmem[MAX_NB_OF_WORDS_READ];
-	snapu32_t  left_bytes = total_bytes_to_transfer;
-	snapu32_t  copy_bytes, copy_64_bytes_aligned;
-
- L_COPY:
-	while (left_bytes > 0) {
-		switch (direction) {
-		case HOST2DDR:
-			copy_bytes = read_bulk (din_gmem, 
-						source_address + address_xfer_offset,  
-						left_bytes, buf_gmem);
-			// Always write 64 bytes aligned data into DDR
-			if ((copy_bytes%64) == 0)
-				copy_64_bytes_aligned = copy_bytes;
-			else
-				copy_64_bytes_aligned = copy_bytes - (copy_bytes%64) + 64;
-
-			write_bulk (d_ddrmem,
-				    target_address + address_xfer_offset,  
-				    copy_64_bytes_aligned, buf_gmem);
-			break;
-		case DDR2HOST:
-			copy_bytes = read_bulk (d_ddrmem, 
-						source_address + address_xfer_offset, 
-						left_bytes, buf_gmem);
-			write_bulk (dout_gmem, 
-				    target_address + address_xfer_offset, 
-				    copy_bytes, buf_gmem);
-			break;
-		default:
-			break;
-		}
-		left_bytes -= copy_bytes;
-		address_xfer_offset += MAX_NB_OF_BYTES_READ;
-	} // end of L_COPY
-}
-
-
-// READ DATA FROM MEMORY
-static short read_burst_of_data_from_mem(snap_membus_t *din_gmem, 
-					 snap_membus_t *d_ddrmem,
-					 snapu16_t memory_type,
-					 snapu64_t input_address,
-					 snap_membus_t *buffer,
-					 snapu64_t size_in_bytes_to_transfer)
-{
-	short rc = -1;
-	// Patch to Issue#320 - memcopy doesn't handle 4Kbytes xfer
-        int size_in_words;
-        if(size_in_bytes_to_transfer %BPERDW == 0)
-        	size_in_words = size_in_bytes_to_transfer/BPERDW;
-        else
-        	size_in_words = (size_in_bytes_to_transfer/BPERDW) + 1;
-
-	switch (memory_type) {
-	case SNAP_ADDRTYPE_HOST_DRAM:
-		// Patch to Issue#320 - memcopy doesn't handle 4Kbytes xfer
-        	//memcpy(buffer, (snap_membus_t  *) (din_gmem + input_address),
-		//       size_in_bytes_to_transfer);
-		rb_din_loop: for (int k=0; k<size_in_words; k++)
-#pragma HLS PIPELINE
-                    buffer[k] = (din_gmem + input_address)[k];
-
-       		rc =  0;
+	switch (direction) {
+	case HOST2DDR:
+		snap_dma_copy(din_gmem, dout_gmem, d_ddrmem, d_ddrmem,
+			      SNAP_ADDRTYPE_HOST_DRAM, source_address,
+			      SNAP_ADDRTYPE_CARD_DRAM, target_address,
+			      total_bytes_to_transfer);
 		break;
-	case SNAP_ADDRTYPE_CARD_DRAM:
-		// Patch to Issue#320 - memcopy doesn't handle 4Kbytes xfer
-        	//memcpy(buffer, (snap_membus_t  *) (d_ddrmem + input_address), 
-		//       size_in_bytes_to_transfer);
-		rb_ddr_loop: for (int k=0; k<size_in_words; k++)
-#pragma HLS PIPELINE
-                    buffer[k] = (d_ddrmem + input_address)[k];
-
-       		rc =  0;
+	case DDR2HOST:
+		snap_dma_copy(din_gmem, dout_gmem, d_ddrmem, d_ddrmem,
+			      SNAP_ADDRTYPE_CARD_DRAM, source_address,
+			      SNAP_ADDRTYPE_HOST_DRAM, target_address,
+			      total_bytes_to_transfer);
+		break;
+	default:
 		break;
 	}
-	return rc;
 }
 
 static short read_single_word_of_data_from_mem(snap_membus_t *din_gmem, 
@@ -550,33 +438,83 @@ unsigned int search(snapu16_t Method,
 //--------------------------------------------------------------------------------------------
 //--- MAIN PROGRAM FOR ARRAY SEARCH ----------------------------------------------------------
 //--------------------------------------------------------------------------------------------
+// search a text of InputSize bytes block by block
+static unsigned int search_text(snap_membus_t *din_gmem,
+                                snap_membus_t *d_ddrmem,
+                                snapu16_t InputType,
+                                snapu64_t InputAddress,
+                                snapu32_t InputSize,
+                                snapu16_t Method,
+                                char Pattern[PATTERN_SIZE],
+                                snapu32_t PatternSize,
+                                short *rc)
+{
+  snapu32_t search_size;
+  snapu32_t TextSize;
+  snapu32_t nb_blocks_to_process;
+  snapu16_t i;
+  snapu64_t rd_address_text_offset;
+  unsigned int nb_of_occurrences = 0;
+
+  snap_membus_t  TextBuffer[MAX_NB_OF_WORDS_READ];   // 4KB =>64 words of 64B
+  char  Text[MAX_NB_OF_BYTES_READ];
+
+  rd_address_text_offset = 0x0;
+  TextSize = InputSize;
+
+  // buffer size is hardware limited by MAX_NB_OF_BYTES_READ
+  if(InputSize %MAX_NB_OF_BYTES_READ == 0)
+      nb_blocks_to_process = (InputSize / MAX_NB_OF_BYTES_READ);
+  else
+      nb_blocks_to_process = (InputSize / MAX_NB_OF_BYTES_READ) + 1;
+
+  // processing buffers one after the other
+  process_text_per_block:
+  for ( i = 0; i < nb_blocks_to_process; i++ ) {
+#pragma HLS UNROLL // cannot completely unroll a loop with a variable trip count
+		search_size = MIN(TextSize, (snapu32_t) MAX_NB_OF_BYTES_READ);
+
+		*rc |= snap_dma_read(din_gmem, d_ddrmem, InputType,
+				InputAddress + rd_address_text_offset,
+				TextBuffer, search_size);
+		x_mbus_to_word(TextBuffer, Text); /* convert buffer to char*/
+
+		/* ********************
+		 * call search function
+		 **********************/
+		/*FIXME we may miss a pattern that could be between 2 blocks / 2 calls */
+		nb_of_occurrences +=  search(Method, Pattern, PatternSize,
+                                            Text, search_size);
+
+		TextSize -= search_size;
+		rd_address_text_offset += (snapu64_t)search_size;
+
+  }
+  return nb_of_occurrences;
+}
+
 static snapu32_t process_action(snap_membus_t *din_gmem,
                            snap_membus_t *dout_gmem,
                            snap_membus_t *d_ddrmem,
+                           snapu32_t *d_nvme,
                            action_reg *Action_Register)
 {
 
 
   // VARIABLES
-  snapu32_t search_size;
-  snapu32_t TextSize;
-  snapu32_t nb_blocks_to_process;
-  snapu16_t i, j ;
   short rc = 0;
 
   snapu64_t   InputAddress;
   snapu32_t   InputSize;
   snapu16_t   InputType;
-  snapu64_t   OutputAddress;
-
-  snapu64_t   rd_address_text_offset;
-
-  snap_membus_t  TextBuffer[MAX_NB_OF_WORDS_READ];   // 4KB =>64 words of 64B
-  char  Text[MAX_NB_OF_BYTES_READ]; 
 
   unsigned int nb_of_occurrences = 0;
   snapu16_t Method;
-  unsigned int nb_pos;
+
+  // NVMe text is searched in the staging area of the card DRAM
+  nvme_stream_t nvme_text;
+  snapu64_t   StagingAddress;
+  snapu32_t   StagingSize;
 
 
   /* read pattern */
@@ -587,7 +525,7 @@ static snapu32_t process_action(snap_membus_t *din_gmem,
   PatternSize = Action_Register->Data.src_pattern.size;
   if (PatternSize > PATTERN_SIZE) rc = 1;
 
-  read_single_word_of_data_from_mem(din_gmem, d_ddrmem, 
+  read_single_word_of_data_from_mem(din_gmem, d_ddrmem,
           Action_Register->Data.src_pattern.type,
           Action_Register->Data.src_pattern.addr >> ADDR_RIGHT_SHIFT,
           PatternBuffer);
@@ -601,39 +539,26 @@ static snapu32_t process_action(snap_membus_t *din_gmem,
   InputType    = Action_Register->Data.ddr_text1.type;
   Method       = Action_Register->Data.method;
 
+  if (InputType == SNAP_ADDRTYPE_NVME) {
+      // the drive reads the next chunk while we search this one
+      nvme_stream_init(&nvme_text, d_nvme, InputAddress, InputSize,
+                       (Action_Register->Data.ddr_text1.flags &
+                        SNAP_ADDRFLAG_DRIVE1) != 0, NVME_MAX_BYTES);
+      process_text_per_chunk:
+      while ((StagingSize = nvme_stream_next(&nvme_text, d_nvme,
+                                             &StagingAddress)) != 0)
+          nb_of_occurrences += search_text(din_gmem, d_ddrmem,
+                                           SNAP_ADDRTYPE_CARD_DRAM,
+                                           StagingAddress, StagingSize,
+                                           Method, Pattern, PatternSize,
+                                           &rc);
+      if (nvme_text.error)
+          Action_Register->Control.Retc = SNAP_RETC_FAILURE;
+  } else
+      nb_of_occurrences = search_text(din_gmem, d_ddrmem, InputType,
+                                      InputAddress, InputSize,
+                                      Method, Pattern, PatternSize, &rc);
 
-  rd_address_text_offset = 0x0;
-  TextSize = InputSize;
-
-  // buffer size is hardware limited by MAX_NB_OF_BYTES_READ
-  if(InputSize %MAX_NB_OF_BYTES_READ == 0)
-      nb_blocks_to_process = (InputSize / MAX_NB_OF_BYTES_READ);
-  else
-      nb_blocks_to_process = (InputSize / MAX_NB_OF_BYTES_READ) + 1;
-
-  // processing buffers one after the other
-  process_text_per_block:
-  for ( i = 0; i < nb_blocks_to_process; i++ ) {
-#pragma HLS UNROLL // cannot completely unroll a loop with a variable trip count
-		search_size = MIN(TextSize, (snapu32_t) MAX_NB_OF_BYTES_READ);
-
-		rc |= read_burst_of_data_from_mem(din_gmem, d_ddrmem, InputType,
-				(InputAddress >> ADDR_RIGHT_SHIFT) + rd_address_text_offset,
-				TextBuffer, search_size);
-		x_mbus_to_word(TextBuffer, Text); /* convert buffer to char*/
-
-		/* ********************
-		 * call search function
-		 **********************/
-		/*FIXME we may miss a pattern that could be between 2 blocks / 2 calls */
-		nb_of_occurrences +=  search(Method, Pattern, PatternSize, 
-                                            Text, search_size);
-		Action_Register->Data.nb_of_occurrences = (snapu32_t) nb_of_occurrences;
-
-		TextSize -= search_size;
-		rd_address_text_offset += (snapu64_t)(search_size >> ADDR_RIGHT_SHIFT);
-
-  }
   Action_Register->Data.nb_of_occurrences = (snapu32_t) nb_of_occurrences;
   return (snapu32_t) nb_of_occurrences;
 }
@@ -643,6 +568,7 @@ static snapu32_t process_action(snap_membus_t *din_gmem,
 void hls_action(snap_membus_t *din_gmem, 
 		snap_membus_t  *dout_gmem,
 		snap_membus_t  *d_ddrmem,
+		snapu32_t *d_nvme,
         	action_reg *Action_Register, 
 		action_RO_config_reg *Action_Config)
 {
@@ -661,6 +587,9 @@ void hls_action(snap_membus_t *din_gmem,
   max_read_burst_length=64  max_write_burst_length=64
 #pragma HLS INTERFACE s_axilite port=d_ddrmem bundle=ctrl_reg 		offset=0x050
 
+//NVMe host registers
+#pragma HLS INTERFACE m_axi port=d_nvme bundle=nvme offset=off
+
 // Host Memory AXI Lite Master Interface
 #pragma HLS DATA_PACK variable=Action_Config
 #pragma HLS INTERFACE s_axilite port=Action_Config bundle=ctrl_reg	offset=0x010 
@@ -712,13 +641,14 @@ void hls_action(snap_membus_t *din_gmem,
     		break;
     	case 3: // HW : search processing
 #ifdef STREAMING_METHOD
-    		if(Action_Register->Data.method == STRM_method)
+    		if(Action_Register->Data.method == STRM_method &&
+		   Action_Register->Data.ddr_text1.type != SNAP_ADDRTYPE_NVME)
                     result = process_action_strm(din_gmem, dout_gmem, d_ddrmem, 
 					Action_Register);
     		else
 #endif
-                    result = process_action(din_gmem, dout_gmem, d_ddrmem, 
-					Action_Register);
+                    result = process_action(din_gmem, dout_gmem, d_ddrmem,
+					d_nvme, Action_Register);
     		break;
 
 /* Reporting positions of pattern - Case not yet implemented
@@ -735,7 +665,8 @@ void hls_action(snap_membus_t *din_gmem,
             break;
         }
 
-    Action_Register->Control.Retc = SNAP_RETC_SUCCESS;
+    if (Action_Register->Control.Retc != SNAP_RETC_FAILURE)
+        Action_Register->Control.Retc = SNAP_RETC_SUCCESS;
     Action_Register->Data.nb_of_occurrences = result;
     Action_Register->Data.next_input_addr = 0x0;
 
@@ -748,7 +679,9 @@ void hls_action(snap_membus_t *din_gmem,
 //-----------------------------------------------------------------------------
 
 
-#ifdef NO_SYNTH
+#if defined(NO_SYNTH) && !defined(HLS_SWEMU)
+
+#include <stdlib.h>
 
 // Cast a char* word (64B) to a word for output port (512b)
 static snap_membus_t word_to_mbus(word_t text)
@@ -771,6 +704,7 @@ int main(void)
     snap_membus_t  din_gmem [512];
     snap_membus_t  dout_gmem[512];
     snap_membus_t  d_ddrmem [512];
+    snapu32_t      d_nvme[16];
 
     action_reg Action_Register;
     action_RO_config_reg Action_Config;
@@ -842,7 +776,8 @@ int main(void)
 
     // get Action_Register values
     Action_Register.Control.flags = 0x0;
-    hls_action(din_gmem, dout_gmem, d_ddrmem, &Action_Register, &Action_Config);
+    hls_action(din_gmem, dout_gmem, d_ddrmem, d_nvme, &Action_Register,
+	       &Action_Config);
 
 
     // process the action
@@ -852,7 +787,8 @@ int main(void)
     // SW + HW : copy all data from Host to DDR
     Action_Register.Data.step = 1;
     printf("--Step 1--SW + HW : copy all data from Host to DDR--");
-    hls_action(din_gmem, dout_gmem, d_ddrmem, &Action_Register, &Action_Config);
+    hls_action(din_gmem, dout_gmem, d_ddrmem, d_nvme, &Action_Register,
+	       &Action_Config);
     if (Action_Register.Control.Retc == SNAP_RETC_FAILURE)
 	    printf("Error in step 1\n");
     else printf("OK\n");
@@ -860,7 +796,8 @@ int main(void)
     // SW : copy source from DDR to Host
     Action_Register.Data.step = 2;
     printf("--Step 2--SW : copy source from DDR to Host--");
-    hls_action(din_gmem, dout_gmem, d_ddrmem, &Action_Register, &Action_Config);
+    hls_action(din_gmem, dout_gmem, d_ddrmem, d_nvme, &Action_Register,
+	       &Action_Config);
     if (Action_Register.Control.Retc == SNAP_RETC_FAILURE)
 	    printf("Error in step 2\n");
     else printf("OK\n");
@@ -868,7 +805,8 @@ int main(void)
     // HW : search processing
     Action_Register.Data.step = 3;
     printf("--Step 3--HW : search processing--\n");
-    hls_action(din_gmem, dout_gmem, d_ddrmem, &Action_Register, &Action_Config);
+    hls_action(din_gmem, dout_gmem, d_ddrmem, d_nvme, &Action_Register,
+	       &Action_Config);
     nb_of_occurrences = Action_Register.Data.nb_of_occurrences;
     if(Action_Register.Control.Retc == SNAP_RETC_FAILURE)
 	    printf("Error in step 3\n");
@@ -880,11 +818,32 @@ int main(void)
     else
     	printf(" => Test failed : Expected 18 !!\n============================= \n");
 
+    // HW : search processing of the same text on NVMe drive 0
+    uint64_t card_size = SNAP_NVME_STAGING_ADDR + SNAP_NVME_STAGING_SIZE;
+    snap_membus_t *card = (snap_membus_t *)calloc(1, card_size);
+    if (card == NULL)
+	    return 1;
+    nvme_sim_setup((const uint8_t *)din_gmem, sizeof(din_gmem), NULL, 0,
+		   card, card_size);
+    Action_Register.Data.ddr_text1.type = SNAP_ADDRTYPE_NVME;
+    Action_Register.Data.ddr_text1.flags = SNAP_ADDRFLAG_SRC;
+    printf("--Step 3--HW : search processing from NVMe--\n");
+    hls_action(din_gmem, dout_gmem, card, d_nvme, &Action_Register,
+	       &Action_Config);
+    free(card);
+    if (Action_Register.Control.Retc == SNAP_RETC_FAILURE ||
+	Action_Register.Data.nb_of_occurrences != nb_of_occurrences) {
+	    printf(" => NVMe test failed : %d occurrences\n",
+		   (unsigned int)Action_Register.Data.nb_of_occurrences);
+	    return 1;
+    }
+
 /* Positions reported - not yet implemented
     // HW : copy result array from DDR to Host
     Action_Register.Data.step = 5;
     printf("--Step 5--HW : copy result array from DDR to Host--");
-    hls_action(din_gmem, dout_gmem, d_ddrmem, &Action_Register, &Action_Config);
+    hls_action(din_gmem, dout_gmem, d_ddrmem, d_nvme, &Action_Register,
+	       &Action_Config);
     if(Action_Register.Control.Retc == SNAP_RETC_FAILURE)
 	    printf("Error in step 5\n");
     else printf("OK\n");
@@ -30,21 +30,6 @@
 #include <snap_internal.h>
 #include <snap_search.h>
 
-static int mmio_write32(struct snap_card *card,
-			uint64_t offs, uint32_t data)
-{
-	act_trace("  %s(%p, %llx, %x)\n", __func__, card,
-		  (long long)offs, data);
-	return 0;
-}
-
-static int mmio_read32(struct snap_card *card,
-		       uint64_t offs, uint32_t *data)
-{
-	act_trace("  %s(%p, %llx, %x)\n", __func__, card,
-		  (long long)offs, *data);
-	return 0;
-}
 /*******************************************************/
 // Knuth Morris Pratt Pattern Searching algorithm
 // based on D. E. Knuth, J. H. Morris, Jr., and V. R. Pratt, i
@@ -148,6 +133,27 @@ unsigned int run_sw_search(unsigned int Method,
         return (unsigned int) count;
 }
 
+/*
+ * With BUILD_HLS_SWEMU the HLS sources are the action, only the search
+ * functions above are used as reference by the application.
+ */
+#ifndef HLS_SWEMU
+static int mmio_write32(struct snap_card *card,
+			uint64_t offs, uint32_t data)
+{
+	act_trace("  %s(%p, %llx, %x)\n", __func__, card,
+		  (long long)offs, data);
+	return 0;
+}
+
+static int mmio_read32(struct snap_card *card,
+		       uint64_t offs, uint32_t *data)
+{
+	act_trace("  %s(%p, %llx, %x)\n", __func__, card,
+		  (long long)offs, *data);
+	return 0;
+}
+
 static void __trace_addr(const char *name, struct snap_addr *a)
 {
 	act_trace("  %-12s: %012llx %08x %04x %04x\n",
@@ -179,7 +185,26 @@ static int action_main(struct snap_sim_action *action,
 
 	method =  js->method;
 
-        if (js->step == 3) 
+	if (js->step == 3 && js->ddr_text1.type == SNAP_ADDRTYPE_NVME) {
+		/* Text read straight from the drive, no host copy in step 1 */
+		int drive = (js->ddr_text1.flags & SNAP_ADDRFLAG_DRIVE1) ? 1 : 0;
+
+		haystack_len = js->ddr_text1.size;
+		if (js->ddr_text1.addr % SNAP_NVME_BLOCK_SIZE)
+			return 0;
+		haystack = malloc(haystack_len);
+		if (haystack == NULL)
+			return 0;
+		if (snap_nvme_emu_read(drive, js->ddr_text1.addr, haystack,
+				       haystack_len) != 0) {
+			free(haystack);
+			return 0;
+		}
+		js->nb_of_occurrences = run_sw_search(method, (char *)needle,
+						      needle_len, haystack,
+						      haystack_len);
+		free(haystack);
+	} else if (js->step == 3) 
 		js->nb_of_occurrences = run_sw_search(method, (char *)needle, needle_len,
                                         (char *)haystack, haystack_len);
 
@@ -210,3 +235,4 @@ static void _init(void)
 {
 	snap_action_register(&action);
 }
+#endif /* HLS_SWEMU */
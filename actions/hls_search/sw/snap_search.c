@@ -284,6 +284,9 @@ static void usage(const char *prog)
 	       "  -s, --software         Test the software flow \n"
 	       "  -m, --method           Can be (1,2) different method search\n"
 	       "  -i, --input <data.bin> Input data.\n"
+	       "  -A, --type-in <NVME, NVME1> search the text on a drive.\n"
+	       "  -a, --addr-in <offs>   byte offset on the drive.\n"
+	       "  -S, --size <size>      size of the text on the drive.\n"
 	       "  -I, --items <items>    Max items to find.\n"
 	       "  -p, --pattern <str>    Pattern to search for\n"
 	       "  -E, --expected <num>   Expected # of patterns to find\n"
@@ -329,6 +332,10 @@ int main(int argc, char *argv[])
         int sw = 0; //using software flow. Default is 0.
         unsigned int method = 1; //search method. Default is Naive(1).
         unsigned int step;
+	uint8_t type_in = SNAP_ADDRTYPE_HOST_DRAM;
+	snap_addrflag_t flags_in = 0;
+	uint64_t addr_in = 0x0ull;
+	ssize_t size_in = 0;
 
 	while (1) {
 		int option_index = 0;
@@ -337,6 +344,9 @@ int main(int argc, char *argv[])
 			{ "software",    no_argument,       NULL, 's' },
 			{ "method",      required_argument, NULL, 'm' },
 			{ "input",	 required_argument, NULL, 'i' },
+			{ "type-in",	 required_argument, NULL, 'A' },
+			{ "addr-in",	 required_argument, NULL, 'a' },
+			{ "size",	 required_argument, NULL, 'S' },
 			{ "pattern",	 required_argument, NULL, 'p' },
 			{ "items",	 required_argument, NULL, 'I' },
 			{ "timeout",	 required_argument, NULL, 't' },
@@ -349,7 +359,7 @@ int main(int argc, char *argv[])
 		};
 
 		ch = getopt_long(argc, argv,
-				 "C:E:m:i:p:I:t:sVvhX",
+				 "C:E:m:i:A:a:S:p:I:t:sVvhX",
 				 long_options, &option_index);
 		if (ch == -1)	/* all params processed ? */
 			break;
@@ -368,6 +378,20 @@ int main(int argc, char *argv[])
 		case 'i':
 			fname = optarg;
 			break;
+		case 'A':
+			if (strcmp(optarg, "NVME") == 0)
+				type_in = SNAP_ADDRTYPE_NVME;
+			else if (strcmp(optarg, "NVME1") == 0) {
+				type_in = SNAP_ADDRTYPE_NVME;
+				flags_in = SNAP_ADDRFLAG_DRIVE1;
+			}
+			break;
+		case 'a':
+			addr_in = strtoull(optarg, (char **)NULL, 0);
+			break;
+		case 'S':
+			size_in = strtol(optarg, (char **)NULL, 0);
+			break;
 		case 'p':
 			pattern_str = optarg;
 			break;
@@ -404,7 +428,15 @@ int main(int argc, char *argv[])
 		exit(EXIT_FAILURE);
 	}
 
-	dsize = file_size(fname);
+	/* The drive is only searched by the hardware, in one run */
+	if (type_in == SNAP_ADDRTYPE_NVME) {
+		if (sw || fname != NULL || size_in <= 0) {
+			usage(argv[0]);
+			exit(EXIT_FAILURE);
+		}
+		dsize = size_in;
+	} else
+		dsize = file_size(fname);
 	if (dsize < 0)
 		goto out_error;
 
@@ -423,9 +455,11 @@ int main(int argc, char *argv[])
 		goto out_error0;
 	memcpy(pbuff, pattern_str, psize);
 
-	rc = file_read(fname, dbuff, dsize);
-	if (rc < 0)
-		goto out_errorX;
+	if (type_in != SNAP_ADDRTYPE_NVME) {
+		rc = file_read(fname, dbuff, dsize);
+		if (rc < 0)
+			goto out_errorX;
+	}
 
 	offs = snap_malloc(items * sizeof(*offs));
 	if (offs == NULL)
@@ -460,7 +494,10 @@ int main(int argc, char *argv[])
     	/*
  	 * Run Step 1, 2, 4 for Software search
  	 * Run Step 1, 3, 5 for Hardware search
+ 	 * Run Step 3 only for text on NVMe
  	 */
+	if (type_in == SNAP_ADDRTYPE_NVME)
+		goto step3;
 
     	printf("...................................................\n");
   	printf("Start Step1 (Copy source data from Host to DDR) ...\n");
@@ -479,6 +516,7 @@ int main(int argc, char *argv[])
 	if (rc != 0)
 		goto out_error3;
 
+step3:
 	gettimeofday(&stime, NULL);
     	if(sw)
     	{
@@ -541,6 +579,12 @@ int main(int argc, char *argv[])
 					    offs, items,
 					    pbuff, psize,
 					    method, step);
+			if (type_in == SNAP_ADDRTYPE_NVME)
+				snap_addr_set(&sjob_in.ddr_text1,
+					      (void *)addr_in, dsize,
+					      SNAP_ADDRTYPE_NVME,
+					      SNAP_ADDRFLAG_ADDR |
+					      SNAP_ADDRFLAG_SRC | flags_in);
         		printf("dsize = %d - psize = %d \n", (int)dsize, (int)psize);
 
             		rc |= run_one_step(queue, &cjob, timeout, step);
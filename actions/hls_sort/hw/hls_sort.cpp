@@ -0,0 +1,733 @@
+/*
+ * Copyright 2017 International Business Machines
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* SNAP HLS_SORT EXAMPLE */
+
+#include <string.h>
+#include "ap_int.h"
+#include "action_sort.H"
+
+/* ----------------------------------------------------------------------------
+ * Sort of records by a 32 or 64 bit key, see include/action_sort.h.
+ *
+ * A record is a lane of a bus word, SORT_NREC of them per word. Each
+ * block of SORT_BLOCK_WORDS words is sorted on-chip: every word by a
+ * bitonic sorting network, then the words by SORT_WAYS-way merges
+ * until the block is one run. The runs go to tmp and are merged
+ * SORT_WAYS at a time into the other half of tmp, pass by pass, the
+ * last pass writes to out. Every merge pass moves a bus word per step
+ * in and out, so a pass through card DRAM takes its bandwidth.
+ *
+ * A merger keeps a word of records. It takes the next word of the
+ * input whose first record is the smaller one, merges it with the
+ * kept records by a bitonic merge network, passes the lower half on
+ * and keeps the upper half. That way the words passed on are sorted,
+ * which holds for two inputs, not for more. So SORT_WAYS runs are
+ * merged by a tree of SORT_WAYS - 1 mergers with a FIFO of two words
+ * after each one. The leaves get the words of the runs, one word per
+ * step into the emptiest FIFO.
+ *
+ * The keys are compared with the sign bit flipped for signed keys
+ * and all bits flipped for descending order. The last word of the
+ * records can have empty lanes. They carry a pad flag which sorts
+ * them after all records, so they stay at the end.
+ * ----------------------------------------------------------------------------
+ */
+
+//----------------------------------------------------------------------
+//--- RECORDS ----------------------------------------------------------
+//----------------------------------------------------------------------
+/* Key of r to compare, kx flips its bits, all ones for a pad lane */
+template <int KBITS, int RBITS>
+static ap_uint<KBITS + 1> sort_key(SORT_REC_T(RBITS) r, ap_uint<KBITS> kx)
+{
+	ap_uint<KBITS> key = r(KBITS - 1, 0);
+	ap_uint<KBITS + 1> k = key ^ kx;
+
+	if (r[RBITS])
+		k = -1;
+	return k;
+}
+
+/* Records of w, the ones from n on are pad lanes */
+template <int RBITS>
+static void sort_unpack(snap_membus_t w, snapu64_t n, SORT_REC_T(RBITS) *r)
+{
+ sort_unpack_loop:
+	for (int i = 0; i < SORT_NREC(RBITS); i++) {
+#pragma HLS UNROLL
+		r[i] = w((i + 1) * RBITS - 1, i * RBITS);
+		r[i][RBITS] = i >= n;
+	}
+}
+
+template <int RBITS>
+static snap_membus_t sort_pack(SORT_REC_T(RBITS) *r)
+{
+	snap_membus_t w = 0;
+
+ sort_pack_loop:
+	for (int i = 0; i < SORT_NREC(RBITS); i++) {
+#pragma HLS UNROLL
+		w((i + 1) * RBITS - 1, i * RBITS) = r[i](RBITS - 1, 0);
+	}
+	return w;
+}
+
+/* Compare and exchange, a gets the smaller key */
+template <int KBITS, int RBITS>
+static void sort_cx(SORT_REC_T(RBITS) &a, SORT_REC_T(RBITS) &b,
+		    ap_uint<KBITS> kx)
+{
+	SORT_REC_T(RBITS) t = a;
+
+	if (sort_key<KBITS, RBITS>(a, kx) > sort_key<KBITS, RBITS>(b, kx)) {
+		a = b;
+		b = t;
+	}
+}
+
+//----------------------------------------------------------------------
+//--- NETWORKS ---------------------------------------------------------
+//----------------------------------------------------------------------
+/* Bitonic sorting network over the records of a word */
+template <int KBITS, int RBITS>
+static void sort_word(SORT_REC_T(RBITS) *r, ap_uint<KBITS> kx)
+{
+	const int R = SORT_NREC(RBITS);
+
+ sort_word_k:
+	for (int k = 2; k <= R; k <<= 1) {
+#pragma HLS UNROLL
+	 sort_word_j:
+		for (int j = k >> 1; j > 0; j >>= 1) {
+#pragma HLS UNROLL
+		 sort_word_i:
+			for (int i = 0; i < R; i++) {
+#pragma HLS UNROLL
+				int l = i ^ j;
+
+				if (l < i)
+					continue;
+				if ((i & k) == 0)
+					sort_cx<KBITS, RBITS>(r[i], r[l], kx);
+				else	sort_cx<KBITS, RBITS>(r[l], r[i], kx);
+			}
+		}
+	}
+}
+
+/*
+ * Bitonic merge network: of the sorted records a and b, a gets the
+ * lower half and b the upper half, both sorted. a followed by b
+ * reversed is bitonic, half cleaners sort it.
+ */
+template <int KBITS, int RBITS>
+static void sort_merge2(SORT_REC_T(RBITS) *a, SORT_REC_T(RBITS) *b,
+			ap_uint<KBITS> kx)
+{
+	const int R = SORT_NREC(RBITS);
+	SORT_REC_T(RBITS) c[2 * R];
+#pragma HLS ARRAY_PARTITION variable=c complete
+
+ sort_merge2_in:
+	for (int i = 0; i < R; i++) {
+#pragma HLS UNROLL
+		c[i] = a[i];
+		c[2 * R - 1 - i] = b[i];
+	}
+ sort_merge2_j:
+	for (int j = R; j > 0; j >>= 1) {
+#pragma HLS UNROLL
+	 sort_merge2_i:
+		for (int i = 0; i < 2 * R; i++) {
+#pragma HLS UNROLL
+			if ((i & j) == 0)
+				sort_cx<KBITS, RBITS>(c[i], c[i | j], kx);
+		}
+	}
+ sort_merge2_out:
+	for (int i = 0; i < R; i++) {
+#pragma HLS UNROLL
+		a[i] = c[i];
+		b[i] = c[R + i];
+	}
+}
+
+//----------------------------------------------------------------------
+//--- MERGE TREE -------------------------------------------------------
+//----------------------------------------------------------------------
+template <int RBITS>
+static void sort_push(sort_tree<RBITS> *t, int n, SORT_REC_T(RBITS) *r)
+{
+ sort_push_loop:
+	for (int i = 0; i < SORT_NREC(RBITS); i++) {
+#pragma HLS UNROLL
+		t->q[n][t->qn[n]][i] = r[i];
+	}
+	t->qn[n]++;
+}
+
+template <int RBITS>
+static void sort_pop(sort_tree<RBITS> *t, int n, SORT_REC_T(RBITS) *r)
+{
+ sort_pop_loop:
+	for (int i = 0; i < SORT_NREC(RBITS); i++) {
+#pragma HLS UNROLL
+		r[i] = t->q[n][0][i];
+		t->q[n][0][i] = t->q[n][1][i];
+	}
+	t->qn[n]--;
+}
+
+/*
+ * One step of merger n: waits until it knows the next word of both
+ * children or that they ended, then takes the one with the smaller
+ * first key. The first word taken fills reg, after both children
+ * ended reg goes out as the last word.
+ */
+template <int KBITS, int RBITS>
+static void sort_node(sort_tree<RBITS> *t, int n, ap_uint<KBITS> kx)
+{
+	SORT_REC_T(RBITS) w[SORT_NREC(RBITS)];
+#pragma HLS ARRAY_PARTITION variable=w complete
+	int l = 2 * n, r = 2 * n + 1, c;
+	bool lend = t->qn[l] == 0 && t->fin[l];
+	bool rend = t->qn[r] == 0 && t->fin[r];
+
+	if ((t->qn[l] == 0 && !lend) || (t->qn[r] == 0 && !rend))
+		return;
+	if (lend && rend) {
+		if (t->rv[n] && t->qn[n] < SORT_FIFO) {
+			sort_push<RBITS>(t, n, t->reg[n]);
+			t->rv[n] = false;
+		}
+		t->fin[n] = !t->rv[n];
+		return;
+	}
+
+	if (lend)
+		c = r;
+	else if (rend)
+		c = l;
+	else if (sort_key<KBITS, RBITS>(t->q[r][0][0], kx) <
+		 sort_key<KBITS, RBITS>(t->q[l][0][0], kx))
+		c = r;
+	else	c = l;
+
+	if (!t->rv[n]) {
+		sort_pop<RBITS>(t, c, t->reg[n]);
+		t->rv[n] = true;
+	} else if (t->qn[n] < SORT_FIFO) {
+		sort_pop<RBITS>(t, c, w);
+		sort_merge2<KBITS, RBITS>(w, t->reg[n], kx);
+		sort_push<RBITS>(t, n, w);
+	}
+}
+
+/*
+ * Merge the SORT_WAYS runs of run records from record first on of the
+ * n records at src into dst at the same place. The last run can be
+ * shorter or missing. Words from memory are read in bursts into wbuf,
+ * one buffer per run, and written in bursts from obuf.
+ */
+template <int KBITS, int RBITS>
+static short sort_group(snap_membus_t *host, snap_membus_t *card,
+			sort_mem_t *src, sort_mem_t *dst, snapu64_t first,
+			snapu64_t run, snapu64_t n, ap_uint<KBITS> kx,
+			snap_membus_t wbuf[SORT_WAYS][SNAP_DMA_BURST_WORDS],
+			snap_membus_t *obuf, snap_perf_t *perf)
+{
+	const int R = SORT_NREC(RBITS);
+	sort_tree<RBITS> t;
+#pragma HLS ARRAY_PARTITION variable=t.q complete dim=2
+#pragma HLS ARRAY_PARTITION variable=t.q complete dim=3
+#pragma HLS ARRAY_PARTITION variable=t.reg complete dim=2
+	snapu64_t rleft[SORT_WAYS];	/* records of the run to come */
+	snapu64_t wnext[SORT_WAYS];	/* their first word */
+	snapu8_t bn[SORT_WAYS], bi[SORT_WAYS]; /* words in wbuf, next */
+	snapu64_t total = MIN((snapu64_t)(n - first),
+			      (snapu64_t)(SORT_WAYS * run));
+	snapu64_t owords = (total + R - 1) / R, oword = first / R;
+	snapu64_t done = 0, steps = 0, s;
+	snapu32_t on = 0;
+	short rc = 0;
+
+ sort_group_init:
+	for (int k = 0; k < SORT_NODES; k++) {
+		t.qn[k] = 0;
+		t.fin[k] = false;
+		if (k < SORT_WAYS) {
+			t.rv[k] = false;
+			s = first + k * run;
+			rleft[k] = s < n ? MIN(run, (snapu64_t)(n - s)) :
+				(snapu64_t)0;
+			wnext[k] = s / R;
+			bn[k] = 0;
+			bi[k] = 0;
+			t.fin[SORT_WAYS + k] = rleft[k] == 0;
+		}
+	}
+
+ sort_group_loop:
+	while (done < owords) {
+#pragma HLS PIPELINE
+		SORT_REC_T(RBITS) r[SORT_NREC(RBITS)];
+		snap_membus_t w;
+		snapu64_t k;
+		snapu8_t sel = SORT_WAYS;
+
+		/* the root passes a word per step out */
+		if (t.qn[1] != 0) {
+			sort_pop<RBITS>(&t, 1, r);
+			w = sort_pack<RBITS>(r);
+			if (dst->blk != NULL)
+				dst->blk[oword + done] = w;
+			else {
+				obuf[on++] = w;
+				if (on == SNAP_DMA_BURST_WORDS ||
+				    done + 1 == owords) {
+					rc |= snap_dma_write(host, card,
+						dst->type, dst->addr +
+						(oword + done + 1 - on) *
+						BPERDW, obuf, on * BPERDW,
+						perf);
+					on = 0;
+				}
+			}
+			done++;
+		}
+
+		/* mergers from the root down, so a word moves a level per step */
+	 sort_group_nodes:
+		for (int m = 1; m < SORT_WAYS; m++) {
+#pragma HLS UNROLL
+			sort_node<KBITS, RBITS>(&t, m, kx);
+		}
+
+		/* a leaf gets the next word of its run */
+	 sort_group_leaf1:
+		for (int j = SORT_WAYS - 1; j >= 0; j--) {
+#pragma HLS UNROLL
+			if (!t.fin[SORT_WAYS + j] && t.qn[SORT_WAYS + j] == 1)
+				sel = j;
+		}
+	 sort_group_leaf0:
+		for (int j = SORT_WAYS - 1; j >= 0; j--) {
+#pragma HLS UNROLL
+			if (!t.fin[SORT_WAYS + j] && t.qn[SORT_WAYS + j] == 0)
+				sel = j;
+		}
+		if (sel != SORT_WAYS) {
+			k = MIN(rleft[sel], (snapu64_t)R);
+			if (src->blk != NULL)
+				w = src->blk[wnext[sel]];
+			else {
+				if (bi[sel] == bn[sel]) {
+					bn[sel] = MIN((snapu64_t)((rleft[sel] + R - 1) / R),
+						(snapu64_t)SNAP_DMA_BURST_WORDS);
+					bi[sel] = 0;
+					rc |= snap_dma_read(host, card,
+						src->type, src->addr +
+						wnext[sel] * BPERDW,
+						wbuf[sel], bn[sel] * BPERDW,
+						perf);
+				}
+				w = wbuf[sel][bi[sel]++];
+			}
+			wnext[sel]++;
+			sort_unpack<RBITS>(w, k, r);
+			sort_push<RBITS>(&t, SORT_WAYS + sel, r);
+			rleft[sel] -= k;
+			t.fin[SORT_WAYS + sel] = rleft[sel] == 0;
+		}
+		steps++;
+	}
+	perf->cycles += steps;
+	return rc;
+}
+
+//----------------------------------------------------------------------
+//--- MAIN PROGRAM -----------------------------------------------------
+//----------------------------------------------------------------------
+template <int KBITS, int RBITS>
+static short sort_records(snap_membus_t *din_gmem, snap_membus_t *dout_gmem,
+			  snap_membus_t *d_ddrmem, action_reg *act_reg,
+			  snap_membus_t blk[2][SORT_BLOCK_WORDS],
+			  snap_membus_t wbuf[SORT_WAYS][SNAP_DMA_BURST_WORDS],
+			  snap_membus_t *obuf, snap_perf_t *perf)
+{
+	const int R = SORT_NREC(RBITS);
+	const snapu64_t BR = (snapu64_t)R * SORT_BLOCK_WORDS;
+	snapu64_t size = act_reg->Data.in.size;
+	snapu64_t n = size / (RBITS / 8);
+	snapu64_t nblk = (n + BR - 1) / BR, runs, run, first, nb;
+	snapu32_t passes = 0, words, p;
+	sort_mem_t mem[3], blks[2];
+	snapu8_t x, b;
+	ap_uint<KBITS> kx = 0, ones = -1;
+	short rc = 0;
+
+	if (size % (RBITS / 8) != 0 || act_reg->Data.out.size < size ||
+	    act_reg->Data.tmp.size < sort_tmp_size(size))
+		return 1;
+	if (act_reg->Data.flags & SORT_FLAG_SIGNED)
+		kx[KBITS - 1] = 1;
+	if (act_reg->Data.flags & SORT_FLAG_DESCENDING)
+		kx ^= ones;
+
+ sort_passes_loop:
+	for (runs = nblk; runs > 1; runs = (runs + SORT_WAYS - 1) / SORT_WAYS)
+		passes++;
+	act_reg->Data.runs = nblk;
+	act_reg->Data.passes = passes;
+
+	/* tmp halves A and B, the last pass writes out */
+	mem[0].blk = NULL;
+	mem[0].type = act_reg->Data.tmp.type;
+	mem[0].addr = act_reg->Data.tmp.addr;
+	mem[1].blk = NULL;
+	mem[1].type = act_reg->Data.tmp.type;
+	mem[1].addr = act_reg->Data.tmp.addr + sort_tmp_size(size) / 2;
+	mem[2].blk = NULL;
+	mem[2].type = act_reg->Data.out.type;
+	mem[2].addr = act_reg->Data.out.addr;
+	blks[0].blk = blk[0];
+	blks[1].blk = blk[1];
+	x = passes == 0 ? 2 : passes % 2 == 1 ? 0 : 1;
+
+	//--- BLOCKS ---
+ sort_block_loop:
+	for (first = 0; first < n; first += BR) {
+		nb = MIN(BR, (snapu64_t)(n - first));
+		words = (nb + R - 1) / R;
+		rc |= snap_dma_read(din_gmem, d_ddrmem, act_reg->Data.in.type,
+				    act_reg->Data.in.addr + first * (RBITS / 8),
+				    blk[0], words * BPERDW, perf);
+	 sort_words_loop:
+		for (snapu32_t i = 0; i < words; i++) {
+#pragma HLS PIPELINE
+			SORT_REC_T(RBITS) r[SORT_NREC(RBITS)];
+#pragma HLS ARRAY_PARTITION variable=r complete
+
+			sort_unpack<RBITS>(blk[0][i], nb - i * R, r);
+			sort_word<KBITS, RBITS>(r, kx);
+			blk[0][i] = sort_pack<RBITS>(r);
+		}
+		perf->cycles += words;
+
+		b = 0;
+	 sort_block_merge:
+		for (run = R; run < nb; run *= SORT_WAYS) {
+		 sort_block_group:
+			for (snapu64_t g = 0; g < nb; g += SORT_WAYS * run)
+				rc |= sort_group<KBITS, RBITS>(din_gmem,
+					d_ddrmem, &blks[b], &blks[b ^ 1], g,
+					run, nb, kx, wbuf, obuf, perf);
+			b ^= 1;
+		}
+		rc |= snap_dma_write(dout_gmem, d_ddrmem, mem[x].type,
+				     mem[x].addr + first * (RBITS / 8),
+				     blk[b], words * BPERDW, perf);
+	}
+
+	//--- MERGE PASSES ---
+	run = BR;
+ sort_pass_loop:
+	for (p = 0; p < passes; p++) {
+		b = p + 1 == passes ? (snapu8_t)2 : (snapu8_t)(x ^ 1);
+	 sort_pass_group:
+		for (first = 0; first < n; first += SORT_WAYS * run)
+			rc |= sort_group<KBITS, RBITS>(din_gmem, d_ddrmem,
+				&mem[x], &mem[b], first, run, n, kx, wbuf,
+				obuf, perf);
+		x = b;
+		run *= SORT_WAYS;
+	}
+	return rc;
+}
+
+static void process_action(snap_membus_t *din_gmem,
+			   snap_membus_t *dout_gmem,
+			   snap_membus_t *d_ddrmem,
+			   action_reg *act_reg,
+			   snap_perf_t *perf)
+{
+	static snap_membus_t blk[2][SORT_BLOCK_WORDS];
+	static snap_membus_t wbuf[SORT_WAYS][SNAP_DMA_BURST_WORDS];
+	static snap_membus_t obuf[SNAP_DMA_BURST_WORDS];
+#pragma HLS ARRAY_PARTITION variable=wbuf complete dim=1
+	snapu16_t kb = act_reg->Data.key_bytes;
+	snapu16_t rb = act_reg->Data.rec_bytes;
+	short rc;
+
+	snap_perf_clear(perf);
+	act_reg->Data.runs = 0;
+	act_reg->Data.passes = 0;
+	if (kb == 4 && rb == 4)
+		rc = sort_records<32, 32>(din_gmem, dout_gmem, d_ddrmem,
+					  act_reg, blk, wbuf, obuf, perf);
+	else if (kb == 4 && rb == 8)
+		rc = sort_records<32, 64>(din_gmem, dout_gmem, d_ddrmem,
+					  act_reg, blk, wbuf, obuf, perf);
+	else if (kb == 8 && rb == 8)
+		rc = sort_records<64, 64>(din_gmem, dout_gmem, d_ddrmem,
+					  act_reg, blk, wbuf, obuf, perf);
+	else if (kb == 8 && rb == 16)
+		rc = sort_records<64, 128>(din_gmem, dout_gmem, d_ddrmem,
+					   act_reg, blk, wbuf, obuf, perf);
+	else	rc = 1;
+
+	if (rc != 0)
+		act_reg->Control.Retc = SNAP_RETC_FAILURE;
+	else	act_reg->Control.Retc = SNAP_RETC_SUCCESS;
+}
+
+//--- TOP LEVEL MODULE -------------------------------------------------
+void hls_action(snap_membus_t *din_gmem,
+		snap_membus_t *dout_gmem,
+		snap_membus_t *d_ddrmem,
+		action_reg *act_reg,
+		action_RO_config_reg *Action_Config,
+		snap_perf_t *Action_Perf)
+{
+	// Host Memory AXI Interface
+#pragma HLS INTERFACE m_axi port=din_gmem bundle=host_mem offset=slave depth=512 \
+  max_read_burst_length=64  max_write_burst_length=64 \
+  num_read_outstanding=8  num_write_outstanding=8
+#pragma HLS INTERFACE s_axilite port=din_gmem bundle=ctrl_reg offset=0x030
+
+#pragma HLS INTERFACE m_axi port=dout_gmem bundle=host_mem offset=slave depth=512 \
+  max_read_burst_length=64  max_write_burst_length=64 \
+  num_read_outstanding=8  num_write_outstanding=8
+#pragma HLS INTERFACE s_axilite port=dout_gmem bundle=ctrl_reg offset=0x040
+
+	// DDR memory Interface
+#pragma HLS INTERFACE m_axi port=d_ddrmem bundle=card_mem0 offset=slave depth=512 \
+  max_read_burst_length=64  max_write_burst_length=64 \
+  num_read_outstanding=8  num_write_outstanding=8
+#pragma HLS INTERFACE s_axilite port=d_ddrmem bundle=ctrl_reg offset=0x050
+
+	// Host Memory AXI Lite Master Interface
+#pragma HLS DATA_PACK variable=Action_Config
+#pragma HLS INTERFACE s_axilite port=Action_Config bundle=ctrl_reg offset=0x010
+#pragma HLS DATA_PACK variable=act_reg
+#pragma HLS INTERFACE s_axilite port=act_reg bundle=ctrl_reg offset=0x100
+#pragma HLS INTERFACE s_axilite port=return bundle=ctrl_reg
+
+	// Performance counters of the job, ACTION_PERF
+#pragma HLS DATA_PACK variable=Action_Perf
+#pragma HLS INTERFACE s_axilite port=Action_Perf bundle=ctrl_reg offset=0x080
+
+	/* Required Action Type Detection */
+	switch (act_reg->Control.flags) {
+	case 0:
+		Action_Config->action_type = SORT_ACTION_TYPE;
+		Action_Config->release_level = RELEASE_LEVEL;
+		act_reg->Control.Retc = 0xe00f;
+		return;
+	default:
+		process_action(din_gmem, dout_gmem, d_ddrmem, act_reg,
+			       Action_Perf);
+		break;
+	}
+}
+
+//-----------------------------------------------------------------------------
+//--- TESTBENCH ---------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
+#if defined(NO_SYNTH) && !defined(HLS_SWEMU)
+
+#include <stdlib.h>
+
+static action_reg act_reg;
+static action_RO_config_reg Action_Config;
+static snap_perf_t Action_Perf;
+
+#define MEM_SIZE	(2 * 1024 * 1024)
+#define IN		0
+#define OUT		(512 * 1024)
+#define REF		(1024 * 1024)
+#define DDR_SIZE	(1024 * 1024)
+
+static unsigned int rec_bytes;		/* for rec_cmp() */
+
+static uint32_t lcg(uint32_t *x)
+{
+	*x = *x * 1103515245U + 12345U;
+	return *x >> 16;
+}
+
+/* Key of the record at p as it is compared */
+static uint64_t key(const uint8_t *p, unsigned int kb, uint32_t flags)
+{
+	uint64_t k = 0;
+
+	memcpy(&k, p, kb);
+	if (flags & SORT_FLAG_SIGNED)
+		k ^= 1ull << (kb * 8 - 1);
+	if (flags & SORT_FLAG_DESCENDING)
+		k = ~k & (kb == 8 ? ~0ull : 0xffffffffull);
+	return k;
+}
+
+static int rec_cmp(const void *a, const void *b)
+{
+	return memcmp(a, b, rec_bytes);
+}
+
+/* Sort n records of the format at IN to OUT, tmp in card memory ddr */
+static int run(snap_membus_t *mem, snap_membus_t *ddr, unsigned int kb,
+	       unsigned int rb, uint64_t n, uint32_t flags)
+{
+	act_reg.Control.flags = 0x1; /* just not 0x0 */
+	act_reg.Data.in.addr = IN;
+	act_reg.Data.in.size = n * rb;
+	act_reg.Data.in.type = SNAP_ADDRTYPE_HOST_DRAM;
+	act_reg.Data.out.addr = OUT;
+	act_reg.Data.out.size = n * rb;
+	act_reg.Data.out.type = SNAP_ADDRTYPE_HOST_DRAM;
+	act_reg.Data.tmp.addr = 0;
+	act_reg.Data.tmp.size = DDR_SIZE;
+	act_reg.Data.tmp.type = SNAP_ADDRTYPE_CARD_DRAM;
+	act_reg.Data.key_bytes = kb;
+	act_reg.Data.rec_bytes = rb;
+	act_reg.Data.flags = flags;
+
+	hls_action(mem, mem, ddr, &act_reg, &Action_Config, &Action_Perf);
+	return act_reg.Control.Retc == SNAP_RETC_SUCCESS ? 0 : 1;
+}
+
+/* OUT is in order and the same records as IN */
+static int check(uint8_t *m, unsigned int kb, unsigned int rb, uint64_t n,
+		 uint32_t flags)
+{
+	uint64_t i;
+
+	for (i = 1; i < n; i++)
+		if (key(m + OUT + (i - 1) * rb, kb, flags) >
+		    key(m + OUT + i * rb, kb, flags))
+			return 1;
+	rec_bytes = rb;
+	memcpy(m + REF, m + IN, n * rb);
+	qsort(m + REF, n, rb, rec_cmp);
+	qsort(m + OUT, n, rb, rec_cmp);
+	return memcmp(m + REF, m + OUT, n * rb) != 0;
+}
+
+int main(void)
+{
+	static const unsigned int fmts[4][2] = {
+		{ 4, 4 }, { 4, 8 }, { 8, 8 }, { 8, 16 } };
+	static const struct {
+		const char *name;
+		uint32_t mask;		/* of random key bits */
+		uint32_t flags;
+	} kinds[] = {
+		{ "RANDOM", 0xffffffff, 0 },
+		{ "FEW KEYS", 0x7, 0 },
+		{ "DESCENDING", 0xffffffff, SORT_FLAG_DESCENDING },
+		{ "SIGNED", 0xffffffff, SORT_FLAG_SIGNED },
+	};
+	snap_membus_t *mem = (snap_membus_t *)calloc(1, MEM_SIZE);
+	snap_membus_t *ddr = (snap_membus_t *)calloc(1, DDR_SIZE);
+	uint8_t *m = (uint8_t *)mem;
+	unsigned int f, i, c, kb, rb, nrec;
+	uint64_t ns[6], n;
+	uint32_t x = 1, v;
+
+	if (mem == NULL || ddr == NULL)
+		return 1;
+
+	/* Query ACTION_TYPE ... */
+	act_reg.Control.flags = 0x0;
+	hls_action(mem, mem, ddr, &act_reg, &Action_Config, &Action_Perf);
+	fprintf(stderr,
+		"ACTION_TYPE:   %08x\n"
+		"RELEASE_LEVEL: %08x\n"
+		"RETC:          %04x\n",
+		(unsigned int)Action_Config.action_type,
+		(unsigned int)Action_Config.release_level,
+		(unsigned int)act_reg.Control.Retc);
+
+	for (f = 0; f < 4; f++) {
+		kb = fmts[f][0];
+		rb = fmts[f][1];
+		nrec = BPERDW / rb;
+
+		/* none, part of a word, a block, one and two merge passes */
+		ns[0] = 0;
+		ns[1] = 1;
+		ns[2] = nrec - 1;
+		ns[3] = SORT_BLOCK_SIZE / rb;
+		ns[4] = 3 * SORT_BLOCK_SIZE / rb + 5;
+		ns[5] = (SORT_WAYS + 1) * SORT_BLOCK_SIZE / rb + 3;
+
+		for (c = 0; c < sizeof(kinds) / sizeof(kinds[0]); c++) {
+			for (i = 0; i < 6; i++) {
+				n = ns[i];
+				/* random keys, the payload counts */
+				for (uint64_t r = 0; r < n * rb / 4; r++) {
+					v = lcg(&x) << 16 ^ lcg(&x);
+					if ((r * 4 / kb) % (rb / kb) == 0)
+						v &= kinds[c].mask;
+					else	v = r;
+					memcpy(m + IN + r * 4, &v, 4);
+				}
+				if (run(mem, ddr, kb, rb, n, kinds[c].flags) ||
+				    check(m, kb, rb, n, kinds[c].flags)) {
+					fprintf(stderr, " ==> %u/%u %s %llu "
+						"FAILURE <==\n", kb, rb,
+						kinds[c].name,
+						(unsigned long long)n);
+					return 1;
+				}
+			}
+			printf(" ==> KEY %u RECORD %u %s OK, %u RUNS %u "
+			       "PASSES %llu CYCLES <==\n", kb, rb,
+			       kinds[c].name, (unsigned int)act_reg.Data.runs,
+			       (unsigned int)act_reg.Data.passes,
+			       (unsigned long long)Action_Perf.cycles);
+		}
+	}
+
+	/* Bad formats and a tmp too small fail */
+	if (run(mem, ddr, 8, 4, 16, 0) == 0 ||
+	    run(mem, ddr, 4, 12, 16, 0) == 0) {
+		fprintf(stderr, " ==> BAD FORMAT NOT DETECTED <==\n");
+		return 1;
+	}
+	act_reg.Data.tmp.size = 0;
+	act_reg.Data.key_bytes = 8;
+	act_reg.Data.rec_bytes = 8;
+	act_reg.Data.in.size = 2 * SORT_BLOCK_SIZE;
+	act_reg.Data.out.size = 2 * SORT_BLOCK_SIZE;
+	hls_action(mem, mem, ddr, &act_reg, &Action_Config, &Action_Perf);
+	if (act_reg.Control.Retc == SNAP_RETC_SUCCESS) {
+		fprintf(stderr, " ==> SMALL TMP NOT DETECTED <==\n");
+		return 1;
+	}
+	free(ddr);
+	free(mem);
+
+	printf(">> ACTION TYPE = %08lx - RELEASE_LEVEL = %08lx <<\n",
+	       (unsigned long)Action_Config.action_type,
+	       (unsigned long)Action_Config.release_level);
+	return 0;
+}
+
+#endif
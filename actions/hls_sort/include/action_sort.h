@@ -0,0 +1,74 @@
+#ifndef __ACTION_SORT_H__
+#define __ACTION_SORT_H__
+
+/*
+ * Copyright 2017 International Business Machines
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <snap_types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SORT_ACTION_TYPE 0x10141009
+
+/* sort_job.flags */
+#define SORT_FLAG_DESCENDING	0x1	/* largest key first */
+#define SORT_FLAG_SIGNED	0x2	/* keys are two's complement */
+
+#define SORT_BLOCK_SIZE		(16 * 1024)	/* sorted on-chip */
+#define SORT_WAYS		16		/* runs merged per pass */
+
+/*
+ * Sort of in.size / rec_bytes records of rec_bytes each by their key,
+ * an integer of key_bytes in little endian at the start of the record.
+ * A record is the key alone or the key followed by a payload of the
+ * same size, e.g. a row id. The order of records with the same key is
+ * not defined.
+ *
+ * Blocks of SORT_BLOCK_SIZE bytes are sorted on-chip into runs, the
+ * runs are merged SORT_WAYS at a time through tmp until one is left,
+ * which goes to out. tmp is card DRAM usually, host memory works as
+ * well, and needs sort_tmp_size(in.size) bytes.
+ *
+ * in, out and tmp must be 64 byte aligned and out must have room for
+ * in.size rounded up to 64 bytes, the last bus word is written in
+ * full.
+ */
+typedef struct sort_job {
+	struct snap_addr in;	/* in:  records */
+	struct snap_addr out;	/* in:  the records sorted */
+	struct snap_addr tmp;	/* in:  runs between the merge passes */
+	uint16_t key_bytes;	/* in:  4 or 8 */
+	uint16_t rec_bytes;	/* in:  key_bytes or 2 * key_bytes */
+	uint32_t flags;		/* in:  SORT_FLAG_* */
+	uint32_t runs;		/* out: blocks sorted on-chip */
+	uint32_t passes;	/* out: merge passes over them */
+} sort_job_t;
+
+/* Bytes of tmp a sort of size bytes needs, two copies of the runs */
+static inline uint64_t sort_tmp_size(uint64_t size)
+{
+	if (size <= SORT_BLOCK_SIZE)
+		return 0;
+	return 2 * ((size + 4095) & ~4095ull);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif	/* __ACTION_SORT_H__ */
@@ -0,0 +1,335 @@
+/*
+ * Copyright 2017 International Business Machines
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Software version of the sort action, see include/action_sort.h.
+ *
+ * The records are split into one part per thread, each thread sorts
+ * its part by merge sort. The sorted parts are merged pairwise, a
+ * thread per pair, until one is left. tmp is the scratch space of
+ * the merges, like the action uses it, so the job takes and checks
+ * the same memory. runs and passes are what the action reports.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <pthread.h>
+#include <libsnap.h>
+
+#include <snap_internal.h>
+#include <snap_tools.h>
+#include <action_sort.h>
+
+#define SORT_THREADS		16	/* at most */
+#define SORT_PART_MIN		(64 * 1024)	/* records per thread */
+#define SORT_INSERT		16	/* insertion sorted first */
+
+struct sort_part {
+	pthread_t thread;
+	int started;		/* else sorted by the caller */
+	uint8_t *a, *b;		/* records and the same room in tmp */
+	uint64_t n, m;		/* records, first m sorted by themselves */
+	unsigned int rb, kb;
+	uint64_t kx;		/* flips the bits of a key to compare */
+	int in_b;		/* result is in b */
+};
+
+static struct snap_card *sort_card;	/* for the emulated card DRAM */
+
+static int mmio_write32(struct snap_card *card,
+			uint64_t offs, uint32_t data)
+{
+	act_trace("  %s(%p, %llx, %x)\n", __func__, card,
+		  (long long)offs, data);
+	sort_card = card;
+	return 0;
+}
+
+static int mmio_read32(struct snap_card *card,
+		       uint64_t offs, uint32_t *data)
+{
+	act_trace("  %s(%p, %llx, %x)\n", __func__, card,
+		  (long long)offs, *data);
+	sort_card = card;
+	return 0;
+}
+
+/* Memory behind a job address, NULL if it cannot be reached */
+static uint8_t *sort_mem(const struct snap_addr *a)
+{
+	switch (a->type) {
+	case SNAP_ADDRTYPE_HOST_DRAM:
+		return (uint8_t *)(unsigned long)a->addr;
+	case SNAP_ADDRTYPE_CARD_DRAM:
+		if (sort_card == NULL)
+			return NULL;
+		return snap_card_ddr_emu(sort_card, a->addr, a->size);
+	default:
+		return NULL;
+	}
+}
+
+/*
+ * The helpers below get key and record size as constants from
+ * sort_thread(), so the compiler builds a loop per record format.
+ */
+static inline uint64_t sort_key(const uint8_t *r, unsigned int kb,
+				uint64_t kx)
+{
+	uint32_t k32;
+	uint64_t k64;
+
+	if (kb == 4) {
+		memcpy(&k32, r, 4);
+		return k32 ^ kx;
+	}
+	memcpy(&k64, r, 8);
+	return k64 ^ kx;
+}
+
+/* Merge the sorted records a[0..na) and b[0..nb) to dst */
+static inline void sort_merge(const uint8_t *a, uint64_t na,
+			      const uint8_t *b, uint64_t nb, uint8_t *dst,
+			      unsigned int kb, unsigned int rb, uint64_t kx)
+{
+	const uint8_t *ae = a + na * rb, *be = b + nb * rb;
+	int take_b;
+
+	/* without a branch, which would go either way */
+	while (a < ae && b < be) {
+		take_b = sort_key(b, kb, kx) < sort_key(a, kb, kx);
+		memcpy(dst, take_b ? b : a, rb);
+		b += take_b * rb;
+		a += !take_b * rb;
+		dst += rb;
+	}
+	memcpy(dst, a, ae - a);
+	memcpy(dst + (ae - a), b, be - b);
+}
+
+/* Insertion sort of n records */
+static inline void sort_insert(uint8_t *r, uint64_t n, unsigned int kb,
+			       unsigned int rb, uint64_t kx)
+{
+	uint8_t t[16];
+	uint64_t i, j, k;
+
+	for (i = 1; i < n; i++) {
+		memcpy(t, r + i * rb, rb);
+		k = sort_key(t, kb, kx);
+		for (j = i; j > 0 && k < sort_key(r + (j - 1) * rb, kb, kx);
+		     j--)
+			memcpy(r + j * rb, r + (j - 1) * rb, rb);
+		memcpy(r + j * rb, t, rb);
+	}
+}
+
+/*
+ * Bottom-up merge sort of the n records of a part, going back and
+ * forth between a and b. Runs of m records are sorted already.
+ */
+static inline void sort_part(struct sort_part *p, unsigned int kb,
+			     unsigned int rb)
+{
+	uint64_t run, i, na, nb;
+	uint8_t *src = p->in_b ? p->b : p->a;
+	uint8_t *dst = p->in_b ? p->a : p->b, *t;
+
+	if (p->m == 1) {
+		for (i = 0; i < p->n; i += SORT_INSERT)
+			sort_insert(src + i * rb,
+				    MIN(p->n - i, (uint64_t)SORT_INSERT),
+				    kb, rb, p->kx);
+		run = SORT_INSERT;
+	} else	run = p->m;
+
+	for (; run < p->n; run *= 2) {
+		for (i = 0; i < p->n; i += 2 * run) {
+			na = MIN(run, p->n - i);
+			nb = MIN(run, p->n - i - na);
+			sort_merge(src + i * rb, na, src + (i + na) * rb, nb,
+				   dst + i * rb, kb, rb, p->kx);
+		}
+		t = src;
+		src = dst;
+		dst = t;
+		p->in_b ^= 1;
+	}
+}
+
+static void *sort_thread(void *arg)
+{
+	struct sort_part *p = arg;
+
+	switch (p->kb << 8 | p->rb) {
+	case 0x404:
+		sort_part(p, 4, 4);
+		break;
+	case 0x408:
+		sort_part(p, 4, 8);
+		break;
+	case 0x808:
+		sort_part(p, 8, 8);
+		break;
+	default:
+		sort_part(p, 8, 16);
+		break;
+	}
+	return NULL;
+}
+
+/* Run a part on its own thread, or right here if there is none */
+static void sort_start(struct sort_part *p)
+{
+	p->started = (pthread_create(&p->thread, NULL, sort_thread, p) == 0);
+	if (!p->started)
+		sort_thread(p);
+}
+
+static void sort_wait(struct sort_part *p)
+{
+	if (p->started)
+		pthread_join(p->thread, NULL);
+}
+
+/* Sort the n records at out, with room for as many at tmp */
+static void sort_records(uint8_t *out, uint8_t *tmp, uint64_t n,
+			 unsigned int kb, unsigned int rb, uint32_t flags)
+{
+	struct sort_part parts[SORT_THREADS], *p, *q;
+	long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	uint64_t per, first = 0, k;
+	unsigned int np, i, width;
+
+	np = MAX(1, MIN(cpus, (long)SORT_THREADS));
+	np = MIN((uint64_t)np, (n + SORT_PART_MIN - 1) / SORT_PART_MIN);
+	if (np == 0)
+		return;
+	per = (n + np - 1) / np;
+
+	/* each thread sorts its part */
+	for (i = 0; i < np; i++) {
+		p = &parts[i];
+		k = MIN(per, n - first);
+		p->a = out + first * rb;
+		p->b = tmp + first * rb;
+		p->n = k;
+		p->m = 1;
+		p->in_b = 0;
+		p->kb = kb;
+		p->rb = rb;
+		p->kx = 0;
+		if (flags & SORT_FLAG_SIGNED)
+			p->kx ^= 1ull << (kb * 8 - 1);
+		if (flags & SORT_FLAG_DESCENDING)
+			p->kx ^= kb == 8 ? ~0ull : 0xffffffffull;
+		first += k;
+		sort_start(p);
+	}
+	for (i = 0; i < np; i++)
+		sort_wait(&parts[i]);
+
+	/* then pairwise, the right part moves to where the left one is */
+	for (width = 1; width < np; width *= 2) {
+		for (i = 0; i + width < np; i += 2 * width) {
+			p = &parts[i];
+			q = &parts[i + width];
+			if (q->in_b != p->in_b)
+				memcpy(p->in_b ? q->b : q->a,
+				       p->in_b ? q->a : q->b, q->n * rb);
+			p->m = p->n;
+			p->n += parts[i + width].n;
+			sort_start(p);
+		}
+		for (i = 0; i + width < np; i += 2 * width)
+			sort_wait(&parts[i]);
+	}
+	if (parts[0].in_b)
+		memcpy(out, tmp, n * rb);
+}
+
+static int action_main(struct snap_sim_action *action,
+		       void *job, unsigned int job_len)
+{
+	struct sort_job *js = (struct sort_job *)job;
+	uint64_t size = js->in.size, tsize = sort_tmp_size(size);
+	uint64_t runs, n;
+	uint8_t *in, *out, *tmp, small[SORT_BLOCK_SIZE];
+	unsigned int kb = js->key_bytes, rb = js->rec_bytes;
+
+	act_trace("%s(%p, %p, %d) in=%lld key=%d rec=%d flags=%x\n",
+		  __func__, action, job, job_len, (long long)size, kb, rb,
+		  js->flags);
+
+	js->runs = 0;
+	js->passes = 0;
+	if ((kb != 4 && kb != 8) || (rb != kb && rb != 2 * kb) ||
+	    size % rb != 0 || js->out.size < size || js->tmp.size < tsize) {
+		act_trace("  err: bad job\n");
+		goto out_err;
+	}
+	in = sort_mem(&js->in);
+	out = sort_mem(&js->out);
+	tmp = tsize != 0 ? sort_mem(&js->tmp) : small;
+	if (in == NULL || out == NULL || tmp == NULL) {
+		act_trace("  err: memory type not supported\n");
+		goto out_err;
+	}
+
+	n = size / rb;
+	js->runs = (size + SORT_BLOCK_SIZE - 1) / SORT_BLOCK_SIZE;
+	for (runs = js->runs; runs > 1;
+	     runs = (runs + SORT_WAYS - 1) / SORT_WAYS)
+		js->passes++;
+
+	memmove(out, in, size);
+	sort_records(out, tmp, n, kb, rb, js->flags);
+	action->perf.rd_bytes = size;
+	action->perf.wr_bytes = size;
+
+	action->job.retc = SNAP_RETC_SUCCESS;
+	return 0;
+
+ out_err:
+	action->job.retc = SNAP_RETC_FAILURE;
+	return 0;
+}
+
+static struct snap_sim_action action = {
+	.vendor_id = SNAP_VENDOR_ID_ANY,
+	.device_id = SNAP_DEVICE_ID_ANY,
+	.action_type = SORT_ACTION_TYPE,
+
+	.job = { .retc = SNAP_RETC_FAILURE, },
+	.state = ACTION_IDLE,
+	.main = action_main,
+	.priv_data = NULL,	/* this is passed back as void *card */
+	.mmio_write32 = mmio_write32,
+	.mmio_read32 = mmio_read32,
+
+	.next = NULL,
+};
+
+static void _init(void) __attribute__((constructor));
+
+static void _init(void)
+{
+	snap_action_register(&action);
+}
@@ -0,0 +1,380 @@
+/*
+ * Copyright 2017 International Business Machines
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Sort of 32 or 64 bit keys or key-payload pairs with the sort action.
+ *
+ * The records come from a file or are generated: random keys, the
+ * payload counts the records, so it is the row id of the key. One job
+ * sorts all of them, the merge passes go through card DRAM from
+ * address 0, or through host memory with -H. -c checks the result:
+ * keys in order and the same records as before.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <malloc.h>
+#include <errno.h>
+#include <string.h>
+#include <sys/time.h>
+#include <assert.h>
+
+#include <snap_tools.h>
+#include <action_sort.h>
+#include <libsnap.h>
+#include <snap_hls_if.h>
+
+int verbose_flag = 0;
+
+static const char *version = GIT_VERSION;
+
+/**
+ * @brief	prints valid command line options
+ *
+ * @param prog	current program's name
+ */
+static void usage(const char *prog)
+{
+	printf("Usage: %s [-h] [-v, --verbose] [-V, --version]\n"
+	       "  -C, --card <cardno>       can be (0...3)\n"
+	       "  -i, --input <file>        input file of records.\n"
+	       "  -o, --output <file>       output file, the records sorted.\n"
+	       "  -n, --records <n>         random records instead of a file.\n"
+	       "  -k, --key <bytes>         key of 4 or 8 bytes (8 default).\n"
+	       "  -p, --payload             a payload of the key size follows.\n"
+	       "  -D, --descending          largest key first.\n"
+	       "  -S, --signed              keys are signed.\n"
+	       "  -H, --host-tmp            merge through host memory instead\n"
+	       "                            of card DRAM.\n"
+	       "  -s, --seed <seed>         of the random records.\n"
+	       "  -c, --check               check the result.\n"
+	       "  -t, --timeout             Timeout in sec to wait for done. (60 sec default)\n"
+	       "\n"
+	       "Example:\n"
+	       "  snap_sort -n 1000000 -p -c\n"
+	       "\n",
+	       prog);
+}
+
+static uint64_t xorshift(uint64_t *x)
+{
+	*x ^= *x << 13;
+	*x ^= *x >> 7;
+	*x ^= *x << 17;
+	return *x;
+}
+
+/* Key of the record at p as it is compared */
+static uint64_t sort_key(const uint8_t *p, unsigned int kb, uint32_t flags)
+{
+	uint64_t k = 0;
+
+	memcpy(&k, p, kb);
+	if (flags & SORT_FLAG_SIGNED)
+		k ^= 1ull << (kb * 8 - 1);
+	if (flags & SORT_FLAG_DESCENDING)
+		k ^= kb == 8 ? ~0ull : 0xffffffffull;
+	return k;
+}
+
+/* Sum of the hashes of the records, the same for any order */
+static uint64_t rec_sum(const uint8_t *p, uint64_t n, unsigned int rb)
+{
+	uint64_t sum = 0, h, i;
+	unsigned int k;
+
+	for (i = 0; i < n; i++, p += rb) {
+		h = 0xcbf29ce484222325ull;
+		for (k = 0; k < rb; k++)
+			h = (h ^ p[k]) * 0x100000001b3ull;
+		sum += h ^ (h >> 29);
+	}
+	return sum;
+}
+
+static int check(const uint8_t *in, const uint8_t *out, uint64_t n,
+		 unsigned int kb, unsigned int rb, uint32_t flags)
+{
+	uint64_t i;
+
+	for (i = 1; i < n; i++) {
+		if (sort_key(out + (i - 1) * rb, kb, flags) >
+		    sort_key(out + i * rb, kb, flags)) {
+			fprintf(stderr, "err: record %lld out of order\n",
+				(long long)i);
+			return -1;
+		}
+	}
+	if (rec_sum(in, n, rb) != rec_sum(out, n, rb)) {
+		fprintf(stderr, "err: records differ from the input\n");
+		return -1;
+	}
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	int ch, rc = 0;
+	int card_no = 0;
+	struct snap_card *card = NULL;
+	struct snap_action *action = NULL;
+	struct snap_job cjob;
+	struct sort_job job;
+	struct snap_action_perf perf;
+	char device[128];
+	const char *input = NULL;
+	const char *output = NULL;
+	unsigned long timeout = 60;
+	unsigned int kb = 8, rb, payload = 0, host_tmp = 0, chk = 0;
+	uint32_t flags = 0;
+	uint64_t n = 0, size, tsize, i, seed = 1;
+	unsigned long sdram_mb = 0;
+	struct timeval etime, stime;
+	ssize_t fsize;
+	uint8_t *ibuff = NULL, *obuff = NULL, *tbuff = NULL;
+	long long usec;
+	FILE *fp;
+
+	while (1) {
+		int option_index = 0;
+		static struct option long_options[] = {
+			{ "card",	 required_argument, NULL, 'C' },
+			{ "input",	 required_argument, NULL, 'i' },
+			{ "output",	 required_argument, NULL, 'o' },
+			{ "records",	 required_argument, NULL, 'n' },
+			{ "key",	 required_argument, NULL, 'k' },
+			{ "payload",	 no_argument,	    NULL, 'p' },
+			{ "descending",	 no_argument,	    NULL, 'D' },
+			{ "signed",	 no_argument,	    NULL, 'S' },
+			{ "host-tmp",	 no_argument,	    NULL, 'H' },
+			{ "seed",	 required_argument, NULL, 's' },
+			{ "check",	 no_argument,	    NULL, 'c' },
+			{ "timeout",	 required_argument, NULL, 't' },
+			{ "version",	 no_argument,	    NULL, 'V' },
+			{ "verbose",	 no_argument,	    NULL, 'v' },
+			{ "help",	 no_argument,	    NULL, 'h' },
+			{ 0,		 no_argument,	    NULL, 0   },
+		};
+
+		ch = getopt_long(argc, argv, "C:i:o:n:k:pDSHs:ct:Vvh",
+				 long_options, &option_index);
+		if (ch == -1)
+			break;
+
+		switch (ch) {
+		case 'C':
+			card_no = strtol(optarg, (char **)NULL, 0);
+			break;
+		case 'i':
+			input = optarg;
+			break;
+		case 'o':
+			output = optarg;
+			break;
+		case 'n':
+			n = strtoull(optarg, (char **)NULL, 0);
+			break;
+		case 'k':
+			kb = strtol(optarg, (char **)NULL, 0);
+			break;
+		case 'p':
+			payload = 1;
+			break;
+		case 'D':
+			flags |= SORT_FLAG_DESCENDING;
+			break;
+		case 'S':
+			flags |= SORT_FLAG_SIGNED;
+			break;
+		case 'H':
+			host_tmp = 1;
+			break;
+		case 's':
+			seed = strtoull(optarg, (char **)NULL, 0);
+			break;
+		case 'c':
+			chk = 1;
+			break;
+		case 't':
+			timeout = strtol(optarg, (char **)NULL, 0);
+			break;
+			/* service */
+		case 'V':
+			printf("%s\n", version);
+			exit(EXIT_SUCCESS);
+		case 'v':
+			verbose_flag = 1;
+			break;
+		case 'h':
+			usage(argv[0]);
+			exit(EXIT_SUCCESS);
+			break;
+		default:
+			usage(argv[0]);
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	rb = payload ? 2 * kb : kb;
+	if (optind != argc || (kb != 4 && kb != 8) ||
+	    (input != NULL && n != 0)) {
+		usage(argv[0]);
+		exit(EXIT_FAILURE);
+	}
+
+	if (input != NULL) {
+		fsize = __file_size(input);
+		if (fsize < 0)
+			goto out_error;
+		if (fsize % rb != 0) {
+			fprintf(stderr, "err: %s is not made of %u byte "
+				"records\n", input, rb);
+			goto out_error;
+		}
+		n = fsize / rb;
+	}
+	size = n * rb;
+	tsize = host_tmp ? sort_tmp_size(size) : 0;
+
+	/* room for the last bus word in full */
+	ibuff = snap_malloc(size + 64);
+	obuff = snap_malloc(size + 64);
+	if (tsize != 0)
+		tbuff = snap_malloc(tsize);
+	if (ibuff == NULL || obuff == NULL || (tsize != 0 && tbuff == NULL))
+		goto out_error;
+	if (input != NULL && size != 0 &&
+	    __file_read(input, ibuff, size) < 0)
+		goto out_error;
+	if (input == NULL) {
+		for (i = 0; i < n; i++) {
+			uint64_t key = xorshift(&seed);
+
+			memcpy(ibuff + i * rb, &key, kb);
+			if (payload)
+				memcpy(ibuff + i * rb + kb, &i, kb);
+		}
+	}
+
+	snprintf(device, sizeof(device)-1, "/dev/cxl/afu%d.0s", card_no);
+	card = snap_card_alloc_dev(device, SNAP_VENDOR_ID_IBM,
+				   SNAP_DEVICE_ID_SNAP);
+	if (card == NULL) {
+		fprintf(stderr, "err: failed to open card %u: %s\n",
+			card_no, strerror(errno));
+		goto out_error;
+	}
+
+	if (!host_tmp) {
+		tsize = sort_tmp_size(size);
+		snap_card_ioctl(card, GET_SDRAM_SIZE,
+				(unsigned long)&sdram_mb);
+		if (sdram_mb != 0 && tsize > (uint64_t)sdram_mb << 20) {
+			fprintf(stderr, "err: %lld MiB of card DRAM needed, "
+				"%ld MiB there, use -H\n",
+				(long long)(tsize >> 20), sdram_mb);
+			goto out_error1;
+		}
+	}
+
+	action = snap_attach_action(card, SORT_ACTION_TYPE, 0, 60);
+	if (action == NULL) {
+		fprintf(stderr, "err: failed to attach action %u: %s\n",
+			card_no, strerror(errno));
+		goto out_error1;
+	}
+
+	assert(sizeof(job) <= SNAP_JOBSIZE);
+	memset(&job, 0, sizeof(job));
+	snap_addr_set(&job.in, ibuff, size, SNAP_ADDRTYPE_HOST_DRAM,
+		      SNAP_ADDRFLAG_ADDR | SNAP_ADDRFLAG_SRC);
+	snap_addr_set(&job.out, obuff, size, SNAP_ADDRTYPE_HOST_DRAM,
+		      SNAP_ADDRFLAG_ADDR | SNAP_ADDRFLAG_DST);
+	if (host_tmp)
+		snap_addr_set(&job.tmp, tbuff, tsize,
+			      SNAP_ADDRTYPE_HOST_DRAM,
+			      SNAP_ADDRFLAG_ADDR | SNAP_ADDRFLAG_SRC |
+			      SNAP_ADDRFLAG_DST | SNAP_ADDRFLAG_END);
+	else	snap_addr_set(&job.tmp, (void *)0, tsize,
+			      SNAP_ADDRTYPE_CARD_DRAM,
+			      SNAP_ADDRFLAG_ADDR | SNAP_ADDRFLAG_SRC |
+			      SNAP_ADDRFLAG_DST | SNAP_ADDRFLAG_END);
+	job.key_bytes = kb;
+	job.rec_bytes = rb;
+	job.flags = flags;
+	snap_job_set(&cjob, &job, sizeof(job), NULL, 0);
+
+	gettimeofday(&stime, NULL);
+	rc = snap_action_sync_execute_job(action, &cjob, timeout);
+	gettimeofday(&etime, NULL);
+	if (rc != 0) {
+		fprintf(stderr, "err: job execution %d: %s!\n", rc,
+			strerror(errno));
+		goto out_error2;
+	}
+	if (cjob.retc != SNAP_RETC_SUCCESS) {
+		fprintf(stderr, "err: Unexpected RETC=%x!\n", cjob.retc);
+		goto out_error2;
+	}
+
+	usec = timediff_usec(&etime, &stime);
+	fprintf(stdout, "sort %lld records of %u bytes in %u runs and %u "
+		"merge passes took %lld usec (%lld MiB/s)\n", (long long)n,
+		rb, job.runs, job.passes, usec,
+		usec ? (long long)(size * 1000000ull / usec >> 20) : 0ll);
+	if (verbose_flag && snap_action_perf(action, &perf) == 0)
+		fprintf(stdout, "cycles %lld read %lld bytes written %lld "
+			"bytes stalls read %lld write %lld\n",
+			(long long)perf.cycles, (long long)perf.rd_bytes,
+			(long long)perf.wr_bytes, (long long)perf.rd_stall,
+			(long long)perf.wr_stall);
+
+	if (chk && check(ibuff, obuff, n, kb, rb, flags) != 0)
+		goto out_error2;
+	if (output != NULL) {
+		fp = fopen(output, "w");
+		if (fp == NULL || (size != 0 &&
+				   fwrite(obuff, size, 1, fp) != 1)) {
+			fprintf(stderr, "err: cannot write %s: %s\n", output,
+				strerror(errno));
+			if (fp != NULL)
+				fclose(fp);
+			goto out_error2;
+		}
+		if (fclose(fp) != 0)
+			goto out_error2;
+	}
+
+	snap_detach_action(action);
+	snap_card_free(card);
+	__free(tbuff);
+	__free(obuff);
+	__free(ibuff);
+	exit(EXIT_SUCCESS);
+
+ out_error2:
+	snap_detach_action(action);
+ out_error1:
+	snap_card_free(card);
+ out_error:
+	__free(tbuff);
+	__free(obuff);
+	__free(ibuff);
+	exit(EXIT_FAILURE);
+}
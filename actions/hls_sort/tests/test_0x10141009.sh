@@ -0,0 +1,117 @@
+#!/bin/bash
+
+#
+# Copyright 2017 International Business Machines
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+
+verbose=0
+snap_card=0
+duration="NORMAL"
+
+function usage() {
+    echo "Usage:"
+    echo "  test_<action_type>.sh"
+    echo "    [-C <card>] card to be used for the test"
+    echo "    [-t <trace_level>]"
+    echo "    [-duration SHORT/NORMAL/LONG] run tests"
+    echo
+}
+
+while getopts ":C:t:d:h" opt; do
+    case $opt in
+	C)
+	snap_card=$OPTARG;
+	;;
+	t)
+	export SNAP_TRACE=$OPTARG;
+	;;
+	d)
+	duration=$OPTARG;
+	;;
+	h)
+	usage;
+	exit 0;
+	;;
+	\?)
+	echo "Invalid option: -$OPTARG" >&2
+	;;
+    esac
+done
+
+export PATH=$PATH:../software/tools
+
+snap_peek --help > /dev/null || exit 1;
+snap_poke --help > /dev/null || exit 1;
+
+#### VERSION ##########################################################
+
+if [ -z "$SNAP_CONFIG" ]; then
+	echo "CARD VERSION"
+	snap_peek -C ${snap_card} 0x0 || exit 1;
+	snap_peek -C ${snap_card} 0x8 || exit 1;
+	echo
+fi
+
+#### SORT #############################################################
+
+export PATH=$PATH:./hls_sort/sw
+
+function run() {
+    local name=$1; shift
+    echo -n "$name ... "
+    cmd="( $* ) > snap_sort.log 2>&1"
+    eval ${cmd}
+    if [ $? -ne 0 ]; then
+	cat snap_sort.log
+	echo "cmd: ${cmd}"
+	echo "failed"
+	exit 1
+    fi
+    echo "ok"
+}
+
+# random records of all formats and orders, checked by snap_sort -c
+if [ "$duration" = "SHORT" ]; then n=20000; else n=300000; fi
+for key in 4 8; do
+    for payload in "" "-p"; do
+	for order in "" "-D" "-S" "-D -S"; do
+	    run "Doing snap_sort -k $key $payload $order" \
+		"snap_sort -C${snap_card} -n $n -k $key $payload $order -c"
+	done
+    done
+done
+run "Doing snap_sort through host memory" \
+    "snap_sort -C${snap_card} -n $n -p -H -c"
+for i in 0 1 1000; do
+    run "Doing snap_sort of $i records" \
+	"snap_sort -C${snap_card} -n $i -k 4 -c"
+done
+
+# a file sorted, checked without snap_sort
+head -c $((n * 16)) /dev/urandom > sort_in.bin
+run "Doing snap_sort of a file" \
+    "snap_sort -C${snap_card} -k 8 -p -i sort_in.bin -o sort_out.bin"
+if python3 -c "import struct" > /dev/null 2>&1; then
+    run "Check results" \
+	"python3 -c 'import struct; a = open(\"sort_in.bin\", \"rb\").read(); b = open(\"sort_out.bin\", \"rb\").read(); r = lambda d: [d[i:i + 16] for i in range(0, len(d), 16)]; k = [struct.unpack(\"<Q\", x[:8])[0] for x in r(b)]; assert k == sorted(k) and sorted(r(a)) == sorted(r(b))'"
+else
+    echo "python3 not found, skipping the file check"
+fi
+run "Doing snap_sort of a file of partial records" \
+    "head -c 100 /dev/urandom > sort_odd.bin && ! snap_sort -C${snap_card} -k 8 -i sort_odd.bin"
+
+rm -f sort_*.bin snap_sort.log
+echo "Test OK"
+exit 0
@@ -333,11 +333,1273 @@ static uint64_t test_speed(const uint64_t run_number,
     return x;
 }
 
+//-----------------------------------------------------------------------------
+//--- CRC32 / CRC32C / ADLER32 ------------------------------------------------
+//-----------------------------------------------------------------------------
+
+/*
+ * All checksums work on one snap_membus_t word (64 bytes) per clock
+ * cycle. Byte k of a memory word is found in bits (8k+7, 8k).
+ */
+typedef struct {
+	snapu32_t crc;		/* CRC register, pre-conditioned */
+	snapu32_t adler_a;	/* sum of bytes, kept reduced */
+	snapu64_t adler_b;	/* sum of adler_a, reduced at the end */
+} checksum_state_t;
+
+static snapu32_t crc32_byte(snapu32_t crc, snapu8_t data, const uint32_t poly)
+{
+#pragma HLS INLINE
+	crc ^= data;
+	crc_bits: for (int k = 0; k < 8; k++) {
+#pragma HLS UNROLL
+		if (crc[0])
+			crc = (crc >> 1) ^ poly;
+		else
+			crc = crc >> 1;
+	}
+	return crc;
+}
+
+static snapu32_t crc32_word(snapu32_t crc, snap_membus_t word,
+			    const uint32_t poly)
+{
+#pragma HLS INLINE
+	crc_bytes: for (int i = 0; i < BPERDW; i++)
+#pragma HLS UNROLL
+		crc = crc32_byte(crc, word(8 * i + 7, 8 * i), poly);
+	return crc;
+}
+
+/*
+ * The CRC register update is linear over GF(2), so the update with a
+ * full word can be split (folded) into the contribution of the data,
+ * which does not depend on the previous CRC and can be pipelined, and
+ * the 512 bit shift of the old CRC. Only the latter, a 32 input XOR
+ * network, remains in the loop carried path. This is what makes
+ * II=1 possible.
+ */
+static snapu32_t crc32_fold(snapu32_t crc, snap_membus_t word,
+			    const uint32_t poly)
+{
+#pragma HLS INLINE
+	snapu32_t data_part = crc32_word(0, word, poly);
+	snapu32_t crc_part = crc32_word(crc, 0, poly);
+
+	return crc_part ^ data_part;
+}
+
+static void adler32_byte(checksum_state_t *st, snapu8_t data)
+{
+#pragma HLS INLINE
+	snapu32_t a = st->adler_a + data;
+
+	if (a >= ADLER32_BASE)
+		a -= ADLER32_BASE;
+	st->adler_a = a;
+	st->adler_b += a;
+}
+
+/*
+ * Over 64 bytes d[0..63] Adler-32 adds sum(d[i]) to a and
+ * 64 * a + sum((64 - i) * d[i]) to b. a stays below ADLER32_BASE
+ * with one conditional subtract, b is a wide sum which cannot overflow
+ * for buffers addressable by snap_addr.size and is reduced once at the
+ * end.
+ */
+static void adler32_word(checksum_state_t *st, snap_membus_t word)
+{
+#pragma HLS INLINE
+	snapu32_t sum = 0, wsum = 0, a;
+
+	adler_bytes: for (int i = 0; i < BPERDW; i++) {
+#pragma HLS UNROLL
+		snapu8_t d = word(8 * i + 7, 8 * i);
+		sum += d;
+		wsum += (snapu32_t)(BPERDW - i) * d;
+	}
+	st->adler_b += (snapu64_t)st->adler_a * BPERDW + wsum;
+	a = st->adler_a + sum;
+	if (a >= ADLER32_BASE)
+		a -= ADLER32_BASE;
+	st->adler_a = a;
+}
+
+static void checksum_word(snapu32_t mode, checksum_state_t *st,
+			  snap_membus_t word)
+{
+#pragma HLS INLINE
+	switch (mode) {
+	case CHECKSUM_CRC32:
+		st->crc = crc32_fold(st->crc, word, CRC32_POLY);
+		break;
+	case CHECKSUM_CRC32C:
+		st->crc = crc32_fold(st->crc, word, CRC32C_POLY);
+		break;
+	case CHECKSUM_ADLER32:
+		adler32_word(st, word);
+		break;
+	default:
+		break;
+	}
+}
+
+/* Bytes first..last-1 of a word, used for unaligned head and tail */
+static void checksum_bytes(snapu32_t mode, checksum_state_t *st,
+			   snap_membus_t word, snapu8_t first, snapu8_t last)
+{
+	snapu8_t d;
+
+	partial_bytes: for (int i = 0; i < BPERDW; i++) {
+#pragma HLS PIPELINE
+		if (i < first || i >= last)
+			continue;
+		d = word(8 * i + 7, 8 * i);
+		switch (mode) {
+		case CHECKSUM_CRC32:
+			st->crc = crc32_byte(st->crc, d, CRC32_POLY);
+			break;
+		case CHECKSUM_CRC32C:
+			st->crc = crc32_byte(st->crc, d, CRC32C_POLY);
+			break;
+		case CHECKSUM_ADLER32:
+			adler32_byte(st, d);
+			break;
+		default:
+			break;
+		}
+	}
+}
+
+/*
+ * Stream the buffer through the checksum logic. The main loop is
+ * pipelined with II=1 and reads the memory in bursts, unaligned start
+ * and end are handled bytewise.
+ */
+static void checksum_mem(snap_membus_t *mem, snapu64_t addr,
+			 snapu32_t size, snapu32_t mode,
+			 checksum_state_t *st)
+{
+	snapu64_t waddr = addr >> ADDR_RIGHT_SHIFT;
+	snapu8_t head = addr(ADDR_RIGHT_SHIFT - 1, 0);
+	snapu32_t nwords;
+	snapu8_t tail;
+
+	if (size == 0)
+		return;
+
+	if (head != 0) {
+		snapu8_t last = (size < (snapu32_t)(BPERDW - head)) ?
+			(snapu8_t)(head + size) : (snapu8_t)BPERDW;
+
+		checksum_bytes(mode, st, mem[waddr], head, last);
+		size -= (last - head);
+		waddr++;
+	}
+
+	nwords = size >> ADDR_RIGHT_SHIFT;
+	tail = size(ADDR_RIGHT_SHIFT - 1, 0);
+
+	full_words: for (snapu32_t k = 0; k < nwords; k++) {
+#pragma HLS PIPELINE II=1
+		checksum_word(mode, st, mem[waddr + k]);
+	}
+
+	if (tail != 0)
+		checksum_bytes(mode, st, mem[waddr + nwords], 0, tail);
+}
+
+static void process_checksum(snap_membus_t *din_gmem,
+			     snap_membus_t *d_ddrmem,
+			     snapu32_t *d_nvme,
+			     action_reg *Action_Register)
+{
+	checksum_state_t st;
+	nvme_stream_t ns;
+	snapu64_t staging;
+	snapu32_t bytes;
+	snapu32_t mode = Action_Register->Data.chk_type;
+	snapu64_t chk_in = Action_Register->Data.chk_in;
+	snapu64_t addr = Action_Register->Data.in.addr;
+	snapu32_t size = Action_Register->Data.in.size;
+
+	st.crc = ~(snapu32_t)chk_in(31, 0);
+	st.adler_a = chk_in(15, 0);
+	st.adler_b = chk_in(31, 16);
+
+	switch (Action_Register->Data.in.type) {
+	case SNAP_ADDRTYPE_HOST_DRAM:
+		checksum_mem(din_gmem, addr, size, mode, &st);
+		break;
+	case SNAP_ADDRTYPE_CARD_DRAM:
+		checksum_mem(d_ddrmem, addr, size, mode, &st);
+		break;
+	case SNAP_ADDRTYPE_NVME:
+		/* Sum up one staging half while the next one is read */
+		nvme_stream_init(&ns, d_nvme, addr, size,
+				 (Action_Register->Data.in.flags &
+				  SNAP_ADDRFLAG_DRIVE1) != 0, NVME_MAX_BYTES);
+		nvme_chunks: while ((bytes = nvme_stream_next(&ns, d_nvme,
+							      &staging)) != 0)
+			checksum_mem(d_ddrmem, staging, bytes, mode, &st);
+		if (ns.error) {
+			Action_Register->Control.Retc = SNAP_RETC_FAILURE;
+			return;
+		}
+		break;
+	default:
+		Action_Register->Control.Retc = SNAP_RETC_FAILURE;
+		return;
+	}
+
+	if (mode == CHECKSUM_ADLER32)
+		Action_Register->Data.chk_out =
+			((snapu64_t)(st.adler_b % ADLER32_BASE) << 16) |
+			st.adler_a;
+	else
+		Action_Register->Data.chk_out = ~st.crc;
+
+	Action_Register->Data.nb_test_runs = 0;
+	Action_Register->Data.nb_rounds = 0;
+	Action_Register->Control.Retc = SNAP_RETC_SUCCESS;
+}
+
+//-----------------------------------------------------------------------------
+//--- SHA3 / SHAKE ------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
+/*
+ * The message is read as a stream of 64-bit lanes, rate/8 lanes are
+ * xored into the state before each Keccak-f[1600] permutation. The
+ * reader keeps the current and the next memory word, so the buffer can
+ * start at any byte address. Words behind the end of the buffer are
+ * never read.
+ */
+typedef struct {
+	snapu64_t waddr;	/* word holding the next lane */
+	snapu64_t wend;		/* first word behind the buffer */
+	snapu8_t offs;		/* byte offset of the next lane in cur */
+	snap_membus_t cur;
+	snap_membus_t nxt;
+} lane_reader_t;
+
+static snap_membus_t lane_load(snap_membus_t *mem, snapu64_t waddr,
+			       snapu64_t wend)
+{
+#pragma HLS INLINE
+	if (waddr < wend)
+		return mem[waddr];
+	return 0;
+}
+
+static void lane_reader_init(lane_reader_t *rd, snap_membus_t *mem,
+			     snapu64_t addr, snapu32_t size)
+{
+	rd->waddr = addr >> ADDR_RIGHT_SHIFT;
+	rd->wend = rd->waddr;
+	if (size != 0)
+		rd->wend = (addr + size + BPERDW - 1) >> ADDR_RIGHT_SHIFT;
+	rd->offs = addr(ADDR_RIGHT_SHIFT - 1, 0);
+	rd->cur = lane_load(mem, rd->waddr, rd->wend);
+	rd->nxt = lane_load(mem, rd->waddr + 1, rd->wend);
+}
+
+static snapu64_t lane_read(lane_reader_t *rd, snap_membus_t *mem)
+{
+#pragma HLS INLINE
+	int shift = 8 * (int)rd->offs;
+	snap_membus_t w = rd->cur >> shift;
+
+	if (rd->offs > BPERDW - 8)
+		w |= rd->nxt << (MEMDW - shift);
+
+	rd->offs += 8;
+	if (rd->offs >= BPERDW) {
+		rd->offs -= BPERDW;
+		rd->waddr++;
+		rd->cur = rd->nxt;
+		rd->nxt = lane_load(mem, rd->waddr + 1, rd->wend);
+	}
+	return w(63, 0);
+}
+
+/*
+ * Xor one block into the state, pos is the message byte of its first
+ * lane. For the last job the padding is added on the fly: pad right
+ * behind the message, 0x80 in the last byte of the last block, which
+ * can be an extra block if the message fills the one before.
+ */
+static void sha3_absorb_block(lane_reader_t *rd, snap_membus_t *mem,
+			      snapu32_t pos, snapu32_t size,
+			      snapu8_t rate_lanes, snapu8_t pad,
+			      bool final, bool last, uint64_t st[SHA3_LANES])
+{
+	sha3_lanes: for (snapu8_t i = 0; i < rate_lanes; i++) {
+#pragma HLS LOOP_TRIPCOUNT max=21
+#pragma HLS PIPELINE II=1
+		snapu64_t lane = 0;
+
+		if (pos < size)
+			lane = lane_read(rd, mem);
+		if (pos + 8 > size) {
+			int valid = (pos < size) ? (int)(size - pos) : 0;
+
+			lane &= ((snapu64_t)1 << (8 * valid)) - 1;
+			if (final && pos <= size)
+				lane ^= (snapu64_t)pad << (8 * valid);
+		}
+		if (last && i == rate_lanes - 1)
+			lane ^= (snapu64_t)0x80 << 56;
+
+		st[i] ^= lane;
+		pos += 8;
+	}
+}
+
+static void sha3_absorb(snap_membus_t *mem, snapu64_t addr, snapu32_t size,
+			snapu8_t rate_lanes, snapu8_t pad, bool final,
+			uint64_t st[SHA3_LANES])
+{
+	lane_reader_t rd;
+	snapu32_t rate = rate_lanes * 8;
+	snapu32_t nblocks = size / rate + (final ? 1 : 0);
+
+	lane_reader_init(&rd, mem, addr, size);
+
+	sha3_blocks: for (snapu32_t b = 0; b < nblocks; b++) {
+		sha3_absorb_block(&rd, mem, b * rate, size, rate_lanes, pad,
+				  final, final && b == nblocks - 1, st);
+		sha3_keccakf(st, st);
+	}
+}
+
+/* Write len digest bytes as whole 64 byte lines, zero filled */
+static void sha3_squeeze(snap_membus_t *mem, snapu64_t addr, snapu32_t len,
+			 snapu8_t rate_lanes, uint64_t st[SHA3_LANES])
+{
+	snapu64_t waddr = addr >> ADDR_RIGHT_SHIFT;
+	snapu32_t nlanes = (len + 7) / 8;
+	snap_membus_t w = 0;
+	snapu8_t i = 0;
+
+	sha3_out: for (snapu32_t l = 0; l < nlanes; l++) {
+		snapu64_t lane;
+		int k = l(2, 0);
+
+		if (i == rate_lanes) {
+			sha3_keccakf(st, st);
+			i = 0;
+		}
+		lane = st[i++];
+		if (l == nlanes - 1 && len(2, 0) != 0)
+			lane &= ((snapu64_t)1 << (8 * (int)len(2, 0))) - 1;
+
+		w(64 * k + 63, 64 * k) = lane;
+		if (k == 7 || l == nlanes - 1) {
+			mem[waddr++] = w;
+			w = 0;
+		}
+	}
+}
+
+static void sha3_state_load(snap_membus_t *mem, snapu64_t addr,
+			    uint64_t st[SHA3_LANES])
+{
+	snapu64_t waddr = addr >> ADDR_RIGHT_SHIFT;
+	snap_membus_t w = 0;
+
+	state_load: for (int l = 0; l < SHA3_LANES; l++) {
+#pragma HLS PIPELINE II=1
+		if (l % 8 == 0)
+			w = mem[waddr + l / 8];
+		st[l] = w(64 * (l % 8) + 63, 64 * (l % 8));
+	}
+}
+
+static void sha3_state_store(snap_membus_t *mem, snapu64_t addr,
+			     uint64_t st[SHA3_LANES])
+{
+	snapu64_t waddr = addr >> ADDR_RIGHT_SHIFT;
+	snap_membus_t w = 0;
+
+	state_store: for (int l = 0; l < SHA3_LANES; l++) {
+#pragma HLS PIPELINE II=1
+		w(64 * (l % 8) + 63, 64 * (l % 8)) = st[l];
+		if (l % 8 == 7 || l == SHA3_LANES - 1) {
+			mem[waddr + l / 8] = w;
+			w = 0;
+		}
+	}
+}
+
+static bool hash_addr_ok(snapu16_t type, snapu64_t addr, bool aligned)
+{
+	if (type != SNAP_ADDRTYPE_HOST_DRAM && type != SNAP_ADDRTYPE_CARD_DRAM)
+		return false;
+	return !aligned || addr(ADDR_RIGHT_SHIFT - 1, 0) == 0;
+}
+
+/*
+ * Batch mode: SHA3_WAYS messages are hashed side by side. Their states
+ * take turns in the round logic, so the loop carried dependency of a
+ * round is SHA3_WAYS cycles long and the round pipeline stays busy.
+ * One bus word holds SHA3_WAYS descriptors. The shorter messages of a
+ * group are done early and wait for the longest one.
+ */
+static void sha3_keccakf_ways(uint64_t st[SHA3_WAYS][SHA3_LANES])
+{
+	keccak_rounds: for (int r = 0; r < KECCAKF_ROUNDS; r++)
+		keccak_ways: for (int w = 0; w < SHA3_WAYS; w++) {
+#pragma HLS PIPELINE II=1
+#pragma HLS DEPENDENCE variable=st inter true distance=4
+			sha3_keccakf_round(st[w], r);
+		}
+}
+
+/*
+ * Hash up to SHA3_WAYS complete messages side by side, unused ways have
+ * used[w] false. The state of message w is copied to md[w] right after
+ * its last block, later rounds for longer messages do not change it.
+ */
+static void sha3_ways(snap_membus_t *din_gmem, snap_membus_t *d_ddrmem,
+		      const snapu64_t addr[SHA3_WAYS],
+		      const snapu32_t size[SHA3_WAYS],
+		      const snapu16_t type[SHA3_WAYS],
+		      const bool used[SHA3_WAYS],
+		      snapu8_t rate_lanes, snapu8_t pad,
+		      uint64_t md[SHA3_WAYS][SHA3_LANES])
+{
+	uint64_t st[SHA3_WAYS][SHA3_LANES];
+#pragma HLS ARRAY_PARTITION variable=st complete dim=2
+	lane_reader_t rd[SHA3_WAYS];
+	snapu32_t nblocks[SHA3_WAYS];
+	snapu32_t rate = rate_lanes * 8;
+	snapu32_t maxblocks = 0;
+
+	ways_setup: for (int w = 0; w < SHA3_WAYS; w++) {
+		nblocks[w] = used[w] ? (snapu32_t)(size[w] / rate + 1) :
+			(snapu32_t)0;
+		if (nblocks[w] > maxblocks)
+			maxblocks = nblocks[w];
+
+		if (type[w] == SNAP_ADDRTYPE_HOST_DRAM)
+			lane_reader_init(&rd[w], din_gmem, addr[w],
+					 used[w] ? size[w] : (snapu32_t)0);
+		else
+			lane_reader_init(&rd[w], d_ddrmem, addr[w],
+					 used[w] ? size[w] : (snapu32_t)0);
+		ways_zero: for (int l = 0; l < SHA3_LANES; l++)
+			st[w][l] = 0;
+	}
+
+	ways_blocks: for (snapu32_t b = 0; b < maxblocks; b++) {
+		ways_absorb: for (int w = 0; w < SHA3_WAYS; w++) {
+			if (b >= nblocks[w])
+				continue;
+			if (type[w] == SNAP_ADDRTYPE_HOST_DRAM)
+				sha3_absorb_block(&rd[w], din_gmem, b * rate,
+						  size[w], rate_lanes, pad,
+						  true, b == nblocks[w] - 1,
+						  st[w]);
+			else
+				sha3_absorb_block(&rd[w], d_ddrmem, b * rate,
+						  size[w], rate_lanes, pad,
+						  true, b == nblocks[w] - 1,
+						  st[w]);
+		}
+
+		sha3_keccakf_ways(st);
+
+		ways_done: for (int w = 0; w < SHA3_WAYS; w++) {
+			if (b != nblocks[w] - 1)
+				continue;
+			for (int l = 0; l < SHA3_LANES; l++)
+				md[w][l] = st[w][l];
+		}
+	}
+}
+
+static void process_sha3_batch(snap_membus_t *din_gmem,
+			       snap_membus_t *dout_gmem,
+			       snap_membus_t *d_ddrmem,
+			       action_reg *Action_Register,
+			       snapu8_t rate_lanes, snapu8_t pad,
+			       snapu32_t outlen)
+{
+	uint64_t md[SHA3_WAYS][SHA3_LANES];
+	snapu64_t addr[SHA3_WAYS];
+	snapu32_t size[SHA3_WAYS];
+	snapu16_t type[SHA3_WAYS];
+	bool used[SHA3_WAYS];
+	snapu64_t in_waddr = Action_Register->Data.in.addr >> ADDR_RIGHT_SHIFT;
+	snapu16_t in_type = Action_Register->Data.in.type;
+	snapu64_t out_addr = Action_Register->Data.out.addr;
+	snapu16_t out_type = Action_Register->Data.out.type;
+	snapu32_t n = Action_Register->Data.in.size / sizeof(struct snap_addr);
+	snap_membus_t descs;
+
+	batch_groups: for (snapu32_t g = 0; g < n; g += SHA3_WAYS) {
+		if (in_type == SNAP_ADDRTYPE_HOST_DRAM)
+			descs = din_gmem[in_waddr + g / SHA3_WAYS];
+		else
+			descs = d_ddrmem[in_waddr + g / SHA3_WAYS];
+
+		batch_setup: for (int w = 0; w < SHA3_WAYS; w++) {
+			addr[w] = descs(128 * w + 63, 128 * w);
+			size[w] = descs(128 * w + 95, 128 * w + 64);
+			type[w] = descs(128 * w + 111, 128 * w + 96);
+			used[w] = g + w < n;
+			if (used[w] && !hash_addr_ok(type[w], 0, false)) {
+				Action_Register->Control.Retc =
+					SNAP_RETC_FAILURE;
+				return;
+			}
+		}
+
+		sha3_ways(din_gmem, d_ddrmem, addr, size, type, used,
+			  rate_lanes, pad, md);
+
+		batch_digest: for (int w = 0; w < SHA3_WAYS; w++) {
+			snapu64_t slot = out_addr +
+				(g + w) * CHECKSUM_HASH_SLOT_SIZE;
+
+			if (!used[w])
+				continue;
+			if (out_type == SNAP_ADDRTYPE_HOST_DRAM)
+				sha3_squeeze(dout_gmem, slot, outlen,
+					     rate_lanes, md[w]);
+			else
+				sha3_squeeze(d_ddrmem, slot, outlen,
+					     rate_lanes, md[w]);
+		}
+	}
+
+	Action_Register->Data.chk_out = n;
+	Action_Register->Data.nb_test_runs = 0;
+	Action_Register->Data.nb_rounds = 0;
+	Action_Register->Control.Retc = SNAP_RETC_SUCCESS;
+}
+
+static void process_sha3(snap_membus_t *din_gmem,
+			 snap_membus_t *dout_gmem,
+			 snap_membus_t *d_ddrmem,
+			 action_reg *Action_Register)
+{
+	uint64_t st[SHA3_LANES];
+#pragma HLS ARRAY_PARTITION variable=st complete
+	snapu32_t mode = Action_Register->Data.chk_type;
+	snapu32_t flags = Action_Register->Data.hash_flags;
+	snapu64_t in_addr = Action_Register->Data.in.addr;
+	snapu32_t size = Action_Register->Data.in.size;
+	snapu16_t in_type = Action_Register->Data.in.type;
+	snapu64_t out_addr = Action_Register->Data.out.addr;
+	snapu16_t out_type = Action_Register->Data.out.type;
+	snapu64_t st_addr = Action_Register->Data.state.addr;
+	snapu16_t st_type = Action_Register->Data.state.type;
+	bool init = flags & CHECKSUM_HASH_INIT;
+	bool final = flags & CHECKSUM_HASH_FINAL;
+	snapu8_t mdlen, rate_lanes, pad = SHA3_PAD;
+	snapu32_t outlen;
+
+	switch (mode) {
+	case CHECKSUM_SHA3_224: mdlen = 28; break;
+	case CHECKSUM_SHA3_256: mdlen = 32; break;
+	case CHECKSUM_SHA3_384: mdlen = 48; break;
+	case CHECKSUM_SHA3_512: mdlen = 64; break;
+	case CHECKSUM_SHAKE128: mdlen = 16; pad = SHAKE_PAD; break;
+	default:		mdlen = 32; pad = SHAKE_PAD; break;
+	}
+	rate_lanes = (200 - 2 * mdlen) / 8;
+	outlen = (pad == SHAKE_PAD) ? (snapu32_t)Action_Register->Data.out.size :
+		(snapu32_t)mdlen;
+
+	if (flags & CHECKSUM_HASH_BATCH) {
+		if (!hash_addr_ok(in_type, in_addr, true) ||
+		    !hash_addr_ok(out_type, out_addr, true) ||
+		    outlen > CHECKSUM_HASH_SLOT_SIZE) {
+			Action_Register->Control.Retc = SNAP_RETC_FAILURE;
+			return;
+		}
+		process_sha3_batch(din_gmem, dout_gmem, d_ddrmem,
+				   Action_Register, rate_lanes, pad, outlen);
+		return;
+	}
+
+	/* Check everything before touching memory */
+	if (!hash_addr_ok(in_type, in_addr, false) ||
+	    (final && !hash_addr_ok(out_type, out_addr, true)) ||
+	    ((!init || !final) && !hash_addr_ok(st_type, st_addr, true)) ||
+	    (!final && size % (rate_lanes * 8) != 0)) {
+		Action_Register->Control.Retc = SNAP_RETC_FAILURE;
+		return;
+	}
+
+	if (init) {
+		state_zero: for (int l = 0; l < SHA3_LANES; l++)
+#pragma HLS UNROLL
+			st[l] = 0;
+	} else if (st_type == SNAP_ADDRTYPE_HOST_DRAM)
+		sha3_state_load(din_gmem, st_addr, st);
+	else
+		sha3_state_load(d_ddrmem, st_addr, st);
+
+	if (in_type == SNAP_ADDRTYPE_HOST_DRAM)
+		sha3_absorb(din_gmem, in_addr, size, rate_lanes, pad, final, st);
+	else
+		sha3_absorb(d_ddrmem, in_addr, size, rate_lanes, pad, final, st);
+
+	if (final) {
+		Action_Register->Data.chk_out = st[0];
+		if (out_type == SNAP_ADDRTYPE_HOST_DRAM)
+			sha3_squeeze(dout_gmem, out_addr, outlen, rate_lanes, st);
+		else
+			sha3_squeeze(d_ddrmem, out_addr, outlen, rate_lanes, st);
+	} else {
+		Action_Register->Data.chk_out = 0;
+		if (st_type == SNAP_ADDRTYPE_HOST_DRAM)
+			sha3_state_store(dout_gmem, st_addr, st);
+		else
+			sha3_state_store(d_ddrmem, st_addr, st);
+	}
+
+	Action_Register->Data.nb_test_runs = 0;
+	Action_Register->Data.nb_rounds = 0;
+	Action_Register->Control.Retc = SNAP_RETC_SUCCESS;
+}
+
+//-----------------------------------------------------------------------------
+//--- XXH3 --------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
+/*
+ * XXH3 64 bit, same results as sw/xxh3.c. Inputs longer than 240
+ * bytes go through eight 64 bit accumulators, one 64 byte stripe per
+ * bus word, so the stripe loop takes one realigned word per cycle.
+ * The accumulators are scrambled after every 16 stripes. The last
+ * stripe is the last 64 bytes of the input again, read once more.
+ * Shorter inputs are copied into a local buffer and hashed from there.
+ */
+#define XXH_PRIME32_1	0x9E3779B1U
+#define XXH_PRIME32_2	0x85EBCA77U
+#define XXH_PRIME32_3	0xC2B2AE3DU
+#define XXH_PRIME64_1	0x9E3779B185EBCA87ULL
+#define XXH_PRIME64_2	0xC2B2AE3D27D4EB4FULL
+#define XXH_PRIME64_3	0x165667B19E3779F9ULL
+#define XXH_PRIME64_4	0x85EBCA77C2B2AE63ULL
+#define XXH_PRIME64_5	0x27D4EB2F165667C5ULL
+#define XXH_PRIME_MX1	0x165667919E3779F9ULL
+#define XXH_PRIME_MX2	0x9FB21C651E98DF25ULL
+
+static const uint8_t xxh3_secret[XXH3_SECRET_SIZE] = {
+	0xb8, 0xfe, 0x6c, 0x39, 0x23, 0xa4, 0x4b, 0xbe,
+	0x7c, 0x01, 0x81, 0x2c, 0xf7, 0x21, 0xad, 0x1c,
+	0xde, 0xd4, 0x6d, 0xe9, 0x83, 0x90, 0x97, 0xdb,
+	0x72, 0x40, 0xa4, 0xa4, 0xb7, 0xb3, 0x67, 0x1f,
+	0xcb, 0x79, 0xe6, 0x4e, 0xcc, 0xc0, 0xe5, 0x78,
+	0x82, 0x5a, 0xd0, 0x7d, 0xcc, 0xff, 0x72, 0x21,
+	0xb8, 0x08, 0x46, 0x74, 0xf7, 0x43, 0x24, 0x8e,
+	0xe0, 0x35, 0x90, 0xe6, 0x81, 0x3a, 0x26, 0x4c,
+	0x3c, 0x28, 0x52, 0xbb, 0x91, 0xc3, 0x00, 0xcb,
+	0x88, 0xd0, 0x65, 0x8b, 0x1b, 0x53, 0x2e, 0xa3,
+	0x71, 0x64, 0x48, 0x97, 0xa2, 0x0d, 0xf9, 0x4e,
+	0x38, 0x19, 0xef, 0x46, 0xa9, 0xde, 0xac, 0xd8,
+	0xa8, 0xfa, 0x76, 0x3f, 0xe3, 0x9c, 0x34, 0x3f,
+	0xf9, 0xdc, 0xbb, 0xc7, 0xc7, 0x0b, 0x4f, 0x1d,
+	0x8a, 0x51, 0xe0, 0x4b, 0xcd, 0xb4, 0x59, 0x31,
+	0xc8, 0x9f, 0x7e, 0xc9, 0xd9, 0x78, 0x73, 0x64,
+	0xea, 0xc5, 0xac, 0x83, 0x34, 0xd3, 0xeb, 0xc3,
+	0xc5, 0x81, 0xa0, 0xff, 0xfa, 0x13, 0x63, 0xeb,
+	0x17, 0x0d, 0xdd, 0x51, 0xb7, 0xf0, 0xda, 0x49,
+	0xd3, 0x16, 0x55, 0x26, 0x29, 0xd4, 0x68, 0x9e,
+	0x2b, 0x16, 0xbe, 0x58, 0x7d, 0x47, 0xa1, 0xfc,
+	0x8f, 0xf8, 0xb8, 0xd1, 0x7a, 0xd0, 0x31, 0xce,
+	0x45, 0xcb, 0x3a, 0x8f, 0x95, 0x16, 0x04, 0x28,
+	0xaf, 0xd7, 0xfb, 0xca, 0xbb, 0x4b, 0x40, 0x7e,
+};
+
+/* Secret derived from the seed, as 24 lanes and as bytes */
+typedef struct {
+	uint64_t seed;
+	uint64_t key[XXH3_SECRET_SIZE / 8];
+	uint8_t b[XXH3_SECRET_SIZE];
+} xxh3_secret_t;
+
+/* 64 bytes from the current reader position, then the next word */
+static snap_membus_t word_read(lane_reader_t *rd, snap_membus_t *mem)
+{
+#pragma HLS INLINE
+	int shift = 8 * (int)rd->offs;
+	snap_membus_t w = rd->cur;
+
+	if (shift != 0)
+		w = (rd->cur >> shift) | (rd->nxt << (MEMDW - shift));
+
+	rd->waddr++;
+	rd->cur = rd->nxt;
+	rd->nxt = lane_load(mem, rd->waddr + 1, rd->wend);
+	return w;
+}
+
+static uint64_t xxh3_le64(const uint8_t *p)
+{
+#pragma HLS INLINE
+	uint64_t v = 0;
+
+	for (int i = 7; i >= 0; i--)
+		v = (v << 8) | p[i];
+	return v;
+}
+
+static uint32_t xxh3_le32(const uint8_t *p)
+{
+#pragma HLS INLINE
+	return (uint32_t)p[0] | (uint32_t)p[1] << 8 |
+		(uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static uint64_t xxh3_swap64(uint64_t x)
+{
+	uint64_t v = 0;
+
+	for (int i = 0; i < 8; i++) {
+#pragma HLS UNROLL
+		v = (v << 8) | (x & 0xff);
+		x >>= 8;
+	}
+	return v;
+}
+
+static uint64_t xxh3_rotl64(uint64_t x, int r)
+{
+	return (x << r) | (x >> (64 - r));
+}
+
+/* Low and high half of the 64 x 64 bit product, from 32 bit partials */
+static uint64_t xxh3_mul128_fold64(uint64_t a, uint64_t b)
+{
+	uint64_t lo_lo = (a & 0xffffffff) * (b & 0xffffffff);
+	uint64_t hi_lo = (a >> 32) * (b & 0xffffffff);
+	uint64_t lo_hi = (a & 0xffffffff) * (b >> 32);
+	uint64_t hi_hi = (a >> 32) * (b >> 32);
+	uint64_t cross = (lo_lo >> 32) + (hi_lo & 0xffffffff) + lo_hi;
+	uint64_t upper = (hi_lo >> 32) + (cross >> 32) + hi_hi;
+	uint64_t lower = (cross << 32) | (lo_lo & 0xffffffff);
+
+	return lower ^ upper;
+}
+
+static uint64_t xxh64_avalanche(uint64_t h)
+{
+	h ^= h >> 33;
+	h *= XXH_PRIME64_2;
+	h ^= h >> 29;
+	h *= XXH_PRIME64_3;
+	return h ^ (h >> 32);
+}
+
+static uint64_t xxh3_avalanche(uint64_t h)
+{
+	h ^= h >> 37;
+	h *= XXH_PRIME_MX1;
+	return h ^ (h >> 32);
+}
+
+static uint64_t xxh3_mix16(const uint8_t *in, const uint8_t *s,
+			   uint64_t seed)
+{
+	return xxh3_mul128_fold64(xxh3_le64(in) ^ (xxh3_le64(s) + seed),
+				  xxh3_le64(in + 8) ^ (xxh3_le64(s + 8) - seed));
+}
+
+static void xxh3_secret_init(xxh3_secret_t *sec, uint64_t seed)
+{
+	sec->seed = seed;
+	secret_lanes: for (int l = 0; l < XXH3_SECRET_SIZE / 8; l++) {
+#pragma HLS PIPELINE II=1
+		uint64_t k = xxh3_le64(xxh3_secret + 8 * l);
+
+		if (l % 2 == 0)
+			k += seed;
+		else
+			k -= seed;
+		sec->key[l] = k;
+		for (int i = 0; i < 8; i++)
+			sec->b[8 * l + i] = (uint8_t)(k >> (8 * i));
+	}
+}
+
+/* Up to 240 bytes in m[], always with the default secret */
+static uint64_t xxh3_short(const uint8_t m[256], snapu32_t size,
+			   uint64_t seed)
+{
+	const uint8_t *s = xxh3_secret;
+	uint32_t len = size;
+	uint64_t acc = len * XXH_PRIME64_1;
+
+	if (len == 0)
+		return xxh64_avalanche(seed ^ xxh3_le64(s + 56) ^
+				       xxh3_le64(s + 64));
+	if (len < 4) {
+		uint32_t c = ((uint32_t)m[0] << 16) |
+			((uint32_t)m[len >> 1] << 24) |
+			(uint32_t)m[len - 1] | (len << 8);
+
+		return xxh64_avalanche((uint64_t)c ^
+			((uint64_t)(xxh3_le32(s) ^ xxh3_le32(s + 4)) + seed));
+	}
+	if (len <= 8) {
+		uint64_t in64, flip, h;
+
+		seed ^= xxh3_swap64(seed & 0xffffffff);
+		flip = (xxh3_le64(s + 8) ^ xxh3_le64(s + 16)) - seed;
+		in64 = (uint64_t)xxh3_le32(m + len - 4) +
+			((uint64_t)xxh3_le32(m) << 32);
+		h = in64 ^ flip;
+		h ^= xxh3_rotl64(h, 49) ^ xxh3_rotl64(h, 24);
+		h *= XXH_PRIME_MX2;
+		h ^= (h >> 35) + len;
+		h *= XXH_PRIME_MX2;
+		return h ^ (h >> 28);
+	}
+	if (len <= 16) {
+		uint64_t lo = xxh3_le64(m) ^
+			((xxh3_le64(s + 24) ^ xxh3_le64(s + 32)) + seed);
+		uint64_t hi = xxh3_le64(m + len - 8) ^
+			((xxh3_le64(s + 40) ^ xxh3_le64(s + 48)) - seed);
+
+		return xxh3_avalanche(len + xxh3_swap64(lo) + hi +
+				      xxh3_mul128_fold64(lo, hi));
+	}
+	if (len <= 128) {
+		/* pairs from both ends, as many as fit */
+		mix_pairs: for (uint32_t i = 0; i < 4; i++) {
+			if (32 * i >= len)
+				break;
+			acc += xxh3_mix16(m + 16 * i, s + 32 * i, seed);
+			acc += xxh3_mix16(m + len - 16 * (i + 1),
+					  s + 32 * i + 16, seed);
+		}
+		return xxh3_avalanche(acc);
+	}
+
+	mix_first: for (uint32_t i = 0; i < 8; i++)
+		acc += xxh3_mix16(m + 16 * i, s + 16 * i, seed);
+	acc = xxh3_avalanche(acc);
+	mix_rest: for (uint32_t i = 8; i < len / 16; i++) {
+#pragma HLS LOOP_TRIPCOUNT max=7
+		acc += xxh3_mix16(m + 16 * i, s + 16 * (i - 8) + 3, seed);
+	}
+	acc += xxh3_mix16(m + len - 16, s + 136 - 17, seed);
+	return xxh3_avalanche(acc);
+}
+
+/* acc[j ^ 1] += data[j], acc[j] += lo32(data[j] ^ key) * hi32(...) */
+static void xxh3_stripe(uint64_t acc[8], snap_membus_t w,
+			const uint64_t key[8])
+{
+#pragma HLS INLINE
+	uint64_t d[8];
+
+	for (int j = 0; j < 8; j++) {
+#pragma HLS UNROLL
+		uint64_t k;
+
+		d[j] = w(64 * j + 63, 64 * j);
+		k = d[j] ^ key[j];
+		acc[j] += (k & 0xffffffff) * (k >> 32);
+	}
+	for (int j = 0; j < 8; j++) {
+#pragma HLS UNROLL
+		acc[j ^ 1] += d[j];
+	}
+}
+
+static uint64_t xxh3_long(snap_membus_t *mem, snapu64_t addr,
+			  snapu32_t size, const xxh3_secret_t *sec)
+{
+	uint64_t acc[8] = { XXH_PRIME32_3, XXH_PRIME64_1, XXH_PRIME64_2,
+			    XXH_PRIME64_3, XXH_PRIME64_4, XXH_PRIME32_2,
+			    XXH_PRIME64_5, XXH_PRIME32_1 };
+#pragma HLS ARRAY_PARTITION variable=acc complete
+	uint64_t key[8];
+#pragma HLS ARRAY_PARTITION variable=key complete
+	lane_reader_t rd;
+	snapu32_t nstripes = (size - 1) / BPERDW;	/* all but the last */
+	snapu32_t done = 0;
+	uint64_t h;
+
+	lane_reader_init(&rd, mem, addr, size);
+
+	xxh3_blocks: while (done < nstripes) {
+		snapu32_t n = nstripes - done;
+
+		if (n > XXH3_STRIPES)
+			n = XXH3_STRIPES;
+
+		xxh3_stripes: for (snapu32_t s = 0; s < n; s++) {
+#pragma HLS LOOP_TRIPCOUNT max=16
+#pragma HLS PIPELINE II=1
+			for (int j = 0; j < 8; j++)
+				key[j] = sec->key[s + j];
+			xxh3_stripe(acc, word_read(&rd, mem), key);
+		}
+		done += n;
+
+		if (n == XXH3_STRIPES) {
+			/* full block: scramble with the secret end */
+			for (int j = 0; j < 8; j++) {
+#pragma HLS UNROLL
+				acc[j] ^= acc[j] >> 47;
+				acc[j] ^= sec->key[16 + j];
+				acc[j] *= XXH_PRIME32_1;
+			}
+		}
+	}
+
+	/* the last stripe ends at the end of the input, secret + 121 */
+	lane_reader_init(&rd, mem, addr + size - BPERDW, BPERDW);
+	for (int j = 0; j < 8; j++)
+		key[j] = xxh3_le64(sec->b + XXH3_SECRET_SIZE - BPERDW - 7 +
+				   8 * j);
+	xxh3_stripe(acc, word_read(&rd, mem), key);
+
+	h = (uint64_t)size * XXH_PRIME64_1;
+	for (int i = 0; i < 4; i++)
+		h += xxh3_mul128_fold64(acc[2 * i] ^
+					xxh3_le64(sec->b + 11 + 16 * i),
+					acc[2 * i + 1] ^
+					xxh3_le64(sec->b + 11 + 16 * i + 8));
+	return xxh3_avalanche(h);
+}
+
+static uint64_t xxh3_mem(snap_membus_t *mem, snapu64_t addr,
+			 snapu32_t size, const xxh3_secret_t *sec)
+{
+	uint8_t m[256];
+	lane_reader_t rd;
+
+	if (size > XXH3_SHORT_MAX)
+		return xxh3_long(mem, addr, size, sec);
+
+	lane_reader_init(&rd, mem, addr, size);
+	short_words: for (int i = 0; i < 4; i++) {
+		snap_membus_t w = 0;
+
+		if ((snapu32_t)(BPERDW * i) < size)
+			w = word_read(&rd, mem);
+		for (int j = 0; j < BPERDW; j++)
+			m[BPERDW * i + j] = w(8 * j + 7, 8 * j);
+	}
+	return xxh3_short(m, size, sec->seed);
+}
+
+static void process_xxh3(snap_membus_t *din_gmem,
+			 snap_membus_t *dout_gmem,
+			 snap_membus_t *d_ddrmem,
+			 action_reg *Action_Register)
+{
+	xxh3_secret_t sec;
+	snapu64_t in_addr = Action_Register->Data.in.addr;
+	snapu32_t size = Action_Register->Data.in.size;
+	snapu16_t in_type = Action_Register->Data.in.type;
+	snapu64_t out_addr = Action_Register->Data.out.addr;
+	snapu16_t out_type = Action_Register->Data.out.type;
+	bool batch = Action_Register->Data.hash_flags & CHECKSUM_HASH_BATCH;
+
+	if (!hash_addr_ok(in_type, in_addr, batch) ||
+	    (batch && !hash_addr_ok(out_type, out_addr, true))) {
+		Action_Register->Control.Retc = SNAP_RETC_FAILURE;
+		return;
+	}
+
+	xxh3_secret_init(&sec, Action_Register->Data.chk_in);
+
+	if (!batch) {
+		if (in_type == SNAP_ADDRTYPE_HOST_DRAM)
+			Action_Register->Data.chk_out =
+				xxh3_mem(din_gmem, in_addr, size, &sec);
+		else
+			Action_Register->Data.chk_out =
+				xxh3_mem(d_ddrmem, in_addr, size, &sec);
+	} else {
+		snapu64_t in_waddr = in_addr >> ADDR_RIGHT_SHIFT;
+		snapu64_t out_waddr = out_addr >> ADDR_RIGHT_SHIFT;
+		snapu32_t n = size / sizeof(struct snap_addr);
+		snap_membus_t descs = 0, hashes = 0;
+
+		/* messages one after the other, 8 hashes per output word */
+		xxh3_batch: for (snapu32_t i = 0; i < n; i++) {
+			int w = i % SHA3_WAYS, k = i % 8;
+			snapu64_t addr;
+			snapu32_t len;
+			snapu16_t type;
+
+			if (w == 0) {
+				if (in_type == SNAP_ADDRTYPE_HOST_DRAM)
+					descs = din_gmem[in_waddr + i / SHA3_WAYS];
+				else
+					descs = d_ddrmem[in_waddr + i / SHA3_WAYS];
+			}
+			addr = descs(128 * w + 63, 128 * w);
+			len = descs(128 * w + 95, 128 * w + 64);
+			type = descs(128 * w + 111, 128 * w + 96);
+			if (!hash_addr_ok(type, 0, false)) {
+				Action_Register->Control.Retc =
+					SNAP_RETC_FAILURE;
+				return;
+			}
+
+			if (type == SNAP_ADDRTYPE_HOST_DRAM)
+				hashes(64 * k + 63, 64 * k) =
+					xxh3_mem(din_gmem, addr, len, &sec);
+			else
+				hashes(64 * k + 63, 64 * k) =
+					xxh3_mem(d_ddrmem, addr, len, &sec);
+
+			if (k == 7 || i == n - 1) {
+				if (out_type == SNAP_ADDRTYPE_HOST_DRAM)
+					dout_gmem[out_waddr + i / 8] = hashes;
+				else
+					d_ddrmem[out_waddr + i / 8] = hashes;
+				hashes = 0;
+			}
+		}
+		Action_Register->Data.chk_out = n;
+	}
+
+	Action_Register->Data.nb_test_runs = 0;
+	Action_Register->Data.nb_rounds = 0;
+	Action_Register->Control.Retc = SNAP_RETC_SUCCESS;
+}
+
+//-----------------------------------------------------------------------------
+//--- MERKLE TREE -------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
+/*
+ * Digests are kept in the low bytes of a bus word. The tree is built
+ * bottom up on a stack: after leaf i the top ctz(i + 1) pairs are
+ * merged, so the stack holds at most one node per level. At the end
+ * the stack is folded from the top, which moves odd nodes up the way
+ * RFC 6962 does. SHA3 leaves are hashed SHA3_WAYS side by side, XXH3
+ * leaves one after the other since one already takes a word per cycle.
+ */
+#define TREE_LEVELS	33
+
+typedef ap_uint<18 * 64> tree_msg_t;	/* 0x01 || left || right + pad */
+
+static snap_membus_t tree_digest(const uint64_t st[SHA3_LANES],
+				 snapu8_t mdlen)
+{
+	snap_membus_t d = 0;
+
+	for (int l = 0; l < 8; l++) {
+#pragma HLS UNROLL
+		d(64 * l + 63, 64 * l) = st[l];
+	}
+	if (mdlen < BPERDW)
+		d &= (((snap_membus_t)1) << (8 * (int)mdlen)) - 1;
+	return d;
+}
+
+static snap_membus_t tree_node(bool xxh3, const xxh3_secret_t *sec,
+			       snapu8_t mdlen, snapu8_t rate_lanes,
+			       snap_membus_t left, snap_membus_t right)
+{
+	uint64_t st[SHA3_LANES];
+#pragma HLS ARRAY_PARTITION variable=st complete
+	uint8_t m[256];
+	tree_msg_t msg;
+	snapu32_t len = 1 + 2 * mdlen;
+	snapu32_t nblocks = len / (rate_lanes * 8) + 1;
+	snap_membus_t d = 0;
+
+	if (xxh3) {
+		m[0] = 0x01;
+		for (int i = 0; i < 8; i++) {
+			m[1 + i] = left(8 * i + 7, 8 * i);
+			m[9 + i] = right(8 * i + 7, 8 * i);
+		}
+		d(63, 0) = xxh3_short(m, 17, sec->seed);
+		return d;
+	}
+
+	msg = right;
+	msg <<= 8 * (int)mdlen;
+	msg |= left;
+	msg <<= 8;
+	msg |= 0x01;
+	msg |= (tree_msg_t)SHA3_PAD << (8 * (int)len);
+
+	for (int l = 0; l < SHA3_LANES; l++)
+		st[l] = 0;
+	node_blocks: for (snapu32_t b = 0; b < nblocks; b++) {
+		for (snapu8_t i = 0; i < rate_lanes; i++) {
+			int lane = b * rate_lanes + i;
+			uint64_t v = 0;
+
+			if (lane < 18)
+				v = msg(64 * lane + 63, 64 * lane);
+			if (b == nblocks - 1 && i == rate_lanes - 1)
+				v ^= (uint64_t)0x80 << 56;
+			st[i] ^= v;
+		}
+		sha3_keccakf(st, st);
+	}
+	return tree_digest(st, mdlen);
+}
+
+static void process_hash_tree(snap_membus_t *din_gmem,
+			      snap_membus_t *dout_gmem,
+			      snap_membus_t *d_ddrmem,
+			      action_reg *Action_Register)
+{
+	uint64_t md[SHA3_WAYS][SHA3_LANES];
+	snap_membus_t stack[TREE_LEVELS];
+	snap_membus_t leaf[SHA3_WAYS];
+	snapu64_t addr[SHA3_WAYS];
+	snapu32_t len[SHA3_WAYS];
+	snapu16_t type[SHA3_WAYS];
+	bool used[SHA3_WAYS];
+	xxh3_secret_t sec;
+	bool xxh3 = Action_Register->Data.chk_type == CHECKSUM_XXH3;
+	bool leaves = Action_Register->Data.hash_flags & CHECKSUM_HASH_LEAVES;
+	snapu64_t in_addr = Action_Register->Data.in.addr;
+	snapu32_t size = Action_Register->Data.in.size;
+	snapu16_t in_type = Action_Register->Data.in.type;
+	snapu64_t out_addr = Action_Register->Data.out.addr;
+	snapu16_t out_type = Action_Register->Data.out.type;
+	snapu32_t leaf_size = Action_Register->Data.leaf_size;
+	snapu64_t n, out_lines = 1;
+	snap_membus_t packed = 0;
+	snapu8_t mdlen, rate_lanes;
+	int sp = 0;
+
+	switch (Action_Register->Data.chk_type) {
+	case CHECKSUM_SHA3_224: mdlen = 28; break;
+	case CHECKSUM_SHA3_256: mdlen = 32; break;
+	case CHECKSUM_SHA3_384: mdlen = 48; break;
+	case CHECKSUM_SHA3_512: mdlen = 64; break;
+	case CHECKSUM_XXH3:	mdlen = 8; break;
+	default:		mdlen = 0; break;	/* no SHAKE trees */
+	}
+	rate_lanes = (200 - 2 * mdlen) / 8;
+
+	if (mdlen == 0 || leaf_size == 0 || leaf_size(ADDR_RIGHT_SHIFT - 1, 0) != 0) {
+		Action_Register->Control.Retc = SNAP_RETC_FAILURE;
+		return;
+	}
+	n = (size == 0) ? (snapu64_t)1 :
+		(snapu64_t)((size + (snapu64_t)leaf_size - 1) / leaf_size);
+	if (leaves && xxh3)
+		out_lines += (n + 7) / 8;
+	else if (leaves)
+		out_lines += n;
+	if (!hash_addr_ok(in_type, in_addr, false) ||
+	    !hash_addr_ok(out_type, out_addr, true) ||
+	    Action_Register->Data.out.size < out_lines * BPERDW) {
+		Action_Register->Control.Retc = SNAP_RETC_FAILURE;
+		return;
+	}
+
+	xxh3_secret_init(&sec, Action_Register->Data.chk_in);
+
+	tree_groups: for (snapu64_t g = 0; g < n; g += SHA3_WAYS) {
+		tree_setup: for (int w = 0; w < SHA3_WAYS; w++) {
+			snapu64_t offs = (g + w) * leaf_size;
+
+			used[w] = g + w < n;
+			addr[w] = in_addr + offs;
+			len[w] = 0;
+			if (used[w] && offs < size)
+				len[w] = (size - offs < leaf_size) ?
+					(snapu32_t)(size - offs) : leaf_size;
+			type[w] = in_type;
+		}
+
+		if (!xxh3) {
+			sha3_ways(din_gmem, d_ddrmem, addr, len, type, used,
+				  rate_lanes, SHA3_PAD, md);
+			for (int w = 0; w < SHA3_WAYS; w++)
+				leaf[w] = tree_digest(md[w], mdlen);
+		} else {
+			for (int w = 0; w < SHA3_WAYS; w++) {
+				leaf[w] = 0;
+				if (!used[w])
+					continue;
+				if (in_type == SNAP_ADDRTYPE_HOST_DRAM)
+					leaf[w](63, 0) = xxh3_mem(din_gmem,
+						addr[w], len[w], &sec);
+				else
+					leaf[w](63, 0) = xxh3_mem(d_ddrmem,
+						addr[w], len[w], &sec);
+			}
+		}
+
+		tree_push: for (int w = 0; w < SHA3_WAYS; w++) {
+			snapu64_t i = g + w;
+			snapu64_t c = i + 1;
+			snap_membus_t line = leaf[w];
+			bool flush = false;
+
+			if (!used[w])
+				continue;
+
+			if (xxh3) {	/* eight leaf digests per line */
+				packed(64 * (int)i(2, 0) + 63,
+				       64 * (int)i(2, 0)) = leaf[w](63, 0);
+				line = packed;
+				flush = i(2, 0) == 7 || i == n - 1;
+			} else
+				flush = true;
+			if (leaves && flush) {
+				snapu64_t waddr = (out_addr >> ADDR_RIGHT_SHIFT)
+					+ 1 + (xxh3 ? (snapu64_t)(i / 8) : i);
+
+				if (out_type == SNAP_ADDRTYPE_HOST_DRAM)
+					dout_gmem[waddr] = line;
+				else
+					d_ddrmem[waddr] = line;
+			}
+			if (xxh3 && flush)
+				packed = 0;
+
+			stack[sp++] = leaf[w];
+			tree_merge: while ((c & 1) == 0) {
+#pragma HLS LOOP_TRIPCOUNT max=32
+				stack[sp - 2] = tree_node(xxh3, &sec, mdlen,
+							  rate_lanes,
+							  stack[sp - 2],
+							  stack[sp - 1]);
+				sp--;
+				c >>= 1;
+			}
+		}
+	}
+
+	tree_fold: while (sp > 1) {
+#pragma HLS LOOP_TRIPCOUNT max=32
+		stack[sp - 2] = tree_node(xxh3, &sec, mdlen, rate_lanes,
+					  stack[sp - 2], stack[sp - 1]);
+		sp--;
+	}
+
+	if (out_type == SNAP_ADDRTYPE_HOST_DRAM)
+		dout_gmem[out_addr >> ADDR_RIGHT_SHIFT] = stack[0];
+	else
+		d_ddrmem[out_addr >> ADDR_RIGHT_SHIFT] = stack[0];
+
+	Action_Register->Data.chk_out = stack[0](63, 0);
+	Action_Register->Data.nb_test_runs = 0;
+	Action_Register->Data.nb_rounds = 0;
+	Action_Register->Control.Retc = SNAP_RETC_SUCCESS;
+}
+
 //-----------------------------------------------------------------------------
 //--- MAIN PROGRAM ------------------------------------------------------------
 //-----------------------------------------------------------------------------
 
-void process_action( action_reg *Action_Register)
+static void process_sponge(action_reg *Action_Register)
 {
 	int rc = 1;
         uint64_t run_number, j;
@@ -400,6 +1662,57 @@ void process_action( action_reg *Action_Register)
 
 }
 
+static void process_action(snap_membus_t *din_gmem,
+			   snap_membus_t *dout_gmem,
+			   snap_membus_t *d_ddrmem,
+			   snapu32_t *d_nvme,
+			   action_reg *Action_Register)
+{
+	/* Only the streaming checksums read from NVMe */
+	if (Action_Register->Data.in.type == SNAP_ADDRTYPE_NVME &&
+	    Action_Register->Data.chk_type != CHECKSUM_CRC32 &&
+	    Action_Register->Data.chk_type != CHECKSUM_CRC32C &&
+	    Action_Register->Data.chk_type != CHECKSUM_ADLER32) {
+		Action_Register->Control.Retc = SNAP_RETC_FAILURE;
+		return;
+	}
+
+	switch (Action_Register->Data.chk_type) {
+	case CHECKSUM_CRC32:
+	case CHECKSUM_CRC32C:
+	case CHECKSUM_ADLER32:
+		process_checksum(din_gmem, d_ddrmem, d_nvme, Action_Register);
+		break;
+	case CHECKSUM_SPONGE:
+		process_sponge(Action_Register);
+		break;
+	case CHECKSUM_SHA3_224:
+	case CHECKSUM_SHA3_256:
+	case CHECKSUM_SHA3_384:
+	case CHECKSUM_SHA3_512:
+	case CHECKSUM_SHAKE128:
+	case CHECKSUM_SHAKE256:
+		if (Action_Register->Data.hash_flags & CHECKSUM_HASH_TREE)
+			process_hash_tree(din_gmem, dout_gmem, d_ddrmem,
+					  Action_Register);
+		else
+			process_sha3(din_gmem, dout_gmem, d_ddrmem,
+				     Action_Register);
+		break;
+	case CHECKSUM_XXH3:
+		if (Action_Register->Data.hash_flags & CHECKSUM_HASH_TREE)
+			process_hash_tree(din_gmem, dout_gmem, d_ddrmem,
+					  Action_Register);
+		else
+			process_xxh3(din_gmem, dout_gmem, d_ddrmem,
+				     Action_Register);
+		break;
+	default:
+		Action_Register->Control.Retc = SNAP_RETC_FAILURE;
+		break;
+	}
+}
+
 
 //--- INTERFACE LEVEL -------------------------------------------------
 /**
@@ -408,25 +1721,33 @@ void process_action( action_reg *Action_Register)
  * the cosimulation will not work, since the width of the interface cannot
  * be determined. Using an array din_gmem[...] works too to fix that.
  */
-// This example doesn't use FPGA DDR.
-// Need to set Environment Variable "SDRAM_USED=FALSE" before compilation.
+// CRC32, CRC32C, ADLER32, the SHA3 modes and XXH3 can use FPGA DDR.
+// Need to set Environment Variable "SDRAM_USED=TRUE" before compilation.
+// CRC32, CRC32C and ADLER32 also read NVMe, which needs "NVME_USED=TRUE".
 void hls_action(snap_membus_t *din_gmem,
 		    snap_membus_t *dout_gmem,
-		    //snap_membus_t *d_ddrmem, 
+		    snap_membus_t *d_ddrmem,
+		    snapu32_t *d_nvme,
 		    action_reg *Action_Register,
 		    action_RO_config_reg *Action_Config)
 {
 
 // Host Memory AXI Interface
-#pragma HLS INTERFACE m_axi port=din_gmem bundle=host_mem offset=slave depth=512
+#pragma HLS INTERFACE m_axi port=din_gmem bundle=host_mem offset=slave depth=512 \
+  max_read_burst_length=64  max_write_burst_length=64
 #pragma HLS INTERFACE s_axilite port=din_gmem bundle=ctrl_reg           offset=0x030
 
-#pragma HLS INTERFACE m_axi port=dout_gmem bundle=host_mem offset=slave depth=512
+#pragma HLS INTERFACE m_axi port=dout_gmem bundle=host_mem offset=slave depth=512 \
+  max_read_burst_length=64  max_write_burst_length=64
 #pragma HLS INTERFACE s_axilite port=dout_gmem bundle=ctrl_reg          offset=0x040
 
-//DDR memory Interface 
-//#pragma HLS INTERFACE m_axi port=d_ddrmem bundle=card_mem0 offset=slave depth=512
-//#pragma HLS INTERFACE s_axilite port=d_ddrmem bundle=ctrl_reg           offset=0x050
+//DDR memory Interface
+#pragma HLS INTERFACE m_axi port=d_ddrmem bundle=card_mem0 offset=slave depth=512 \
+  max_read_burst_length=64  max_write_burst_length=64
+#pragma HLS INTERFACE s_axilite port=d_ddrmem bundle=ctrl_reg           offset=0x050
+
+//NVMe host registers
+#pragma HLS INTERFACE m_axi port=d_nvme bundle=nvme offset=off
 
 // Host Memory AXI Lite Master Interface
 #pragma HLS DATA_PACK variable=Action_Config
@@ -445,7 +1766,8 @@ void hls_action(snap_membus_t *din_gmem,
         	break;
         default:
         	Action_Register->Control.Retc = (snapu32_t)0x0;
-        	process_action(Action_Register);
+        	process_action(din_gmem, dout_gmem, d_ddrmem, d_nvme,
+			       Action_Register);
         	break;
         }
 
@@ -459,6 +1781,537 @@ void hls_action(snap_membus_t *din_gmem,
 
 #ifdef NO_SYNTH
 
+#include <stdlib.h>
+
+/* Bytewise references to check the word oriented hardware versions */
+static uint32_t ref_crc32(uint32_t crc, const uint8_t *buf, size_t len,
+			  uint32_t poly)
+{
+	crc = ~crc;
+	while (len--) {
+		crc ^= *buf++;
+		for (int k = 0; k < 8; k++)
+			crc = (crc & 1) ? (crc >> 1) ^ poly : crc >> 1;
+	}
+	return ~crc;
+}
+
+static uint32_t ref_adler32(uint32_t adler, const uint8_t *buf, size_t len)
+{
+	uint32_t a = adler & 0xffff, b = adler >> 16;
+
+	while (len--) {
+		a = (a + *buf++) % ADLER32_BASE;
+		b = (b + a) % ADLER32_BASE;
+	}
+	return (b << 16) | a;
+}
+
+#define MEMORY_LINES	128	/* 8 KiB */
+#define HASH_OUT_LINE	80	/* digest area in the test memories */
+#define HASH_STATE_LINE	120	/* state area, 4 lines */
+#define HASH_DESC_LINE	72	/* batch descriptors, up to 32 */
+
+static snapu32_t tb_nvme[16];		/* NVMe host registers */
+
+static int test_checksum(snap_membus_t *din_gmem, snap_membus_t *dout_gmem,
+			 snap_membus_t *d_ddrmem, uint8_t *ref,
+			 uint16_t type, uint32_t mode,
+			 uint32_t offs, uint32_t size)
+{
+	action_reg Action_Register;
+	action_RO_config_reg Action_Config;
+	uint32_t expected;
+
+	switch (mode) {
+	case CHECKSUM_CRC32:
+		expected = ref_crc32(0x12345678, ref + offs, size, CRC32_POLY);
+		break;
+	case CHECKSUM_CRC32C:
+		expected = ref_crc32(0x12345678, ref + offs, size, CRC32C_POLY);
+		break;
+	default:
+		expected = ref_adler32(0x12345678, ref + offs, size);
+		break;
+	}
+
+	Action_Register.Control.flags = 1;
+	Action_Register.Data.chk_type = mode;
+	Action_Register.Data.chk_in = 0x12345678;
+	Action_Register.Data.in.addr = offs;
+	Action_Register.Data.in.size = size;
+	Action_Register.Data.in.type = type;
+	Action_Register.Data.in.flags = SNAP_ADDRFLAG_SRC;
+
+	hls_action(din_gmem, dout_gmem, d_ddrmem, tb_nvme,
+		   &Action_Register, &Action_Config);
+
+	if (Action_Register.Control.Retc != SNAP_RETC_SUCCESS ||
+	    Action_Register.Data.chk_out != expected) {
+		printf(" ==> mode %d type %d offs %d size %d: %08x expected "
+		       "%08x FAILED\n", mode, type, offs, size,
+		       (unsigned int)Action_Register.Data.chk_out, expected);
+		return 1;
+	}
+	return 0;
+}
+
+/*
+ * Hash ref[offs..offs+size-1] with one job, or with a sequence of jobs
+ * of chunk_blocks * rate bytes if chunk_blocks is not 0, and compare
+ * with the sha3.cpp software functions.
+ */
+static int test_hash(snap_membus_t *din_gmem, snap_membus_t *dout_gmem,
+		     snap_membus_t *d_ddrmem, const uint8_t *ref,
+		     uint16_t type, uint32_t mode, uint32_t offs,
+		     uint32_t size, uint32_t outlen, uint32_t chunk_blocks)
+{
+	action_reg Action_Register;
+	action_RO_config_reg Action_Config;
+	snap_membus_t *out_mem = (type == SNAP_ADDRTYPE_HOST_DRAM) ?
+		dout_gmem : d_ddrmem;
+	uint8_t expected[512], digest[512];
+	sha3_ctx_t ctx;
+	uint32_t mdlen, rate, done = 0;
+
+	switch (mode) {
+	case CHECKSUM_SHA3_224: mdlen = 28; break;
+	case CHECKSUM_SHA3_256: mdlen = 32; break;
+	case CHECKSUM_SHA3_384: mdlen = 48; break;
+	case CHECKSUM_SHA3_512: mdlen = 64; break;
+	case CHECKSUM_SHAKE128: mdlen = 16; break;
+	default:		mdlen = 32; break;
+	}
+	rate = 200 - 2 * mdlen;
+
+	if (mode == CHECKSUM_SHAKE128 || mode == CHECKSUM_SHAKE256) {
+		sha3_init(&ctx, mdlen);
+		shake_update(&ctx, ref + offs, size);
+		shake_xof(&ctx);
+		shake_out(&ctx, expected, outlen);
+	} else {
+		sha3(ref + offs, size, expected, mdlen);
+		outlen = mdlen;
+	}
+
+	Action_Register.Control.flags = 1;
+	Action_Register.Data.chk_type = mode;
+	Action_Register.Data.in.type = type;
+	Action_Register.Data.out.addr = HASH_OUT_LINE * BPERDW;
+	Action_Register.Data.out.size = outlen;
+	Action_Register.Data.out.type = type;
+	/* keep the state in the other memory to exercise both */
+	Action_Register.Data.state.addr = HASH_STATE_LINE * BPERDW;
+	Action_Register.Data.state.size = CHECKSUM_HASH_STATE_SIZE;
+	Action_Register.Data.state.type = (type == SNAP_ADDRTYPE_HOST_DRAM) ?
+		SNAP_ADDRTYPE_CARD_DRAM : SNAP_ADDRTYPE_HOST_DRAM;
+	Action_Register.Data.hash_flags = CHECKSUM_HASH_INIT;
+
+	do {
+		uint32_t n = size - done;
+
+		if (chunk_blocks && n > chunk_blocks * rate)
+			n = chunk_blocks * rate;
+		else
+			Action_Register.Data.hash_flags |= CHECKSUM_HASH_FINAL;
+
+		Action_Register.Data.in.addr = offs + done;
+		Action_Register.Data.in.size = n;
+		hls_action(din_gmem, dout_gmem, d_ddrmem, tb_nvme,
+			   &Action_Register, &Action_Config);
+		if (Action_Register.Control.Retc != SNAP_RETC_SUCCESS) {
+			printf(" ==> hash mode %d type %d offs %d size %d: "
+			       "job failed\n", mode, type, offs, size);
+			return 1;
+		}
+		Action_Register.Data.hash_flags &= ~CHECKSUM_HASH_INIT;
+		done += n;
+	} while (!(Action_Register.Data.hash_flags & CHECKSUM_HASH_FINAL));
+
+	for (uint32_t i = 0; i < outlen; i++)
+		digest[i] = out_mem[HASH_OUT_LINE + i / BPERDW]
+			(8 * (i % BPERDW) + 7, 8 * (i % BPERDW));
+
+	if (memcmp(digest, expected, outlen) != 0) {
+		printf(" ==> hash mode %d type %d offs %d size %d chunk %d: "
+		       "digest FAILED\n", mode, type, offs, size, chunk_blocks);
+		return 1;
+	}
+	return 0;
+}
+
+/*
+ * Batch of n messages with different lengths and alignments, spread
+ * over host and card memory. Descriptors and digests are in type.
+ */
+static int test_hash_batch(snap_membus_t *din_gmem, snap_membus_t *dout_gmem,
+			   snap_membus_t *d_ddrmem, const uint8_t *ref,
+			   uint16_t type, uint32_t mode, uint32_t n,
+			   uint32_t outlen)
+{
+	action_reg Action_Register;
+	action_RO_config_reg Action_Config;
+	snap_membus_t *mem = (type == SNAP_ADDRTYPE_HOST_DRAM) ?
+		dout_gmem : d_ddrmem;
+	uint8_t expected[64], digest[64];
+	sha3_ctx_t ctx;
+	uint32_t mdlen, i;
+	int rc = 0;
+
+	switch (mode) {
+	case CHECKSUM_SHA3_224: mdlen = 28; break;
+	case CHECKSUM_SHA3_256: mdlen = 32; break;
+	case CHECKSUM_SHA3_384: mdlen = 48; break;
+	case CHECKSUM_SHA3_512: mdlen = 64; break;
+	case CHECKSUM_SHAKE128: mdlen = 16; break;
+	default:		mdlen = 32; break;
+	}
+	if (mode != CHECKSUM_SHAKE128 && mode != CHECKSUM_SHAKE256)
+		outlen = mdlen;
+
+	for (i = 0; i < n; i++) {
+		uint32_t offs = (i * 37) % 200, size = (i * 97) % 700;
+		int w = i % SHA3_WAYS;
+		snap_membus_t *line = &mem[HASH_DESC_LINE + i / SHA3_WAYS];
+
+		(*line)(128 * w + 63, 128 * w) = offs;
+		(*line)(128 * w + 95, 128 * w + 64) = size;
+		(*line)(128 * w + 111, 128 * w + 96) = (i & 1) ?
+			SNAP_ADDRTYPE_CARD_DRAM : SNAP_ADDRTYPE_HOST_DRAM;
+		(*line)(128 * w + 127, 128 * w + 112) = SNAP_ADDRFLAG_ADDR;
+	}
+
+	Action_Register.Control.flags = 1;
+	Action_Register.Data.chk_type = mode;
+	Action_Register.Data.hash_flags = CHECKSUM_HASH_BATCH;
+	Action_Register.Data.in.addr = HASH_DESC_LINE * BPERDW;
+	Action_Register.Data.in.size = n * sizeof(struct snap_addr);
+	Action_Register.Data.in.type = type;
+	Action_Register.Data.out.addr = HASH_OUT_LINE * BPERDW;
+	Action_Register.Data.out.size = outlen;
+	Action_Register.Data.out.type = type;
+
+	hls_action(din_gmem, dout_gmem, d_ddrmem, tb_nvme,
+		   &Action_Register, &Action_Config);
+	if (Action_Register.Control.Retc != SNAP_RETC_SUCCESS ||
+	    Action_Register.Data.chk_out != n) {
+		printf(" ==> hash batch mode %d type %d n %d: job failed\n",
+		       mode, type, n);
+		return 1;
+	}
+
+	for (i = 0; i < n; i++) {
+		uint32_t offs = (i * 37) % 200, size = (i * 97) % 700;
+
+		if (mode == CHECKSUM_SHAKE128 || mode == CHECKSUM_SHAKE256) {
+			sha3_init(&ctx, mdlen);
+			shake_update(&ctx, ref + offs, size);
+			shake_xof(&ctx);
+			shake_out(&ctx, expected, outlen);
+		} else
+			sha3(ref + offs, size, expected, mdlen);
+
+		for (uint32_t k = 0; k < outlen; k++)
+			digest[k] = mem[HASH_OUT_LINE + i](8 * k + 7, 8 * k);
+		if (memcmp(digest, expected, outlen) != 0) {
+			printf(" ==> hash batch mode %d type %d message %d: "
+			       "digest FAILED\n", mode, type, i);
+			rc = 1;
+		}
+	}
+	return rc;
+}
+
+/*
+ * XXH3 of ref[offs..offs+size-1] from the xxHash library, for single
+ * jobs, and of the messages of test_xxh3_batch() with seed 0x55.
+ */
+static const struct {
+	uint32_t offs;
+	uint32_t size;
+	uint64_t seed;
+	uint64_t hash;
+} xxh3_expected[] = {
+	{  0,    0, 0x0000000000000000ull, 0x2d06800538d394c2ull },
+	{  5,    0, 0x123456789abcdef0ull, 0x8aa56c2c3d8317f6ull },
+	{ 64,    0, 0x0000000000000000ull, 0x2d06800538d394c2ull },
+	{  0,    3, 0x123456789abcdef0ull, 0x8cb655aa6022b088ull },
+	{  5,    3, 0x0000000000000000ull, 0x49a539e3df1e29b7ull },
+	{ 64,    3, 0x123456789abcdef0ull, 0xd844b5f23993fa01ull },
+	{  0,    8, 0x0000000000000000ull, 0x60539db630471163ull },
+	{  5,    8, 0x123456789abcdef0ull, 0x893b88c616dcbe48ull },
+	{ 64,    8, 0x0000000000000000ull, 0x3ce807440bf73951ull },
+	{  0,   16, 0x123456789abcdef0ull, 0x2ad917a43d6fbc6aull },
+	{  5,   16, 0x0000000000000000ull, 0x0b4f7df588f9dd13ull },
+	{ 64,   16, 0x123456789abcdef0ull, 0x0e3735c0aaad40f0ull },
+	{  0,   17, 0x0000000000000000ull, 0x714a04408e79b80full },
+	{  5,   17, 0x123456789abcdef0ull, 0xa6b0861ecf1b9221ull },
+	{ 64,   17, 0x0000000000000000ull, 0xe6994e155e3f4929ull },
+	{  0,  100, 0x123456789abcdef0ull, 0xb655cc561d6b9fc6ull },
+	{  5,  100, 0x0000000000000000ull, 0xcd922021f5769a89ull },
+	{ 64,  100, 0x123456789abcdef0ull, 0xbdb761a3e8efa9dbull },
+	{  0,  128, 0x0000000000000000ull, 0x29a1b5fc4e0235afull },
+	{  5,  128, 0x123456789abcdef0ull, 0x319b2975d649032aull },
+	{ 64,  128, 0x0000000000000000ull, 0x1726fd2304d5c677ull },
+	{  0,  129, 0x123456789abcdef0ull, 0x14a2c3666626026bull },
+	{  5,  129, 0x0000000000000000ull, 0xde2ddd65c233625full },
+	{ 64,  129, 0x123456789abcdef0ull, 0x6ce48f0c333fe185ull },
+	{  0,  240, 0x0000000000000000ull, 0xc50f661c24e43760ull },
+	{  5,  240, 0x123456789abcdef0ull, 0x713f841673090cb1ull },
+	{ 64,  240, 0x0000000000000000ull, 0xb9260fc775e0ebd2ull },
+	{  0,  241, 0x123456789abcdef0ull, 0x7872c8a8d3538fa5ull },
+	{  5,  241, 0x0000000000000000ull, 0x2315b698af95a3faull },
+	{ 64,  241, 0x123456789abcdef0ull, 0x5735d88047a79308ull },
+	{  0, 1024, 0x0000000000000000ull, 0xb051553f78e73e93ull },
+	{  5, 1024, 0x123456789abcdef0ull, 0x35acc336ab5b540cull },
+	{ 64, 1024, 0x0000000000000000ull, 0x67d46bb4317b5f04ull },
+	{  0, 1025, 0x123456789abcdef0ull, 0x6da2a6724bbf815aull },
+	{  5, 1025, 0x0000000000000000ull, 0x369e1fad68923039ull },
+	{ 64, 1025, 0x123456789abcdef0ull, 0xaa57b38dbe380feaull },
+	{  0, 1100, 0x0000000000000000ull, 0xf45ad9db2f77e458ull },
+	{  5, 1100, 0x123456789abcdef0ull, 0x6341fae26f21f842ull },
+	{ 64, 1100, 0x0000000000000000ull, 0x3d1ba9ca21c9eaf1ull },
+	{  0, 2049, 0x123456789abcdef0ull, 0x56e9a452feb4bd63ull },
+	{  5, 2049, 0x0000000000000000ull, 0x2e865093f4da716full },
+	{ 64, 2049, 0x123456789abcdef0ull, 0x6893232c7e769db6ull },
+	{  0, 4000, 0x0000000000000000ull, 0x90a5dd317b69d02full },
+	{  5, 4000, 0x123456789abcdef0ull, 0xaec38169e60b478cull },
+	{ 64, 4000, 0x0000000000000000ull, 0x973b7b340c47e7dbull },
+};
+
+static const uint64_t xxh3_batch_expected[] = {
+	0x42878ef81d85b4dbull,
+	0x6667592cfd4ece71ull,
+	0x574f5fb3f9f346a7ull,
+	0xf581d36ec3e5f4c6ull,
+	0x925f3e330fbd7ce4ull,
+	0xba2a6a943d954376ull,
+	0x04c75ea4e6394e3cull,
+	0x61983187029734d4ull,
+	0x8f6ec96c1a90c43aull,
+};
+
+static int test_xxh3(snap_membus_t *din_gmem, snap_membus_t *dout_gmem,
+		     snap_membus_t *d_ddrmem, uint16_t type, unsigned int i)
+{
+	action_reg Action_Register;
+	action_RO_config_reg Action_Config;
+
+	Action_Register.Control.flags = 1;
+	Action_Register.Data.chk_type = CHECKSUM_XXH3;
+	Action_Register.Data.chk_in = xxh3_expected[i].seed;
+	Action_Register.Data.hash_flags = 0;
+	Action_Register.Data.in.addr = xxh3_expected[i].offs;
+	Action_Register.Data.in.size = xxh3_expected[i].size;
+	Action_Register.Data.in.type = type;
+
+	hls_action(din_gmem, dout_gmem, d_ddrmem, tb_nvme,
+		   &Action_Register, &Action_Config);
+
+	if (Action_Register.Control.Retc != SNAP_RETC_SUCCESS ||
+	    Action_Register.Data.chk_out != xxh3_expected[i].hash) {
+		printf(" ==> XXH3 type %d offs %d size %d: %016llx expected "
+		       "%016llx FAILED\n", type, xxh3_expected[i].offs,
+		       xxh3_expected[i].size,
+		       (long long)Action_Register.Data.chk_out,
+		       (long long)xxh3_expected[i].hash);
+		return 1;
+	}
+	return 0;
+}
+
+/* Same messages as test_hash_batch(), hashes packed 8 per line */
+static int test_xxh3_batch(snap_membus_t *din_gmem, snap_membus_t *dout_gmem,
+			   snap_membus_t *d_ddrmem, uint16_t type, uint32_t n)
+{
+	action_reg Action_Register;
+	action_RO_config_reg Action_Config;
+	snap_membus_t *mem = (type == SNAP_ADDRTYPE_HOST_DRAM) ?
+		dout_gmem : d_ddrmem;
+	uint32_t i;
+	int rc = 0;
+
+	for (i = 0; i < n; i++) {
+		uint32_t offs = (i * 37) % 200, size = (i * 97) % 700;
+		int w = i % SHA3_WAYS;
+		snap_membus_t *line = &mem[HASH_DESC_LINE + i / SHA3_WAYS];
+
+		(*line)(128 * w + 63, 128 * w) = offs;
+		(*line)(128 * w + 95, 128 * w + 64) = size;
+		(*line)(128 * w + 111, 128 * w + 96) = (i & 1) ?
+			SNAP_ADDRTYPE_CARD_DRAM : SNAP_ADDRTYPE_HOST_DRAM;
+		(*line)(128 * w + 127, 128 * w + 112) = SNAP_ADDRFLAG_ADDR;
+	}
+
+	Action_Register.Control.flags = 1;
+	Action_Register.Data.chk_type = CHECKSUM_XXH3;
+	Action_Register.Data.chk_in = 0x55;
+	Action_Register.Data.hash_flags = CHECKSUM_HASH_BATCH;
+	Action_Register.Data.in.addr = HASH_DESC_LINE * BPERDW;
+	Action_Register.Data.in.size = n * sizeof(struct snap_addr);
+	Action_Register.Data.in.type = type;
+	Action_Register.Data.out.addr = HASH_OUT_LINE * BPERDW;
+	Action_Register.Data.out.size = n * sizeof(uint64_t);
+	Action_Register.Data.out.type = type;
+
+	hls_action(din_gmem, dout_gmem, d_ddrmem, tb_nvme,
+		   &Action_Register, &Action_Config);
+	if (Action_Register.Control.Retc != SNAP_RETC_SUCCESS ||
+	    Action_Register.Data.chk_out != n) {
+		printf(" ==> XXH3 batch type %d n %d: job failed\n", type, n);
+		return 1;
+	}
+
+	for (i = 0; i < n; i++) {
+		uint64_t h = mem[HASH_OUT_LINE + i / 8]
+			(64 * (i % 8) + 63, 64 * (i % 8));
+
+		if (h != xxh3_batch_expected[i]) {
+			printf(" ==> XXH3 batch type %d message %d: %016llx "
+			       "expected %016llx FAILED\n", type, i,
+			       (long long)h, (long long)xxh3_batch_expected[i]);
+			rc = 1;
+		}
+	}
+	return rc;
+}
+
+/* Merkle tree sizes and leaf sizes, at input offsets 0 and 5 */
+static const uint32_t tree_tests[][2] = {
+	{ 0, 64 }, { 1, 64 }, { 64, 64 }, { 65, 64 }, { 200, 64 },
+	{ 1000, 64 }, { 2000, 64 }, { 3000, 1024 }, { 4000, 192 },
+	{ 4000, 1024 },
+};
+
+/* XXH3 roots from the xxHash library, seed 0x55, offset 0, then 5 */
+static const uint64_t tree_xxh3_expected[] = {
+	0x42878ef81d85b4dbull,
+	0x20f2433716950cd8ull,
+	0x07d624cb01fdb216ull,
+	0x193651857c09c04cull,
+	0xbaa6c9bcb6c68c21ull,
+	0xdff4155badaa323aull,
+	0x8b423431badb13e8ull,
+	0xbc42a6467ba36e53ull,
+	0x738670dcd39cd8dbull,
+	0x4d0879e63ba4ffddull,
+	0x42878ef81d85b4dbull,
+	0xef48a53303aad2a5ull,
+	0x3ed2dbb444a54552ull,
+	0x54d99daacd24b2eeull,
+	0x58a80b4a58082c05ull,
+	0x8d62ffbe615a6066ull,
+	0xb5207f71408d46b0ull,
+	0x898411fa7cc96924ull,
+	0x3d44d49e37d2b4d6ull,
+	0x0fe42eeda9d4f667ull,
+};
+
+/* Recursive split at the largest power of two, like RFC 6962 */
+static void ref_tree(const uint8_t *buf, uint32_t size, uint32_t leaf_size,
+		     uint32_t mdlen, uint8_t *md)
+{
+	uint32_t n = size ? (size + leaf_size - 1) / leaf_size : 1, k = 1;
+	uint8_t m[1 + 2 * 64];
+
+	if (n == 1) {
+		sha3(buf, size, md, mdlen);
+		return;
+	}
+	while (2 * k < n)
+		k *= 2;
+	m[0] = 0x01;
+	ref_tree(buf, k * leaf_size, leaf_size, mdlen, m + 1);
+	ref_tree(buf + k * leaf_size, size - k * leaf_size, leaf_size, mdlen,
+		 m + 1 + mdlen);
+	sha3(m, 1 + 2 * mdlen, md, mdlen);
+}
+
+static int test_hash_tree(snap_membus_t *din_gmem, snap_membus_t *dout_gmem,
+			  snap_membus_t *d_ddrmem, const uint8_t *ref,
+			  uint16_t type, uint32_t mode, uint32_t offs,
+			  unsigned int t)
+{
+	action_reg Action_Register;
+	action_RO_config_reg Action_Config;
+	snap_membus_t *mem = (type == SNAP_ADDRTYPE_HOST_DRAM) ?
+		dout_gmem : d_ddrmem;
+	uint32_t size = tree_tests[t][0], leaf_size = tree_tests[t][1];
+	uint32_t n = size ? (size + leaf_size - 1) / leaf_size : 1;
+	uint8_t expected[64], digest[64];
+	uint32_t mdlen, i;
+	int rc = 0;
+
+	switch (mode) {
+	case CHECKSUM_SHA3_224: mdlen = 28; break;
+	case CHECKSUM_SHA3_256: mdlen = 32; break;
+	case CHECKSUM_SHA3_384: mdlen = 48; break;
+	case CHECKSUM_SHA3_512: mdlen = 64; break;
+	default:		mdlen = 8; break;
+	}
+
+	Action_Register.Control.flags = 1;
+	Action_Register.Data.chk_type = mode;
+	Action_Register.Data.chk_in = 0x55;
+	Action_Register.Data.hash_flags = CHECKSUM_HASH_TREE |
+		CHECKSUM_HASH_LEAVES;
+	Action_Register.Data.leaf_size = leaf_size;
+	Action_Register.Data.in.addr = offs;
+	Action_Register.Data.in.size = size;
+	Action_Register.Data.in.type = type;
+	Action_Register.Data.out.addr = HASH_OUT_LINE * BPERDW;
+	Action_Register.Data.out.size = (1 + n) * BPERDW;
+	Action_Register.Data.out.type = type;
+
+	hls_action(din_gmem, dout_gmem, d_ddrmem, tb_nvme,
+		   &Action_Register, &Action_Config);
+	if (Action_Register.Control.Retc != SNAP_RETC_SUCCESS) {
+		printf(" ==> tree mode %d type %d offs %d size %d leaf %d: "
+		       "job failed\n", mode, type, offs, size, leaf_size);
+		return 1;
+	}
+
+	if (mode == CHECKSUM_XXH3) {
+		uint64_t root = tree_xxh3_expected[t + (offs ? ARRAY_SIZE(
+						tree_tests) : 0)];
+
+		if (Action_Register.Data.chk_out != root) {
+			printf(" ==> tree XXH3 type %d offs %d size %d leaf "
+			       "%d: %016llx expected %016llx FAILED\n", type,
+			       offs, size, leaf_size,
+			       (long long)Action_Register.Data.chk_out,
+			       (long long)root);
+			return 1;
+		}
+		return 0;
+	}
+
+	ref_tree(ref + offs, size, leaf_size, mdlen, expected);
+	for (uint32_t k = 0; k < mdlen; k++)
+		digest[k] = mem[HASH_OUT_LINE](8 * k + 7, 8 * k);
+	if (memcmp(digest, expected, mdlen) != 0) {
+		printf(" ==> tree mode %d type %d offs %d size %d leaf %d: "
+		       "root FAILED\n", mode, type, offs, size, leaf_size);
+		rc = 1;
+	}
+
+	for (i = 0; i < n; i++) {
+		uint32_t len = (i == n - 1) ? size - i * leaf_size : leaf_size;
+
+		sha3(ref + offs + i * leaf_size, len, expected, mdlen);
+		for (uint32_t k = 0; k < mdlen; k++)
+			digest[k] = mem[HASH_OUT_LINE + 1 + i]
+				(8 * k + 7, 8 * k);
+		if (memcmp(digest, expected, mdlen) != 0) {
+			printf(" ==> tree mode %d type %d size %d leaf %d: "
+			       "leaf %d FAILED\n", mode, type, size,
+			       leaf_size, i);
+			rc = 1;
+		}
+	}
+	return rc;
+}
+
 /**
  * FIXME We need to use hls_action from here to get the real thing
  * simulated. For now let's take the short path and try without it.
@@ -469,27 +2322,185 @@ int main(void)
 {
 	short i, j, rc=0;
 
-	snap_membus_t din_gmem[1]; 	// Unused
-	snap_membus_t dout_gmem[1];	// Unused
-	//snap_membus_t d_ddrmem[1];	// Unused
+	static snap_membus_t din_gmem[MEMORY_LINES];
+	snap_membus_t *dout_gmem = din_gmem;	/* both are host memory */
+	static snap_membus_t d_ddrmem[MEMORY_LINES];
+	static uint8_t ref[MEMORY_LINES * BPERDW];
 	action_reg Action_Register;
 	action_RO_config_reg Action_Config;
+	const uint32_t sizes[] = { 0, 1, 63, 64, 65, 200, 1000, 4000 };
+	const uint32_t offsets[] = { 0, 1, 31, 64 };
+	const uint32_t modes[] = { CHECKSUM_CRC32, CHECKSUM_CRC32C,
+				   CHECKSUM_ADLER32 };
+
+	for (i = 0; i < MEMORY_LINES; i++)
+		for (j = 0; j < BPERDW; j++) {
+			ref[i * BPERDW + j] = (uint8_t)(i * 131 + j * 7 + 3);
+			din_gmem[i](8 * j + 7, 8 * j) = ref[i * BPERDW + j];
+			d_ddrmem[i](8 * j + 7, 8 * j) = ref[i * BPERDW + j];
+		}
+
+	//********CRC32, CRC32C, ADLER32 TESTS*******
+	for (unsigned int m = 0; m < ARRAY_SIZE(modes); m++)
+		for (unsigned int o = 0; o < ARRAY_SIZE(offsets); o++)
+			for (unsigned int s = 0; s < ARRAY_SIZE(sizes); s++) {
+				rc |= test_checksum(din_gmem, dout_gmem,
+					d_ddrmem, ref, SNAP_ADDRTYPE_HOST_DRAM,
+					modes[m], offsets[o], sizes[s]);
+				rc |= test_checksum(din_gmem, dout_gmem,
+					d_ddrmem, ref, SNAP_ADDRTYPE_CARD_DRAM,
+					modes[m], offsets[o], sizes[s]);
+			}
+	if (rc == 0)
+		printf(" ==> CRC32/CRC32C/ADLER32 checksums OK\n");
+
+	//********NVME SOURCE TESTS*******
+	{
+		/* Chunks of the staging area are 1 MiB, use a few of them */
+		const uint32_t drive_size = 3 * 1024 * 1024;
+		const uint32_t nvme_sizes[] = { 0, 1000, 1024 * 1024,
+						2 * 1024 * 1024 + 4077 };
+		const uint32_t nvme_offsets[] = { 0, 1536 };
+		uint64_t card_size = SNAP_NVME_STAGING_ADDR +
+			SNAP_NVME_STAGING_SIZE;
+		uint8_t *drive = (uint8_t *)malloc(drive_size);
+		snap_membus_t *card = (snap_membus_t *)calloc(1, card_size);
+		int nrc = 0;
+
+		if (drive == NULL || card == NULL)
+			return 1;
+		for (uint32_t k = 0; k < drive_size; k++)
+			drive[k] = (uint8_t)(k * 13 + (k >> 11));
+		nvme_sim_setup(drive, drive_size, NULL, 0, card, card_size);
+
+		for (unsigned int m = 0; m < ARRAY_SIZE(modes); m++)
+		for (unsigned int o = 0; o < ARRAY_SIZE(nvme_offsets); o++)
+		for (unsigned int s = 0; s < ARRAY_SIZE(nvme_sizes); s++)
+			nrc |= test_checksum(din_gmem, dout_gmem, card, drive,
+					     SNAP_ADDRTYPE_NVME, modes[m],
+					     nvme_offsets[o], nvme_sizes[s]);
+
+		/* Unaligned drive offsets, beyond the drive, hash modes */
+		Action_Register.Control.flags = 1;
+		Action_Register.Data.chk_type = CHECKSUM_CRC32;
+		Action_Register.Data.in.type = SNAP_ADDRTYPE_NVME;
+		Action_Register.Data.in.flags = SNAP_ADDRFLAG_SRC;
+		Action_Register.Data.in.addr = 100;
+		Action_Register.Data.in.size = 1000;
+		hls_action(din_gmem, dout_gmem, card, tb_nvme,
+			   &Action_Register, &Action_Config);
+		nrc |= Action_Register.Control.Retc != SNAP_RETC_FAILURE;
+		Action_Register.Data.in.addr = drive_size - 1024;
+		Action_Register.Data.in.size = 4096;
+		hls_action(din_gmem, dout_gmem, card, tb_nvme,
+			   &Action_Register, &Action_Config);
+		nrc |= Action_Register.Control.Retc != SNAP_RETC_FAILURE;
+		Action_Register.Data.chk_type = CHECKSUM_SHA3_256;
+		Action_Register.Data.in.addr = 0;
+		hls_action(din_gmem, dout_gmem, card, tb_nvme,
+			   &Action_Register, &Action_Config);
+		nrc |= Action_Register.Control.Retc != SNAP_RETC_FAILURE;
+		Action_Register.Data.in.type = SNAP_ADDRTYPE_HOST_DRAM;
+
+		free(drive);
+		free(card);
+		if (nrc == 0)
+			printf(" ==> NVMe checksums OK\n");
+		rc |= nrc;
+	}
 
+	//********SHA3, SHAKE TESTS*******
+	{
+		const uint32_t hash_modes[] = {
+			CHECKSUM_SHA3_224, CHECKSUM_SHA3_256,
+			CHECKSUM_SHA3_384, CHECKSUM_SHA3_512,
+			CHECKSUM_SHAKE128, CHECKSUM_SHAKE256 };
+		const uint32_t hash_sizes[] = { 0, 1, 71, 72, 135, 136, 137,
+						500, 3000 };
+		const uint32_t hash_offsets[] = { 0, 5, 64 };
+		const uint32_t hash_outlens[] = { 32, 500 };
+		const uint32_t chunks[] = { 0, 1, 3 };
+		const uint16_t types[] = { SNAP_ADDRTYPE_HOST_DRAM,
+					   SNAP_ADDRTYPE_CARD_DRAM };
+		int hrc = 0;
+
+		for (unsigned int m = 0; m < ARRAY_SIZE(hash_modes); m++)
+		for (unsigned int t = 0; t < ARRAY_SIZE(types); t++)
+		for (unsigned int o = 0; o < ARRAY_SIZE(hash_offsets); o++)
+		for (unsigned int s = 0; s < ARRAY_SIZE(hash_sizes); s++)
+		for (unsigned int c = 0; c < ARRAY_SIZE(chunks); c++)
+		for (unsigned int l = 0; l < ARRAY_SIZE(hash_outlens); l++)
+			hrc |= test_hash(din_gmem, dout_gmem, d_ddrmem, ref,
+					 types[t], hash_modes[m],
+					 hash_offsets[o], hash_sizes[s],
+					 hash_outlens[l], chunks[c]);
+		for (unsigned int m = 0; m < ARRAY_SIZE(hash_modes); m++)
+		for (unsigned int t = 0; t < ARRAY_SIZE(types); t++)
+		for (uint32_t n = 1; n <= 9; n += 4)
+			hrc |= test_hash_batch(din_gmem, dout_gmem, d_ddrmem,
+					       ref, types[t], hash_modes[m],
+					       n, 20);
+		if (hrc == 0)
+			printf(" ==> SHA3/SHAKE digests OK\n");
+		rc |= hrc;
+	}
+
+	//********XXH3 TESTS*******
+	{
+		const uint16_t types[] = { SNAP_ADDRTYPE_HOST_DRAM,
+					   SNAP_ADDRTYPE_CARD_DRAM };
+		int xrc = 0;
+
+		for (unsigned int t = 0; t < ARRAY_SIZE(types); t++) {
+			for (unsigned int x = 0; x < ARRAY_SIZE(xxh3_expected);
+			     x++)
+				xrc |= test_xxh3(din_gmem, dout_gmem,
+						 d_ddrmem, types[t], x);
+			for (uint32_t n = 1; n <= 9; n += 4)
+				xrc |= test_xxh3_batch(din_gmem, dout_gmem,
+						       d_ddrmem, types[t], n);
+		}
+		if (xrc == 0)
+			printf(" ==> XXH3 hashes OK\n");
+		rc |= xrc;
+	}
+
+	//********MERKLE TREE TESTS*******
+	{
+		const uint32_t tree_modes[] = {
+			CHECKSUM_SHA3_224, CHECKSUM_SHA3_256,
+			CHECKSUM_SHA3_512, CHECKSUM_XXH3 };
+		const uint16_t types[] = { SNAP_ADDRTYPE_HOST_DRAM,
+					   SNAP_ADDRTYPE_CARD_DRAM };
+		int trc = 0;
+
+		for (unsigned int m = 0; m < ARRAY_SIZE(tree_modes); m++)
+		for (unsigned int t = 0; t < ARRAY_SIZE(types); t++)
+		for (uint32_t offs = 0; offs <= 5; offs += 5)
+		for (unsigned int x = 0; x < ARRAY_SIZE(tree_tests); x++)
+			trc |= test_hash_tree(din_gmem, dout_gmem, d_ddrmem,
+					      ref, types[t], tree_modes[m],
+					      offs, x);
+		if (trc == 0)
+			printf(" ==> Merkle tree roots OK\n");
+		rc |= trc;
+	}
 
 	// Get Config registers
 	Action_Register.Control.flags = 0;
-	hls_action(din_gmem, dout_gmem, //d_ddrmem,
+	hls_action(din_gmem, dout_gmem, d_ddrmem, tb_nvme,
 			    &Action_Register, &Action_Config);
 
 	// Process the action
 	Action_Register.Control.flags = 1;
+	Action_Register.Data.chk_type = CHECKSUM_SPONGE;
 
 	//********SPEED TESTS*******
 	Action_Register.Data.test_choice = 0; 	//speed test
 	Action_Register.Data.nb_elmts = 2;			// 2 calls
 	Action_Register.Data.freq = NB_TEST_RUNS; // every NB_TEST_RUNS until NB_TEST_RUNS
 
-	hls_action(din_gmem, dout_gmem, //d_ddrmem,
+	hls_action(din_gmem, dout_gmem, d_ddrmem, tb_nvme,
 			    &Action_Register, &Action_Config);
 	printf(" ==> 2 test calls : checksum = %016llx",
 			(long long) Action_Register.Data.chk_out);
@@ -501,7 +2512,7 @@ int main(void)
 	//********SPEED TESTS*******
 	Action_Register.Data.nb_elmts = 4;			// 4 calls
 	Action_Register.Data.freq = NB_TEST_RUNS; // every NB_TEST_RUNS until NB_TEST_RUNS
-	hls_action(din_gmem, dout_gmem, //d_ddrmem,
+	hls_action(din_gmem, dout_gmem, d_ddrmem, tb_nvme,
 			    &Action_Register, &Action_Config);
 	printf(" ==> 4 test calls : checksum = %016llx",
 			(long long) Action_Register.Data.chk_out);
@@ -513,11 +2524,11 @@ int main(void)
 #ifndef TEST_SPEED_ONLY
 	//********SHA3 + SHAKE TESTS*******
 	Action_Register.Data.test_choice = 3; //SHA3 + SHAKE tests
-	hls_action(din_gmem, dout_gmem, //d_ddrmem,
+	hls_action(din_gmem, dout_gmem, d_ddrmem, tb_nvme,
 			    &Action_Register, &Action_Config);
 #endif // end of TEST_SPEED_ONLY flag
 
-	if (Action_Register.Control.Retc == SNAP_RETC_FAILURE) {
+	if (rc != 0 || Action_Register.Control.Retc == SNAP_RETC_FAILURE) {
 				printf(" ==> RETURN CODE FAILURE <==\n");
 				return 1;
 	}
@@ -74,13 +74,8 @@ void cast_uint64_to_uint8(uint64_t *st_in, uint8_t *st_out, unsigned int size)
     }
 }
 
-// update the state with given number of rounds
-
-//void sha3_keccakf(uint64_t st[25])
-void sha3_keccakf(uint64_t st_in[25], uint64_t st_out[25])
-{
-    // constants
-    const uint64_t keccakf_rndc[24] = {
+// constants
+static const uint64_t keccakf_rndc[24] = {
         0x0000000000000001, 0x0000000000008082, 0x800000000000808a,
         0x8000000080008000, 0x000000000000808b, 0x0000000080000001,
         0x8000000080008081, 0x8000000000008009, 0x000000000000008a,
@@ -89,19 +84,61 @@ void sha3_keccakf(uint64_t st_in[25], uint64_t st_out[25])
         0x8000000000008003, 0x8000000000008002, 0x8000000000000080,
         0x000000000000800a, 0x800000008000000a, 0x8000000080008081,
         0x8000000000008080, 0x0000000080000001, 0x8000000080008008
-    };
-    const int keccakf_rotc[24] = {
+};
+static const int keccakf_rotc[24] = {
         1,  3,  6,  10, 15, 21, 28, 36, 45, 55, 2,  14,
         27, 41, 56, 8,  25, 43, 62, 18, 39, 61, 20, 44
-    };
-    const int keccakf_piln[24] = {
+};
+static const int keccakf_piln[24] = {
         10, 7,  11, 17, 18, 3, 5,  16, 8,  21, 24, 4,
         15, 23, 19, 13, 12, 2, 20, 14, 22, 9,  6,  1
-    };
+};
 
-    // variables
-    int i, j, r;
+// one round, separate so that several states can share the round logic
+void sha3_keccakf_round(uint64_t st[25], int r)
+{
+#pragma HLS INLINE
+    int i, j;
     uint64_t t, bc[5];
+
+    // Theta
+    for (i = 0; i < 5; i++)
+        bc[i] = st[i] ^ st[i + 5] ^ st[i + 10] ^ st[i + 15] ^ st[i + 20];
+
+    for (i = 0; i < 5; i++) {
+        t = bc[(i + 4) % 5] ^ ROTL64(bc[(i + 1) % 5], 1);
+        for (j = 0; j < 25; j += 5)
+            st[j + i] ^= t;
+    }
+
+    // Rho Pi
+    t = st[1];
+    for (i = 0; i < 24; i++) {
+        j = keccakf_piln[i];
+        bc[0] = st[j];
+        st[j] = ROTL64(t, keccakf_rotc[i]);
+        t = bc[0];
+    }
+
+    //  Chi
+    for (j = 0; j < 25; j += 5) {
+        for (i = 0; i < 5; i++)
+            bc[i] = st[j + i];
+        for (i = 0; i < 5; i++)
+            st[j + i] ^= (~bc[(i + 1) % 5]) & bc[(i + 2) % 5];
+    }
+
+    //  Iota
+    st[0] ^= keccakf_rndc[r];
+}
+
+// update the state with given number of rounds
+
+//void sha3_keccakf(uint64_t st[25])
+void sha3_keccakf(uint64_t st_in[25], uint64_t st_out[25])
+{
+    // variables
+    int i, r;
     uint64_t st[25];
 
     //separate entry port from logic
@@ -126,35 +163,7 @@ void sha3_keccakf(uint64_t st_in[25], uint64_t st_out[25])
     // actual iteration
     keccakfrounds:for (r = 0; r < KECCAKF_ROUNDS; r++) {
 #pragma HLS PIPELINE
-        // Theta
-        for (i = 0; i < 5; i++)
-            bc[i] = st[i] ^ st[i + 5] ^ st[i + 10] ^ st[i + 15] ^ st[i + 20];
-
-        for (i = 0; i < 5; i++) {
-            t = bc[(i + 4) % 5] ^ ROTL64(bc[(i + 1) % 5], 1);
-            for (j = 0; j < 25; j += 5)
-                st[j + i] ^= t;
-        }
-
-        // Rho Pi
-        t = st[1];
-        for (i = 0; i < 24; i++) {
-            j = keccakf_piln[i];
-            bc[0] = st[j];
-            st[j] = ROTL64(t, keccakf_rotc[i]);
-            t = bc[0];
-        }
-
-        //  Chi
-        for (j = 0; j < 25; j += 5) {
-            for (i = 0; i < 5; i++)
-                bc[i] = st[j + i];
-            for (i = 0; i < 5; i++)
-                st[j + i] ^= (~bc[(i + 1) % 5]) & bc[(i + 2) % 5];
-        }
-
-        //  Iota
-        st[0] ^= keccakf_rndc[r];
+        sha3_keccakf_round(st, r);
     }
 
 #if __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
@@ -24,7 +24,7 @@ extern "C" {
 #endif
 
 #define CHECKSUM_ACTION_TYPE 0x10141001
-#define RELEASE_LEVEL        0x00000020 
+#define RELEASE_LEVEL        0x00000025
 
 // For simulation use smaller numbers like 8 for both
 #define NB_ROUNDS      65536
@@ -34,7 +34,15 @@ typedef enum {
 	CHECKSUM_CRC32 = 0x0,
 	CHECKSUM_ADLER32 = 0x1,
 	CHECKSUM_SPONGE = 0x2,
-	CHECKSUM_MODE_MAX = 0x3,
+	CHECKSUM_CRC32C = 0x3,
+	CHECKSUM_SHA3_224 = 0x4,
+	CHECKSUM_SHA3_256 = 0x5,
+	CHECKSUM_SHA3_384 = 0x6,
+	CHECKSUM_SHA3_512 = 0x7,
+	CHECKSUM_SHAKE128 = 0x8,
+	CHECKSUM_SHAKE256 = 0x9,
+	CHECKSUM_XXH3 = 0xa,
+	CHECKSUM_MODE_MAX = 0xb,
 } checksum_mode_t;
 
 typedef enum {
@@ -45,16 +53,82 @@ typedef enum {
 	CHECKSUM_TYPE_MAX = 0x4,
 } test_choice_t;
 
+/* hash_flags for the SHA3, SHAKE and XXH3 modes */
+#define CHECKSUM_HASH_INIT	0x00000001 /* start with a zero state */
+#define CHECKSUM_HASH_FINAL	0x00000002 /* pad and write the digest */
+#define CHECKSUM_HASH_BATCH	0x00000004 /* in is a descriptor array */
+#define CHECKSUM_HASH_TREE	0x00000008 /* Merkle tree of leaf_size leaves */
+#define CHECKSUM_HASH_LEAVES	0x00000010 /* tree: also write leaf digests */
+
+#define CHECKSUM_HASH_STATE_SIZE 256	/* 200 byte state, 64 byte lines */
+#define CHECKSUM_HASH_SLOT_SIZE	64	/* digest slot in batch mode */
+
+/*
+ * For CRC32, CRC32C and ADLER32 chk_in is the running checksum of the
+ * data preceding the buffer, like the crc/adler argument of zlib's
+ * crc32()/adler32(): 0 starts a new CRC, 1 starts a new Adler-32.
+ * The input buffer can be in host or card memory and does not need
+ * to be aligned. A long buffer can be checksummed by a chain of jobs,
+ * each passing its chk_out as chk_in of the next, or as independent
+ * chunks whose CRCs are merged with crc32_ieee_combine() or
+ * crc32c_combine() from sw/crc32.h.
+ *
+ * The SHA3 and SHAKE modes hash the input buffer into out, which must
+ * be 64 byte aligned. Whole 64 byte lines are written. The digest has
+ * out.size bytes for SHAKE, the SHA3 modes write 28, 32, 48 or 64
+ * bytes. chk_out returns the first 8 digest bytes, little endian.
+ * Large inputs can be hashed by a sequence of jobs: the first one
+ * sets CHECKSUM_HASH_INIT, the last one CHECKSUM_HASH_FINAL, and
+ * in between the Keccak state is kept in the 64 byte aligned state
+ * buffer (CHECKSUM_HASH_STATE_SIZE bytes, 25 little endian lanes).
+ * All but the last job must hash a multiple of the rate, which is
+ * 200 - 2 * (digest size) bytes, with 16 and 32 bytes for SHAKE128
+ * and SHAKE256.
+ *
+ * With CHECKSUM_HASH_BATCH many small messages are hashed by one job.
+ * in then points to a 64 byte aligned array of struct snap_addr, one
+ * per message, and in.size is the size of that array in bytes. Each
+ * message is hashed completely, the state buffer is not used. The
+ * digest of message i goes to out.addr + i * CHECKSUM_HASH_SLOT_SIZE,
+ * for SHAKE out.size is the digest size per message, at most 64 bytes.
+ * chk_out returns the number of messages.
+ *
+ * CHECKSUM_XXH3 computes the 64 bit XXH3 hash of the input buffer
+ * (host or card memory, any alignment) with chk_in as seed and
+ * returns it in chk_out, same values as XXH3_64bits_withSeed() of
+ * the xxHash library. hash_flags and the state buffer are ignored,
+ * except CHECKSUM_HASH_BATCH: it takes the same descriptor array as
+ * the SHA3 batch mode and writes one little endian 64 bit hash per
+ * message to out.addr + i * 8. out must be 64 byte aligned and its
+ * size is rounded up to 64 bytes.
+ *
+ * CHECKSUM_HASH_TREE computes a Merkle tree over the input with the
+ * SHA3 modes or XXH3. The input is cut into leaves of leaf_size bytes,
+ * a non zero multiple of 64, the last leaf can be shorter and an empty
+ * input is one empty leaf. A leaf digest is the plain hash of the leaf,
+ * an inner node is H(0x01 || left || right) and an odd node at the end
+ * of a level moves up unchanged, which gives the tree shape of RFC 6962.
+ * XXH3 uses the seed in chk_in for leaves and nodes. The root goes to
+ * the first 64 byte line of out, with CHECKSUM_HASH_LEAVES the leaf
+ * digests follow from the second line on, one per line for SHA3, eight
+ * per line for XXH3. chk_out returns the first 8 root bytes, little
+ * endian. The tree shape depends on in.size, so a verifier must know
+ * the size of the object. SHAKE is not supported.
+ */
 typedef struct checksum_job {
 	struct snap_addr in;	/* in:  input data */
-	uint64_t chk_in;	/* in:  checksum input */
+	uint64_t chk_in;	/* in:  checksum to continue */
 	uint64_t chk_out;	/* out: checksum output */
-	uint32_t chk_type;	/* in:  CRC32, ADDLER32 */
+	uint32_t chk_type;	/* in:  checksum_mode_t */
 	uint32_t test_choice;	/* in:  special parameter for sponge */
 	uint32_t nb_elmts;	/* in:  special parameter for sponge */
 	uint32_t freq;		/* in:  special parameter for sponge */
 	uint32_t nb_test_runs;  /* out: special parameter for sponge */
 	uint32_t nb_rounds;     /* out: special parameter for sponge */
+	struct snap_addr out;	/* in:  digest output for SHA3/SHAKE */
+	struct snap_addr state;	/* in:  Keccak state between SHA3 jobs */
+	uint32_t hash_flags;	/* in:  CHECKSUM_HASH_INIT/FINAL */
+	uint32_t leaf_size;	/* in:  Merkle tree leaf size */
 } checksum_job_t;
 
 #ifdef __cplusplus
@@ -44,6 +44,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <malloc.h>
 #include <stdint.h>
 #include <errno.h>
 #include <string.h>
@@ -52,12 +53,20 @@
 #include <snap_internal.h>
 #include <action_checksum.h>
 #include <sha3.h>
+#include <crc32.h>
+#include <sha3_x4.h>
+#include <worker_pool.h>
+#include <xxh3.h>
+#include <merkle.h>
+
+static struct snap_card *checksum_card;	/* for the emulated card DRAM */
 
 static int mmio_write32(struct snap_card *card,
 			uint64_t offs, uint32_t data)
 {
 	act_trace("  %s(%p, %llx, %x)\n", __func__, card,
 		  (long long)offs, data);
+	checksum_card = card;
 	return 0;
 }
 
@@ -66,151 +75,52 @@ static int mmio_read32(struct snap_card *card,
 {
 	act_trace("  %s(%p, %llx, %x)\n", __func__, card,
 		  (long long)offs, *data);
+	checksum_card = card;
 	return 0;
 }
 
-/* Table of CRCs of all 8-bit messages. */
-#if defined(CONFIG_BUILD_CRC_TABLE)
-
-static unsigned long crc_table[256];
-
-/* Flag: has the table been computed? Initially false. */
-static int crc_table_computed = 0;
-
-/* Make the table for a fast CRC. */
-static void make_crc_table(void)
-{
-	unsigned long c;
-	int n, k;
-
-	for (n = 0; n < 256; n++) {
-		c = (unsigned long) n;
-		for (k = 0; k < 8; k++) {
-			if (c & 1) {
-				c = 0xedb88320L ^ (c >> 1);
-			} else {
-				c = c >> 1;
-			}
-		}
-		crc_table[n] = c;
-	}
-	crc_table_computed = 1;
-}
-
-static void dump_crc_table(void)
+/* Where a host or card DRAM buffer of a job is, NULL if nowhere */
+static uint8_t *checksum_mem(const struct snap_addr *a)
 {
-	int i;
-
-	printf("static unsigned long crc_table[] = {\n");
-	for (i = 0; i < 256; i++) {
-		printf(" 0x%08lx,", (long)crc_table[i]);
-		if ((i & 3) == 3)
-			printf("\n");
+	switch (a->type) {
+	case SNAP_ADDRTYPE_HOST_DRAM:
+		return (uint8_t *)(unsigned long)a->addr;
+	case SNAP_ADDRTYPE_CARD_DRAM:
+		if (checksum_card == NULL)
+			return NULL;
+		return snap_card_ddr_emu(checksum_card, a->addr, a->size);
+	default:
+		return NULL;
 	}
-	printf("};\n");
 }
 
-#else
-
-static unsigned long crc_table[] = {
-	0x00000000, 0x77073096, 0xee0e612c, 0x990951ba,
-	0x076dc419, 0x706af48f, 0xe963a535, 0x9e6495a3,
-	0x0edb8832, 0x79dcb8a4, 0xe0d5e91e, 0x97d2d988,
-	0x09b64c2b, 0x7eb17cbd, 0xe7b82d07, 0x90bf1d91,
-	0x1db71064, 0x6ab020f2, 0xf3b97148, 0x84be41de,
-	0x1adad47d, 0x6ddde4eb, 0xf4d4b551, 0x83d385c7,
-	0x136c9856, 0x646ba8c0, 0xfd62f97a, 0x8a65c9ec,
-	0x14015c4f, 0x63066cd9, 0xfa0f3d63, 0x8d080df5,
-	0x3b6e20c8, 0x4c69105e, 0xd56041e4, 0xa2677172,
-	0x3c03e4d1, 0x4b04d447, 0xd20d85fd, 0xa50ab56b,
-	0x35b5a8fa, 0x42b2986c, 0xdbbbc9d6, 0xacbcf940,
-	0x32d86ce3, 0x45df5c75, 0xdcd60dcf, 0xabd13d59,
-	0x26d930ac, 0x51de003a, 0xc8d75180, 0xbfd06116,
-	0x21b4f4b5, 0x56b3c423, 0xcfba9599, 0xb8bda50f,
-	0x2802b89e, 0x5f058808, 0xc60cd9b2, 0xb10be924,
-	0x2f6f7c87, 0x58684c11, 0xc1611dab, 0xb6662d3d,
-	0x76dc4190, 0x01db7106, 0x98d220bc, 0xefd5102a,
-	0x71b18589, 0x06b6b51f, 0x9fbfe4a5, 0xe8b8d433,
-	0x7807c9a2, 0x0f00f934, 0x9609a88e, 0xe10e9818,
-	0x7f6a0dbb, 0x086d3d2d, 0x91646c97, 0xe6635c01,
-	0x6b6b51f4, 0x1c6c6162, 0x856530d8, 0xf262004e,
-	0x6c0695ed, 0x1b01a57b, 0x8208f4c1, 0xf50fc457,
-	0x65b0d9c6, 0x12b7e950, 0x8bbeb8ea, 0xfcb9887c,
-	0x62dd1ddf, 0x15da2d49, 0x8cd37cf3, 0xfbd44c65,
-	0x4db26158, 0x3ab551ce, 0xa3bc0074, 0xd4bb30e2,
-	0x4adfa541, 0x3dd895d7, 0xa4d1c46d, 0xd3d6f4fb,
-	0x4369e96a, 0x346ed9fc, 0xad678846, 0xda60b8d0,
-	0x44042d73, 0x33031de5, 0xaa0a4c5f, 0xdd0d7cc9,
-	0x5005713c, 0x270241aa, 0xbe0b1010, 0xc90c2086,
-	0x5768b525, 0x206f85b3, 0xb966d409, 0xce61e49f,
-	0x5edef90e, 0x29d9c998, 0xb0d09822, 0xc7d7a8b4,
-	0x59b33d17, 0x2eb40d81, 0xb7bd5c3b, 0xc0ba6cad,
-	0xedb88320, 0x9abfb3b6, 0x03b6e20c, 0x74b1d29a,
-	0xead54739, 0x9dd277af, 0x04db2615, 0x73dc1683,
-	0xe3630b12, 0x94643b84, 0x0d6d6a3e, 0x7a6a5aa8,
-	0xe40ecf0b, 0x9309ff9d, 0x0a00ae27, 0x7d079eb1,
-	0xf00f9344, 0x8708a3d2, 0x1e01f268, 0x6906c2fe,
-	0xf762575d, 0x806567cb, 0x196c3671, 0x6e6b06e7,
-	0xfed41b76, 0x89d32be0, 0x10da7a5a, 0x67dd4acc,
-	0xf9b9df6f, 0x8ebeeff9, 0x17b7be43, 0x60b08ed5,
-	0xd6d6a3e8, 0xa1d1937e, 0x38d8c2c4, 0x4fdff252,
-	0xd1bb67f1, 0xa6bc5767, 0x3fb506dd, 0x48b2364b,
-	0xd80d2bda, 0xaf0a1b4c, 0x36034af6, 0x41047a60,
-	0xdf60efc3, 0xa867df55, 0x316e8eef, 0x4669be79,
-	0xcb61b38c, 0xbc66831a, 0x256fd2a0, 0x5268e236,
-	0xcc0c7795, 0xbb0b4703, 0x220216b9, 0x5505262f,
-	0xc5ba3bbe, 0xb2bd0b28, 0x2bb45a92, 0x5cb36a04,
-	0xc2d7ffa7, 0xb5d0cf31, 0x2cd99e8b, 0x5bdeae1d,
-	0x9b64c2b0, 0xec63f226, 0x756aa39c, 0x026d930a,
-	0x9c0906a9, 0xeb0e363f, 0x72076785, 0x05005713,
-	0x95bf4a82, 0xe2b87a14, 0x7bb12bae, 0x0cb61b38,
-	0x92d28e9b, 0xe5d5be0d, 0x7cdcefb7, 0x0bdbdf21,
-	0x86d3d2d4, 0xf1d4e242, 0x68ddb3f8, 0x1fda836e,
-	0x81be16cd, 0xf6b9265b, 0x6fb077e1, 0x18b74777,
-	0x88085ae6, 0xff0f6a70, 0x66063bca, 0x11010b5c,
-	0x8f659eff, 0xf862ae69, 0x616bffd3, 0x166ccf45,
-	0xa00ae278, 0xd70dd2ee, 0x4e048354, 0x3903b3c2,
-	0xa7672661, 0xd06016f7, 0x4969474d, 0x3e6e77db,
-	0xaed16a4a, 0xd9d65adc, 0x40df0b66, 0x37d83bf0,
-	0xa9bcae53, 0xdebb9ec5, 0x47b2cf7f, 0x30b5ffe9,
-	0xbdbdf21c, 0xcabac28a, 0x53b39330, 0x24b4a3a6,
-	0xbad03605, 0xcdd70693, 0x54de5729, 0x23d967bf,
-	0xb3667a2e, 0xc4614ab8, 0x5d681b02, 0x2a6f2b94,
-	0xb40bbe37, 0xc30c8ea1, 0x5a05df1b, 0x2d02ef8d,
-};
-#endif
-
 /*
-  Update a running crc with the bytes buf[0..len-1] and return
-  the updated crc. The crc should be initialized to zero. Pre- and
-  post-conditioning (one's complement) is performed within this
-  function so it shouldn't be done by the caller. Usage example:
-
-  unsigned long crc = 0L;
-
-  while (read_buffer(buffer, length) != EOF) {
-      crc = update_crc(crc, buffer, length);
-  }
-  if (crc != original_crc) error();
-*/
+ * Update a running Adler-32 checksum, start with 1. Same semantics as
+ * adler32() in zlib. NMAX is the largest n such that
+ * 255n(n+1)/2 + (n+1)(BASE-1) fits into 32 bits, so the modulo needs
+ * to be done only once per NMAX bytes.
+ */
+#define ADLER32_BASE	65521
+#define ADLER32_NMAX	5552
 
-/* Return the CRC of the bytes buf[0..len-1]. */
-static unsigned long do_crc(unsigned long crc, unsigned char *buf, int len)
+static uint32_t do_adler32(uint32_t adler, const unsigned char *buf,
+			   size_t len)
 {
-	unsigned long c = crc ^ 0xffffffffL;
-	int n;
-
-#if defined(CONFIG_BUILD_CRC_TABLE)
-	if (!crc_table_computed) {
-		make_crc_table();
-		dump_crc_table();
-	}
-#endif
-
-	for (n = 0; n < len; n++) {
-		c = crc_table[(c ^ buf[n]) & 0xff] ^ (c >> 8);
+	uint32_t a = adler & 0xffff;
+	uint32_t b = (adler >> 16) & 0xffff;
+	size_t n;
+
+	while (len > 0) {
+		n = MIN(len, (size_t)ADLER32_NMAX);
+		len -= n;
+		while (n--) {
+			a += *buf++;
+			b += a;
+		}
+		a %= ADLER32_BASE;
+		b %= ADLER32_BASE;
 	}
-	return c ^ 0xffffffffL;
+	return (b << 16) | a;
 }
 
 
@@ -544,50 +454,54 @@ static uint64_t sha3_main(uint32_t test_choice, uint32_t nb_elmts, uint32_t freq
 
 #else
 
-#include <pthread.h>
-
-struct thread_data {
-        pthread_t thread_id;    /* Thread id assigned by pthread_create() */
-        unsigned int run_number;
+/*
+ * The test runs are spread over the worker pool. Every worker xors
+ * the checksums of its runs into its own slot, the slots are merged
+ * at the end; xor does not care about the order.
+ */
+struct sha3_run {
         uint32_t test_choice;
         uint32_t nb_elmts;
         uint32_t freq;
-        uint64_t checksum;
-        int thread_rc;
+        struct {
+                uint64_t checksum;
+        } __attribute__((aligned(64))) worker[];
 };
 
-static struct thread_data *d;
-
-static void *sha3_thread(void *data)
+static void sha3_run_one(void *arg, unsigned int run_number,
+                         unsigned int worker)
 {
-        struct thread_data *d = (struct thread_data *)data;
+        struct sha3_run *r = (struct sha3_run *)arg;
+        uint64_t checksum;
+
+        if (r->nb_elmts <= (run_number % r->freq))
+                return;
 
-        d->checksum = 0;
-        d->thread_rc = 0;
-        switch(d->test_choice) {
+        switch(r->test_choice) {
         case(CHECKSUM_SPEED):
-                d->checksum = test_speed(d->run_number, d->nb_elmts, d->freq);
+                checksum = test_speed(run_number, r->nb_elmts, r->freq);
                 break;
         case(CHECKSUM_SHA3):
-                d->checksum = (uint64_t)test_sha3();
+                checksum = (uint64_t)test_sha3();
                 break;
         case(CHECKSUM_SHAKE):
-                d->checksum = (uint64_t)test_shake();
+                checksum = (uint64_t)test_shake();
                 break;
         case(CHECKSUM_SHA3_SHAKE):
-                d->checksum = (uint64_t)test_sha3();
-                d->checksum += (uint64_t)test_shake();
+                checksum = (uint64_t)test_sha3();
+                checksum += (uint64_t)test_shake();
                 break;
         default:
-                d->checksum = 1;
+                checksum = 1;
                 break;
         }
-        pthread_exit(&d->thread_rc);
+        r->worker[worker].checksum ^= checksum;
 }
+
 static uint64_t sha3_main(uint32_t test_choice, uint32_t nb_elmts, uint32_t freq, uint32_t _threads)
 {
-       int rc;
-        uint32_t run_number;
+        unsigned int i, workers = worker_pool_size();
+        struct sha3_run *r;
         uint64_t checksum = 0;
 
         if (_threads == 0) {
@@ -595,64 +509,350 @@ static uint64_t sha3_main(uint32_t test_choice, uint32_t nb_elmts, uint32_t freq
                 return 0;
         }
 
-        d = calloc(_threads * sizeof(struct thread_data), 1);
-        if (d == NULL) {
+        r = aligned_alloc(64, sizeof(*r) + workers * sizeof(r->worker[0]));
+        if (r == NULL) {
                 fprintf(stderr, "err: No memory available\n");
                 return 0;
         }
+        memset(r, 0, sizeof(*r) + workers * sizeof(r->worker[0]));
+        r->test_choice = test_choice;
+        r->nb_elmts = nb_elmts;
+        r->freq = freq;
 
-        act_trace("%s(%d, %d, %d)\n", __func__, nb_elmts, freq, _threads);
+        act_trace("%s(%d, %d, %d) workers=%d\n", __func__, nb_elmts, freq,
+                  _threads, workers);
         act_trace("  NB_TEST_RUNS=%d NB_ROUNDS=%d\n", NB_TEST_RUNS, NB_ROUNDS);
-        for (run_number = 0; run_number < NB_TEST_RUNS; ) {
-                unsigned int i;
-                unsigned int remaining_run_number = NB_TEST_RUNS - run_number;
-                unsigned int threads = MIN(remaining_run_number, _threads);
-
-                act_trace("  [X] run_number=%d remaining=%d threads=%d\n",
-                          run_number, remaining_run_number, threads);
-
-                for (i = 0; i < threads; i++) {
-                        if (nb_elmts <= ((run_number + i) % freq)) 
-                                continue;
-
-                        d[i].run_number = run_number + i;
-                        d[i].test_choice = test_choice;
-                        d[i].nb_elmts = nb_elmts;
-                        d[i].freq = freq;
-                        rc = pthread_create(&d[i].thread_id, NULL,
-                                            &sha3_thread, &d[i]);
-                        if (rc != 0) {
-                                free(d);
-                                fprintf(stderr, "starting %d failed!\n", i);
-                                return EXIT_FAILURE;
-                        }
-                }
-                for (i = 0; i < threads; i++) {
-                        act_trace("      run_number=%d checksum=%016llx\n",
-                                  run_number + i, (long long)d[i].checksum);
-
-                        if (nb_elmts <= ((run_number + i) % freq))
-                                continue;
-
-                        rc = pthread_join(d[i].thread_id, NULL);
-                        if (rc != 0) {
-                                free(d);
-                                fprintf(stderr, "joining threads failed!\n");
-                                return EXIT_FAILURE;
-                        }
-                        checksum ^= d[i].checksum;
-                }
-                run_number += threads;
+        if (worker_pool_run(sha3_run_one, r, NB_TEST_RUNS, _threads) != 0) {
+                free(r);
+                return EXIT_FAILURE;
         }
 
-        free(d);
+        for (i = 0; i < workers; i++)
+                checksum ^= r->worker[i].checksum;
+        free(r);
 
         act_trace("checksum=%016llx\n", (unsigned long long)checksum);
         return checksum;
-
 }
 #endif /* CONFIG_USE_NO_PTHREADS */
 
+/*
+ * Batch mode, the messages are hashed SHA3_X4_WAYS at a time by the
+ * multi-buffer Keccak. Every digest slot is written completely, like
+ * the hardware does.
+ */
+struct hash_batch {
+	const struct snap_addr *desc;
+	unsigned int n;
+	uint8_t *out;
+	int mdlen;
+	unsigned int outlen;
+	int shake;
+};
+
+/* One group of SHA3_X4_WAYS messages, run by the worker pool */
+static void hash_batch_group(void *arg, unsigned int group,
+			     unsigned int worker __attribute__((unused)))
+{
+	struct hash_batch *b = (struct hash_batch *)arg;
+	const uint8_t *in[SHA3_X4_WAYS];
+	size_t inlen[SHA3_X4_WAYS];
+	uint8_t *md[SHA3_X4_WAYS];
+	unsigned int i = group * SHA3_X4_WAYS;
+	int w;
+
+	for (w = 0; w < SHA3_X4_WAYS; w++) {
+		md[w] = NULL;
+		if (i + w >= b->n)
+			continue;
+		in[w] = checksum_mem(&b->desc[i + w]);
+		inlen[w] = b->desc[i + w].size;
+		md[w] = b->out + (i + w) * CHECKSUM_HASH_SLOT_SIZE;
+		memset(md[w], 0, CHECKSUM_HASH_SLOT_SIZE);
+	}
+	sha3_x4(in, inlen, md, b->mdlen, b->outlen, b->shake);
+}
+
+static int action_hash_batch(struct checksum_job *js, int mdlen, int shake)
+{
+	const struct snap_addr *desc =
+		(const struct snap_addr *)checksum_mem(&js->in);
+	uint8_t *out = checksum_mem(&js->out);
+	unsigned int n = js->in.size / sizeof(*desc);
+	unsigned int outlen = shake ? js->out.size : (unsigned int)mdlen;
+	struct hash_batch b;
+	unsigned int i;
+
+	if (desc == NULL || ((unsigned long)desc & 63) ||
+	    out == NULL || ((unsigned long)out & 63) ||
+	    outlen > CHECKSUM_HASH_SLOT_SIZE)
+		return -1;
+
+	for (i = 0; i < n; i++)
+		if (desc[i].type != SNAP_ADDRTYPE_HOST_DRAM &&
+		    checksum_mem(&desc[i]) == NULL)
+			return -1;
+
+	b.desc = desc;
+	b.n = n;
+	b.out = out;
+	b.mdlen = mdlen;
+	b.outlen = outlen;
+	b.shake = shake;
+	if (worker_pool_run(hash_batch_group, &b,
+			    (n + SHA3_X4_WAYS - 1) / SHA3_X4_WAYS, 0) != 0)
+		return -1;
+
+	js->chk_out = n;
+	return 0;
+}
+
+/* XXH3 batch: one 64 bit hash per message, packed into out */
+struct xxh3_batch {
+	const struct snap_addr *desc;
+	uint64_t *out;
+	uint64_t seed;
+};
+
+static void xxh3_batch_one(void *arg, unsigned int i,
+			   unsigned int worker __attribute__((unused)))
+{
+	struct xxh3_batch *b = (struct xxh3_batch *)arg;
+	uint64_t h;
+
+	h = xxh3_64(checksum_mem(&b->desc[i]), b->desc[i].size, b->seed);
+	cast_uint64_to_uint8(&h, (uint8_t *)&b->out[i], 1);
+}
+
+/*
+ * Merkle tree: the leaves are hashed on the worker pool like a batch,
+ * SHA3 ones in groups of SHA3_X4_WAYS, then the much smaller upper
+ * levels are reduced by merkle_reduce().
+ */
+static int action_hash_tree(struct checksum_job *js)
+{
+	const uint8_t *in = checksum_mem(&js->in);
+	uint8_t *out = checksum_mem(&js->out);
+	unsigned int mdlen = merkle_digest_size(js->chk_type);
+	unsigned int stride = (js->chk_type == CHECKSUM_XXH3) ?
+		sizeof(uint64_t) : CHECKSUM_HASH_SLOT_SIZE;
+	size_t leaf_size = js->leaf_size;
+	size_t n, i, leaf_bytes = 0;
+	struct snap_addr *desc = NULL;
+	uint8_t *md = NULL;
+	int rc = -1;
+
+	if (mdlen == 0 || leaf_size == 0 || (leaf_size % 64) != 0 ||
+	    in == NULL || out == NULL || ((unsigned long)out & 63))
+		return -1;
+
+	n = merkle_leaves(js->in.size, leaf_size);
+	if (js->hash_flags & CHECKSUM_HASH_LEAVES)
+		leaf_bytes = (n * stride + 63) & ~63ul;
+	if (js->out.size < 64 + leaf_bytes)
+		return -1;
+
+	desc = memalign(64, n * sizeof(*desc));
+	md = memalign(64, n * stride + 64);
+	if (desc == NULL || md == NULL)
+		goto out;
+
+	for (i = 0; i < n; i++) {
+		desc[i].addr = (unsigned long)in + i * leaf_size;
+		desc[i].size = (i == n - 1) ? js->in.size - i * leaf_size :
+			leaf_size;
+		desc[i].type = SNAP_ADDRTYPE_HOST_DRAM;
+		desc[i].flags = SNAP_ADDRFLAG_ADDR;
+	}
+
+	if (js->chk_type == CHECKSUM_XXH3) {
+		struct xxh3_batch b = { desc, (uint64_t *)md, js->chk_in };
+
+		memset(md + (n & ~7ul) * stride, 0, 64);
+		if (worker_pool_run(xxh3_batch_one, &b, n, 0) != 0)
+			goto out;
+	} else {
+		struct hash_batch b = { desc, n, md, mdlen, mdlen, 0 };
+
+		if (worker_pool_run(hash_batch_group, &b,
+				    (n + SHA3_X4_WAYS - 1) / SHA3_X4_WAYS,
+				    0) != 0)
+			goto out;
+	}
+
+	if (leaf_bytes)
+		memcpy(out + 64, md, leaf_bytes);
+
+	merkle_reduce(js->chk_type, js->chk_in, md, n, stride);
+	memset(out, 0, 64);
+	memcpy(out, md, mdlen);
+	cast_uint8_to_uint64(out, &js->chk_out, 1);
+	rc = 0;
+ out:
+	free(desc);
+	free(md);
+	return rc;
+}
+
+/*
+ * SHA3/SHAKE with the same rules as the hardware: the state is kept in
+ * memory between jobs, only the last job may hash a partial block and
+ * chk_out is the first lane of the state after the final permutation.
+ * Returns 0 on success.
+ */
+static int action_hash(struct checksum_job *js)
+{
+	sha3_ctx_t ctx;
+	int mdlen, shake = 0;
+	unsigned int rate;
+	uint8_t *in, *out, *state;
+	int init = js->hash_flags & CHECKSUM_HASH_INIT;
+	int final = js->hash_flags & CHECKSUM_HASH_FINAL;
+
+	switch (js->chk_type) {
+	case CHECKSUM_SHA3_224: mdlen = 28; break;
+	case CHECKSUM_SHA3_256: mdlen = 32; break;
+	case CHECKSUM_SHA3_384: mdlen = 48; break;
+	case CHECKSUM_SHA3_512: mdlen = 64; break;
+	case CHECKSUM_SHAKE128: mdlen = 16; shake = 1; break;
+	case CHECKSUM_SHAKE256: mdlen = 32; shake = 1; break;
+	default:
+		return -1;
+	}
+	rate = 200 - 2 * mdlen;
+
+	if (js->hash_flags & CHECKSUM_HASH_TREE)
+		return shake ? -1 : action_hash_tree(js);
+	if (js->hash_flags & CHECKSUM_HASH_BATCH)
+		return action_hash_batch(js, mdlen, shake);
+
+	in = checksum_mem(&js->in);
+	out = checksum_mem(&js->out);
+	state = checksum_mem(&js->state);
+	if (in == NULL && (js->in.type != SNAP_ADDRTYPE_HOST_DRAM ||
+			   js->in.size != 0))
+		return -1;
+	if (final && (out == NULL || ((unsigned long)out & 63)))
+		return -1;
+	if ((!init || !final) &&
+	    (state == NULL || ((unsigned long)state & 63)))
+		return -1;
+	if (!final && (js->in.size % rate) != 0)
+		return -1;
+
+	sha3_init(&ctx, mdlen);
+	if (!init)
+		memcpy(ctx.st.b, state, sizeof(ctx.st.b));
+
+	sha3_update(&ctx, in, js->in.size);
+
+	if (!final) {
+		memcpy(state, ctx.st.b, sizeof(ctx.st.b));
+		js->chk_out = 0;
+		return 0;
+	}
+
+	if (shake) {
+		shake_xof(&ctx);
+		cast_uint8_to_uint64(ctx.st.b, &js->chk_out, 1);
+		shake_out(&ctx, out, js->out.size);
+	} else {
+		sha3_final(out, &ctx);
+		cast_uint8_to_uint64(ctx.st.b, &js->chk_out, 1);
+	}
+	return 0;
+}
+
+static int action_xxh3(struct checksum_job *js)
+{
+	const struct snap_addr *desc =
+		(const struct snap_addr *)checksum_mem(&js->in);
+	uint8_t *out;
+	unsigned int n = js->in.size / sizeof(*desc);
+	struct xxh3_batch b;
+	unsigned int i;
+
+	if (js->hash_flags & CHECKSUM_HASH_TREE)
+		return action_hash_tree(js);
+
+	if (desc == NULL)
+		return -1;
+
+	if (!(js->hash_flags & CHECKSUM_HASH_BATCH)) {
+		js->chk_out = xxh3_64(desc, js->in.size, js->chk_in);
+		return 0;
+	}
+
+	out = checksum_mem(&js->out);
+	if (((unsigned long)desc & 63) || out == NULL ||
+	    ((unsigned long)out & 63) || js->out.size < n * sizeof(uint64_t))
+		return -1;
+
+	for (i = 0; i < n; i++)
+		if (desc[i].type != SNAP_ADDRTYPE_HOST_DRAM &&
+		    checksum_mem(&desc[i]) == NULL)
+			return -1;
+
+	/* Like the hardware, pad the last 64 byte line with zeros */
+	if (n & 7)
+		memset(out + (n & ~7u) * sizeof(uint64_t), 0, 64);
+
+	b.desc = desc;
+	b.out = (uint64_t *)out;
+	b.seed = js->chk_in;
+	if (worker_pool_run(xxh3_batch_one, &b, n, 0) != 0)
+		return -1;
+
+	js->chk_out = n;
+	return 0;
+}
+
+/*
+ * CRC32, CRC32C and Adler-32 of an NVMe source, read in the chunks the
+ * hardware streams through one half of its staging area. The other
+ * modes do not take NVMe input.
+ */
+static int checksum_nvme(struct checksum_job *js)
+{
+	int drive = (js->in.flags & SNAP_ADDRFLAG_DRIVE1) ? 1 : 0;
+	uint64_t offs = js->in.addr;
+	uint32_t left = js->in.size;
+	uint32_t sum = js->chk_in;
+	uint8_t *buf;
+	size_t n;
+	int rc = 0;
+
+	if (offs % SNAP_NVME_BLOCK_SIZE)
+		return -1;
+	if (js->chk_type != CHECKSUM_CRC32 &&
+	    js->chk_type != CHECKSUM_CRC32C &&
+	    js->chk_type != CHECKSUM_ADLER32)
+		return -1;
+
+	buf = malloc(SNAP_NVME_STAGING_SIZE / 2);
+	if (buf == NULL)
+		return -1;
+
+	while (left) {
+		n = MIN(left, (uint32_t)SNAP_NVME_STAGING_SIZE / 2);
+		rc = snap_nvme_emu_read(drive, offs, buf, n);
+		if (rc != 0)
+			break;
+
+		if (js->chk_type == CHECKSUM_CRC32)
+			sum = crc32_ieee(sum, buf, n);
+		else if (js->chk_type == CHECKSUM_CRC32C)
+			sum = crc32c(sum, buf, n);
+		else
+			sum = do_adler32(sum, buf, n);
+		offs += n;
+		left -= n;
+	}
+	free(buf);
+	js->chk_out = sum;
+	return rc;
+}
+
 static int action_main(struct snap_sim_action *action, void *job,
 		       unsigned int job_len)
 {
@@ -662,6 +862,13 @@ static int action_main(struct snap_sim_action *action, void *job,
 	act_trace("%s(%p, %p, %d) [%d]\n", __func__, action, job, job_len,
 		  (int)js->chk_type);
 
+	if (js->in.type == SNAP_ADDRTYPE_NVME) {
+		if (checksum_nvme(js) != 0)
+			return 0;
+		action->job.retc = SNAP_RETC_SUCCESS;
+		return 0;
+	}
+
 	switch (js->chk_type) {
 	case CHECKSUM_SPONGE: {
 		unsigned int threads;
@@ -686,16 +893,43 @@ static int action_main(struct snap_sim_action *action, void *job,
 	}
 	case CHECKSUM_CRC32:
 		/* checking parameters ... */
-		if (js->in.type != SNAP_ADDRTYPE_HOST_DRAM)
+		src = checksum_mem(&js->in);
+		if (src == NULL)
 			return 0;
 
-		src = (void *)js->in.addr;
+		/* calculate the results ... */
+		js->chk_out = crc32_ieee(js->chk_in, src, js->in.size);
+		break;
+
+	case CHECKSUM_CRC32C:
+		src = checksum_mem(&js->in);
 		if (src == NULL)
 			return 0;
 
-		/* calculate the results ... */
-		js->chk_out = do_crc(js->chk_in, src, js->in.size);
-		js->chk_out &= 0xffffffff; /* 32-bit only */
+		js->chk_out = crc32c(js->chk_in, src, js->in.size);
+		break;
+
+	case CHECKSUM_ADLER32:
+		src = checksum_mem(&js->in);
+		if (src == NULL)
+			return 0;
+
+		js->chk_out = do_adler32(js->chk_in, src, js->in.size);
+		break;
+
+	case CHECKSUM_SHA3_224:
+	case CHECKSUM_SHA3_256:
+	case CHECKSUM_SHA3_384:
+	case CHECKSUM_SHA3_512:
+	case CHECKSUM_SHAKE128:
+	case CHECKSUM_SHAKE256:
+		if (action_hash(js) != 0)
+			return 0;
+		break;
+
+	case CHECKSUM_XXH3:
+		if (action_xxh3(js) != 0)
+			return 0;
 		break;
 
 	default:
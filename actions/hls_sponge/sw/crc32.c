@@ -0,0 +1,413 @@
+/*
+ * Copyright 2017 International Business Machines
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Software CRC32/CRC32C.
+ *
+ * Byte-at-a-time: the classic table loop, kept as reference.
+ *
+ * Slicing-by-8: eight tables, table[k][n] is the CRC of byte n followed
+ * by k zero bytes. Consumes 8 bytes per step with 8 independent
+ * lookups instead of a chain of 8 dependent ones.
+ *
+ * Carry-less multiply: the buffer is folded 64 bytes at a time into
+ * four 128-bit accumulators. Folding a 128-bit block X = L:H (L are the
+ * first 8 bytes) D bits forward means replacing it by
+ *
+ *   L * (x^(64+D) mod P) + H * (x^D mod P)
+ *
+ * which is two 64x64 carry-less multiplies and a xor, done by
+ * PCLMULQDQ or VPMSUMD. The constants are computed at init time in the
+ * bit-reflected domain for both polynomials. After folding, the last
+ * 128-bit remainder is run through the table code, which is cheaper to
+ * get right than a Barrett reduction and costs only 16 bytes.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "crc32.h"
+
+#define CRC32_POLY	0xedb88320	/* IEEE 802.3, reflected */
+#define CRC32C_POLY	0x82f63b78	/* Castagnoli, reflected */
+
+struct crc32_poly {
+	uint32_t poly;
+	uint32_t table[8][256];
+	uint64_t k_512[2];	/* fold 4 x 128 bit forward */
+	uint64_t k_128[2];	/* fold 128 bit forward */
+};
+
+typedef uint32_t (*crc32_fn_t)(const struct crc32_poly *p, uint32_t c,
+			       const uint8_t *buf, size_t len);
+
+static struct crc32_poly crc32_ieee_poly = { .poly = CRC32_POLY, };
+static struct crc32_poly crc32c_poly = { .poly = CRC32C_POLY, };
+
+static crc32_fn_t crc32_fns[CRC32_IMPL_MAX];
+static crc32_impl_t crc32_impl = CRC32_IMPL_BYTE;
+
+static const char *crc32_impl_strs[] = { "BYTE", "SLICE8", "CLMUL" };
+
+/* x^n mod P, bit-reflected: bit (31 - d) holds the coefficient of x^d */
+static uint32_t crc32_xpow(uint32_t poly, unsigned int n)
+{
+	uint32_t r = 0x80000000;
+
+	while (n--)
+		r = (r & 1) ? (r >> 1) ^ poly : r >> 1;
+	return r;
+}
+
+static void crc32_poly_init(struct crc32_poly *p)
+{
+	uint32_t c;
+	int n, k;
+
+	for (n = 0; n < 256; n++) {
+		c = (uint32_t)n;
+		for (k = 0; k < 8; k++)
+			c = (c & 1) ? p->poly ^ (c >> 1) : c >> 1;
+		p->table[0][n] = c;
+	}
+	for (n = 0; n < 256; n++) {
+		c = p->table[0][n];
+		for (k = 1; k < 8; k++) {
+			c = p->table[0][c & 0xff] ^ (c >> 8);
+			p->table[k][n] = c;
+		}
+	}
+
+	/*
+	 * Multiplier for a 64-bit lane, see header. Shifting the reflected
+	 * remainder into the upper half of the 64-bit operand lines up the
+	 * product with the 128-bit block it is xored into.
+	 */
+	p->k_512[0] = (uint64_t)crc32_xpow(p->poly, 512 + 63) << 32;
+	p->k_512[1] = (uint64_t)crc32_xpow(p->poly, 512 - 1) << 32;
+	p->k_128[0] = (uint64_t)crc32_xpow(p->poly, 128 + 63) << 32;
+	p->k_128[1] = (uint64_t)crc32_xpow(p->poly, 128 - 1) << 32;
+}
+
+static uint32_t crc32_byte(const struct crc32_poly *p, uint32_t c,
+			   const uint8_t *buf, size_t len)
+{
+	while (len--)
+		c = p->table[0][(c ^ *buf++) & 0xff] ^ (c >> 8);
+	return c;
+}
+
+static inline uint32_t crc32_le32(const uint8_t *b)
+{
+	return (uint32_t)b[0] | (uint32_t)b[1] << 8 |
+		(uint32_t)b[2] << 16 | (uint32_t)b[3] << 24;
+}
+
+static uint32_t crc32_slice8(const struct crc32_poly *p, uint32_t c,
+			     const uint8_t *buf, size_t len)
+{
+	uint32_t one, two;
+
+	while (len >= 8) {
+		one = crc32_le32(buf) ^ c;
+		two = crc32_le32(buf + 4);
+		c = p->table[7][one & 0xff] ^
+			p->table[6][(one >> 8) & 0xff] ^
+			p->table[5][(one >> 16) & 0xff] ^
+			p->table[4][one >> 24] ^
+			p->table[3][two & 0xff] ^
+			p->table[2][(two >> 8) & 0xff] ^
+			p->table[1][(two >> 16) & 0xff] ^
+			p->table[0][two >> 24];
+		buf += 8;
+		len -= 8;
+	}
+	return crc32_byte(p, c, buf, len);
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+
+#define CRC32_CLMUL_TARGET __attribute__((target("pclmul,sse2")))
+
+CRC32_CLMUL_TARGET
+static inline __m128i crc32_fold(__m128i x, __m128i k)
+{
+	return _mm_xor_si128(_mm_clmulepi64_si128(x, k, 0x00),
+			     _mm_clmulepi64_si128(x, k, 0x11));
+}
+
+CRC32_CLMUL_TARGET
+static uint32_t crc32_clmul(const struct crc32_poly *p, uint32_t c,
+			    const uint8_t *buf, size_t len)
+{
+	__m128i x0, x1, x2, x3, k;
+	uint8_t rem[16];
+
+	if (len < 64)
+		return crc32_slice8(p, c, buf, len);
+
+	x0 = _mm_loadu_si128((const __m128i *)(buf + 0));
+	x1 = _mm_loadu_si128((const __m128i *)(buf + 16));
+	x2 = _mm_loadu_si128((const __m128i *)(buf + 32));
+	x3 = _mm_loadu_si128((const __m128i *)(buf + 48));
+	x0 = _mm_xor_si128(x0, _mm_cvtsi32_si128((int)c));
+	buf += 64;
+	len -= 64;
+
+	k = _mm_set_epi64x((long long)p->k_512[1], (long long)p->k_512[0]);
+	while (len >= 64) {
+		x0 = _mm_xor_si128(crc32_fold(x0, k),
+			_mm_loadu_si128((const __m128i *)(buf + 0)));
+		x1 = _mm_xor_si128(crc32_fold(x1, k),
+			_mm_loadu_si128((const __m128i *)(buf + 16)));
+		x2 = _mm_xor_si128(crc32_fold(x2, k),
+			_mm_loadu_si128((const __m128i *)(buf + 32)));
+		x3 = _mm_xor_si128(crc32_fold(x3, k),
+			_mm_loadu_si128((const __m128i *)(buf + 48)));
+		buf += 64;
+		len -= 64;
+	}
+
+	k = _mm_set_epi64x((long long)p->k_128[1], (long long)p->k_128[0]);
+	x1 = _mm_xor_si128(crc32_fold(x0, k), x1);
+	x2 = _mm_xor_si128(crc32_fold(x1, k), x2);
+	x3 = _mm_xor_si128(crc32_fold(x2, k), x3);
+	while (len >= 16) {
+		x3 = _mm_xor_si128(crc32_fold(x3, k),
+			_mm_loadu_si128((const __m128i *)buf));
+		buf += 16;
+		len -= 16;
+	}
+
+	_mm_storeu_si128((__m128i *)rem, x3);
+	c = crc32_slice8(p, 0, rem, sizeof(rem));
+	return crc32_slice8(p, c, buf, len);
+}
+
+static int crc32_clmul_supported(void)
+{
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("pclmul") &&
+		__builtin_cpu_supports("sse2");
+}
+
+#elif defined(__powerpc64__) && defined(__LITTLE_ENDIAN__) && \
+	defined(__CRYPTO__)
+#include <altivec.h>
+
+/*
+ * Same algorithm as above. VPMSUMD does both 64x64 multiplies and the
+ * xor in one instruction. Element 0 of a little-endian vector load is
+ * the first 8 bytes, like the low quadword on x86. Only built when the
+ * compiler targets POWER8 or later, so no runtime check is needed.
+ */
+typedef __vector unsigned long long crc32_vec_t;
+
+static inline crc32_vec_t crc32_fold(crc32_vec_t x, crc32_vec_t k)
+{
+	return __builtin_crypto_vpmsumd(x, k);
+}
+
+static inline crc32_vec_t crc32_load(const uint8_t *buf)
+{
+	return vec_xl(0, (const unsigned long long *)buf);
+}
+
+static uint32_t crc32_clmul(const struct crc32_poly *p, uint32_t c,
+			    const uint8_t *buf, size_t len)
+{
+	crc32_vec_t x0, x1, x2, x3, k;
+	crc32_vec_t init = { c, 0 };
+	uint8_t rem[16];
+
+	if (len < 64)
+		return crc32_slice8(p, c, buf, len);
+
+	x0 = crc32_load(buf + 0) ^ init;
+	x1 = crc32_load(buf + 16);
+	x2 = crc32_load(buf + 32);
+	x3 = crc32_load(buf + 48);
+	buf += 64;
+	len -= 64;
+
+	k = (crc32_vec_t){ p->k_512[0], p->k_512[1] };
+	while (len >= 64) {
+		x0 = crc32_fold(x0, k) ^ crc32_load(buf + 0);
+		x1 = crc32_fold(x1, k) ^ crc32_load(buf + 16);
+		x2 = crc32_fold(x2, k) ^ crc32_load(buf + 32);
+		x3 = crc32_fold(x3, k) ^ crc32_load(buf + 48);
+		buf += 64;
+		len -= 64;
+	}
+
+	k = (crc32_vec_t){ p->k_128[0], p->k_128[1] };
+	x1 = crc32_fold(x0, k) ^ x1;
+	x2 = crc32_fold(x1, k) ^ x2;
+	x3 = crc32_fold(x2, k) ^ x3;
+	while (len >= 16) {
+		x3 = crc32_fold(x3, k) ^ crc32_load(buf);
+		buf += 16;
+		len -= 16;
+	}
+
+	vec_xst(x3, 0, (unsigned long long *)rem);
+	c = crc32_slice8(p, 0, rem, sizeof(rem));
+	return crc32_slice8(p, c, buf, len);
+}
+
+static int crc32_clmul_supported(void)
+{
+	return 1;
+}
+
+#else
+#define crc32_clmul NULL
+
+static int crc32_clmul_supported(void)
+{
+	return 0;
+}
+#endif
+
+static void crc32_init(void) __attribute__((constructor));
+
+static void crc32_init(void)
+{
+	crc32_poly_init(&crc32_ieee_poly);
+	crc32_poly_init(&crc32c_poly);
+
+	crc32_fns[CRC32_IMPL_BYTE] = crc32_byte;
+	crc32_fns[CRC32_IMPL_SLICE8] = crc32_slice8;
+	crc32_impl = CRC32_IMPL_SLICE8;
+
+	if (crc32_clmul_supported()) {
+		crc32_fns[CRC32_IMPL_CLMUL] = crc32_clmul;
+		crc32_impl = CRC32_IMPL_CLMUL;
+	}
+}
+
+uint32_t crc32_ieee(uint32_t crc, const void *buf, size_t len)
+{
+	return ~crc32_fns[crc32_impl](&crc32_ieee_poly, ~crc, buf, len);
+}
+
+uint32_t crc32c(uint32_t crc, const void *buf, size_t len)
+{
+	return ~crc32_fns[crc32_impl](&crc32c_poly, ~crc, buf, len);
+}
+
+/*
+ * CRC of A followed by B from crc(A), crc(B) and the length of B. Both
+ * CRCs are linear in their input, so appending len2 zero bytes to A is
+ * a 32 x 32 matrix over GF(2) applied to crc(A). The matrix for one
+ * zero bit is squared up to the bits set in len2, like in zlib.
+ */
+static uint32_t gf2_matrix_times(const uint32_t *mat, uint32_t vec)
+{
+	uint32_t sum = 0;
+
+	while (vec) {
+		if (vec & 1)
+			sum ^= *mat;
+		vec >>= 1;
+		mat++;
+	}
+	return sum;
+}
+
+static void gf2_matrix_square(uint32_t *square, const uint32_t *mat)
+{
+	int n;
+
+	for (n = 0; n < 32; n++)
+		square[n] = gf2_matrix_times(mat, mat[n]);
+}
+
+static uint32_t crc32_combine_poly(uint32_t poly, uint32_t crc1,
+				   uint32_t crc2, uint64_t len2)
+{
+	uint32_t even[32];	/* even power of two zeros operator */
+	uint32_t odd[32];	/* odd power of two zeros operator */
+	uint32_t row = 1;
+	int n;
+
+	if (len2 == 0)
+		return crc1;
+
+	odd[0] = poly;		/* operator for one zero bit */
+	for (n = 1; n < 32; n++) {
+		odd[n] = row;
+		row <<= 1;
+	}
+	gf2_matrix_square(even, odd);	/* two zero bits */
+	gf2_matrix_square(odd, even);	/* four zero bits */
+
+	/* first square gives one zero byte, then 2, 4, ... */
+	do {
+		gf2_matrix_square(even, odd);
+		if (len2 & 1)
+			crc1 = gf2_matrix_times(even, crc1);
+		len2 >>= 1;
+		if (len2 == 0)
+			break;
+
+		gf2_matrix_square(odd, even);
+		if (len2 & 1)
+			crc1 = gf2_matrix_times(odd, crc1);
+		len2 >>= 1;
+	} while (len2 != 0);
+
+	return crc1 ^ crc2;
+}
+
+uint32_t crc32_ieee_combine(uint32_t crc1, uint32_t crc2, uint64_t len2)
+{
+	return crc32_combine_poly(CRC32_POLY, crc1, crc2, len2);
+}
+
+uint32_t crc32c_combine(uint32_t crc1, uint32_t crc2, uint64_t len2)
+{
+	return crc32_combine_poly(CRC32C_POLY, crc1, crc2, len2);
+}
+
+int crc32_impl_available(crc32_impl_t impl)
+{
+	if (impl >= CRC32_IMPL_MAX)
+		return 0;
+	return crc32_fns[impl] != NULL;
+}
+
+int crc32_set_impl(crc32_impl_t impl)
+{
+	if (!crc32_impl_available(impl))
+		return -1;
+	crc32_impl = impl;
+	return 0;
+}
+
+crc32_impl_t crc32_get_impl(void)
+{
+	return crc32_impl;
+}
+
+const char *crc32_impl_str(crc32_impl_t impl)
+{
+	if (impl >= CRC32_IMPL_MAX)
+		return "UNKNOWN";
+	return crc32_impl_strs[impl];
+}
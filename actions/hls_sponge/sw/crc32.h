@@ -0,0 +1,68 @@
+#ifndef __CRC32_H__
+#define __CRC32_H__
+
+/*
+ * Copyright 2017 International Business Machines
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Software CRC32 (IEEE 802.3, as in zlib) and CRC32C (Castagnoli).
+ *
+ * Used by the software version of the checksum action and by the
+ * host tools to verify what the card computed. The implementation is
+ * picked once at startup: carry-less multiply folding if the CPU has
+ * it (PCLMULQDQ on x86, VPMSUMD on POWER8), slicing-by-8 otherwise.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum crc32_impl {
+	CRC32_IMPL_BYTE = 0x0,		/* one table lookup per byte */
+	CRC32_IMPL_SLICE8 = 0x1,	/* eight tables, 8 bytes per step */
+	CRC32_IMPL_CLMUL = 0x2,		/* PCLMULQDQ / VPMSUMD folding */
+	CRC32_IMPL_MAX = 0x3,
+} crc32_impl_t;
+
+/*
+ * Update a running CRC with buf[0..len-1]. Start with 0, pre- and
+ * post-conditioning is done inside, same semantics as crc32() in zlib.
+ */
+uint32_t crc32_ieee(uint32_t crc, const void *buf, size_t len);
+uint32_t crc32c(uint32_t crc, const void *buf, size_t len);
+
+/*
+ * CRC of two pieces A and B back to back, given crc1 of A, crc2 of B
+ * (both started with 0) and the length of B. Used to merge the results
+ * of chunks which were checksummed in parallel.
+ */
+uint32_t crc32_ieee_combine(uint32_t crc1, uint32_t crc2, uint64_t len2);
+uint32_t crc32c_combine(uint32_t crc1, uint32_t crc2, uint64_t len2);
+
+/* Runtime selection, mainly for testing and benchmarking */
+int crc32_impl_available(crc32_impl_t impl);
+int crc32_set_impl(crc32_impl_t impl);	/* 0 or -1 if not available */
+crc32_impl_t crc32_get_impl(void);
+const char *crc32_impl_str(crc32_impl_t impl);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif	/* __CRC32_H__ */
@@ -0,0 +1,82 @@
+/*
+ * Copyright 2017 International Business Machines
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+
+#include <action_checksum.h>
+#include "merkle.h"
+#include "sha3.h"
+#include "xxh3.h"
+
+unsigned int merkle_digest_size(int mode)
+{
+	switch (mode) {
+	case CHECKSUM_SHA3_224: return 28;
+	case CHECKSUM_SHA3_256: return 32;
+	case CHECKSUM_SHA3_384: return 48;
+	case CHECKSUM_SHA3_512: return 64;
+	case CHECKSUM_XXH3:	return 8;
+	}
+	return 0;
+}
+
+size_t merkle_leaves(size_t size, size_t leaf_size)
+{
+	if (size == 0)
+		return 1;
+	return (size + leaf_size - 1) / leaf_size;
+}
+
+void merkle_leaf(int mode, uint64_t seed, const uint8_t *buf, size_t len,
+		 uint8_t *md)
+{
+	uint64_t h;
+
+	if (mode == CHECKSUM_XXH3) {
+		h = xxh3_64(buf, len, seed);
+		cast_uint64_to_uint8(&h, md, 1);
+	} else
+		sha3(buf, len, md, merkle_digest_size(mode));
+}
+
+void merkle_node(int mode, uint64_t seed, const uint8_t *left,
+		 const uint8_t *right, uint8_t *md)
+{
+	unsigned int mdlen = merkle_digest_size(mode);
+	uint8_t buf[1 + 2 * 64];
+
+	buf[0] = MERKLE_NODE_PREFIX;
+	memcpy(buf + 1, left, mdlen);
+	memcpy(buf + 1 + mdlen, right, mdlen);
+	merkle_leaf(mode, seed, buf, 1 + 2 * mdlen, md);
+}
+
+void merkle_reduce(int mode, uint64_t seed, uint8_t *md, size_t n,
+		   size_t stride)
+{
+	unsigned int mdlen = merkle_digest_size(mode);
+	size_t i;
+
+	/* Node i of the next level only depends on nodes 2i and 2i + 1 */
+	while (n > 1) {
+		for (i = 0; i < n / 2; i++)
+			merkle_node(mode, seed, md + 2 * i * stride,
+				    md + (2 * i + 1) * stride, md + i * stride);
+		if (n % 2)
+			memmove(md + i * stride, md + (n - 1) * stride, mdlen);
+		n = (n + 1) / 2;
+	}
+}
@@ -0,0 +1,58 @@
+#ifndef __MERKLE_H__
+#define __MERKLE_H__
+
+/*
+ * Copyright 2017 International Business Machines
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Merkle tree of the CHECKSUM_HASH_TREE mode, see action_checksum.h:
+ * leaves are hashed as they are, inner nodes as H(0x01 || left ||
+ * right), an odd node at the end of a level moves up unchanged. XXH3
+ * digests are 8 bytes, little endian.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MERKLE_NODE_PREFIX	0x01
+
+/* Digest size of mode in bytes, 0 if mode cannot build a tree */
+unsigned int merkle_digest_size(int mode);
+
+/* Number of leaves, an empty input has one empty leaf */
+size_t merkle_leaves(size_t size, size_t leaf_size);
+
+void merkle_leaf(int mode, uint64_t seed, const uint8_t *buf, size_t len,
+		 uint8_t *md);
+void merkle_node(int mode, uint64_t seed, const uint8_t *left,
+		 const uint8_t *right, uint8_t *md);
+
+/*
+ * Reduce the n digests at md, md + stride, ... level by level. The
+ * root ends up in the first one, the others are overwritten.
+ */
+void merkle_reduce(int mode, uint64_t seed, uint8_t *md, size_t n,
+		   size_t stride);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif	/* __MERKLE_H__ */
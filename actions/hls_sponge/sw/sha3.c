@@ -75,31 +75,32 @@ void cast_uint64_to_uint8(uint64_t *st_in, uint8_t *st_out, unsigned int size)
     }
 }
 
-// update the state with given number of rounds
-
-//void sha3_keccakf(uint64_t st[25])
-void sha3_keccakf(uint64_t st_in[25], uint64_t st_out[25])
+// constants
+static const uint64_t keccakf_rndc[24] = {
+    0x0000000000000001, 0x0000000000008082, 0x800000000000808a,
+    0x8000000080008000, 0x000000000000808b, 0x0000000080000001,
+    0x8000000080008081, 0x8000000000008009, 0x000000000000008a,
+    0x0000000000000088, 0x0000000080008009, 0x000000008000000a,
+    0x000000008000808b, 0x800000000000008b, 0x8000000000008089,
+    0x8000000000008003, 0x8000000000008002, 0x8000000000000080,
+    0x000000000000800a, 0x800000008000000a, 0x8000000080008081,
+    0x8000000000008080, 0x0000000080000001, 0x8000000080008008
+};
+static const int keccakf_rotc[24] = {
+    1,  3,  6,  10, 15, 21, 28, 36, 45, 55, 2,  14,
+    27, 41, 56, 8,  25, 43, 62, 18, 39, 61, 20, 44
+};
+static const int keccakf_piln[24] = {
+    10, 7,  11, 17, 18, 3, 5,  16, 8,  21, 24, 4,
+    15, 23, 19, 13, 12, 2, 20, 14, 22, 9,  6,  1
+};
+
+static const char *sha3_impl_strs[] = { "REF", "UNROLLED" };
+
+// update the state with given number of rounds, reference version
+
+static void sha3_keccakf_ref(uint64_t st_in[25], uint64_t st_out[25])
 {
-    // constants
-    const uint64_t keccakf_rndc[24] = {
-        0x0000000000000001, 0x0000000000008082, 0x800000000000808a,
-        0x8000000080008000, 0x000000000000808b, 0x0000000080000001,
-        0x8000000080008081, 0x8000000000008009, 0x000000000000008a,
-        0x0000000000000088, 0x0000000080008009, 0x000000008000000a,
-        0x000000008000808b, 0x800000000000008b, 0x8000000000008089,
-        0x8000000000008003, 0x8000000000008002, 0x8000000000000080,
-        0x000000000000800a, 0x800000008000000a, 0x8000000080008081,
-        0x8000000000008080, 0x0000000080000001, 0x8000000080008008
-    };
-    const int keccakf_rotc[24] = {
-        1,  3,  6,  10, 15, 21, 28, 36, 45, 55, 2,  14,
-        27, 41, 56, 8,  25, 43, 62, 18, 39, 61, 20, 44
-    };
-    const int keccakf_piln[24] = {
-        10, 7,  11, 17, 18, 3, 5,  16, 8,  21, 24, 4,
-        15, 23, 19, 13, 12, 2, 20, 14, 22, 9,  6,  1
-    };
-
     // variables
     int i, j, r;
     uint64_t t, bc[5];
@@ -181,6 +182,141 @@ void sha3_keccakf(uint64_t st_in[25], uint64_t st_out[25])
 
 }
 
+// Unrolled version: the 25 lanes live in local variables, rho and pi
+// are resolved at compile time. Lanes 1, 2, 8, 12, 17 and 20 are kept
+// complemented between the rounds ("lane complementing" from the Keccak
+// implementation overview), which turns 20 of the 25 NOTs of chi into
+// ORs and leaves one NOT per row.
+
+#define KECCAK_THETA_RHO_PI()                                           \
+    c0 = a00 ^ a05 ^ a10 ^ a15 ^ a20;                                   \
+    c1 = a01 ^ a06 ^ a11 ^ a16 ^ a21;                                   \
+    c2 = a02 ^ a07 ^ a12 ^ a17 ^ a22;                                   \
+    c3 = a03 ^ a08 ^ a13 ^ a18 ^ a23;                                   \
+    c4 = a04 ^ a09 ^ a14 ^ a19 ^ a24;                                   \
+    d0 = c4 ^ ROTL64(c1, 1);                                            \
+    d1 = c0 ^ ROTL64(c2, 1);                                            \
+    d2 = c1 ^ ROTL64(c3, 1);                                            \
+    d3 = c2 ^ ROTL64(c4, 1);                                            \
+    d4 = c3 ^ ROTL64(c0, 1);                                            \
+    b00 = a00 ^ d0;                                                     \
+    b01 = ROTL64(a06 ^ d1, 44);                                         \
+    b02 = ROTL64(a12 ^ d2, 43);                                         \
+    b03 = ROTL64(a18 ^ d3, 21);                                         \
+    b04 = ROTL64(a24 ^ d4, 14);                                         \
+    b05 = ROTL64(a03 ^ d3, 28);                                         \
+    b06 = ROTL64(a09 ^ d4, 20);                                         \
+    b07 = ROTL64(a10 ^ d0, 3);                                          \
+    b08 = ROTL64(a16 ^ d1, 45);                                         \
+    b09 = ROTL64(a22 ^ d2, 61);                                         \
+    b10 = ROTL64(a01 ^ d1, 1);                                          \
+    b11 = ROTL64(a07 ^ d2, 6);                                          \
+    b12 = ROTL64(a13 ^ d3, 25);                                         \
+    b13 = ROTL64(a19 ^ d4, 8);                                          \
+    b14 = ROTL64(a20 ^ d0, 18);                                         \
+    b15 = ROTL64(a04 ^ d4, 27);                                         \
+    b16 = ROTL64(a05 ^ d0, 36);                                         \
+    b17 = ROTL64(a11 ^ d1, 10);                                         \
+    b18 = ROTL64(a17 ^ d2, 15);                                         \
+    b19 = ROTL64(a23 ^ d3, 56);                                         \
+    b20 = ROTL64(a02 ^ d2, 62);                                         \
+    b21 = ROTL64(a08 ^ d3, 55);                                         \
+    b22 = ROTL64(a14 ^ d4, 39);                                         \
+    b23 = ROTL64(a15 ^ d0, 41);                                         \
+    b24 = ROTL64(a21 ^ d1, 2)
+
+static void sha3_keccakf_unrolled(uint64_t st_in[25], uint64_t st_out[25])
+{
+    uint64_t a00, a01, a02, a03, a04, a05, a06, a07, a08, a09, a10, a11, a12;
+    uint64_t a13, a14, a15, a16, a17, a18, a19, a20, a21, a22, a23, a24;
+    uint64_t b00, b01, b02, b03, b04, b05, b06, b07, b08, b09, b10, b11, b12;
+    uint64_t b13, b14, b15, b16, b17, b18, b19, b20, b21, b22, b23, b24;
+    uint64_t c0, c1, c2, c3, c4, d0, d1, d2, d3, d4;
+    int r;
+
+    a00 = st_in[0];  a01 = ~st_in[1]; a02 = ~st_in[2]; a03 = st_in[3];
+    a04 = st_in[4];  a05 = st_in[5];  a06 = st_in[6];  a07 = st_in[7];
+    a08 = ~st_in[8]; a09 = st_in[9];  a10 = st_in[10]; a11 = st_in[11];
+    a12 = ~st_in[12]; a13 = st_in[13]; a14 = st_in[14]; a15 = st_in[15];
+    a16 = st_in[16]; a17 = ~st_in[17]; a18 = st_in[18]; a19 = st_in[19];
+    a20 = ~st_in[20]; a21 = st_in[21]; a22 = st_in[22]; a23 = st_in[23];
+    a24 = st_in[24];
+
+    for (r = 0; r < KECCAKF_ROUNDS; r++) {
+        KECCAK_THETA_RHO_PI();
+
+        //  Chi and Iota on the complemented lanes
+        a00 = b00 ^ (b01 | b02) ^ keccakf_rndc[r];
+        a01 = b01 ^ (~b02 | b03);
+        a02 = b02 ^ (b03 & b04);
+        a03 = b03 ^ (b04 | b00);
+        a04 = b04 ^ (b00 & b01);
+
+        a05 = b05 ^ (b06 | b07);
+        a06 = b06 ^ (b07 & b08);
+        a07 = b07 ^ (b08 | ~b09);
+        a08 = b08 ^ (b09 | b05);
+        a09 = b09 ^ (b05 & b06);
+
+        a10 = b10 ^ (b11 | b12);
+        a11 = b11 ^ (b12 & b13);
+        a12 = b12 ^ (~b13 & b14);
+        a13 = ~b13 ^ (b14 | b10);
+        a14 = b14 ^ (b10 & b11);
+
+        a15 = b15 ^ (b16 & b17);
+        a16 = b16 ^ (b17 | b18);
+        a17 = b17 ^ (~b18 | b19);
+        a18 = ~b18 ^ (b19 & b15);
+        a19 = b19 ^ (b15 | b16);
+
+        a20 = b20 ^ (~b21 & b22);
+        a21 = ~b21 ^ (b22 | b23);
+        a22 = b22 ^ (b23 & b24);
+        a23 = b23 ^ (b24 | b20);
+        a24 = b24 ^ (b20 & b21);
+    }
+
+    st_out[0] = a00;  st_out[1] = ~a01; st_out[2] = ~a02; st_out[3] = a03;
+    st_out[4] = a04;  st_out[5] = a05;  st_out[6] = a06;  st_out[7] = a07;
+    st_out[8] = ~a08; st_out[9] = a09;  st_out[10] = a10; st_out[11] = a11;
+    st_out[12] = ~a12; st_out[13] = a13; st_out[14] = a14; st_out[15] = a15;
+    st_out[16] = a16; st_out[17] = ~a17; st_out[18] = a18; st_out[19] = a19;
+    st_out[20] = ~a20; st_out[21] = a21; st_out[22] = a22; st_out[23] = a23;
+    st_out[24] = a24;
+}
+
+static void (*sha3_keccakf_fns[SHA3_IMPL_MAX])(uint64_t st_in[25],
+                                              uint64_t st_out[25]) = {
+    sha3_keccakf_ref, sha3_keccakf_unrolled
+};
+static sha3_impl_t sha3_impl = SHA3_IMPL_UNROLLED;
+
+void sha3_keccakf(uint64_t st_in[25], uint64_t st_out[25])
+{
+    sha3_keccakf_fns[sha3_impl](st_in, st_out);
+}
+
+int sha3_set_impl(sha3_impl_t impl)
+{
+    if (impl >= SHA3_IMPL_MAX)
+        return -1;
+    sha3_impl = impl;
+    return 0;
+}
+
+sha3_impl_t sha3_get_impl(void)
+{
+    return sha3_impl;
+}
+
+const char *sha3_impl_str(sha3_impl_t impl)
+{
+    if (impl >= SHA3_IMPL_MAX)
+        return "UNKNOWN";
+    return sha3_impl_strs[impl];
+}
+
 // Initialize the context for SHA3
 
 int sha3_init(sha3_ctx_t *c, int mdlen)
@@ -209,7 +345,27 @@ int sha3_update(sha3_ctx_t *c, const uint8_t *data, size_t len)
     uint64_t st[25];
 
     j = c->pt;
-    for (i = 0; i < len; i++) {
+    i = 0;
+
+    // whole blocks are xored lane by lane into the unpacked state
+    if (j == 0 && len >= (size_t)c->rsiz) {
+        cast_uint8_to_uint64(c->st.b, st, 25);
+        for (; len - i >= (size_t)c->rsiz; i += c->rsiz) {
+            int k, n;
+
+            for (k = 0; k < c->rsiz / 8; k++) {
+                uint64_t w = 0;
+
+                for (n = 7; n >= 0; n--)
+                    w = (w << 8) | data[i + 8 * k + n];
+                st[k] ^= w;
+            }
+            sha3_keccakf(st, st);
+        }
+        cast_uint64_to_uint8(st, c->st.b, 25);
+    }
+
+    for (; i < len; i++) {
 	    /* #pragma HLS UNROLL */
         if (i < len) {
 			c->st.b[j++] ^= ((const uint8_t *) data)[i];
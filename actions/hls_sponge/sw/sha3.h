@@ -57,6 +57,18 @@ typedef struct {
 //void sha3_keccakf(uint64_t st[25]);
 void sha3_keccakf(uint64_t st_in[25], uint64_t st_out[25]);
 
+// Keccak-f implementation used by sha3_keccakf(), all give the same
+// result. UNROLLED is the default, REF the loop from tiny_sha3.
+typedef enum sha3_impl {
+    SHA3_IMPL_REF = 0x0,
+    SHA3_IMPL_UNROLLED = 0x1,
+    SHA3_IMPL_MAX = 0x2,
+} sha3_impl_t;
+
+int sha3_set_impl(sha3_impl_t impl);        // 0 or -1 if unknown
+sha3_impl_t sha3_get_impl(void);
+const char *sha3_impl_str(sha3_impl_t impl);
+
 // OpenSSL - like interfece
 int sha3_init(sha3_ctx_t *c, int mdlen);    // mdlen = hash output in bytes
 //int sha3_update(sha3_ctx_t *c, const void *data, size_t len);
@@ -0,0 +1,152 @@
+/*
+ * Copyright 2017 International Business Machines
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Multi-buffer Keccak with GCC vector extensions. Each of the 25 lanes
+ * is a vector of four 64 bit words, one per message, so every step of
+ * the permutation works on four states at once. On x86 an AVX2 clone
+ * is selected at load time if the CPU has it, otherwise the compiler
+ * uses pairs of 128 bit operations.
+ */
+
+#include <string.h>
+
+#include "sha3_x4.h"
+
+typedef uint64_t v4u64_t __attribute__((vector_size(32)));
+
+#define ROTV64(x, y) (((x) << (y)) | ((x) >> (64 - (y))))
+
+#if defined(__x86_64__)
+#define SHA3_X4_CLONES __attribute__((target_clones("avx2", "default")))
+#else
+#define SHA3_X4_CLONES
+#endif
+
+static const uint64_t keccakf_rndc[24] = {
+	0x0000000000000001, 0x0000000000008082, 0x800000000000808a,
+	0x8000000080008000, 0x000000000000808b, 0x0000000080000001,
+	0x8000000080008081, 0x8000000000008009, 0x000000000000008a,
+	0x0000000000000088, 0x0000000080008009, 0x000000008000000a,
+	0x000000008000808b, 0x800000000000008b, 0x8000000000008089,
+	0x8000000000008003, 0x8000000000008002, 0x8000000000000080,
+	0x000000000000800a, 0x800000008000000a, 0x8000000080008081,
+	0x8000000000008080, 0x0000000080000001, 0x8000000080008008
+};
+static const int keccakf_rotc[24] = {
+	1,  3,  6,  10, 15, 21, 28, 36, 45, 55, 2,  14,
+	27, 41, 56, 8,  25, 43, 62, 18, 39, 61, 20, 44
+};
+static const int keccakf_piln[24] = {
+	10, 7,  11, 17, 18, 3, 5,  16, 8,  21, 24, 4,
+	15, 23, 19, 13, 12, 2, 20, 14, 22, 9,  6,  1
+};
+
+SHA3_X4_CLONES
+static void sha3_keccakf_x4(v4u64_t st[25])
+{
+	v4u64_t t, bc[5];
+	int i, j, r;
+
+	for (r = 0; r < 24; r++) {
+		/* Theta */
+		for (i = 0; i < 5; i++)
+			bc[i] = st[i] ^ st[i + 5] ^ st[i + 10] ^
+				st[i + 15] ^ st[i + 20];
+		for (i = 0; i < 5; i++) {
+			t = bc[(i + 4) % 5] ^ ROTV64(bc[(i + 1) % 5], 1);
+			for (j = 0; j < 25; j += 5)
+				st[j + i] ^= t;
+		}
+
+		/* Rho Pi */
+		t = st[1];
+		for (i = 0; i < 24; i++) {
+			j = keccakf_piln[i];
+			bc[0] = st[j];
+			st[j] = ROTV64(t, keccakf_rotc[i]);
+			t = bc[0];
+		}
+
+		/* Chi */
+		for (j = 0; j < 25; j += 5) {
+			for (i = 0; i < 5; i++)
+				bc[i] = st[j + i];
+			for (i = 0; i < 5; i++)
+				st[j + i] ^= ~bc[(i + 1) % 5] & bc[(i + 2) % 5];
+		}
+
+		/* Iota */
+		st[0] ^= (v4u64_t){ keccakf_rndc[r], keccakf_rndc[r],
+				    keccakf_rndc[r], keccakf_rndc[r] };
+	}
+}
+
+static inline uint64_t le64(const uint8_t *p)
+{
+	return (uint64_t)p[0] | (uint64_t)p[1] << 8 |
+		(uint64_t)p[2] << 16 | (uint64_t)p[3] << 24 |
+		(uint64_t)p[4] << 32 | (uint64_t)p[5] << 40 |
+		(uint64_t)p[6] << 48 | (uint64_t)p[7] << 56;
+}
+
+void sha3_x4(const uint8_t *in[SHA3_X4_WAYS],
+	     const size_t inlen[SHA3_X4_WAYS],
+	     uint8_t *md[SHA3_X4_WAYS], int mdlen, int outlen, int shake)
+{
+	v4u64_t st[25];
+	uint8_t last[200];
+	const uint8_t *p;
+	size_t rate = 200 - 2 * mdlen;
+	size_t nblocks[SHA3_X4_WAYS], maxblocks = 0, b, rem;
+	int w, i;
+
+	memset(st, 0, sizeof(st));
+	for (w = 0; w < SHA3_X4_WAYS; w++) {
+		nblocks[w] = md[w] ? inlen[w] / rate + 1 : 0;
+		if (nblocks[w] > maxblocks)
+			maxblocks = nblocks[w];
+	}
+
+	for (b = 0; b < maxblocks; b++) {
+		for (w = 0; w < SHA3_X4_WAYS; w++) {
+			if (b >= nblocks[w])
+				continue;
+
+			p = in[w] + b * rate;
+			if (b == nblocks[w] - 1) {	/* pad the last one */
+				rem = inlen[w] - b * rate;
+				memset(last, 0, rate);
+				if (rem)
+					memcpy(last, p, rem);
+				last[rem] ^= shake ? 0x1f : 0x06;
+				last[rate - 1] ^= 0x80;
+				p = last;
+			}
+			for (i = 0; i < (int)rate / 8; i++)
+				st[i][w] ^= le64(p + 8 * i);
+		}
+
+		sha3_keccakf_x4(st);
+
+		for (w = 0; w < SHA3_X4_WAYS; w++) {
+			if (b != nblocks[w] - 1)
+				continue;
+			for (i = 0; i < outlen; i++)
+				md[w][i] = (uint8_t)(st[i / 8][w] >> (8 * (i % 8)));
+		}
+	}
+}
@@ -0,0 +1,49 @@
+#ifndef __SHA3_X4_H__
+#define __SHA3_X4_H__
+
+/*
+ * Copyright 2017 International Business Machines
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Multi-buffer SHA3/SHAKE: four independent messages share one
+ * Keccak-f[1600] on 4 x 64 bit vectors, one message per vector element.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SHA3_X4_WAYS	4
+
+/*
+ * Hash up to four complete messages. Message w is in[w], inlen[w]
+ * bytes, its first outlen bytes of output go to md[w]. Ways with
+ * md[w] == NULL are unused. mdlen selects the rate like sha3_init()
+ * does, shake selects the SHAKE instead of the SHA3 padding. outlen
+ * must not exceed the rate.
+ */
+void sha3_x4(const uint8_t *in[SHA3_X4_WAYS],
+	     const size_t inlen[SHA3_X4_WAYS],
+	     uint8_t *md[SHA3_X4_WAYS], int mdlen, int outlen, int shake);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif	/* __SHA3_X4_H__ */
@@ -20,6 +20,7 @@
 #include <stdint.h>
 #include <unistd.h>
 #include <getopt.h>
+#include <pthread.h>
 #include <malloc.h>
 #include <sys/mman.h>
 #include <sys/stat.h>
@@ -28,12 +29,23 @@
 #include <snap_tools.h>
 #include <action_checksum.h>
 #include <libsnap.h>
+#include <snap_internal.h>
 #include <snap_hls_if.h>
+#include <crc32.h>
+#include <sha3.h>
+#include <xxh3.h>
+#include <merkle.h>
 
 int verbose_flag = 0;
 
+/* SNAP_ADDRFLAG_DRIVE1 selects the second drive for NVMe input */
+static snap_addrflag_t flags_in = 0;
+
 static const char *version = GIT_VERSION;
-static const char *checksum_mode_str[] = { "CRC32", "ADLER32", "SPONGE" };
+static const char *checksum_mode_str[] = { "CRC32", "ADLER32", "SPONGE",
+					    "CRC32C", "SHA3_224", "SHA3_256",
+					    "SHA3_384", "SHA3_512", "SHAKE128",
+					    "SHAKE256", "XXH3" };
 static const char *test_choice_str[] = { "SPEED", "SHA3", "SHAKE" , "SHA3_SHAKE"};
 
 /**
@@ -46,20 +58,51 @@ static void usage(const char *prog)
 	printf("Usage: %s [-h] [-v, --verbose] [-V, --version]\n"
 	       "  -C, --card <cardno> can be (0...3)\n"
 	       "  -x, --threads <threads>   depends on the available CPUs.\n"
-	       "  -i, --input <file.bin>    input file.\n"
-	       "  -S, --start-value <checksum_start> checksum start value.\n"
-	       "  -A, --type-in <CARD_RAM, HOST_RAM, ...>.\n"
-	       "  -a, --addr-in <addr>      address e.g. in CARD_RAM.\n"
+	       "  -i, --input <file.bin>    input file, with -ACARD_DRAM put\n"
+	       "                            at --addr-in (software mode only).\n"
+	       "  -S, --start-value <checksum_start> checksum start value\n"
+	       "                            (default 0 for CRCs, 1 for ADLER32),\n"
+	       "                            seed for XXH3.\n"
+	       "  -A, --type-in <CARD_DRAM, HOST_DRAM, NVME, NVME1>.\n"
+	       "  -a, --addr-in <addr>      address e.g. in CARD_DRAM, byte\n"
+	       "                            offset on the drive for NVME.\n"
 	       "  -s, --size <size>         size of data.\n"
 	       "  -c, --choice <SPEED,SHA3,SHAKE,SHA3_SHAKE>  sponge specific input.\n"
 	       "  -n, --number of elements <nb_elmts> sponge specific input.\n"
 	       "  -f, --frequency <freq>        sponge specific input.(up to 65536)\n"
-	       "  -m, --mode <CRC32|ADLER32|SPONGE> mode flags.\n"
+	       "  -m, --mode <CRC32|CRC32C|ADLER32|SPONGE|SHA3_224|SHA3_256|\n"
+	       "              SHA3_384|SHA3_512|SHAKE128|SHAKE256|XXH3> mode flags.\n"
+	       "  -d, --digest-size <bytes> SHAKE output size (default 32/64).\n"
+	       "  -b, --block-size <bytes>  hash or CRC in several jobs of this\n"
+	       "                            size, rounded down to the SHA3 rate.\n"
+	       "  -o, --output <file.bin>   write the SHA3/SHAKE digest to file.\n"
+	       "  -B, --batch <n>           cut the input into n messages and\n"
+	       "                            hash them with one batch job.\n"
+	       "  -j, --jobs <n>            CRC the input as n chunks in\n"
+	       "                            parallel and merge the results.\n"
+	       "  -L, --leaf-size <bytes>   Merkle tree root over leaves of this\n"
+	       "                            size, SHA3_224...SHA3_512 and XXH3.\n"
+	       "                            With -o the leaf digests go to file.\n"
+	       "  -X, --verify              verify the result on the host\n"
+	       "                            (HOST_DRAM or CARD_DRAM with -i).\n"
 	       "  -T, --test                execute a test if available.\n"
 	       "  -t, --timeout             Timeout in sec (default 3600 sec).\n"
 	       "  -I, --irq                 Enable Interrupts\n"
 	       "\n"
 	       "Example:\n"
+	       "  snap_checksum -mCRC32 -i file.bin\n"
+	       "  snap_checksum -mCRC32C -X -i file.bin\n"
+	       "  snap_checksum -mSHA3_256 -X -b0x100000 -i file.bin\n"
+	       "  snap_checksum -mSHA3_256 -X -ACARD_DRAM -a0x1000 -i file.bin\n"
+	       "  snap_checksum -mSHAKE128 -d1000 -o digest.bin -i file.bin\n"
+	       "  snap_checksum -mSHA3_256 -X -B1000 -i file.bin\n"
+	       "  snap_checksum -mXXH3 -X -B1000 -i file.bin\n"
+	       "  snap_checksum -mSHA3_256 -X -L0x100000 -i file.bin\n"
+	       "  snap_checksum -mCRC32C -X -j8 -b0x100000 -i file.bin\n"
+	       "  snap_checksum -mCRC32 -T -s0x1000000  compare host CRC implementations\n"
+	       "  snap_checksum -mSHA3_256 -T -s0x1000000  same for Keccak-f\n"
+	       "  snap_checksum -mXXH3 -T -s0x1000000  check and time host XXH3\n"
+	       "  snap_checksum -mADLER32 -ACARD_DRAM -a0x0 -s0x100000\n"
 	       "  snap_checksum -mSPONGE -I -t200 -cSPEED -n2 -f65536 will generate 65536*2/65536 = 2 calls \n"
 	       "  snap_checksum -mSPONGE -I -t200 -cSPEED -n1 -f4     will generate 65536*1/4 = 16384 calls\n"
                "               (1 call every 4 calls until 65536...\n"
@@ -82,7 +125,7 @@ static void snap_prepare_checksum(struct snap_job *cjob,
 {
 	snap_addr_set(&mjob_in->in, addr_in, size_in, type_in,
 		      SNAP_ADDRFLAG_ADDR | SNAP_ADDRFLAG_SRC |
-		      SNAP_ADDRFLAG_END);
+		      SNAP_ADDRFLAG_END | flags_in);
 
 	mjob_in->chk_type = type;
 	mjob_in->chk_in = chk_in;
@@ -162,6 +205,38 @@ file_write(const char *fname, const uint8_t *buff, size_t len)
 	return rc;
 }
 
+/*
+ * Copy the input file to card DRAM at addr. The host can only write
+ * card DRAM directly in software mode (SNAP_CONFIG=1).
+ */
+static int card_load(int card_no, uint64_t addr, const uint8_t *buf,
+		     size_t size)
+{
+	char device[128];
+	struct snap_card *card;
+	void *ddr;
+
+	snprintf(device, sizeof(device)-1, "/dev/cxl/afu%d.0s", card_no);
+	card = snap_card_alloc_dev(device, SNAP_VENDOR_ID_IBM,
+				   SNAP_DEVICE_ID_SNAP);
+	if (card == NULL) {
+		fprintf(stderr, "err: failed to open card %u: %s\n",
+			card_no, strerror(errno));
+		return -1;
+	}
+
+	ddr = snap_card_ddr_emu(card, addr, size);
+	if (ddr == NULL) {
+		fprintf(stderr, "err: cannot put the input to CARD_DRAM at "
+			"%016llx, only in software mode\n", (long long)addr);
+		snap_card_free(card);
+		return -1;
+	}
+	memcpy(ddr, buf, size);
+	snap_card_free(card);
+	return 0;
+}
+
 static int do_checksum(int card_no, unsigned long timeout,
 		       unsigned int threads,
 		       unsigned long addr_in,
@@ -235,18 +310,23 @@ static int do_checksum(int card_no, unsigned long timeout,
 
 	fprintf(fp, "------------------\n"
                 "RETC=%x => %s\n"
-		"CHECKSUM=%016llx\n"
-		"NB_TEST_RUNS=%d\n"
-		"NB_ROUND=%d\n"
-		"%lld usec\n"
-                "------------------\n",
+		"CHECKSUM=%016llx\n",
 		cjob.retc, (cjob.retc == SNAP_RETC_SUCCESS ? "SUCCESS" : "FAILURE"),
-		(long long)mjob_out.chk_out,
-		mjob_out.nb_test_runs,
-		mjob_out.nb_rounds,
+		(long long)mjob_out.chk_out);
+	if (mode == CHECKSUM_SPONGE)
+		fprintf(fp, "NB_TEST_RUNS=%d\n"
+			"NB_ROUND=%d\n",
+			mjob_out.nb_test_runs,
+			mjob_out.nb_rounds);
+	fprintf(fp, "%lld usec\n"
+                "------------------\n",
 		(long long)timediff_usec(&etime, &stime));
+	if (cjob.retc != SNAP_RETC_SUCCESS) {
+		fprintf(stderr, "err: Unexpected RETC=%x!\n", cjob.retc);
+		goto out_error2;
+	}
 
-        if(test_choice == CHECKSUM_SPEED) {
+        if(mode == CHECKSUM_SPONGE && test_choice == CHECKSUM_SPEED) {
 
             for(j = 0; j<NB_TEST_RUNS; j++)
                  if(mjob_out.nb_elmts > (j % mjob_out.freq))
@@ -281,6 +361,957 @@ static int do_checksum(int card_no, unsigned long timeout,
 	return -1;
 }
 
+/*
+ * CRC over a buffer cut into nchunks pieces. Each piece is checksummed
+ * by its own thread with its own action context, in jobs of at most
+ * block_size bytes. A job continues the CRC of the previous one via
+ * chk_in, the per chunk results are merged with crc32_*_combine().
+ */
+struct crc_chunk {
+	pthread_t thread_id;
+	int card_no;
+	unsigned long timeout;
+	snap_action_flag_t action_irq;
+	checksum_mode_t mode;
+	unsigned char type_in;
+	unsigned long addr;
+	unsigned long size;
+	unsigned long block_size;
+	uint64_t chk;		/* in: start value, out: CRC of the chunk */
+	unsigned int njobs;
+	int rc;
+};
+
+static void *crc_chunk_main(void *data)
+{
+	struct crc_chunk *c = (struct crc_chunk *)data;
+	char device[128];
+	struct snap_card *card;
+	struct snap_action *action;
+	struct snap_job cjob;
+	struct checksum_job mjob_in, mjob_out;
+	unsigned long offs, len;
+	int rc;
+
+	c->rc = -1;
+	snprintf(device, sizeof(device)-1, "/dev/cxl/afu%d.0s", c->card_no);
+	card = snap_card_alloc_dev(device, SNAP_VENDOR_ID_IBM,
+				   SNAP_DEVICE_ID_SNAP);
+	if (card == NULL) {
+		fprintf(stderr, "err: failed to open card %u: %s\n",
+			c->card_no, strerror(errno));
+		return NULL;
+	}
+
+	action = snap_attach_action(card, CHECKSUM_ACTION_TYPE,
+				    c->action_irq, 60);
+	if (action == NULL) {
+		fprintf(stderr, "err: failed to attach action %u: %s\n",
+			c->card_no, strerror(errno));
+		goto out_free;
+	}
+
+	for (offs = 0; offs < c->size; offs += len) {
+		len = c->size - offs;
+		if (c->block_size && len > c->block_size)
+			len = c->block_size;
+
+		memset(&mjob_in, 0, sizeof(mjob_in));
+		snap_prepare_checksum(&cjob, &mjob_in, &mjob_out,
+				      (void *)(c->addr + offs), len,
+				      c->type_in, c->mode, c->chk,
+				      0, 0, 0, 0);
+
+		rc = snap_action_sync_execute_job(action, &cjob, c->timeout);
+		if (rc != 0) {
+			fprintf(stderr, "err: job execution %d: %s!\n", rc,
+				strerror(errno));
+			goto out_detach;
+		}
+		if (cjob.retc != SNAP_RETC_SUCCESS) {
+			fprintf(stderr, "err: Unexpected RETC=%x!\n",
+				cjob.retc);
+			goto out_detach;
+		}
+		c->chk = mjob_out.chk_out;
+		c->njobs++;
+	}
+	c->rc = 0;
+
+ out_detach:
+	snap_detach_action(action);
+ out_free:
+	snap_card_free(card);
+	return NULL;
+}
+
+static int do_checksum_chunks(int card_no, unsigned long timeout,
+			      unsigned long addr_in, unsigned char type_in,
+			      unsigned long size, uint64_t checksum_start,
+			      checksum_mode_t mode, unsigned long block_size,
+			      unsigned int nchunks, uint64_t *_checksum,
+			      FILE *fp, snap_action_flag_t action_irq)
+{
+	int rc = 0;
+	unsigned int i, j, njobs = 0;
+	struct crc_chunk *c;
+	struct timeval etime, stime;
+	uint32_t crc;
+	long long usec;
+
+	fprintf(fp, "PARAMETERS:\n"
+		"  type_in:  %x\n"
+		"  addr_in:  %016llx\n"
+		"  size:     %08lx\n"
+		"  checksum_start: %016llx\n"
+		"  mode:     %08x %s\n"
+		"  chunks:   %d\n"
+		"  block_size: %08lx\n",
+		type_in, (long long)addr_in, size,
+		(long long)checksum_start, mode,
+		checksum_mode_str[mode % CHECKSUM_MODE_MAX],
+		nchunks, block_size);
+
+	c = calloc(nchunks, sizeof(*c));
+	if (c == NULL)
+		return -1;
+
+	for (i = 0; i < nchunks; i++) {
+		c[i].card_no = card_no;
+		c[i].timeout = timeout;
+		c[i].action_irq = action_irq;
+		c[i].mode = mode;
+		c[i].type_in = type_in;
+		c[i].addr = addr_in + size * i / nchunks;
+		c[i].size = size * (i + 1) / nchunks - size * i / nchunks;
+		c[i].block_size = block_size;
+		c[i].chk = (i == 0) ? checksum_start : 0;
+	}
+
+	gettimeofday(&stime, NULL);
+	for (i = 0; i < nchunks; i++) {
+		rc = pthread_create(&c[i].thread_id, NULL, crc_chunk_main,
+				    &c[i]);
+		if (rc != 0) {
+			fprintf(stderr, "err: pthread_create: %s\n",
+				strerror(rc));
+			break;
+		}
+	}
+	for (j = 0; j < i; j++)
+		pthread_join(c[j].thread_id, NULL);
+	if (rc != 0) {
+		free(c);
+		return -1;	/* no CRC without all chunks */
+	}
+
+	crc = (uint32_t)c[0].chk;
+	for (i = 0; i < nchunks; i++) {
+		if (c[i].rc != 0)
+			rc = -1;
+		if (i == 0)
+			continue;
+		if (mode == CHECKSUM_CRC32C)
+			crc = crc32c_combine(crc, c[i].chk, c[i].size);
+		else
+			crc = crc32_ieee_combine(crc, c[i].chk, c[i].size);
+	}
+	gettimeofday(&etime, NULL);
+
+	for (i = 0; i < nchunks; i++) {
+		njobs += c[i].njobs;
+		if (verbose_flag)
+			fprintf(fp, "  chunk %d: %016lx %08lx CRC %08x, "
+				"%d jobs\n", i, c[i].addr, c[i].size,
+				(uint32_t)c[i].chk, c[i].njobs);
+	}
+	free(c);
+	if (rc != 0)
+		return rc;
+
+	usec = timediff_usec(&etime, &stime);
+	fprintf(fp, "------------------\n"
+		"RETC=%x => SUCCESS\n"
+		"CHECKSUM=%016llx\n"
+		"%d jobs, %lld usec\n"
+		"------------------\n",
+		SNAP_RETC_SUCCESS, (long long)crc, njobs, usec);
+
+	if (_checksum)
+		*_checksum = crc;
+	return 0;
+}
+
+/* Half the Keccak capacity in bytes, the digest size for SHA3 */
+static unsigned int hash_mdlen(int mode)
+{
+	switch (mode) {
+	case CHECKSUM_SHA3_224: return 28;
+	case CHECKSUM_SHA3_256: return 32;
+	case CHECKSUM_SHA3_384: return 48;
+	case CHECKSUM_SHA3_512: return 64;
+	case CHECKSUM_SHAKE128: return 16;
+	case CHECKSUM_SHAKE256: return 32;
+	default:		return 0;
+	}
+}
+
+static int is_shake(int mode)
+{
+	return (mode == CHECKSUM_SHAKE128) || (mode == CHECKSUM_SHAKE256);
+}
+
+/*
+ * Hash a buffer with one or more jobs. Jobs other than the last hash
+ * block_size bytes, rounded down to a multiple of the rate, and leave
+ * the Keccak state in host memory for the next one.
+ */
+static int do_hash(int card_no, unsigned long timeout,
+		   unsigned long addr_in, unsigned char type_in,
+		   unsigned long size, checksum_mode_t mode,
+		   unsigned long block_size,
+		   uint8_t *digest, unsigned int digest_size,
+		   FILE *fp, snap_action_flag_t action_irq)
+{
+	int rc;
+	char device[128];
+	struct snap_card *card = NULL;
+	struct snap_action *action = NULL;
+	struct snap_job cjob;
+	struct checksum_job mjob_in, mjob_out;
+	struct timeval etime, stime;
+	unsigned int rate = 200 - 2 * hash_mdlen(mode);
+	unsigned long done = 0, n;
+	unsigned int jobs = 0, i;
+	uint8_t *obuff = NULL, *sbuff = NULL;
+
+	block_size -= block_size % rate;
+
+	fprintf(fp, "PARAMETERS:\n"
+		"  type_in:  %x\n"
+		"  addr_in:  %016llx\n"
+		"  size:     %08lx\n"
+		"  mode:     %08x %s\n"
+		"  digest:   %d bytes\n"
+		"  block:    %08lx\n",
+		type_in, (long long)addr_in, size, mode,
+		checksum_mode_str[mode % CHECKSUM_MODE_MAX],
+		digest_size, block_size);
+
+	obuff = memalign(64, (digest_size + 63) & ~63);
+	sbuff = memalign(64, CHECKSUM_HASH_STATE_SIZE);
+	if (obuff == NULL || sbuff == NULL)
+		goto out_error;
+
+	snprintf(device, sizeof(device)-1, "/dev/cxl/afu%d.0s", card_no);
+	card = snap_card_alloc_dev(device, SNAP_VENDOR_ID_IBM,
+				   SNAP_DEVICE_ID_SNAP);
+	if (card == NULL) {
+		fprintf(stderr, "err: failed to open card %u: %s\n",
+			card_no, strerror(errno));
+		goto out_error;
+	}
+
+	action = snap_attach_action(card, CHECKSUM_ACTION_TYPE, action_irq, 60);
+	if (action == NULL) {
+		fprintf(stderr, "err: failed to attach action %u: %s\n",
+			card_no, strerror(errno));
+		goto out_error1;
+	}
+
+	memset(&mjob_in, 0, sizeof(mjob_in));
+	mjob_in.chk_type = mode;
+	mjob_in.hash_flags = CHECKSUM_HASH_INIT;
+	snap_addr_set(&mjob_in.out, obuff, digest_size,
+		      SNAP_ADDRTYPE_HOST_DRAM,
+		      SNAP_ADDRFLAG_ADDR | SNAP_ADDRFLAG_DST);
+	snap_addr_set(&mjob_in.state, sbuff, CHECKSUM_HASH_STATE_SIZE,
+		      SNAP_ADDRTYPE_HOST_DRAM,
+		      SNAP_ADDRFLAG_ADDR | SNAP_ADDRFLAG_SRC |
+		      SNAP_ADDRFLAG_DST | SNAP_ADDRFLAG_END);
+
+	gettimeofday(&stime, NULL);
+	do {
+		n = size - done;
+		if (block_size && n > block_size)
+			n = block_size;
+		else
+			mjob_in.hash_flags |= CHECKSUM_HASH_FINAL;
+
+		snap_addr_set(&mjob_in.in, (void *)(addr_in + done), n,
+			      type_in, SNAP_ADDRFLAG_ADDR | SNAP_ADDRFLAG_SRC);
+		snap_job_set(&cjob, &mjob_in, sizeof(mjob_in),
+			     &mjob_out, sizeof(mjob_out));
+
+		rc = snap_action_sync_execute_job(action, &cjob, timeout);
+		if (rc != 0) {
+			fprintf(stderr, "err: job execution %d: %s!\n", rc,
+				strerror(errno));
+			goto out_error2;
+		}
+		if (cjob.retc != SNAP_RETC_SUCCESS) {
+			fprintf(stderr, "err: Unexpected RETC=%x!\n",
+				cjob.retc);
+			goto out_error2;
+		}
+		mjob_in.hash_flags &= ~CHECKSUM_HASH_INIT;
+		done += n;
+		jobs++;
+	} while (!(mjob_in.hash_flags & CHECKSUM_HASH_FINAL));
+	gettimeofday(&etime, NULL);
+
+	memcpy(digest, obuff, digest_size);
+
+	fprintf(fp, "------------------\n"
+		"RETC=%x => SUCCESS\n"
+		"CHECKSUM=%016llx\n"
+		"%d jobs, %lld usec\n"
+		"------------------\n",
+		cjob.retc, (long long)mjob_out.chk_out, jobs,
+		(long long)timediff_usec(&etime, &stime));
+
+	snap_detach_action(action);
+	snap_card_free(card);
+
+	for (i = 0; i < digest_size; i++)
+		printf("%02x", digest[i]);
+	printf("\n");
+
+	free(obuff);
+	free(sbuff);
+	return 0;
+
+ out_error2:
+	snap_detach_action(action);
+ out_error1:
+	snap_card_free(card);
+ out_error:
+	free(obuff);
+	free(sbuff);
+	return -1;
+}
+
+/*
+ * Hash nmsg messages with one batch job. The input is cut into nmsg
+ * pieces of about the same size, digest i goes to
+ * digests + i * digest_size. For XXH3 the digests are the 8 byte
+ * little endian hashes and seed is passed as chk_in.
+ */
+static int do_hash_batch(int card_no, unsigned long timeout,
+			 unsigned long addr_in, unsigned char type_in,
+			 unsigned long size, checksum_mode_t mode,
+			 uint64_t seed, unsigned int nmsg,
+			 uint8_t *digests, unsigned int digest_size,
+			 FILE *fp, snap_action_flag_t action_irq)
+{
+	int rc;
+	char device[128];
+	struct snap_card *card = NULL;
+	struct snap_action *action = NULL;
+	struct snap_job cjob;
+	struct checksum_job mjob_in, mjob_out;
+	struct timeval etime, stime;
+	struct snap_addr *desc = NULL;
+	uint8_t *obuff = NULL;
+	unsigned long start, end;
+	long long usec;
+	unsigned int i;
+	unsigned int slot = (mode == CHECKSUM_XXH3) ? sizeof(uint64_t) :
+		CHECKSUM_HASH_SLOT_SIZE;
+
+	fprintf(fp, "PARAMETERS:\n"
+		"  type_in:  %x\n"
+		"  addr_in:  %016llx\n"
+		"  size:     %08lx\n"
+		"  mode:     %08x %s\n"
+		"  digest:   %d bytes\n"
+		"  messages: %d\n",
+		type_in, (long long)addr_in, size, mode,
+		checksum_mode_str[mode % CHECKSUM_MODE_MAX],
+		digest_size, nmsg);
+
+	desc = memalign(64, nmsg * sizeof(*desc));
+	obuff = memalign(64, (nmsg * slot + 63) & ~63ul);
+	if (desc == NULL || obuff == NULL)
+		goto out_error;
+
+	for (i = 0; i < nmsg; i++) {
+		start = size * i / nmsg;
+		end = size * (i + 1) / nmsg;
+		snap_addr_set(&desc[i], (void *)(addr_in + start),
+			      end - start, type_in,
+			      SNAP_ADDRFLAG_ADDR | SNAP_ADDRFLAG_SRC);
+	}
+
+	snprintf(device, sizeof(device)-1, "/dev/cxl/afu%d.0s", card_no);
+	card = snap_card_alloc_dev(device, SNAP_VENDOR_ID_IBM,
+				   SNAP_DEVICE_ID_SNAP);
+	if (card == NULL) {
+		fprintf(stderr, "err: failed to open card %u: %s\n",
+			card_no, strerror(errno));
+		goto out_error;
+	}
+
+	action = snap_attach_action(card, CHECKSUM_ACTION_TYPE, action_irq, 60);
+	if (action == NULL) {
+		fprintf(stderr, "err: failed to attach action %u: %s\n",
+			card_no, strerror(errno));
+		goto out_error1;
+	}
+
+	memset(&mjob_in, 0, sizeof(mjob_in));
+	mjob_in.chk_type = mode;
+	mjob_in.chk_in = seed;
+	mjob_in.hash_flags = CHECKSUM_HASH_BATCH;
+	snap_addr_set(&mjob_in.in, desc, nmsg * sizeof(*desc),
+		      SNAP_ADDRTYPE_HOST_DRAM,
+		      SNAP_ADDRFLAG_ADDR | SNAP_ADDRFLAG_SRC);
+	snap_addr_set(&mjob_in.out, obuff,
+		      (mode == CHECKSUM_XXH3) ? nmsg * slot : digest_size,
+		      SNAP_ADDRTYPE_HOST_DRAM,
+		      SNAP_ADDRFLAG_ADDR | SNAP_ADDRFLAG_DST |
+		      SNAP_ADDRFLAG_END);
+	snap_job_set(&cjob, &mjob_in, sizeof(mjob_in),
+		     &mjob_out, sizeof(mjob_out));
+
+	gettimeofday(&stime, NULL);
+	rc = snap_action_sync_execute_job(action, &cjob, timeout);
+	gettimeofday(&etime, NULL);
+	if (rc != 0) {
+		fprintf(stderr, "err: job execution %d: %s!\n", rc,
+			strerror(errno));
+		goto out_error2;
+	}
+	if (cjob.retc != SNAP_RETC_SUCCESS) {
+		fprintf(stderr, "err: Unexpected RETC=%x!\n", cjob.retc);
+		goto out_error2;
+	}
+
+	usec = timediff_usec(&etime, &stime);
+	fprintf(fp, "------------------\n"
+		"RETC=%x => SUCCESS\n"
+		"CHECKSUM=%016llx\n"
+		"%lld usec, %.0f messages/s\n"
+		"------------------\n",
+		cjob.retc, (long long)mjob_out.chk_out, usec,
+		usec ? (double)nmsg * 1000000.0 / (double)usec : 0.0);
+
+	snap_detach_action(action);
+	snap_card_free(card);
+
+	for (i = 0; i < nmsg; i++) {
+		unsigned int k;
+
+		memcpy(digests + i * digest_size, obuff + i * slot,
+		       digest_size);
+		if (mode == CHECKSUM_XXH3) {
+			uint64_t h;
+
+			cast_uint8_to_uint64(digests + i * digest_size,
+					     &h, 1);
+			printf("%016llx  %d\n", (long long)h, i);
+			continue;
+		}
+		for (k = 0; k < digest_size; k++)
+			printf("%02x", digests[i * digest_size + k]);
+		printf("  %d\n", i);
+	}
+
+	free(desc);
+	free(obuff);
+	return 0;
+
+ out_error2:
+	snap_detach_action(action);
+ out_error1:
+	snap_card_free(card);
+ out_error:
+	free(desc);
+	free(obuff);
+	return -1;
+}
+
+/*
+ * Merkle tree root of the input with one job. With leaves != NULL the
+ * action also returns the leaf digests, digest size bytes each.
+ */
+static int do_hash_tree(int card_no, unsigned long timeout,
+			unsigned long addr_in, unsigned char type_in,
+			unsigned long size, checksum_mode_t mode,
+			uint64_t seed, unsigned long leaf_size,
+			uint8_t *root, uint8_t *leaves,
+			FILE *fp, snap_action_flag_t action_irq)
+{
+	int rc;
+	char device[128];
+	struct snap_card *card = NULL;
+	struct snap_action *action = NULL;
+	struct snap_job cjob;
+	struct checksum_job mjob_in, mjob_out;
+	struct timeval etime, stime;
+	unsigned int mdlen = merkle_digest_size(mode);
+	unsigned int stride = (mode == CHECKSUM_XXH3) ? mdlen :
+		CHECKSUM_HASH_SLOT_SIZE;
+	size_t i, n = merkle_leaves(size, leaf_size);
+	size_t obuff_size = 64;
+	uint8_t *obuff = NULL;
+	long long usec;
+
+	fprintf(fp, "PARAMETERS:\n"
+		"  type_in:  %x\n"
+		"  addr_in:  %016llx\n"
+		"  size:     %08lx\n"
+		"  mode:     %08x %s\n"
+		"  leaf_size: %08lx\n"
+		"  leaves:   %zd\n",
+		type_in, (long long)addr_in, size, mode,
+		checksum_mode_str[mode % CHECKSUM_MODE_MAX],
+		leaf_size, n);
+
+	if (leaves)
+		obuff_size += (n * stride + 63) & ~63ul;
+	obuff = memalign(64, obuff_size);
+	if (obuff == NULL)
+		return -1;
+
+	snprintf(device, sizeof(device)-1, "/dev/cxl/afu%d.0s", card_no);
+	card = snap_card_alloc_dev(device, SNAP_VENDOR_ID_IBM,
+				   SNAP_DEVICE_ID_SNAP);
+	if (card == NULL) {
+		fprintf(stderr, "err: failed to open card %u: %s\n",
+			card_no, strerror(errno));
+		goto out_error;
+	}
+
+	action = snap_attach_action(card, CHECKSUM_ACTION_TYPE, action_irq, 60);
+	if (action == NULL) {
+		fprintf(stderr, "err: failed to attach action %u: %s\n",
+			card_no, strerror(errno));
+		goto out_error1;
+	}
+
+	memset(&mjob_in, 0, sizeof(mjob_in));
+	mjob_in.chk_type = mode;
+	mjob_in.chk_in = seed;
+	mjob_in.hash_flags = CHECKSUM_HASH_TREE |
+		(leaves ? CHECKSUM_HASH_LEAVES : 0);
+	mjob_in.leaf_size = leaf_size;
+	snap_addr_set(&mjob_in.in, (void *)addr_in, size, type_in,
+		      SNAP_ADDRFLAG_ADDR | SNAP_ADDRFLAG_SRC);
+	snap_addr_set(&mjob_in.out, obuff, obuff_size,
+		      SNAP_ADDRTYPE_HOST_DRAM,
+		      SNAP_ADDRFLAG_ADDR | SNAP_ADDRFLAG_DST |
+		      SNAP_ADDRFLAG_END);
+	snap_job_set(&cjob, &mjob_in, sizeof(mjob_in),
+		     &mjob_out, sizeof(mjob_out));
+
+	gettimeofday(&stime, NULL);
+	rc = snap_action_sync_execute_job(action, &cjob, timeout);
+	gettimeofday(&etime, NULL);
+	if (rc != 0) {
+		fprintf(stderr, "err: job execution %d: %s!\n", rc,
+			strerror(errno));
+		goto out_error2;
+	}
+	if (cjob.retc != SNAP_RETC_SUCCESS) {
+		fprintf(stderr, "err: Unexpected RETC=%x!\n", cjob.retc);
+		goto out_error2;
+	}
+
+	usec = timediff_usec(&etime, &stime);
+	fprintf(fp, "------------------\n"
+		"RETC=%x => SUCCESS\n"
+		"CHECKSUM=%016llx\n"
+		"%lld usec, %.3f MB/s\n"
+		"------------------\n",
+		cjob.retc, (long long)mjob_out.chk_out, usec,
+		usec ? (double)size / (double)usec : 0.0);
+
+	snap_detach_action(action);
+	snap_card_free(card);
+
+	memcpy(root, obuff, mdlen);
+	for (i = 0; i < mdlen; i++)
+		printf("%02x", root[i]);
+	printf("  root\n");
+	for (i = 0; leaves && i < n; i++)
+		memcpy(leaves + i * mdlen, obuff + 64 + i * stride, mdlen);
+
+	free(obuff);
+	return 0;
+
+ out_error2:
+	snap_detach_action(action);
+ out_error1:
+	snap_card_free(card);
+ out_error:
+	free(obuff);
+	return -1;
+}
+
+/* Rebuild the tree with merkle.c, compare the root and the leaves */
+static int verify_tree(checksum_mode_t mode, uint64_t seed,
+		       const uint8_t *buf, size_t size, size_t leaf_size,
+		       const uint8_t *root, const uint8_t *leaves)
+{
+	unsigned int mdlen = merkle_digest_size(mode);
+	size_t i, n = merkle_leaves(size, leaf_size);
+	uint8_t *md;
+	int rc = 0;
+
+	md = malloc(n * mdlen);
+	if (md == NULL)
+		return EX_MEMORY;
+
+	for (i = 0; i < n; i++)
+		merkle_leaf(mode, seed, buf + i * leaf_size,
+			    MIN(leaf_size, size - i * leaf_size),
+			    md + i * mdlen);
+
+	for (i = 0; leaves && i < n && rc == 0; i++)
+		if (memcmp(md + i * mdlen, leaves + i * mdlen, mdlen) != 0) {
+			fprintf(stderr, "err: %s leaf %zd digest mismatch!\n",
+				checksum_mode_str[mode], i);
+			rc = EX_ERR_VERIFY;
+		}
+
+	merkle_reduce(mode, seed, md, n, mdlen);
+	if (rc == 0 && memcmp(md, root, mdlen) != 0) {
+		fprintf(stderr, "err: %s root mismatch!\n",
+			checksum_mode_str[mode]);
+		rc = EX_ERR_VERIFY;
+	} else if (rc == 0)
+		fprintf(stderr, "host %s: root of %zd leaves OK\n",
+			checksum_mode_str[mode], n);
+
+	free(md);
+	return rc;
+}
+
+static void host_hash(checksum_mode_t mode, const uint8_t *buf,
+		      size_t size, uint8_t *md, unsigned int digest_size)
+{
+	sha3_ctx_t ctx;
+
+	if (is_shake(mode)) {
+		sha3_init(&ctx, hash_mdlen(mode));
+		shake_update(&ctx, buf, size);
+		shake_xof(&ctx);
+		shake_out(&ctx, md, digest_size);
+	} else
+		sha3(buf, size, md, digest_size);
+}
+
+/* Recompute the digest with sha3.c and compare */
+static int verify_hash(checksum_mode_t mode, const uint8_t *buf,
+		       size_t size, const uint8_t *digest,
+		       unsigned int digest_size)
+{
+	uint8_t *expected;
+	int rc = 0;
+
+	expected = malloc(digest_size);
+	if (expected == NULL)
+		return EX_MEMORY;
+
+	host_hash(mode, buf, size, expected, digest_size);
+
+	if (memcmp(expected, digest, digest_size) != 0) {
+		fprintf(stderr, "err: %s digest mismatch!\n",
+			checksum_mode_str[mode]);
+		rc = EX_ERR_VERIFY;
+	} else
+		fprintf(stderr, "host %s: digest OK\n",
+			checksum_mode_str[mode]);
+
+	free(expected);
+	return rc;
+}
+
+/*
+ * Recompute the CRC or XXH3 hash on the host and compare it with what
+ * the action returned. Other modes are not checked.
+ */
+static int verify_checksum(checksum_mode_t mode, uint64_t checksum_start,
+			   const uint8_t *buf, size_t size, uint64_t checksum)
+{
+	uint64_t expected;
+	const char *impl = crc32_impl_str(crc32_get_impl());
+	struct timeval etime, stime;
+
+	gettimeofday(&stime, NULL);
+	switch (mode) {
+	case CHECKSUM_CRC32:
+		expected = crc32_ieee(checksum_start, buf, size);
+		break;
+	case CHECKSUM_CRC32C:
+		expected = crc32c(checksum_start, buf, size);
+		break;
+	case CHECKSUM_XXH3:
+		expected = xxh3_64(buf, size, checksum_start);
+		impl = "xxh3.c";
+		break;
+	default:
+		fprintf(stderr, "warn: Verification works currently "
+			"only for CRC32, CRC32C and XXH3\n");
+		return 0;
+	}
+	gettimeofday(&etime, NULL);
+
+	fprintf(stderr, "host %s (%s): %08llx %lld usec\n",
+		checksum_mode_str[mode], impl, (long long)expected,
+		(long long)timediff_usec(&etime, &stime));
+
+	if (expected != checksum) {
+		fprintf(stderr, "err: checksum mismatch card %016llx "
+			"host %08llx!\n", (long long)checksum,
+			(long long)expected);
+		return EX_ERR_CRC;
+	}
+	return 0;
+}
+
+/*
+ * Same for the Keccak-f implementations in sha3.c: random messages
+ * hashed with each one must give the digest of the reference loop.
+ */
+static int test_sha3(checksum_mode_t mode, uint8_t *buf, size_t size)
+{
+	sha3_impl_t impl, saved = sha3_get_impl();
+	unsigned int mdlen = hash_mdlen(mode);
+	uint8_t ref[64], val[64];
+	size_t offs, len;
+	struct timeval etime, stime;
+	long long usec;
+	unsigned int i;
+	int rc = 0;
+
+	srand(0x1234);
+	for (i = 0; i < size; i++)
+		buf[i] = rand();
+
+	for (impl = SHA3_IMPL_REF; impl < SHA3_IMPL_MAX; impl++) {
+		for (i = 0; i < 200 && rc == 0; i++) {
+			offs = (size > 64) ? (size_t)rand() % 64 : 0;
+			len = (i < 100) ? i * 7 : (size_t)rand() % 16384;
+			len = MIN(len, size - offs);
+
+			sha3_set_impl(SHA3_IMPL_REF);
+			host_hash(mode, buf + offs, len, ref, mdlen);
+			sha3_set_impl(impl);
+			host_hash(mode, buf + offs, len, val, mdlen);
+			if (memcmp(val, ref, mdlen) != 0) {
+				fprintf(stderr, "err: %s %s offs=%zd len=%zd: "
+					"digest mismatch\n",
+					checksum_mode_str[mode],
+					sha3_impl_str(impl), offs, len);
+				rc = EX_ERR_VERIFY;
+			}
+		}
+
+		sha3_set_impl(impl);
+		gettimeofday(&stime, NULL);
+		host_hash(mode, buf, size, val, mdlen);
+		gettimeofday(&etime, NULL);
+		usec = timediff_usec(&etime, &stime);
+		fprintf(stderr, "  %-8s %02x%02x%02x%02x... %8lld usec "
+			"%8.3f MB/s %s\n", sha3_impl_str(impl),
+			val[0], val[1], val[2], val[3], usec,
+			usec ? (double)size / (double)usec : 0.0,
+			impl == saved ? "(default)" : "");
+	}
+
+	sha3_set_impl(saved);
+	return rc;
+}
+
+/*
+ * Check all host CRC implementations against the byte-at-a-time
+ * reference, using random lengths and alignments, and measure their
+ * throughput on the whole buffer.
+ */
+static int test_crc32(checksum_mode_t mode, uint8_t *buf, size_t size)
+{
+	uint32_t (*crc)(uint32_t, const void *, size_t);
+	crc32_impl_t impl, saved = crc32_get_impl();
+	uint32_t ref, val, start;
+	size_t offs, len;
+	struct timeval etime, stime;
+	long long usec;
+	unsigned int i;
+	int rc = 0;
+
+	crc = (mode == CHECKSUM_CRC32C) ? crc32c : crc32_ieee;
+	srand(0x1234);
+	for (i = 0; i < size; i++)
+		buf[i] = rand();
+
+	for (impl = CRC32_IMPL_BYTE; impl < CRC32_IMPL_MAX; impl++) {
+		if (!crc32_impl_available(impl)) {
+			fprintf(stderr, "  %-7s not available\n",
+				crc32_impl_str(impl));
+			continue;
+		}
+		for (i = 0; i < 1000; i++) {
+			offs = (size > 64) ? (size_t)rand() % 64 : 0;
+			len = (i < 256) ? i : (size_t)rand() % 16384;
+			len = MIN(len, size - offs);
+			start = rand();
+
+			crc32_set_impl(CRC32_IMPL_BYTE);
+			ref = crc(start, buf + offs, len);
+			crc32_set_impl(impl);
+			val = crc(start, buf + offs, len);
+			if (val != ref) {
+				fprintf(stderr, "err: %s %s offs=%zd len=%zd: "
+					"%08x expected %08x\n",
+					checksum_mode_str[mode],
+					crc32_impl_str(impl), offs, len,
+					val, ref);
+				rc = EX_ERR_CRC;
+				break;
+			}
+		}
+
+		crc32_set_impl(impl);
+		gettimeofday(&stime, NULL);
+		val = crc(0, buf, size);
+		gettimeofday(&etime, NULL);
+		usec = timediff_usec(&etime, &stime);
+		fprintf(stderr, "  %-7s %08x %8lld usec %8.3f MB/s %s\n",
+			crc32_impl_str(impl), val, usec,
+			usec ? (double)size / (double)usec : 0.0,
+			impl == saved ? "(default)" : "");
+	}
+
+	crc32_set_impl(saved);
+
+	/* Merging the CRCs of two pieces must give the CRC of the whole */
+	for (i = 0; i < 1000 && rc == 0; i++) {
+		offs = (i < 64) ? i : (size_t)rand() % (size + 1);
+		offs = MIN(offs, size);
+		start = rand();
+
+		ref = crc(start, buf, size);
+		val = crc(start, buf, offs);
+		if (mode == CHECKSUM_CRC32C)
+			val = crc32c_combine(val, crc(0, buf + offs,
+					     size - offs), size - offs);
+		else
+			val = crc32_ieee_combine(val, crc(0, buf + offs,
+						 size - offs), size - offs);
+		if (val != ref) {
+			fprintf(stderr, "err: %s combine at %zd: %08x "
+				"expected %08x\n", checksum_mode_str[mode],
+				offs, val, ref);
+			rc = EX_ERR_CRC;
+		}
+	}
+	return rc;
+}
+
+/*
+ * XXH3 results from the xxHash library for the first len bytes of
+ * the pattern in test_xxh3().
+ */
+static const struct {
+	unsigned int len;
+	uint64_t seed;
+	uint64_t hash;
+} xxh3_kat[] = {
+	{    0, 0x0000000000000000ull, 0x2d06800538d394c2ull },
+	{    0, 0x123456789abcdef0ull, 0x8aa56c2c3d8317f6ull },
+	{    1, 0x0000000000000000ull, 0x13e608bc156defedull },
+	{    1, 0x123456789abcdef0ull, 0x248da794ce114825ull },
+	{    3, 0x0000000000000000ull, 0x7a241cd186d86429ull },
+	{    3, 0x123456789abcdef0ull, 0xefbb447381a84383ull },
+	{    4, 0x0000000000000000ull, 0xee63e61db2240dfdull },
+	{    4, 0x123456789abcdef0ull, 0xdd2ecb0701b2ad16ull },
+	{    8, 0x0000000000000000ull, 0xc79bde02ac2c4070ull },
+	{    8, 0x123456789abcdef0ull, 0xfe77db55d1ab4a58ull },
+	{    9, 0x0000000000000000ull, 0xf0fe029643147ba0ull },
+	{    9, 0x123456789abcdef0ull, 0xa6f856c940dc333dull },
+	{   16, 0x0000000000000000ull, 0x3fb07c03792d802cull },
+	{   16, 0x123456789abcdef0ull, 0x455813bf6ff1aa63ull },
+	{   17, 0x0000000000000000ull, 0xb7166a1157e2e64bull },
+	{   17, 0x123456789abcdef0ull, 0xef5a574ae6a2accbull },
+	{  128, 0x0000000000000000ull, 0x07777867b1a4f190ull },
+	{  128, 0x123456789abcdef0ull, 0xc6fffc53273ec02eull },
+	{  129, 0x0000000000000000ull, 0x767a4eb58d3d27e9ull },
+	{  129, 0x123456789abcdef0ull, 0x63cb3aca29f2e479ull },
+	{  240, 0x0000000000000000ull, 0xe544ded3a6e1802aull },
+	{  240, 0x123456789abcdef0ull, 0x134cbb91565bd4aeull },
+	{  241, 0x0000000000000000ull, 0x5a0e42cf41af9a05ull },
+	{  241, 0x123456789abcdef0ull, 0xaeb3bd2ea6eba6f3ull },
+	{ 1024, 0x0000000000000000ull, 0x357fdbb193091875ull },
+	{ 1024, 0x123456789abcdef0ull, 0x4a01065f76782fe9ull },
+	{ 2048, 0x0000000000000000ull, 0xfded4151202b36b6ull },
+	{ 2048, 0x123456789abcdef0ull, 0x7e2db8e097859461ull },
+};
+
+/*
+ * Check xxh3.c against the known answers, on all alignments and
+ * against itself on random lengths, and time it on the whole buffer.
+ */
+static int test_xxh3(uint8_t *buf, size_t size)
+{
+	static uint8_t pat[2048 + 64];
+	struct timeval etime, stime;
+	uint64_t h, ref;
+	size_t offs, len;
+	long long usec;
+	unsigned int i, a;
+	int rc = 0;
+
+	for (a = 0; a < 64 && rc == 0; a++) {
+		for (i = 0; i < 2048; i++)
+			pat[a + i] = (uint8_t)((i * 131 + 7) >> 1);
+		for (i = 0; i < ARRAY_SIZE(xxh3_kat); i++) {
+			h = xxh3_64(pat + a, xxh3_kat[i].len,
+				    xxh3_kat[i].seed);
+			if (h != xxh3_kat[i].hash) {
+				fprintf(stderr, "err: XXH3 len=%d seed=%016llx "
+					"align=%d: %016llx expected %016llx\n",
+					xxh3_kat[i].len,
+					(long long)xxh3_kat[i].seed, a,
+					(long long)h,
+					(long long)xxh3_kat[i].hash);
+				rc = EX_ERR_CRC;
+				break;
+			}
+		}
+	}
+
+	srand(0x1234);
+	for (i = 0; i < size; i++)
+		buf[i] = rand();
+
+	/* Same data at another address must give the same hash */
+	for (i = 0; i < 1000 && rc == 0 && size > 64; i++) {
+		len = (i < 512) ? i : (size_t)rand() % 16384;
+		len = MIN(len, size - 64);
+		offs = 1 + (size_t)rand() % 63;
+		ref = xxh3_64(buf, len, i);
+		memmove(buf + offs, buf, len);
+		h = xxh3_64(buf + offs, len, i);
+		memmove(buf, buf + offs, len);
+		if (h != ref) {
+			fprintf(stderr, "err: XXH3 offs=%zd len=%zd: %016llx "
+				"expected %016llx\n", offs, len,
+				(long long)h, (long long)ref);
+			rc = EX_ERR_CRC;
+		}
+	}
+
+	gettimeofday(&stime, NULL);
+	h = xxh3_64(buf, size, 0);
+	gettimeofday(&etime, NULL);
+	usec = timediff_usec(&etime, &stime);
+	fprintf(stderr, "  xxh3.c  %016llx %8lld usec %8.3f MB/s\n",
+		(long long)h, usec,
+		usec ? (double)size / (double)usec : 0.0);
+	return rc;
+}
 
 /**
  * Read accelerator specific registers. Must be called as root!
@@ -288,19 +1319,31 @@ static int do_checksum(int card_no, unsigned long timeout,
 int main(int argc, char *argv[])
 {
 	int ch, rc = 0;
+	int exit_code = EXIT_SUCCESS;
 	int card_no = 0;
 	const char *input = NULL;
 	unsigned long timeout = 60 * 60 * 60; /* 60h for SPONGE */
 	const char *space = "CARD_RAM";
 	ssize_t size = 1024 * 1024;
 	uint8_t *ibuff = NULL;
+	const uint8_t *vbuf = NULL;
 	unsigned int page_size = sysconf(_SC_PAGESIZE);
 	uint8_t type_in = SNAP_ADDRTYPE_HOST_DRAM;
 	uint64_t addr_in = 0x0ull;
 	int mode = CHECKSUM_CRC32;
 	uint64_t checksum_start = 0ull;
+	int checksum_start_set = 0;
 	uint32_t test_choice = CHECKSUM_SPEED, nb_elmts = 0, freq = 1;
 	int test = 0;
+	int verify = 0;
+	uint64_t checksum = 0ull;
+	unsigned long block_size = 0;
+	unsigned int nmsg = 0;
+	unsigned int nchunks = 0;
+	unsigned long leaf_size = 0;
+	unsigned int digest_size = 0;
+	uint8_t *digest = NULL;
+	const char *output = NULL;
 	unsigned int threads = 160;
 	snap_action_flag_t action_irq = 0;
 
@@ -317,6 +1360,13 @@ int main(int argc, char *argv[])
 			{ "mode",	 required_argument, NULL, 'm' },
 			{ "timeout",	 required_argument, NULL, 't' },
 			{ "test",	 no_argument,       NULL, 'T' },
+			{ "verify",	 no_argument,       NULL, 'X' },
+			{ "digest-size", required_argument, NULL, 'd' },
+			{ "block-size",	 required_argument, NULL, 'b' },
+			{ "output",	 required_argument, NULL, 'o' },
+			{ "batch",	 required_argument, NULL, 'B' },
+			{ "jobs",	 required_argument, NULL, 'j' },
+			{ "leaf-size",	 required_argument, NULL, 'L' },
 			{ "test_choice", required_argument, NULL, 'c' },
 			{ "nb_elmts",    required_argument, NULL, 'n' },
 			{ "freq",	 required_argument, NULL, 'f' },
@@ -328,7 +1378,7 @@ int main(int argc, char *argv[])
 		};
 
 		ch = getopt_long(argc, argv,
-				 "A:C:i:a:S:Tx:c:n:f:m:s:t:x:VqvhI",
+				 "A:C:i:a:S:TXx:c:n:f:m:s:t:x:d:b:o:B:j:L:VqvhI",
 				 long_options, &option_index);
 		if (ch == -1)
 			break;
@@ -348,10 +1398,32 @@ int main(int argc, char *argv[])
 			break;
 		case 'S':
 			checksum_start = __str_to_num(optarg);
+			checksum_start_set = 1;
 			break;
 		case 'T':
 			test++;
 			break;
+		case 'X':
+			verify++;
+			break;
+		case 'd':
+			digest_size = __str_to_num(optarg);
+			break;
+		case 'b':
+			block_size = __str_to_num(optarg);
+			break;
+		case 'o':
+			output = optarg;
+			break;
+		case 'B':
+			nmsg = strtol(optarg, (char **)NULL, 0);
+			break;
+		case 'j':
+			nchunks = strtol(optarg, (char **)NULL, 0);
+			break;
+		case 'L':
+			leaf_size = __str_to_num(optarg);
+			break;
 		case 'c':
 			if (strcmp(optarg, "SPEED") == 0) {
 				test_choice = CHECKSUM_SPEED;
@@ -381,19 +1453,11 @@ int main(int argc, char *argv[])
 			timeout = strtol(optarg, (char **)NULL, 0);
 			break;
 		case 'm':
-			if (strcmp(optarg, "CRC32") == 0) {
-				mode = CHECKSUM_CRC32;
-				break;
-			}
-			if (strcmp(optarg, "ADLER32") == 0) {
-				mode = CHECKSUM_ADLER32;
-				break;
-			}
-			if (strcmp(optarg, "SPONGE") == 0) {
-				mode = CHECKSUM_SPONGE;
-				break;
-			}
-			mode = strtol(optarg, (char **)NULL, 0);
+			for (mode = 0; mode < CHECKSUM_MODE_MAX; mode++)
+				if (strcmp(optarg, checksum_mode_str[mode]) == 0)
+					break;
+			if (mode == CHECKSUM_MODE_MAX)
+				mode = strtol(optarg, (char **)NULL, 0);
 			break;
 			/* input data */
 		case 'A':
@@ -402,6 +1466,12 @@ int main(int argc, char *argv[])
 				type_in = SNAP_ADDRTYPE_CARD_DRAM;
 			else if (strcmp(space, "HOST_DRAM") == 0)
 				type_in = SNAP_ADDRTYPE_HOST_DRAM;
+			else if (strcmp(space, "NVME") == 0)
+				type_in = SNAP_ADDRTYPE_NVME;
+			else if (strcmp(space, "NVME1") == 0) {
+				type_in = SNAP_ADDRTYPE_NVME;
+				flags_in = SNAP_ADDRFLAG_DRIVE1;
+			}
 			break;
 		case 'a':
 			addr_in = strtol(optarg, (char **)NULL, 0);
@@ -431,6 +1501,10 @@ int main(int argc, char *argv[])
 		exit(EXIT_FAILURE);
 	}
 
+	/* Adler-32 of an empty buffer is 1, not 0 like for the CRCs */
+	if ((mode == CHECKSUM_ADLER32) && !checksum_start_set)
+		checksum_start = 1;
+
 	/* if input file is defined, use that as input */
 	if (input != NULL) {
 		size = file_size(input);
@@ -449,32 +1523,220 @@ int main(int argc, char *argv[])
 		if (rc < 0)
 			goto out_error1;
 
-		type_in = SNAP_ADDRTYPE_HOST_DRAM;
-		addr_in = (unsigned long)ibuff;
+		if (type_in == SNAP_ADDRTYPE_CARD_DRAM) {
+			/* ibuff stays as the host copy for -X */
+			if (card_load(card_no, addr_in, ibuff, size) != 0)
+				goto out_error1;
+		} else {
+			type_in = SNAP_ADDRTYPE_HOST_DRAM;
+			addr_in = (unsigned long)ibuff;
+			flags_in = 0;
+		}
+	}
+
+	/* The data to verify against, on the host */
+	if (type_in == SNAP_ADDRTYPE_HOST_DRAM)
+		vbuf = (const uint8_t *)(unsigned long)addr_in;
+	else if (type_in == SNAP_ADDRTYPE_CARD_DRAM)
+		vbuf = ibuff;
+
+	/* The drive is streamed in one job, for the CRCs and Adler-32 only */
+	if (type_in == SNAP_ADDRTYPE_NVME &&
+	    ((mode != CHECKSUM_CRC32 && mode != CHECKSUM_CRC32C &&
+	      mode != CHECKSUM_ADLER32) || nchunks || block_size || test)) {
+		fprintf(stderr, "err: NVME input only for single CRC32, "
+			"CRC32C or ADLER32 jobs\n");
+		goto out_error1;
 	}
 
 	if (test) {
 		switch (mode) {
+		case CHECKSUM_CRC32:
+		case CHECKSUM_CRC32C:
+			if (ibuff == NULL) {
+				ibuff = memalign(page_size, size);
+				if (ibuff == NULL)
+					goto out_error;
+			}
+			exit_code = test_crc32(mode, ibuff, size);
+			break;
+		case CHECKSUM_SHA3_224:
+		case CHECKSUM_SHA3_256:
+		case CHECKSUM_SHA3_384:
+		case CHECKSUM_SHA3_512:
+		case CHECKSUM_SHAKE128:
+		case CHECKSUM_SHAKE256:
+			if (ibuff == NULL) {
+				ibuff = memalign(page_size, size);
+				if (ibuff == NULL)
+					goto out_error;
+			}
+			exit_code = test_sha3(mode, ibuff, size);
+			break;
+		case CHECKSUM_XXH3:
+			if (ibuff == NULL) {
+				ibuff = memalign(page_size, size);
+				if (ibuff == NULL)
+					goto out_error;
+			}
+			exit_code = test_xxh3(ibuff, size);
+			break;
 		default:
 			goto out_error1;
 		}
+	} else if (leaf_size) {
+		size_t n = merkle_leaves(size, leaf_size);
+		int want_leaves = verify || output != NULL;
+
+		digest_size = merkle_digest_size(mode);
+		if (digest_size == 0) {
+			fprintf(stderr, "err: no Merkle tree for %s\n",
+				checksum_mode_str[mode % CHECKSUM_MODE_MAX]);
+			goto out_error1;
+		}
+		digest = malloc(digest_size * (n + 1));
+		if (digest == NULL)
+			goto out_error1;
+
+		rc = do_hash_tree(card_no, timeout, addr_in, type_in, size,
+				  mode, checksum_start, leaf_size, digest,
+				  want_leaves ? digest + digest_size : NULL,
+				  stderr, action_irq);
+		if (rc != 0)
+			goto out_error1;
+
+		if (output != NULL) {
+			rc = file_write(output, digest + digest_size,
+					digest_size * n);
+			if (rc < 0)
+				goto out_error1;
+		}
+		if (verify && vbuf == NULL)
+			fprintf(stderr, "warn: Verification needs HOST_DRAM "
+				"or an input file\n");
+		else if (verify)
+			exit_code = verify_tree(mode, checksum_start, vbuf,
+						size, leaf_size, digest,
+						digest + digest_size);
+	} else if (mode == CHECKSUM_XXH3 && nmsg) {
+		unsigned int i;
+		unsigned long start, end;
+		uint64_t h;
+
+		digest_size = sizeof(uint64_t);
+		digest = malloc(digest_size * nmsg);
+		if (digest == NULL)
+			goto out_error1;
+
+		rc = do_hash_batch(card_no, timeout, addr_in, type_in, size,
+				   mode, checksum_start, nmsg, digest,
+				   digest_size, stderr, action_irq);
+		if (rc != 0)
+			goto out_error1;
+
+		if (output != NULL) {
+			rc = file_write(output, digest, digest_size * nmsg);
+			if (rc < 0)
+				goto out_error1;
+		}
+		if (verify && vbuf == NULL)
+			fprintf(stderr, "warn: Verification needs HOST_DRAM "
+				"or an input file\n");
+		for (i = 0; verify && vbuf != NULL &&
+			     i < nmsg && exit_code == 0; i++) {
+			start = size * i / nmsg;
+			end = size * (i + 1) / nmsg;
+			cast_uint8_to_uint64(digest + i * digest_size, &h, 1);
+			exit_code = verify_checksum(mode, checksum_start,
+					vbuf + start, end - start, h);
+		}
+	} else if (hash_mdlen(mode)) {
+		if (digest_size == 0 || !is_shake(mode))
+			digest_size = is_shake(mode) ? 2 * hash_mdlen(mode) :
+				hash_mdlen(mode);
+		if (nmsg && digest_size > CHECKSUM_HASH_SLOT_SIZE) {
+			fprintf(stderr, "err: digest size in batch mode is "
+				"limited to %d bytes\n",
+				CHECKSUM_HASH_SLOT_SIZE);
+			goto out_error1;
+		}
+		digest = malloc(digest_size * (nmsg ? nmsg : 1));
+		if (digest == NULL)
+			goto out_error1;
+
+		if (nmsg)
+			rc = do_hash_batch(card_no, timeout, addr_in, type_in,
+					   size, mode, 0, nmsg, digest,
+					   digest_size, stderr, action_irq);
+		else
+			rc = do_hash(card_no, timeout, addr_in, type_in, size,
+				     mode, block_size, digest, digest_size,
+				     stderr, action_irq);
+		if (rc != 0)
+			goto out_error1;
+
+		if (output != NULL) {
+			rc = file_write(output, digest,
+					digest_size * (nmsg ? nmsg : 1));
+			if (rc < 0)
+				goto out_error1;
+		}
+		if (verify && vbuf == NULL)
+			fprintf(stderr, "warn: Verification needs HOST_DRAM "
+				"or an input file\n");
+		else if (verify && nmsg == 0)
+			exit_code = verify_hash(mode, vbuf, size, digest,
+						digest_size);
+		else if (verify) {
+			unsigned int i;
+			unsigned long start, end;
+
+			for (i = 0; i < nmsg && exit_code == 0; i++) {
+				start = size * i / nmsg;
+				end = size * (i + 1) / nmsg;
+				exit_code = verify_hash(mode, vbuf + start,
+						end - start,
+						digest + i * digest_size,
+						digest_size);
+			}
+		}
 	} else {
-		rc = do_checksum(card_no, timeout, threads, addr_in,
-				 type_in, size, checksum_start, mode,
-				 test_choice, nb_elmts, freq, NULL, NULL, NULL,
-				 NULL, stderr, action_irq);
+		if ((nchunks || block_size) && (mode == CHECKSUM_CRC32 ||
+						mode == CHECKSUM_CRC32C))
+			rc = do_checksum_chunks(card_no, timeout, addr_in,
+						type_in, size, checksum_start,
+						mode, block_size,
+						nchunks ? nchunks : 1,
+						&checksum, stderr, action_irq);
+		else
+			rc = do_checksum(card_no, timeout, threads, addr_in,
+					 type_in, size, checksum_start, mode,
+					 test_choice, nb_elmts, freq, &checksum,
+					 NULL, NULL, NULL, stderr, action_irq);
 		if (rc != 0)
 			goto out_error1;
+
+		if (verify) {
+			if (vbuf != NULL)
+				exit_code = verify_checksum(mode,
+						checksum_start, vbuf,
+						size, checksum);
+			else
+				fprintf(stderr, "warn: Verification needs "
+					"HOST_DRAM or an input file\n");
+		}
 	}
 
 	if (ibuff)
 		free(ibuff);
+	free(digest);
 
-	exit(EXIT_SUCCESS);
+	exit(exit_code);
 
  out_error1:
 	if (ibuff)
 		free(ibuff);
+	free(digest);
  out_error:
 	exit(EXIT_FAILURE);
 }
@@ -0,0 +1,249 @@
+/*
+ * Copyright 2017 International Business Machines
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "worker_pool.h"
+
+#if defined(CONFIG_USE_NO_PTHREADS)
+
+unsigned int worker_pool_size(void)
+{
+	return 1;
+}
+
+int worker_pool_run(worker_fn_t fn, void *arg, unsigned int n,
+		    unsigned int max_workers __attribute__((unused)))
+{
+	unsigned int idx;
+
+	for (idx = 0; idx < n; idx++)
+		fn(arg, idx, 0);
+	return 0;
+}
+
+#else
+
+#include <sched.h>
+#include <dirent.h>
+#include <pthread.h>
+
+/*
+ * Indexes still to do in the slice of one worker. The owner and the
+ * thieves all take indexes with an atomic increment of next, so no
+ * index is handed out twice. One cache line each to keep the owners
+ * from disturbing each other.
+ */
+struct wp_slice {
+	unsigned int next;
+	unsigned int end;
+} __attribute__((aligned(64)));
+
+struct wp_worker {
+	pthread_t thread_id;
+	int cpu;
+	int node;
+	unsigned int *steal;	/* other workers, own node first */
+};
+
+static pthread_once_t wp_once = PTHREAD_ONCE_INIT;
+static pthread_mutex_t wp_run_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t wp_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t wp_start = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t wp_done = PTHREAD_COND_INITIALIZER;
+
+static unsigned int wp_nworkers;
+static struct wp_worker *wp_workers;
+static struct wp_slice *wp_slices;
+
+/* Current run, protected by wp_lock */
+static unsigned long wp_gen;
+static unsigned int wp_active;
+static unsigned int wp_busy;
+static worker_fn_t wp_fn;
+static void *wp_arg;
+
+static int wp_cpu_node(int cpu)
+{
+	char path[64];
+	struct dirent *e;
+	DIR *d;
+	int node = 0;
+
+	snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d", cpu);
+	d = opendir(path);
+	if (d == NULL)
+		return 0;
+
+	while ((e = readdir(d)) != NULL) {
+		if (sscanf(e->d_name, "node%d", &node) == 1)
+			break;
+	}
+	closedir(d);
+	return node;
+}
+
+static void wp_slice_work(unsigned int w, unsigned int victim)
+{
+	struct wp_slice *s = &wp_slices[victim];
+	unsigned int idx;
+
+	while ((idx = __atomic_fetch_add(&s->next, 1, __ATOMIC_RELAXED)) <
+	       s->end)
+		wp_fn(wp_arg, idx, w);
+}
+
+static void *wp_worker_main(void *data)
+{
+	unsigned int w = (unsigned int)(unsigned long)data;
+	struct wp_worker *me = &wp_workers[w];
+	unsigned long gen = 0;
+	unsigned int i, active;
+
+	while (1) {
+		pthread_mutex_lock(&wp_lock);
+		while (wp_gen == gen)
+			pthread_cond_wait(&wp_start, &wp_lock);
+		gen = wp_gen;
+		active = wp_active;
+		pthread_mutex_unlock(&wp_lock);
+
+		if (w >= active)
+			continue;
+
+		wp_slice_work(w, w);
+		for (i = 0; i < wp_nworkers - 1; i++)
+			if (me->steal[i] < active)
+				wp_slice_work(w, me->steal[i]);
+
+		pthread_mutex_lock(&wp_lock);
+		if (--wp_busy == 0)
+			pthread_cond_signal(&wp_done);
+		pthread_mutex_unlock(&wp_lock);
+	}
+	return NULL;
+}
+
+static void wp_init(void)
+{
+	cpu_set_t set, one;
+	unsigned int i, j, k, n;
+	int cpu;
+
+	CPU_ZERO(&set);
+	if (sched_getaffinity(0, sizeof(set), &set) != 0 ||
+	    CPU_COUNT(&set) == 0) {
+		CPU_ZERO(&set);
+		CPU_SET(0, &set);
+	}
+	n = CPU_COUNT(&set);
+
+	wp_workers = calloc(n, sizeof(*wp_workers));
+	wp_slices = aligned_alloc(64, n * sizeof(*wp_slices));
+	if (wp_workers == NULL || wp_slices == NULL)
+		goto out_error;
+
+	for (cpu = 0, i = 0; i < n; cpu++) {
+		if (!CPU_ISSET(cpu, &set))
+			continue;
+		wp_workers[i].cpu = cpu;
+		wp_workers[i].node = wp_cpu_node(cpu);
+		i++;
+	}
+
+	/* Steal from the next workers on the own node, then the rest */
+	for (i = 0; i < n; i++) {
+		struct wp_worker *me = &wp_workers[i];
+
+		me->steal = calloc(n, sizeof(*me->steal));
+		if (me->steal == NULL)
+			goto out_error;
+		for (k = 0, j = 1; j < n; j++)
+			if (wp_workers[(i + j) % n].node == me->node)
+				me->steal[k++] = (i + j) % n;
+		for (j = 1; j < n; j++)
+			if (wp_workers[(i + j) % n].node != me->node)
+				me->steal[k++] = (i + j) % n;
+	}
+
+	wp_nworkers = n;
+	for (i = 0; i < n; i++) {
+		if (pthread_create(&wp_workers[i].thread_id, NULL,
+				   wp_worker_main, (void *)(unsigned long)i)) {
+			fprintf(stderr, "err: starting worker %d failed!\n", i);
+			break;
+		}
+		pthread_detach(wp_workers[i].thread_id);
+
+		CPU_ZERO(&one);
+		CPU_SET(wp_workers[i].cpu, &one);
+		pthread_setaffinity_np(wp_workers[i].thread_id,
+				       sizeof(one), &one);
+	}
+	/* Workers behind the first failure are never active */
+	wp_nworkers = i;
+	return;
+
+ out_error:
+	fprintf(stderr, "err: No memory for %d workers\n", n);
+	wp_nworkers = 0;
+}
+
+unsigned int worker_pool_size(void)
+{
+	pthread_once(&wp_once, wp_init);
+	return wp_nworkers;
+}
+
+int worker_pool_run(worker_fn_t fn, void *arg, unsigned int n,
+		    unsigned int max_workers)
+{
+	unsigned int w, active;
+
+	if (worker_pool_size() == 0)
+		return -1;
+	if (n == 0)
+		return 0;
+
+	active = wp_nworkers;
+	if (max_workers && max_workers < active)
+		active = max_workers;
+	if (n < active)
+		active = n;
+
+	pthread_mutex_lock(&wp_run_lock);
+	pthread_mutex_lock(&wp_lock);
+	for (w = 0; w < active; w++) {
+		wp_slices[w].next = (unsigned long)n * w / active;
+		wp_slices[w].end = (unsigned long)n * (w + 1) / active;
+	}
+	wp_fn = fn;
+	wp_arg = arg;
+	wp_active = active;
+	wp_busy = active;
+	wp_gen++;
+	pthread_cond_broadcast(&wp_start);
+
+	while (wp_busy != 0)
+		pthread_cond_wait(&wp_done, &wp_lock);
+	pthread_mutex_unlock(&wp_lock);
+	pthread_mutex_unlock(&wp_run_lock);
+	return 0;
+}
+
+#endif /* CONFIG_USE_NO_PTHREADS */
@@ -0,0 +1,55 @@
+#ifndef __WORKER_POOL_H__
+#define __WORKER_POOL_H__
+
+/*
+ * Copyright 2017 International Business Machines
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Worker threads for the software version of the checksum action.
+ *
+ * The pool is started by the first worker_pool_run() and lives until
+ * the process exits, so short jobs do not pay for thread creation.
+ * There is one worker per CPU the process may run on, each pinned to
+ * its CPU. A run splits the index range [0, n) into one slice per
+ * worker; a worker which is done with its slice steals indexes from
+ * the others, first from workers on its own NUMA node.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Called once per index, worker is 0 ... worker_pool_size() - 1 */
+typedef void (*worker_fn_t)(void *arg, unsigned int idx,
+			    unsigned int worker);
+
+/*
+ * Call fn(arg, idx, worker) for all idx in [0, n) on at most
+ * max_workers workers (0: all) and wait until all calls are done.
+ * Runs from different threads are serialized. Returns 0 or -1 if the
+ * pool could not be started.
+ */
+int worker_pool_run(worker_fn_t fn, void *arg, unsigned int n,
+		    unsigned int max_workers);
+
+/* Number of workers, starts the pool if needed, 0 on error */
+unsigned int worker_pool_size(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif	/* __WORKER_POOL_H__ */
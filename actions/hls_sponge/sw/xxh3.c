@@ -0,0 +1,321 @@
+/*
+ * Copyright 2017 International Business Machines
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * XXH3, 64 bit output, after the description of the xxHash library by
+ * Yann Collet (BSD 2-Clause). Inputs up to 240 bytes take the short
+ * paths, longer ones run through eight 64 bit accumulators, one 64 byte
+ * stripe at a time. The accumulators are kept in two vectors of four
+ * lanes; on x86 an AVX2 clone of that loop is picked at load time.
+ */
+
+#include <string.h>
+
+#include "xxh3.h"
+
+#define XXH_PRIME32_1	0x9E3779B1U
+#define XXH_PRIME32_2	0x85EBCA77U
+#define XXH_PRIME32_3	0xC2B2AE3DU
+#define XXH_PRIME64_1	0x9E3779B185EBCA87ULL
+#define XXH_PRIME64_2	0xC2B2AE3D27D4EB4FULL
+#define XXH_PRIME64_3	0x165667B19E3779F9ULL
+#define XXH_PRIME64_4	0x85EBCA77C2B2AE63ULL
+#define XXH_PRIME64_5	0x27D4EB2F165667C5ULL
+#define XXH_PRIME_MX1	0x165667919E3779F9ULL
+#define XXH_PRIME_MX2	0x9FB21C651E98DF25ULL
+
+#define XXH_SECRET_SIZE		192
+#define XXH_STRIPE_LEN		64
+#define XXH_STRIPES_PER_BLOCK	((XXH_SECRET_SIZE - XXH_STRIPE_LEN) / 8)
+#define XXH_BLOCK_LEN		(XXH_STRIPE_LEN * XXH_STRIPES_PER_BLOCK)
+#define XXH_LASTACC_START	7
+#define XXH_MERGEACCS_START	11
+#define XXH_MIDSIZE_START	3
+#define XXH_MIDSIZE_LAST	17
+
+#if defined(__x86_64__)
+#define XXH3_CLONES __attribute__((target_clones("avx2", "default")))
+#else
+#define XXH3_CLONES
+#endif
+
+typedef uint64_t v4u64_t __attribute__((vector_size(32)));
+
+static const uint8_t xxh3_secret[XXH_SECRET_SIZE] = {
+	0xb8, 0xfe, 0x6c, 0x39, 0x23, 0xa4, 0x4b, 0xbe,
+	0x7c, 0x01, 0x81, 0x2c, 0xf7, 0x21, 0xad, 0x1c,
+	0xde, 0xd4, 0x6d, 0xe9, 0x83, 0x90, 0x97, 0xdb,
+	0x72, 0x40, 0xa4, 0xa4, 0xb7, 0xb3, 0x67, 0x1f,
+	0xcb, 0x79, 0xe6, 0x4e, 0xcc, 0xc0, 0xe5, 0x78,
+	0x82, 0x5a, 0xd0, 0x7d, 0xcc, 0xff, 0x72, 0x21,
+	0xb8, 0x08, 0x46, 0x74, 0xf7, 0x43, 0x24, 0x8e,
+	0xe0, 0x35, 0x90, 0xe6, 0x81, 0x3a, 0x26, 0x4c,
+	0x3c, 0x28, 0x52, 0xbb, 0x91, 0xc3, 0x00, 0xcb,
+	0x88, 0xd0, 0x65, 0x8b, 0x1b, 0x53, 0x2e, 0xa3,
+	0x71, 0x64, 0x48, 0x97, 0xa2, 0x0d, 0xf9, 0x4e,
+	0x38, 0x19, 0xef, 0x46, 0xa9, 0xde, 0xac, 0xd8,
+	0xa8, 0xfa, 0x76, 0x3f, 0xe3, 0x9c, 0x34, 0x3f,
+	0xf9, 0xdc, 0xbb, 0xc7, 0xc7, 0x0b, 0x4f, 0x1d,
+	0x8a, 0x51, 0xe0, 0x4b, 0xcd, 0xb4, 0x59, 0x31,
+	0xc8, 0x9f, 0x7e, 0xc9, 0xd9, 0x78, 0x73, 0x64,
+	0xea, 0xc5, 0xac, 0x83, 0x34, 0xd3, 0xeb, 0xc3,
+	0xc5, 0x81, 0xa0, 0xff, 0xfa, 0x13, 0x63, 0xeb,
+	0x17, 0x0d, 0xdd, 0x51, 0xb7, 0xf0, 0xda, 0x49,
+	0xd3, 0x16, 0x55, 0x26, 0x29, 0xd4, 0x68, 0x9e,
+	0x2b, 0x16, 0xbe, 0x58, 0x7d, 0x47, 0xa1, 0xfc,
+	0x8f, 0xf8, 0xb8, 0xd1, 0x7a, 0xd0, 0x31, 0xce,
+	0x45, 0xcb, 0x3a, 0x8f, 0x95, 0x16, 0x04, 0x28,
+	0xaf, 0xd7, 0xfb, 0xca, 0xbb, 0x4b, 0x40, 0x7e,
+};
+
+static inline uint32_t le32(const uint8_t *p)
+{
+	return (uint32_t)p[0] | (uint32_t)p[1] << 8 |
+		(uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static inline uint64_t le64(const uint8_t *p)
+{
+	return (uint64_t)le32(p) | (uint64_t)le32(p + 4) << 32;
+}
+
+static inline void put_le64(uint8_t *p, uint64_t v)
+{
+	int i;
+
+	for (i = 0; i < 8; i++)
+		p[i] = (uint8_t)(v >> (8 * i));
+}
+
+static inline uint64_t rotl64(uint64_t x, int r)
+{
+	return (x << r) | (x >> (64 - r));
+}
+
+/* Low and high half of the 128 bit product, xored */
+static inline uint64_t mul128_fold64(uint64_t a, uint64_t b)
+{
+	unsigned __int128 p = (unsigned __int128)a * b;
+
+	return (uint64_t)p ^ (uint64_t)(p >> 64);
+}
+
+static uint64_t xxh64_avalanche(uint64_t h)
+{
+	h ^= h >> 33;
+	h *= XXH_PRIME64_2;
+	h ^= h >> 29;
+	h *= XXH_PRIME64_3;
+	return h ^ (h >> 32);
+}
+
+static uint64_t xxh3_avalanche(uint64_t h)
+{
+	h ^= h >> 37;
+	h *= XXH_PRIME_MX1;
+	return h ^ (h >> 32);
+}
+
+static uint64_t xxh3_rrmxmx(uint64_t h, uint64_t len)
+{
+	h ^= rotl64(h, 49) ^ rotl64(h, 24);
+	h *= XXH_PRIME_MX2;
+	h ^= (h >> 35) + len;
+	h *= XXH_PRIME_MX2;
+	return h ^ (h >> 28);
+}
+
+static uint64_t xxh3_mix16(const uint8_t *in, const uint8_t *secret,
+			   uint64_t seed)
+{
+	return mul128_fold64(le64(in) ^ (le64(secret) + seed),
+			     le64(in + 8) ^ (le64(secret + 8) - seed));
+}
+
+static uint64_t xxh3_len_0to16(const uint8_t *in, size_t len, uint64_t seed)
+{
+	const uint8_t *s = xxh3_secret;
+
+	if (len > 8) {
+		uint64_t lo = le64(in) ^ ((le64(s + 24) ^ le64(s + 32)) + seed);
+		uint64_t hi = le64(in + len - 8) ^
+			((le64(s + 40) ^ le64(s + 48)) - seed);
+
+		return xxh3_avalanche(len + __builtin_bswap64(lo) + hi +
+				      mul128_fold64(lo, hi));
+	}
+	if (len >= 4) {
+		uint64_t in64, flip;
+
+		seed ^= (uint64_t)__builtin_bswap32((uint32_t)seed) << 32;
+		flip = (le64(s + 8) ^ le64(s + 16)) - seed;
+		in64 = le32(in + len - 4) + ((uint64_t)le32(in) << 32);
+		return xxh3_rrmxmx(in64 ^ flip, len);
+	}
+	if (len > 0) {
+		uint32_t c = ((uint32_t)in[0] << 16) |
+			((uint32_t)in[len >> 1] << 24) |
+			(uint32_t)in[len - 1] | ((uint32_t)len << 8);
+
+		return xxh64_avalanche((uint64_t)c ^
+				       ((le32(s) ^ le32(s + 4)) + seed));
+	}
+	return xxh64_avalanche(seed ^ le64(s + 56) ^ le64(s + 64));
+}
+
+static uint64_t xxh3_len_17to240(const uint8_t *in, size_t len, uint64_t seed)
+{
+	const uint8_t *s = xxh3_secret;
+	uint64_t acc = len * XXH_PRIME64_1;
+	size_t i, nrounds;
+
+	if (len <= 128) {
+		if (len > 32) {
+			if (len > 64) {
+				if (len > 96) {
+					acc += xxh3_mix16(in + 48, s + 96, seed);
+					acc += xxh3_mix16(in + len - 64, s + 112,
+							  seed);
+				}
+				acc += xxh3_mix16(in + 32, s + 64, seed);
+				acc += xxh3_mix16(in + len - 48, s + 80, seed);
+			}
+			acc += xxh3_mix16(in + 16, s + 32, seed);
+			acc += xxh3_mix16(in + len - 32, s + 48, seed);
+		}
+		acc += xxh3_mix16(in, s, seed);
+		acc += xxh3_mix16(in + len - 16, s + 16, seed);
+		return xxh3_avalanche(acc);
+	}
+
+	nrounds = len / 16;
+	for (i = 0; i < 8; i++)
+		acc += xxh3_mix16(in + 16 * i, s + 16 * i, seed);
+	acc = xxh3_avalanche(acc);
+	for (i = 8; i < nrounds; i++)
+		acc += xxh3_mix16(in + 16 * i, s + 16 * (i - 8) +
+				  XXH_MIDSIZE_START, seed);
+	acc += xxh3_mix16(in + len - 16, s + 136 - XXH_MIDSIZE_LAST, seed);
+	return xxh3_avalanche(acc);
+}
+
+static inline void xxh3_load(v4u64_t *v, const uint8_t *p)
+{
+	memcpy(v, p, sizeof(*v));
+#if __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+	*v = (v4u64_t){ __builtin_bswap64((*v)[0]), __builtin_bswap64((*v)[1]),
+			__builtin_bswap64((*v)[2]), __builtin_bswap64((*v)[3]) };
+#endif
+}
+
+/*
+ * acc[i ^ 1] += data[i], acc[i] += lo32(data[i] ^ key[i]) *
+ * hi32(data[i] ^ key[i]) for the eight lanes of a stripe. Stripe n
+ * of a block uses the secret from byte 8 * n on.
+ */
+static inline void xxh3_stripe(v4u64_t acc[2], const uint8_t *in,
+			       const uint8_t *secret)
+{
+	const v4u64_t swap = { 1, 0, 3, 2 };
+	v4u64_t d, k;
+	int h;
+
+	for (h = 0; h < 2; h++) {
+		xxh3_load(&d, in + 32 * h);
+		xxh3_load(&k, secret + 32 * h);
+		k ^= d;
+		acc[h] += __builtin_shuffle(d, swap) +
+			(k & 0xffffffff) * (k >> 32);
+	}
+}
+
+static inline void xxh3_scramble(v4u64_t acc[2], const uint8_t *secret)
+{
+	v4u64_t k;
+	int h;
+
+	for (h = 0; h < 2; h++) {
+		xxh3_load(&k, secret + 32 * h);
+		acc[h] ^= acc[h] >> 47;
+		acc[h] ^= k;
+		acc[h] *= XXH_PRIME32_1;
+	}
+}
+
+XXH3_CLONES
+static void xxh3_long_loop(v4u64_t acc[2], const uint8_t *in, size_t len,
+			   const uint8_t *secret)
+{
+	size_t nblocks = (len - 1) / XXH_BLOCK_LEN;
+	size_t n, s, nstripes;
+
+	for (n = 0; n < nblocks; n++) {
+		for (s = 0; s < XXH_STRIPES_PER_BLOCK; s++)
+			xxh3_stripe(acc, in + n * XXH_BLOCK_LEN +
+				    s * XXH_STRIPE_LEN, secret + 8 * s);
+		xxh3_scramble(acc, secret + XXH_SECRET_SIZE - XXH_STRIPE_LEN);
+	}
+
+	nstripes = ((len - 1) - nblocks * XXH_BLOCK_LEN) / XXH_STRIPE_LEN;
+	for (s = 0; s < nstripes; s++)
+		xxh3_stripe(acc, in + nblocks * XXH_BLOCK_LEN +
+			    s * XXH_STRIPE_LEN, secret + 8 * s);
+
+	xxh3_stripe(acc, in + len - XXH_STRIPE_LEN, secret + XXH_SECRET_SIZE -
+		    XXH_STRIPE_LEN - XXH_LASTACC_START);
+}
+
+static uint64_t xxh3_long(const uint8_t *in, size_t len, uint64_t seed)
+{
+	uint8_t custom[XXH_SECRET_SIZE];
+	const uint8_t *secret = xxh3_secret;
+	v4u64_t acc[2] = {
+		{ XXH_PRIME32_3, XXH_PRIME64_1, XXH_PRIME64_2, XXH_PRIME64_3 },
+		{ XXH_PRIME64_4, XXH_PRIME32_2, XXH_PRIME64_5, XXH_PRIME32_1 },
+	};
+	uint64_t h;
+	int i;
+
+	/* A seed is folded into the secret, 0 uses the default one */
+	if (seed != 0) {
+		for (i = 0; i < XXH_SECRET_SIZE; i += 16) {
+			put_le64(custom + i, le64(xxh3_secret + i) + seed);
+			put_le64(custom + i + 8, le64(xxh3_secret + i + 8) - seed);
+		}
+		secret = custom;
+	}
+
+	xxh3_long_loop(acc, in, len, secret);
+
+	h = len * XXH_PRIME64_1;
+	for (i = 0; i < 4; i++)
+		h += mul128_fold64(acc[i / 2][2 * (i % 2)] ^
+				   le64(secret + XXH_MERGEACCS_START + 16 * i),
+				   acc[i / 2][2 * (i % 2) + 1] ^
+				   le64(secret + XXH_MERGEACCS_START + 16 * i + 8));
+	return xxh3_avalanche(h);
+}
+
+uint64_t xxh3_64(const void *buf, size_t len, uint64_t seed)
+{
+	const uint8_t *in = (const uint8_t *)buf;
+
+	if (len <= 16)
+		return xxh3_len_0to16(in, len, seed);
+	if (len <= 240)
+		return xxh3_len_17to240(in, len, seed);
+	return xxh3_long(in, len, seed);
+}
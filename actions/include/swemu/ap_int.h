@@ -0,0 +1,289 @@
+#ifndef __SWEMU_AP_INT_H__
+#define __SWEMU_AP_INT_H__
+
+/*
+ * Copyright 2017 International Business Machines
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Arbitrary width integers for building HLS actions without Vivado,
+ * used by the software emulation (see hls_snap_swemu.H) when
+ * XILINX_VIVADO is not set. Only what the SNAP actions use is there:
+ * ap_uint<W> with arithmetic, shifts, compares, range and bit access.
+ * ap_int<W> stores the same bits and sign extends on conversion, its
+ * operators are the unsigned ones. Results of binary operators are
+ * as wide as in Vivado: a sum or difference one bit wider than the
+ * wider operand, a product as wide as both, the others as wide as the
+ * wider operand. An integer operand is as wide as its type. A signed
+ * difference is the same bits as in Vivado, but compares unsigned.
+ */
+
+#include <stdint.h>
+#include <type_traits>
+#include <cassert>
+
+template<int W> struct ap_uint;
+template<int W> struct ap_int;
+
+template<int W> struct ap_range_ref;
+template<int W> struct ap_bit_ref;
+
+template<int W>
+struct ap_uint {
+	enum { N = (W + 63) / 64 };
+	uint64_t v[N];
+
+	void norm() {
+		if (W % 64) v[N-1] &= (~0ULL >> (64 - W % 64));
+	}
+	void clr() { for (int i = 0; i < N; i++) v[i] = 0; }
+	void from_u64(uint64_t x, bool sext = false) {
+		v[0] = x;
+		for (int i = 1; i < N; i++) v[i] = sext ? ~0ULL : 0;
+		norm();
+	}
+	ap_uint() { clr(); }
+	template<typename T, typename std::enable_if<std::is_integral<T>::value, int>::type = 0>
+	ap_uint(T x) { from_u64((uint64_t)(int64_t)x, std::is_signed<T>::value && (int64_t)x < 0); }
+	ap_uint(double x) { from_u64((uint64_t)x); }
+	template<int W2> ap_uint(const ap_uint<W2> &o) {
+		clr();
+		for (int i = 0; i < N && i < ap_uint<W2>::N; i++) v[i] = o.v[i];
+		norm();
+	}
+	template<int W2> ap_uint(const ap_int<W2> &o);
+	template<int W2> ap_uint(const ap_range_ref<W2> &r);
+	template<int W2> ap_uint(const ap_bit_ref<W2> &r) { from_u64((bool)r); }
+
+	bool get(int i) const { return (v[i / 64] >> (i % 64)) & 1; }
+	void set(int i, bool b) {
+		if (b) v[i / 64] |= 1ULL << (i % 64);
+		else v[i / 64] &= ~(1ULL << (i % 64));
+	}
+	void set(int i) { set(i, true); }
+	void clear(int i) { set(i, false); }
+	bool test(int i) const { return get(i); }
+	int length() const { return W; }
+
+	uint64_t to_uint64() const { return v[0]; }
+	unsigned int to_uint() const { return (unsigned int)v[0]; }
+	unsigned long to_ulong() const { return (unsigned long)v[0]; }
+	int to_int() const { return (int)v[0]; }
+	int64_t to_int64() const { return (int64_t)v[0]; }
+	bool to_bool() const { for (int i = 0; i < N; i++) if (v[i]) return true; return false; }
+	operator uint64_t() const { return v[0]; }
+
+	ap_range_ref<W> operator()(int hi, int lo) { return ap_range_ref<W>(this, hi, lo); }
+	ap_range_ref<W> range(int hi, int lo) { return ap_range_ref<W>(this, hi, lo); }
+	ap_uint<W> operator()(int hi, int lo) const { return const_cast<ap_uint *>(this)->range(hi, lo).get(); }
+	ap_uint<W> range(int hi, int lo) const { return const_cast<ap_uint *>(this)->range(hi, lo).get(); }
+	ap_uint<W> range() const { return *this; }
+	ap_bit_ref<W> operator[](int i) { return ap_bit_ref<W>(this, i); }
+	bool operator[](int i) const { return get(i); }
+
+	ap_uint shl(int s) const {
+		ap_uint r;
+		if (s >= W) return r;
+		int ws = s / 64, bs = s % 64;
+		for (int i = N - 1; i >= 0; i--) {
+			uint64_t x = 0;
+			if (i - ws >= 0) x = v[i - ws] << bs;
+			if (bs && i - ws - 1 >= 0) x |= v[i - ws - 1] >> (64 - bs);
+			r.v[i] = x;
+		}
+		r.norm();
+		return r;
+	}
+	ap_uint shr(int s) const {
+		ap_uint r;
+		if (s >= W) return r;
+		int ws = s / 64, bs = s % 64;
+		for (int i = 0; i < N; i++) {
+			uint64_t x = 0;
+			if (i + ws < N) x = v[i + ws] >> bs;
+			if (bs && i + ws + 1 < N) x |= v[i + ws + 1] << (64 - bs);
+			r.v[i] = x;
+		}
+		return r;
+	}
+	ap_uint add(const ap_uint &o) const {
+		ap_uint r; uint64_t c = 0;
+		for (int i = 0; i < N; i++) {
+			uint64_t s = v[i] + o.v[i];
+			uint64_t c1 = s < v[i];
+			r.v[i] = s + c;
+			c = c1 | (r.v[i] < s);
+		}
+		r.norm(); return r;
+	}
+	ap_uint neg() const { ap_uint r; for (int i = 0; i < N; i++) r.v[i] = ~v[i]; r.norm(); return r.add(ap_uint(1)); }
+	ap_uint mul(const ap_uint &o) const {
+		ap_uint r;
+		for (int i = 0; i < N; i++) {
+			uint64_t c = 0;
+			for (int j = 0; i + j < N; j++) {
+				unsigned __int128 t = (unsigned __int128)v[i] * o.v[j] +
+					r.v[i + j] + c;
+				r.v[i + j] = (uint64_t)t;
+				c = (uint64_t)(t >> 64);
+			}
+		}
+		r.norm(); return r;
+	}
+	int cmp(const ap_uint &o) const {
+		for (int i = N - 1; i >= 0; i--)
+			if (v[i] != o.v[i]) return v[i] < o.v[i] ? -1 : 1;
+		return 0;
+	}
+	ap_uint divmod(const ap_uint &d, ap_uint *rem) const {
+		ap_uint q, r;
+		if (N == 1) {
+			q.v[0] = v[0] / d.v[0];
+			if (rem)
+				rem->v[0] = v[0] % d.v[0];
+			return q;
+		}
+		for (int i = W - 1; i >= 0; i--) {
+			r = r.shl(1); r.set(0, get(i));
+			if (r.cmp(d) >= 0) { r = r.add(d.neg()); q.set(i); }
+		}
+		if (rem) *rem = r;
+		return q;
+	}
+
+#define AP_OPASSIGN(op, expr) \
+	template<typename T> ap_uint &operator op(const T &x) { ap_uint o(x); expr; norm(); return *this; }
+	AP_OPASSIGN(+=, *this = add(o))
+	AP_OPASSIGN(-=, *this = add(o.neg()))
+	AP_OPASSIGN(*=, *this = mul(o))
+	AP_OPASSIGN(/=, *this = divmod(o, 0))
+	AP_OPASSIGN(%=, divmod(o, this))
+	AP_OPASSIGN(&=, for (int i = 0; i < N; i++) v[i] &= o.v[i])
+	AP_OPASSIGN(|=, for (int i = 0; i < N; i++) v[i] |= o.v[i])
+	AP_OPASSIGN(^=, for (int i = 0; i < N; i++) v[i] ^= o.v[i])
+#undef AP_OPASSIGN
+	ap_uint &operator<<=(int s) { *this = shl(s); return *this; }
+	ap_uint &operator>>=(int s) { *this = shr(s); return *this; }
+	ap_uint operator<<(int s) const { return shl(s); }
+	ap_uint operator>>(int s) const { return shr(s); }
+	template<int W2> ap_uint operator<<(const ap_uint<W2> &s) const { return shl((int)s.v[0]); }
+	template<int W2> ap_uint operator>>(const ap_uint<W2> &s) const { return shr((int)s.v[0]); }
+	ap_uint operator~() const { ap_uint r; for (int i = 0; i < N; i++) r.v[i] = ~v[i]; r.norm(); return r; }
+	ap_uint operator-() const { return neg(); }
+	bool operator!() const { return !to_bool(); }
+	ap_uint &operator++() { *this = add(ap_uint(1)); return *this; }
+	ap_uint operator++(int) { ap_uint t = *this; ++*this; return t; }
+	ap_uint &operator--() { *this = add(ap_uint(1).neg()); return *this; }
+	ap_uint operator--(int) { ap_uint t = *this; --*this; return t; }
+	bool and_reduce() const { return (~*this).to_bool() == false; }
+	bool or_reduce() const { return to_bool(); }
+	bool xor_reduce() const { bool b = false; for (int i = 0; i < W; i++) b ^= get(i); return b; }
+	ap_uint reverse() const { ap_uint r; for (int i = 0; i < W; i++) r.set(W - 1 - i, get(i)); return r; }
+};
+
+template<int W>
+struct ap_int : public ap_uint<W> {
+	ap_int() {}
+	template<typename T> ap_int(const T &x) : ap_uint<W>(x) {}
+	int64_t to_int64() const {
+		int64_t x = (int64_t)this->v[0];
+		if (W < 64 && this->get(W - 1)) x |= ~0ULL << W;
+		return x;
+	}
+	int to_int() const { return (int)to_int64(); }
+	operator int64_t() const { return to_int64(); }
+};
+
+template<int W> template<int W2>
+ap_uint<W>::ap_uint(const ap_int<W2> &o) { from_u64((uint64_t)o.to_int64(), o.to_int64() < 0); }
+
+template<int W>
+struct ap_range_ref {
+	ap_uint<W> *p; int hi, lo;
+	ap_range_ref(ap_uint<W> *p_, int h, int l) : p(p_), hi(h), lo(l) { assert(h >= l && h < W && l >= 0); }
+	ap_uint<W> get() const {
+		ap_uint<W> r = p->shr(lo);
+		int n = hi - lo + 1;
+		for (int i = n; i < W; i++) r.set(i, false);
+		return r;
+	}
+	template<typename T> ap_range_ref &operator=(const T &x) {
+		ap_uint<W> o(x);
+		for (int i = lo; i <= hi; i++) p->set(i, o.get(i - lo));
+		return *this;
+	}
+	ap_range_ref &operator=(const ap_range_ref &r) { return operator=(r.get()); }
+	template<int W2> ap_range_ref &operator=(const ap_range_ref<W2> &r) { return operator=(r.get()); }
+	operator uint64_t() const { return get().v[0]; }
+	uint64_t to_uint64() const { return get().v[0]; }
+	unsigned int to_uint() const { return (unsigned int)get().v[0]; }
+	int to_int() const { return (int)get().v[0]; }
+	int length() const { return hi - lo + 1; }
+};
+
+template<int W> template<int W2>
+ap_uint<W>::ap_uint(const ap_range_ref<W2> &r) : ap_uint(r.get()) {}
+
+template<int W>
+struct ap_bit_ref {
+	ap_uint<W> *p; int i;
+	ap_bit_ref(ap_uint<W> *p_, int i_) : p(p_), i(i_) { assert(i >= 0 && i < W); }
+	ap_bit_ref &operator=(bool b) { p->set(i, b); return *this; }
+	ap_bit_ref &operator=(const ap_bit_ref &b) { p->set(i, (bool)b); return *this; }
+	operator bool() const { return p->get(i); }
+};
+
+/* binary operators: ap_uint op ap_uint, ap_uint op integral, integral op ap_uint */
+#define AP_MAXW(a, b) ((a) > (b) ? (a) : (b))
+#define AP_SUMW(a, b) (AP_MAXW(a, b) + 1)
+#define AP_MULW(a, b) ((a) + (b))
+#define AP_TW(T) (8 * (int)sizeof(T))
+#define AP_BINOP(op, aop, RW) \
+template<int W1, int W2> ap_uint<RW(W1, W2)> operator op(const ap_uint<W1> &a, const ap_uint<W2> &b) \
+	{ ap_uint<RW(W1, W2)> r(a); r aop b; return r; } \
+template<int W1, typename T, typename std::enable_if<std::is_integral<T>::value, int>::type = 0> \
+	ap_uint<RW(W1, AP_TW(T))> operator op(const ap_uint<W1> &a, T b) \
+	{ ap_uint<RW(W1, AP_TW(T))> r(a); r aop b; return r; } \
+template<int W1, typename T, typename std::enable_if<std::is_integral<T>::value, int>::type = 0> \
+	ap_uint<RW(AP_TW(T), W1)> operator op(T a, const ap_uint<W1> &b) \
+	{ ap_uint<RW(AP_TW(T), W1)> r(a); r aop b; return r; }
+AP_BINOP(+, +=, AP_SUMW)
+AP_BINOP(-, -=, AP_SUMW)
+AP_BINOP(*, *=, AP_MULW)
+AP_BINOP(/, /=, AP_MAXW)
+AP_BINOP(%, %=, AP_MAXW)
+AP_BINOP(&, &=, AP_MAXW)
+AP_BINOP(|, |=, AP_MAXW)
+AP_BINOP(^, ^=, AP_MAXW)
+#undef AP_BINOP
+
+#define AP_CMPOP(op) \
+template<int W1, int W2> bool operator op(const ap_uint<W1> &a, const ap_uint<W2> &b) \
+	{ ap_uint<AP_MAXW(W1, W2)> x(a), y(b); return x.cmp(y) op 0; } \
+template<int W1, typename T, typename std::enable_if<std::is_integral<T>::value, int>::type = 0> \
+	bool operator op(const ap_uint<W1> &a, T b) \
+	{ ap_uint<AP_MAXW(W1, 64)> x(a), y(b); return x.cmp(y) op 0; } \
+template<int W1, typename T, typename std::enable_if<std::is_integral<T>::value, int>::type = 0> \
+	bool operator op(T a, const ap_uint<W1> &b) \
+	{ ap_uint<AP_MAXW(W1, 64)> x(a), y(b); return x.cmp(y) op 0; }
+AP_CMPOP(==)
+AP_CMPOP(!=)
+AP_CMPOP(<)
+AP_CMPOP(<=)
+AP_CMPOP(>)
+AP_CMPOP(>=)
+#undef AP_CMPOP
+
+#endif  /* __SWEMU_AP_INT_H__ */
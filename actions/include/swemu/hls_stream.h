@@ -0,0 +1,48 @@
+#ifndef __SWEMU_HLS_STREAM_H__
+#define __SWEMU_HLS_STREAM_H__
+
+/*
+ * Copyright 2017 International Business Machines
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * hls::stream for building HLS actions without Vivado, see ap_int.h.
+ * The software emulation runs DATAFLOW processes one after the other
+ * like the C simulation, so streams are unbounded queues.
+ */
+
+#include <deque>
+#include <cassert>
+#include <string>
+namespace hls {
+template<typename T>
+class stream {
+	std::deque<T> q;
+public:
+	stream() {}
+	stream(const char *) {}
+	bool empty() const { return q.empty(); }
+	bool full() const { return false; }
+	unsigned size() const { return q.size(); }
+	T read() { assert(!q.empty() && "read from empty stream"); T t = q.front(); q.pop_front(); return t; }
+	void read(T &t) { t = read(); }
+	bool read_nb(T &t) { if (q.empty()) return false; t = read(); return true; }
+	void write(const T &t) { q.push_back(t); }
+	bool write_nb(const T &t) { write(t); return true; }
+	void operator>>(T &t) { t = read(); }
+	void operator<<(const T &t) { write(t); }
+};
+}
+#endif  /* __SWEMU_HLS_STREAM_H__ */
@@ -0,0 +1,173 @@
+/*
+ * Copyright 2017 International Business Machines
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Testbench for hls_engines.H: tables of records of different sizes,
+ * not all multiples of the group size, run through one or more sets
+ * of engines and compared to the result of a loop in C.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <hls_engines.H>
+
+#define TB_LINES 64
+
+/* Engines on 8 byte records, each keeps a count of its calls */
+struct scale_engine {
+	unsigned int calls;
+
+	SNAP_REC_T(8) operator()(SNAP_REC_T(8) rec)
+	{
+		calls++;
+		return rec * 3 + 1;
+	}
+};
+
+/* Engines turn 4 byte records into 8 bytes tagged with their id */
+struct tag_engine {
+	unsigned int id;
+
+	SNAP_REC_T(8) operator()(SNAP_REC_T(4) rec)
+	{
+		SNAP_REC_T(8) r = 0;
+
+		r(31, 0) = rec;
+		r(63, 32) = id;
+		return r;
+	}
+};
+
+static void bytes_to_mem(const uint8_t *b, unsigned int n,
+			 snap_membus_t *mem)
+{
+	for (unsigned int i = 0; i < n; i++)
+		mem[i / BPERDW](8 * (i % BPERDW) + 7, 8 * (i % BPERDW)) = b[i];
+}
+
+static void mem_to_bytes(snap_membus_t *mem, uint8_t *b, unsigned int n)
+{
+	for (unsigned int i = 0; i < n; i++)
+		b[i] = mem[i / BPERDW](8 * (i % BPERDW) + 7,
+				       8 * (i % BPERDW)).to_uint();
+}
+
+/* Engine which gets record i of the table */
+static unsigned int tb_engine(unsigned int i, unsigned int n,
+			      unsigned int g)
+{
+	return (i / g) % (n / g) * g + i % g;
+}
+
+template <unsigned int N, unsigned int G>
+static int test_scale(unsigned int nrec)
+{
+	static snap_membus_t src[TB_LINES], dst[TB_LINES];
+	uint64_t in[TB_LINES * BPERDW / 8], out[TB_LINES * BPERDW / 8];
+	unsigned int ngroups = snap_engines_groups(nrec, G);
+	unsigned int calls[N];
+	scale_engine eng[N];
+	unsigned int i, k;
+
+	memset(in, 0, sizeof(in));
+	for (i = 0; i < nrec; i++)
+		in[i] = 0x0123456789abcdefull * (i + 1);
+	bytes_to_mem((uint8_t *)in, sizeof(in), src);
+	for (i = 0; i < TB_LINES; i++)
+		dst[i] = 0;
+	for (k = 0; k < N; k++) {
+		eng[k].calls = 0;
+		calls[k] = 0;
+	}
+	for (i = 0; i < ngroups * G; i++)
+		calls[tb_engine(i, N, G)]++;
+
+	snap_engines_table<N, G, 8, 8>(eng, src, ngroups, dst);
+
+	mem_to_bytes(dst, (uint8_t *)out, sizeof(out));
+	for (i = 0; i < ngroups * G; i++) {
+		if (out[i] != in[i] * 3 + 1) {
+			fprintf(stderr, "err: scale %u/%u %u records, record "
+				"%u: %016llx instead of %016llx\n", N, G,
+				nrec, i, (long long)out[i],
+				(long long)(in[i] * 3 + 1));
+			return 1;
+		}
+	}
+	for (k = 0; k < N; k++) {
+		if (eng[k].calls != calls[k]) {
+			fprintf(stderr, "err: scale %u/%u %u records, engine "
+				"%u: %u calls instead of %u\n", N, G, nrec,
+				k, eng[k].calls, calls[k]);
+			return 1;
+		}
+	}
+	return 0;
+}
+
+template <unsigned int N, unsigned int G>
+static int test_tag(unsigned int nrec)
+{
+	static snap_membus_t src[TB_LINES], dst[TB_LINES];
+	uint32_t in[TB_LINES * BPERDW / 4], out[TB_LINES * BPERDW / 4];
+	unsigned int ngroups = snap_engines_groups(nrec, G);
+	tag_engine eng[N];
+	unsigned int i, k, e;
+
+	memset(in, 0, sizeof(in));
+	for (i = 0; i < nrec; i++)
+		in[i] = 0x9e3779b9 * (i + 1);
+	bytes_to_mem((uint8_t *)in, sizeof(in), src);
+	for (i = 0; i < TB_LINES; i++)
+		dst[i] = 0;
+	for (k = 0; k < N; k++)
+		eng[k].id = k;
+
+	snap_engines_table<N, G, 4, 8>(eng, src, ngroups, dst);
+
+	mem_to_bytes(dst, (uint8_t *)out, sizeof(out));
+	for (i = 0; i < ngroups * G; i++) {
+		e = tb_engine(i, N, G);
+		if (out[2 * i] != in[i] || out[2 * i + 1] != e) {
+			fprintf(stderr, "err: tag %u/%u %u records, record "
+				"%u: %08x/%u instead of %08x/%u\n", N, G,
+				nrec, i, out[2 * i], out[2 * i + 1], in[i], e);
+			return 1;
+		}
+	}
+	return 0;
+}
+
+int main(void)
+{
+	static const unsigned int nrecs[] = { 0, 1, 7, 8, 9, 100, 255 };
+	unsigned int i;
+	int rc = 0;
+
+	for (i = 0; i < sizeof(nrecs) / sizeof(nrecs[0]); i++) {
+		rc |= test_scale<8, 8>(nrecs[i]);
+		rc |= test_scale<16, 8>(nrecs[i]);
+		rc |= test_tag<4, 4>(nrecs[i]);
+		rc |= test_tag<12, 4>(nrecs[i]);
+	}
+	if (rc != 0) {
+		printf(" ==> ENGINES FAILURE <==\n");
+		return 1;
+	}
+	printf(" ==> ENGINES OK <==\n");
+	return 0;
+}
@@ -137,6 +137,98 @@ function test_hls_intersect()
 	return 0
 }
 
+function test_hls_lz4() # $card $accel
+{
+	local card=$1
+	local accel=$2
+	mytest="./actions/hls_lz4"
+
+	echo "TEST HLS LZ4 Action on Accel: $accel[$card] ..."
+	FUNC="$mytest/sw/snap_lz4 -C $card"
+	for size in 1 4096 70000 1048576; do
+		head -c $size /dev/urandom | od -An -tx1 > /tmp/snap_test.in
+		for flags in "" "-I"; do
+			cmd="${FUNC} ${flags} -i /tmp/snap_test.in -o /tmp/snap_test.lz4 && ${FUNC} -d -i /tmp/snap_test.lz4 -o /tmp/snap_test.out && cmp /tmp/snap_test.in /tmp/snap_test.out"
+			eval ${cmd}
+			RC=$?
+			if [ $RC -ne 0 ]; then
+				rm -f /tmp/snap_test*
+				return $RC
+			fi
+		done
+	done
+	rm -f /tmp/snap_test*
+	return 0
+}
+
+function test_hls_inflate() # $card $accel
+{
+	local card=$1
+	local accel=$2
+	mytest="./actions/hls_inflate"
+
+	echo "TEST HLS Inflate Action on Accel: $accel[$card] ..."
+	FUNC="$mytest/sw/snap_inflate -C $card"
+	for size in 1 4096 70000 1048576; do
+		head -c $size /dev/urandom | od -An -tx1 > /tmp/snap_test.in
+		gzip -c /tmp/snap_test.in > /tmp/snap_test.gz
+		for flags in "" "-B 4KiB"; do
+			cmd="${FUNC} ${flags} -i /tmp/snap_test.gz -o /tmp/snap_test.out && cmp /tmp/snap_test.in /tmp/snap_test.out"
+			eval ${cmd}
+			RC=$?
+			if [ $RC -ne 0 ]; then
+				rm -f /tmp/snap_test*
+				return $RC
+			fi
+		done
+	done
+	rm -f /tmp/snap_test*
+	return 0
+}
+
+function test_hls_sort() # $card $accel
+{
+	local card=$1
+	local accel=$2
+	mytest="./actions/hls_sort"
+
+	echo "TEST HLS Sort Action on Accel: $accel[$card] ..."
+	FUNC="$mytest/sw/snap_sort -C $card"
+	for n in 1 4096 70000 1048576; do
+		for flags in "-k 4" "-k 8 -p" "-k 8 -D -S"; do
+			cmd="${FUNC} ${flags} -n $n -c"
+			eval ${cmd}
+			RC=$?
+			if [ $RC -ne 0 ]; then
+				return $RC
+			fi
+		done
+	done
+	return 0
+}
+
+function test_hls_filter() # $card $accel
+{
+	local card=$1
+	local accel=$2
+	mytest="./actions/hls_filter"
+
+	echo "TEST HLS Filter Action on Accel: $accel[$card] ..."
+	FUNC="$mytest/sw/snap_filter -C $card"
+	for n in 1 4096 70000 1048576; do
+		for flags in "-p '>100&<200'" "-T int64 -p '=3|=5|=9' -r" \
+			     "-T double -p '<=1.5|>=98'" "-T string8 -p '>=b&<d' -r"; do
+			cmd="${FUNC} ${flags} -n $n -c"
+			eval ${cmd}
+			RC=$?
+			if [ $RC -ne 0 ]; then
+				return $RC
+			fi
+		done
+	done
+	return 0
+}
+
 function test_all_actions() # $1 = card, $2 = accel
 {
 	local card=$1
@@ -175,6 +267,22 @@ function test_all_actions() # $1 = card, $2 = accel
 			test_hls_intersect $card $accel
 			RC=$?
 		;;
+		*"10141007")
+			test_hls_lz4 $card $accel
+			RC=$?
+		;;
+		*"10141008")
+			test_hls_inflate $card $accel
+			RC=$?
+		;;
+		*"10141009")
+			test_hls_sort $card $accel
+			RC=$?
+		;;
+		*"1014100A")
+			test_hls_filter $card $accel
+			RC=$?
+		;;
 		*)
 			echo "Error: No Test Case found for $action"
 			RC=99
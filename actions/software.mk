@@ -47,6 +47,24 @@ else
 LDLIBS += -lcxl
 endif
 
+# Software emulation with the HLS sources of the action (../hw) instead
+# of its C version, see actions/include/hls_snap_swemu.H. Uses the Vivado
+# ap_int.h and hls_stream.h if XILINX_VIVADO is set, else the shims in
+# actions/include/swemu.
+ifdef BUILD_HLS_SWEMU
+CXXFLAGS += -std=c++11 -W -Wall -O2 -Wno-unknown-pragmas \
+	-Wno-unused-label -Wno-unused-function -Wno-unused-parameter \
+	-DNO_SYNTH -DHLS_SWEMU -I../hw -I../include \
+	-I$(SNAP_ROOT)/actions/include -I$(SNAP_ROOT)/software/include
+ifdef XILINX_VIVADO
+CXXFLAGS += -I$(XILINX_VIVADO)/include
+else
+CXXFLAGS += -I$(SNAP_ROOT)/actions/include/swemu
+endif
+CFLAGS += -DHLS_SWEMU
+LDLIBS += -lstdc++
+endif
+
 # This rule should be the 1st one to find (default)
 all: all_build
 
@@ -72,6 +90,12 @@ $(PSLSE_ROOT)/libcxl/libcxl.a $(SNAP_ROOT)/software/lib/libsnap.a:
 %.o: %.c $(libs)
 	$(CC) -c $(CPPFLAGS) $(CFLAGS) $< -o $@
 
+%.o: %.cpp $(libs)
+	$(CXX) -c $(CPPFLAGS) $(CXXFLAGS) $< -o $@
+
+%.o: ../hw/%.cpp $(libs)
+	$(CXX) -c $(CPPFLAGS) $(CXXFLAGS) $< -o $@
+
 install: all
 	@mkdir -p $(DESTDIR)/bin
 	@for f in $(projs); do 					\
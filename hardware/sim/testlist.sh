@@ -98,6 +98,10 @@
         "10141004") a0="hls_bfs";;
         "10141005") a0="hls_intersect_h";;
         "10141006") a0="hls_intersect_s";;
+        "10141007") a0="hls_lz4";;
+        "10141008") a0="hls_inflate";;
+        "10141009") a0="hls_sort";;
+        "1014100A") a0="hls_filter";;
         *) a0="unknown";;
       esac; echo "action0 type0s=$t0s type0l=$t0l $a0"
       t="$SNAP_ROOT/software/tools/snap_peek 0x180       ";   r=$($t|grep ']'|awk '{print $2}');echo -e "$t result=$r # action0 counter reg"
@@ -118,6 +122,10 @@
         "10141004") a1="hls_bfs";;
         "10141005") a1="hls_intersect_h";;
         "10141006") a1="hls_intersect_s";;
+        "10141007") a1="hls_lz4";;
+        "10141008") a1="hls_inflate";;
+        "10141009") a1="hls_sort";;
+        "1014100A") a1="hls_filter";;
         *) a1="unknown";;
       esac; echo "action0 type1s=$t1s type1l=$t1l $a1"
       t="$SNAP_ROOT/software/tools/snap_peek 0x188       ";   r=$($t|grep ']'|awk '{print $2}');echo -e "$t result=$r # action1 counter reg"
@@ -267,6 +275,33 @@
       step "$ACTION_ROOT/sw/snap_checksum -I -v -t200 -mSPONGE  -cSHA3                 " # 23s
       step "$ACTION_ROOT/sw/snap_checksum -I -v -t200 -mSPONGE  -cSHA3_SHAKE           " # 44s
       step "$ACTION_ROOT/sw/snap_checksum -I -v -t200 -mSPONGE  -cSHAKE                " # 43s
+      for size in 1 64 85 $rnd1k; do
+        dd if=/dev/urandom bs=${size} count=1 >${size}.in
+        step "$ACTION_ROOT/sw/snap_checksum -I -v -t200 -mCRC32   -X -i ${size}.in     "
+        step "$ACTION_ROOT/sw/snap_checksum -I -v -t200 -mCRC32C  -X -i ${size}.in     "
+        step "$ACTION_ROOT/sw/snap_checksum -I -v -t200 -mADLER32 -i ${size}.in        "
+        for hash in SHA3_224 SHA3_256 SHA3_384 SHA3_512 SHAKE128 SHAKE256; do
+          step "$ACTION_ROOT/sw/snap_checksum -I -v -t200 -m${hash} -X -i ${size}.in"
+          step "$ACTION_ROOT/sw/snap_checksum -I -v -t200 -m${hash} -X -b136 -d300 -i ${size}.in"
+          step "$ACTION_ROOT/sw/snap_checksum -I -v -t200 -m${hash} -X -B7 -d20 -i ${size}.in"
+        done
+        step "$ACTION_ROOT/sw/snap_checksum -I -v -t200 -mXXH3    -X -i ${size}.in     "
+        step "$ACTION_ROOT/sw/snap_checksum -I -v -t200 -mXXH3    -X -S0x1234 -B7 -i ${size}.in"
+        rm ${size}.in
+      done
+      step "$ACTION_ROOT/sw/snap_checksum -mCRC32  -T -s0x100000"
+      step "$ACTION_ROOT/sw/snap_checksum -mCRC32C -T -s0x100000"
+      step "$ACTION_ROOT/sw/snap_checksum -mSHA3_256 -T -s0x100000"
+      step "$ACTION_ROOT/sw/snap_checksum -mSHAKE128 -T -s0x100000"
+      step "$ACTION_ROOT/sw/snap_checksum -mXXH3 -T -s0x100000"
+      dd if=/dev/urandom bs=$rnd1k count=64 >chunks.in
+      step "$ACTION_ROOT/sw/snap_checksum -I -v -t200 -mCRC32   -X -b0x1000 -i chunks.in"
+      step "$ACTION_ROOT/sw/snap_checksum -I -v -t200 -mCRC32C  -X -j4 -b0x2000 -i chunks.in"
+      step "$ACTION_ROOT/sw/snap_checksum -I -v -t200 -mXXH3    -X -S0x1234 -i chunks.in"
+      step "$ACTION_ROOT/sw/snap_checksum -I -v -t200 -mSHA3_256 -X -L0x1000 -i chunks.in"
+      step "$ACTION_ROOT/sw/snap_checksum -I -v -t200 -mSHA3_512 -X -L0x400 -i chunks.in"
+      step "$ACTION_ROOT/sw/snap_checksum -I -v -t200 -mXXH3    -X -L0x1000 -i chunks.in"
+      rm chunks.in
 ## not implemented in HW, just in SW
 ## -m <empty> defaults to -mCRC32
 ## -s only for -mADLER32/CRC32
@@ -335,6 +370,48 @@
       step "$ACTION_ROOT/sw/snap_intersect -I -m2 -v -t1200"
     fi # intersect
 
+    if [[ "$t0l" == "10141007" || "${env_action}" == "hls_lz4"* ]];then echo -e "$del\ntesting snap_lz4"
+      step "$ACTION_ROOT/sw/snap_lz4 -h"
+      for size in 1 100 4096 70000 $rnd1k4k; do to=$((size/100+400))
+        head -c $size </dev/urandom|od -An -tx1 >${size}.txt                                          # hex text, compresses to about half
+        step "$ACTION_ROOT/sw/snap_lz4      -i${size}.txt -o${size}.lz4 -t$to -v"
+        step "$ACTION_ROOT/sw/snap_lz4 -d   -i${size}.lz4 -o${size}.out -t$to -v"
+        step "cmp ${size}.txt ${size}.out"
+        step "$ACTION_ROOT/sw/snap_lz4 -I   -i${size}.txt -o${size}.lz4 -t$to -v"
+        step "$ACTION_ROOT/sw/snap_lz4 -d   -i${size}.lz4 -o${size}.out -t$to -v"
+        step "cmp ${size}.txt ${size}.out"
+      done
+    fi # hls_lz4
+
+    if [[ "$t0l" == "10141008" || "${env_action}" == "hls_inflate"* ]];then echo -e "$del\ntesting snap_inflate"
+      step "$ACTION_ROOT/sw/snap_inflate -h"
+      for size in 1 100 4096 70000 $rnd1k4k; do to=$((size/100+400))
+        head -c $size </dev/urandom|od -An -tx1 >${size}.txt                                          # hex text, compresses to about half
+        gzip -c ${size}.txt >${size}.gz
+        step "$ACTION_ROOT/sw/snap_inflate         -i${size}.gz -o${size}.out -t$to -v"
+        step "cmp ${size}.txt ${size}.out"
+        step "$ACTION_ROOT/sw/snap_inflate -B4KiB  -i${size}.gz -o${size}.out -t$to -v"
+        step "cmp ${size}.txt ${size}.out"
+      done
+    fi # hls_inflate
+
+    if [[ "$t0l" == "10141009" || "${env_action}" == "hls_sort"* ]];then echo -e "$del\ntesting snap_sort"
+      step "$ACTION_ROOT/sw/snap_sort -h"
+      for n in 1 100 4096 70000 $rnd1k4k; do to=$((n/100+400))
+        step "$ACTION_ROOT/sw/snap_sort -n$n -k4         -c -t$to -v"
+        step "$ACTION_ROOT/sw/snap_sort -n$n -k8 -p -D -S -c -t$to -v"
+      done
+    fi # hls_sort
+
+    if [[ "$t0l" == "1014100A" || "${env_action}" == "hls_filter"* ]];then echo -e "$del\ntesting snap_filter"
+      step "$ACTION_ROOT/sw/snap_filter -h"
+      for n in 1 100 4096 70000 $rnd1k4k; do to=$((n/100+400))
+        step "$ACTION_ROOT/sw/snap_filter -n$n -p>100&<200          -c -t$to -v"
+        step "$ACTION_ROOT/sw/snap_filter -n$n -T int64 -p=3|=5|=9 -r -c -t$to -v"
+        step "$ACTION_ROOT/sw/snap_filter -n$n -T string16 -p>=b&<d  -r -c -t$to -v"
+      done
+    fi # hls_filter
+
 
     ts2=$(date +%s); looptime=`expr $ts2 - $ts1`; echo "looptime=$looptime"  # end of loop
   done; l=""; ts3=$(date +%s); totaltime=`expr $ts3 - $ts0`; echo "loops=$loops tests=$n total_time=$totaltime" # end of test
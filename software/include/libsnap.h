@@ -383,6 +383,29 @@ int snap_action_sync_execute_job(struct snap_action *action,
 			struct snap_job *cjob,
 			unsigned int timeout_sec);
 
+struct snap_action_perf {
+	uint64_t cycles;		/* Cycles moving or waiting for data */
+	uint64_t rd_bytes;		/* Bytes read from host and card memory */
+	uint64_t wr_bytes;		/* Bytes written to host and card memory */
+	uint64_t rd_stall;		/* Cycles waiting for read data */
+	uint64_t wr_stall;		/* Cycles held back by writes */
+};
+
+/**
+ * Performance counters of the last job of the action, to tell whether
+ * it was busy computing or waiting for its DMA transfers. HLS actions
+ * offer them through the snap_perf_t port of hls_snap.H, all counters
+ * are 0 for actions without it. In software emulation, cycles are the
+ * run time of the job at 250 MHz and the other counters are what the
+ * software action reported, see struct snap_sim_action.
+ *
+ * @action      handle to the attached action
+ * @perf        counters of the last job
+ * @return      SNAP_OK in case of success, else error.
+ */
+int snap_action_perf(struct snap_action *action,
+		     struct snap_action_perf *perf);
+
 #if 0 /* FIXME Discuss how this must be done correctly */
 /**
  * Allow the action to use interrupts to signal results back to the
@@ -460,6 +483,196 @@ int snap_async_execute_job(struct snap_queue *queue,
 			struct snap_job *cjob,
 			snap_job_finished_t finished);
 
+/******************************************************************************
+ * SNAP NVMe I/O Queues
+ *****************************************************************************/
+
+/*
+ * Block I/O between the NVMe drives and card DRAM, driven from the host.
+ * Commands are pushed into the I/O submission queue of the NVMe host on
+ * the card without waiting for earlier ones, completions are collected
+ * later in submission order. The card handle must be opened on the master
+ * device (/dev/cxl/afuX.0m) and the drives must be set up by
+ * snap_nvme_init.
+ *
+ * In software mode (SNAP_CONFIG=1) the drive is emulated by the file named
+ * in SNAP_NVME_FILE0 or SNAP_NVME_FILE1, its size is the namespace size.
+ * Card DRAM is emulated in host memory.
+ */
+struct snap_nvme_queue;
+
+#define SNAP_NVME_READ		0	/* Drive -> card DRAM */
+#define SNAP_NVME_WRITE		1	/* Card DRAM -> drive */
+
+#define SNAP_NVME_BLOCK_SIZE	512
+#define SNAP_NVME_MAX_BLOCKS	0x10000	/* Blocks per command */
+#define SNAP_NVME_MAX_ID	16	/* Tracking ids in the NVMe host */
+#define SNAP_NVME_MAX_DEPTH	256	/* Commands tracked per id */
+
+struct snap_nvme_cmd {
+	uint32_t opcode;		/* SNAP_NVME_READ or SNAP_NVME_WRITE */
+	uint32_t nblocks;		/* 1 .. SNAP_NVME_MAX_BLOCKS */
+	uint64_t lba;			/* First block on the drive */
+	uint64_t ddr_addr;		/* Card DRAM, must not cross 32 MiB */
+	void *priv;			/* Handed back on completion */
+};
+
+struct snap_nvme_cpl {
+	void *priv;			/* From the command */
+	int status;			/* SNAP_OK, SNAP_EIO or SNAP_EFAULT */
+};
+
+/*
+ * Allocate an I/O queue to one drive.
+ *
+ * @card        snap_card device handle on the master device.
+ * @drive       NVMe drive, 0 or 1.
+ * @id          NVMe host tracking id, 0 .. SNAP_NVME_MAX_ID - 1. Every
+ *              queue and every action talking to the NVMe host needs its
+ *              own id, actions normally use 0.
+ * @depth       Maximum number of outstanding commands,
+ *              1 .. SNAP_NVME_MAX_DEPTH.
+ * @return      queue handle or NULL in case of error.
+ */
+struct snap_nvme_queue *snap_nvme_queue_alloc(struct snap_card *card,
+			int drive, unsigned int id, unsigned int depth);
+
+void snap_nvme_queue_free(struct snap_nvme_queue *queue);
+
+/*
+ * Queue up to n commands, does not wait for any of them.
+ *
+ * @queue       NVMe queue handle.
+ * @cmds        Array of n commands.
+ * @return      Number of commands queued, less than n if the queue or
+ *              the submission queue on the card is full. Negative SNAP
+ *              error code if cmds[0] is invalid or the card fails.
+ */
+int snap_nvme_submit(struct snap_nvme_queue *queue,
+			const struct snap_nvme_cmd *cmds, unsigned int n);
+
+/*
+ * Collect completions in submission order. Waits until at least min
+ * completions are there or timeout_ms passed, negative timeout_ms waits
+ * forever.
+ *
+ * @queue       NVMe queue handle.
+ * @cpls        Array for up to max completions.
+ * @return      Number of completions returned, negative SNAP error code
+ *              if the card fails.
+ */
+int snap_nvme_reap(struct snap_nvme_queue *queue, struct snap_nvme_cpl *cpls,
+			unsigned int min, unsigned int max, int timeout_ms);
+
+/*
+ * Number of commands submitted but not yet reaped.
+ */
+unsigned int snap_nvme_pending(struct snap_nvme_queue *queue);
+
+/******************************************************************************
+ * SNAP NVMe Block Cache
+ *****************************************************************************/
+
+/*
+ * Cache of drive blocks in a region of card DRAM, in front of one drive.
+ * Blocks are cached in lines of SNAP_NVME_CACHE_LINE_BLOCKS, indexed by
+ * LBA, SNAP_NVME_CACHE_WAYS lines per set. The tags live on the host. A
+ * lookup makes a range of blocks resident and returns where the lines
+ * sit in card DRAM, so the host and actions work on them in place.
+ * Lines are read from the drive on a miss. Written lines go to the drive
+ * at once (write-through) or when they are evicted or flushed
+ * (write-back).
+ *
+ * The addresses are valid until the next call which can evict lines,
+ * any call except snap_nvme_cache_stats(). A cache must not be used by
+ * more than one thread at a time.
+ *
+ * Jobs with an SNAP_ADDRTYPE_NVME source read the drive itself and do
+ * not see the cache. Dirty lines of a write-back cache must go to the
+ * drive with snap_nvme_cache_flush() before such a job is started, and
+ * the cache must not write the drive while the job runs.
+ */
+struct snap_nvme_cache;
+
+#define SNAP_NVME_CACHE_WRITE_BACK	0x0
+#define SNAP_NVME_CACHE_WRITE_THROUGH	0x1
+
+#define SNAP_NVME_CACHE_LINE_BLOCKS	8	/* 4 KiB lines */
+#define SNAP_NVME_CACHE_LINE_SIZE	\
+	(SNAP_NVME_CACHE_LINE_BLOCKS * SNAP_NVME_BLOCK_SIZE)
+#define SNAP_NVME_CACHE_WAYS		4
+
+struct snap_nvme_cache_stats {
+	uint64_t hits;			/* Lines found in the cache */
+	uint64_t misses;		/* Lines not found */
+	uint64_t fills;			/* Lines read from the drive */
+	uint64_t writebacks;		/* Lines written to the drive */
+	uint64_t evictions;		/* Valid lines replaced */
+	uint64_t nvme_cmds;		/* NVMe commands issued */
+};
+
+/*
+ * Allocate a cache and an NVMe queue for it.
+ *
+ * @card        snap_card device handle on the master device.
+ * @drive       NVMe drive, 0 or 1.
+ * @id          NVMe host tracking id for the queue of the cache.
+ * @ddr_addr    Card DRAM region for the lines, aligned to
+ *              SNAP_NVME_CACHE_LINE_SIZE. It must not overlap the NVMe
+ *              staging area, SNAP_NVME_STAGING_ADDR.
+ * @size        Size of the region, at least SNAP_NVME_CACHE_WAYS lines.
+ * @flags       SNAP_NVME_CACHE_WRITE_BACK or SNAP_NVME_CACHE_WRITE_THROUGH.
+ * @return      cache handle or NULL in case of error.
+ */
+struct snap_nvme_cache *snap_nvme_cache_alloc(struct snap_card *card,
+			int drive, unsigned int id, uint64_t ddr_addr,
+			uint64_t size, int flags);
+
+/* Write back dirty lines and free the cache */
+void snap_nvme_cache_free(struct snap_nvme_cache *cache);
+
+/*
+ * Make blocks lba .. lba + nblocks - 1 resident.
+ *
+ * @cache       Cache handle.
+ * @lba         First block.
+ * @nblocks     Number of blocks, the range may span at most
+ *              snap_nvme_cache_max_lines() lines.
+ * @ddr_addr    Gets the card DRAM address of each line of the range, the
+ *              first line is the one holding lba. Block lba is at
+ *              ddr_addr[0] + (lba % SNAP_NVME_CACHE_LINE_BLOCKS) *
+ *              SNAP_NVME_BLOCK_SIZE.
+ * @return      Number of lines, negative SNAP error code on failure.
+ */
+int snap_nvme_cache_read(struct snap_nvme_cache *cache, uint64_t lba,
+			uint32_t nblocks, uint64_t *ddr_addr);
+
+/*
+ * Like snap_nvme_cache_read(), but for blocks which are going to be
+ * overwritten. Lines covered completely are not read from the drive.
+ * Call snap_nvme_cache_commit() once the new data is in card DRAM.
+ */
+int snap_nvme_cache_write(struct snap_nvme_cache *cache, uint64_t lba,
+			uint32_t nblocks, uint64_t *ddr_addr);
+
+/*
+ * Blocks lba .. lba + nblocks - 1 were written in card DRAM. Write-through
+ * caches write the lines to the drive and wait for it, write-back caches
+ * mark them dirty. Returns SNAP_ENOENT if a line is not resident.
+ */
+int snap_nvme_cache_commit(struct snap_nvme_cache *cache, uint64_t lba,
+			uint32_t nblocks);
+
+/* Write all dirty lines to the drive, they stay in the cache */
+int snap_nvme_cache_flush(struct snap_nvme_cache *cache);
+
+/* Largest number of lines one read or write may span */
+unsigned int snap_nvme_cache_max_lines(struct snap_nvme_cache *cache);
+
+/* Copy the statistics, reset them if reset is not 0 */
+void snap_nvme_cache_stats(struct snap_nvme_cache *cache,
+			struct snap_nvme_cache_stats *stats, int reset);
+
 #ifdef __cplusplus
 }
 #endif
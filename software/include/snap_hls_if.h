@@ -49,6 +49,15 @@ extern "C" {
 #define ACTION_PARAMS_OUT	(ACTION_PARAMS_IN + 0x80)
 #define ACTION_RETC_OUT		(ACTION_PARAMS_OUT + 4)
 
+/* Performance counters of the last job, snap_perf_t of hls_snap.H */
+#define ACTION_PERF		0x80
+#define ACTION_PERF_CYCLES	(ACTION_PERF + 0x00)
+#define ACTION_PERF_RD_BYTES	(ACTION_PERF + 0x08)
+#define ACTION_PERF_WR_BYTES	(ACTION_PERF + 0x10)
+#define ACTION_PERF_RD_STALL	(ACTION_PERF + 0x18)
+#define ACTION_PERF_WR_STALL	(ACTION_PERF + 0x20)
+#define ACTION_PERF_SIZE	0x28
+
 #define SNAP_ACTION_ID_REG	0x10		/* SNAP Action ID Register */
 #define SNAP_ACTION_VERS_REG	0x14		/* SNAP Action Version Register */
 
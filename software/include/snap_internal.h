@@ -80,6 +80,30 @@ int action_trace_enabled(void);
 			fprintf(stderr, "A " fmt, ## __VA_ARGS__);	\
 	} while (0)
 
+int nvme_trace_enabled(void);
+
+#define nvme_trace(fmt, ...) do {					\
+		if (nvme_trace_enabled())				\
+			fprintf(stderr, "N " fmt, ## __VA_ARGS__);	\
+	} while (0)
+
+/* True if SNAP_CONFIG selects the software emulation */
+int snap_sim_enabled(void);
+
+/*
+ * Card DRAM in software mode, allocated on first use. Returns the host
+ * address of [addr, addr + size) or NULL if the range is outside of the
+ * emulated DRAM or the card is real hardware.
+ */
+void *snap_card_ddr_emu(struct snap_card *card, uint64_t addr, uint64_t size);
+
+/*
+ * Read size bytes at byte offset offs of the emulated NVMe drive, the
+ * file named by SNAP_NVME_FILE<drive>. Software actions use this for
+ * SNAP_ADDRTYPE_NVME sources.
+ */
+int snap_nvme_emu_read(int drive, uint64_t offs, void *buf, size_t size);
+
 /**
  * Register a software version of the FPGA action to enable us
  * simulating high-level behavior of the same and allowing us to
@@ -106,6 +130,7 @@ struct snap_sim_action {
 	void *priv_data;
 
 	struct snap_queue_workitem job;
+	struct snap_action_perf perf;	/* Counters of the job, set by main */
 	snap_action_main_t main;
 
 	int (* mmio_write32)(struct snap_card *card,
@@ -45,6 +45,18 @@ extern "C" {
 #define SNAP_ADDRFLAG_EXT		0x0008 /* reserved for extension */
 #define SNAP_ADDRFLAG_SRC		0x0010 /* data source */
 #define SNAP_ADDRFLAG_DST		0x0020 /* data destination */
+#define SNAP_ADDRFLAG_DRIVE1		0x0040 /* NVMe: drive 1, else drive 0 */
+
+/*
+ * An SNAP_ADDRTYPE_NVME source is given as byte offset on the drive,
+ * which must be 512 byte aligned. Actions stream the data through the
+ * staging area at the end of the first GiB of card DRAM, two halves
+ * used alternately. Host code must not put its own data there while
+ * such a job runs. The drive is read as it is, a write-back NVMe block
+ * cache of the host must be flushed before the job.
+ */
+#define SNAP_NVME_STAGING_ADDR		0x3fe00000ull
+#define SNAP_NVME_STAGING_SIZE		0x00200000
 
 typedef uint16_t snap_addrtype_t;
 typedef uint16_t snap_addrflag_t;
@@ -22,7 +22,11 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include <errno.h>
+#include <pthread.h>
+#include <fcntl.h>
 #include <sys/time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 #include <libsnap.h>
 #include <libcxl.h>
@@ -38,6 +42,18 @@ static unsigned int snap_trace = 0x0;
 static unsigned int snap_config = 0x0;
 static struct snap_sim_action *actions = NULL;
 
+/*
+ * Software actions keep their return code in the one registered
+ * snap_sim_action, run them one at a time if several contexts are
+ * attached to the same action.
+ */
+static pthread_mutex_t sw_action_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* Emulated card DRAM is mapped on first use */
+static pthread_mutex_t sw_ddr_lock = PTHREAD_MUTEX_INITIALIZER;
+#define SW_DDR_SIZE_MB		1024	/* Default emulated card DRAM */
+#define SW_DDR_FILE		"/tmp/snap_ddr_%u.bin"	/* per user */
+
 #define snap_trace_enabled()  (snap_trace & 0x01)
 #define reg_trace_enabled()   (snap_trace & 0x02)
 #define sim_trace_enabled()   (snap_trace & 0x04)
@@ -48,8 +64,18 @@ int action_trace_enabled(void)
 	return snap_trace & 0x8;
 }
 
+int nvme_trace_enabled(void)
+{
+	return snap_trace & 0x20;
+}
+
 #define simulation_enabled()  (snap_config & 0x1)
 
+int snap_sim_enabled(void)
+{
+	return simulation_enabled();
+}
+
 #define snap_trace(fmt, ...) do {					\
 		if (snap_trace_enabled())				\
 			fprintf(stderr, "D " fmt, ## __VA_ARGS__);	\
@@ -90,12 +116,17 @@ struct snap_card {
 	int afu_fd;
 
 	struct snap_sim_action *action; /* software simulation mode */
+	struct snap_queue_workitem sw_job; /* job registers of this context */
 	size_t errinfo_size;            /* Size of errinfo */
 	void *errinfo;                  /* Err info Buffer */
 	struct cxl_event event;         /* Buffer to keep event from IRQ */
 	unsigned int attach_timeout_sec;
 	unsigned int queue_length;      /* unused */
 	uint64_t cap_reg;               /* Capability Register */
+
+	void *ddr_emu;                  /* Card DRAM in software mode */
+	uint64_t ddr_emu_size;
+	struct snap_action_perf sw_perf; /* Counters of the last sw job */
 };
 
 /* To be used for software simulation, use funcs provided by action */
@@ -114,6 +145,15 @@ static unsigned int tget_ms(void)
 	return tms;
 }
 
+/*	Get Time in usec */
+static uint64_t tget_us(void)
+{
+	struct timeval now;
+
+	gettimeofday(&now, NULL);
+	return (uint64_t)now.tv_sec * 1000000 + now.tv_usec;
+}
+
 static void *hw_snap_card_alloc_dev(const char *path,
 				    uint16_t vendor_id,
 				    uint16_t device_id)
@@ -846,6 +886,34 @@ __snap_action_sync_execute_job_exit:
 	return rc;
 }
 
+int snap_action_perf(struct snap_action *action,
+		     struct snap_action_perf *perf)
+{
+	int rc;
+	unsigned int i;
+	struct snap_card *card = (struct snap_card *)action;
+	uint32_t data[ACTION_PERF_SIZE / sizeof(uint32_t)];
+
+	/* 64 bit counters, lower half first like all HLS registers */
+	for (i = 0; i < ARRAY_SIZE(data); i++) {
+		rc = snap_mmio_read32(card, ACTION_PERF + i * sizeof(uint32_t),
+				      &data[i]);
+		if (rc != 0)
+			return rc;
+	}
+	perf->cycles   = data[0] | (uint64_t)data[1] << 32;
+	perf->rd_bytes = data[2] | (uint64_t)data[3] << 32;
+	perf->wr_bytes = data[4] | (uint64_t)data[5] << 32;
+	perf->rd_stall = data[6] | (uint64_t)data[7] << 32;
+	perf->wr_stall = data[8] | (uint64_t)data[9] << 32;
+
+	snap_trace("%s: cycles %lld rd %lld wr %lld stalls %lld/%lld\n",
+		   __func__, (long long)perf->cycles,
+		   (long long)perf->rd_bytes, (long long)perf->wr_bytes,
+		   (long long)perf->rd_stall, (long long)perf->wr_stall);
+	return 0;
+}
+
 int snap_sync_execute_job(struct snap_card *card,
 			  snap_action_type_t action_type,
 			  snap_action_flag_t action_flags,
@@ -946,9 +1014,85 @@ static void *sw_card_alloc_dev(const char *path __unused,
 
 static void sw_card_free(struct snap_card *card)
 {
+	if (card->ddr_emu)
+		munmap(card->ddr_emu, card->ddr_emu_size);
 	free(card);
 }
 
+static unsigned long sw_ddr_size_mb(struct snap_card *card)
+{
+	if (card->cap_reg >> 16)
+		return (unsigned long)(card->cap_reg >> 16);
+	return SW_DDR_SIZE_MB;
+}
+
+/*
+ * Card DRAM is emulated by a shared mapping of the file SNAP_DDR_FILE,
+ * /tmp/snap_ddr_<uid>.bin by default. Like on a card, data stays in
+ * it from one process to the next, e.g. a test copies data to the
+ * card with one job and back with another. The file is sparse,
+ * blocks get backed when they are written.
+ */
+static void *sw_ddr_map(uint64_t ddr_size)
+{
+	char def_path[64];
+	const char *path;
+	struct stat st;
+	void *ddr;
+	int fd;
+
+	path = getenv("SNAP_DDR_FILE");
+	if (path == NULL) {
+		snprintf(def_path, sizeof(def_path), SW_DDR_FILE,
+			 (unsigned int)getuid());
+		path = def_path;
+	}
+	fd = open(path, O_RDWR | O_CREAT, 0600);
+	if (fd < 0)
+		return NULL;
+	if (fstat(fd, &st) != 0 ||
+	    ((uint64_t)st.st_size < ddr_size &&
+	     ftruncate(fd, ddr_size) != 0)) {
+		close(fd);
+		return NULL;
+	}
+	ddr = mmap(NULL, ddr_size, PROT_READ | PROT_WRITE,
+		   MAP_SHARED | MAP_NORESERVE, fd, 0);
+	close(fd);
+	if (ddr == MAP_FAILED)
+		return NULL;
+	snap_trace("  %s: %lld MB of %s at %p\n", __func__,
+		   (long long)(ddr_size >> 20), path, ddr);
+	return ddr;
+}
+
+void *snap_card_ddr_emu(struct snap_card *card, uint64_t addr, uint64_t size)
+{
+	void *ddr;
+	uint64_t ddr_size;
+
+	if (!simulation_enabled() || card == NULL)
+		return NULL;
+
+	pthread_mutex_lock(&sw_ddr_lock);
+	if (card->ddr_emu == NULL) {
+		ddr_size = (uint64_t)sw_ddr_size_mb(card) << 20;
+		ddr = sw_ddr_map(ddr_size);
+		if (ddr != NULL) {
+			card->ddr_emu = ddr;
+			card->ddr_emu_size = ddr_size;
+		}
+	}
+	pthread_mutex_unlock(&sw_ddr_lock);
+
+	if (card->ddr_emu == NULL || addr > card->ddr_emu_size ||
+	    size > card->ddr_emu_size - addr) {
+		errno = EFAULT;
+		return NULL;
+	}
+	return (uint8_t *)card->ddr_emu + addr;
+}
+
 static int sw_mmio_write32(struct snap_card *card,
 			   uint64_t offs, uint32_t data)
 {
@@ -967,21 +1111,35 @@ static int sw_mmio_write32(struct snap_card *card,
 		errno = EFAULT;
 		return -1;
 	}
-	w = &a->job;
+	w = &card->sw_job;
 
 	if (offs == ACTION_CONTROL) {
+		uint64_t t0;
+
 		snap_trace("  starting action!!\n");
+		pthread_mutex_lock(&sw_action_lock);
 		a->state = ACTION_RUNNING;
+		memset(&a->perf, 0, sizeof(a->perf));
 		/* __hexdump(stdout, &w->user, sizeof(w->user)); */
+		t0 = tget_us();
+		/* an action which does not set it failed */
+		a->job.retc = SNAP_RETC_FAILURE;
 		a->main(a, &w->user, sizeof(w->user));
+		w->retc = a->job.retc;
+
+		/* Stand-in for the action clock: run time at 250 MHz */
+		card->sw_perf = a->perf;
+		if (card->sw_perf.cycles == 0)
+			card->sw_perf.cycles = (tget_us() - t0) * 250;
 		a->state = ACTION_IDLE;
+		pthread_mutex_unlock(&sw_action_lock);
 
 		return 0;
 	}
 
 	if ((offs >= ACTION_PARAMS_IN) &&
 	    (offs < ACTION_PARAMS_IN + CACHELINE_BYTES)) {
-		((uint32_t *)&a->job)[(offs - ACTION_PARAMS_IN)/4] = data;
+		((uint32_t *)w)[(offs - ACTION_PARAMS_IN)/4] = data;
 	}
 
 	if (a->mmio_write32)
@@ -1006,7 +1164,7 @@ static int sw_mmio_read32(struct snap_card *card,
 		errno = EFAULT;
 		return -1;
 	}
-	w = &a->job;
+	w = &card->sw_job;
 	*data = 0x0;
 
 	switch (offs) {
@@ -1026,6 +1184,13 @@ static int sw_mmio_read32(struct snap_card *card,
 			unsigned int idx = (offs - ACTION_PARAMS_OUT)/4;
 			*data = ((uint32_t *)(unsigned long)w)[idx];
 
+		} else if ((offs >= ACTION_PERF) &&
+			   (offs < ACTION_PERF + ACTION_PERF_SIZE)) {
+			unsigned int idx = (offs - ACTION_PERF)/4;
+			uint64_t v = ((uint64_t *)&card->sw_perf)[idx/2];
+
+			*data = (idx & 1) ? (uint32_t)(v >> 32) : (uint32_t)v;
+
 		} else if (a->mmio_read32)
 			rc = a->mmio_read32(card, offs, data);
 	}
@@ -1095,10 +1260,12 @@ static int sw_card_ioctl(struct snap_card *card, unsigned int cmd, unsigned long
 		*arg = 255;    /* Some Unknown */
 		break;
 	case GET_NVME_ENABLED:
-		*arg  = 0;     /* No NVME in SW Mode */
+		/* Emulated if a drive has a backing file */
+		*arg = (getenv("SNAP_NVME_FILE0") != NULL ||
+			getenv("SNAP_NVME_FILE1") != NULL);
 		break;
 	case GET_SDRAM_SIZE:
-		*arg = 0;      /* No Card Ram in SW Mode */
+		*arg = sw_ddr_size_mb(card);	/* Emulated Card Ram */
 		break;
 	case SET_SDRAM_SIZE:
 		card->cap_reg = (card->cap_reg & 0xffff) | (parm << 16);
@@ -0,0 +1,491 @@
+/*
+ * Copyright 2017 International Business Machines
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * NVMe I/O queues driven from the host. The NVMe host on the card has
+ * an action register block, the same one actions reach over AXI. On the
+ * master context it shows up at SNAP_M_NVME_OFFSET. Writing the command
+ * register pushes one entry into the I/O submission queue of a drive and
+ * returns right away. Completions are kept per tracking id in submission
+ * order, each read of the track register pops the oldest one if it is
+ * done. So a queue is a ring of submitted commands, reaping pops its head.
+ *
+ * In software mode a thread per queue executes the ring against a
+ * backing file and the emulated card DRAM, completing in the same order.
+ */
+
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+
+#include <libsnap.h>
+#include <snap_internal.h>
+#include <snap_m_regs.h>
+
+/* Action registers of the NVMe host, write side */
+#define NVME_W_DPTR_LOW		0x00
+#define NVME_W_DPTR_HIGH	0x04
+#define NVME_W_LBA_LOW		0x08
+#define NVME_W_LBA_HIGH		0x0c
+#define NVME_W_LBA_NUM		0x10	/* Blocks - 1 */
+#define NVME_W_COMMAND		0x14
+
+/* Action registers of the NVMe host, read side */
+#define NVME_R_STATUS		0x00
+#define NVME_R_TRACK(id)	(0x04 + 4 * (id))
+#define NVME_R_SQ_SPACE		0x48	/* Free entries, one byte per queue */
+
+/* Command register: type 3:0, queue 7:4, tracking id 11:8 */
+#define NVME_CMD_QUEUE(drive)	(2 * (drive) + 1)	/* I/O queue of drive */
+#define NVME_CMD(type, drive, id) \
+	((type) | (NVME_CMD_QUEUE(drive) << 4) | ((id) << 8))
+
+/* Card DRAM as seen by the NVMe host */
+#define NVME_DDR_OFFSET		0x200000000ull
+#define NVME_DDR_BOUNDARY	0x2000000ull	/* Transfers must not cross */
+
+#define NVME_TRACK_DONE		0x01
+#define NVME_TRACK_ERROR	0x02
+
+#define NVME_POLL_MAX_US	256	/* Longest sleep between polls */
+
+struct nvme_slot {
+	struct snap_nvme_cmd cmd;
+	int status;
+	bool done;
+};
+
+struct snap_nvme_queue {
+	struct snap_card *card;
+	int drive;
+	unsigned int id;
+	unsigned int depth;
+	struct nvme_slot *ring;
+	unsigned int head;		/* Oldest not reaped, free running */
+	unsigned int tail;		/* Next to submit, free running */
+
+	/* Software emulation */
+	bool sim;
+	int fd;
+	uint64_t ns_blocks;		/* Size of the backing file */
+	unsigned int next;		/* Next the thread executes */
+	bool stop;
+	pthread_t thread;
+	pthread_mutex_t lock;
+	pthread_cond_t work;
+	pthread_cond_t done;
+};
+
+static uint64_t get_usec(void)
+{
+	struct timeval t;
+
+	gettimeofday(&t, NULL);
+	return t.tv_sec * 1000000ull + t.tv_usec;
+}
+
+static int nvme_cmd_check(const struct snap_nvme_cmd *cmd)
+{
+	if (cmd->opcode != SNAP_NVME_READ && cmd->opcode != SNAP_NVME_WRITE)
+		return SNAP_EINVAL;
+	if (cmd->nblocks == 0 || cmd->nblocks > SNAP_NVME_MAX_BLOCKS)
+		return SNAP_EINVAL;
+	if (cmd->ddr_addr / NVME_DDR_BOUNDARY !=
+	    (cmd->ddr_addr + (uint64_t)cmd->nblocks * SNAP_NVME_BLOCK_SIZE - 1) /
+	    NVME_DDR_BOUNDARY)
+		return SNAP_EINVAL;
+	return SNAP_OK;
+}
+
+/******************************************************************************
+ * HARDWARE
+ *****************************************************************************/
+
+static int hw_nvme_write(struct snap_nvme_queue *q, uint32_t reg,
+			 uint32_t data)
+{
+	return snap_mmio_write32(q->card, SNAP_M_NVME_OFFSET + reg, data);
+}
+
+static int hw_nvme_read(struct snap_nvme_queue *q, uint32_t reg,
+			uint32_t *data)
+{
+	return snap_mmio_read32(q->card, SNAP_M_NVME_OFFSET + reg, data);
+}
+
+static int hw_nvme_submit(struct snap_nvme_queue *q,
+			  const struct snap_nvme_cmd *cmds, unsigned int n)
+{
+	const struct snap_nvme_cmd *cmd;
+	uint64_t ddr;
+	uint32_t space;
+	unsigned int i;
+
+	/* One read for the whole batch, a full queue would stall the MMIO */
+	if (hw_nvme_read(q, NVME_R_SQ_SPACE, &space) != 0)
+		return SNAP_EIO;
+	space = (space >> (8 * NVME_CMD_QUEUE(q->drive))) & 0xff;
+	if (n > space)
+		n = space;
+
+	for (i = 0; i < n; i++) {
+		cmd = &cmds[i];
+		if (nvme_cmd_check(cmd) != SNAP_OK)
+			break;
+		ddr = cmd->ddr_addr + NVME_DDR_OFFSET;
+		if (hw_nvme_write(q, NVME_W_DPTR_LOW, (uint32_t)ddr) ||
+		    hw_nvme_write(q, NVME_W_DPTR_HIGH, (uint32_t)(ddr >> 32)) ||
+		    hw_nvme_write(q, NVME_W_LBA_LOW, (uint32_t)cmd->lba) ||
+		    hw_nvme_write(q, NVME_W_LBA_HIGH,
+				  (uint32_t)(cmd->lba >> 32)) ||
+		    hw_nvme_write(q, NVME_W_LBA_NUM, cmd->nblocks - 1) ||
+		    hw_nvme_write(q, NVME_W_COMMAND,
+				  NVME_CMD(cmd->opcode, q->drive, q->id)))
+			return i ? (int)i : SNAP_EIO;
+		q->ring[q->tail % q->depth].cmd = *cmd;
+		q->ring[q->tail % q->depth].done = false;
+		q->tail++;
+	}
+	return i;
+}
+
+/* Move what the card has finished from the track register to the ring */
+static int hw_nvme_poll(struct snap_nvme_queue *q)
+{
+	struct nvme_slot *slot;
+	unsigned int i;
+	uint32_t track;
+
+	for (i = q->head; i != q->tail; i++) {
+		slot = &q->ring[i % q->depth];
+		if (slot->done)
+			continue;
+		if (hw_nvme_read(q, NVME_R_TRACK(q->id), &track) != 0)
+			return SNAP_EIO;
+		if (!(track & NVME_TRACK_DONE))
+			break;
+		slot->status = (track & NVME_TRACK_ERROR) ? SNAP_EIO : SNAP_OK;
+		slot->done = true;
+	}
+	return SNAP_OK;
+}
+
+/******************************************************************************
+ * SOFTWARE EMULATION
+ *****************************************************************************/
+
+static int sw_nvme_exec(struct snap_nvme_queue *q,
+			const struct snap_nvme_cmd *cmd)
+{
+	size_t size = (size_t)cmd->nblocks * SNAP_NVME_BLOCK_SIZE;
+	off_t offs = (off_t)(cmd->lba * SNAP_NVME_BLOCK_SIZE);
+	ssize_t done;
+	void *ddr;
+
+	if (cmd->lba >= q->ns_blocks || cmd->nblocks > q->ns_blocks - cmd->lba)
+		return SNAP_EIO;
+	ddr = snap_card_ddr_emu(q->card, cmd->ddr_addr, size);
+	if (ddr == NULL)
+		return SNAP_EFAULT;
+
+	if (cmd->opcode == SNAP_NVME_READ)
+		done = pread(q->fd, ddr, size, offs);
+	else	done = pwrite(q->fd, ddr, size, offs);
+	return (done == (ssize_t)size) ? SNAP_OK : SNAP_EIO;
+}
+
+static void *sw_nvme_thread(void *arg)
+{
+	struct snap_nvme_queue *q = arg;
+	struct nvme_slot *slot;
+	struct snap_nvme_cmd cmd;
+	int status;
+
+	pthread_mutex_lock(&q->lock);
+	while (1) {
+		while (!q->stop && q->next == q->tail)
+			pthread_cond_wait(&q->work, &q->lock);
+		if (q->stop)
+			break;
+
+		slot = &q->ring[q->next % q->depth];
+		cmd = slot->cmd;
+		pthread_mutex_unlock(&q->lock);
+
+		status = sw_nvme_exec(q, &cmd);
+		nvme_trace("  %s: id %u %s lba 0x%llx n %u ddr 0x%llx rc %d\n",
+			   __func__, q->id, cmd.opcode ? "write" : "read",
+			   (long long)cmd.lba, cmd.nblocks,
+			   (long long)cmd.ddr_addr, status);
+
+		pthread_mutex_lock(&q->lock);
+		slot->status = status;
+		slot->done = true;
+		q->next++;
+		pthread_cond_broadcast(&q->done);
+	}
+	pthread_mutex_unlock(&q->lock);
+	return NULL;
+}
+
+static int sw_nvme_open(struct snap_nvme_queue *q)
+{
+	char name[32];
+	const char *path;
+	struct stat st;
+
+	snprintf(name, sizeof(name), "SNAP_NVME_FILE%d", q->drive);
+	path = getenv(name);
+	if (path == NULL) {
+		nvme_trace("  %s: %s not set\n", __func__, name);
+		return SNAP_ENODEV;
+	}
+	q->fd = open(path, O_RDWR);
+	if (q->fd < 0)
+		return SNAP_ENODEV;
+	if (fstat(q->fd, &st) != 0) {
+		close(q->fd);
+		return SNAP_ENODEV;
+	}
+	q->ns_blocks = (uint64_t)st.st_size / SNAP_NVME_BLOCK_SIZE;
+
+	pthread_mutex_init(&q->lock, NULL);
+	pthread_cond_init(&q->work, NULL);
+	pthread_cond_init(&q->done, NULL);
+	if (pthread_create(&q->thread, NULL, sw_nvme_thread, q) != 0) {
+		pthread_cond_destroy(&q->done);
+		pthread_cond_destroy(&q->work);
+		pthread_mutex_destroy(&q->lock);
+		close(q->fd);
+		return SNAP_EBUSY;
+	}
+	nvme_trace("  %s: drive %d %s %lld blocks\n", __func__, q->drive,
+		   path, (long long)q->ns_blocks);
+	return SNAP_OK;
+}
+
+static void sw_nvme_close(struct snap_nvme_queue *q)
+{
+	pthread_mutex_lock(&q->lock);
+	q->stop = true;
+	pthread_cond_signal(&q->work);
+	pthread_mutex_unlock(&q->lock);
+	pthread_join(q->thread, NULL);
+
+	pthread_cond_destroy(&q->done);
+	pthread_cond_destroy(&q->work);
+	pthread_mutex_destroy(&q->lock);
+	close(q->fd);
+}
+
+int snap_nvme_emu_read(int drive, uint64_t offs, void *buf, size_t size)
+{
+	char name[32];
+	const char *path;
+	ssize_t done;
+	int fd;
+
+	snprintf(name, sizeof(name), "SNAP_NVME_FILE%d", drive);
+	path = getenv(name);
+	if (path == NULL)
+		return SNAP_ENODEV;
+	fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return SNAP_ENODEV;
+	done = pread(fd, buf, size, (off_t)offs);
+	close(fd);
+	nvme_trace("  %s: drive %d offs 0x%llx size %zu rc %zd\n", __func__,
+		   drive, (long long)offs, size, done);
+	return (done == (ssize_t)size) ? SNAP_OK : SNAP_EIO;
+}
+
+/******************************************************************************
+ * API
+ *****************************************************************************/
+
+struct snap_nvme_queue *snap_nvme_queue_alloc(struct snap_card *card,
+			int drive, unsigned int id, unsigned int depth)
+{
+	struct snap_nvme_queue *q;
+	unsigned long have_nvme = 0;
+
+	nvme_trace("%s: drive %d id %u depth %u\n", __func__, drive, id, depth);
+
+	if (card == NULL || (drive != 0 && drive != 1) ||
+	    id >= SNAP_NVME_MAX_ID || depth == 0 ||
+	    depth > SNAP_NVME_MAX_DEPTH) {
+		errno = EINVAL;
+		return NULL;
+	}
+	snap_card_ioctl(card, GET_NVME_ENABLED, (unsigned long)&have_nvme);
+	if (!have_nvme) {
+		errno = ENODEV;
+		return NULL;
+	}
+
+	q = calloc(1, sizeof(*q));
+	if (q == NULL)
+		return NULL;
+	q->ring = calloc(depth, sizeof(*q->ring));
+	if (q->ring == NULL) {
+		free(q);
+		return NULL;
+	}
+	q->card = card;
+	q->drive = drive;
+	q->id = id;
+	q->depth = depth;
+	q->sim = snap_sim_enabled();
+
+	if (q->sim && sw_nvme_open(q) != SNAP_OK) {
+		free(q->ring);
+		free(q);
+		errno = ENODEV;
+		return NULL;
+	}
+	return q;
+}
+
+void snap_nvme_queue_free(struct snap_nvme_queue *q)
+{
+	if (q == NULL)
+		return;
+
+	/* The card still writes completions for what is outstanding */
+	if (q->head != q->tail)
+		snap_nvme_reap(q, NULL, q->tail - q->head, q->tail - q->head,
+			       1000);
+	if (q->sim)
+		sw_nvme_close(q);
+	free(q->ring);
+	free(q);
+}
+
+int snap_nvme_submit(struct snap_nvme_queue *q,
+		     const struct snap_nvme_cmd *cmds, unsigned int n)
+{
+	unsigned int i, room;
+	int rc;
+
+	if (q == NULL || (n && cmds == NULL))
+		return SNAP_EINVAL;
+	if (n && nvme_cmd_check(&cmds[0]) != SNAP_OK)
+		return SNAP_EINVAL;
+
+	room = q->depth - (q->tail - q->head);
+	if (n > room)
+		n = room;
+	if (n == 0)
+		return 0;
+
+	if (!q->sim) {
+		rc = hw_nvme_submit(q, cmds, n);
+		nvme_trace("%s: id %u %d of %u queued\n", __func__, q->id,
+			   rc, n);
+		return rc;
+	}
+
+	pthread_mutex_lock(&q->lock);
+	for (i = 0; i < n; i++) {
+		if (nvme_cmd_check(&cmds[i]) != SNAP_OK)
+			break;
+		q->ring[q->tail % q->depth].cmd = cmds[i];
+		q->ring[q->tail % q->depth].done = false;
+		q->tail++;
+	}
+	pthread_cond_signal(&q->work);
+	pthread_mutex_unlock(&q->lock);
+	return i;
+}
+
+int snap_nvme_reap(struct snap_nvme_queue *q, struct snap_nvme_cpl *cpls,
+		   unsigned int min, unsigned int max, int timeout_ms)
+{
+	struct nvme_slot *slot;
+	struct timespec ts;
+	uint64_t t0 = get_usec(), dt;
+	unsigned int n = 0, delay = 1;
+	int rc = SNAP_OK;
+
+	if (q == NULL)
+		return SNAP_EINVAL;
+	if (min > max)
+		min = max;
+
+	if (q->sim)
+		pthread_mutex_lock(&q->lock);
+
+	while (1) {
+		if (!q->sim)
+			rc = hw_nvme_poll(q);
+
+		while (n < max && q->head != q->tail) {
+			slot = &q->ring[q->head % q->depth];
+			if (!slot->done)
+				break;
+			if (cpls) {
+				cpls[n].priv = slot->cmd.priv;
+				cpls[n].status = slot->status;
+			}
+			slot->done = false;
+			q->head++;
+			n++;
+		}
+		if (rc != SNAP_OK || n >= min || q->head == q->tail)
+			break;
+
+		dt = get_usec() - t0;
+		if (timeout_ms >= 0 && dt >= (uint64_t)timeout_ms * 1000)
+			break;
+
+		if (q->sim) {
+			clock_gettime(CLOCK_REALTIME, &ts);
+			ts.tv_nsec += 1000000;	/* Recheck the timeout */
+			if (ts.tv_nsec >= 1000000000) {
+				ts.tv_sec++;
+				ts.tv_nsec -= 1000000000;
+			}
+			pthread_cond_timedwait(&q->done, &q->lock, &ts);
+			continue;
+		}
+
+		/* Short sleeps first, the drive answers in tens of usec */
+		usleep(delay);
+		if (delay < NVME_POLL_MAX_US)
+			delay *= 2;
+	}
+
+	if (q->sim)
+		pthread_mutex_unlock(&q->lock);
+
+	if (rc != SNAP_OK && n == 0)
+		return rc;
+	return n;
+}
+
+unsigned int snap_nvme_pending(struct snap_nvme_queue *q)
+{
+	return q ? q->tail - q->head : 0;
+}
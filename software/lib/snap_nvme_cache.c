@@ -0,0 +1,445 @@
+/*
+ * Copyright 2017 International Business Machines
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Block cache in card DRAM on top of the NVMe queues. Line n of the drive
+ * goes to set n % sets. The slot of (set, way) is at
+ *
+ *   ddr_addr + (way * sets + set) * SNAP_NVME_CACHE_LINE_SIZE
+ *
+ * so consecutive lines which end up in the same way are also consecutive
+ * in card DRAM and are moved with one NVMe command. A range spans at
+ * most one line per set, a lookup never evicts a line it just placed.
+ *
+ * Dirty victims are written back and waited for before their slots are
+ * refilled, the NVMe host does not order commands on the same DRAM.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <errno.h>
+
+#include <libsnap.h>
+#include <snap_internal.h>
+
+#define CACHE_DEPTH		64	/* Commands in flight */
+#define CACHE_TIMEOUT_MS	1000
+#define CACHE_DDR_BOUNDARY	0x2000000ull	/* NVMe transfers, 32 MiB */
+
+struct cache_line {
+	uint64_t line;			/* lba / SNAP_NVME_CACHE_LINE_BLOCKS */
+	uint64_t used;			/* LRU stamp */
+	bool valid;
+	bool dirty;
+};
+
+/* One line to move between the drive and card DRAM */
+struct cache_io {
+	uint64_t line;
+	uint64_t ddr;
+};
+
+struct snap_nvme_cache {
+	struct snap_nvme_queue *q;
+	uint64_t ddr_addr;
+	unsigned int sets;
+	int flags;
+	uint64_t clock;			/* LRU stamps */
+	struct cache_line *lines;	/* sets * SNAP_NVME_CACHE_WAYS */
+
+	/* Scratch for one lookup or flush */
+	struct cache_io *wb;
+	struct cache_io *fill;
+	struct cache_line **slot;
+	struct snap_nvme_cmd *cmds;
+	struct snap_nvme_cpl *cpls;
+
+	struct snap_nvme_cache_stats stats;
+};
+
+static uint64_t slot_ddr(struct snap_nvme_cache *c, unsigned int set,
+			 unsigned int way)
+{
+	return c->ddr_addr + ((uint64_t)way * c->sets + set) *
+		SNAP_NVME_CACHE_LINE_SIZE;
+}
+
+/*
+ * Move n lines in one direction, waits until all are done. Runs of lines
+ * which are consecutive on the drive and in card DRAM share a command.
+ */
+static int cache_io(struct snap_nvme_cache *c, uint32_t opcode,
+		    const struct cache_io *io, unsigned int n)
+{
+	struct snap_nvme_cmd *cmd;
+	unsigned int i, ncmds = 0, sent = 0, done = 0;
+	uint64_t end;
+	int rc, err = SNAP_OK;
+
+	for (i = 0; i < n; i++) {
+		if (ncmds) {
+			cmd = &c->cmds[ncmds - 1];
+			end = cmd->ddr_addr + (uint64_t)cmd->nblocks *
+				SNAP_NVME_BLOCK_SIZE;
+			if (io[i].ddr == end &&
+			    io[i].line * SNAP_NVME_CACHE_LINE_BLOCKS ==
+			    cmd->lba + cmd->nblocks &&
+			    cmd->nblocks + SNAP_NVME_CACHE_LINE_BLOCKS <=
+			    SNAP_NVME_MAX_BLOCKS &&
+			    end % CACHE_DDR_BOUNDARY != 0) {
+				cmd->nblocks += SNAP_NVME_CACHE_LINE_BLOCKS;
+				continue;
+			}
+		}
+		cmd = &c->cmds[ncmds++];
+		cmd->opcode = opcode;
+		cmd->nblocks = SNAP_NVME_CACHE_LINE_BLOCKS;
+		cmd->lba = io[i].line * SNAP_NVME_CACHE_LINE_BLOCKS;
+		cmd->ddr_addr = io[i].ddr;
+		cmd->priv = NULL;
+	}
+
+	while (done < ncmds) {
+		if (sent < ncmds) {
+			rc = snap_nvme_submit(c->q, &c->cmds[sent],
+					      ncmds - sent);
+			if (rc < 0) {
+				err = rc;
+				ncmds = sent;	/* Only wait for what is out */
+				continue;
+			}
+			sent += rc;
+		}
+		rc = snap_nvme_reap(c->q, c->cpls, 1, CACHE_DEPTH,
+				    CACHE_TIMEOUT_MS);
+		if (rc <= 0)
+			return rc ? rc : SNAP_ETIMEDOUT;
+		for (i = 0; i < (unsigned int)rc; i++)
+			if (c->cpls[i].status != SNAP_OK)
+				err = c->cpls[i].status;
+		done += rc;
+	}
+	c->stats.nvme_cmds += sent;
+	nvme_trace("  %s: %s %u lines in %u commands rc %d\n", __func__,
+		   opcode == SNAP_NVME_READ ? "read" : "write", n, sent, err);
+	return err;
+}
+
+static struct cache_line *cache_find(struct snap_nvme_cache *c,
+				     uint64_t line)
+{
+	struct cache_line *l = &c->lines[(line % c->sets) *
+					 SNAP_NVME_CACHE_WAYS];
+	unsigned int way;
+
+	for (way = 0; way < SNAP_NVME_CACHE_WAYS; way++)
+		if (l[way].valid && l[way].line == line)
+			return &l[way];
+	return NULL;
+}
+
+/* Invalid ways first, then the least recently used one */
+static unsigned int cache_victim(struct snap_nvme_cache *c, unsigned int set)
+{
+	struct cache_line *l = &c->lines[set * SNAP_NVME_CACHE_WAYS];
+	unsigned int way, victim = 0;
+
+	for (way = 0; way < SNAP_NVME_CACHE_WAYS; way++) {
+		if (!l[way].valid)
+			return way;
+		if (l[way].used < l[victim].used)
+			victim = way;
+	}
+	return victim;
+}
+
+static int cache_lookup(struct snap_nvme_cache *c, uint64_t lba,
+			uint32_t nblocks, uint64_t *ddr_addr, bool write)
+{
+	struct cache_line *l;
+	uint64_t first, last, line;
+	unsigned int n, i, set, way, nwb = 0, nfill = 0;
+	int rc;
+
+	if (c == NULL || ddr_addr == NULL || nblocks == 0 ||
+	    lba + nblocks < lba)
+		return SNAP_EINVAL;
+	first = lba / SNAP_NVME_CACHE_LINE_BLOCKS;
+	last = (lba + nblocks - 1) / SNAP_NVME_CACHE_LINE_BLOCKS;
+	if (last - first >= c->sets)
+		return SNAP_EINVAL;
+	n = last - first + 1;
+
+	for (i = 0; i < n; i++) {
+		line = first + i;
+		set = line % c->sets;
+		l = cache_find(c, line);
+		if (l) {
+			c->stats.hits++;
+			l->used = ++c->clock;
+			c->slot[i] = l;
+			ddr_addr[i] = slot_ddr(c, set,
+				l - &c->lines[set * SNAP_NVME_CACHE_WAYS]);
+			continue;
+		}
+		c->stats.misses++;
+		way = cache_victim(c, set);
+		l = &c->lines[set * SNAP_NVME_CACHE_WAYS + way];
+		c->slot[i] = NULL;
+		ddr_addr[i] = slot_ddr(c, set, way);
+		if (l->valid && l->dirty) {
+			c->wb[nwb].line = l->line;
+			c->wb[nwb].ddr = ddr_addr[i];
+			nwb++;
+		}
+	}
+
+	rc = cache_io(c, SNAP_NVME_WRITE, c->wb, nwb);
+	if (rc != SNAP_OK)
+		return rc;
+	c->stats.writebacks += nwb;
+
+	/* The victims are clean now, take over their slots */
+	for (i = 0; i < n; i++) {
+		if (c->slot[i])
+			continue;
+		line = first + i;
+		set = line % c->sets;
+		way = (ddr_addr[i] - slot_ddr(c, set, 0)) /
+			((uint64_t)c->sets * SNAP_NVME_CACHE_LINE_SIZE);
+		l = &c->lines[set * SNAP_NVME_CACHE_WAYS + way];
+		if (l->valid)
+			c->stats.evictions++;
+		l->line = line;
+		l->used = ++c->clock;
+		l->valid = true;
+		l->dirty = false;
+		c->slot[i] = l;
+
+		/* Whole lines about to be overwritten need no data */
+		if (write && line * SNAP_NVME_CACHE_LINE_BLOCKS >= lba &&
+		    (line + 1) * SNAP_NVME_CACHE_LINE_BLOCKS <= lba + nblocks)
+			continue;
+		c->fill[nfill].line = line;
+		c->fill[nfill].ddr = ddr_addr[i];
+		nfill++;
+	}
+
+	rc = cache_io(c, SNAP_NVME_READ, c->fill, nfill);
+	if (rc != SNAP_OK) {
+		/* Do not know which of them arrived */
+		for (i = 0; i < nfill; i++) {
+			l = cache_find(c, c->fill[i].line);
+			if (l)
+				l->valid = false;
+		}
+		return rc;
+	}
+	c->stats.fills += nfill;
+	return n;
+}
+
+/******************************************************************************
+ * API
+ *****************************************************************************/
+
+struct snap_nvme_cache *snap_nvme_cache_alloc(struct snap_card *card,
+			int drive, unsigned int id, uint64_t ddr_addr,
+			uint64_t size, int flags)
+{
+	struct snap_nvme_cache *c;
+	unsigned long sdram_mb = 0;
+	uint64_t sets;
+
+	nvme_trace("%s: drive %d id %u ddr 0x%llx size 0x%llx flags %d\n",
+		   __func__, drive, id, (long long)ddr_addr, (long long)size,
+		   flags);
+
+	sets = size / (SNAP_NVME_CACHE_LINE_SIZE * SNAP_NVME_CACHE_WAYS);
+	if (card == NULL || sets == 0 || sets > 0xffffffffull ||
+	    ddr_addr % SNAP_NVME_CACHE_LINE_SIZE != 0 ||
+	    (flags != SNAP_NVME_CACHE_WRITE_BACK &&
+	     flags != SNAP_NVME_CACHE_WRITE_THROUGH)) {
+		errno = EINVAL;
+		return NULL;
+	}
+	snap_card_ioctl(card, GET_SDRAM_SIZE, (unsigned long)&sdram_mb);
+	if (sdram_mb && ddr_addr + size > (uint64_t)sdram_mb << 20) {
+		errno = EINVAL;
+		return NULL;
+	}
+	/* Actions reading a drive directly own the staging area */
+	if (ddr_addr < SNAP_NVME_STAGING_ADDR + SNAP_NVME_STAGING_SIZE &&
+	    ddr_addr + size > SNAP_NVME_STAGING_ADDR) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	c = calloc(1, sizeof(*c));
+	if (c == NULL)
+		return NULL;
+	c->ddr_addr = ddr_addr;
+	c->sets = sets;
+	c->flags = flags;
+	c->lines = calloc(sets * SNAP_NVME_CACHE_WAYS, sizeof(*c->lines));
+	c->wb = calloc(sets, sizeof(*c->wb));
+	c->fill = calloc(sets, sizeof(*c->fill));
+	c->slot = calloc(sets, sizeof(*c->slot));
+	c->cmds = calloc(sets, sizeof(*c->cmds));
+	c->cpls = calloc(CACHE_DEPTH, sizeof(*c->cpls));
+	if (c->lines == NULL || c->wb == NULL || c->fill == NULL ||
+	    c->slot == NULL || c->cmds == NULL || c->cpls == NULL)
+		goto __err;
+
+	c->q = snap_nvme_queue_alloc(card, drive, id, CACHE_DEPTH);
+	if (c->q == NULL)
+		goto __err;
+	return c;
+
+ __err:
+	free(c->cpls);
+	free(c->cmds);
+	free(c->slot);
+	free(c->fill);
+	free(c->wb);
+	free(c->lines);
+	free(c);
+	return NULL;
+}
+
+void snap_nvme_cache_free(struct snap_nvme_cache *c)
+{
+	if (c == NULL)
+		return;
+
+	snap_nvme_cache_flush(c);
+	snap_nvme_queue_free(c->q);
+	free(c->cpls);
+	free(c->cmds);
+	free(c->slot);
+	free(c->fill);
+	free(c->wb);
+	free(c->lines);
+	free(c);
+}
+
+int snap_nvme_cache_read(struct snap_nvme_cache *c, uint64_t lba,
+			 uint32_t nblocks, uint64_t *ddr_addr)
+{
+	return cache_lookup(c, lba, nblocks, ddr_addr, false);
+}
+
+int snap_nvme_cache_write(struct snap_nvme_cache *c, uint64_t lba,
+			  uint32_t nblocks, uint64_t *ddr_addr)
+{
+	return cache_lookup(c, lba, nblocks, ddr_addr, true);
+}
+
+int snap_nvme_cache_commit(struct snap_nvme_cache *c, uint64_t lba,
+			   uint32_t nblocks)
+{
+	struct cache_line *l;
+	uint64_t first, last;
+	unsigned int n, i, set;
+	int rc;
+
+	if (c == NULL || nblocks == 0 || lba + nblocks < lba)
+		return SNAP_EINVAL;
+	first = lba / SNAP_NVME_CACHE_LINE_BLOCKS;
+	last = (lba + nblocks - 1) / SNAP_NVME_CACHE_LINE_BLOCKS;
+	if (last - first >= c->sets)
+		return SNAP_EINVAL;
+	n = last - first + 1;
+
+	for (i = 0; i < n; i++) {
+		l = cache_find(c, first + i);
+		if (l == NULL)
+			return SNAP_ENOENT;
+		c->slot[i] = l;
+	}
+	if (c->flags == SNAP_NVME_CACHE_WRITE_BACK) {
+		for (i = 0; i < n; i++)
+			c->slot[i]->dirty = true;
+		return SNAP_OK;
+	}
+
+	for (i = 0; i < n; i++) {
+		set = (first + i) % c->sets;
+		c->wb[i].line = first + i;
+		c->wb[i].ddr = slot_ddr(c, set,
+			c->slot[i] - &c->lines[set * SNAP_NVME_CACHE_WAYS]);
+	}
+	rc = cache_io(c, SNAP_NVME_WRITE, c->wb, n);
+	if (rc != SNAP_OK) {
+		/* Keep them for a later flush */
+		for (i = 0; i < n; i++)
+			c->slot[i]->dirty = true;
+		return rc;
+	}
+	c->stats.writebacks += n;
+	return SNAP_OK;
+}
+
+int snap_nvme_cache_flush(struct snap_nvme_cache *c)
+{
+	struct cache_line *l;
+	unsigned int set, way, n;
+	int rc = SNAP_OK, err = SNAP_OK;
+
+	if (c == NULL)
+		return SNAP_EINVAL;
+
+	/* A way at a time, walking the sets follows card DRAM */
+	for (way = 0; way < SNAP_NVME_CACHE_WAYS; way++) {
+		n = 0;
+		for (set = 0; set < c->sets; set++) {
+			l = &c->lines[set * SNAP_NVME_CACHE_WAYS + way];
+			if (!l->valid || !l->dirty)
+				continue;
+			c->wb[n].line = l->line;
+			c->wb[n].ddr = slot_ddr(c, set, way);
+			n++;
+		}
+		rc = cache_io(c, SNAP_NVME_WRITE, c->wb, n);
+		if (rc != SNAP_OK) {
+			err = rc;
+			continue;
+		}
+		c->stats.writebacks += n;
+		for (set = 0; set < c->sets; set++)
+			c->lines[set * SNAP_NVME_CACHE_WAYS + way].dirty = false;
+	}
+	return err;
+}
+
+unsigned int snap_nvme_cache_max_lines(struct snap_nvme_cache *c)
+{
+	return c ? c->sets : 0;
+}
+
+void snap_nvme_cache_stats(struct snap_nvme_cache *c,
+			   struct snap_nvme_cache_stats *stats, int reset)
+{
+	if (c == NULL)
+		return;
+	if (stats)
+		*stats = c->stats;
+	if (reset)
+		memset(&c->stats, 0, sizeof(c->stats));
+}
@@ -0,0 +1,220 @@
+/*
+ * Copyright 2017 International Business Machines
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/time.h>
+
+#include <snap_tools.h>
+#include <libsnap.h>
+#include "mmio_script.h"
+
+#define POLL_TIMEOUT_MSEC	1000
+#define MAX_ARGS		4
+
+enum mmio_op { OP_READ, OP_WRITE, OP_POLL, OP_DELAY };
+
+static const struct {
+	const char *name;
+	enum mmio_op op;
+	int min_args;
+	int max_args;
+} mmio_ops[] = {
+	{ "read",  OP_READ,  1, 2 },
+	{ "write", OP_WRITE, 2, 2 },
+	{ "poll",  OP_POLL,  2, 4 },
+	{ "delay", OP_DELAY, 1, 1 },
+};
+
+static struct timeval t_start;
+
+static void print_val(uint32_t offs, uint64_t val, int width)
+{
+	struct timeval now;
+	long long t;
+
+	gettimeofday(&now, NULL);
+	t = timediff_usec(&now, &t_start);
+	if (width == 32)
+		printf("%lld.%06lld [%08x] %08llx\n", t / 1000000,
+		       t % 1000000, offs, (long long)val);
+	else	printf("%lld.%06lld [%08x] %016llx\n", t / 1000000,
+		       t % 1000000, offs, (long long)val);
+}
+
+static int mmio_read(struct snap_card *card, uint32_t offs, uint64_t *val,
+		     int width)
+{
+	uint32_t val32;
+	int rc;
+
+	if (width != 32)
+		return snap_mmio_read64(card, offs, val);
+
+	rc = snap_mmio_read32(card, offs, &val32);
+	*val = val32;
+	return rc;
+}
+
+static int mmio_write(struct snap_card *card, uint32_t offs, uint64_t val,
+		      int width)
+{
+	if (width != 32)
+		return snap_mmio_write64(card, offs, val);
+	return snap_mmio_write32(card, offs, (uint32_t)val);
+}
+
+/* Execute one parsed line, returns EXIT_SUCCESS or an exit code */
+static int mmio_exec(struct snap_card *card, enum mmio_op op, int width,
+		     uint64_t *arg, int nargs, int quiet, unsigned long line)
+{
+	uint32_t offs = (uint32_t)arg[0];
+	uint64_t val, mask, i, count;
+	struct timeval now, poll_start;
+	long long timeout;
+
+	switch (op) {
+	case OP_READ:
+		count = (nargs > 1) ? arg[1] : 1;
+		for (i = 0; i < count; i++, offs += (width == 32) ? 4 : 8) {
+			if (mmio_read(card, offs, &val, width) != 0) {
+				fprintf(stderr, "err: line %lu: could not read "
+					"[%08x]\n", line, offs);
+				return EXIT_FAILURE;
+			}
+			if (!quiet)
+				print_val(offs, val, width);
+		}
+		break;
+	case OP_WRITE:
+		if (mmio_write(card, offs, arg[1], width) != 0) {
+			fprintf(stderr, "err: line %lu: could not write "
+				"%016llx to [%08x]: %s\n", line,
+				(long long)arg[1], offs, strerror(errno));
+			return EXIT_FAILURE;
+		}
+		break;
+	case OP_POLL:
+		mask = (nargs > 2) ? arg[2] : 0xffffffffffffffffull;
+		timeout = (nargs > 3) ? (long long)arg[3] : POLL_TIMEOUT_MSEC;
+		gettimeofday(&poll_start, NULL);
+		while (1) {
+			if (mmio_read(card, offs, &val, width) != 0) {
+				fprintf(stderr, "err: line %lu: could not read "
+					"[%08x]\n", line, offs);
+				return EXIT_FAILURE;
+			}
+			if ((val & mask) == (arg[1] & mask))
+				break;
+			gettimeofday(&now, NULL);
+			if (timediff_usec(&now, &poll_start) / 1000 >= timeout) {
+				fprintf(stderr, "err: line %lu: [%08x] %016llx "
+					"& %016llx != %016llx after %lld msec\n",
+					line, offs, (long long)val,
+					(long long)mask, (long long)arg[1],
+					timeout);
+				return EX_ERR_DATA;
+			}
+		}
+		if (!quiet)
+			print_val(offs, val, width);
+		break;
+	case OP_DELAY:
+		usleep(arg[0]);
+		break;
+	}
+	return EXIT_SUCCESS;
+}
+
+int mmio_script_run(struct snap_card *card, const char *fname, int width,
+		    int quiet)
+{
+	FILE *fp;
+	char buf[256], *tok, *end, *save;
+	uint64_t arg[MAX_ARGS];
+	unsigned long line = 0;
+	unsigned int i;
+	int nargs, op_width, rc = EXIT_SUCCESS;
+	size_t len;
+
+	if (strcmp(fname, "-") == 0)
+		fp = stdin;
+	else
+		fp = fopen(fname, "r");
+	if (fp == NULL) {
+		fprintf(stderr, "err: cannot open %s: %s\n", fname,
+			strerror(errno));
+		return EXIT_FAILURE;
+	}
+
+	gettimeofday(&t_start, NULL);
+	while (rc == EXIT_SUCCESS && fgets(buf, sizeof(buf), fp) != NULL) {
+		line++;
+		end = strchr(buf, '#');
+		if (end)
+			*end = '\0';
+		tok = strtok_r(buf, " \t\r\n", &save);
+		if (tok == NULL)
+			continue;	/* empty or comment line */
+
+		/* Operation with optional width suffix */
+		len = strlen(tok);
+		op_width = width;
+		if (len > 2 && (strcmp(tok + len - 2, "32") == 0 ||
+				strcmp(tok + len - 2, "64") == 0)) {
+			op_width = strtol(tok + len - 2, NULL, 10);
+			tok[len - 2] = '\0';
+		}
+		for (i = 0; i < ARRAY_SIZE(mmio_ops); i++)
+			if (strcmp(tok, mmio_ops[i].name) == 0)
+				break;
+		if (i == ARRAY_SIZE(mmio_ops)) {
+			fprintf(stderr, "err: line %lu: unknown operation "
+				"%s\n", line, tok);
+			rc = EXIT_FAILURE;
+			break;
+		}
+
+		nargs = 0;
+		while ((tok = strtok_r(NULL, " \t\r\n", &save)) != NULL) {
+			if (nargs == mmio_ops[i].max_args)
+				break;
+			arg[nargs++] = strtoull(tok, &end, 0);
+			if (*end != '\0')
+				break;
+		}
+		if (tok != NULL || nargs < mmio_ops[i].min_args) {
+			fprintf(stderr, "err: line %lu: bad arguments for "
+				"%s\n", line, mmio_ops[i].name);
+			rc = EXIT_FAILURE;
+			break;
+		}
+
+		if (verbose_flag)
+			fprintf(stderr, "[%s] line %lu: %s%d\n", __func__,
+				line, mmio_ops[i].name, op_width);
+		rc = mmio_exec(card, mmio_ops[i].op, op_width, arg, nargs,
+			       quiet, line);
+	}
+
+	if (fp != stdin)
+		fclose(fp);
+	return rc;
+}
@@ -0,0 +1,43 @@
+/*
+ * Copyright 2017 International Business Machines
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __MMIO_SCRIPT_H__
+#define __MMIO_SCRIPT_H__
+
+#include <libsnap.h>
+
+/*
+ * Register scripts for snap_peek and snap_poke: one operation per
+ * line, all executed on the card handle opened once by the tool.
+ *
+ *   read[32|64]  <addr> [<count>]
+ *   write[32|64] <addr> <val>
+ *   poll[32|64]  <addr> <val> [<mask> [<timeout_msec>]]
+ *   delay        <usec>
+ *
+ * Without 32 or 64 the -w width of the tool is used. poll reads until
+ * (reg & mask) == val, mask defaults to all ones, timeout to 1000
+ * msec. Everything after a '#' is a comment. Reads and polls print
+ * "<sec.usec> [<addr>] <val>", the time counted from the script start.
+ *
+ * Runs the script in fname, "-" is stdin, until the end or the first
+ * failing line. Returns EXIT_SUCCESS, EX_ERR_DATA on a poll timeout
+ * or EXIT_FAILURE on other errors.
+ */
+int mmio_script_run(struct snap_card *card, const char *fname, int width,
+		    int quiet);
+
+#endif	/* __MMIO_SCRIPT_H__ */
@@ -16,6 +16,11 @@
 
 /*
  * SNAP NVME Maintenance tool Written by Eberhard S. Amann esa@de.ibm.com.
+ *
+ * Both drives are brought up in parallel threads. They share the
+ * indirect register pairs and the admin buffer of the NVMe host, so every
+ * multi-register access holds reg_lock. Completed steps are kept in the
+ * scratch register, a restart only does what is still missing.
  */
 
 #include <stdio.h>
@@ -29,7 +34,9 @@
 #include <errno.h>
 #include <getopt.h>
 #include <endian.h>
+#include <pthread.h>
 #include <sys/stat.h>
+#include <sys/time.h>
 
 #include <libcxl.h>
 
@@ -38,9 +45,13 @@
 #include <snap_tools.h>
 #include <snap_m_regs.h>
 
+#include "snap_nvme_model.h"
+
 static const char *version = GIT_VERSION;
 static int verbose = 0;
 static FILE *fd_out;
+static bool use_model = false;		/* Register model instead of a card */
+static pthread_mutex_t reg_lock;	/* Recursive */
 
 #define VERBOSE0(fmt, ...) do {					\
 		fprintf(fd_out, fmt, ## __VA_ARGS__);		\
@@ -86,7 +97,14 @@ static FILE *fd_out;
 #define ADMIN_ASQ_INDEX_SSD1  0xFF0000 /* Bits 23:16 SSD1 Index (we use 18:16 */
 #define ADMIN_SCRATCH_REG     0x98    /* Scratch Reg */
 
-#define DEFAULT_WAIT_US       1000     /* usec to wait */
+/* Polling starts at POLL_MIN_US and doubles up to the given maximum */
+#define POLL_MIN_US           10
+#define LINK_TIMEOUT_US       160000000 /* PCIe link training */
+#define LINK_POLL_MAX_US      100000
+#define READY_TIMEOUT_US      100000   /* Minimum, CAP.TO may give more */
+#define READY_POLL_MAX_US     10000
+#define ADMIN_TIMEOUT_US      1000000  /* Admin command */
+#define ADMIN_POLL_MAX_US     1000
 
 struct pcie_tab {
 	uint32_t addr;
@@ -126,6 +144,8 @@ static uint32_t MMIO_read(void *handle, uint32_t addr)
 	uint32_t reg;
 	int rc;
 
+	if (use_model)
+		return nvme_model_read(addr);
 	rc = snap_mmio_read32(handle, (uint64_t)addr, &reg);
 	if (0 != rc)
 		VERBOSE0("[%s] Error Addr %x\n", __func__, addr);
@@ -136,6 +156,10 @@ static void MMIO_write(void *handle, uint32_t addr, uint32_t data)
 {
 	int rc;
 
+	if (use_model) {
+		nvme_model_write(addr, data);
+		return;
+	}
 	rc = snap_mmio_write32(handle, (uint64_t)addr, data);
 	if (0 != rc)
 		VERBOSE0("[%s] Error Addr: %x\n", __func__, addr);
@@ -144,33 +168,65 @@ static void MMIO_write(void *handle, uint32_t addr, uint32_t data)
 
 static void nvme_write(void * handle, uint32_t addr, uint32_t data)
 {
+	pthread_mutex_lock(&reg_lock);
 	if (addr >= 0x30000) {
 		MMIO_write(handle, 0x30000, addr);
 		addr = 0x30004;
 	} else addr = 0x20000 + addr;
 	MMIO_write(handle, addr, data);
+	pthread_mutex_unlock(&reg_lock);
 }
 
 static uint32_t nvme_read(void *handle, uint32_t addr)
 {
 	uint32_t data;
 
+	pthread_mutex_lock(&reg_lock);
 	if (addr >= 0x30000) {
 		MMIO_write(handle, 0x30000, addr);
 		addr = 0x30004;
 	} else addr = 0x20000 + addr;
 	data = MMIO_read(handle, addr);
+	pthread_mutex_unlock(&reg_lock);
 	return data;
 }
 
-static void nvme_fill_buffer(void *handle, uint32_t *buffer, int size)
+static uint64_t get_usec(void)
+{
+	struct timeval t;
+
+	gettimeofday(&t, NULL);
+	return t.tv_sec * 1000000ull + t.tv_usec;
+}
+
+/*
+ * Sleep before the next poll. The first polls are close together, so a
+ * fast answer is not missed by much, later ones back off to max_us.
+ * Returns false once timeout_us have passed since t0.
+ */
+static bool poll_wait(uint64_t t0, uint64_t timeout_us,
+		      unsigned int *delay_us, unsigned int max_us)
+{
+	if (get_usec() - t0 >= timeout_us)
+		return false;
+	if (*delay_us < POLL_MIN_US)
+		*delay_us = POLL_MIN_US;
+	usleep(*delay_us);
+	*delay_us *= 2;
+	if (*delay_us > max_us)
+		*delay_us = max_us;
+	return true;
+}
+
+static void nvme_fill_buffer(void *handle, uint32_t *buffer, int size,
+			     uint32_t ces)
 {
 	int i;
 
 	VERBOSE2("[%s] Enter from Data @: %p Size: %d Bytes\n", __func__, buffer, size);
 	/* Set Auto increment, Enable NVME Host, Clear Error status */
 	nvme_write(handle, ADMIN_CONTROL_REG,
-		(ADMIN_CONTROL_ENA | ADMIN_CONTROL_CES | ADMIN_CONTROL_EAINC));
+		(ADMIN_CONTROL_ENA | ces | ADMIN_CONTROL_EAINC));
 	for (i = 0 ; i < size; i++)
 		nvme_write(handle, 0x100, *buffer++);
 	VERBOSE2("[%s] Exit\n", __func__);
@@ -180,12 +236,19 @@ static void nvme_fill_buffer(void *handle, uint32_t *buffer, int size)
 #define PROGRESS_ssd_0_IOQueueUp 0x02
 #define PROGRESS_ssd_1_initdone  0x04
 #define PROGRESS_ssd_1_IOQueueUp 0x08
+#define PROGRESS_ssd_0_identified 0x10
+#define PROGRESS_ssd_1_identified 0x20
 
 static uint64_t g_prog_reg;
 
 static uint32_t get_prog_reg(void)
 {
-	return g_prog_reg;
+	uint32_t prog_reg;
+
+	pthread_mutex_lock(&reg_lock);
+	prog_reg = g_prog_reg;
+	pthread_mutex_unlock(&reg_lock);
+	return prog_reg;
 }
 
 static void set_prog_reg(uint64_t prog_reg)
@@ -211,11 +274,13 @@ static void set_ssdinitdone(int drive)
 {
 	uint64_t prog_reg;
 
+	pthread_mutex_lock(&reg_lock);
 	prog_reg = get_prog_reg();
 	if (0 == drive)
 		prog_reg |= PROGRESS_ssd_0_initdone;
 	else    prog_reg |= PROGRESS_ssd_1_initdone;
 	set_prog_reg(prog_reg);
+	pthread_mutex_unlock(&reg_lock);
 }
 
 static bool ssdIOQueueUp(int drive)
@@ -236,30 +301,59 @@ static void set_ssdIOQueueUp(int drive)
 {
 	uint64_t prog_reg;
 
+	pthread_mutex_lock(&reg_lock);
 	prog_reg = get_prog_reg();
 	if (0 == drive)
 		prog_reg |= PROGRESS_ssd_0_IOQueueUp;
 	else    prog_reg |= PROGRESS_ssd_1_IOQueueUp;
 	set_prog_reg(prog_reg);
+	pthread_mutex_unlock(&reg_lock);
+}
+
+static bool ssdidentified(int drive)
+{
+	uint64_t mask;
+
+	if (0 == drive)
+		mask = PROGRESS_ssd_0_identified;
+	else    mask = PROGRESS_ssd_1_identified;
+	if (get_prog_reg() & mask)
+		return true;
+	return false;
+}
+
+static void set_ssdidentified(int drive)
+{
+	uint64_t prog_reg;
+
+	pthread_mutex_lock(&reg_lock);
+	prog_reg = get_prog_reg();
+	if (0 == drive)
+		prog_reg |= PROGRESS_ssd_0_identified;
+	else    prog_reg |= PROGRESS_ssd_1_identified;
+	set_prog_reg(prog_reg);
+	pthread_mutex_unlock(&reg_lock);
 }
 
 /*
- * Bits in PROG_REG: 7 6    5 4    3   2   1   0
- *                   ---    ---   --  --  --  --
- *                                Q1  I1  Q0  I0
+ * Bits in PROG_REG: 7 6    5   4    3   2   1   0
+ *                   ---   --  --   --  --  --  --
+ *                         D1  D0   Q1  I1  Q0  I0
  *
- * Bit 3 I0 Drive 1 ssdIOQueueUp
- * Bit 2 Q0 Drive 1 ssdinitdone
- * Bit 1 I1 Drive 1 ssdIOQueueUp
- * Bit 0 Q1 Drive 0 ssdinitdone
+ * Bit 5 D1 Drive 1 ssdidentified
+ * Bit 4 D0 Drive 0 ssdidentified
+ * Bit 3 Q1 Drive 1 ssdIOQueueUp
+ * Bit 2 I1 Drive 1 ssdinitdone
+ * Bit 1 Q0 Drive 0 ssdIOQueueUp
+ * Bit 0 I0 Drive 0 ssdinitdone
  */
 static void show_prog_reg(void)
 {
 	int i;
 
 	for (i = 0; i < MAX_SNAP_DRIVES; i++)
-		VERBOSE1("     SSD[%d] InitDone: %d QueueDone: %d\n",
-			i, ssdinitdone(i), ssdIOQueueUp(i));
+		VERBOSE1("     SSD[%d] InitDone: %d QueueDone: %d Identified: %d\n",
+			i, ssdinitdone(i), ssdIOQueueUp(i), ssdidentified(i));
 }
 
 /*
@@ -270,8 +364,10 @@ static void drive_write(void *handle, int drive, uint32_t addr, uint32_t data)
 {
 	if (1 == drive)
 		addr += 0x2000;
+	pthread_mutex_lock(&reg_lock);
 	MMIO_write(handle, 0x2008c, addr);
 	MMIO_write(handle, 0x20104, data);
+	pthread_mutex_unlock(&reg_lock);
 }
 
 static uint32_t drive_read(void *handle, int drive, uint32_t addr)
@@ -280,25 +376,36 @@ static uint32_t drive_read(void *handle, int drive, uint32_t addr)
 
 	if (1 == drive)
 		addr += 0x2000;
+	pthread_mutex_lock(&reg_lock);
 	MMIO_write(handle, 0x2008c, addr);
 	data = MMIO_read(handle, 0x20104);
+	pthread_mutex_unlock(&reg_lock);
 	return data;
 }
 
+/* CAP.TO of each drive in usec, read by nvme_init */
+static uint64_t drive_ready_timeout[MAX_SNAP_DRIVES] = {
+	READY_TIMEOUT_US, READY_TIMEOUT_US
+};
+
 static int drive_wait_for_ready(void *handle, int drive)
 {
 	int i;
 	uint32_t data;
 	int rc = 1;
+	unsigned int delay = 0;
+	uint64_t t0 = get_usec();
 
 	VERBOSE2("[%s] Enter SSD[%d]\n", __func__, drive);
-	for (i = 0; i < 100; i++) {
+	for (i = 0; ; i++) {
 		data = drive_read(handle, drive, 0x0000001c);
 		if (data) {
 			rc = 0;
 			break;
 		}
-		usleep(DEFAULT_WAIT_US);
+		if (!poll_wait(t0, drive_ready_timeout[drive], &delay,
+			       READY_POLL_MAX_US))
+			break;
 	}
 	if (0 != rc)
 		VERBOSE0("     Error SSD[%d] Not Ready after %d Retries. 0x%x\n",
@@ -308,21 +415,50 @@ static int drive_wait_for_ready(void *handle, int drive)
 	return rc;
 }
 
+/*
+ * Reading ADMIN_STATUS_REG clears the completion bits of both drives.
+ * Whatever a read returns is collected here, each drive takes its own
+ * bit. The error bit goes to the drive which sees it first. It stays
+ * set until ADMIN_CONTROL_CES, which is only written while no admin
+ * command is in flight, so it cannot get lost for the command of the
+ * other drive. Until then it is not passed on again.
+ */
+static uint32_t admin_status;
+static int admin_busy;		/* admin commands in flight */
+static bool admin_error_taken;	/* error bit went to a drive */
+
+static uint32_t admin_status_take(void *handle, uint32_t mask)
+{
+	uint32_t data;
+
+	pthread_mutex_lock(&reg_lock);
+	data = nvme_read(handle, ADMIN_STATUS_REG);
+	if (admin_error_taken)
+		data &= ~ADMIN_STATUS_ERROR;
+	else if (data & ADMIN_STATUS_ERROR)
+		admin_error_taken = true;
+	admin_status |= data;
+	data = admin_status;
+	admin_status &= ~(mask | ADMIN_STATUS_ERROR);
+	pthread_mutex_unlock(&reg_lock);
+	return data;
+}
+
 static int drive_wait_for_complete(void *handle, int drive)
 {
 	int i;
 	uint32_t data, mask;
 	int rc = 1;
+	unsigned int delay = 0;
+	uint64_t t0 = get_usec();
 
 	VERBOSE2("[%s] Enter SSD[%d]\n", __func__, drive);
-	nvme_write(handle, ADMIN_CONTROL_REG,
-		(ADMIN_CONTROL_ENA | ADMIN_CONTROL_CES));    /* Clear Error Bit */
 	if (0 == drive)
 		mask = ADMIN_STATUS_SSD0;
 	else    mask = ADMIN_STATUS_SSD1;
 
-	for (i = 0; i < 100; i++) {
-		data = nvme_read(handle, ADMIN_STATUS_REG);
+	for (i = 0; ; i++) {
+		data = admin_status_take(handle, mask);
 		if (data & ADMIN_STATUS_ERROR) {
 			VERBOSE0("   Error: SSD[%d] waiting for Admin Command to complete: 0x%x\n",
 				drive, data);
@@ -332,7 +468,8 @@ static int drive_wait_for_complete(void *handle, int drive)
 			rc = 0;     /* OK */
 			break;
 		}
-		usleep(DEFAULT_WAIT_US);
+		if (!poll_wait(t0, ADMIN_TIMEOUT_US, &delay, ADMIN_POLL_MAX_US))
+			break;
 	}
 	if (0 != rc)
 		VERBOSE0("     Error: SSD[%d] Not Ready after %d Retries. Status Reg: 0x%x\n",
@@ -361,15 +498,27 @@ static uint32_t drive_get_aq_ptr(void * handle, int drive)
 static int drive_exec(void * handle, int drive, uint32_t *data)
 {
 	int rc;
-	uint32_t cmd, offset;
+	uint32_t cmd, offset, ces;
 
 	VERBOSE2("[%s] Enter SSD[%d]\n", __func__, drive);
+	/* The admin buffer address and auto increment are shared */
+	pthread_mutex_lock(&reg_lock);
+	ces = (0 == admin_busy) ? ADMIN_CONTROL_CES : 0;
+	if (ces)
+		admin_error_taken = false;
 	offset = drive_get_aq_ptr(handle, drive);
 	nvme_write(handle, ADMIN_BUFFER_ADDR_REG, offset);
-	nvme_fill_buffer(handle, data, 16);
+	nvme_fill_buffer(handle, data, 16, ces);
+	nvme_write(handle, ADMIN_CONTROL_REG,
+		(ADMIN_CONTROL_ENA | ces));    /* Clear Error Bit */
 	cmd = 0x2 + (drive * 0x20);
 	nvme_write(handle, 0x14, cmd);
+	admin_busy++;
+	pthread_mutex_unlock(&reg_lock);
 	rc = drive_wait_for_complete(handle, drive);
+	pthread_mutex_lock(&reg_lock);
+	admin_busy--;
+	pthread_mutex_unlock(&reg_lock);
 	VERBOSE2("[%s] Exit SSD[%d] rc: %d\n", __func__, drive, rc);
 	return rc;
 }
@@ -485,47 +634,42 @@ static int wait_pcie_link_up(void *handle, int drive)
 {
 	int rc = 1;
 	uint32_t addr, data, offset;
-	int width, i, ltssm_state;
+	int i, ltssm_state;
+	const char *rate;
+	unsigned int delay = 0;
+	uint64_t t0 = get_usec();
 
 	offset = 0;    /* for drive 0 */
 	if (1 == drive)
 		offset = 0x10000000;  /* for drive 1 */
 	addr = 0x10000144 + offset;
 	data = nvme_read(handle, addr);
-	/* Decode Status */
-	VERBOSE1("SSD[%d] PCIE ", drive);
-	/* Wait Until PCIE Link is up */
-	for (i = 0; i < 80; i++) {
+	/* Wait Until PCIE Link is up, each message in one line */
+	for (i = 0; ; i++) {
 		data = nvme_read(handle, addr);
 		/* Decode PCIE State Machine state */
 		ltssm_state = (data & 0x1f8) >> 3;
-		VERBOSE2("\nSSD[%d] (%2.2d) PCIE State: %2.2d",
+		VERBOSE2("SSD[%d] (%2.2d) PCIE State: %2.2d\n",
 			drive, i, ltssm_state);
 		if (0x800 & data) {    /* Check for Link Up */
-			VERBOSE1(" -> UP (after %d sec).\n", i*2);
+			VERBOSE1("SSD[%d] PCIE -> UP (after %lld msec).\n",
+				drive, (long long)(get_usec() - t0) / 1000);
 			rc = 0;
 			break;
 		}
-		sleep(2);
+		if (!poll_wait(t0, LINK_TIMEOUT_US, &delay, LINK_POLL_MAX_US))
+			break;
 	}
-	VERBOSE1("SSD[%d] PCIE Link Rate: ", drive);
 	if (0x1000 & data)
-		VERBOSE1("Gen3");
-	else {
-		if (0x1 & data)
-			VERBOSE1("Gen2 @ 5 GT/s");
-		else    VERBOSE1("Gen2 @ 2.5 GT/s");
-	}
-	width = (data & 0x6) >> 1;
-	VERBOSE1(" Link With: ");
-	switch (width) {
-		case 0: VERBOSE1("1\n"); break;
-		case 1: VERBOSE1("2\n"); break;
-		case 2: VERBOSE1("4\n"); break;
-		case 3: VERBOSE1("8\n"); break;
-	}
+		rate = "Gen3";
+	else if (0x1 & data)
+		rate = "Gen2 @ 5 GT/s";
+	else	rate = "Gen2 @ 2.5 GT/s";
+	VERBOSE1("SSD[%d] PCIE Link Rate: %s Link With: %d\n", drive, rate,
+		1 << ((data & 0x6) >> 1));
 	if (0 != rc)
-		VERBOSE0("Error: PCIE Link Reports: 0x%8.8x\n", data);
+		VERBOSE0("Error: SSD[%d] PCIE Link Reports: 0x%8.8x\n",
+			drive, data);
 	return rc;
 }
 
@@ -579,11 +723,14 @@ static int nvme_init(void *handle, int drive)
 		drive_offset = 0x10000000;
 	else drive_offset = 0;
 	data = drive_read(handle, drive, 0x0000);
-	VERBOSE1("           Cap Register(0): 0x%8.8x\n", data);
+	VERBOSE1("     SSD[%d] Cap Register(0): 0x%8.8x\n", drive, data);
+	/* CAP.TO in 500 msec units, worst case time to get ready */
+	if (((data >> 24) & 0xff) * 500000ull > READY_TIMEOUT_US)
+		drive_ready_timeout[drive] = ((data >> 24) & 0xff) * 500000ull;
 	data = drive_read(handle, drive, 0x0004);
 	mps = (data >> 20) & 0xf;
-	VERBOSE1("           Cap Register(4): 0x%8.8x Max Page Size: 0x%x\n",
-		data, mps);
+	VERBOSE1("     SSD[%d] Cap Register(4): 0x%8.8x Max Page Size: 0x%x\n",
+		drive, data, mps);
 	data = (4 << 20) | (6 << 16) | (mps << 7);
 	drive_write(handle, drive, 0x14, data);
 
@@ -607,11 +754,18 @@ static int nvme_init2(void *handle, int drive)
 	VERBOSE2("[%s] Enter SSD[%d]\n", __func__, drive);
 	data = drive_read(handle, drive, 0x003c);
 	VERBOSE1("     SSD[%d] Capability Register: 0x%x\n", drive, data);
+	/* Warm restart, the drive kept features and queues */
+	if (ssdidentified(drive) && ssdIOQueueUp(drive)) {
+		VERBOSE1("     SSD[%d] Identified and I/O Queues up\n", drive);
+		return 0;
+	}
 	rc = drive_get_features(handle, drive);
 	if (0 == rc)
 		rc = drive_set_features(handle, drive);
 	if (0 == rc)
 		rc = drive_send_identify2(handle, drive);
+	if (0 == rc)
+		set_ssdidentified(drive);
 	if (0 == rc) {
 		if (!ssdIOQueueUp(drive)) {
 			rc = create_io_queues(handle, drive);
@@ -625,15 +779,91 @@ static int nvme_init2(void *handle, int drive)
 	return rc;
 }
 
+struct drive_bringup {
+	void *handle;
+	int drive;
+	pthread_t tid;
+	int rc;
+};
+
+static void *drive_bringup(void *arg)
+{
+	struct drive_bringup *b = (struct drive_bringup *)arg;
+	void *handle = b->handle;
+	int drive = b->drive;
+	int rc;
+
+	VERBOSE1("Init SSD[%d]\n", drive);
+	rc = wait_pcie_link_up(handle, drive);
+	if (0 == rc) {
+		/* Init NVME PCIe */
+		if (false == ssdinitdone(drive)) {
+			pcie_setup(handle, drive);
+			rc = nvme_init(handle, drive);
+			if (0 == rc)
+				set_ssdinitdone(drive);
+		}
+		if (ssdinitdone(drive))
+			rc = nvme_init2(handle, drive);
+	}
+	b->rc = rc;
+	return NULL;
+}
+
+/* Bring up all drives in drive_mask in parallel */
+static int nvme_bringup(void *handle, unsigned int drive_mask)
+{
+	struct drive_bringup b[MAX_SNAP_DRIVES];
+	int drive, rc = 0;
+
+	/* set Namespace Identifier to 1 */
+	nvme_write(handle, ADMIN_NSID_REG, 1);
+	/* enable NVMe host */
+	nvme_write(handle, ADMIN_CONTROL_REG, ADMIN_CONTROL_ENA);
+
+	/* Get Prog Reg */
+	g_prog_reg = nvme_read(handle, ADMIN_SCRATCH_REG);
+	show_prog_reg();
+
+	for (drive = 0; drive < MAX_SNAP_DRIVES; drive++) {
+		b[drive].handle = handle;
+		b[drive].drive = drive;
+		b[drive].rc = 0;
+		/* Check which drive to init */
+		if (0 == (drive_mask & (1 << drive)))
+			continue;
+		if (0 != pthread_create(&b[drive].tid, NULL,
+					drive_bringup, &b[drive])) {
+			VERBOSE0("Error: Cannot start SSD[%d] thread, "
+				 "running it inline\n", drive);
+			drive_mask &= ~(1 << drive);
+			drive_bringup(&b[drive]);
+		}
+	}
+	for (drive = 0; drive < MAX_SNAP_DRIVES; drive++) {
+		if (drive_mask & (1 << drive))
+			pthread_join(b[drive].tid, NULL);
+		if (0 != b[drive].rc)
+			rc = b[drive].rc;
+	}
+
+	/* Save Prog Reg */
+	nvme_write(handle, ADMIN_SCRATCH_REG, g_prog_reg);
+	show_prog_reg();
+	return rc;
+}
+
 static void help(char *prog)
 {
 	printf("\n\tSNAP tool to Init NVME Drives.\n");
-	printf("Usage: %s [-CvhV] [-d drive]\n"
+	printf("Usage: %s [-CvhVM] [-d drive]\n"
 		"\t-C, --card <num> Card to use (default 0)\n"
 		"\t-V, --version  Print Version number\n"
 		"\t-h, --help     this help message\n"
 		"\t-v, --verbose  verbose mode, up to -vvv\n"
-		"\t-d, --drive    Nvme Drive (0 or 1), default: 0 and 1\n\n",
+		"\t-d, --drive    Nvme Drive (0 or 1), default: 0 and 1\n"
+		"\t-M, --model    Use a register model instead of the card, runs\n"
+		"\t               a cold start and a warm restart\n\n",
 	       prog);
 }
 
@@ -651,6 +881,9 @@ int main(int argc, char *argv[])
 	unsigned long have_nvme = 0;
 	unsigned int drive_mask = 0x03;       /* Enable drive 0 and 1 bits in mask */
 	unsigned int new_drive_mask = 0x00;
+	pthread_mutexattr_t attr;
+	uint64_t t0;
+	int pass;
 
 	while (1) {
 		int option_index = 0;
@@ -660,9 +893,10 @@ int main(int argc, char *argv[])
 			{ "help",       no_argument,       NULL, 'h' },
 			{ "verbose",    no_argument,       NULL, 'v' },
 			{ "drive",      required_argument, NULL, 'd' },
+			{ "model",      no_argument,       NULL, 'M' },
 			{ 0,		0,                 NULL,  0  }
 		};
-		ch = getopt_long(argc, argv, "C:d:Vhv",
+		ch = getopt_long(argc, argv, "C:d:VhvM",
 			long_options, &option_index);
 		if (-1 == ch)
 			break;
@@ -695,21 +929,44 @@ int main(int argc, char *argv[])
 			}
 			new_drive_mask |= 1 << drive;
 			break;
+		case 'M':	/* --model */
+			use_model = true;
+			break;
 		default:
 			help(argv[0]);
 			exit(EXIT_FAILURE);
 		}
 	}
 
+	pthread_mutexattr_init(&attr);
+	pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+	pthread_mutex_init(&reg_lock, &attr);
+	pthread_mutexattr_destroy(&attr);
+
+	if (0 != new_drive_mask)
+		drive_mask = new_drive_mask;
+
+	if (use_model) {
+		/* Same model state for both passes, like a rerun on the card */
+		for (pass = 0; pass < 2; pass++) {
+			VERBOSE0("Model %s\n", pass ? "warm restart" : "cold start");
+			t0 = get_usec();
+			rc = nvme_bringup(NULL, drive_mask);
+			VERBOSE0("     rc: %d after %lld msec\n", rc,
+				(long long)(get_usec() - t0) / 1000);
+			nvme_model_stats(fd_out);
+			if (0 != rc)
+				break;
+		}
+		exit(rc);
+	}
+
 	handle = snap_open(card);
 	if (NULL == handle) {
 		rc = ENODEV;
 		goto __main_exit;
 	}
 
-	if (0 != new_drive_mask)
-		drive_mask = new_drive_mask;
-
 	/* Check if i do have NVME on this card */
 	snap_card_ioctl(handle, GET_NVME_ENABLED, (unsigned long)&have_nvme);
 	if (0 == have_nvme) {
@@ -718,36 +975,7 @@ int main(int argc, char *argv[])
 		goto __main_exit1;
 	}
 
-	/* set Namespace Identifier to 1 */
-	nvme_write(handle, ADMIN_NSID_REG, 1);
-	/* enable NVMe host */
-	nvme_write(handle, ADMIN_CONTROL_REG, ADMIN_CONTROL_ENA);
-
-	/* Get Prog Reg */
-	g_prog_reg = nvme_read(handle, ADMIN_SCRATCH_REG);
-
-	for (drive = 0; drive < MAX_SNAP_DRIVES; drive++) {
-		/* Check which drive to init */
-		if (0 == (drive_mask & (1 << drive)))
-			continue;
-		VERBOSE1("Init SSD[%d]\n", drive);
-		show_prog_reg();
-		rc = wait_pcie_link_up(handle, drive);
-		if (0 == rc) {
-			/* Init NVME PCIe */
-			if (false == ssdinitdone(drive)) {
-				pcie_setup(handle, drive);
-				rc = nvme_init(handle, drive);
-				if (0 == rc)
-					set_ssdinitdone(drive);
-			}
-			if (ssdinitdone(drive))
-				rc = nvme_init2(handle, drive);
-		}
-	}
-
-	/* Save Prog Reg */
-	nvme_write(handle, ADMIN_SCRATCH_REG, g_prog_reg);
+	rc = nvme_bringup(handle, drive_mask);
 __main_exit1:
 	VERBOSE1("Exit rc: %d\n", rc);
 
@@ -0,0 +1,623 @@
+/*
+ * Copyright 2017 International Business Machines
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * SNAP NVMe I/O load through the libsnap NVMe queues. Keeps a number of
+ * commands outstanding between card DRAM and one drive and reports the
+ * rate. With --check a range is written and read back, in software mode
+ * the data is compared in the emulated card DRAM.
+ *
+ * With --cache the same load goes through a block cache in card DRAM,
+ * repeated --passes times to show hits on the second scan.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <errno.h>
+#include <getopt.h>
+#include <sys/time.h>
+
+#include <libsnap.h>
+#include <snap_internal.h>
+#include <snap_tools.h>
+
+static const char *version = GIT_VERSION;
+static int verbose = 0;
+
+#define VERBOSE0(fmt, ...) do {					\
+		printf(fmt, ## __VA_ARGS__);			\
+	} while (0)
+
+#define VERBOSE1(fmt, ...) do {					\
+		if (verbose > 0)				\
+			printf(fmt, ## __VA_ARGS__);		\
+	} while (0)
+
+#define DEFAULT_DEPTH		64
+#define DEFAULT_BLOCKS		8		/* 4 KiB commands */
+#define DEFAULT_COUNT		10000
+#define DEFAULT_RANGE		0x100000	/* 512 MiB of the drive */
+#define DEFAULT_ID		1		/* Actions use id 0 */
+#define DEFAULT_PASSES		2
+#define REAP_TIMEOUT_MS		1000
+
+struct nvme_job {
+	int opcode;
+	bool random;
+	uint32_t blocks;
+	uint64_t lba;		/* First LBA of the range */
+	uint64_t range;		/* Blocks in the range */
+	uint64_t ddr;		/* Card DRAM for the data */
+	unsigned long count;	/* Commands to run */
+	unsigned int passes;	/* Cache mode only */
+};
+
+static uint64_t get_usec(void)
+{
+	struct timeval t;
+
+	gettimeofday(&t, NULL);
+	return t.tv_sec * 1000000ull + t.tv_usec;
+}
+
+static uint64_t xorshift64(uint64_t *s)
+{
+	*s ^= *s << 13;
+	*s ^= *s >> 7;
+	*s ^= *s << 17;
+	return *s;
+}
+
+/*
+ * Run count commands with up to depth of them in flight. Command i uses
+ * card DRAM slot i % depth, sequential jobs walk the range and wrap.
+ */
+static int nvme_run(struct snap_nvme_queue *q, const struct nvme_job *job,
+		    unsigned int depth)
+{
+	struct snap_nvme_cmd *cmds;
+	struct snap_nvme_cpl *cpls;
+	unsigned long sent = 0, done = 0, errors = 0;
+	uint64_t seed = 0x9e3779b97f4a7c15ull, slots, t0, dt;
+	uint32_t bytes = job->blocks * SNAP_NVME_BLOCK_SIZE;
+	unsigned int i, n;
+	int rc = 0;
+
+	cmds = calloc(depth, sizeof(*cmds));
+	cpls = calloc(depth, sizeof(*cpls));
+	if (cmds == NULL || cpls == NULL) {
+		rc = ENOMEM;
+		goto __exit;
+	}
+	slots = job->range / job->blocks;
+
+	t0 = get_usec();
+	while (done < job->count) {
+		n = depth - snap_nvme_pending(q);
+		if (n > job->count - sent)
+			n = job->count - sent;
+		for (i = 0; i < n; i++) {
+			unsigned long c = sent + i;
+
+			cmds[i].opcode = job->opcode;
+			cmds[i].nblocks = job->blocks;
+			cmds[i].lba = job->lba + job->blocks *
+				(job->random ? xorshift64(&seed) % slots
+					     : c % slots);
+			cmds[i].ddr_addr = job->ddr + (uint64_t)(c % depth) * bytes;
+			cmds[i].priv = (void *)c;
+		}
+		if (n) {
+			rc = snap_nvme_submit(q, cmds, n);
+			if (rc < 0) {
+				VERBOSE0("Error: submit rc %d\n", rc);
+				rc = EINVAL;
+				goto __exit;
+			}
+			sent += rc;
+		}
+
+		rc = snap_nvme_reap(q, cpls, 1, depth, REAP_TIMEOUT_MS);
+		if (rc < 0) {
+			VERBOSE0("Error: reap rc %d\n", rc);
+			rc = EIO;
+			goto __exit;
+		}
+		if (rc == 0) {
+			VERBOSE0("Error: timeout, %u commands pending\n",
+				 snap_nvme_pending(q));
+			rc = ETIME;
+			goto __exit;
+		}
+		for (i = 0; i < (unsigned int)rc; i++) {
+			if (cpls[i].status == SNAP_OK)
+				continue;
+			if (errors++ < 10)
+				VERBOSE0("Error: command %lu status %d\n",
+					 (unsigned long)cpls[i].priv,
+					 cpls[i].status);
+		}
+		done += rc;
+	}
+	dt = get_usec() - t0;
+	rc = errors ? EIO : 0;
+
+	VERBOSE0("%s %lu x %u bytes %s, depth %u: %llu usec, "
+		 "%.0f IOPS %.3f MB/sec\n",
+		 job->opcode == SNAP_NVME_READ ? "read" : "write",
+		 done, bytes, job->random ? "random" : "sequential", depth,
+		 (long long)dt, dt ? done * 1e6 / dt : 0.0,
+		 dt ? (double)done * bytes / dt : 0.0);
+ __exit:
+	free(cmds);
+	free(cpls);
+	return rc;
+}
+
+/* Pattern of a block, word i counted from lba */
+static uint64_t nvme_pattern(uint64_t lba, uint64_t i)
+{
+	return (lba * SNAP_NVME_BLOCK_SIZE + i * 8) ^ 0x5a5a5a5a00000000ull;
+}
+
+/* Write the range from one DRAM area, read it into another and compare */
+static int nvme_check(struct snap_card *card, struct snap_nvme_queue *q,
+		      struct nvme_job *job)
+{
+	uint64_t size = job->range * SNAP_NVME_BLOCK_SIZE, i;
+	uint64_t *src, *dst;
+	int rc;
+
+	src = snap_card_ddr_emu(card, job->ddr, size);
+	dst = snap_card_ddr_emu(card, job->ddr + size, size);
+	if (src == NULL || dst == NULL) {
+		VERBOSE0("Error: --check needs the emulated card DRAM "
+			 "(SNAP_CONFIG=1) to hold 2 x %lld bytes\n",
+			 (long long)size);
+		return EINVAL;
+	}
+	for (i = 0; i < size / 8; i++)
+		src[i] = nvme_pattern(job->lba, i);
+	memset(dst, 0xff, size);
+
+	/* Slot i % depth with depth = range / blocks covers the range once */
+	job->count = job->range / job->blocks;
+	job->random = false;
+	job->opcode = SNAP_NVME_WRITE;
+	rc = nvme_run(q, job, job->count);
+	if (rc)
+		return rc;
+
+	job->ddr += size;
+	job->opcode = SNAP_NVME_READ;
+	rc = nvme_run(q, job, job->count);
+	if (rc)
+		return rc;
+
+	for (i = 0; i < size / 8; i++) {
+		if (src[i] != dst[i]) {
+			VERBOSE0("Error: offset 0x%llx expect 0x%016llx "
+				 "read 0x%016llx\n", (long long)i * 8,
+				 (long long)src[i], (long long)dst[i]);
+			return EIO;
+		}
+	}
+	VERBOSE0("check %lld bytes OK\n", (long long)size);
+	return 0;
+}
+
+/*
+ * Run the job through the cache, each pass issues count lookups. Writes
+ * are committed without touching the data in card DRAM.
+ */
+static int cache_run(struct snap_nvme_cache *c, const struct nvme_job *job)
+{
+	struct snap_nvme_cache_stats st;
+	uint64_t seed, slots, lba, t0, dt;
+	uint64_t *ddr;
+	unsigned long i;
+	unsigned int pass;
+	int rc = 0;
+
+	ddr = calloc(snap_nvme_cache_max_lines(c), sizeof(*ddr));
+	if (ddr == NULL)
+		return ENOMEM;
+	slots = job->range / job->blocks;
+
+	for (pass = 0; pass < job->passes; pass++) {
+		seed = 0x9e3779b97f4a7c15ull;	/* Same blocks every pass */
+		snap_nvme_cache_stats(c, NULL, 1);
+		t0 = get_usec();
+		for (i = 0; i < job->count; i++) {
+			lba = job->lba + job->blocks *
+				(job->random ? xorshift64(&seed) % slots
+					     : i % slots);
+			if (job->opcode == SNAP_NVME_READ) {
+				rc = snap_nvme_cache_read(c, lba, job->blocks,
+							  ddr);
+			} else {
+				rc = snap_nvme_cache_write(c, lba, job->blocks,
+							   ddr);
+				if (rc >= 0)
+					rc = snap_nvme_cache_commit(c, lba,
+							job->blocks);
+			}
+			if (rc < 0) {
+				VERBOSE0("Error: lba 0x%llx rc %d\n",
+					 (long long)lba, rc);
+				rc = EIO;
+				goto __exit;
+			}
+		}
+		dt = get_usec() - t0;
+		snap_nvme_cache_stats(c, &st, 0);
+		VERBOSE0("pass %u: %s %lu x %u bytes %s: %llu usec, "
+			 "%.0f IOPS %.3f MB/sec\n", pass,
+			 job->opcode == SNAP_NVME_READ ? "read" : "write",
+			 job->count, job->blocks * SNAP_NVME_BLOCK_SIZE,
+			 job->random ? "random" : "sequential", (long long)dt,
+			 dt ? job->count * 1e6 / dt : 0.0,
+			 dt ? (double)job->count * job->blocks *
+			 SNAP_NVME_BLOCK_SIZE / dt : 0.0);
+		VERBOSE0("        lines hit %llu miss %llu (%.1f%% hits) "
+			 "fill %llu writeback %llu evict %llu, "
+			 "%llu NVMe commands\n",
+			 (long long)st.hits, (long long)st.misses,
+			 st.hits + st.misses ?
+			 100.0 * st.hits / (st.hits + st.misses) : 0.0,
+			 (long long)st.fills, (long long)st.writebacks,
+			 (long long)st.evictions, (long long)st.nvme_cmds);
+		rc = 0;
+	}
+ __exit:
+	free(ddr);
+	return rc;
+}
+
+/*
+ * Write the range through the cache, flush it and read it back past the
+ * cache region with the plain queue. Then read it through the cache.
+ */
+static int cache_check(struct snap_card *card, struct snap_nvme_cache *c,
+		       struct snap_nvme_queue *q, struct nvme_job *job,
+		       uint64_t cache_size)
+{
+	uint64_t size = job->range * SNAP_NVME_BLOCK_SIZE, lba, *p, *dst;
+	uint64_t ddr[SNAP_NVME_MAX_BLOCKS / SNAP_NVME_CACHE_LINE_BLOCKS + 1];
+	unsigned int i, j, k, n, w, first;
+	int rc;
+
+	if (job->blocks > snap_nvme_cache_max_lines(c) *
+	    SNAP_NVME_CACHE_LINE_BLOCKS - SNAP_NVME_CACHE_LINE_BLOCKS)
+		job->blocks = SNAP_NVME_CACHE_LINE_BLOCKS;
+
+	/* Written through the cache */
+	for (lba = job->lba; lba < job->lba + job->range; lba += n) {
+		n = job->lba + job->range - lba;
+		if (n > job->blocks)
+			n = job->blocks;
+		rc = snap_nvme_cache_write(c, lba, n, ddr);
+		if (rc < 0)
+			goto __err;
+		first = lba % SNAP_NVME_CACHE_LINE_BLOCKS;
+		for (i = 0, k = 0; k < n; i++, first = 0) {
+			for (j = first; j < SNAP_NVME_CACHE_LINE_BLOCKS &&
+				     k < n; j++, k++) {
+				p = snap_card_ddr_emu(card, ddr[i] +
+					j * SNAP_NVME_BLOCK_SIZE,
+					SNAP_NVME_BLOCK_SIZE);
+				if (p == NULL)
+					goto __emu;
+				for (w = 0; w < SNAP_NVME_BLOCK_SIZE / 8; w++)
+					p[w] = nvme_pattern(lba + k, w);
+			}
+		}
+		rc = snap_nvme_cache_commit(c, lba, n);
+		if (rc < 0)
+			goto __err;
+	}
+	rc = snap_nvme_cache_flush(c);
+	if (rc < 0)
+		goto __err;
+
+	/* Read back without the cache */
+	dst = snap_card_ddr_emu(card, job->ddr + cache_size, size);
+	if (dst == NULL)
+		goto __emu;
+	memset(dst, 0xff, size);
+	job->ddr += cache_size;
+	job->count = job->range / job->blocks;
+	job->random = false;
+	job->opcode = SNAP_NVME_READ;
+	rc = nvme_run(q, job, job->count);
+	job->ddr -= cache_size;
+	if (rc)
+		return rc;
+	for (i = 0; i < size / 8; i++) {
+		if (dst[i] != nvme_pattern(job->lba, i)) {
+			VERBOSE0("Error: offset 0x%llx expect 0x%016llx "
+				 "read 0x%016llx\n", (long long)i * 8,
+				 (long long)nvme_pattern(job->lba, i),
+				 (long long)dst[i]);
+			return EIO;
+		}
+	}
+
+	/* And through the cache, block by block */
+	for (lba = job->lba; lba < job->lba + job->range; lba++) {
+		rc = snap_nvme_cache_read(c, lba, 1, ddr);
+		if (rc < 0)
+			goto __err;
+		p = snap_card_ddr_emu(card, ddr[0] + (lba %
+			SNAP_NVME_CACHE_LINE_BLOCKS) * SNAP_NVME_BLOCK_SIZE,
+			SNAP_NVME_BLOCK_SIZE);
+		if (p == NULL)
+			goto __emu;
+		for (i = 0; i < SNAP_NVME_BLOCK_SIZE / 8; i++) {
+			if (p[i] != nvme_pattern(lba, i)) {
+				VERBOSE0("Error: cache lba 0x%llx word %u "
+					 "read 0x%016llx\n", (long long)lba,
+					 i, (long long)p[i]);
+				return EIO;
+			}
+		}
+	}
+	VERBOSE0("cache check %lld bytes OK\n", (long long)size);
+	return 0;
+
+ __emu:
+	VERBOSE0("Error: --check needs the emulated card DRAM "
+		 "(SNAP_CONFIG=1)\n");
+	return EINVAL;
+ __err:
+	VERBOSE0("Error: cache lba 0x%llx rc %d\n", (long long)lba, rc);
+	return EIO;
+}
+
+static void help(char *prog)
+{
+	printf("\n\tSNAP tool to run NVMe I/O from card DRAM.\n");
+	printf("Usage: %s [-CvhV] [-d drive] [-wRc] ...\n"
+		"\t-C, --card <num>    Card to use (default 0)\n"
+		"\t-V, --version       Print Version number\n"
+		"\t-h, --help          this help message\n"
+		"\t-v, --verbose       verbose mode\n"
+		"\t-d, --drive <0|1>   Nvme Drive (default 0)\n"
+		"\t-i, --id <id>       NVMe host tracking id (default %d)\n"
+		"\t-q, --depth <n>     Commands in flight (default %d, max %d)\n"
+		"\t-b, --blocks <n>    Blocks of %d bytes per command "
+		"(default %d)\n"
+		"\t-n, --count <n>     Number of commands (default %d)\n"
+		"\t-s, --lba <lba>     First block of the range (default 0)\n"
+		"\t-r, --range <n>     Blocks in the range (default 0x%x)\n"
+		"\t-a, --ddr <addr>    Card DRAM for the data (default 0)\n"
+		"\t-w, --write         Write instead of read\n"
+		"\t-R, --random        Random instead of sequential blocks\n"
+		"\t-c, --check         Write the range, read it back and "
+		"compare\n"
+		"\t-k, --cache <MiB>   Go through a block cache of this size "
+		"at --ddr\n"
+		"\t-W, --write-through Write-through cache (default "
+		"write-back)\n"
+		"\t-p, --passes <n>    Cache passes over the load (default "
+		"%d)\n\n"
+		"\tIn software mode (SNAP_CONFIG=1) drive N is the file in\n"
+		"\tSNAP_NVME_FILE<N>.\n\n",
+		prog, DEFAULT_ID, DEFAULT_DEPTH, SNAP_NVME_MAX_DEPTH,
+		SNAP_NVME_BLOCK_SIZE, DEFAULT_BLOCKS, DEFAULT_COUNT,
+		DEFAULT_RANGE, DEFAULT_PASSES);
+}
+
+int main(int argc, char *argv[])
+{
+	int rc = EXIT_SUCCESS;
+	int ch;
+	char device[64];
+	struct snap_card *card = NULL;
+	struct snap_nvme_queue *q = NULL;
+	struct snap_nvme_cache *c = NULL;
+	uint64_t cache_size = 0;
+	int cache_flags = SNAP_NVME_CACHE_WRITE_BACK;
+	struct nvme_job job;
+	int card_no = 0;
+	int drive = 0;
+	unsigned int id = DEFAULT_ID;
+	unsigned int depth = DEFAULT_DEPTH;
+	bool check = false;
+
+	memset(&job, 0, sizeof(job));
+	job.opcode = SNAP_NVME_READ;
+	job.blocks = DEFAULT_BLOCKS;
+	job.count = DEFAULT_COUNT;
+	job.range = DEFAULT_RANGE;
+	job.passes = DEFAULT_PASSES;
+
+	while (1) {
+		int option_index = 0;
+		static struct option long_options[] = {
+			{ "card",       required_argument, NULL, 'C' },
+			{ "version",    no_argument,       NULL, 'V' },
+			{ "help",       no_argument,       NULL, 'h' },
+			{ "verbose",    no_argument,       NULL, 'v' },
+			{ "drive",      required_argument, NULL, 'd' },
+			{ "id",         required_argument, NULL, 'i' },
+			{ "depth",      required_argument, NULL, 'q' },
+			{ "blocks",     required_argument, NULL, 'b' },
+			{ "count",      required_argument, NULL, 'n' },
+			{ "lba",        required_argument, NULL, 's' },
+			{ "range",      required_argument, NULL, 'r' },
+			{ "ddr",        required_argument, NULL, 'a' },
+			{ "write",      no_argument,       NULL, 'w' },
+			{ "random",     no_argument,       NULL, 'R' },
+			{ "check",      no_argument,       NULL, 'c' },
+			{ "cache",      required_argument, NULL, 'k' },
+			{ "write-through", no_argument,    NULL, 'W' },
+			{ "passes",     required_argument, NULL, 'p' },
+			{ 0,		0,                 NULL,  0  }
+		};
+		ch = getopt_long(argc, argv, "C:d:i:q:b:n:s:r:a:wRck:Wp:Vhv",
+			long_options, &option_index);
+		if (-1 == ch)
+			break;
+		switch (ch) {
+		case 'C':	/* --card */
+			card_no = strtol(optarg, (char **)NULL, 0);
+			if ((card_no < 0) || (card_no >= 4)) {
+				fprintf(stderr, "Err: %d for option -C is invalid, please provide "
+					"0..3!\n", card_no);
+				exit(EXIT_FAILURE);
+			}
+			break;
+		case 'V':	/* --version */
+			printf("%s\n", version);
+			exit(EXIT_SUCCESS);
+			break;
+		case 'h':       /* help */
+			help(argv[0]);
+			exit(EXIT_SUCCESS);
+			break;
+		case 'v':	/* --verbose */
+			verbose++;
+			break;
+		case 'd':       /* drive */
+			drive = strtol(optarg, NULL, 0);
+			if ((drive > 1) || (drive < 0)) {
+				fprintf(stderr, "Please provide correct "
+					"SSD[%d] (Must be 0 or 1)\n", drive);
+				exit(EXIT_FAILURE);
+			}
+			break;
+		case 'i':	/* --id */
+			id = strtoul(optarg, NULL, 0);
+			break;
+		case 'q':	/* --depth */
+			depth = strtoul(optarg, NULL, 0);
+			break;
+		case 'b':	/* --blocks */
+			job.blocks = strtoul(optarg, NULL, 0);
+			break;
+		case 'n':	/* --count */
+			job.count = strtoul(optarg, NULL, 0);
+			break;
+		case 's':	/* --lba */
+			job.lba = strtoull(optarg, NULL, 0);
+			break;
+		case 'r':	/* --range */
+			job.range = strtoull(optarg, NULL, 0);
+			break;
+		case 'a':	/* --ddr */
+			job.ddr = strtoull(optarg, NULL, 0);
+			break;
+		case 'w':	/* --write */
+			job.opcode = SNAP_NVME_WRITE;
+			break;
+		case 'R':	/* --random */
+			job.random = true;
+			break;
+		case 'c':	/* --check */
+			check = true;
+			break;
+		case 'k':	/* --cache */
+			cache_size = strtoull(optarg, NULL, 0) << 20;
+			break;
+		case 'W':	/* --write-through */
+			cache_flags = SNAP_NVME_CACHE_WRITE_THROUGH;
+			break;
+		case 'p':	/* --passes */
+			job.passes = strtoul(optarg, NULL, 0);
+			break;
+		default:
+			help(argv[0]);
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	if (job.blocks == 0 || job.blocks > SNAP_NVME_MAX_BLOCKS ||
+	    job.range < job.blocks) {
+		fprintf(stderr, "Err: need 1 <= blocks <= min(range, %d)\n",
+			SNAP_NVME_MAX_BLOCKS);
+		exit(EXIT_FAILURE);
+	}
+	if (check && job.range % job.blocks) {
+		fprintf(stderr, "Err: --check needs range to be a multiple "
+			"of blocks\n");
+		exit(EXIT_FAILURE);
+	}
+	if (check && job.range / job.blocks > SNAP_NVME_MAX_DEPTH &&
+	    !cache_size) {
+		fprintf(stderr, "Err: --check runs range / blocks commands "
+			"at once, at most %d\n", SNAP_NVME_MAX_DEPTH);
+		exit(EXIT_FAILURE);
+	}
+
+	sprintf(device, "/dev/cxl/afu%d.0m", card_no);
+	card = snap_card_alloc_dev(device, SNAP_VENDOR_ID_IBM,
+				   SNAP_DEVICE_ID_SNAP);
+	if (NULL == card) {
+		VERBOSE0("Error: Cannot open %s\n", device);
+		rc = ENODEV;
+		goto __main_exit;
+	}
+
+	q = snap_nvme_queue_alloc(card, drive, id,
+				  check ? SNAP_NVME_MAX_DEPTH : depth);
+	if (NULL == q) {
+		VERBOSE0("Error: Cannot get NVMe queue drive %d id %u "
+			 "depth %u (%s)\n", drive, id, depth, strerror(errno));
+		rc = ENODEV;
+		goto __main_exit1;
+	}
+	VERBOSE1("Drive %d id %u LBA 0x%llx range 0x%llx DDR 0x%llx\n",
+		 drive, id, (long long)job.lba, (long long)job.range,
+		 (long long)job.ddr);
+
+	if (cache_size) {
+		/* The cache gets the next tracking id */
+		c = snap_nvme_cache_alloc(card, drive, id + 1, job.ddr,
+					  cache_size, cache_flags);
+		if (NULL == c) {
+			VERBOSE0("Error: Cannot get NVMe cache at DDR 0x%llx "
+				 "size 0x%llx (%s)\n", (long long)job.ddr,
+				 (long long)cache_size, strerror(errno));
+			rc = ENODEV;
+			goto __main_exit2;
+		}
+		if (check)
+			rc = cache_check(card, c, q, &job, cache_size);
+		else if (job.blocks > snap_nvme_cache_max_lines(c) *
+			 SNAP_NVME_CACHE_LINE_BLOCKS -
+			 SNAP_NVME_CACHE_LINE_BLOCKS) {
+			VERBOSE0("Error: cache too small for %u blocks\n",
+				 job.blocks);
+			rc = EINVAL;
+		} else	rc = cache_run(c, &job);
+		snap_nvme_cache_free(c);
+	} else if (check)
+		rc = nvme_check(card, q, &job);
+	else	rc = nvme_run(q, &job, depth);
+
+ __main_exit2:
+	snap_nvme_queue_free(q);
+__main_exit1:
+	snap_card_free(card);
+__main_exit:
+	VERBOSE1("Exit rc: %d\n", rc);
+	exit(rc);
+}
@@ -0,0 +1,301 @@
+/*
+ * Copyright 2017 International Business Machines
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Register model of the NVMe host for snap_nvme_init. Addresses are the
+ * MMIO offsets on the master context: the NVMe host registers at 0x20000,
+ * the indirect PCIe root port access at 0x30000/0x30004. Drive registers
+ * are reached through the PCIe address/data pair of the NVMe host.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <pthread.h>
+#include <sys/time.h>
+
+#include "snap_nvme_model.h"
+
+#define MODEL_DRIVES		2
+#define MODEL_LINK_US		200000	/* PCIe link training */
+#define MODEL_READY_US		50000	/* CC.EN to CSTS.RDY */
+#define MODEL_ADMIN_US		200	/* Admin command latency */
+
+#define MODEL_BUFFER_WORDS	0x1000	/* Admin buffer, 16 KiB */
+
+/* Host side registers */
+#define REG_COMMAND		0x20014
+#define REG_CONTROL		0x20080
+#define REG_STATUS		0x20084
+#define REG_BUFFER_ADDR		0x20088
+#define REG_PCIE_ADDR		0x2008c
+#define REG_NSID		0x20090
+#define REG_ASQ_INDEX		0x20094
+#define REG_SCRATCH		0x20098
+#define REG_BUFFER_DATA		0x20100
+#define REG_PCIE_DATA		0x20104
+#define REG_INDIRECT_ADDR	0x30000
+#define REG_INDIRECT_DATA	0x30004
+
+#define CONTROL_ENA		0x01
+#define CONTROL_EAINC		0x02
+#define CONTROL_CES		0x04
+
+#define STATUS_READY		0x01
+#define STATUS_ERROR		0x02
+#define STATUS_DONE(d)		(0x04 << (d))
+
+/* Root port registers, behind the indirect access */
+#define RP_LINK_STATUS		0x144
+#define RP_AXI_BAR		0x20c	/* Last write of the PCIe setup */
+#define RP_LINK_UP		0x1804	/* Gen3, x4, link up */
+
+/* NVMe controller registers */
+#define NVME_CAP_LO		0x00
+#define NVME_CAP_HI		0x04
+#define NVME_CC			0x14
+#define NVME_CSTS		0x1c
+#define NVME_CAP_TO		(2u << 24)	/* 1 sec ready timeout */
+
+/* Admin opcodes */
+#define ADMIN_CREATE_SQ		0x01
+#define ADMIN_CREATE_CQ		0x05
+
+struct model_drive {
+	bool setup;			/* Root port programmed */
+	uint32_t regs[0x40 / 4];	/* Controller registers 0x00..0x3c */
+	uint64_t ready_at;
+	uint64_t done_at;		/* Pending admin command, 0 for none */
+	unsigned int asq_index;
+	bool cq_created;
+	unsigned int admin_cmds;
+};
+
+static pthread_mutex_t model_lock = PTHREAD_MUTEX_INITIALIZER;
+static uint64_t model_t0;
+static uint32_t control, status, buffer_addr, pcie_addr, nsid, scratch;
+static uint32_t indirect_addr;
+static uint32_t buffer[MODEL_BUFFER_WORDS];
+static struct model_drive drives[MODEL_DRIVES];
+
+static uint64_t model_usec(void)
+{
+	struct timeval t;
+	uint64_t now;
+
+	gettimeofday(&t, NULL);
+	now = t.tv_sec * 1000000ull + t.tv_usec;
+	if (model_t0 == 0)
+		model_t0 = now;
+	return now - model_t0 + 1;
+}
+
+static bool drive_ready(struct model_drive *d, uint64_t now)
+{
+	return (d->regs[NVME_CC / 4] & 1) && now >= d->ready_at;
+}
+
+static void model_update(uint64_t now)
+{
+	int i;
+
+	for (i = 0; i < MODEL_DRIVES; i++) {
+		if (drives[i].done_at && now >= drives[i].done_at) {
+			drives[i].done_at = 0;
+			status |= STATUS_DONE(i);
+		}
+	}
+}
+
+static void admin_command(int drive, uint64_t now)
+{
+	struct model_drive *d = &drives[drive];
+	uint32_t base, opcode;
+
+	base = (drive ? 0x3780 : 0x0000) + d->asq_index * 0x40;
+	opcode = buffer[(base / 4) % MODEL_BUFFER_WORDS] & 0xff;
+
+	if (!drive_ready(d, now) || d->done_at) {
+		status |= STATUS_ERROR;
+		return;
+	}
+	if (opcode == ADMIN_CREATE_SQ && !d->cq_created) {
+		status |= STATUS_ERROR;
+		return;
+	}
+	if (opcode == ADMIN_CREATE_CQ)
+		d->cq_created = true;
+
+	d->asq_index = (d->asq_index + 1) % 4;
+	d->done_at = now + MODEL_ADMIN_US;
+	d->admin_cmds++;
+}
+
+static uint32_t drive_reg_read(uint32_t addr, uint64_t now)
+{
+	struct model_drive *d = &drives[(addr >> 13) & 1];
+	uint32_t reg = addr & 0x1fff;
+
+	if (!d->setup || reg >= sizeof(d->regs))
+		return 0xffffffff;
+	if (reg == NVME_CSTS)
+		return drive_ready(d, now) ? 1 : 0;
+	return d->regs[reg / 4];
+}
+
+static void drive_reg_write(uint32_t addr, uint32_t data, uint64_t now)
+{
+	struct model_drive *d = &drives[(addr >> 13) & 1];
+	uint32_t reg = addr & 0x1fff;
+
+	if (!d->setup || reg >= sizeof(d->regs))
+		return;
+	if (reg == NVME_CC && (data & 1) && !(d->regs[reg / 4] & 1))
+		d->ready_at = now + MODEL_READY_US;
+	d->regs[reg / 4] = data;
+}
+
+static uint32_t root_port_read(uint32_t addr, uint64_t now)
+{
+	int drive = (int)(addr >> 28) - 1;
+
+	if (drive < 0 || drive >= MODEL_DRIVES)
+		return 0xffffffff;
+	if ((addr & 0xfffffff) == RP_LINK_STATUS)
+		return (now >= MODEL_LINK_US) ? RP_LINK_UP : 0;
+	return 0;
+}
+
+static void root_port_write(uint32_t addr, uint32_t data __attribute__((unused)))
+{
+	int drive = (int)(addr >> 28) - 1;
+	struct model_drive *d;
+
+	if (drive < 0 || drive >= MODEL_DRIVES)
+		return;
+	d = &drives[drive];
+	if ((addr & 0xfffffff) == RP_AXI_BAR && !d->setup) {
+		d->setup = true;
+		d->regs[NVME_CAP_LO / 4] = NVME_CAP_TO | 0x3ff;
+		d->regs[NVME_CAP_HI / 4] = 0;
+	}
+}
+
+uint32_t nvme_model_read(uint32_t addr)
+{
+	uint64_t now;
+	uint32_t data = 0xffffffff;
+
+	pthread_mutex_lock(&model_lock);
+	now = model_usec();
+	model_update(now);
+
+	switch (addr) {
+	case REG_CONTROL:
+		data = control;
+		break;
+	case REG_STATUS:
+		data = status | ((control & CONTROL_ENA) ? STATUS_READY : 0);
+		/* Done bits clear on read */
+		status &= ~(STATUS_DONE(0) | STATUS_DONE(1));
+		break;
+	case REG_BUFFER_ADDR:
+		data = buffer_addr;
+		break;
+	case REG_PCIE_ADDR:
+		data = pcie_addr;
+		break;
+	case REG_NSID:
+		data = nsid;
+		break;
+	case REG_ASQ_INDEX:
+		data = drives[0].asq_index | (drives[1].asq_index << 16);
+		break;
+	case REG_SCRATCH:
+		data = scratch;
+		break;
+	case REG_PCIE_DATA:
+		data = drive_reg_read(pcie_addr, now);
+		break;
+	case REG_INDIRECT_DATA:
+		data = root_port_read(indirect_addr, now);
+		break;
+	}
+	pthread_mutex_unlock(&model_lock);
+	return data;
+}
+
+void nvme_model_write(uint32_t addr, uint32_t data)
+{
+	uint64_t now;
+
+	pthread_mutex_lock(&model_lock);
+	now = model_usec();
+	model_update(now);
+
+	switch (addr) {
+	case REG_COMMAND:
+		if ((data & 0xf) == 0x2)	/* Admin, queue 0 or 2 */
+			admin_command((data >> 5) & 1, now);
+		break;
+	case REG_CONTROL:
+		if (data & CONTROL_CES)
+			status &= ~STATUS_ERROR;
+		control = data & ~CONTROL_CES;
+		break;
+	case REG_BUFFER_ADDR:
+		buffer_addr = data;
+		break;
+	case REG_PCIE_ADDR:
+		pcie_addr = data;
+		break;
+	case REG_NSID:
+		nsid = data;
+		break;
+	case REG_SCRATCH:
+		scratch = data;
+		break;
+	case REG_BUFFER_DATA:
+		buffer[(buffer_addr / 4) % MODEL_BUFFER_WORDS] = data;
+		if (control & CONTROL_EAINC)
+			buffer_addr += 4;
+		break;
+	case REG_PCIE_DATA:
+		drive_reg_write(pcie_addr, data, now);
+		break;
+	case REG_INDIRECT_ADDR:
+		indirect_addr = data;
+		break;
+	case REG_INDIRECT_DATA:
+		root_port_write(indirect_addr, data);
+		break;
+	}
+	pthread_mutex_unlock(&model_lock);
+}
+
+void nvme_model_stats(FILE *fp)
+{
+	int i;
+
+	pthread_mutex_lock(&model_lock);
+	for (i = 0; i < MODEL_DRIVES; i++) {
+		fprintf(fp, "     Model SSD[%d] admin commands: %u\n",
+			i, drives[i].admin_cmds);
+		drives[i].admin_cmds = 0;
+	}
+	pthread_mutex_unlock(&model_lock);
+}
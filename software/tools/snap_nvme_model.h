@@ -0,0 +1,37 @@
+#ifndef __SNAP_NVME_MODEL_H__
+#define __SNAP_NVME_MODEL_H__
+
+/*
+ * Copyright 2017 International Business Machines
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Stand-in for the master context MMIO space of the NVMe host and its
+ * two drives, good enough to run the snap_nvme_init bring-up without a
+ * card. PCIe links come up, controllers get ready and admin commands
+ * complete after fixed delays. Admin commands sent too early or in the
+ * wrong order fail with the error status bit.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+
+uint32_t nvme_model_read(uint32_t addr);
+void nvme_model_write(uint32_t addr, uint32_t data);
+
+/* Admin commands executed per drive since the last call */
+void nvme_model_stats(FILE *fp);
+
+#endif	/* __SNAP_NVME_MODEL_H__ */
@@ -26,6 +26,7 @@
 #include <snap_tools.h>
 #include <libsnap.h>
 #include "force_cpu.h"
+#include "mmio_script.h"
 
 int verbose_flag = 0;
 
@@ -49,6 +50,8 @@ static void usage(const char *prog)
 	       "  -e, --must-be <value>     compare and exit if not equal.\n"
 	       "  -n, --must-not-be <value> compare and exit if equal.\n"
 	       "  -d, --dump                Number of 32 or 64 bytes to read. default 1\n"
+	       "  -s, --script <file|->     run the register operations in file\n"
+	       "                            or stdin, see mmio_script.h.\n"
 	       "  <addr>\n"
 		"Note: Use -w32 to access snap action starting at offset 0x10000\n"
 	       "Example:\n"
@@ -80,6 +83,7 @@ int main(int argc, char *argv[])
 	unsigned long interval = 0;
 	char device[128];
 	int dump = 1;
+	const char *script = NULL;
 
 	while (1) {
 		int option_index = 0;
@@ -101,11 +105,12 @@ int main(int argc, char *argv[])
 			{ "verbose",	 no_argument,	    NULL, 'v' },
 			{ "help",	 no_argument,	    NULL, 'h' },
 			{ "dump",	 required_argument, NULL, 'd' },
+			{ "script",	 required_argument, NULL, 's' },
 			{ 0,		 no_argument,	    NULL, 0   },
 		};
 
 		ch = getopt_long(argc, argv,
-				 "C:X:w:i:c:e:n:a:d:Vqvh",
+				 "C:X:w:i:c:e:n:a:d:s:Vqvh",
 				 long_options, &option_index);
 		if (ch == -1)	/* all params processed ? */
 			break;
@@ -155,17 +160,20 @@ int main(int argc, char *argv[])
 		case 'd':		/* dump */
 			dump = strtol(optarg, (char **)NULL, 0);
 			break;
+		case 's':
+			script = optarg;
+			break;
 		default:
 			usage(argv[0]);
 			exit(EXIT_FAILURE);
 		}
 	}
 
-	if (optind + 1 != argc) {
+	if (optind + (script ? 0 : 1) != argc) {
 		usage(argv[0]);
 		exit(EXIT_FAILURE);
 	}
-	offs = strtoull(argv[optind], NULL, 0);
+	offs = script ? 0 : strtoull(argv[optind], NULL, 0);
 
 	if (equal && not_equal) {
 		usage(argv[0]);
@@ -187,6 +195,12 @@ int main(int argc, char *argv[])
 	if (verbose_flag)
 		printf("[%s] Open CAPI Card Got handle: %p\n", argv[0], card);
 
+	if (script) {
+		rc = mmio_script_run(card, script, width, quiet);
+		snap_card_free(card);
+		exit(rc);
+	}
+
 	for (i = 0; i < count; i++) {
 		dump_more:
 		switch (width) {
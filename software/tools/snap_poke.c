@@ -25,6 +25,7 @@
 #include <snap_tools.h>
 #include <libsnap.h>
 #include "force_cpu.h"
+#include "mmio_script.h"
 
 int verbose_flag = 0;
 static int quiet = 0;
@@ -46,6 +47,8 @@ static void usage(const char *prog)
 	       "  -i, --interval <intv>     interval in usec, 0: default.\n"
 	       "  -c, --count <mum>         number of pokes, 1: default\n"
 	       "  -r, --read-back           read back and verify.\n"
+	       "  -s, --script <file|->     run the register operations in file\n"
+	       "                            or stdin, see mmio_script.h.\n"
 	       "  <addr> <val>\n"
 	       "\n"
 	       "Example:\n"
@@ -71,6 +74,7 @@ int main(int argc, char *argv[])
 	unsigned long interval = 0;
 	int xerrno;
 	char device[128];
+	const char *script = NULL;
 
 	while (1) {
 		int option_index = 0;
@@ -83,6 +87,7 @@ int main(int argc, char *argv[])
 			{ "interval",	required_argument, NULL, 'i' },
 			{ "count",	required_argument, NULL, 'c' },
 			{ "rd-back",	no_argument,       NULL, 'r' },
+			{ "script",	required_argument, NULL, 's' },
 
 			/* misc/support */
 			{ "version",	no_argument,	   NULL, 'V' },
@@ -93,7 +98,7 @@ int main(int argc, char *argv[])
 			{ 0,		no_argument,	   NULL, 0   },
 		};
 
-		ch = getopt_long(argc, argv, "p:C:X:w:i:c:Vqrvh",
+		ch = getopt_long(argc, argv, "p:C:X:w:i:c:s:Vqrvh",
 				 long_options, &option_index);
 		if (ch == -1)	/* all params processed ? */
 			break;
@@ -115,6 +120,9 @@ int main(int argc, char *argv[])
 		case 'c':		/* loop count */
 			count = strtol(optarg, (char **)NULL, 0);
 			break;
+		case 's':
+			script = optarg;
+			break;
 
 		case 'V':
 			printf("%s\n", version);
@@ -139,13 +147,16 @@ int main(int argc, char *argv[])
 		}
 	}
 
-	if (optind + 2 != argc) {
+	if (optind + (script ? 0 : 2) != argc) {
 		usage(argv[0]);
 		exit(EXIT_FAILURE);
 	}
 
-	offs = strtoull(argv[optind++], NULL, 0);
-	val  = strtoull(argv[optind++], NULL, 0);
+	if (script == NULL) {
+		offs = strtoull(argv[optind++], NULL, 0);
+		val  = strtoull(argv[optind++], NULL, 0);
+	} else
+		offs = val = 0;
 	rbval = ~val;
 	switch_cpu(cpu, verbose_flag);
 
@@ -165,6 +176,12 @@ int main(int argc, char *argv[])
 		exit(EXIT_FAILURE);
 	}
 
+	if (script) {
+		rc = mmio_script_run(card, script, width, quiet);
+		snap_card_free(card);
+		exit(rc);
+	}
+
 	for (i = 0; i < count; i++) {
 		switch (width) {
 		case 32: